@@ -52,15 +52,11 @@ BthPS3_DeviceContextHeaderInit(
 {
 	NTSTATUS status;
 	WDF_OBJECT_ATTRIBUTES attributes;
-	WDFKEY hKey = NULL;
-	ULONG length, type;
 
 	FuncEntry(TRACE_BTH);
 
 	PAGED_CODE();
 
-	DECLARE_CONST_UNICODE_STRING(slots, BTHPS3_REG_VALUE_SLOTS);
-
 	Header->Device = Device;
 
 	Header->IoTarget = WdfDeviceGetIoTarget(Device);
@@ -112,16 +108,9 @@ BthPS3_DeviceContextHeaderInit(
 			break;
 		}
 
-		//
-		// Open
-		//   HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Services\BthPS3\Parameters
-		// key
-		// 
-		if (!NT_SUCCESS(status = WdfDriverOpenParametersRegistryKey(
-			WdfGetDriver(),
-			STANDARD_RIGHTS_READ,
-			WDF_NO_OBJECT_ATTRIBUTES,
-			&hKey
+		if (!NT_SUCCESS(status = BthPS3_FlightRecorderInitialize(
+			Device,
+			&Header->FlightRecorder
 		)))
 		{
 			break;
@@ -130,22 +119,13 @@ BthPS3_DeviceContextHeaderInit(
 		//
 		// Restore persisted slots, if any
 		// 
-		(void)WdfRegistryQueryValue(
-			hKey,
-			&slots,
-			sizeof(Header->Slots),
-			&Header->Slots,
-			&length,
-			&type
-		);
+		if (!NT_SUCCESS(status = BthPS3_PDO_InitializeSlots(Header)))
+		{
+			break;
+		}
 
 	} while (FALSE);
 
-	if (hKey)
-	{
-		WdfRegistryClose(hKey);
-	}
-
 	FuncExit(TRACE_BTH, "status=%!STATUS!", status);
 
 	return status;
@@ -230,6 +210,26 @@ BthPS3_ServerContextInit(
 			break;
 		}
 
+		if (!NT_SUCCESS(status = WdfSpinLockCreate(
+			&attributes,
+			&Context->FeatureReports.Lock
+		)))
+		{
+			break;
+		}
+
+		BthPS3_FeatureCacheInit(&Context->FeatureReports.Cache);
+
+		if (!NT_SUCCESS(status = WdfSpinLockCreate(
+			&attributes,
+			&Context->RejectedDevices.Lock
+		)))
+		{
+			break;
+		}
+
+		BthPS3_RejectCacheInit(&Context->RejectedDevices.Cache);
+
 		//
 		// Query registry for dynamic values
 		// 
@@ -256,6 +256,9 @@ BthPS3_SettingsContextInit(
 	NTSTATUS status;
 	WDFKEY hKey = NULL;
 	WDF_OBJECT_ATTRIBUTES attributes;
+	UCHAR reportIds[0x100];
+	ULONG reportIdsLength = 0;
+	ULONG valueType = REG_NONE;
 
 	PAGED_CODE();
 
@@ -268,6 +271,12 @@ BthPS3_SettingsContextInit(
 	DECLARE_CONST_UNICODE_STRING(isMOTIONSupported, BTHPS3_REG_VALUE_IS_MOTION_SUPPORTED);
 	DECLARE_CONST_UNICODE_STRING(isWIRELESSSupported, BTHPS3_REG_VALUE_IS_WIRELESS_SUPPORTED);
 
+	DECLARE_CONST_UNICODE_STRING(maxControllersPerRadio, BTHPS3_REG_VALUE_MAX_CONTROLLERS_PER_RADIO);
+	DECLARE_CONST_UNICODE_STRING(SIXAXISEnableOnConnect, BTHPS3_REG_VALUE_SIXAXIS_ENABLE_ON_CONNECT);
+	DECLARE_CONST_UNICODE_STRING(featureReportCacheIds, BTHPS3_REG_VALUE_FEATURE_REPORT_CACHE_IDS);
+	DECLARE_CONST_UNICODE_STRING(featureReportCachePersist, BTHPS3_REG_VALUE_FEATURE_REPORT_CACHE_PERSIST);
+	DECLARE_CONST_UNICODE_STRING(rejectedDeviceCacheTimeout, BTHPS3_REG_VALUE_REJECTED_DEVICE_CACHE_TIMEOUT);
+
 	DECLARE_CONST_UNICODE_STRING(SIXAXISSupportedNames, BTHPS3_REG_VALUE_SIXAXIS_SUPPORTED_NAMES);
 	DECLARE_CONST_UNICODE_STRING(NAVIGATIONSupportedNames, BTHPS3_REG_VALUE_NAVIGATION_SUPPORTED_NAMES);
 	DECLARE_CONST_UNICODE_STRING(MOTIONSupportedNames, BTHPS3_REG_VALUE_MOTION_SUPPORTED_NAMES);
@@ -285,6 +294,11 @@ BthPS3_SettingsContextInit(
 	Context->Settings.IsMOTIONSupported = TRUE;
 	Context->Settings.IsWIRELESSSupported = TRUE;
 
+	Context->Settings.MaxControllersPerRadio = 0; // Unlimited
+	Context->Settings.SIXAXISEnableOnConnect = FALSE;
+	Context->Settings.FeatureReportCachePersist = FALSE;
+	Context->Settings.RejectedDeviceCacheTimeout = 60; // Seconds
+
 	//
 	// Open
 	//   HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Services\BthPS3\Parameters
@@ -347,6 +361,48 @@ BthPS3_SettingsContextInit(
 			&Context->Settings.IsWIRELESSSupported
 		);
 
+		(void)WdfRegistryQueryULong(
+			hKey,
+			&maxControllersPerRadio,
+			&Context->Settings.MaxControllersPerRadio
+		);
+
+		(void)WdfRegistryQueryULong(
+			hKey,
+			&SIXAXISEnableOnConnect,
+			&Context->Settings.SIXAXISEnableOnConnect
+		);
+
+		(void)WdfRegistryQueryULong(
+			hKey,
+			&featureReportCachePersist,
+			&Context->Settings.FeatureReportCachePersist
+		);
+
+		(void)WdfRegistryQueryULong(
+			hKey,
+			&rejectedDeviceCacheTimeout,
+			&Context->Settings.RejectedDeviceCacheTimeout
+		);
+
+		//
+		// One report ID per byte, nothing gets cached if absent
+		// 
+		if (NT_SUCCESS(WdfRegistryQueryValue(
+			hKey,
+			&featureReportCacheIds,
+			sizeof(reportIds),
+			reportIds,
+			&reportIdsLength,
+			&valueType
+		)) && valueType == REG_BINARY)
+		{
+			for (ULONG index = 0; index < reportIdsLength; index++)
+			{
+				BthPS3_FeatureCacheAllow(&Context->FeatureReports.Cache, reportIds[index]);
+			}
+		}
+
 		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
 		attributes.ParentObject = Context->Settings.SIXAXISSupportedNames;
 		(void)WdfRegistryQueryMultiString(
@@ -0,0 +1,188 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include "Driver.h"
+#include "Bluetooth.Radios.tmh"
+
+
+//
+// All radio (server) devices of this driver, spin lock so the load can be
+// reported from I/O handlers running at DISPATCH_LEVEL
+// 
+static WDFCOLLECTION G_RadioCollection = NULL;
+static WDFSPINLOCK G_RadioCollectionLock = NULL;
+
+
+//
+// Creates the registry, objects are parented to the driver
+// 
+#pragma code_seg("PAGE")
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_RadiosInitialize(
+	WDFDRIVER Driver
+)
+{
+	NTSTATUS status;
+	WDF_OBJECT_ATTRIBUTES attributes;
+
+	PAGED_CODE();
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Driver;
+
+	if (!NT_SUCCESS(status = WdfCollectionCreate(
+		&attributes,
+		&G_RadioCollection
+	)))
+	{
+		TraceError(
+			TRACE_BTH,
+			"WdfCollectionCreate failed with status %!STATUS!",
+			status
+		);
+		return status;
+	}
+
+	if (!NT_SUCCESS(status = WdfSpinLockCreate(
+		&attributes,
+		&G_RadioCollectionLock
+	)))
+	{
+		TraceError(
+			TRACE_BTH,
+			"WdfSpinLockCreate failed with status %!STATUS!",
+			status
+		);
+		return status;
+	}
+
+	return status;
+}
+#pragma code_seg()
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_RadioAdd(
+	WDFDEVICE Device
+)
+{
+	NTSTATUS status;
+
+	WdfSpinLockAcquire(G_RadioCollectionLock);
+
+	//
+	// WdfCollectionAdd takes a reference on the device
+	// 
+	status = WdfCollectionAdd(G_RadioCollection, Device);
+
+	WdfSpinLockRelease(G_RadioCollectionLock);
+
+	if (!NT_SUCCESS(status))
+	{
+		TraceError(
+			TRACE_BTH,
+			"WdfCollectionAdd failed with status %!STATUS!",
+			status
+		);
+	}
+
+	return status;
+}
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+BthPS3_RadioRemove(
+	WDFDEVICE Device
+)
+{
+	WdfSpinLockAcquire(G_RadioCollectionLock);
+
+	const ULONG count = WdfCollectionGetCount(G_RadioCollection);
+
+	//
+	// Device might never have made it into the collection
+	// 
+	for (ULONG index = 0; index < count; index++)
+	{
+		if (WdfCollectionGetItem(G_RadioCollection, index) == Device)
+		{
+			WdfCollectionRemoveItem(G_RadioCollection, index);
+			break;
+		}
+	}
+
+	WdfSpinLockRelease(G_RadioCollectionLock);
+}
+
+//
+// Fills in one entry per radio, in order of arrival
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_RadiosGetLoad(
+	PBTHPS3_GET_RADIO_LOAD Load
+)
+{
+	RtlZeroMemory(Load, sizeof(BTHPS3_GET_RADIO_LOAD));
+
+	WdfSpinLockAcquire(G_RadioCollectionLock);
+
+	Load->Timestamp = KeQueryInterruptTime();
+
+	const ULONG count = min(WdfCollectionGetCount(G_RadioCollection), BTHPS3_MAX_RADIOS);
+
+	for (ULONG index = 0; index < count; index++)
+	{
+		const PBTHPS3_SERVER_CONTEXT pSrvCtx =
+			GetServerDeviceContext(WdfCollectionGetItem(G_RadioCollection, index));
+		const PBTHPS3_RADIO_LOAD pRadio = &Load->Radios[index];
+
+		pRadio->RadioAddress = pSrvCtx->Header.LocalBthAddr;
+		pRadio->ActiveLinks = (ULONG)ReadNoFence(&pSrvCtx->Header.ActiveLinks);
+		pRadio->MaxLinks = pSrvCtx->Settings.MaxControllersPerRadio;
+		pRadio->BytesTransferred = (ULONG64)ReadNoFence64(&pSrvCtx->Header.BytesTransferred);
+		pRadio->DeniedConnections = (ULONG64)ReadNoFence64(&pSrvCtx->DeniedConnections);
+		pRadio->InputCrcFailures = (ULONG64)ReadNoFence64(&pSrvCtx->Header.InputCrcFailures);
+		pRadio->CachedDenials = (ULONG64)ReadNoFence64(&pSrvCtx->RejectedDevices.Cache.Hits);
+		pRadio->RejectedDevices = (ULONG64)ReadNoFence64(&pSrvCtx->RejectedDevices.Cache.Inserts);
+	}
+
+	Load->RadioCount = count;
+
+	WdfSpinLockRelease(G_RadioCollectionLock);
+}
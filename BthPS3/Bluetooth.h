@@ -47,10 +47,16 @@
 #include <bthsdpdef.h>
 #include <bthguid.h>
 
+#include "SlotBitmap.h"
+#include "FlightRecorder.h"
+#include "FeatureCache.h"
+#include "RejectCache.h"
+
 #define POOLTAG_BTHPS3                  '3SPB'
 #define BTH_DEVICE_INFO_MAX_COUNT       UCHAR_MAX
 #define BTH_DEVICE_INFO_MAX_RETRIES     UCHAR_MAX
-#define BTHPS3_MAX_NUM_DEVICES			UCHAR_MAX
+#define BTHPS3_MAX_NUM_DEVICES			(BTHPS3_SLOT_MAP_MAX_SLOTS - 1)
+#define BTHPS3_SLOTS_INITIAL_CAPACITY	256
 #define BTHPS3_BTH_ADDR_MAX_CHARS		13 /* 12 characters + NULL terminator */
 
 
@@ -93,15 +99,36 @@ typedef struct _BTHPS3_DEVICE_CONTEXT_HEADER
 	// 
 	WDFWAITLOCK ClientsLock;
 
+	//
+	// Number of items in Clients plus links reserved for connections still
+	// being set up, readable without the lock
+	// 
+	volatile LONG ActiveLinks;
+
+	//
+	// HID payload bytes moved through all children
+	// 
+	volatile LONG64 BytesTransferred;
+
+	//
+	// DualShock 4 input reports that failed the CRC32 check
+	// 
+	volatile LONG64 InputCrcFailures;
+
 	//
 	// DMF module to handle PDO creation
 	// 
 	DMFMODULE PdoModule;
 
 	//
-	// Free and occupied serial numbers
+	// Free and occupied serial numbers, grows on demand
 	// 
-	UINT32 Slots[8]; // 256 usable bits
+	BTHPS3_SLOT_MAP Slots;
+
+	//
+	// Backing storage of Slots.Words
+	// 
+	WDFMEMORY SlotsMemory;
 
 	//
 	// Lock protecting Slots access
@@ -113,6 +140,11 @@ typedef struct _BTHPS3_DEVICE_CONTEXT_HEADER
 	// 
 	DMFMODULE QueuedWorkItemModule;
 
+	//
+	// Per-processor rings of recent hot-path events
+	// 
+	BTHPS3_FLIGHT_RECORDER FlightRecorder;
+
 } BTHPS3_DEVICE_CONTEXT_HEADER, * PBTHPS3_DEVICE_CONTEXT_HEADER;
 
 typedef struct _BTHPS3_SERVER_CONTEXT
@@ -165,6 +197,36 @@ typedef struct _BTHPS3_SERVER_CONTEXT
 
 	} PsmFilter;
 
+	//
+	// Connections rejected due to MaxControllersPerRadio
+	// 
+	volatile LONG64 DeniedConnections;
+
+	struct
+	{
+		WDFSPINLOCK Lock;
+
+		//
+		// Allow-listed feature reports of all remotes seen since load
+		// 
+		BTHPS3_FEATURE_CACHE Cache;
+
+	} FeatureReports;
+
+	struct
+	{
+		//
+		// Serializes writers, lookups don't need it
+		// 
+		WDFSPINLOCK Lock;
+
+		//
+		// Remotes recently denied for not being identified
+		// 
+		BTHPS3_REJECT_CACHE Cache;
+
+	} RejectedDevices;
+
 	struct
 	{
 		ULONG AutoEnableFilter;
@@ -181,6 +243,14 @@ typedef struct _BTHPS3_SERVER_CONTEXT
 
 		ULONG IsWIRELESSSupported;
 
+		ULONG MaxControllersPerRadio;
+
+		ULONG SIXAXISEnableOnConnect;
+
+		ULONG FeatureReportCachePersist;
+
+		ULONG RejectedDeviceCacheTimeout;
+
 		WDFCOLLECTION SIXAXISSupportedNames;
 
 		WDFCOLLECTION NAVIGATIONSupportedNames;
@@ -336,6 +406,34 @@ BthPS3_GetDeviceName(
 	PCHAR Name
 );
 
+//
+// Driver-global registry of radios
+// 
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_RadiosInitialize(
+	_In_ WDFDRIVER Driver
+);
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_RadioAdd(
+	_In_ WDFDEVICE Device
+);
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+BthPS3_RadioRemove(
+	_In_ WDFDEVICE Device
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_RadiosGetLoad(
+	_Out_ PBTHPS3_GET_RADIO_LOAD Load
+);
+
 //
 // Request HCI version from radio
 // 
@@ -39,6 +39,77 @@
 #include "BusLogic.IO.tmh"
 
 
+//
+// Records how many requests are waiting in a channel queue
+// 
+FORCEINLINE
+VOID
+BthPS3_PDO_RecordQueueDepth(
+	_In_ PBTHPS3_PDO_CONTEXT PdoCtx,
+	_In_ WDFQUEUE Queue,
+	_In_ UCHAR Channel
+)
+{
+	ULONG queueRequests = 0;
+
+	(void)WdfIoQueueGetState(Queue, &queueRequests, NULL);
+
+	BthPS3_FlightRecorderRecord(
+		&PdoCtx->DevCtxHdr->FlightRecorder,
+		BTHPS3_FLIGHT_RECORDER_QUEUE_DEPTH,
+		Channel,
+		PdoCtx->SerialNumber,
+		queueRequests
+	);
+}
+
+//
+// Fetches the transfer buffer of a queued HID request, the direct I/O
+// variants yield the caller's MDL so BTHPORT can use it without a copy
+// 
+static
+NTSTATUS
+BthPS3_PDO_RetrieveTransferBuffer(
+	_In_ WDFREQUEST Request,
+	_In_ BOOLEAN IsRead,
+	_Out_ PVOID* Buffer,
+	_Out_ PMDL* BufferMDL,
+	_Out_ size_t* Length
+)
+{
+	NTSTATUS status;
+	WDF_REQUEST_PARAMETERS params;
+
+	*Buffer = NULL;
+	*BufferMDL = NULL;
+	*Length = 0;
+
+	WDF_REQUEST_PARAMETERS_INIT(&params);
+	WdfRequestGetParameters(Request, &params);
+
+	const ULONG method = METHOD_FROM_CTL_CODE(params.Parameters.DeviceIoControl.IoControlCode);
+
+	if (method == METHOD_IN_DIRECT || method == METHOD_OUT_DIRECT)
+	{
+		//
+		// Data is described by the output MDL for either direction
+		// 
+		if (NT_SUCCESS(status = WdfRequestRetrieveOutputWdmMdl(Request, BufferMDL)))
+		{
+			*Length = params.Parameters.DeviceIoControl.OutputBufferLength;
+		}
+
+		return status;
+	}
+
+	if (IsRead)
+	{
+		return WdfRequestRetrieveOutputBuffer(Request, 0, Buffer, Length);
+	}
+
+	return WdfRequestRetrieveInputBuffer(Request, 0, Buffer, Length);
+}
+
  //
  // Handles IOCTL_BTHPS3_HID_CONTROL_READ
  // 
@@ -62,7 +133,7 @@ BthPS3_PDO_HandleHidControlRead(
 	UNREFERENCED_PARAMETER(OutputBufferSize);
 	UNREFERENCED_PARAMETER(OutputBuffer);
 
-	FuncEntry(TRACE_BUSLOGIC);
+	HotFuncEntry(TRACE_BUSLOGIC);
 
 	NTSTATUS status;
 	const WDFDEVICE device = DMF_ParentDeviceGet(DmfModule);
@@ -81,9 +152,18 @@ BthPS3_PDO_HandleHidControlRead(
 			status
 		);
 	}
-	else status = STATUS_PENDING;
+	else
+	{
+		status = STATUS_PENDING;
 
-	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+		BthPS3_PDO_RecordQueueDepth(
+			pPdoCtx,
+			pPdoCtx->Queues.HidControlReadRequests,
+			BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_READ
+		);
+	}
+
+	HotFuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
 
 	return status;
 }
@@ -111,7 +191,7 @@ BthPS3_PDO_HandleHidControlWrite(
 	UNREFERENCED_PARAMETER(InputBuffer);
 	UNREFERENCED_PARAMETER(InputBufferSize);
 
-	FuncEntry(TRACE_BUSLOGIC);
+	HotFuncEntry(TRACE_BUSLOGIC);
 
 	NTSTATUS status;
 	const WDFDEVICE device = DMF_ParentDeviceGet(DmfModule);
@@ -130,9 +210,70 @@ BthPS3_PDO_HandleHidControlWrite(
 			status
 		);
 	}
-	else status = STATUS_PENDING;
+	else
+	{
+		status = STATUS_PENDING;
 
-	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+		BthPS3_PDO_RecordQueueDepth(
+			pPdoCtx,
+			pPdoCtx->Queues.HidControlWriteRequests,
+			BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_WRITE
+		);
+	}
+
+	HotFuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+
+//
+// Handles IOCTL_BTHPS3_HID_CONTROL_TRANSACT
+// 
+NTSTATUS
+BthPS3_PDO_HandleHidControlTransact(
+	_In_ DMFMODULE DmfModule,
+	_In_ WDFQUEUE Queue,
+	_In_ WDFREQUEST Request,
+	_In_ ULONG IoctlCode,
+	_In_reads_(InputBufferSize) VOID* InputBuffer,
+	_In_ size_t InputBufferSize,
+	_Out_writes_(OutputBufferSize) VOID* OutputBuffer,
+	_In_ size_t OutputBufferSize,
+	_Out_ size_t* BytesReturned
+)
+{
+	UNREFERENCED_PARAMETER(Queue);
+	UNREFERENCED_PARAMETER(IoctlCode);
+	UNREFERENCED_PARAMETER(InputBuffer);
+	UNREFERENCED_PARAMETER(InputBufferSize);
+	UNREFERENCED_PARAMETER(OutputBufferSize);
+	UNREFERENCED_PARAMETER(OutputBuffer);
+
+	HotFuncEntry(TRACE_BUSLOGIC);
+
+	NTSTATUS status;
+	const WDFDEVICE device = DMF_ParentDeviceGet(DmfModule);
+	const PBTHPS3_PDO_CONTEXT pPdoCtx = GetPdoContext(device);
+
+	*BytesReturned = 0;
+
+	if (!NT_SUCCESS(status = WdfRequestForwardToIoQueue(
+		Request,
+		pPdoCtx->Queues.HidControlTransactions
+	)))
+	{
+		TraceError(
+			TRACE_BUSLOGIC,
+			"WdfRequestForwardToIoQueue failed with status %!STATUS!",
+			status
+		);
+	}
+	else
+	{
+		status = STATUS_PENDING;
+	}
+
+	HotFuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
 
 	return status;
 }
@@ -160,7 +301,7 @@ BthPS3_PDO_HandleHidInterruptRead(
 	UNREFERENCED_PARAMETER(OutputBuffer);
 	UNREFERENCED_PARAMETER(OutputBufferSize);
 
-	FuncEntry(TRACE_BUSLOGIC);
+	HotFuncEntry(TRACE_BUSLOGIC);
 
     *BytesReturned = 0;
 
@@ -179,9 +320,18 @@ BthPS3_PDO_HandleHidInterruptRead(
 			status
 		);
 	}
-	else status = STATUS_PENDING;
+	else
+	{
+		status = STATUS_PENDING;
 
-	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+		BthPS3_PDO_RecordQueueDepth(
+			pPdoCtx,
+			pPdoCtx->Queues.HidInterruptReadRequests,
+			BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_READ
+		);
+	}
+
+	HotFuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
 
 	return status;
 }
@@ -209,7 +359,7 @@ BthPS3_PDO_HandleHidInterruptWrite(
 	UNREFERENCED_PARAMETER(InputBuffer);
 	UNREFERENCED_PARAMETER(InputBufferSize);
 
-	FuncEntry(TRACE_BUSLOGIC);
+	HotFuncEntry(TRACE_BUSLOGIC);
 
 	NTSTATUS status;
 	const WDFDEVICE device = DMF_ParentDeviceGet(DmfModule);
@@ -228,9 +378,18 @@ BthPS3_PDO_HandleHidInterruptWrite(
 			status
 		);
 	}
-	else status = STATUS_PENDING;
+	else
+	{
+		status = STATUS_PENDING;
 
-	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+		BthPS3_PDO_RecordQueueDepth(
+			pPdoCtx,
+			pPdoCtx->Queues.HidInterruptWriteRequests,
+			BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_WRITE
+		);
+	}
+
+	HotFuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
 
 	return status;
 }
@@ -251,7 +410,7 @@ BthPS3_PDO_HandleBthDisconnect(
 	_Out_ size_t* BytesReturned
 )
 {
-	FuncEntry(TRACE_BUSLOGIC);
+	HotFuncEntry(TRACE_BUSLOGIC);
 
 	UNREFERENCED_PARAMETER(Queue);
 	UNREFERENCED_PARAMETER(Request);
@@ -271,6 +430,14 @@ BthPS3_PDO_HandleBthDisconnect(
 
     *BytesReturned = 0;
 
+	BthPS3_FlightRecorderRecord(
+		&pPdoCtx->DevCtxHdr->FlightRecorder,
+		BTHPS3_FLIGHT_RECORDER_DISCONNECT_STAGE,
+		BTHPS3_FLIGHT_RECORDER_DISCONNECT_REQUESTED,
+		pPdoCtx->SerialNumber,
+		pPdoCtx->RemoteAddress
+	);
+
 	do
 	{
 		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
@@ -372,14 +539,263 @@ BthPS3_PDO_HandleBthDisconnect(
 		WdfObjectDelete(dcRequest);
 	}
 
+	HotFuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+
+//
+// Handles IOCTL_BTHPS3_GET_FLIGHT_RECORDER
+// 
+NTSTATUS
+BthPS3_PDO_HandleGetFlightRecorder(
+	_In_ DMFMODULE DmfModule,
+	_In_ WDFQUEUE Queue,
+	_In_ WDFREQUEST Request,
+	_In_ ULONG IoctlCode,
+	_In_reads_(InputBufferSize) VOID* InputBuffer,
+	_In_ size_t InputBufferSize,
+	_Out_writes_(OutputBufferSize) VOID* OutputBuffer,
+	_In_ size_t OutputBufferSize,
+	_Out_ size_t* BytesReturned
+)
+{
+	UNREFERENCED_PARAMETER(Queue);
+	UNREFERENCED_PARAMETER(Request);
+	UNREFERENCED_PARAMETER(IoctlCode);
+	UNREFERENCED_PARAMETER(InputBuffer);
+	UNREFERENCED_PARAMETER(InputBufferSize);
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	const NTSTATUS status = STATUS_SUCCESS;
+	const WDFDEVICE device = DMF_ParentDeviceGet(DmfModule);
+	const PBTHPS3_PDO_CONTEXT pPdoCtx = GetPdoContext(device);
+
+	//
+	// The recorder is shared by all children of the radio
+	// 
+	BthPS3_FlightRecorderDump(
+		&pPdoCtx->DevCtxHdr->FlightRecorder,
+		(PBTHPS3_GET_FLIGHT_RECORDER)OutputBuffer,
+		OutputBufferSize,
+		BytesReturned
+	);
+
 	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
 
 	return status;
 }
 
+//
+// Handles IOCTL_BTHPS3_GET_RADIO_LOAD, reports all radios, not just the parent of this child
+// 
+NTSTATUS
+BthPS3_PDO_HandleGetRadioLoad(
+	_In_ DMFMODULE DmfModule,
+	_In_ WDFQUEUE Queue,
+	_In_ WDFREQUEST Request,
+	_In_ ULONG IoctlCode,
+	_In_reads_(InputBufferSize) VOID* InputBuffer,
+	_In_ size_t InputBufferSize,
+	_Out_writes_(OutputBufferSize) VOID* OutputBuffer,
+	_In_ size_t OutputBufferSize,
+	_Out_ size_t* BytesReturned
+)
+{
+	UNREFERENCED_PARAMETER(DmfModule);
+	UNREFERENCED_PARAMETER(Queue);
+	UNREFERENCED_PARAMETER(Request);
+	UNREFERENCED_PARAMETER(IoctlCode);
+	UNREFERENCED_PARAMETER(InputBuffer);
+	UNREFERENCED_PARAMETER(InputBufferSize);
+	UNREFERENCED_PARAMETER(OutputBufferSize);
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	const NTSTATUS status = STATUS_SUCCESS;
+
+	BthPS3_RadiosGetLoad((PBTHPS3_GET_RADIO_LOAD)OutputBuffer);
+
+	*BytesReturned = sizeof(BTHPS3_GET_RADIO_LOAD);
+
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+
+//
+// Handles IOCTL_BTHPS3_GET_CAPABILITIES
+// 
+NTSTATUS
+BthPS3_PDO_HandleGetCapabilities(
+	_In_ DMFMODULE DmfModule,
+	_In_ WDFQUEUE Queue,
+	_In_ WDFREQUEST Request,
+	_In_ ULONG IoctlCode,
+	_In_reads_(InputBufferSize) VOID* InputBuffer,
+	_In_ size_t InputBufferSize,
+	_Out_writes_(OutputBufferSize) VOID* OutputBuffer,
+	_In_ size_t OutputBufferSize,
+	_Out_ size_t* BytesReturned
+)
+{
+	UNREFERENCED_PARAMETER(DmfModule);
+	UNREFERENCED_PARAMETER(Queue);
+	UNREFERENCED_PARAMETER(Request);
+	UNREFERENCED_PARAMETER(IoctlCode);
+	UNREFERENCED_PARAMETER(InputBuffer);
+	UNREFERENCED_PARAMETER(InputBufferSize);
+	UNREFERENCED_PARAMETER(OutputBufferSize);
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	const NTSTATUS status = STATUS_SUCCESS;
+	const PBTHPS3_GET_CAPABILITIES pCaps = (PBTHPS3_GET_CAPABILITIES)OutputBuffer;
+
+	pCaps->Capabilities = BTHPS3_CAPABILITY_DIRECT_HID_IO
+		| BTHPS3_CAPABILITY_SET_FEEDBACK
+		| BTHPS3_CAPABILITY_MOTION_IMU
+		| BTHPS3_CAPABILITY_WRITE_CRC
+		| BTHPS3_CAPABILITY_DECODED_STATE
+		| BTHPS3_CAPABILITY_STATE_PAGE
+		| BTHPS3_CAPABILITY_CONTROL_TRANSACTION;
+
+	*BytesReturned = sizeof(BTHPS3_GET_CAPABILITIES);
+
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+
+//
+// Handles IOCTL_BTHPS3_SET_FEEDBACK, the synthesized output report is only
+// sent if it differs from the one the device got last
+// 
+NTSTATUS
+BthPS3_PDO_HandleSetFeedback(
+	_In_ DMFMODULE DmfModule,
+	_In_ WDFQUEUE Queue,
+	_In_ WDFREQUEST Request,
+	_In_ ULONG IoctlCode,
+	_In_reads_(InputBufferSize) VOID* InputBuffer,
+	_In_ size_t InputBufferSize,
+	_Out_writes_(OutputBufferSize) VOID* OutputBuffer,
+	_In_ size_t OutputBufferSize,
+	_Out_ size_t* BytesReturned
+)
+{
+	UNREFERENCED_PARAMETER(Queue);
+	UNREFERENCED_PARAMETER(IoctlCode);
+	UNREFERENCED_PARAMETER(InputBufferSize);
+	UNREFERENCED_PARAMETER(OutputBuffer);
+	UNREFERENCED_PARAMETER(OutputBufferSize);
+
+	HotFuncEntry(TRACE_BUSLOGIC);
+
+	NTSTATUS status = STATUS_SUCCESS;
+	const WDFDEVICE device = DMF_ParentDeviceGet(DmfModule);
+	const PBTHPS3_PDO_CONTEXT pPdoCtx = GetPdoContext(device);
+	WDF_OBJECT_ATTRIBUTES attributes;
+	WDFMEMORY reportMemory = NULL;
+	PVOID pReportBuffer = NULL;
+	UCHAR report[BTHPS3_OUTPUT_REPORT_MAX_SIZE];
+	ULONG reportLength;
+	BOOLEAN isControlChannel;
+	BOOLEAN isSendRequired;
+
+	*BytesReturned = 0;
+
+	do
+	{
+		if (!pPdoCtx->Feedback.IsSupported)
+		{
+			status = STATUS_NOT_SUPPORTED;
+			break;
+		}
+
+		WdfSpinLockAcquire(pPdoCtx->Feedback.Lock);
+		isSendRequired = BthPS3_OutputReportApply(
+			&pPdoCtx->Feedback.State,
+			(const BTHPS3_SET_FEEDBACK*)InputBuffer
+		);
+		reportLength = pPdoCtx->Feedback.State.Length;
+		isControlChannel = pPdoCtx->Feedback.State.IsControlChannel;
+		RtlCopyMemory(report, pPdoCtx->Feedback.State.Report, reportLength);
+		WdfSpinLockRelease(pPdoCtx->Feedback.Lock);
+
+		if (!isSendRequired)
+		{
+			break;
+		}
+
+		//
+		// Has to outlive the transfer, freed with the request
+		// 
+		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+		attributes.ParentObject = Request;
+
+		if (NT_SUCCESS(status = WdfMemoryCreate(
+			&attributes,
+			NonPagedPoolNx,
+			POOLTAG_BTHPS3,
+			reportLength,
+			&reportMemory,
+			&pReportBuffer
+		)))
+		{
+			RtlCopyMemory(pReportBuffer, report, reportLength);
+
+			status = isControlChannel
+				? L2CAP_PS3_SendControlTransferAsync(
+					pPdoCtx,
+					Request,
+					pReportBuffer,
+					NULL,
+					reportLength,
+					L2CAP_PS3_FeedbackSendControlCompleted
+				)
+				: L2CAP_PS3_SendInterruptTransferAsync(
+					pPdoCtx,
+					Request,
+					pReportBuffer,
+					NULL,
+					reportLength,
+					L2CAP_PS3_FeedbackSendInterruptCompleted
+				);
+		}
+
+		if (!NT_SUCCESS(status))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"Sending output report failed with status %!STATUS!",
+				status
+			);
+
+			//
+			// Make sure the next command goes out regardless
+			// 
+			WdfSpinLockAcquire(pPdoCtx->Feedback.Lock);
+			pPdoCtx->Feedback.State.IsSent = FALSE;
+			WdfSpinLockRelease(pPdoCtx->Feedback.Lock);
+
+			break;
+		}
+
+		status = STATUS_PENDING;
+
+	} while (FALSE);
+
+	HotFuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+
 
 //
-// Sends pending HID Control Read Requests through L2CAP channel to remote device
+// Sends pending HID Control Read Requests through L2CAP channel to remote device,
+// they stay queued while a control transaction waits for its response
 // 
 VOID
 BthPS3_PDO_DispatchHidControlRead(
@@ -387,29 +803,53 @@ BthPS3_PDO_DispatchHidControlRead(
 	_In_ WDFCONTEXT Context
 )
 {
-	FuncEntry(TRACE_BUSLOGIC);
+	HotFuncEntry(TRACE_BUSLOGIC);
 
 	const PBTHPS3_PDO_CONTEXT pPdoCtx = Context;
 	NTSTATUS status;
 	WDFREQUEST request = NULL;
 	PVOID buffer = NULL;
+	PMDL mdl = NULL;
 	size_t length = 0;
 
-	while (NT_SUCCESS(WdfIoQueueRetrieveNextRequest(Queue, &request)))
+	for (;;)
 	{
-		if (!NT_SUCCESS(status = WdfRequestRetrieveOutputBuffer(
+		WdfSpinLockAcquire(pPdoCtx->ControlTransaction.Lock);
+
+		//
+		// Dispatched again once the transaction completed
+		// 
+		status = pPdoCtx->ControlTransaction.IsActive
+			? STATUS_DEVICE_BUSY
+			: WdfIoQueueRetrieveNextRequest(Queue, &request);
+
+		if (NT_SUCCESS(status))
+		{
+			InterlockedIncrement(&pPdoCtx->ControlTransaction.PlainReads);
+		}
+
+		WdfSpinLockRelease(pPdoCtx->ControlTransaction.Lock);
+
+		if (!NT_SUCCESS(status))
+		{
+			break;
+		}
+
+		if (!NT_SUCCESS(status = BthPS3_PDO_RetrieveTransferBuffer(
 			request,
-			0,
+			TRUE,
 			&buffer,
+			&mdl,
 			&length
 		)))
 		{
 			TraceError(
 				TRACE_BUSLOGIC,
-				"WdfRequestRetrieveOutputBuffer failed with status %!STATUS!",
+				"BthPS3_PDO_RetrieveTransferBuffer failed with status %!STATUS!",
 				status
 			);
 
+			L2CAP_PS3_ControlReadDone(pPdoCtx);
 			WdfRequestComplete(request, status);
 			continue;
 		}
@@ -418,6 +858,7 @@ BthPS3_PDO_DispatchHidControlRead(
 			pPdoCtx,
 			request,
 			buffer,
+			mdl,
 			length,
 			L2CAP_PS3_AsyncReadControlTransferCompleted
 		)))
@@ -428,12 +869,13 @@ BthPS3_PDO_DispatchHidControlRead(
 				status
 			);
 
+			L2CAP_PS3_ControlReadDone(pPdoCtx);
 			WdfRequestComplete(request, status);
 			continue;
 		}
 	}
 
-	FuncExitNoReturn(TRACE_BUSLOGIC);
+	HotFuncExitNoReturn(TRACE_BUSLOGIC);
 }
 
 //
@@ -445,26 +887,28 @@ BthPS3_PDO_DispatchHidControlWrite(
 	_In_ WDFCONTEXT Context
 )
 {
-	FuncEntry(TRACE_BUSLOGIC);
+	HotFuncEntry(TRACE_BUSLOGIC);
 
 	const PBTHPS3_PDO_CONTEXT pPdoCtx = Context;
 	NTSTATUS status;
 	WDFREQUEST request = NULL;
 	PVOID buffer = NULL;
+	PMDL mdl = NULL;
 	size_t length = 0;
 
 	while (NT_SUCCESS(WdfIoQueueRetrieveNextRequest(Queue, &request)))
 	{
-		if (!NT_SUCCESS(status = WdfRequestRetrieveInputBuffer(
+		if (!NT_SUCCESS(status = BthPS3_PDO_RetrieveTransferBuffer(
 			request,
-			0,
+			FALSE,
 			&buffer,
+			&mdl,
 			&length
 		)))
 		{
 			TraceError(
 				TRACE_BUSLOGIC,
-				"WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+				"BthPS3_PDO_RetrieveTransferBuffer failed with status %!STATUS!",
 				status
 			);
 
@@ -476,6 +920,7 @@ BthPS3_PDO_DispatchHidControlWrite(
 			pPdoCtx,
 			request,
 			buffer,
+			mdl,
 			length,
 			L2CAP_PS3_AsyncSendControlTransferCompleted
 		)))
@@ -491,7 +936,7 @@ BthPS3_PDO_DispatchHidControlWrite(
 		}
 	}
 
-	FuncExitNoReturn(TRACE_BUSLOGIC);
+	HotFuncExitNoReturn(TRACE_BUSLOGIC);
 }
 
 //
@@ -503,26 +948,29 @@ BthPS3_PDO_DispatchHidInterruptRead(
 	_In_ WDFCONTEXT Context
 )
 {
-	FuncEntry(TRACE_BUSLOGIC);
+	HotFuncEntry(TRACE_BUSLOGIC);
 
 	const PBTHPS3_PDO_CONTEXT pPdoCtx = Context;
 	NTSTATUS status;
 	WDFREQUEST request = NULL;
 	PVOID buffer = NULL;
+	PMDL mdl = NULL;
 	size_t length = 0;
+	WDF_REQUEST_PARAMETERS params;
 
 	while (NT_SUCCESS(WdfIoQueueRetrieveNextRequest(Queue, &request)))
 	{
-		if (!NT_SUCCESS(status = WdfRequestRetrieveOutputBuffer(
+		if (!NT_SUCCESS(status = BthPS3_PDO_RetrieveTransferBuffer(
 			request,
-			0,
+			TRUE,
 			&buffer,
+			&mdl,
 			&length
 		)))
 		{
 			TraceError(
 				TRACE_BUSLOGIC,
-				"WdfRequestRetrieveOutputBuffer failed with status %!STATUS!",
+				"BthPS3_PDO_RetrieveTransferBuffer failed with status %!STATUS!",
 				status
 			);
 
@@ -530,10 +978,54 @@ BthPS3_PDO_DispatchHidInterruptRead(
 			continue;
 		}
 
+		WDF_REQUEST_PARAMETERS_INIT(&params);
+		WdfRequestGetParameters(request, &params);
+
+		if (params.Parameters.DeviceIoControl.IoControlCode == IOCTL_BTHPS3_HID_INTERRUPT_READ_IMU)
+		{
+			if (!NT_SUCCESS(status = L2CAP_PS3_ReadMotionImuTransferAsync(
+				pPdoCtx,
+				request,
+				(PBTHPS3_MOTION_IMU_SAMPLE)buffer
+			)))
+			{
+				TraceError(
+					TRACE_BUSLOGIC,
+					"L2CAP_PS3_ReadMotionImuTransferAsync failed with status %!STATUS!",
+					status
+				);
+
+				WdfRequestComplete(request, status);
+			}
+
+			continue;
+		}
+
+		if (params.Parameters.DeviceIoControl.IoControlCode == IOCTL_BTHPS3_HID_INTERRUPT_READ_STATE)
+		{
+			if (!NT_SUCCESS(status = L2CAP_PS3_ReadControllerStateTransferAsync(
+				pPdoCtx,
+				request,
+				(PBTHPS3_CONTROLLER_STATE)buffer
+			)))
+			{
+				TraceError(
+					TRACE_BUSLOGIC,
+					"L2CAP_PS3_ReadControllerStateTransferAsync failed with status %!STATUS!",
+					status
+				);
+
+				WdfRequestComplete(request, status);
+			}
+
+			continue;
+		}
+
 		if (!NT_SUCCESS(status = L2CAP_PS3_ReadInterruptTransferAsync(
 			pPdoCtx,
 			request,
 			buffer,
+			mdl,
 			length,
 			L2CAP_PS3_AsyncReadInterruptTransferCompleted
 		)))
@@ -549,7 +1041,7 @@ BthPS3_PDO_DispatchHidInterruptRead(
 		}
 	}
 
-	FuncExitNoReturn(TRACE_BUSLOGIC);
+	HotFuncExitNoReturn(TRACE_BUSLOGIC);
 }
 
 //
@@ -561,26 +1053,29 @@ BthPS3_PDO_DispatchHidInterruptWrite(
 	_In_ WDFCONTEXT Context
 )
 {
-	FuncEntry(TRACE_BUSLOGIC);
+	HotFuncEntry(TRACE_BUSLOGIC);
 
 	const PBTHPS3_PDO_CONTEXT pPdoCtx = Context;
 	NTSTATUS status;
 	WDFREQUEST request = NULL;
 	PVOID buffer = NULL;
+	PMDL mdl = NULL;
 	size_t length = 0;
+	WDF_REQUEST_PARAMETERS params;
 
 	while (NT_SUCCESS(WdfIoQueueRetrieveNextRequest(Queue, &request)))
 	{
-		if (!NT_SUCCESS(status = WdfRequestRetrieveInputBuffer(
+		if (!NT_SUCCESS(status = BthPS3_PDO_RetrieveTransferBuffer(
 			request,
-			0,
+			FALSE,
 			&buffer,
+			&mdl,
 			&length
 		)))
 		{
 			TraceError(
 				TRACE_BUSLOGIC,
-				"WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+				"BthPS3_PDO_RetrieveTransferBuffer failed with status %!STATUS!",
 				status
 			);
 
@@ -588,10 +1083,28 @@ BthPS3_PDO_DispatchHidInterruptWrite(
 			continue;
 		}
 
+		WDF_REQUEST_PARAMETERS_INIT(&params);
+		WdfRequestGetParameters(request, &params);
+
+		//
+		// System buffer is ours to patch
+		// 
+		if (params.Parameters.DeviceIoControl.IoControlCode == IOCTL_BTHPS3_HID_INTERRUPT_WRITE_CRC)
+		{
+			if (pPdoCtx->DeviceType != DS_DEVICE_TYPE_WIRELESS)
+			{
+				WdfRequestComplete(request, STATUS_NOT_SUPPORTED);
+				continue;
+			}
+
+			BthPS3_Crc32Seal((PUCHAR)buffer, (ULONG)length);
+		}
+
 		if (!NT_SUCCESS(status = L2CAP_PS3_SendInterruptTransferAsync(
 			pPdoCtx,
 			request,
 			buffer,
+			mdl,
 			length,
 			L2CAP_PS3_AsyncSendInterruptTransferCompleted
 		)))
@@ -607,5 +1120,188 @@ BthPS3_PDO_DispatchHidInterruptWrite(
 		}
 	}
 
-	FuncExitNoReturn(TRACE_BUSLOGIC);
+	HotFuncExitNoReturn(TRACE_BUSLOGIC);
+}
+
+//
+// Handles IOCTL_BTHPS3_MAP_STATE_PAGE, the request stays pending and its
+// locked output buffer receives every input report until it gets canceled
+// or the device disconnects
+// 
+NTSTATUS
+BthPS3_PDO_HandleMapStatePage(
+	_In_ DMFMODULE DmfModule,
+	_In_ WDFQUEUE Queue,
+	_In_ WDFREQUEST Request,
+	_In_ ULONG IoctlCode,
+	_In_reads_(InputBufferSize) VOID* InputBuffer,
+	_In_ size_t InputBufferSize,
+	_Out_writes_(OutputBufferSize) VOID* OutputBuffer,
+	_In_ size_t OutputBufferSize,
+	_Out_ size_t* BytesReturned
+)
+{
+	UNREFERENCED_PARAMETER(Queue);
+	UNREFERENCED_PARAMETER(IoctlCode);
+	UNREFERENCED_PARAMETER(InputBuffer);
+	UNREFERENCED_PARAMETER(InputBufferSize);
+	UNREFERENCED_PARAMETER(OutputBufferSize);
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	NTSTATUS status;
+	const WDFDEVICE device = DMF_ParentDeviceGet(DmfModule);
+	const PBTHPS3_PDO_CONTEXT pPdoCtx = GetPdoContext(device);
+
+	*BytesReturned = 0;
+
+	WdfSpinLockAcquire(pPdoCtx->StatePage.Lock);
+
+	do
+	{
+		//
+		// One page per device, readers can share it
+		// 
+		if (pPdoCtx->StatePage.Request != NULL)
+		{
+			status = STATUS_DEVICE_BUSY;
+			break;
+		}
+
+		if (!NT_SUCCESS(status = WdfRequestMarkCancelableEx(
+			Request,
+			BthPS3_PDO_EvtStatePageCanceled
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRequestMarkCancelableEx failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		BthPS3_StatePageInit((PBTHPS3_STATE_PAGE)OutputBuffer);
+
+		pPdoCtx->StatePage.Request = Request;
+		pPdoCtx->StatePage.Page = (PBTHPS3_STATE_PAGE)OutputBuffer;
+
+		status = STATUS_PENDING;
+
+	} while (FALSE);
+
+	WdfSpinLockRelease(pPdoCtx->StatePage.Lock);
+
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+
+//
+// Runs the next control transaction, the sequential queue holds back
+// further ones until this request got completed
+// 
+VOID
+BthPS3_PDO_EvtHidControlTransaction(
+	_In_ WDFQUEUE Queue,
+	_In_ WDFREQUEST Request,
+	_In_ size_t OutputBufferLength,
+	_In_ size_t InputBufferLength,
+	_In_ ULONG IoControlCode
+)
+{
+	UNREFERENCED_PARAMETER(InputBufferLength);
+	UNREFERENCED_PARAMETER(IoControlCode);
+
+	HotFuncEntry(TRACE_BUSLOGIC);
+
+	NTSTATUS status;
+	const PBTHPS3_PDO_CONTEXT pPdoCtx = GetPdoContext(WdfIoQueueGetDevice(Queue));
+	PVOID report = NULL;
+	size_t reportLength = 0;
+	PMDL responseMdl = NULL;
+	ULONG responseLength = 0;
+	BOOLEAN isConnected;
+
+	do
+	{
+		WdfSpinLockAcquire(pPdoCtx->HidControlChannel.ConnectionStateLock);
+		isConnected = pPdoCtx->HidControlChannel.ConnectionState == ConnectionStateConnected;
+		WdfSpinLockRelease(pPdoCtx->HidControlChannel.ConnectionStateLock);
+
+		if (!isConnected)
+		{
+			status = STATUS_DEVICE_NOT_CONNECTED;
+			break;
+		}
+
+		if (!NT_SUCCESS(status = WdfRequestRetrieveInputBuffer(
+			Request,
+			1,
+			&report,
+			&reportLength
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		if (!NT_SUCCESS(status = WdfRequestRetrieveOutputWdmMdl(
+			Request,
+			&responseMdl
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRequestRetrieveOutputWdmMdl failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		//
+		// Static feature reports read before don't need a round trip
+		// 
+		if (BthPS3_PDO_LookupFeatureReport(
+			pPdoCtx,
+			report,
+			(ULONG)reportLength,
+			responseMdl,
+			(ULONG)OutputBufferLength,
+			&responseLength
+		))
+		{
+			WdfRequestCompleteWithInformation(Request, STATUS_SUCCESS, responseLength);
+			break;
+		}
+
+		if (!NT_SUCCESS(status = L2CAP_PS3_ControlTransactionAsync(
+			pPdoCtx,
+			Request,
+			report,
+			reportLength,
+			responseMdl,
+			OutputBufferLength
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"L2CAP_PS3_ControlTransactionAsync failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+	} while (FALSE);
+
+	if (!NT_SUCCESS(status))
+	{
+		WdfRequestComplete(Request, status);
+	}
+
+	HotFuncExitNoReturn(TRACE_BUSLOGIC);
 }
@@ -0,0 +1,70 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include "Driver.h"
+
+
+//
+// IOCTLs handled by each PDO, shared with the user-mode simulator
+// 
+IoctlHandler_IoctlRecord G_PDO_IoctlSpecification[] =
+{
+	/* HID channels traffic */
+	{IOCTL_BTHPS3_HID_CONTROL_READ, 0, 1, BthPS3_PDO_HandleHidControlRead},
+	{IOCTL_BTHPS3_HID_CONTROL_WRITE, 1, 0, BthPS3_PDO_HandleHidControlWrite},
+	{IOCTL_BTHPS3_HID_INTERRUPT_READ, 0, 1, BthPS3_PDO_HandleHidInterruptRead},
+	{IOCTL_BTHPS3_HID_INTERRUPT_WRITE, 1, 0, BthPS3_PDO_HandleHidInterruptWrite},
+	/* Same as above, data buffer is always the (direct) output buffer */
+	{IOCTL_BTHPS3_HID_CONTROL_READ_DIRECT, 0, 1, BthPS3_PDO_HandleHidControlRead},
+	{IOCTL_BTHPS3_HID_CONTROL_WRITE_DIRECT, 0, 1, BthPS3_PDO_HandleHidControlWrite},
+	{IOCTL_BTHPS3_HID_INTERRUPT_READ_DIRECT, 0, 1, BthPS3_PDO_HandleHidInterruptRead},
+	{IOCTL_BTHPS3_HID_INTERRUPT_WRITE_DIRECT, 0, 1, BthPS3_PDO_HandleHidInterruptWrite},
+	{IOCTL_BTHPS3_GET_CAPABILITIES, 0, sizeof(BTHPS3_GET_CAPABILITIES), BthPS3_PDO_HandleGetCapabilities},
+	{IOCTL_BTHPS3_SET_FEEDBACK, sizeof(BTHPS3_SET_FEEDBACK), 0, BthPS3_PDO_HandleSetFeedback},
+	{IOCTL_BTHPS3_HID_INTERRUPT_READ_IMU, 0, 2 * sizeof(BTHPS3_MOTION_IMU_SAMPLE), BthPS3_PDO_HandleHidInterruptRead},
+	{IOCTL_BTHPS3_HID_INTERRUPT_WRITE_CRC, BTHPS3_CRC32_SIZE + 1, 0, BthPS3_PDO_HandleHidInterruptWrite},
+	{IOCTL_BTHPS3_HID_INTERRUPT_READ_STATE, 0, sizeof(BTHPS3_CONTROLLER_STATE), BthPS3_PDO_HandleHidInterruptRead},
+	{IOCTL_BTHPS3_MAP_STATE_PAGE, 0, sizeof(BTHPS3_STATE_PAGE), BthPS3_PDO_HandleMapStatePage},
+	{IOCTL_BTHPS3_HID_CONTROL_TRANSACT, 1, 1, BthPS3_PDO_HandleHidControlTransact},
+	/* Disconnect instruction (e.g. from DsHidMini) */
+	{IOCTL_BTH_DISCONNECT_DEVICE, sizeof(BTH_ADDR), 0, BthPS3_PDO_HandleBthDisconnect},
+	/* Diagnostics */
+	{IOCTL_BTHPS3_GET_FLIGHT_RECORDER, 0, sizeof(BTHPS3_GET_FLIGHT_RECORDER), BthPS3_PDO_HandleGetFlightRecorder},
+	{IOCTL_BTHPS3_GET_RADIO_LOAD, 0, sizeof(BTHPS3_GET_RADIO_LOAD), BthPS3_PDO_HandleGetRadioLoad},
+};
+
+const ULONG G_PDO_IoctlSpecificationCount = ARRAYSIZE(G_PDO_IoctlSpecification);
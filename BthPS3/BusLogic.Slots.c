@@ -2,36 +2,827 @@
 #include "BusLogic.Slots.tmh"
 
 
+//
+// Replaces the slot storage with a larger one, existing slots are kept
+// 
+#pragma code_seg("PAGE")
+_IRQL_requires_max_(PASSIVE_LEVEL)
+static NTSTATUS
+BthPS3_PDO_GrowSlots(
+	PBTHPS3_DEVICE_CONTEXT_HEADER Header,
+	ULONG Capacity
+)
+{
+	NTSTATUS status;
+	WDF_OBJECT_ATTRIBUTES attributes;
+	WDFMEMORY memory;
+	PVOID buffer;
+	const size_t size = Capacity / 8;
+
+	PAGED_CODE();
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Header->Device;
+
+	//
+	// Only ever touched at PASSIVE_LEVEL under SlotsLock
+	// 
+	if (!NT_SUCCESS(status = WdfMemoryCreate(
+		&attributes,
+		PagedPool,
+		POOLTAG_BTHPS3,
+		size,
+		&memory,
+		&buffer
+	)))
+	{
+		TraceError(
+			TRACE_BUSLOGIC,
+			"WdfMemoryCreate failed with status %!STATUS!",
+			status
+		);
+		return status;
+	}
+
+	RtlZeroMemory(buffer, size);
+
+	if (Header->SlotsMemory)
+	{
+		RtlCopyMemory(buffer, Header->Slots.Words, Header->Slots.Capacity / 8);
+		WdfObjectDelete(Header->SlotsMemory);
+	}
+
+	Header->SlotsMemory = memory;
+	Header->Slots.Words = buffer;
+	Header->Slots.Capacity = Capacity;
+
+	BthPS3_SlotMapRebuildSummary(&Header->Slots);
+
+	TraceVerbose(
+		TRACE_BUSLOGIC,
+		"Slot capacity grown to %d",
+		Capacity
+	);
+
+	return status;
+}
+#pragma code_seg()
+
+//
+// Checks if a slot belongs to a currently present PDO
+// 
+#pragma code_seg("PAGE")
+_IRQL_requires_max_(PASSIVE_LEVEL)
+static BOOLEAN
+BthPS3_PDO_IsSlotPresent(
+	PBTHPS3_DEVICE_CONTEXT_HEADER Header,
+	ULONG Slot
+)
+{
+	BOOLEAN isPresent = FALSE;
+
+	PAGED_CODE();
+
+	WdfWaitLockAcquire(Header->ClientsLock, NULL);
+
+	const ULONG itemCount = WdfCollectionGetCount(Header->Clients);
+
+	for (ULONG index = 0; index < itemCount; index++)
+	{
+		const WDFDEVICE currentPdo = WdfCollectionGetItem(Header->Clients, index);
+
+		if (GetPdoContext(currentPdo)->SerialNumber == Slot)
+		{
+			isPresent = TRUE;
+			break;
+		}
+	}
+
+	WdfWaitLockRelease(Header->ClientsLock);
+
+	return isPresent;
+}
+#pragma code_seg()
+
+//
+// Takes the slot of the least recently connected cached device that isn't
+// present and forgets that device. Walks all cached devices, so it's only
+// used once the slot space is exhausted. Called with SlotsLock held.
+// 
+#pragma code_seg("PAGE")
+_IRQL_requires_max_(PASSIVE_LEVEL)
+static NTSTATUS
+BthPS3_PDO_ReclaimSlot(
+	PBTHPS3_DEVICE_CONTEXT_HEADER Header,
+	PULONG Slot
+)
+{
+	NTSTATUS status;
+	WDFKEY hKey = NULL;
+	WDFKEY hDevicesKey = NULL;
+	WDFKEY hDeviceKey = NULL;
+	ULONG resultLength;
+	BTHPS3_SLOT_RECLAIM reclaim;
+	WCHAR oldestName[BTHPS3_BTH_ADDR_MAX_CHARS] = { 0 };
+	UCHAR buffer[sizeof(KEY_BASIC_INFORMATION) + BTHPS3_BTH_ADDR_MAX_CHARS * sizeof(WCHAR)];
+	const PKEY_BASIC_INFORMATION pInfo = (PKEY_BASIC_INFORMATION)buffer;
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	PAGED_CODE();
+
+	DECLARE_CONST_UNICODE_STRING(devicesKeyName, L"Devices");
+	DECLARE_CONST_UNICODE_STRING(slotNo, BTHPS3_REG_VALUE_SLOT_NO);
+	DECLARE_CONST_UNICODE_STRING(lastConnectedTime, BTHPS3_REG_VALUE_LAST_CONNECTED_TIME);
+
+	BthPS3_SlotReclaimInit(&reclaim, Header->Slots.Capacity);
+
+	do
+	{
+		if (!NT_SUCCESS(status = WdfDriverOpenParametersRegistryKey(
+			WdfGetDriver(),
+			STANDARD_RIGHTS_ALL,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hKey
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfDriverOpenParametersRegistryKey failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		if (!NT_SUCCESS(status = WdfRegistryOpenKey(
+			hKey,
+			&devicesKeyName,
+			KEY_READ,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hDevicesKey
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRegistryOpenKey failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		for (ULONG index = 0; ; index++)
+		{
+			UNICODE_STRING name;
+			ULONG slot = 0;
+			ULONG64 time = 0;
+
+			status = ZwEnumerateKey(
+				WdfRegistryWdmGetHandle(hDevicesKey),
+				index,
+				KeyBasicInformation,
+				pInfo,
+				sizeof(buffer),
+				&resultLength
+			);
+
+			if (status == STATUS_NO_MORE_ENTRIES)
+			{
+				status = STATUS_SUCCESS;
+				break;
+			}
+
+			//
+			// Not one of ours if the name doesn't fit an address
+			// 
+			if (status == STATUS_BUFFER_OVERFLOW || status == STATUS_BUFFER_TOO_SMALL)
+			{
+				continue;
+			}
+
+			if (!NT_SUCCESS(status))
+			{
+				TraceError(
+					TRACE_BUSLOGIC,
+					"ZwEnumerateKey failed with status %!STATUS!",
+					status
+				);
+				break;
+			}
+
+			if (pInfo->NameLength != BTH_ADDR_HEX_LEN * sizeof(WCHAR))
+			{
+				continue;
+			}
+
+			name.Buffer = pInfo->Name;
+			name.Length = name.MaximumLength = (USHORT)pInfo->NameLength;
+
+			if (!NT_SUCCESS(WdfRegistryOpenKey(
+				hDevicesKey,
+				&name,
+				KEY_READ,
+				WDF_NO_OBJECT_ATTRIBUTES,
+				&hDeviceKey
+			)))
+			{
+				continue;
+			}
+
+			//
+			// Entries cached before the time got recorded count as oldest
+			// 
+			(void)WdfRegistryQueryValue(
+				hDeviceKey,
+				&lastConnectedTime,
+				sizeof(time),
+				&time,
+				NULL,
+				NULL
+			);
+
+			if (NT_SUCCESS(WdfRegistryQueryULong(hDeviceKey, &slotNo, &slot))
+				&& BthPS3_SlotReclaimIsOlder(&reclaim, slot, time)
+				&& !BthPS3_PDO_IsSlotPresent(Header, slot))
+			{
+				BthPS3_SlotReclaimTake(&reclaim, slot, time);
+				RtlCopyMemory(oldestName, pInfo->Name, pInfo->NameLength);
+			}
+
+			WdfRegistryClose(hDeviceKey);
+			hDeviceKey = NULL;
+		}
+
+		if (!NT_SUCCESS(status))
+		{
+			break;
+		}
+
+		if (reclaim.OldestSlot == 0)
+		{
+			status = STATUS_NO_MORE_ENTRIES;
+			break;
+		}
+
+		UNICODE_STRING oldestKeyName;
+		RtlInitUnicodeString(&oldestKeyName, oldestName);
+
+		if (!NT_SUCCESS(status = WdfRegistryOpenKey(
+			hDevicesKey,
+			&oldestKeyName,
+			KEY_ALL_ACCESS,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hDeviceKey
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRegistryOpenKey failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		//
+		// Closes the handle on success
+		// 
+		if (!NT_SUCCESS(status = WdfRegistryRemoveKey(hDeviceKey)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRegistryRemoveKey failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		hDeviceKey = NULL;
+
+		TraceInformation(
+			TRACE_BUSLOGIC,
+			"Reclaimed slot %d of device %ws",
+			reclaim.OldestSlot,
+			oldestName
+		);
+
+		*Slot = reclaim.OldestSlot;
+
+	} while (FALSE);
+
+	if (hDeviceKey)
+	{
+		WdfRegistryClose(hDeviceKey);
+	}
+
+	if (hDevicesKey)
+	{
+		WdfRegistryClose(hDevicesKey);
+	}
+
+	if (hKey)
+	{
+		WdfRegistryClose(hKey);
+	}
+
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+#pragma code_seg()
+
+//
+// Allocates the slot storage and restores the persisted occupied slots
+// 
+#pragma code_seg("PAGE")
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_PDO_InitializeSlots(
+	PBTHPS3_DEVICE_CONTEXT_HEADER Header
+)
+{
+	NTSTATUS status;
+	WDFKEY hKey = NULL;
+	WDFMEMORY memory = NULL;
+	PVOID buffer = NULL;
+	size_t length = 0;
+	ULONG type = REG_NONE;
+	ULONG capacity = BTHPS3_SLOTS_INITIAL_CAPACITY;
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	PAGED_CODE();
+
+	DECLARE_CONST_UNICODE_STRING(slots, BTHPS3_REG_VALUE_SLOTS);
+
+	do
+	{
+		//
+		// Open
+		//   HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Services\BthPS3\Parameters
+		// key
+		// 
+		if (NT_SUCCESS(WdfDriverOpenParametersRegistryKey(
+			WdfGetDriver(),
+			STANDARD_RIGHTS_READ,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hKey
+		)))
+		{
+			//
+			// Read in full, the persisted bitmap may outgrow what we can track
+			// 
+			if (NT_SUCCESS(WdfRegistryQueryMemory(
+				hKey,
+				&slots,
+				PagedPool,
+				WDF_NO_OBJECT_ATTRIBUTES,
+				&memory,
+				&type
+			)))
+			{
+				buffer = WdfMemoryGetBuffer(memory, &length);
+			}
+
+			if (type != REG_BINARY)
+			{
+				length = 0;
+			}
+		}
+
+		while (capacity < BTHPS3_SLOT_MAP_MAX_SLOTS && capacity < length * 8)
+		{
+			capacity *= 2;
+		}
+
+		if (!NT_SUCCESS(status = BthPS3_PDO_GrowSlots(Header, capacity)))
+		{
+			break;
+		}
+
+		//
+		// Restore persisted slots, if any
+		// 
+		if (length > 0)
+		{
+			RtlCopyMemory(
+				Header->Slots.Words,
+				buffer,
+				min(length, capacity / 8)
+			);
+		}
+
+		//
+		// Zero is never a valid serial, keep it from being handed out
+		// 
+		BthPS3_SlotBitmapSet(Header->Slots.Words, 0);
+
+		BthPS3_SlotMapRebuildSummary(&Header->Slots);
+
+	} while (FALSE);
+
+	if (memory)
+	{
+		WdfObjectDelete(memory);
+	}
+
+	if (hKey)
+	{
+		WdfRegistryClose(hKey);
+	}
+
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+#pragma code_seg()
+
+
 //
 // Gets a stored slot/serial/index number for a given remote address or selects a free one
 // 
 #pragma code_seg("PAGE")
 _IRQL_requires_max_(PASSIVE_LEVEL)
 NTSTATUS
-BthPS3_PDO_QuerySlot(
-	PBTHPS3_DEVICE_CONTEXT_HEADER Header,
-	BTH_ADDR RemoteAddress,
-	PULONG Slot
+BthPS3_PDO_QuerySlot(
+	PBTHPS3_DEVICE_CONTEXT_HEADER Header,
+	BTH_ADDR RemoteAddress,
+	PULONG Slot
+)
+{
+	NTSTATUS status;
+	WDFKEY hKey = NULL;
+	WDFKEY hDeviceKey = NULL;
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	PAGED_CODE();
+
+	DECLARE_UNICODE_STRING_SIZE(deviceKeyName, REG_CACHED_DEVICE_KEY_FMT_LEN);
+	DECLARE_CONST_UNICODE_STRING(slotNo, BTHPS3_REG_VALUE_SLOT_NO);
+
+	do
+	{
+		//
+		// Open
+		//   HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Services\BthPS3\Parameters
+		// key
+		// 
+		if (!NT_SUCCESS(status = WdfDriverOpenParametersRegistryKey(
+			WdfGetDriver(),
+			STANDARD_RIGHTS_READ,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hKey
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfDriverOpenParametersRegistryKey failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		if (!NT_SUCCESS(status = RtlUnicodeStringPrintf(
+			&deviceKeyName,
+			REG_CACHED_DEVICE_KEY_FMT,
+			RemoteAddress
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"RtlUnicodeStringPrintf failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		//
+		// Try to get cached value
+		// 
+		if (NT_SUCCESS(WdfRegistryOpenKey(
+			hKey,
+			&deviceKeyName,
+			GENERIC_READ,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hDeviceKey
+		))
+			&& NT_SUCCESS(status = WdfRegistryQueryULong(
+				hDeviceKey,
+				&slotNo,
+				Slot
+			)))
+		{
+			TraceVerbose(
+				TRACE_BUSLOGIC,
+				"Found cached serial"
+			);
+
+			//
+			// Validate
+			// 
+			if (*Slot == 0 /* invalid value */ || *Slot > BTHPS3_MAX_NUM_DEVICES)
+			{
+				status = STATUS_INVALID_PARAMETER;
+				break;
+			}
+
+			WdfWaitLockAcquire(Header->SlotsLock, NULL);
+
+			//
+			// Persisted bitmap may lag behind the cached assignments
+			// 
+			ULONG capacity = Header->Slots.Capacity;
+
+			while (capacity <= *Slot)
+			{
+				capacity *= 2;
+			}
+
+			if (capacity == Header->Slots.Capacity
+				|| NT_SUCCESS(status = BthPS3_PDO_GrowSlots(Header, capacity)))
+			{
+				BthPS3_SlotMapSet(&Header->Slots, *Slot);
+
+				status = STATUS_SUCCESS;
+			}
+
+			WdfWaitLockRelease(Header->SlotsLock);
+		}
+		//
+		// Get next free one
+		// 
+		else
+		{
+			TraceVerbose(
+				TRACE_BUSLOGIC,
+				"Looking for free serial"
+			);
+
+			WdfWaitLockAcquire(Header->SlotsLock, NULL);
+
+			//
+			// ...otherwise get next free serial number
+			// 
+			*Slot = BthPS3_SlotMapFindClear(&Header->Slots);
+			status = STATUS_SUCCESS;
+
+			//
+			// Grow while possible, then take over the slot of the least recently seen device
+			// 
+			if (*Slot == Header->Slots.Capacity)
+			{
+				if (Header->Slots.Capacity < BTHPS3_SLOT_MAP_MAX_SLOTS)
+				{
+					if (NT_SUCCESS(status = BthPS3_PDO_GrowSlots(Header, Header->Slots.Capacity * 2)))
+					{
+						*Slot = BthPS3_SlotMapFindClear(&Header->Slots);
+					}
+				}
+				else
+				{
+					status = BthPS3_PDO_ReclaimSlot(Header, Slot);
+				}
+			}
+
+			if (NT_SUCCESS(status))
+			{
+				TraceVerbose(
+					TRACE_BUSLOGIC,
+					"Assigned serial: %d",
+					*Slot
+				);
+
+				BthPS3_SlotMapSet(&Header->Slots, *Slot);
+			}
+
+			WdfWaitLockRelease(Header->SlotsLock);
+		}
+
+	} while (FALSE);
+
+	if (hKey)
+	{
+		WdfRegistryClose(hKey);
+	}
+
+	if (hDeviceKey)
+	{
+		WdfRegistryClose(hDeviceKey);
+	}
+
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+#pragma code_seg()
+
+//
+// Caches an occupied slot in the registry
+// 
+#pragma code_seg("PAGE")
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_PDO_AssignSlot(
+	PBTHPS3_DEVICE_CONTEXT_HEADER Header,
+	BTH_ADDR RemoteAddress,
+	ULONG Slot
+)
+{
+	NTSTATUS status;
+	WDFKEY hKey = NULL;
+	WDFKEY hDeviceKey = NULL;
+	LARGE_INTEGER now;
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	PAGED_CODE();
+
+	DECLARE_UNICODE_STRING_SIZE(deviceKeyName, REG_CACHED_DEVICE_KEY_FMT_LEN);
+	DECLARE_CONST_UNICODE_STRING(slotNo, BTHPS3_REG_VALUE_SLOT_NO);
+	DECLARE_CONST_UNICODE_STRING(slots, BTHPS3_REG_VALUE_SLOTS);
+	DECLARE_CONST_UNICODE_STRING(lastConnectedTime, BTHPS3_REG_VALUE_LAST_CONNECTED_TIME);
+
+	do
+	{
+		if (Slot == 0 /* invalid value */ || Slot > BTHPS3_MAX_NUM_DEVICES)
+		{
+			status = STATUS_INVALID_PARAMETER;
+			break;
+		}
+
+		//
+		// Open
+		//   HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Services\BthPS3\Parameters
+		// key
+		// 
+		if (!NT_SUCCESS(status = WdfDriverOpenParametersRegistryKey(
+			WdfGetDriver(),
+			STANDARD_RIGHTS_ALL,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hKey
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfDriverOpenParametersRegistryKey failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		if (!NT_SUCCESS(status = RtlUnicodeStringPrintf(
+			&deviceKeyName,
+			REG_CACHED_DEVICE_KEY_FMT,
+			RemoteAddress
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"RtlUnicodeStringPrintf failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		//
+		// Create key for device
+		// 
+		if (!NT_SUCCESS(status = WdfRegistryCreateKey(
+			hKey,
+			&deviceKeyName,
+			GENERIC_WRITE,
+			REG_OPTION_NON_VOLATILE,
+			NULL,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hDeviceKey
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRegistryCreateKey failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		//
+		// Store serial value
+		// 
+		if (!NT_SUCCESS(status = WdfRegistryAssignULong(
+			hDeviceKey,
+			&slotNo,
+			Slot
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRegistryAssignULong failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		//
+		// Used to pick a slot to reclaim once all are taken
+		// 
+		KeQuerySystemTimePrecise(&now);
+
+		if (!NT_SUCCESS(status = WdfRegistryAssignValue(
+			hDeviceKey,
+			&lastConnectedTime,
+			REG_QWORD,
+			sizeof(now),
+			&now
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRegistryAssignValue failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		WdfWaitLockAcquire(Header->SlotsLock, NULL);
+
+		if (Slot >= Header->Slots.Capacity)
+		{
+			WdfWaitLockRelease(Header->SlotsLock);
+			status = STATUS_INVALID_PARAMETER;
+			break;
+		}
+
+		BthPS3_SlotMapSet(&Header->Slots, Slot);
+
+		//
+		// Store occupied slots in registry
+		// 
+		status = WdfRegistryAssignValue(
+			hKey,
+			&slots,
+			REG_BINARY,
+			Header->Slots.Capacity / 8,
+			Header->Slots.Words
+		);
+
+		WdfWaitLockRelease(Header->SlotsLock);
+
+		if (!NT_SUCCESS(status))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfRegistryAssignValue failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+	} while (FALSE);
+
+	if (hKey)
+	{
+		WdfRegistryClose(hKey);
+	}
+
+	if (hDeviceKey)
+	{
+		WdfRegistryClose(hDeviceKey);
+	}
+
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+
+	return status;
+}
+#pragma code_seg()
+
+//
+// Collects the remote addresses of all devices with a cached slot
+// 
+#pragma code_seg("PAGE")
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_PDO_QueryCachedAddresses(
+	PBTH_ADDR Addresses,
+	ULONG MaxCount,
+	PULONG Count
 )
 {
 	NTSTATUS status;
 	WDFKEY hKey = NULL;
-	WDFKEY hDeviceKey = NULL;
+	WDFKEY hDevicesKey = NULL;
+	ULONG resultLength;
+	UCHAR buffer[sizeof(KEY_BASIC_INFORMATION) + BTHPS3_BTH_ADDR_MAX_CHARS * sizeof(WCHAR)];
+	const PKEY_BASIC_INFORMATION pInfo = (PKEY_BASIC_INFORMATION)buffer;
 
 	FuncEntry(TRACE_BUSLOGIC);
 
 	PAGED_CODE();
 
-	DECLARE_UNICODE_STRING_SIZE(deviceKeyName, REG_CACHED_DEVICE_KEY_FMT_LEN);
-	DECLARE_CONST_UNICODE_STRING(slotNo, BTHPS3_REG_VALUE_SLOT_NO);
+	DECLARE_CONST_UNICODE_STRING(devicesKeyName, L"Devices");
+
+	*Count = 0;
 
 	do
 	{
-		//
-		// Open
-		//   HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Services\BthPS3\Parameters
-		// key
-		// 
 		if (!NT_SUCCESS(status = WdfDriverOpenParametersRegistryKey(
 			WdfGetDriver(),
 			STANDARD_RIGHTS_READ,
@@ -47,156 +838,177 @@ BthPS3_PDO_QuerySlot(
 			break;
 		}
 
-		if (!NT_SUCCESS(status = RtlUnicodeStringPrintf(
-			&deviceKeyName,
-			REG_CACHED_DEVICE_KEY_FMT,
-			RemoteAddress
-		)))
-		{
-			TraceError(
-				TRACE_BUSLOGIC,
-				"RtlUnicodeStringPrintf failed with status %!STATUS!",
-				status
-			);
-			break;
-		}
-
 		//
-		// Try to get cached value
+		// Nothing cached yet
 		// 
-		if (NT_SUCCESS(WdfRegistryOpenKey(
+		if (!NT_SUCCESS(status = WdfRegistryOpenKey(
 			hKey,
-			&deviceKeyName,
-			GENERIC_READ,
+			&devicesKeyName,
+			KEY_READ,
 			WDF_NO_OBJECT_ATTRIBUTES,
-			&hDeviceKey
-		))
-			&& NT_SUCCESS(status = WdfRegistryQueryULong(
-				hDeviceKey,
-				&slotNo,
-				Slot
-			)))
+			&hDevicesKey
+		)))
 		{
-			TraceVerbose(
-				TRACE_BUSLOGIC,
-				"Found cached serial"
-			);
-
-			//
-			// Validate
-			// 
-			if (*Slot == 0 /* invalid value */ || *Slot > BTHPS3_MAX_NUM_DEVICES)
+			if (status == STATUS_OBJECT_NAME_NOT_FOUND)
 			{
-				status = STATUS_INVALID_PARAMETER;
-				break;
+				status = STATUS_SUCCESS;
 			}
-
-			WdfWaitLockAcquire(Header->SlotsLock, NULL);
-
-			SetBit(Header->Slots, *Slot);
-
-			WdfWaitLockRelease(Header->SlotsLock);
-
-			status = STATUS_SUCCESS;
+			break;
 		}
-		//
-		// Get next free one
-		// 
-		else
+
+		for (ULONG index = 0; *Count < MaxCount; index++)
 		{
-			TraceVerbose(
-				TRACE_BUSLOGIC,
-				"Looking for free serial"
+			BTH_ADDR address = 0;
+			ULONG digits;
+
+			status = ZwEnumerateKey(
+				WdfRegistryWdmGetHandle(hDevicesKey),
+				index,
+				KeyBasicInformation,
+				pInfo,
+				sizeof(buffer),
+				&resultLength
 			);
 
-			WdfWaitLockAcquire(Header->SlotsLock, NULL);
+			if (status == STATUS_NO_MORE_ENTRIES)
+			{
+				status = STATUS_SUCCESS;
+				break;
+			}
 
 			//
-			// ...otherwise get next free serial number
+			// Not one of ours if the name doesn't fit an address
 			// 
-			for (*Slot = 1; *Slot <= BTHPS3_MAX_NUM_DEVICES; (*Slot)++)
+			if (status == STATUS_BUFFER_OVERFLOW || status == STATUS_BUFFER_TOO_SMALL)
 			{
-				if (!TestBit(Header->Slots, *Slot))
-				{
-					TraceVerbose(
-						TRACE_BUSLOGIC,
-						"Assigned serial: %d",
-						*Slot
-					);
+				continue;
+			}
+
+			if (!NT_SUCCESS(status))
+			{
+				TraceError(
+					TRACE_BUSLOGIC,
+					"ZwEnumerateKey failed with status %!STATUS!",
+					status
+				);
+				break;
+			}
+
+			if (pInfo->NameLength != BTH_ADDR_HEX_LEN * sizeof(WCHAR))
+			{
+				continue;
+			}
 
-					SetBit(Header->Slots, *Slot);
+			for (digits = 0; digits < BTH_ADDR_HEX_LEN; digits++)
+			{
+				const WCHAR c = pInfo->Name[digits];
 
-					status = STATUS_SUCCESS;
+				if (c >= L'0' && c <= L'9')
+				{
+					address = (address << 4) | (BTH_ADDR)(c - L'0');
+				}
+				else if (c >= L'A' && c <= L'F')
+				{
+					address = (address << 4) | (BTH_ADDR)(c - L'A' + 10);
+				}
+				else if (c >= L'a' && c <= L'f')
+				{
+					address = (address << 4) | (BTH_ADDR)(c - L'a' + 10);
+				}
+				else
+				{
 					break;
 				}
 			}
 
-			if (*Slot > BTHPS3_MAX_NUM_DEVICES)
+			if (digits == BTH_ADDR_HEX_LEN)
 			{
-				status = STATUS_NO_MORE_ENTRIES;
+				Addresses[(*Count)++] = address;
 			}
-
-			WdfWaitLockRelease(Header->SlotsLock);
 		}
 
 	} while (FALSE);
 
-	if (hKey)
+	if (hDevicesKey)
 	{
-		WdfRegistryClose(hKey);
+		WdfRegistryClose(hDevicesKey);
 	}
 
-	if (hDeviceKey)
+	if (hKey)
 	{
-		WdfRegistryClose(hDeviceKey);
+		WdfRegistryClose(hKey);
 	}
 
-	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!, count=%d", status, *Count);
 
 	return status;
 }
 #pragma code_seg()
 
 //
-// Caches an occupied slot in the registry
+// Takes the next dirty cached feature report of the remote, the cache
+// lock raises IRQL so this stays out of the paged section
+// 
+static
+BOOLEAN
+BthPS3_PDO_TakeDirtyFeatureReport(
+	_In_ PBTHPS3_SERVER_CONTEXT ServerContext,
+	_In_ BTH_ADDR RemoteAddress,
+	_Inout_ PULONG Cursor,
+	_Out_ PBTHPS3_FEATURE_CACHE_ENTRY Entry
+)
+{
+	BOOLEAN found;
+
+	WdfSpinLockAcquire(ServerContext->FeatureReports.Lock);
+
+	found = BthPS3_FeatureCacheTakeDirty(
+		&ServerContext->FeatureReports.Cache,
+		RemoteAddress,
+		Cursor,
+		Entry
+	);
+
+	WdfSpinLockRelease(ServerContext->FeatureReports.Lock);
+
+	return found;
+}
+
+//
+// Restores allow-listed feature reports persisted for the remote, if enabled
 // 
 #pragma code_seg("PAGE")
 _IRQL_requires_max_(PASSIVE_LEVEL)
-NTSTATUS
-BthPS3_PDO_AssignSlot(
-	PBTHPS3_DEVICE_CONTEXT_HEADER Header,
-	BTH_ADDR RemoteAddress,
-	ULONG Slot
+VOID
+BthPS3_PDO_LoadFeatureReports(
+	PBTHPS3_PDO_CONTEXT PdoContext
 )
 {
-	NTSTATUS status;
+	NTSTATUS status = STATUS_SUCCESS;
 	WDFKEY hKey = NULL;
 	WDFKEY hDeviceKey = NULL;
+	const PBTHPS3_SERVER_CONTEXT pSrvCtx = GetServerDeviceContext(PdoContext->DevCtxHdr->Device);
+	UCHAR report[BTHPS3_FEATURE_CACHE_MAX_REPORT_SIZE];
+	ULONG reportLength;
+	ULONG valueType;
 
 	FuncEntry(TRACE_BUSLOGIC);
 
 	PAGED_CODE();
 
 	DECLARE_UNICODE_STRING_SIZE(deviceKeyName, REG_CACHED_DEVICE_KEY_FMT_LEN);
-	DECLARE_CONST_UNICODE_STRING(slotNo, BTHPS3_REG_VALUE_SLOT_NO);
-	DECLARE_CONST_UNICODE_STRING(slots, BTHPS3_REG_VALUE_SLOTS);
+	DECLARE_UNICODE_STRING_SIZE(valueName, REG_CACHED_FEATURE_REPORT_FMT_LEN);
 
 	do
 	{
-		if (Slot == 0 /* invalid value */ || Slot > BTHPS3_MAX_NUM_DEVICES)
+		if (!pSrvCtx->Settings.FeatureReportCachePersist)
 		{
-			status = STATUS_INVALID_PARAMETER;
 			break;
 		}
 
-		//
-		// Open
-		//   HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Services\BthPS3\Parameters
-		// key
-		// 
 		if (!NT_SUCCESS(status = WdfDriverOpenParametersRegistryKey(
 			WdfGetDriver(),
-			STANDARD_RIGHTS_ALL,
+			STANDARD_RIGHTS_READ,
 			WDF_NO_OBJECT_ATTRIBUTES,
 			&hKey
 		)))
@@ -212,7 +1024,7 @@ BthPS3_PDO_AssignSlot(
 		if (!NT_SUCCESS(status = RtlUnicodeStringPrintf(
 			&deviceKeyName,
 			REG_CACHED_DEVICE_KEY_FMT,
-			RemoteAddress
+			PdoContext->RemoteAddress
 		)))
 		{
 			TraceError(
@@ -224,82 +1036,193 @@ BthPS3_PDO_AssignSlot(
 		}
 
 		//
-		// Create key for device
+		// Nothing persisted for devices seen for the first time
 		// 
-		if (!NT_SUCCESS(status = WdfRegistryCreateKey(
+		if (!NT_SUCCESS(status = WdfRegistryOpenKey(
 			hKey,
 			&deviceKeyName,
-			GENERIC_WRITE,
-			REG_OPTION_NON_VOLATILE,
-			NULL,
+			GENERIC_READ,
 			WDF_NO_OBJECT_ATTRIBUTES,
 			&hDeviceKey
 		)))
+		{
+			break;
+		}
+
+		for (ULONG reportId = 0; reportId <= UCHAR_MAX; reportId++)
+		{
+			if (!BthPS3_FeatureCacheIsAllowed(&pSrvCtx->FeatureReports.Cache, (UCHAR)reportId))
+			{
+				continue;
+			}
+
+			if (!NT_SUCCESS(RtlUnicodeStringPrintf(
+				&valueName,
+				REG_CACHED_FEATURE_REPORT_FMT,
+				reportId
+			)))
+			{
+				continue;
+			}
+
+			if (!NT_SUCCESS(WdfRegistryQueryValue(
+				hDeviceKey,
+				&valueName,
+				sizeof(report),
+				report,
+				&reportLength,
+				&valueType
+			)) || valueType != REG_BINARY || reportLength < 2 || report[1] != reportId)
+			{
+				continue;
+			}
+
+			BthPS3_PDO_CacheFeatureReport(
+				PdoContext,
+				report,
+				reportLength,
+				FALSE
+			);
+		}
+
+	} while (FALSE);
+
+	if (hDeviceKey)
+	{
+		WdfRegistryClose(hDeviceKey);
+	}
+
+	if (hKey)
+	{
+		WdfRegistryClose(hKey);
+	}
+
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+}
+#pragma code_seg()
+
+//
+// Writes feature reports read from the remote since the last flush to its
+// device key, if enabled
+// 
+#pragma code_seg("PAGE")
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+BthPS3_PDO_PersistFeatureReports(
+	PBTHPS3_PDO_CONTEXT PdoContext
+)
+{
+	NTSTATUS status = STATUS_SUCCESS;
+	WDFKEY hKey = NULL;
+	WDFKEY hDeviceKey = NULL;
+	const PBTHPS3_SERVER_CONTEXT pSrvCtx = GetServerDeviceContext(PdoContext->DevCtxHdr->Device);
+	BTHPS3_FEATURE_CACHE_ENTRY entry;
+	ULONG cursor = 0;
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	PAGED_CODE();
+
+	DECLARE_UNICODE_STRING_SIZE(deviceKeyName, REG_CACHED_DEVICE_KEY_FMT_LEN);
+	DECLARE_UNICODE_STRING_SIZE(valueName, REG_CACHED_FEATURE_REPORT_FMT_LEN);
+
+	do
+	{
+		//
+		// Don't create a key if there is nothing to store
+		// 
+		if (!pSrvCtx->Settings.FeatureReportCachePersist
+			|| !BthPS3_PDO_TakeDirtyFeatureReport(pSrvCtx, PdoContext->RemoteAddress, &cursor, &entry))
+		{
+			break;
+		}
+
+		if (!NT_SUCCESS(status = WdfDriverOpenParametersRegistryKey(
+			WdfGetDriver(),
+			STANDARD_RIGHTS_ALL,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hKey
+		)))
 		{
 			TraceError(
 				TRACE_BUSLOGIC,
-				"WdfRegistryCreateKey failed with status %!STATUS!",
+				"WdfDriverOpenParametersRegistryKey failed with status %!STATUS!",
 				status
 			);
 			break;
 		}
 
-		//
-		// Store serial value
-		// 
-		if (!NT_SUCCESS(status = WdfRegistryAssignULong(
-			hDeviceKey,
-			&slotNo,
-			Slot
+		if (!NT_SUCCESS(status = RtlUnicodeStringPrintf(
+			&deviceKeyName,
+			REG_CACHED_DEVICE_KEY_FMT,
+			PdoContext->RemoteAddress
 		)))
 		{
 			TraceError(
 				TRACE_BUSLOGIC,
-				"WdfRegistryAssignULong failed with status %!STATUS!",
+				"RtlUnicodeStringPrintf failed with status %!STATUS!",
 				status
 			);
 			break;
 		}
 
-		WdfWaitLockAcquire(Header->SlotsLock, NULL);
-
-		SetBit(Header->Slots, Slot);
-
-		WdfWaitLockRelease(Header->SlotsLock);
-
-		//
-		// Store occupied slots in registry
-		// 
-		if (!NT_SUCCESS(status = WdfRegistryAssignValue(
+		if (!NT_SUCCESS(status = WdfRegistryCreateKey(
 			hKey,
-			&slots,
-			REG_BINARY,
-			sizeof(Header->Slots),
-			&Header->Slots
+			&deviceKeyName,
+			GENERIC_WRITE,
+			REG_OPTION_NON_VOLATILE,
+			NULL,
+			WDF_NO_OBJECT_ATTRIBUTES,
+			&hDeviceKey
 		)))
 		{
 			TraceError(
 				TRACE_BUSLOGIC,
-				"WdfRegistryAssignValue failed with status %!STATUS!",
+				"WdfRegistryCreateKey failed with status %!STATUS!",
 				status
 			);
 			break;
 		}
 
+		do
+		{
+			if (!NT_SUCCESS(status = RtlUnicodeStringPrintf(
+				&valueName,
+				REG_CACHED_FEATURE_REPORT_FMT,
+				entry.ReportId
+			)))
+			{
+				continue;
+			}
+
+			if (!NT_SUCCESS(status = WdfRegistryAssignValue(
+				hDeviceKey,
+				&valueName,
+				REG_BINARY,
+				entry.Length,
+				entry.Report
+			)))
+			{
+				TraceError(
+					TRACE_BUSLOGIC,
+					"WdfRegistryAssignValue failed with status %!STATUS!",
+					status
+				);
+			}
+		} while (BthPS3_PDO_TakeDirtyFeatureReport(pSrvCtx, PdoContext->RemoteAddress, &cursor, &entry));
+
 	} while (FALSE);
 
-	if (hKey)
+	if (hDeviceKey)
 	{
-		WdfRegistryClose(hKey);
+		WdfRegistryClose(hDeviceKey);
 	}
 
-	if (hDeviceKey)
+	if (hKey)
 	{
-		WdfRegistryClose(hDeviceKey);
+		WdfRegistryClose(hKey);
 	}
 
 	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
-
-	return status;
 }
 #pragma code_seg()
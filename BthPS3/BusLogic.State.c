@@ -269,6 +269,30 @@ BthPS3_PDO_EvtPostCreate(
 			break;
 		}
 
+		//
+		// Transactions pair a write with a read, the framework only hands
+		// out the next one once the previous got completed
+		// 
+
+		WDF_IO_QUEUE_CONFIG_INIT(&queueCfg, WdfIoQueueDispatchSequential);
+		queueCfg.PowerManaged = WdfTrue;
+		queueCfg.EvtIoDeviceControl = BthPS3_PDO_EvtHidControlTransaction;
+
+		if (!NT_SUCCESS(status = WdfIoQueueCreate(
+			ChildDevice,
+			&queueCfg,
+			&attributes,
+			&pPdoCtx->Queues.HidControlTransactions
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfIoQueueCreate (HidControlTransactions) failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
 		//
 		// Open
 		//   HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Services\BthPS3\Parameters
@@ -359,8 +383,13 @@ BthPS3_PDO_SelfManagedIoInit(
 	WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS idleSettings;
 	WDFKEY hKey = NULL;
 	ULONG idleTimeout = 10000; // 10 secs idle timeout
+	ULONG idleTimeoutMin = 0;
+	ULONG idleTimeoutMax = 0;
+	const PBTHPS3_PDO_CONTEXT pPdoCtx = GetPdoContext(Device);
 
 	DECLARE_CONST_UNICODE_STRING(idleTimeoutValue, BTHPS3_REG_VALUE_CHILD_IDLE_TIMEOUT);
+	DECLARE_CONST_UNICODE_STRING(idleTimeoutMinValue, BTHPS3_REG_VALUE_CHILD_IDLE_TIMEOUT_MIN);
+	DECLARE_CONST_UNICODE_STRING(idleTimeoutMaxValue, BTHPS3_REG_VALUE_CHILD_IDLE_TIMEOUT_MAX);
 
 	do
 	{
@@ -395,6 +424,25 @@ BthPS3_PDO_SelfManagedIoInit(
 			&idleTimeout
 		);
 
+		//
+		// Missing bounds leave the timeout fixed
+		// 
+		if (!NT_SUCCESS(WdfRegistryQueryULong(hKey, &idleTimeoutMinValue, &idleTimeoutMin))
+			|| !NT_SUCCESS(WdfRegistryQueryULong(hKey, &idleTimeoutMaxValue, &idleTimeoutMax)))
+		{
+			idleTimeoutMin = idleTimeoutMax = idleTimeout;
+		}
+
+		WdfSpinLockAcquire(pPdoCtx->IdleState.Lock);
+		BthPS3_IdlePolicyInit(
+			&pPdoCtx->IdleState.Policy,
+			idleTimeout,
+			idleTimeoutMin,
+			idleTimeoutMax
+		);
+		idleTimeout = pPdoCtx->IdleState.Policy.Timeout;
+		WdfSpinLockRelease(pPdoCtx->IdleState.Lock);
+
 		//
 		// Idle settings
 		// 
@@ -427,6 +475,10 @@ BthPS3_PDO_SelfManagedIoInit(
 			break;
 		}
 
+		WdfSpinLockAcquire(pPdoCtx->IdleState.Lock);
+		pPdoCtx->IdleState.IsAssigned = TRUE;
+		WdfSpinLockRelease(pPdoCtx->IdleState.Lock);
+
 	} while (FALSE);
 
 	if (hKey)
@@ -439,6 +491,283 @@ BthPS3_PDO_SelfManagedIoInit(
 	return status;
 }
 
+//
+// Feeds the pause since the previous transfer completion into the idle
+// policy, called from completion routines
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_PDO_RecordActivity(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext
+)
+{
+	BOOLEAN changed = FALSE;
+	const LONG64 now = (LONG64)(KeQueryInterruptTime() / 10000);
+	const LONG64 last = InterlockedExchange64(&PdoContext->IdleState.LastActivity, now);
+
+	//
+	// Streaming input completes every few milliseconds, only take the
+	// lock for actual pauses
+	// 
+	if (last == 0 || now - last < BTHPS3_IDLE_POLICY_MIN_GAP_MS)
+	{
+		return;
+	}
+
+	WdfSpinLockAcquire(PdoContext->IdleState.Lock);
+
+	if (PdoContext->IdleState.IsAssigned)
+	{
+		changed = BthPS3_IdlePolicyAddGap(&PdoContext->IdleState.Policy, (ULONG64)(now - last));
+	}
+
+	WdfSpinLockRelease(PdoContext->IdleState.Lock);
+
+	if (changed)
+	{
+		WdfWorkItemEnqueue(PdoContext->IdleState.ApplyWorkItem);
+	}
+}
+
+//
+// Copies a completed input report into the shared state page, if any
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_PDO_PublishStatePage(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext,
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_In_ ULONG64 Timestamp
+)
+{
+	//
+	// Unlocked peek, pages are rarely mapped and a stale
+	// result only skips or re-checks a single report
+	// 
+	if (PdoContext->StatePage.Page == NULL)
+	{
+		return;
+	}
+
+	WdfSpinLockAcquire(PdoContext->StatePage.Lock);
+
+	if (PdoContext->StatePage.Page != NULL)
+	{
+		BthPS3_StatePagePublish(
+			PdoContext->StatePage.Page,
+			Report,
+			ReportLength,
+			Timestamp
+		);
+	}
+
+	WdfSpinLockRelease(PdoContext->StatePage.Lock);
+}
+
+//
+// Completes a pending IOCTL_BTHPS3_MAP_STATE_PAGE, the buffer is no
+// longer touched once this returns
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_PDO_ReleaseStatePage(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext
+)
+{
+	WDFREQUEST request;
+
+	WdfSpinLockAcquire(PdoContext->StatePage.Lock);
+
+	request = PdoContext->StatePage.Request;
+
+	//
+	// If the request is being canceled, the cancel routine cleans up
+	// 
+	if (request != NULL && NT_SUCCESS(WdfRequestUnmarkCancelable(request)))
+	{
+		PdoContext->StatePage.Request = NULL;
+		PdoContext->StatePage.Page = NULL;
+	}
+	else
+	{
+		request = NULL;
+	}
+
+	WdfSpinLockRelease(PdoContext->StatePage.Lock);
+
+	if (request != NULL)
+	{
+		WdfRequestComplete(request, STATUS_DEVICE_NOT_CONNECTED);
+	}
+}
+
+//
+// Remembers a feature report the device answered GET_REPORT with, IsDirty
+// is FALSE if it came from the registry
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_PDO_CacheFeatureReport(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext,
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_In_ BOOLEAN IsDirty
+)
+{
+	const PBTHPS3_SERVER_CONTEXT pSrvCtx = GetServerDeviceContext(PdoContext->DevCtxHdr->Device);
+
+	//
+	// The allow list doesn't change after load, skip
+	// the lock for everything that isn't on it
+	// 
+	if (ReportLength < 2
+		|| Report[0] != BTHPS3_FEATURE_CACHE_DATA_HEADER
+		|| !BthPS3_FeatureCacheIsAllowed(&pSrvCtx->FeatureReports.Cache, Report[1]))
+	{
+		return;
+	}
+
+	WdfSpinLockAcquire(pSrvCtx->FeatureReports.Lock);
+
+	(void)BthPS3_FeatureCacheStore(
+		&pSrvCtx->FeatureReports.Cache,
+		PdoContext->RemoteAddress,
+		Report,
+		ReportLength,
+		IsDirty
+	);
+
+	WdfSpinLockRelease(pSrvCtx->FeatureReports.Lock);
+}
+
+//
+// Answers a feature GET_REPORT from memory into the response buffer,
+// returns FALSE if the request has to go to the device
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BthPS3_PDO_LookupFeatureReport(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext,
+	_In_reads_bytes_(RequestLength) const UCHAR* Request,
+	_In_ ULONG RequestLength,
+	_In_ PMDL ResponseMdl,
+	_In_ ULONG ResponseBufferLength,
+	_Out_ PULONG ReportLength
+)
+{
+	const PBTHPS3_SERVER_CONTEXT pSrvCtx = GetServerDeviceContext(PdoContext->DevCtxHdr->Device);
+	UCHAR reportId;
+	PUCHAR buffer;
+	BOOLEAN found;
+
+	*ReportLength = 0;
+
+	if (!BthPS3_FeatureCacheParseRequest(Request, RequestLength, &reportId)
+		|| !BthPS3_FeatureCacheIsAllowed(&pSrvCtx->FeatureReports.Cache, reportId))
+	{
+		return FALSE;
+	}
+
+	buffer = MmGetSystemAddressForMdlSafe(ResponseMdl, NormalPagePriority | MdlMappingNoExecute);
+
+	if (buffer == NULL)
+	{
+		return FALSE;
+	}
+
+	WdfSpinLockAcquire(pSrvCtx->FeatureReports.Lock);
+
+	found = BthPS3_FeatureCacheLookup(
+		&pSrvCtx->FeatureReports.Cache,
+		PdoContext->RemoteAddress,
+		reportId,
+		buffer,
+		ResponseBufferLength,
+		ReportLength
+	);
+
+	WdfSpinLockRelease(pSrvCtx->FeatureReports.Lock);
+
+	TraceVerbose(
+		TRACE_BUSLOGIC,
+		"Feature report 0x%02X cache %s",
+		reportId,
+		found ? "hit" : "miss"
+	);
+
+	return found;
+}
+
+//
+// The owner of the state page closed its handle or canceled the request
+// 
+void
+BthPS3_PDO_EvtStatePageCanceled(
+	_In_ WDFREQUEST Request
+)
+{
+	const WDFDEVICE device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
+	const PBTHPS3_PDO_CONTEXT pPdoCtx = GetPdoContext(device);
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	WdfSpinLockAcquire(pPdoCtx->StatePage.Lock);
+
+	if (pPdoCtx->StatePage.Request == Request)
+	{
+		pPdoCtx->StatePage.Request = NULL;
+		pPdoCtx->StatePage.Page = NULL;
+	}
+
+	WdfSpinLockRelease(pPdoCtx->StatePage.Lock);
+
+	WdfRequestComplete(Request, STATUS_CANCELLED);
+
+	FuncExitNoReturn(TRACE_BUSLOGIC);
+}
+
+//
+// Hands the adapted idle timeout to the power policy
+// 
+void
+BthPS3_PDO_EvtIdlePolicyWorkItem(
+	_In_ WDFWORKITEM WorkItem
+)
+{
+	NTSTATUS status;
+	WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS idleSettings;
+	const WDFDEVICE device = (WDFDEVICE)WdfWorkItemGetParentObject(WorkItem);
+	const PBTHPS3_PDO_CONTEXT pPdoCtx = GetPdoContext(device);
+
+	FuncEntry(TRACE_BUSLOGIC);
+
+	WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS_INIT(&idleSettings, IdleCannotWakeFromS0);
+
+	WdfSpinLockAcquire(pPdoCtx->IdleState.Lock);
+	idleSettings.IdleTimeout = pPdoCtx->IdleState.Policy.Timeout;
+	WdfSpinLockRelease(pPdoCtx->IdleState.Lock);
+
+	if (!NT_SUCCESS(status = WdfDeviceAssignS0IdleSettings(device, &idleSettings)))
+	{
+		TraceError(
+			TRACE_BUSLOGIC,
+			"WdfDeviceAssignS0IdleSettings failed with status %!STATUS!",
+			status
+		);
+	}
+	else
+	{
+		TraceVerbose(
+			TRACE_BUSLOGIC,
+			"Idle timeout adapted to %d ms",
+			idleSettings.IdleTimeout
+		);
+	}
+
+	FuncExit(TRACE_BUSLOGIC, "status=%!STATUS!", status);
+}
+
 //
 // Disconnect request completed
 // 
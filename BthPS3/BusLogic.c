@@ -40,21 +40,6 @@
 #include "BthPS3ETW.h"
 
 
- //
- // IOCTLs handled by each PDO
- // 
-IoctlHandler_IoctlRecord G_PDO_IoctlSpecification[] =
-{
-	/* HID channels traffic */
-	{IOCTL_BTHPS3_HID_CONTROL_READ, 0, 1, BthPS3_PDO_HandleHidControlRead},
-	{IOCTL_BTHPS3_HID_CONTROL_WRITE, 1, 0, BthPS3_PDO_HandleHidControlWrite},
-	{IOCTL_BTHPS3_HID_INTERRUPT_READ, 0, 1, BthPS3_PDO_HandleHidInterruptRead},
-	{IOCTL_BTHPS3_HID_INTERRUPT_WRITE, 1, 0, BthPS3_PDO_HandleHidInterruptWrite},
-	/* Disconnect instruction (e.g. from DsHidMini) */
-	{IOCTL_BTH_DISCONNECT_DEVICE, sizeof(BTH_ADDR), 0, BthPS3_PDO_HandleBthDisconnect},
-};
-
-
 //
 // Called when initializing DMF modules for the PDO
 // 
@@ -84,7 +69,7 @@ BthPS3_PDO_EvtDmfModulesAdd(
 	moduleConfigIoctlHandler.DeviceInterfaceGuid = GUID_DEVINTERFACE_BTHPS3;
 	moduleConfigIoctlHandler.AccessModeFilter = IoctlHandler_AccessModeDefault;
 	moduleConfigIoctlHandler.EvtIoctlHandlerAccessModeFilter = NULL;
-	moduleConfigIoctlHandler.IoctlRecordCount = ARRAYSIZE(G_PDO_IoctlSpecification);
+	moduleConfigIoctlHandler.IoctlRecordCount = G_PDO_IoctlSpecificationCount;
 	moduleConfigIoctlHandler.IoctlRecords = G_PDO_IoctlSpecification;
 	moduleConfigIoctlHandler.ForwardUnhandledRequests = FALSE;
 	moduleConfigIoctlHandler.ManualMode = TRUE;
@@ -100,7 +85,8 @@ BthPS3_PDO_EvtDmfModulesAdd(
 }
 
 //
-// Creates a new PDO and connection context for a given remote address
+// Creates a new PDO and connection context for a given remote address, takes
+// over the link the caller reserved in ActiveLinks or releases it on failure
 // 
 _IRQL_requires_max_(PASSIVE_LEVEL)
 _Must_inspect_result_
@@ -118,6 +104,7 @@ BthPS3_PDO_Create(
 
 	NTSTATUS status = STATUS_SUCCESS;
 	WDF_OBJECT_ATTRIBUTES attributes;
+	WDF_WORKITEM_CONFIG workItemConfig;
 	PDO_RECORD record;
 	WDFDEVICE device;
 	UNICODE_STRING guidString = { 0 };
@@ -126,6 +113,7 @@ BthPS3_PDO_Create(
 	LARGE_INTEGER lastConnectionTime;
 	WDFKEY hKey = NULL;
 	ULONG rawPdo = 0;
+	BOOLEAN isInserted = FALSE;
 
     *PdoContext = NULL;
 
@@ -520,11 +508,32 @@ BthPS3_PDO_Create(
 				"BthPS3_PDO_AssignSlot failed with status %!STATUS!",
 				status
 			);
+
+			//
+			// The caller doesn't get the context and can't destroy the PDO,
+			// take it back out so the link gets released below
+			// 
+			WdfWaitLockAcquire(Context->Header.ClientsLock, NULL);
+			WdfCollectionRemove(Context->Header.Clients, device);
+			WdfWaitLockRelease(Context->Header.ClientsLock);
+
+			(void)DMF_Pdo_DeviceUnPlugEx(
+				Context->Header.PdoModule,
+				hardwareId.Buffer,
+				record.SerialNumber
+			);
+
 			break;
 		}
 
 		const PBTHPS3_PDO_CONTEXT pPdoCtx = *PdoContext = GetPdoContext(device);
 
+		//
+		// Counted from here on, the caller destroys the PDO on failure and
+		// destruction releases the link
+		// 
+		isInserted = TRUE;
+
 		pPdoCtx->RemoteAddress = RemoteAddress;
 		pPdoCtx->DevCtxHdr = &Context->Header;
 		pPdoCtx->DeviceType = DeviceType;
@@ -646,6 +655,138 @@ BthPS3_PDO_Create(
 
 		pPdoCtx->HidInterruptChannel.ConnectionState = ConnectionStateInitialized;
 
+		//
+		// Initialize idle timeout adaptation, policy is set up once the power
+		// policy accepted the initial settings
+		// 
+
+		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+		attributes.ParentObject = device;
+
+		if (!NT_SUCCESS(status = WdfSpinLockCreate(
+			&attributes,
+			&pPdoCtx->IdleState.Lock
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfSpinLockCreate for IdleState failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		WDF_WORKITEM_CONFIG_INIT(&workItemConfig, BthPS3_PDO_EvtIdlePolicyWorkItem);
+
+		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+		attributes.ParentObject = device;
+
+		if (!NT_SUCCESS(status = WdfWorkItemCreate(
+			&workItemConfig,
+			&attributes,
+			&pPdoCtx->IdleState.ApplyWorkItem
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfWorkItemCreate for IdleState failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		//
+		// Initialize output report synthesis
+		// 
+
+		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+		attributes.ParentObject = device;
+
+		if (!NT_SUCCESS(status = WdfSpinLockCreate(
+			&attributes,
+			&pPdoCtx->Feedback.Lock
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfSpinLockCreate for Feedback failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		pPdoCtx->Feedback.IsSupported = BthPS3_OutputReportInit(
+			&pPdoCtx->Feedback.State,
+			pPdoCtx->DeviceType
+		);
+
+		//
+		// Initialize IMU sample timing
+		// 
+
+		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+		attributes.ParentObject = device;
+
+		if (!NT_SUCCESS(status = WdfSpinLockCreate(
+			&attributes,
+			&pPdoCtx->MotionImu.Lock
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfSpinLockCreate for MotionImu failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		BthPS3_MotionImuInit(&pPdoCtx->MotionImu.Clock);
+
+		//
+		// Initialize state page publishing
+		// 
+
+		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+		attributes.ParentObject = device;
+
+		if (!NT_SUCCESS(status = WdfSpinLockCreate(
+			&attributes,
+			&pPdoCtx->StatePage.Lock
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfSpinLockCreate for StatePage failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		//
+		// Initialize control transactions
+		// 
+
+		WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+		attributes.ParentObject = device;
+
+		if (!NT_SUCCESS(status = WdfSpinLockCreate(
+			&attributes,
+			&pPdoCtx->ControlTransaction.Lock
+		)))
+		{
+			TraceError(
+				TRACE_BUSLOGIC,
+				"WdfSpinLockCreate for ControlTransaction failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		//
+		// Restore feature reports read on a previous connection
+		// 
+		BthPS3_PDO_LoadFeatureReports(pPdoCtx);
+
 		//
 		// We're ready, expose interface
 		// 
@@ -658,6 +799,11 @@ BthPS3_PDO_Create(
 		WdfRegistryClose(hKey);
 	}
 
+	if (!NT_SUCCESS(status) && !isInserted)
+	{
+		InterlockedDecrement(&Context->Header.ActiveLinks);
+	}
+
 	if (NT_SUCCESS(status))
 	{
 		EventWriteChildDeviceCreationSuccessful(
@@ -752,6 +898,16 @@ BthPS3_PDO_Destroy(
 		PdoContext
 	);
 
+	//
+	// Stop publishing before the buffer owner goes away
+	// 
+	BthPS3_PDO_ReleaseStatePage(PdoContext);
+
+	//
+	// Feature reports read since connecting, the context is still valid here
+	// 
+	BthPS3_PDO_PersistFeatureReports(PdoContext);
+
 	WdfWaitLockAcquire(Context->ClientsLock, NULL);
 
 	const WDFDEVICE device = WdfObjectContextGetObject(PdoContext);
@@ -818,6 +974,7 @@ BthPS3_PDO_Destroy(
 			}
 
 			WdfCollectionRemoveItem(Context->Clients, index);
+			InterlockedDecrement(&Context->ActiveLinks);
 
 			break;
 		}
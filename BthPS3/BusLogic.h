@@ -42,22 +42,10 @@
 #define BTH_ADDR_HEX_LEN				12
 #define REG_CACHED_DEVICE_KEY_FMT		L"Devices\\%012llX"
 #define REG_CACHED_DEVICE_KEY_FMT_LEN	(8 + BTHPS3_BTH_ADDR_MAX_CHARS)
+#define REG_CACHED_FEATURE_REPORT_FMT		L"FeatureReport%02X"
+#define REG_CACHED_FEATURE_REPORT_FMT_LEN	(13 + 3) /* 2 hex digits + NULL terminator */
 
 
-//
-// Connection state
-//
-typedef enum _BTHPS3_CONNECTION_STATE {
-    ConnectionStateUninitialized = 0,
-    ConnectionStateInitialized,
-    ConnectionStateConnecting,
-    ConnectionStateConnected,
-    ConnectionStateConnectFailed,
-    ConnectionStateDisconnecting,
-    ConnectionStateDisconnected
-
-} BTHPS3_CONNECTION_STATE, *PBTHPS3_CONNECTION_STATE;
-
 //
 // State information for a single L2CAP channel
 // 
@@ -108,8 +96,154 @@ typedef struct _BTHPS3_PDO_CONTEXT
 
 		WDFQUEUE HidInterruptWriteRequests;
 
+		//
+		// Sequential, one control transaction in flight at a time
+		// 
+		WDFQUEUE HidControlTransactions;
+
 	} Queues;
 
+	//
+	// Activity-adapted idle timeout
+	// 
+	struct
+	{
+		//
+		// Protects Policy
+		// 
+		WDFSPINLOCK Lock;
+
+		//
+		// Applies a changed timeout at PASSIVE_LEVEL
+		// 
+		WDFWORKITEM ApplyWorkItem;
+
+		//
+		// Interrupt time (in ms) of the last transfer completion
+		// 
+		volatile LONG64 LastActivity;
+
+		//
+		// Set once the power policy accepted the initial settings
+		// 
+		BOOLEAN IsAssigned;
+
+		BTHPS3_IDLE_POLICY Policy;
+
+	} IdleState;
+
+	//
+	// Output report synthesized from IOCTL_BTHPS3_SET_FEEDBACK
+	// 
+	struct
+	{
+		//
+		// Protects State
+		// 
+		WDFSPINLOCK Lock;
+
+		//
+		// FALSE if the device type has no known report layout
+		// 
+		BOOLEAN IsSupported;
+
+		BTHPS3_OUTPUT_REPORT State;
+
+	} Feedback;
+
+	//
+	// Sample timing for IOCTL_BTHPS3_HID_INTERRUPT_READ_IMU
+	// 
+	struct
+	{
+		//
+		// Protects Clock
+		// 
+		WDFSPINLOCK Lock;
+
+		BTHPS3_MOTION_IMU_CLOCK Clock;
+
+	} MotionImu;
+
+	//
+	// Latest report shared through IOCTL_BTHPS3_MAP_STATE_PAGE
+	// 
+	struct
+	{
+		//
+		// Protects Request and Page, serializes publishers
+		// 
+		WDFSPINLOCK Lock;
+
+		//
+		// Pending map request owning the page, NULL if none
+		// 
+		WDFREQUEST Request;
+
+		//
+		// System address of the output buffer of Request
+		// 
+		PBTHPS3_STATE_PAGE Page;
+
+	} StatePage;
+
+	//
+	// IOCTL_BTHPS3_HID_CONTROL_TRANSACT in flight
+	// 
+	struct
+	{
+		//
+		// Guards IsActive against plain control reads being dispatched
+		// 
+		WDFSPINLOCK Lock;
+
+		//
+		// Holds back plain control reads, the response is the
+		// transaction's to read
+		// 
+		BOOLEAN IsActive;
+
+		//
+		// Plain control reads sent down, a transaction won't start while
+		// they might consume its response
+		// 
+		volatile LONG PlainReads;
+
+		//
+		// Request arrived while plain control reads were pending, it
+		// starts once the last of them is done
+		// 
+		BOOLEAN IsWaiting;
+
+		//
+		// The transaction request, carries the response read
+		// 
+		WDFREQUEST Request;
+
+		//
+		// Report to send and response buffer, both owned by Request
+		// 
+		PVOID Report;
+
+		size_t ReportLength;
+
+		PMDL ResponseMDL;
+
+		size_t ResponseBufferLength;
+
+		//
+		// Transfers not yet completed, Request completes at zero
+		// 
+		volatile LONG Outstanding;
+
+		NTSTATUS SendStatus;
+
+		NTSTATUS ReadStatus;
+
+		ULONG ResponseLength;
+
+	} ControlTransaction;
+
 } BTHPS3_PDO_CONTEXT, * PBTHPS3_PDO_CONTEXT;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(BTHPS3_PDO_CONTEXT, GetPdoContext)
@@ -197,6 +331,22 @@ EVT_DMF_IoctlHandler_Callback BthPS3_PDO_HandleHidInterruptWrite;
 
 EVT_DMF_IoctlHandler_Callback BthPS3_PDO_HandleBthDisconnect;
 
+EVT_DMF_IoctlHandler_Callback BthPS3_PDO_HandleGetFlightRecorder;
+
+EVT_DMF_IoctlHandler_Callback BthPS3_PDO_HandleGetRadioLoad;
+
+EVT_DMF_IoctlHandler_Callback BthPS3_PDO_HandleGetCapabilities;
+
+EVT_DMF_IoctlHandler_Callback BthPS3_PDO_HandleSetFeedback;
+
+EVT_DMF_IoctlHandler_Callback BthPS3_PDO_HandleMapStatePage;
+
+EVT_DMF_IoctlHandler_Callback BthPS3_PDO_HandleHidControlTransact;
+
+extern IoctlHandler_IoctlRecord G_PDO_IoctlSpecification[];
+
+extern const ULONG G_PDO_IoctlSpecificationCount;
+
 //
 // Process requests once queued
 // 
@@ -209,18 +359,65 @@ EVT_WDF_IO_QUEUE_STATE BthPS3_PDO_DispatchHidInterruptRead;
 
 EVT_WDF_IO_QUEUE_STATE BthPS3_PDO_DispatchHidInterruptWrite;
 
+EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL BthPS3_PDO_EvtHidControlTransaction;
+
 //
 // PNP/Power
 // 
 
 EVT_WDF_DEVICE_SELF_MANAGED_IO_INIT BthPS3_PDO_SelfManagedIoInit;
 
+EVT_WDF_WORKITEM BthPS3_PDO_EvtIdlePolicyWorkItem;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_PDO_RecordActivity(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_PDO_PublishStatePage(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext,
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_In_ ULONG64 Timestamp
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_PDO_ReleaseStatePage(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_PDO_CacheFeatureReport(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext,
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_In_ BOOLEAN IsDirty
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BthPS3_PDO_LookupFeatureReport(
+	_In_ PBTHPS3_PDO_CONTEXT PdoContext,
+	_In_reads_bytes_(RequestLength) const UCHAR* Request,
+	_In_ ULONG RequestLength,
+	_In_ PMDL ResponseMdl,
+	_In_ ULONG ResponseBufferLength,
+	_Out_ PULONG ReportLength
+);
+
 //
 // I/O completion
 // 
 
 EVT_WDF_REQUEST_COMPLETION_ROUTINE BthPS3_PDO_DisconnectRequestCompleted;
 
+EVT_WDF_REQUEST_CANCEL BthPS3_PDO_EvtStatePageCanceled;
+
 //
 // Registry operations
 // 
@@ -240,3 +437,29 @@ BthPS3_PDO_AssignSlot(
 	BTH_ADDR RemoteAddress,
 	ULONG Slot
 );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+BthPS3_PDO_LoadFeatureReports(
+	PBTHPS3_PDO_CONTEXT PdoContext
+);
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+VOID
+BthPS3_PDO_PersistFeatureReports(
+	PBTHPS3_PDO_CONTEXT PdoContext
+);
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_PDO_InitializeSlots(
+	PBTHPS3_DEVICE_CONTEXT_HEADER Header
+);
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_PDO_QueryCachedAddresses(
+	PBTH_ADDR Addresses,
+	ULONG MaxCount,
+	PULONG Count
+);
@@ -0,0 +1,140 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// L2CAP channel connection state and its transitions. Callers hold the
+// channel's ConnectionStateLock, the transitions only depend on basic types
+// so the state machine can be built and exercised outside the driver.
+// 
+
+//
+// Connection state
+//
+typedef enum _BTHPS3_CONNECTION_STATE {
+	ConnectionStateUninitialized = 0,
+	ConnectionStateInitialized,
+	ConnectionStateConnecting,
+	ConnectionStateConnected,
+	ConnectionStateConnectFailed,
+	ConnectionStateDisconnecting,
+	ConnectionStateDisconnected
+
+} BTHPS3_CONNECTION_STATE, *PBTHPS3_CONNECTION_STATE;
+
+//
+// What the caller has to do after asking a channel to disconnect
+// 
+typedef enum _BTHPS3_DISCONNECT_ACTION
+{
+	//
+	// Channel isn't connected, nothing to do
+	// 
+	BthPS3DisconnectActionNone = 0,
+
+	//
+	// Connection not completed yet, CLOSE_CHANNEL has to go down once it is
+	// 
+	BthPS3DisconnectActionDeferred,
+
+	//
+	// Channel was connected, CLOSE_CHANNEL has to go down now
+	// 
+	BthPS3DisconnectActionClose
+
+} BTHPS3_DISCONNECT_ACTION;
+
+//
+// Moves a connecting or connected channel to disconnecting
+// 
+FORCEINLINE
+BTHPS3_DISCONNECT_ACTION
+BthPS3_ConnectionStateDisconnect(
+	_Inout_ PBTHPS3_CONNECTION_STATE State
+)
+{
+	switch (*State)
+	{
+	case ConnectionStateConnecting:
+		*State = ConnectionStateDisconnecting;
+		return BthPS3DisconnectActionDeferred;
+	case ConnectionStateConnected:
+		*State = ConnectionStateDisconnecting;
+		return BthPS3DisconnectActionClose;
+	default:
+		return BthPS3DisconnectActionNone;
+	}
+}
+
+//
+// Channel connection got accepted
+// 
+FORCEINLINE
+VOID
+BthPS3_ConnectionStateConnectCompleted(
+	_Inout_ PBTHPS3_CONNECTION_STATE State
+)
+{
+	*State = ConnectionStateConnected;
+}
+
+//
+// CLOSE_CHANNEL completed, whatever its status
+// 
+FORCEINLINE
+VOID
+BthPS3_ConnectionStateDisconnectCompleted(
+	_Inout_ PBTHPS3_CONNECTION_STATE State
+)
+{
+	*State = ConnectionStateDisconnected;
+}
+
+//
+// Clean-up of the device is due once both of its channels are gone
+// 
+FORCEINLINE
+BOOLEAN
+BthPS3_ConnectionStateBothDisconnected(
+	_In_ BTHPS3_CONNECTION_STATE Control,
+	_In_ BTHPS3_CONNECTION_STATE Interrupt
+)
+{
+	return Control == ConnectionStateDisconnected
+		&& Interrupt == ConnectionStateDisconnected;
+}
@@ -0,0 +1,356 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "MotionImu.h"
+#include "ControllerState.h"
+#else
+#include "Driver.h"
+#endif
+
+
+//
+// All offsets are within the report including the HIDP DATA header
+// 
+
+#pragma region SIXAXIS and Navigation
+
+#define SIXAXIS_REPORT_ID                       0x01
+#define SIXAXIS_MIN_REPORT_SIZE                 BTHPS3_SIXAXIS_HID_INPUT_REPORT_SIZE
+#define SIXAXIS_OFFSET_BUTTONS                  3
+#define SIXAXIS_OFFSET_STICKS                   7
+#define SIXAXIS_OFFSET_TRIGGERS                 19
+#define SIXAXIS_OFFSET_BATTERY                  31
+#define SIXAXIS_OFFSET_ACCELEROMETER            42
+#define SIXAXIS_OFFSET_GYROSCOPE                48
+
+//
+// Report bit (byte * 8 + bit) to BTHPS3_BUTTON_* mapping
+// 
+static const ULONG G_SixaxisButtons[24] =
+{
+	BTHPS3_BUTTON_SELECT, BTHPS3_BUTTON_L3, BTHPS3_BUTTON_R3, BTHPS3_BUTTON_START,
+	BTHPS3_BUTTON_DPAD_UP, BTHPS3_BUTTON_DPAD_RIGHT, BTHPS3_BUTTON_DPAD_DOWN, BTHPS3_BUTTON_DPAD_LEFT,
+	BTHPS3_BUTTON_L2, BTHPS3_BUTTON_R2, BTHPS3_BUTTON_L1, BTHPS3_BUTTON_R1,
+	BTHPS3_BUTTON_TRIANGLE, BTHPS3_BUTTON_CIRCLE, BTHPS3_BUTTON_CROSS, BTHPS3_BUTTON_SQUARE,
+	BTHPS3_BUTTON_PS, 0, 0, 0,
+	0, 0, 0, 0
+};
+
+//
+// 10-bit big-endian readings centered at 512
+// 
+FORCEINLINE
+SHORT
+BthPS3_SixaxisAxis(
+	_In_ const UCHAR* Value
+)
+{
+	return (SHORT)((((ULONG)Value[0] << 8) | Value[1]) - 512);
+}
+
+static
+BOOLEAN
+BthPS3_DecodeSixaxis(
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_Out_ PBTHPS3_CONTROLLER_STATE State
+)
+{
+	if (ReportLength < SIXAXIS_MIN_REPORT_SIZE || Report[1] != SIXAXIS_REPORT_ID)
+	{
+		return FALSE;
+	}
+
+	const ULONG raw = (ULONG)Report[SIXAXIS_OFFSET_BUTTONS]
+		| ((ULONG)Report[SIXAXIS_OFFSET_BUTTONS + 1] << 8)
+		| ((ULONG)Report[SIXAXIS_OFFSET_BUTTONS + 2] << 16);
+	ULONG buttons = 0;
+
+	for (ULONG bit = 0; bit < ARRAYSIZE(G_SixaxisButtons); bit++)
+	{
+		buttons |= G_SixaxisButtons[bit] & (0 - ((raw >> bit) & 1));
+	}
+
+	State->Buttons = buttons;
+
+	for (ULONG axis = 0; axis < 4; axis++)
+	{
+		State->Sticks[axis] = Report[SIXAXIS_OFFSET_STICKS + axis];
+	}
+
+	State->Triggers[0] = Report[SIXAXIS_OFFSET_TRIGGERS];
+	State->Triggers[1] = Report[SIXAXIS_OFFSET_TRIGGERS + 1];
+	State->Battery = Report[SIXAXIS_OFFSET_BATTERY];
+
+	for (ULONG axis = 0; axis < 3; axis++)
+	{
+		State->Accelerometer[axis] = BthPS3_SixaxisAxis(&Report[SIXAXIS_OFFSET_ACCELEROMETER + axis * 2]);
+	}
+
+	//
+	// Only yaw rate is reported
+	// 
+	State->Gyroscope[0] = 0;
+	State->Gyroscope[1] = 0;
+	State->Gyroscope[2] = BthPS3_SixaxisAxis(&Report[SIXAXIS_OFFSET_GYROSCOPE]);
+
+	return TRUE;
+}
+
+#pragma endregion
+
+#pragma region Motion
+
+#define MOTION_REPORT_ID                        0x01
+#define MOTION_OFFSET_BUTTONS                   2
+#define MOTION_OFFSET_TRIGGER                   6
+#define MOTION_OFFSET_BATTERY                   13
+
+//
+// Newer of the two samples in the report
+// 
+#define MOTION_OFFSET_ACCELEROMETER             20
+#define MOTION_OFFSET_GYROSCOPE                 32
+
+static const ULONG G_MotionButtons[32] =
+{
+	BTHPS3_BUTTON_SELECT, 0, 0, BTHPS3_BUTTON_START,
+	0, 0, 0, 0,
+	0, 0, 0, 0,
+	BTHPS3_BUTTON_TRIANGLE, BTHPS3_BUTTON_CIRCLE, BTHPS3_BUTTON_CROSS, BTHPS3_BUTTON_SQUARE,
+	BTHPS3_BUTTON_PS, 0, 0, 0,
+	0, 0, 0, 0,
+	0, 0, 0, 0,
+	0, 0, BTHPS3_BUTTON_MOVE, BTHPS3_BUTTON_T
+};
+
+//
+// Little-endian readings biased by 0x8000
+// 
+FORCEINLINE
+SHORT
+BthPS3_MotionAxis(
+	_In_ const UCHAR* Value
+)
+{
+	return (SHORT)(((ULONG)Value[0] | ((ULONG)Value[1] << 8)) - 0x8000);
+}
+
+static
+BOOLEAN
+BthPS3_DecodeMotion(
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_Out_ PBTHPS3_CONTROLLER_STATE State
+)
+{
+	if (ReportLength < BTHPS3_MOTION_IMU_MIN_REPORT_SIZE || Report[1] != MOTION_REPORT_ID)
+	{
+		return FALSE;
+	}
+
+	const ULONG raw = (ULONG)Report[MOTION_OFFSET_BUTTONS]
+		| ((ULONG)Report[MOTION_OFFSET_BUTTONS + 1] << 8)
+		| ((ULONG)Report[MOTION_OFFSET_BUTTONS + 2] << 16)
+		| ((ULONG)Report[MOTION_OFFSET_BUTTONS + 3] << 24);
+	ULONG buttons = 0;
+
+	for (ULONG bit = 0; bit < ARRAYSIZE(G_MotionButtons); bit++)
+	{
+		buttons |= G_MotionButtons[bit] & (0 - ((raw >> bit) & 1));
+	}
+
+	State->Buttons = buttons;
+
+	//
+	// No sticks, centered
+	// 
+	for (ULONG axis = 0; axis < 4; axis++)
+	{
+		State->Sticks[axis] = 0x80;
+	}
+
+	State->Triggers[0] = 0;
+	State->Triggers[1] = Report[MOTION_OFFSET_TRIGGER];
+	State->Battery = Report[MOTION_OFFSET_BATTERY];
+
+	for (ULONG axis = 0; axis < 3; axis++)
+	{
+		State->Accelerometer[axis] = BthPS3_MotionAxis(&Report[MOTION_OFFSET_ACCELEROMETER + axis * 2]);
+		State->Gyroscope[axis] = BthPS3_MotionAxis(&Report[MOTION_OFFSET_GYROSCOPE + axis * 2]);
+	}
+
+	return TRUE;
+}
+
+#pragma endregion
+
+#pragma region Wireless
+
+#define WIRELESS_REPORT_ID                      0x11
+#define WIRELESS_MIN_REPORT_SIZE                37
+#define WIRELESS_OFFSET_STICKS                  4
+#define WIRELESS_OFFSET_BUTTONS                 8
+#define WIRELESS_OFFSET_TRIGGERS                11
+#define WIRELESS_OFFSET_GYROSCOPE               16
+#define WIRELESS_OFFSET_ACCELEROMETER           22
+#define WIRELESS_OFFSET_BATTERY                 33
+
+//
+// Hat switch position (8 = released) to D-Pad buttons
+// 
+static const ULONG G_WirelessHat[16] =
+{
+	BTHPS3_BUTTON_DPAD_UP,
+	BTHPS3_BUTTON_DPAD_UP | BTHPS3_BUTTON_DPAD_RIGHT,
+	BTHPS3_BUTTON_DPAD_RIGHT,
+	BTHPS3_BUTTON_DPAD_RIGHT | BTHPS3_BUTTON_DPAD_DOWN,
+	BTHPS3_BUTTON_DPAD_DOWN,
+	BTHPS3_BUTTON_DPAD_DOWN | BTHPS3_BUTTON_DPAD_LEFT,
+	BTHPS3_BUTTON_DPAD_LEFT,
+	BTHPS3_BUTTON_DPAD_LEFT | BTHPS3_BUTTON_DPAD_UP,
+	0, 0, 0, 0, 0, 0, 0, 0
+};
+
+//
+// Bits above the hat switch nibble
+// 
+static const ULONG G_WirelessButtons[20] =
+{
+	BTHPS3_BUTTON_SQUARE, BTHPS3_BUTTON_CROSS, BTHPS3_BUTTON_CIRCLE, BTHPS3_BUTTON_TRIANGLE,
+	BTHPS3_BUTTON_L1, BTHPS3_BUTTON_R1, BTHPS3_BUTTON_L2, BTHPS3_BUTTON_R2,
+	BTHPS3_BUTTON_SELECT, BTHPS3_BUTTON_START, BTHPS3_BUTTON_L3, BTHPS3_BUTTON_R3,
+	BTHPS3_BUTTON_PS, BTHPS3_BUTTON_TOUCHPAD, 0, 0,
+	0, 0, 0, 0
+};
+
+//
+// Signed little-endian readings
+// 
+FORCEINLINE
+SHORT
+BthPS3_WirelessAxis(
+	_In_ const UCHAR* Value
+)
+{
+	return (SHORT)((ULONG)Value[0] | ((ULONG)Value[1] << 8));
+}
+
+static
+BOOLEAN
+BthPS3_DecodeWireless(
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_Out_ PBTHPS3_CONTROLLER_STATE State
+)
+{
+	if (ReportLength < WIRELESS_MIN_REPORT_SIZE || Report[1] != WIRELESS_REPORT_ID)
+	{
+		return FALSE;
+	}
+
+	const ULONG raw = (ULONG)Report[WIRELESS_OFFSET_BUTTONS]
+		| ((ULONG)Report[WIRELESS_OFFSET_BUTTONS + 1] << 8)
+		| ((ULONG)Report[WIRELESS_OFFSET_BUTTONS + 2] << 16);
+	ULONG buttons = G_WirelessHat[raw & 0x0F];
+
+	for (ULONG bit = 0; bit < ARRAYSIZE(G_WirelessButtons); bit++)
+	{
+		buttons |= G_WirelessButtons[bit] & (0 - ((raw >> (bit + 4)) & 1));
+	}
+
+	State->Buttons = buttons;
+
+	for (ULONG axis = 0; axis < 4; axis++)
+	{
+		State->Sticks[axis] = Report[WIRELESS_OFFSET_STICKS + axis];
+	}
+
+	State->Triggers[0] = Report[WIRELESS_OFFSET_TRIGGERS];
+	State->Triggers[1] = Report[WIRELESS_OFFSET_TRIGGERS + 1];
+	State->Battery = Report[WIRELESS_OFFSET_BATTERY];
+
+	for (ULONG axis = 0; axis < 3; axis++)
+	{
+		State->Gyroscope[axis] = BthPS3_WirelessAxis(&Report[WIRELESS_OFFSET_GYROSCOPE + axis * 2]);
+		State->Accelerometer[axis] = BthPS3_WirelessAxis(&Report[WIRELESS_OFFSET_ACCELEROMETER + axis * 2]);
+	}
+
+	return TRUE;
+}
+
+#pragma endregion
+
+typedef BOOLEAN(*PFN_BTHPS3_DECODE)(
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_Out_ PBTHPS3_CONTROLLER_STATE State
+	);
+
+//
+// Indexed by DS_DEVICE_TYPE
+// 
+static const PFN_BTHPS3_DECODE G_Decoders[] =
+{
+	NULL,
+	BthPS3_DecodeSixaxis,
+	BthPS3_DecodeSixaxis,
+	BthPS3_DecodeMotion,
+	BthPS3_DecodeWireless
+};
+
+BOOLEAN
+BthPS3_ControllerStateDecode(
+	DS_DEVICE_TYPE DeviceType,
+	const UCHAR* Report,
+	ULONG ReportLength,
+	PBTHPS3_CONTROLLER_STATE State
+)
+{
+	RtlZeroMemory(State, sizeof(*State));
+
+	if ((ULONG)DeviceType >= ARRAYSIZE(G_Decoders) || G_Decoders[DeviceType] == NULL)
+	{
+		return FALSE;
+	}
+
+	State->DeviceType = (UCHAR)DeviceType;
+
+	return G_Decoders[DeviceType](Report, ReportLength, State);
+}
@@ -0,0 +1,148 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "Crc32.h"
+#else
+#include "Driver.h"
+#endif
+
+
+#define CRC32_POLYNOMIAL                        0xEDB88320
+
+//
+// Table n advances the CRC over a byte followed by n zero bytes
+// 
+static ULONG G_Crc32Table[8][256];
+
+
+VOID
+BthPS3_Crc32Init(
+	VOID
+)
+{
+	for (ULONG index = 0; index < 256; index++)
+	{
+		ULONG crc = index;
+
+		for (ULONG bit = 0; bit < 8; bit++)
+		{
+			crc = (crc >> 1) ^ (CRC32_POLYNOMIAL & (0 - (crc & 1)));
+		}
+
+		G_Crc32Table[0][index] = crc;
+	}
+
+	for (ULONG index = 0; index < 256; index++)
+	{
+		for (ULONG slice = 1; slice < 8; slice++)
+		{
+			const ULONG previous = G_Crc32Table[slice - 1][index];
+
+			G_Crc32Table[slice][index] = (previous >> 8) ^ G_Crc32Table[0][previous & 0xFF];
+		}
+	}
+}
+
+ULONG
+BthPS3_Crc32Update(
+	ULONG Crc,
+	const UCHAR* Data,
+	ULONG Length
+)
+{
+	ULONG crc = ~Crc;
+
+	//
+	// Eight bytes per step, assembled bytewise to stay endian and alignment agnostic
+	// 
+	while (Length >= 8)
+	{
+		const ULONG low = crc
+			^ ((ULONG)Data[0] | ((ULONG)Data[1] << 8) | ((ULONG)Data[2] << 16) | ((ULONG)Data[3] << 24));
+		const ULONG high =
+			(ULONG)Data[4] | ((ULONG)Data[5] << 8) | ((ULONG)Data[6] << 16) | ((ULONG)Data[7] << 24);
+
+		crc = G_Crc32Table[7][low & 0xFF]
+			^ G_Crc32Table[6][(low >> 8) & 0xFF]
+			^ G_Crc32Table[5][(low >> 16) & 0xFF]
+			^ G_Crc32Table[4][low >> 24]
+			^ G_Crc32Table[3][high & 0xFF]
+			^ G_Crc32Table[2][(high >> 8) & 0xFF]
+			^ G_Crc32Table[1][(high >> 16) & 0xFF]
+			^ G_Crc32Table[0][high >> 24];
+
+		Data += 8;
+		Length -= 8;
+	}
+
+	while (Length-- > 0)
+	{
+		crc = (crc >> 8) ^ G_Crc32Table[0][(crc ^ *Data++) & 0xFF];
+	}
+
+	return ~crc;
+}
+
+VOID
+BthPS3_Crc32Seal(
+	PUCHAR Report,
+	ULONG Length
+)
+{
+	const ULONG crc = BthPS3_Crc32Update(0, Report, Length - BTHPS3_CRC32_SIZE);
+
+	Report[Length - 4] = (UCHAR)crc;
+	Report[Length - 3] = (UCHAR)(crc >> 8);
+	Report[Length - 2] = (UCHAR)(crc >> 16);
+	Report[Length - 1] = (UCHAR)(crc >> 24);
+}
+
+BOOLEAN
+BthPS3_Crc32Verify(
+	const UCHAR* Report,
+	ULONG Length
+)
+{
+	const ULONG crc = BthPS3_Crc32Update(0, Report, Length - BTHPS3_CRC32_SIZE);
+
+	return Report[Length - 4] == (UCHAR)crc
+		&& Report[Length - 3] == (UCHAR)(crc >> 8)
+		&& Report[Length - 2] == (UCHAR)(crc >> 16)
+		&& Report[Length - 1] == (UCHAR)(crc >> 24);
+}
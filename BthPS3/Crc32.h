@@ -0,0 +1,89 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// CRC-32 (IEEE 802.3, reflected) as used by DualShock 4 Bluetooth reports.
+// Slicing-by-8 consumes eight bytes per step through table lookups only, so
+// no extended processor state has to be saved in the kernel. Only depends on
+// basic types so the kernel can be built and exercised outside the driver.
+// 
+
+//
+// Trailing checksum of DualShock 4 Bluetooth reports
+// 
+#define BTHPS3_CRC32_SIZE                       4
+
+
+//
+// Builds the lookup tables, has to be called once before any other function
+// 
+VOID
+BthPS3_Crc32Init(
+	VOID
+);
+
+//
+// Continues Crc (0 to start) over Length bytes of Data
+// 
+ULONG
+BthPS3_Crc32Update(
+	_In_ ULONG Crc,
+	_In_reads_bytes_(Length) const UCHAR* Data,
+	_In_ ULONG Length
+);
+
+//
+// Stores the checksum of everything before it in the last four bytes
+// (little-endian) of a report including the HIDP header
+// 
+VOID
+BthPS3_Crc32Seal(
+	_Inout_updates_bytes_(Length) PUCHAR Report,
+	_In_ ULONG Length
+);
+
+//
+// Returns TRUE if the last four bytes of a report including the HIDP header
+// match the checksum of everything before them
+// 
+BOOLEAN
+BthPS3_Crc32Verify(
+	_In_reads_bytes_(Length) const UCHAR* Report,
+	_In_ ULONG Length
+);
@@ -99,6 +99,7 @@ BthPS3_CreateDevice(
     );
 
     WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, BTHPS3_SERVER_CONTEXT);
+    attributes.EvtCleanupCallback = BthPS3_EvtDeviceContextCleanup;
 
     do
     {
@@ -126,6 +127,15 @@ BthPS3_CreateDevice(
             break;
         }
 
+        //
+        // Make radio known to the load snapshot
+        // 
+        if (!NT_SUCCESS(status = BthPS3_RadioAdd(device)))
+        {
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"BthPS3_RadioAdd", status);
+            break;
+        }
+
         //
         // Query for interfaces and pre-allocate BRBs
         //
@@ -358,6 +368,11 @@ BthPS3_EvtWdfDeviceSelfManagedIoInit(
             );
         }
 
+        //
+        // Known remotes stay patched while the filter is auto-disabled
+        //
+        (void)BthPS3PSM_RefreshAddressFilterSync(devCtx);
+
     } while (FALSE);
 
     FuncExit(TRACE_DEVICE, "status=%!STATUS!", status);
@@ -401,6 +416,22 @@ BthPS3_EvtWdfDeviceSelfManagedIoCleanup(
 }
 #pragma code_seg()
 
+//
+// Gets invoked once the device object is about to be destroyed
+// 
+_Use_decl_annotations_
+VOID
+BthPS3_EvtDeviceContextCleanup(
+    WDFOBJECT Object
+)
+{
+    FuncEntry(TRACE_DEVICE);
+
+    BthPS3_RadioRemove((WDFDEVICE)Object);
+
+    FuncExitNoReturn(TRACE_DEVICE);
+}
+
 //
 // Initializes DMF modules
 // 
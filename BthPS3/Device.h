@@ -54,6 +54,7 @@ BthPS3_CreateDevice(
 
 EVT_WDF_DEVICE_SELF_MANAGED_IO_INIT BthPS3_EvtWdfDeviceSelfManagedIoInit;
 EVT_WDF_DEVICE_SELF_MANAGED_IO_CLEANUP BthPS3_EvtWdfDeviceSelfManagedIoCleanup;
+EVT_WDF_OBJECT_CONTEXT_CLEANUP BthPS3_EvtDeviceContextCleanup;
 
 NTSTATUS
 BthPS3_OpenFilterIoTarget(
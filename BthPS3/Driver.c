@@ -69,6 +69,7 @@ DriverEntry(
     WDF_DRIVER_CONFIG config;
     NTSTATUS status;
     WDF_OBJECT_ATTRIBUTES attributes;
+    WDFDRIVER driver;
 
     //
     // Initialize WPP Tracing
@@ -81,6 +82,8 @@ DriverEntry(
 
     ExInitializeDriverRuntime(DrvRtPoolNxOptIn);
 
+    BthPS3_Crc32Init();
+
     //
     // Register a cleanup callback so that we can call WPP_CLEANUP when
     // the framework driver object is deleted during driver unload.
@@ -97,7 +100,7 @@ DriverEntry(
         RegistryPath,
         &attributes,
         &config,
-        WDF_NO_HANDLE
+        &driver
     )))
     {
         TraceError(
@@ -109,6 +112,17 @@ DriverEntry(
         return status;
     }
 
+    if (!NT_SUCCESS(status = BthPS3_RadiosInitialize(driver)))
+    {
+        TraceError(
+            TRACE_DRIVER,
+            "BthPS3_RadiosInitialize failed %!STATUS!",
+            status
+        );
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
     if (!NT_SUCCESS(status = DomitoInit()))
     {
         TraceError(
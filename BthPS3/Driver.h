@@ -51,6 +51,18 @@
 
 #include "device.h"
 #include "trace.h"
+#include "FlightRecorder.h"
+#include "IdlePolicy.h"
+#include "SlotBitmap.h"
+#include "OutputReport.h"
+#include "MotionImu.h"
+#include "Crc32.h"
+#include "ControllerState.h"
+#include "StatePage.h"
+#include "FeatureCache.h"
+#include "RejectCache.h"
+#include "NameMatch.h"
+#include "ConnectionState.h"
 #include "Bluetooth.h"
 #include "PSM.h"
 #include "L2CAP.h"
@@ -61,10 +73,6 @@ EXTERN_C_START
 
 #define BTHPS_POOL_TAG	'dP3B'
 
-#define SetBit(A,k)     ( A[(k/32)] |= (1 << (k%32)) )
-#define ClearBit(A,k)   ( A[(k/32)] &= ~(1 << (k%32)) )
-#define TestBit(A,k)    ( A[(k/32)] & (1 << (k%32)) )
-
 //
 // WDFDRIVER Events
 //
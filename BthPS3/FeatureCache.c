@@ -0,0 +1,239 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "FeatureCache.h"
+#else
+#include "Driver.h"
+#endif
+
+
+//
+// HIDP GET_REPORT for a feature report, bit 3 flags a trailing buffer size
+// 
+#define BTHPS3_FEATURE_CACHE_GET_REPORT         0x43
+#define BTHPS3_FEATURE_CACHE_GET_REPORT_SIZE    0x08
+
+
+VOID
+BthPS3_FeatureCacheInit(
+	PBTHPS3_FEATURE_CACHE Cache
+)
+{
+	RtlZeroMemory(Cache, sizeof(BTHPS3_FEATURE_CACHE));
+}
+
+VOID
+BthPS3_FeatureCacheAllow(
+	PBTHPS3_FEATURE_CACHE Cache,
+	UCHAR ReportId
+)
+{
+	Cache->AllowList[ReportId / 32] |= 1UL << (ReportId % 32);
+}
+
+BOOLEAN
+BthPS3_FeatureCacheIsAllowed(
+	const BTHPS3_FEATURE_CACHE* Cache,
+	UCHAR ReportId
+)
+{
+	return (Cache->AllowList[ReportId / 32] & (1UL << (ReportId % 32))) != 0;
+}
+
+BOOLEAN
+BthPS3_FeatureCacheParseRequest(
+	const UCHAR* Request,
+	ULONG RequestLength,
+	PUCHAR ReportId
+)
+{
+	if (RequestLength < 2
+		|| (Request[0] & ~BTHPS3_FEATURE_CACHE_GET_REPORT_SIZE) != BTHPS3_FEATURE_CACHE_GET_REPORT)
+	{
+		return FALSE;
+	}
+
+	*ReportId = Request[1];
+
+	return TRUE;
+}
+
+//
+// Returns the entry holding the report or NULL
+// 
+static
+PBTHPS3_FEATURE_CACHE_ENTRY
+BthPS3_FeatureCacheFind(
+	_In_ PBTHPS3_FEATURE_CACHE Cache,
+	_In_ BTH_ADDR RemoteAddress,
+	_In_ UCHAR ReportId
+)
+{
+	for (ULONG index = 0; index < BTHPS3_FEATURE_CACHE_MAX_ENTRIES; index++)
+	{
+		const PBTHPS3_FEATURE_CACHE_ENTRY entry = &Cache->Entries[index];
+
+		if (entry->Length != 0
+			&& entry->RemoteAddress == RemoteAddress
+			&& entry->ReportId == ReportId)
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+BOOLEAN
+BthPS3_FeatureCacheLookup(
+	PBTHPS3_FEATURE_CACHE Cache,
+	BTH_ADDR RemoteAddress,
+	UCHAR ReportId,
+	PUCHAR Buffer,
+	ULONG BufferLength,
+	PULONG ReportLength
+)
+{
+	const PBTHPS3_FEATURE_CACHE_ENTRY entry = BthPS3_FeatureCacheFind(Cache, RemoteAddress, ReportId);
+
+	*ReportLength = 0;
+
+	if (entry == NULL || entry->Length > BufferLength)
+	{
+		Cache->Misses++;
+		return FALSE;
+	}
+
+	RtlCopyMemory(Buffer, entry->Report, entry->Length);
+	*ReportLength = entry->Length;
+
+	entry->LastUsed = ++Cache->Clock;
+	Cache->Hits++;
+
+	return TRUE;
+}
+
+BOOLEAN
+BthPS3_FeatureCacheStore(
+	PBTHPS3_FEATURE_CACHE Cache,
+	BTH_ADDR RemoteAddress,
+	const UCHAR* Report,
+	ULONG ReportLength,
+	BOOLEAN IsDirty
+)
+{
+	if (ReportLength < 2
+		|| ReportLength > BTHPS3_FEATURE_CACHE_MAX_REPORT_SIZE
+		|| Report[0] != BTHPS3_FEATURE_CACHE_DATA_HEADER
+		|| !BthPS3_FeatureCacheIsAllowed(Cache, Report[1]))
+	{
+		return FALSE;
+	}
+
+	PBTHPS3_FEATURE_CACHE_ENTRY entry = BthPS3_FeatureCacheFind(Cache, RemoteAddress, Report[1]);
+
+	if (entry != NULL)
+	{
+		//
+		// Calibration and info reports rarely change, skip rewriting them
+		// 
+		if (entry->Length == ReportLength
+			&& RtlEqualMemory(entry->Report, Report, ReportLength))
+		{
+			entry->LastUsed = ++Cache->Clock;
+			return TRUE;
+		}
+	}
+	else
+	{
+		//
+		// Free entry or the least recently used one
+		// 
+		entry = &Cache->Entries[0];
+
+		for (ULONG index = 1; index < BTHPS3_FEATURE_CACHE_MAX_ENTRIES && entry->Length != 0; index++)
+		{
+			const PBTHPS3_FEATURE_CACHE_ENTRY candidate = &Cache->Entries[index];
+
+			if (candidate->Length == 0 || candidate->LastUsed < entry->LastUsed)
+			{
+				entry = candidate;
+			}
+		}
+
+		entry->RemoteAddress = RemoteAddress;
+		entry->ReportId = Report[1];
+	}
+
+	RtlCopyMemory(entry->Report, Report, ReportLength);
+	entry->Length = (USHORT)ReportLength;
+	entry->IsDirty = IsDirty;
+	entry->LastUsed = ++Cache->Clock;
+
+	return TRUE;
+}
+
+BOOLEAN
+BthPS3_FeatureCacheTakeDirty(
+	PBTHPS3_FEATURE_CACHE Cache,
+	BTH_ADDR RemoteAddress,
+	PULONG Cursor,
+	PBTHPS3_FEATURE_CACHE_ENTRY Entry
+)
+{
+	for (; *Cursor < BTHPS3_FEATURE_CACHE_MAX_ENTRIES; (*Cursor)++)
+	{
+		const PBTHPS3_FEATURE_CACHE_ENTRY entry = &Cache->Entries[*Cursor];
+
+		if (entry->Length != 0
+			&& entry->IsDirty
+			&& entry->RemoteAddress == RemoteAddress)
+		{
+			entry->IsDirty = FALSE;
+			RtlCopyMemory(Entry, entry, sizeof(BTHPS3_FEATURE_CACHE_ENTRY));
+			(*Cursor)++;
+
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
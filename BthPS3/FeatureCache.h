@@ -0,0 +1,176 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#pragma once
+
+//
+// Remembers feature reports the device answered GET_REPORT requests with,
+// keyed by remote address and report ID, so reading static reports (device
+// info, calibration) again after a reconnect doesn't need a round trip. Only
+// report IDs put on the allow list are kept, the least recently used entry
+// gets replaced once all are taken. Callers serialize access. Only depends
+// on basic types so the logic can be built and exercised outside the driver.
+// 
+
+#define BTHPS3_FEATURE_CACHE_MAX_ENTRIES        64
+
+//
+// Largest report kept, including the HIDP header
+// 
+#define BTHPS3_FEATURE_CACHE_MAX_REPORT_SIZE    0x80
+
+//
+// HIDP DATA header of a feature report answering GET_REPORT
+// 
+#define BTHPS3_FEATURE_CACHE_DATA_HEADER        0xA3
+
+typedef struct _BTHPS3_FEATURE_CACHE_ENTRY
+{
+	BTH_ADDR RemoteAddress;
+
+	//
+	// Cache clock value of the last store or hit
+	// 
+	ULONG64 LastUsed;
+
+	//
+	// Valid bytes in Report, 0 if the entry is free
+	// 
+	USHORT Length;
+
+	UCHAR ReportId;
+
+	//
+	// Got stored from the radio and isn't persisted yet
+	// 
+	BOOLEAN IsDirty;
+
+	UCHAR Report[BTHPS3_FEATURE_CACHE_MAX_REPORT_SIZE];
+
+} BTHPS3_FEATURE_CACHE_ENTRY, * PBTHPS3_FEATURE_CACHE_ENTRY;
+
+typedef struct _BTHPS3_FEATURE_CACHE
+{
+	//
+	// One bit per report ID
+	// 
+	ULONG AllowList[0x100 / 32];
+
+	ULONG64 Clock;
+
+	ULONG64 Hits;
+
+	ULONG64 Misses;
+
+	BTHPS3_FEATURE_CACHE_ENTRY Entries[BTHPS3_FEATURE_CACHE_MAX_ENTRIES];
+
+} BTHPS3_FEATURE_CACHE, * PBTHPS3_FEATURE_CACHE;
+
+
+//
+// Empties the cache and the allow list
+// 
+VOID
+BthPS3_FeatureCacheInit(
+	_Out_ PBTHPS3_FEATURE_CACHE Cache
+);
+
+VOID
+BthPS3_FeatureCacheAllow(
+	_Inout_ PBTHPS3_FEATURE_CACHE Cache,
+	_In_ UCHAR ReportId
+);
+
+BOOLEAN
+BthPS3_FeatureCacheIsAllowed(
+	_In_ const BTHPS3_FEATURE_CACHE* Cache,
+	_In_ UCHAR ReportId
+);
+
+//
+// Returns TRUE if Request is a HIDP GET_REPORT for a feature report and
+// stores the requested report ID
+// 
+BOOLEAN
+BthPS3_FeatureCacheParseRequest(
+	_In_reads_bytes_(RequestLength) const UCHAR* Request,
+	_In_ ULONG RequestLength,
+	_Out_ PUCHAR ReportId
+);
+
+//
+// Copies the cached report into Buffer, returns FALSE on a miss or if it
+// doesn't fit
+// 
+BOOLEAN
+BthPS3_FeatureCacheLookup(
+	_Inout_ PBTHPS3_FEATURE_CACHE Cache,
+	_In_ BTH_ADDR RemoteAddress,
+	_In_ UCHAR ReportId,
+	_Out_writes_bytes_to_(BufferLength, *ReportLength) PUCHAR Buffer,
+	_In_ ULONG BufferLength,
+	_Out_ PULONG ReportLength
+);
+
+//
+// Keeps a feature report (including the HIDP header) if its ID is on the
+// allow list, returns FALSE if it got ignored. Storing content equal to the
+// cached one doesn't mark the entry dirty.
+// 
+BOOLEAN
+BthPS3_FeatureCacheStore(
+	_Inout_ PBTHPS3_FEATURE_CACHE Cache,
+	_In_ BTH_ADDR RemoteAddress,
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_In_ BOOLEAN IsDirty
+);
+
+//
+// Copies the next dirty entry of RemoteAddress at or after *Cursor into
+// Entry and clears its dirty flag, returns FALSE once none are left.
+// *Cursor should start at 0.
+// 
+BOOLEAN
+BthPS3_FeatureCacheTakeDirty(
+	_Inout_ PBTHPS3_FEATURE_CACHE Cache,
+	_In_ BTH_ADDR RemoteAddress,
+	_Inout_ PULONG Cursor,
+	_Out_ PBTHPS3_FEATURE_CACHE_ENTRY Entry
+);
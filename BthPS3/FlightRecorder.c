@@ -0,0 +1,154 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include "Driver.h"
+#include "FlightRecorder.tmh"
+
+
+//
+// Allocates one zeroed ring per possible processor
+// 
+#pragma code_seg("PAGE")
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_FlightRecorderInitialize(
+	WDFDEVICE Device,
+	PBTHPS3_FLIGHT_RECORDER Recorder
+)
+{
+	NTSTATUS status;
+	WDF_OBJECT_ATTRIBUTES attributes;
+	size_t size;
+	PVOID buffer;
+
+	FuncEntry(TRACE_BTH);
+
+	PAGED_CODE();
+
+	RtlZeroMemory(Recorder, sizeof(BTHPS3_FLIGHT_RECORDER));
+
+	const ULONG ringCount = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+	//
+	// Over-allocate so the first ring can be moved to a cache line boundary
+	// 
+	size = ((size_t)ringCount * sizeof(BTHPS3_FLIGHT_RECORDER_RING)) + SYSTEM_CACHE_ALIGNMENT_SIZE;
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Device;
+
+	if (!NT_SUCCESS(status = WdfMemoryCreate(
+		&attributes,
+		NonPagedPoolNx,
+		POOLTAG_BTHPS3,
+		size,
+		&Recorder->Memory,
+		&buffer
+	)))
+	{
+		TraceError(
+			TRACE_BTH,
+			"WdfMemoryCreate failed with status %!STATUS!",
+			status
+		);
+
+		FuncExit(TRACE_BTH, "status=%!STATUS!", status);
+
+		return status;
+	}
+
+	RtlZeroMemory(buffer, size);
+
+	Recorder->RingCount = ringCount;
+	Recorder->Rings = (PBTHPS3_FLIGHT_RECORDER_RING)ALIGN_UP_POINTER_BY(buffer, SYSTEM_CACHE_ALIGNMENT_SIZE);
+
+	TraceVerbose(
+		TRACE_BTH,
+		"Allocated %d flight recorder rings",
+		ringCount
+	);
+
+	FuncExit(TRACE_BTH, "status=%!STATUS!", status);
+
+	return status;
+}
+#pragma code_seg()
+
+//
+// Copies the newest events of all rings into the output buffer, rings are
+// read without stopping the recorder
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_FlightRecorderDump(
+	PBTHPS3_FLIGHT_RECORDER Recorder,
+	PBTHPS3_GET_FLIGHT_RECORDER Output,
+	size_t OutputBufferSize,
+	size_t* BytesReturned
+)
+{
+	LARGE_INTEGER frequency;
+	ULONG index;
+	const PBTHPS3_FLIGHT_RECORDER_EVENT pEvents = (PBTHPS3_FLIGHT_RECORDER_EVENT)(Output + 1);
+	ULONG capacity = (ULONG)min(
+		(OutputBufferSize - sizeof(BTHPS3_GET_FLIGHT_RECORDER)) / sizeof(BTHPS3_FLIGHT_RECORDER_EVENT),
+		MAXULONG
+	);
+
+	(void)KeQueryPerformanceCounter(&frequency);
+
+	Output->PerformanceFrequency = (ULONG64)frequency.QuadPart;
+	Output->ProcessorCount = Recorder->RingCount;
+	Output->EventCount = 0;
+	Output->LostCount = 0;
+
+	for (index = 0; index < Recorder->RingCount && capacity > 0; index++)
+	{
+		const ULONG copied = BthPS3_FlightRecorderRingSnapshot(
+			&Recorder->Rings[index],
+			&pEvents[Output->EventCount],
+			capacity,
+			&Output->LostCount
+		);
+
+		Output->EventCount += copied;
+		capacity -= copied;
+	}
+
+	*BytesReturned = sizeof(BTHPS3_GET_FLIGHT_RECORDER)
+		+ ((size_t)Output->EventCount * sizeof(BTHPS3_FLIGHT_RECORDER_EVENT));
+}
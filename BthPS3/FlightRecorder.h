@@ -0,0 +1,121 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+#include "FlightRecorderRing.h"
+
+//
+// Always-on binary recorder of hot-path events, one ring per processor
+// 
+typedef struct _BTHPS3_FLIGHT_RECORDER
+{
+	//
+	// Memory object backing the rings (parented to the device)
+	// 
+	WDFMEMORY Memory;
+
+	//
+	// Cache-aligned array of rings, one per processor
+	// 
+	PBTHPS3_FLIGHT_RECORDER_RING Rings;
+
+	//
+	// Number of elements in Rings
+	// 
+	ULONG RingCount;
+
+} BTHPS3_FLIGHT_RECORDER, * PBTHPS3_FLIGHT_RECORDER;
+
+
+_Must_inspect_result_
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3_FlightRecorderInitialize(
+	_In_ WDFDEVICE Device,
+	_Out_ PBTHPS3_FLIGHT_RECORDER Recorder
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3_FlightRecorderDump(
+	_In_ PBTHPS3_FLIGHT_RECORDER Recorder,
+	_Out_writes_bytes_to_(OutputBufferSize, *BytesReturned) PBTHPS3_GET_FLIGHT_RECORDER Output,
+	_In_ size_t OutputBufferSize,
+	_Out_ size_t* BytesReturned
+);
+
+//
+// Records an event in the current processor's ring
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+FORCEINLINE
+VOID
+BthPS3_FlightRecorderRecord(
+	_In_ PBTHPS3_FLIGHT_RECORDER Recorder,
+	_In_ UCHAR Type,
+	_In_ UCHAR Detail,
+	_In_ ULONG Slot,
+	_In_ ULONG64 Argument
+)
+{
+	KIRQL oldIrql;
+
+	if (Recorder->Rings == NULL)
+	{
+		return;
+	}
+
+	//
+	// Raise so we stay the only writer of this processor's ring
+	// 
+	KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+	{
+		const ULONG index = KeGetCurrentProcessorNumberEx(NULL);
+
+		BthPS3_FlightRecorderRingWrite(
+			&Recorder->Rings[min(index, Recorder->RingCount - 1)],
+			(ULONG64)KeQueryPerformanceCounter(NULL).QuadPart,
+			index,
+			Type,
+			Detail,
+			(USHORT)Slot,
+			Argument
+		);
+	}
+	KeLowerIrql(oldIrql);
+}
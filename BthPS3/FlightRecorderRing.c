@@ -0,0 +1,104 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "FlightRecorderRing.h"
+#else
+#include "Driver.h"
+#endif
+
+
+_Use_decl_annotations_
+ULONG
+BthPS3_FlightRecorderRingSnapshot(
+	const BTHPS3_FLIGHT_RECORDER_RING* Ring,
+	PBTHPS3_FLIGHT_RECORDER_EVENT Events,
+	ULONG MaxEvents,
+	PULONG64 LostCount
+)
+{
+	const LONG64 before = ReadAcquire64((volatile LONG64*)&Ring->Head);
+	LONG64 available = min(before, (LONG64)BTHPS3_FLIGHT_RECORDER_RING_EVENTS);
+	LONG64 first, index;
+	ULONG count = 0;
+
+	//
+	// Everything older than the ring capacity is gone already
+	// 
+	*LostCount += (ULONG64)(before - available);
+
+	if (available > (LONG64)MaxEvents)
+	{
+		available = MaxEvents;
+	}
+
+	first = before - available;
+
+	for (index = first; index < before; index++)
+	{
+		Events[index - first] = Ring->Events[index & (BTHPS3_FLIGHT_RECORDER_RING_EVENTS - 1)];
+	}
+
+	//
+	// Order the copy before re-reading the head
+	// 
+	MemoryBarrier();
+
+	//
+	// The owner may have lapped the oldest copied events meanwhile, the one
+	// it's currently writing to counts as overwritten too
+	// 
+	const LONG64 after = ReadAcquire64((volatile LONG64*)&Ring->Head);
+	const LONG64 oldestIntact = after + 1 - BTHPS3_FLIGHT_RECORDER_RING_EVENTS;
+
+	if (oldestIntact > first)
+	{
+		const LONG64 torn = min(oldestIntact, before) - first;
+
+		*LostCount += (ULONG64)torn;
+
+		for (index = first + torn; index < before; index++)
+		{
+			Events[count++] = Events[index - first];
+		}
+
+		return count;
+	}
+
+	return (ULONG)available;
+}
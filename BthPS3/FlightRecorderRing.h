@@ -0,0 +1,98 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// One processor's ring of the flight recorder. Only the owning processor
+// writes to it (at DISPATCH_LEVEL), so recording needs no interlocked operation.
+// 
+typedef struct DECLSPEC_CACHEALIGN _BTHPS3_FLIGHT_RECORDER_RING
+{
+	//
+	// Number of events ever written, the next one goes to Head modulo ring size
+	// 
+	volatile LONG64 Head;
+
+	BTHPS3_FLIGHT_RECORDER_EVENT Events[BTHPS3_FLIGHT_RECORDER_RING_EVENTS];
+
+} BTHPS3_FLIGHT_RECORDER_RING, * PBTHPS3_FLIGHT_RECORDER_RING;
+
+
+//
+// Stores an event in the ring. Has no dependencies on the framework so it
+// can be built and exercised outside the driver.
+// 
+FORCEINLINE
+VOID
+BthPS3_FlightRecorderRingWrite(
+	_Inout_ PBTHPS3_FLIGHT_RECORDER_RING Ring,
+	_In_ ULONG64 Timestamp,
+	_In_ ULONG Processor,
+	_In_ UCHAR Type,
+	_In_ UCHAR Detail,
+	_In_ USHORT Slot,
+	_In_ ULONG64 Argument
+)
+{
+	const LONG64 head = Ring->Head;
+	const PBTHPS3_FLIGHT_RECORDER_EVENT pEvent = &Ring->Events[head & (BTHPS3_FLIGHT_RECORDER_RING_EVENTS - 1)];
+
+	pEvent->Timestamp = Timestamp;
+	pEvent->Argument = Argument;
+	pEvent->Slot = Slot;
+	pEvent->Type = Type;
+	pEvent->Detail = Detail;
+	pEvent->Processor = Processor;
+
+	//
+	// Publish only after the event is complete
+	// 
+	WriteRelease64((volatile LONG64*)&Ring->Head, head + 1);
+}
+
+//
+// Copies up to MaxEvents of the newest events out of the ring, oldest first.
+// Events the owner overwrote while copying are discarded and counted as lost.
+// 
+ULONG
+BthPS3_FlightRecorderRingSnapshot(
+	_In_ const BTHPS3_FLIGHT_RECORDER_RING* Ring,
+	_Out_writes_to_(MaxEvents, return) PBTHPS3_FLIGHT_RECORDER_EVENT Events,
+	_In_ ULONG MaxEvents,
+	_Inout_ PULONG64 LostCount
+);
@@ -0,0 +1,185 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "IdlePolicy.h"
+#else
+#include "Driver.h"
+#endif
+
+
+static ULONG
+BthPS3_IdlePolicyBucket(
+	_In_ ULONG64 GapMs
+)
+{
+	ULONG bucket = 0;
+
+	while (GapMs > 1 && bucket < BTHPS3_IDLE_POLICY_BUCKETS - 1)
+	{
+		GapMs >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+static ULONG
+BthPS3_IdlePolicyClamp(
+	_In_ const BTHPS3_IDLE_POLICY* Policy,
+	_In_ ULONG64 Timeout
+)
+{
+	if (Timeout < Policy->MinimumTimeout)
+	{
+		return Policy->MinimumTimeout;
+	}
+
+	if (Timeout > Policy->MaximumTimeout)
+	{
+		return Policy->MaximumTimeout;
+	}
+
+	return (ULONG)Timeout;
+}
+
+_Use_decl_annotations_
+VOID
+BthPS3_IdlePolicyInit(
+	PBTHPS3_IDLE_POLICY Policy,
+	ULONG InitialTimeout,
+	ULONG MinimumTimeout,
+	ULONG MaximumTimeout
+)
+{
+	RtlZeroMemory(Policy, sizeof(BTHPS3_IDLE_POLICY));
+
+	if (MinimumTimeout > MaximumTimeout)
+	{
+		MinimumTimeout = MaximumTimeout;
+	}
+
+	Policy->MinimumTimeout = MinimumTimeout;
+	Policy->MaximumTimeout = MaximumTimeout;
+	Policy->Timeout = BthPS3_IdlePolicyClamp(Policy, InitialTimeout);
+}
+
+_Use_decl_annotations_
+BOOLEAN
+BthPS3_IdlePolicyAddGap(
+	PBTHPS3_IDLE_POLICY Policy,
+	ULONG64 GapMs
+)
+{
+	ULONG index;
+	ULONG total = 0;
+	ULONG bridgeable = 0;
+	ULONG covered = 0;
+	ULONG timeout;
+
+	if (Policy->MinimumTimeout == Policy->MaximumTimeout || GapMs < BTHPS3_IDLE_POLICY_MIN_GAP_MS)
+	{
+		return FALSE;
+	}
+
+	Policy->Histogram[BthPS3_IdlePolicyBucket(GapMs)]++;
+
+	if (++Policy->SamplesSinceDecay >= BTHPS3_IDLE_POLICY_DECAY_INTERVAL)
+	{
+		for (index = 0; index < BTHPS3_IDLE_POLICY_BUCKETS; index++)
+		{
+			Policy->Histogram[index] >>= 1;
+		}
+
+		Policy->SamplesSinceDecay = 0;
+	}
+
+	//
+	// Gaps starting beyond the maximum will power down regardless of the
+	// timeout, only the remaining ones can be bridged by staying in D0
+	// 
+	for (index = 0; index < BTHPS3_IDLE_POLICY_BUCKETS; index++)
+	{
+		total += Policy->Histogram[index];
+
+		if ((1ULL << index) < Policy->MaximumTimeout)
+		{
+			bridgeable += Policy->Histogram[index];
+		}
+	}
+
+	if (total < BTHPS3_IDLE_POLICY_MIN_SAMPLES)
+	{
+		return FALSE;
+	}
+
+	if (bridgeable * 2 < total)
+	{
+		//
+		// Mostly long pauses, waiting longer only costs power
+		// 
+		timeout = Policy->MinimumTimeout;
+	}
+	else
+	{
+		timeout = Policy->MaximumTimeout;
+
+		for (index = 0; index < BTHPS3_IDLE_POLICY_BUCKETS; index++)
+		{
+			covered += Policy->Histogram[index];
+
+			if ((ULONG64)covered * 100 >= (ULONG64)bridgeable * BTHPS3_IDLE_POLICY_COVERAGE_PERCENT)
+			{
+				//
+				// Upper edge of the bucket so its gaps are outlasted as well
+				// 
+				timeout = BthPS3_IdlePolicyClamp(Policy, 2ULL << index);
+				break;
+			}
+		}
+	}
+
+	if (timeout == Policy->Timeout)
+	{
+		return FALSE;
+	}
+
+	Policy->Timeout = timeout;
+
+	return TRUE;
+}
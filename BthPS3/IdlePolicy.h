@@ -0,0 +1,111 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// Adaptive child idle timeout. The pauses between I/O bursts of a PDO are
+// collected in a decaying histogram with power-of-two millisecond buckets
+// and the timeout is chosen to outlast most of the pauses that are short
+// enough to be bridged at all. Only depends on basic types so the policy can
+// be built and exercised outside the driver.
+// 
+
+//
+// Gaps shorter than this belong to the same burst of activity
+// 
+#define BTHPS3_IDLE_POLICY_MIN_GAP_MS           256
+
+//
+// Bucket i holds gaps of [2^i, 2^(i+1)) milliseconds, the last one anything longer
+// 
+#define BTHPS3_IDLE_POLICY_BUCKETS              18
+
+//
+// All buckets get halved after this many gaps so old behaviour fades out
+// 
+#define BTHPS3_IDLE_POLICY_DECAY_INTERVAL       32
+
+//
+// Gaps required before the timeout gets adjusted for the first time
+// 
+#define BTHPS3_IDLE_POLICY_MIN_SAMPLES          8
+
+//
+// Percentage of bridgeable gaps the timeout should outlast
+// 
+#define BTHPS3_IDLE_POLICY_COVERAGE_PERCENT     90
+
+typedef struct _BTHPS3_IDLE_POLICY
+{
+	//
+	// Configured bounds, adaptation is off if they are equal
+	// 
+	ULONG MinimumTimeout;
+	ULONG MaximumTimeout;
+
+	//
+	// Timeout currently in effect
+	// 
+	ULONG Timeout;
+
+	//
+	// Gaps since the last decay
+	// 
+	ULONG SamplesSinceDecay;
+
+	ULONG Histogram[BTHPS3_IDLE_POLICY_BUCKETS];
+
+} BTHPS3_IDLE_POLICY, * PBTHPS3_IDLE_POLICY;
+
+
+VOID
+BthPS3_IdlePolicyInit(
+	_Out_ PBTHPS3_IDLE_POLICY Policy,
+	_In_ ULONG InitialTimeout,
+	_In_ ULONG MinimumTimeout,
+	_In_ ULONG MaximumTimeout
+);
+
+//
+// Feeds the gap between two bursts, returns TRUE if Policy->Timeout changed
+// 
+BOOLEAN
+BthPS3_IdlePolicyAddGap(
+	_Inout_ PBTHPS3_IDLE_POLICY Policy,
+	_In_ ULONG64 GapMs
+);
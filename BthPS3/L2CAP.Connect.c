@@ -39,6 +39,77 @@
 #include "L2CAP.Connect.tmh"
 #include "BthPS3ETW.h"
 
+//
+// Suspends patching until the filter observed the next connection attempt
+// of RemoteAddress, falls back to disabling it
+// 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+static
+VOID
+L2CAP_PS3_SuspendPatchFor(
+    _In_ PBTHPS3_SERVER_CONTEXT DevCtx,
+    _In_ BTH_ADDR RemoteAddress
+)
+{
+    NTSTATUS status;
+
+    if (!NT_SUCCESS(status = BthPS3PSM_SuspendPatchSync(
+        DevCtx->PsmFilter.IoTarget,
+        0,
+        RemoteAddress
+    )))
+    {
+        TraceVerbose(
+            TRACE_L2CAP,
+            "BthPS3PSM_SuspendPatchSync failed with status %!STATUS!, disabling instead",
+            status
+        );
+
+        status = BthPS3PSM_DisablePatchSync(
+            DevCtx->PsmFilter.IoTarget,
+            0
+        );
+    }
+
+    if (!NT_SUCCESS(status))
+    {
+        TraceError(
+            TRACE_L2CAP,
+            "BthPS3PSM_DisablePatchSync failed with status %!STATUS!",
+            status
+        );
+
+        return;
+    }
+
+    TraceInformation(
+        TRACE_L2CAP,
+        "Filter disabled"
+    );
+
+    EventWriteAutoDisableFilter(NULL);
+
+    //
+    // Fire off re-enable timer, only a fallback in case the
+    // filter never gets to observe the device's next attempt
+    // 
+    if (DevCtx->Settings.AutoEnableFilter)
+    {
+        TraceInformation(
+            TRACE_L2CAP,
+            "Filter disabled, re-enabling in %d seconds",
+            DevCtx->Settings.AutoEnableFilterDelay
+        );
+
+        EventWriteAutoEnableFilter(NULL, DevCtx->Settings.AutoEnableFilterDelay);
+
+        (void)WdfTimerStart(
+            DevCtx->PsmFilter.AutoResetTimer,
+            WDF_REL_TIMEOUT_IN_SEC(DevCtx->Settings.AutoEnableFilterDelay)
+        );
+    }
+}
+
  //
  // Incoming connection request, prepare and send response
  // 
@@ -57,10 +128,48 @@ L2CAP_PS3_HandleRemoteConnect(
     WDFREQUEST brbAsyncRequest = NULL;
     CHAR remoteName[BTH_MAX_NAME_SIZE];
     DS_DEVICE_TYPE deviceType = DS_DEVICE_TYPE_UNKNOWN;
+    LONG links;
 
 
     FuncEntry(TRACE_L2CAP);
 
+    BthPS3_FlightRecorderRecord(
+        &DevCtx->Header.FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_CONNECT_STAGE,
+        BTHPS3_FLIGHT_RECORDER_CONNECT_INDICATED,
+        0,
+        ConnectParams->BtAddress
+    );
+
+    //
+    // Retry of a device recently found unsupported, drop it before
+    // touching the registry or querying the radio for its name
+    // 
+    if (DevCtx->Settings.RejectedDeviceCacheTimeout != 0
+        && BthPS3_RejectCacheContains(
+            &DevCtx->RejectedDevices.Cache,
+            ConnectParams->BtAddress,
+            KeQueryInterruptTime()
+        ))
+    {
+        TraceVerbose(
+            TRACE_L2CAP,
+            "Device %012llX recently denied, dropping connection",
+            ConnectParams->BtAddress
+        );
+
+        //
+        // Arrived patched, so the suspension from its last attempt got used
+        // up already. Without a new one it'd never reach the native stack.
+        // 
+        if (DevCtx->Settings.AutoDisableFilter)
+        {
+            L2CAP_PS3_SuspendPatchFor(DevCtx, ConnectParams->BtAddress);
+        }
+
+        return L2CAP_PS3_DenyRemoteConnect(DevCtx, ConnectParams);
+    }
+
     //
     // (Try to) refresh settings from registry
     // 
@@ -80,6 +189,31 @@ L2CAP_PS3_HandleRemoteConnect(
     // 
     if (status == STATUS_NOT_FOUND)
     {
+        //
+        // Reserve the link up front so concurrent connections can't all
+        // take the last one, the PDO created takes it over
+        // 
+        links = InterlockedIncrement(&DevCtx->Header.ActiveLinks);
+
+        //
+        // Radio already serves as many controllers as configured, not
+        // counting the link just reserved
+        // 
+        if (BTHPS3_RADIO_IS_FULL((ULONG)links - 1, DevCtx->Settings.MaxControllersPerRadio))
+        {
+            InterlockedDecrement(&DevCtx->Header.ActiveLinks);
+
+            TraceInformation(
+                TRACE_L2CAP,
+                "Radio at its limit of %d controllers, dropping connection",
+                DevCtx->Settings.MaxControllersPerRadio
+            );
+
+            InterlockedIncrement64(&DevCtx->DeniedConnections);
+
+            return L2CAP_PS3_DenyRemoteConnect(DevCtx, ConnectParams);
+        }
+
         RtlZeroMemory(remoteName, BTH_MAX_NAME_SIZE);
 
         //
@@ -110,6 +244,8 @@ L2CAP_PS3_HandleRemoteConnect(
 
             EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"BthPS3_GetDeviceName", status);
 
+            InterlockedDecrement(&DevCtx->Header.ActiveLinks);
+
             //
             // Name couldn't be resolved, drop connection
             // 
@@ -212,51 +348,33 @@ L2CAP_PS3_HandleRemoteConnect(
             EventWriteRemoteDeviceNotIdentified(NULL, ConnectParams->BtAddress);
 
             //
-            // Filter re-routed potentially unsupported device, disable
+            // Name is known and matched nothing, spare further attempts the
+            // lookup. Names not resolved yet may still match later.
+            // 
+            if (DevCtx->Settings.RejectedDeviceCacheTimeout != 0 && remoteName[0] != '\0')
+            {
+                WdfSpinLockAcquire(DevCtx->RejectedDevices.Lock);
+
+                BthPS3_RejectCacheInsert(
+                    &DevCtx->RejectedDevices.Cache,
+                    ConnectParams->BtAddress,
+                    KeQueryInterruptTime() + DevCtx->Settings.RejectedDeviceCacheTimeout * (ULONG64)WDF_TIMEOUT_TO_SEC
+                );
+
+                WdfSpinLockRelease(DevCtx->RejectedDevices.Lock);
+            }
+
+            //
+            // Filter re-routed potentially unsupported device, suspend patching
+            // until the filter observed the device's next connection attempt
             // 
             if (DevCtx->Settings.AutoDisableFilter)
             {
-                if (!NT_SUCCESS(status = BthPS3PSM_DisablePatchSync(
-                    DevCtx->PsmFilter.IoTarget,
-                    0
-                )))
-                {
-                    TraceError(
-                        TRACE_L2CAP,
-                        "BthPS3PSM_DisablePatchSync failed with status %!STATUS!",
-                        status
-                    );
-                }
-                else
-                {
-                    TraceInformation(
-                        TRACE_L2CAP,
-                        "Filter disabled"
-                    );
-
-                    EventWriteAutoDisableFilter(NULL);
-
-                    //
-                    // Fire off re-enable timer
-                    // 
-                    if (DevCtx->Settings.AutoEnableFilter)
-                    {
-                        TraceInformation(
-                            TRACE_L2CAP,
-                            "Filter disabled, re-enabling in %d seconds",
-                            DevCtx->Settings.AutoEnableFilterDelay
-                        );
-
-                        EventWriteAutoEnableFilter(NULL, DevCtx->Settings.AutoEnableFilterDelay);
-
-                        (void)WdfTimerStart(
-                            DevCtx->PsmFilter.AutoResetTimer,
-                            WDF_REL_TIMEOUT_IN_SEC(DevCtx->Settings.AutoEnableFilterDelay)
-                        );
-                    }
-                }
+                L2CAP_PS3_SuspendPatchFor(DevCtx, ConnectParams->BtAddress);
             }
 
+            InterlockedDecrement(&DevCtx->Header.ActiveLinks);
+
             //
             // Unsupported device, drop connection
             // 
@@ -281,6 +399,19 @@ L2CAP_PS3_HandleRemoteConnect(
             );
             goto exit;
         }
+
+        BthPS3_FlightRecorderRecord(
+            &DevCtx->Header.FlightRecorder,
+            BTHPS3_FLIGHT_RECORDER_CONNECT_STAGE,
+            BTHPS3_FLIGHT_RECORDER_CONNECT_PDO_CREATED,
+            pPdoCtx->SerialNumber,
+            ConnectParams->BtAddress
+        );
+
+        //
+        // The new remote got its slot cached, add it to the filter allow-list
+        // 
+        (void)BthPS3PSM_RefreshAddressFilterSync(DevCtx);
     }
 
     if (pPdoCtx == NULL)
@@ -383,6 +514,16 @@ L2CAP_PS3_HandleRemoteConnect(
             status
         );
     }
+    else
+    {
+        BthPS3_FlightRecorderRecord(
+            &DevCtx->Header.FlightRecorder,
+            BTHPS3_FLIGHT_RECORDER_CONNECT_STAGE,
+            BTHPS3_FLIGHT_RECORDER_CONNECT_ACCEPTED,
+            pPdoCtx->SerialNumber,
+            ConnectParams->BtAddress
+        );
+    }
 
 exit:
 
@@ -56,6 +56,14 @@ L2CAP_PS3_HandleRemoteDisconnect(
 
 	pDevCtx = GetServerDeviceContext(pPdoCtx->DevCtxHdr->Device);
 
+	BthPS3_FlightRecorderRecord(
+		&pPdoCtx->DevCtxHdr->FlightRecorder,
+		BTHPS3_FLIGHT_RECORDER_DISCONNECT_STAGE,
+		BTHPS3_FLIGHT_RECORDER_DISCONNECT_INDICATED,
+		pPdoCtx->SerialNumber,
+		pPdoCtx->RemoteAddress
+	);
+
 	//
 	// HID Control Channel disconnected
 	// 
@@ -95,8 +103,10 @@ L2CAP_PS3_HandleRemoteDisconnect(
 	//
 	// Both channels are gone, invoke clean-up
 	// 
-	if (pPdoCtx->HidControlChannel.ConnectionState == ConnectionStateDisconnected
-		&& pPdoCtx->HidInterruptChannel.ConnectionState == ConnectionStateDisconnected)
+	if (BthPS3_ConnectionStateBothDisconnected(
+		pPdoCtx->HidControlChannel.ConnectionState,
+		pPdoCtx->HidInterruptChannel.ConnectionState
+	))
 	{
 		TraceVerbose(
 			TRACE_L2CAP,
@@ -274,22 +284,23 @@ L2CAP_PS3_RemoteDisconnect(
 )
 {
 	struct _BRB_L2CA_CLOSE_CHANNEL* disconnectBrb = NULL;
+	BTHPS3_DISCONNECT_ACTION action;
 
 	FuncEntry(TRACE_L2CAP);
 
 	WdfSpinLockAcquire(Channel->ConnectionStateLock);
 
-	if (Channel->ConnectionState == ConnectionStateConnecting)
+	action = BthPS3_ConnectionStateDisconnect(&Channel->ConnectionState);
+
+	if (action == BthPS3DisconnectActionDeferred)
 	{
 		//
-		// If the connection is not completed yet set the state 
-		// to disconnecting.
+		// If the connection is not completed yet the state is now 
+		// disconnecting.
 		// In such case we should send CLOSE_CHANNEL Brb down after 
 		// we receive connect completion.
 		//
 
-		Channel->ConnectionState = ConnectionStateDisconnecting;
-
 		//
 		// Clear event to indicate that we are in disconnecting
 		// state. It will be set when disconnect is completed
@@ -300,20 +311,18 @@ L2CAP_PS3_RemoteDisconnect(
 		return TRUE;
 	}
 
-	if (Channel->ConnectionState != ConnectionStateConnected)
+	WdfSpinLockRelease(Channel->ConnectionStateLock);
+
+	if (action == BthPS3DisconnectActionNone)
 	{
 		//
 		// Do nothing if we are not connected
 		//
 
-		WdfSpinLockRelease(Channel->ConnectionStateLock);
 		FuncExit(TRACE_L2CAP, "returns=FALSE");
 		return FALSE;
 	}
 
-	Channel->ConnectionState = ConnectionStateDisconnecting;
-	WdfSpinLockRelease(Channel->ConnectionStateLock);
-
 	//
 	// We are now sending the disconnect, so clear the event.
 	//
@@ -331,6 +340,14 @@ L2CAP_PS3_RemoteDisconnect(
 	disconnectBrb->BtAddress = RemoteAddress;
 	disconnectBrb->ChannelHandle = Channel->ChannelHandle;
 
+	BthPS3_FlightRecorderRecord(
+		&CtxHdr->FlightRecorder,
+		BTHPS3_FLIGHT_RECORDER_DISCONNECT_STAGE,
+		BTHPS3_FLIGHT_RECORDER_DISCONNECT_CHANNEL_CLOSE,
+		0,
+		RemoteAddress
+	);
+
 	//
 	// The BRB can fail with STATUS_DEVICE_DISCONNECT if the device is already
 	// disconnected, hence we don't assert for success
@@ -368,7 +385,7 @@ L2CAP_PS3_ChannelDisconnectCompleted(
 	FuncEntryArguments(TRACE_L2CAP, "status=%!STATUS!", Params->IoStatus.Status);
 
 	WdfSpinLockAcquire(channel->ConnectionStateLock);
-	channel->ConnectionState = ConnectionStateDisconnected;
+	BthPS3_ConnectionStateDisconnectCompleted(&channel->ConnectionState);
 	WdfSpinLockRelease(channel->ConnectionStateLock);
 
 	//
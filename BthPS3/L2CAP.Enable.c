@@ -0,0 +1,273 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include "Driver.h"
+#include "L2CAP.Enable.tmh"
+
+
+#pragma region SIXAXIS report enable
+
+//
+// HIDP SET_REPORT (Feature) 0xF4, a SIXAXIS stays silent until it got this
+// 
+static const UCHAR G_SixaxisEnableCommand[] = { 0x53, 0xF4, 0x42, 0x03, 0x00, 0x00 };
+
+//
+// Captured at submit time, the child might be gone before completion so
+// the exchange must not touch its context
+// 
+typedef struct _BTHPS3_SIXAXIS_ENABLE_CONTEXT
+{
+	PBTHPS3_DEVICE_CONTEXT_HEADER DevCtxHdr;
+
+	BTH_ADDR RemoteAddress;
+
+	L2CAP_CHANNEL_HANDLE ChannelHandle;
+
+	//
+	// Carries the command, then the HANDSHAKE reply
+	// 
+	UCHAR Buffer[sizeof(G_SixaxisEnableCommand)];
+
+} BTHPS3_SIXAXIS_ENABLE_CONTEXT, * PBTHPS3_SIXAXIS_ENABLE_CONTEXT;
+
+WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(BTHPS3_SIXAXIS_ENABLE_CONTEXT, GetSixaxisEnableContext)
+
+//
+// Submits one control channel transfer of the report enable exchange
+// 
+static
+NTSTATUS
+L2CAP_PS3_SixaxisEnableTransfer(
+	_In_ WDFREQUEST Request,
+	_In_ ULONG TransferFlags,
+	_In_ PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
+)
+{
+	NTSTATUS status;
+	const PBTHPS3_SIXAXIS_ENABLE_CONTEXT pCtx = GetSixaxisEnableContext(Request);
+	struct _BRB_L2CA_ACL_TRANSFER* brb = (struct _BRB_L2CA_ACL_TRANSFER*)
+		pCtx->DevCtxHdr->ProfileDrvInterface.BthAllocateBrb(
+			BRB_L2CA_ACL_TRANSFER,
+			POOLTAG_BTHPS3
+		);
+
+	if (brb == NULL)
+	{
+		return STATUS_INSUFFICIENT_RESOURCES;
+	}
+
+	brb->Hdr.ClientContext[0] = pCtx->DevCtxHdr;
+
+	brb->BtAddress = pCtx->RemoteAddress;
+	brb->ChannelHandle = pCtx->ChannelHandle;
+	brb->TransferFlags = TransferFlags;
+	brb->BufferMDL = NULL;
+	brb->Buffer = pCtx->Buffer;
+	brb->BufferSize = sizeof(pCtx->Buffer);
+
+	if (!NT_SUCCESS(status = BthPS3_SendBrbAsync(
+		pCtx->DevCtxHdr->IoTarget,
+		Request,
+		(PBRB)brb,
+		sizeof(*brb),
+		CompletionRoutine,
+		brb
+	)))
+	{
+		TraceError(
+			TRACE_L2CAP,
+			"BthPS3_SendBrbAsync failed with status %!STATUS!",
+			status
+		);
+
+		pCtx->DevCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
+	}
+
+	return status;
+}
+
+//
+// Sends the report enable command on the control channel, the reply gets
+// consumed so it doesn't end up in the function driver's first control read
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTSTATUS
+L2CAP_PS3_SendSixaxisEnable(
+	_In_ PBTHPS3_PDO_CONTEXT ClientConnection
+)
+{
+	NTSTATUS status;
+	WDF_OBJECT_ATTRIBUTES attributes;
+	WDFREQUEST request = NULL;
+	PBTHPS3_SIXAXIS_ENABLE_CONTEXT pCtx;
+
+	FuncEntry(TRACE_L2CAP);
+
+	do
+	{
+		//
+		// Parented to the radio as the child might be gone before completion
+		// 
+		WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, BTHPS3_SIXAXIS_ENABLE_CONTEXT);
+		attributes.ParentObject = ClientConnection->DevCtxHdr->Device;
+
+		if (!NT_SUCCESS(status = WdfRequestCreate(
+			&attributes,
+			ClientConnection->DevCtxHdr->IoTarget,
+			&request
+		)))
+		{
+			TraceError(
+				TRACE_L2CAP,
+				"WdfRequestCreate failed with status %!STATUS!",
+				status
+			);
+			break;
+		}
+
+		pCtx = GetSixaxisEnableContext(request);
+		pCtx->DevCtxHdr = ClientConnection->DevCtxHdr;
+		pCtx->RemoteAddress = ClientConnection->RemoteAddress;
+		pCtx->ChannelHandle = ClientConnection->HidControlChannel.ChannelHandle;
+		RtlCopyMemory(pCtx->Buffer, G_SixaxisEnableCommand, sizeof(G_SixaxisEnableCommand));
+
+		if (!NT_SUCCESS(status = L2CAP_PS3_SixaxisEnableTransfer(
+			request,
+			ACL_TRANSFER_DIRECTION_OUT,
+			L2CAP_PS3_SixaxisEnableSendCompleted
+		)))
+		{
+			break;
+		}
+
+	} while (FALSE);
+
+	if (!NT_SUCCESS(status) && request)
+	{
+		WdfObjectDelete(request);
+	}
+
+	FuncExit(TRACE_L2CAP, "status=%!STATUS!", status);
+
+	return status;
+}
+
+//
+// Report enable command got sent, fetch the HANDSHAKE reply
+// 
+void
+L2CAP_PS3_SixaxisEnableSendCompleted(
+	_In_ WDFREQUEST Request,
+	_In_ WDFIOTARGET Target,
+	_In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+	_In_ WDFCONTEXT Context
+)
+{
+	NTSTATUS status = Params->IoStatus.Status;
+	struct _BRB_L2CA_ACL_TRANSFER* brb =
+		(struct _BRB_L2CA_ACL_TRANSFER*)Context;
+	const PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
+		(PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+
+	UNREFERENCED_PARAMETER(Target);
+
+	FuncEntryArguments(TRACE_L2CAP, "status=%!STATUS!", status);
+
+	deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
+
+	if (NT_SUCCESS(status))
+	{
+		CLIENT_CONNECTION_REQUEST_REUSE(Request);
+
+		status = L2CAP_PS3_SixaxisEnableTransfer(
+			Request,
+			ACL_TRANSFER_DIRECTION_IN | ACL_SHORT_TRANSFER_OK,
+			L2CAP_PS3_SixaxisEnableHandshakeCompleted
+		);
+	}
+
+	if (!NT_SUCCESS(status))
+	{
+		TraceError(
+			TRACE_L2CAP,
+			"SIXAXIS report enable failed with status %!STATUS!",
+			status
+		);
+
+		WdfObjectDelete(Request);
+	}
+
+	FuncExitNoReturn(TRACE_L2CAP);
+}
+
+//
+// HANDSHAKE reply to the report enable command arrived
+// 
+void
+L2CAP_PS3_SixaxisEnableHandshakeCompleted(
+	_In_ WDFREQUEST Request,
+	_In_ WDFIOTARGET Target,
+	_In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+	_In_ WDFCONTEXT Context
+)
+{
+	struct _BRB_L2CA_ACL_TRANSFER* brb =
+		(struct _BRB_L2CA_ACL_TRANSFER*)Context;
+	const PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
+		(PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+
+	UNREFERENCED_PARAMETER(Target);
+
+	FuncEntryArguments(TRACE_L2CAP, "status=%!STATUS!", Params->IoStatus.Status);
+
+	if (NT_SUCCESS(Params->IoStatus.Status) && brb->BufferSize > 0)
+	{
+		TraceInformation(
+			TRACE_L2CAP,
+			"SIXAXIS report enable acknowledged with 0x%02X",
+			((PUCHAR)brb->Buffer)[0]
+		);
+	}
+
+	deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
+	WdfObjectDelete(Request);
+
+	FuncExitNoReturn(TRACE_L2CAP);
+}
+
+#pragma endregion
@@ -39,6 +39,24 @@
 #include "L2CAP.Transfer.tmh"
 
 
+//
+// Input reports of all device types including the HIDP header fit into this
+// 
+#define DECODED_READ_REPORT_BUFFER_SIZE 0x100
+
+//
+// Owned by a read request decoded in the driver, the report lands in here
+// first and the result gets written to Output (the request's buffer)
+// 
+typedef struct _BTHPS3_DECODED_READ
+{
+    PVOID Output;
+
+    UCHAR Report[DECODED_READ_REPORT_BUFFER_SIZE];
+
+} BTHPS3_DECODED_READ, * PBTHPS3_DECODED_READ;
+
+
 //
 // Submits an outgoing control request
 // 
@@ -48,6 +66,7 @@ L2CAP_PS3_SendControlTransferAsync(
     PBTHPS3_PDO_CONTEXT ClientConnection,
     WDFREQUEST Request,
     PVOID Buffer,
+    PMDL BufferMDL,
     size_t BufferLength,
     PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
 )
@@ -74,16 +93,30 @@ L2CAP_PS3_SendControlTransferAsync(
     // 
     brb->Hdr.ClientContext[0] = ClientConnection->DevCtxHdr;
 
+    //
+    // Used in completion routine to attribute activity to the PDO, stays
+    // valid as the request is owned by one of its queues
+    // 
+    brb->Hdr.ClientContext[1] = ClientConnection;
+
     //
     // Set channel properties
     // 
     brb->BtAddress = ClientConnection->RemoteAddress;
     brb->ChannelHandle = ClientConnection->HidControlChannel.ChannelHandle;
     brb->TransferFlags = ACL_TRANSFER_DIRECTION_OUT;
-    brb->BufferMDL = NULL;
-    brb->Buffer = Buffer;
+    brb->BufferMDL = BufferMDL;
+    brb->Buffer = (BufferMDL != NULL) ? NULL : Buffer;
     brb->BufferSize = (ULONG)BufferLength;
 
+    BthPS3_FlightRecorderRecord(
+        &ClientConnection->DevCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_SUBMIT,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_WRITE,
+        ClientConnection->SerialNumber,
+        BufferLength
+    );
+
     //
     // Submit request
     // 
@@ -119,6 +152,7 @@ L2CAP_PS3_ReadControlTransferAsync(
     PBTHPS3_PDO_CONTEXT ClientConnection,
     WDFREQUEST Request,
     PVOID Buffer,
+    PMDL BufferMDL,
     size_t BufferLength,
     PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
 )
@@ -145,16 +179,30 @@ L2CAP_PS3_ReadControlTransferAsync(
     // 
     brb->Hdr.ClientContext[0] = ClientConnection->DevCtxHdr;
 
+    //
+    // Used in completion routine to attribute activity to the PDO, stays
+    // valid as the request is owned by one of its queues
+    // 
+    brb->Hdr.ClientContext[1] = ClientConnection;
+
     //
     // Set channel properties
     // 
     brb->BtAddress = ClientConnection->RemoteAddress;
     brb->ChannelHandle = ClientConnection->HidControlChannel.ChannelHandle;
     brb->TransferFlags = ACL_TRANSFER_DIRECTION_IN | ACL_SHORT_TRANSFER_OK;
-    brb->BufferMDL = NULL;
-    brb->Buffer = Buffer;
+    brb->BufferMDL = BufferMDL;
+    brb->Buffer = (BufferMDL != NULL) ? NULL : Buffer;
     brb->BufferSize = (ULONG)BufferLength;
 
+    BthPS3_FlightRecorderRecord(
+        &ClientConnection->DevCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_SUBMIT,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_READ,
+        ClientConnection->SerialNumber,
+        BufferLength
+    );
+
     //
     // Submit request
     // 
@@ -189,7 +237,8 @@ NTSTATUS
 L2CAP_PS3_ReadInterruptTransferAsync(
     _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
     _In_ WDFREQUEST Request,
-    _In_ PVOID Buffer,
+    _In_opt_ PVOID Buffer,
+    _In_opt_ PMDL BufferMDL,
     _In_ size_t BufferLength,
     _In_ PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
 )
@@ -216,16 +265,30 @@ L2CAP_PS3_ReadInterruptTransferAsync(
     // 
     brb->Hdr.ClientContext[0] = ClientConnection->DevCtxHdr;
 
+    //
+    // Used in completion routine to attribute activity to the PDO, stays
+    // valid as the request is owned by one of its queues
+    // 
+    brb->Hdr.ClientContext[1] = ClientConnection;
+
     //
     // Set channel properties
     // 
     brb->BtAddress = ClientConnection->RemoteAddress;
     brb->ChannelHandle = ClientConnection->HidInterruptChannel.ChannelHandle;
     brb->TransferFlags = ACL_TRANSFER_DIRECTION_IN;
-    brb->BufferMDL = NULL;
-    brb->Buffer = Buffer;
+    brb->BufferMDL = BufferMDL;
+    brb->Buffer = (BufferMDL != NULL) ? NULL : Buffer;
     brb->BufferSize = (ULONG)BufferLength;
 
+    BthPS3_FlightRecorderRecord(
+        &ClientConnection->DevCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_SUBMIT,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_READ,
+        ClientConnection->SerialNumber,
+        BufferLength
+    );
+
     //
     // Submit request
     // 
@@ -260,7 +323,8 @@ NTSTATUS
 L2CAP_PS3_SendInterruptTransferAsync(
     _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
     _In_ WDFREQUEST Request,
-    _In_ PVOID Buffer,
+    _In_opt_ PVOID Buffer,
+    _In_opt_ PMDL BufferMDL,
     _In_ size_t BufferLength,
     _In_ PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
 )
@@ -287,18 +351,32 @@ L2CAP_PS3_SendInterruptTransferAsync(
     // 
     brb->Hdr.ClientContext[0] = ClientConnection->DevCtxHdr;
 
+    //
+    // Used in completion routine to attribute activity to the PDO, stays
+    // valid as the request is owned by one of its queues
+    // 
+    brb->Hdr.ClientContext[1] = ClientConnection;
+
     //
     // Set channel properties
     // 
     brb->BtAddress = ClientConnection->RemoteAddress;
     brb->ChannelHandle = ClientConnection->HidInterruptChannel.ChannelHandle;
     brb->TransferFlags = ACL_TRANSFER_DIRECTION_OUT;
-    brb->BufferMDL = NULL;
-    brb->Buffer = Buffer;
+    brb->BufferMDL = BufferMDL;
+    brb->Buffer = (BufferMDL != NULL) ? NULL : Buffer;
     brb->BufferSize = (ULONG)BufferLength;
     brb->Timeout = 0;
     brb->RemainingBufferSize = 0;
 
+    BthPS3_FlightRecorderRecord(
+        &ClientConnection->DevCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_SUBMIT,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_WRITE,
+        ClientConnection->SerialNumber,
+        BufferLength
+    );
+
     //
     // Submit request
     // 
@@ -340,19 +418,67 @@ L2CAP_PS3_AsyncSendControlTransferCompleted(
         (struct _BRB_L2CA_ACL_TRANSFER*)Context;
     PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
         (PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+    const PBTHPS3_PDO_CONTEXT pPdoCtx =
+        (PBTHPS3_PDO_CONTEXT)brb->Hdr.ClientContext[1];
 
     UNREFERENCED_PARAMETER(Target);
 
-    TraceVerbose(
+    HotTraceVerbose(
         TRACE_L2CAP,
         "Control transfer request completed with status %!STATUS!",
         Params->IoStatus.Status
     );
 
+    BthPS3_FlightRecorderRecord(
+        &deviceCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_WRITE,
+        pPdoCtx->SerialNumber,
+        (ULONG)Params->IoStatus.Status | ((ULONG64)brb->BufferSize << 32)
+    );
+
+    if (NT_SUCCESS(Params->IoStatus.Status))
+    {
+        BthPS3_PDO_RecordActivity(pPdoCtx);
+        InterlockedAdd64(&deviceCtxHdr->BytesTransferred, brb->BufferSize);
+    }
+
     deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
     WdfRequestComplete(Request, Params->IoStatus.Status);
 }
 
+//
+// Resolves the buffer of a completed transfer, NULL if it can't be mapped
+// 
+static
+const UCHAR*
+L2CAP_PS3_GetTransferBuffer(
+    _In_ struct _BRB_L2CA_ACL_TRANSFER* Brb
+)
+{
+    return (Brb->BufferMDL != NULL)
+        ? (const UCHAR*)MmGetSystemAddressForMdlSafe(Brb->BufferMDL, NormalPagePriority | MdlMappingNoExecute)
+        : (const UCHAR*)Brb->Buffer;
+}
+
+//
+// Hands a control channel response to the feature report cache
+// 
+static
+VOID
+L2CAP_PS3_CacheFeatureResponse(
+    _In_ PBTHPS3_PDO_CONTEXT PdoContext,
+    _In_ struct _BRB_L2CA_ACL_TRANSFER* Brb
+)
+{
+    const UCHAR* report = L2CAP_PS3_GetTransferBuffer(Brb);
+
+    if (report != NULL)
+    {
+        BthPS3_PDO_CacheFeatureReport(PdoContext, report, Brb->BufferSize, TRUE);
+    }
+}
+
 //
 // Incoming control transfer has been completed
 // 
@@ -369,16 +495,36 @@ L2CAP_PS3_AsyncReadControlTransferCompleted(
         (struct _BRB_L2CA_ACL_TRANSFER*)Context;
     PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
         (PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+    const PBTHPS3_PDO_CONTEXT pPdoCtx =
+        (PBTHPS3_PDO_CONTEXT)brb->Hdr.ClientContext[1];
 
     UNREFERENCED_PARAMETER(Target);
 
-    TraceVerbose(
+    HotTraceVerbose(
         TRACE_L2CAP,
         "Control read transfer request completed with status %!STATUS!",
         Params->IoStatus.Status
     );
 
     length = brb->BufferSize;
+
+    BthPS3_FlightRecorderRecord(
+        &deviceCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_READ,
+        pPdoCtx->SerialNumber,
+        (ULONG)Params->IoStatus.Status | ((ULONG64)brb->BufferSize << 32)
+    );
+
+    if (NT_SUCCESS(Params->IoStatus.Status))
+    {
+        BthPS3_PDO_RecordActivity(pPdoCtx);
+        InterlockedAdd64(&deviceCtxHdr->BytesTransferred, brb->BufferSize);
+        L2CAP_PS3_CacheFeatureResponse(pPdoCtx, brb);
+    }
+
+    L2CAP_PS3_ControlReadDone(pPdoCtx);
+
     deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
     WdfRequestCompleteWithInformation(
         Request,
@@ -387,6 +533,59 @@ L2CAP_PS3_AsyncReadControlTransferCompleted(
     );
 }
 
+//
+// Checks the trailing CRC32 of DualShock 4 input report 0x11, other
+// reports carry none and pass
+// 
+static
+BOOLEAN
+L2CAP_PS3_IsInputCrcValid(
+    _In_ struct _BRB_L2CA_ACL_TRANSFER* Brb
+)
+{
+    const UCHAR* report = L2CAP_PS3_GetTransferBuffer(Brb);
+
+    if (report == NULL || Brb->BufferSize <= 2 + BTHPS3_CRC32_SIZE || report[1] != 0x11)
+    {
+        return TRUE;
+    }
+
+    return BthPS3_Crc32Verify(report, Brb->BufferSize);
+}
+
+//
+// Hands a completed input report to the shared state page
+// 
+static
+VOID
+L2CAP_PS3_PublishInputReport(
+    _In_ PBTHPS3_PDO_CONTEXT PdoContext,
+    _In_ struct _BRB_L2CA_ACL_TRANSFER* Brb
+)
+{
+    const UCHAR* report;
+
+    //
+    // Don't map caller buffers nobody is going to look at
+    // 
+    if (PdoContext->StatePage.Page == NULL)
+    {
+        return;
+    }
+
+    report = L2CAP_PS3_GetTransferBuffer(Brb);
+
+    if (report != NULL)
+    {
+        BthPS3_PDO_PublishStatePage(
+            PdoContext,
+            report,
+            Brb->BufferSize,
+            KeQueryInterruptTime()
+        );
+    }
+}
+
 //
 // Incoming interrupt transfer has been completed
 // 
@@ -399,14 +598,17 @@ L2CAP_PS3_AsyncReadInterruptTransferCompleted(
 )
 {
     size_t length = 0;
+    BOOLEAN isIntact = TRUE;
     struct _BRB_L2CA_ACL_TRANSFER* brb =
         (struct _BRB_L2CA_ACL_TRANSFER*)Context;
     PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
         (PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+    const PBTHPS3_PDO_CONTEXT pPdoCtx =
+        (PBTHPS3_PDO_CONTEXT)brb->Hdr.ClientContext[1];
 
     UNREFERENCED_PARAMETER(Target);
 
-    TraceVerbose(
+    HotTraceVerbose(
         TRACE_L2CAP,
         "Interrupt read transfer request completed with status %!STATUS! (remaining: %d)",
         Params->IoStatus.Status,
@@ -414,6 +616,34 @@ L2CAP_PS3_AsyncReadInterruptTransferCompleted(
     );
 
     length = brb->BufferSize;
+
+    if (NT_SUCCESS(Params->IoStatus.Status)
+        && pPdoCtx->DeviceType == DS_DEVICE_TYPE_WIRELESS
+        && !L2CAP_PS3_IsInputCrcValid(brb))
+    {
+        InterlockedIncrement64(&deviceCtxHdr->InputCrcFailures);
+        isIntact = FALSE;
+    }
+
+    BthPS3_FlightRecorderRecord(
+        &deviceCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_READ,
+        pPdoCtx->SerialNumber,
+        (ULONG)Params->IoStatus.Status | ((ULONG64)brb->BufferSize << 32)
+    );
+
+    if (NT_SUCCESS(Params->IoStatus.Status))
+    {
+        BthPS3_PDO_RecordActivity(pPdoCtx);
+        InterlockedAdd64(&deviceCtxHdr->BytesTransferred, brb->BufferSize);
+
+        if (isIntact)
+        {
+            L2CAP_PS3_PublishInputReport(pPdoCtx, brb);
+        }
+    }
+
     deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
     WdfRequestCompleteWithInformation(
         Request,
@@ -437,15 +667,781 @@ L2CAP_PS3_AsyncSendInterruptTransferCompleted(
         (struct _BRB_L2CA_ACL_TRANSFER*)Context;
     PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
         (PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+    const PBTHPS3_PDO_CONTEXT pPdoCtx =
+        (PBTHPS3_PDO_CONTEXT)brb->Hdr.ClientContext[1];
 
     UNREFERENCED_PARAMETER(Target);
 
-    TraceVerbose(
+    HotTraceVerbose(
         TRACE_L2CAP,
         "Interrupt OUT transfer request completed with status %!STATUS!",
         Params->IoStatus.Status
     );
 
+    BthPS3_FlightRecorderRecord(
+        &deviceCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_WRITE,
+        pPdoCtx->SerialNumber,
+        (ULONG)Params->IoStatus.Status | ((ULONG64)brb->BufferSize << 32)
+    );
+
+    if (NT_SUCCESS(Params->IoStatus.Status))
+    {
+        BthPS3_PDO_RecordActivity(pPdoCtx);
+        InterlockedAdd64(&deviceCtxHdr->BytesTransferred, brb->BufferSize);
+    }
+
     deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
     WdfRequestComplete(Request, Params->IoStatus.Status);
 }
+
+//
+// Submits an incoming interrupt request into a request-owned report buffer
+// 
+static
+NTSTATUS
+L2CAP_PS3_ReadDecodedTransferAsync(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
+    _In_ WDFREQUEST Request,
+    _In_ PVOID Output,
+    _In_ PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
+)
+{
+    NTSTATUS status;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDFMEMORY memory = NULL;
+    PBTHPS3_DECODED_READ pRead = NULL;
+
+    //
+    // Freed with the request
+    // 
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = Request;
+
+    if (!NT_SUCCESS(status = WdfMemoryCreate(
+        &attributes,
+        NonPagedPoolNx,
+        POOLTAG_BTHPS3,
+        sizeof(BTHPS3_DECODED_READ),
+        &memory,
+        (PVOID*)&pRead
+    )))
+    {
+        TraceError(
+            TRACE_L2CAP,
+            "WdfMemoryCreate failed with status %!STATUS!",
+            status
+        );
+
+        return status;
+    }
+
+    pRead->Output = Output;
+
+    return L2CAP_PS3_ReadInterruptTransferAsync(
+        ClientConnection,
+        Request,
+        pRead->Report,
+        NULL,
+        sizeof(pRead->Report),
+        CompletionRoutine
+    );
+}
+
+//
+// Submits an incoming interrupt request to be unpacked into IMU samples
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTSTATUS
+L2CAP_PS3_ReadMotionImuTransferAsync(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
+    _In_ WDFREQUEST Request,
+    _Out_writes_(2) PBTHPS3_MOTION_IMU_SAMPLE Samples
+)
+{
+    if (ClientConnection->DeviceType != DS_DEVICE_TYPE_MOTION)
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    return L2CAP_PS3_ReadDecodedTransferAsync(
+        ClientConnection,
+        Request,
+        Samples,
+        L2CAP_PS3_AsyncReadMotionImuTransferCompleted
+    );
+}
+
+//
+// Incoming interrupt transfer for IMU samples has been completed
+// 
+void
+L2CAP_PS3_AsyncReadMotionImuTransferCompleted(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+    _In_ WDFCONTEXT Context
+)
+{
+    NTSTATUS status = Params->IoStatus.Status;
+    size_t length = 0;
+    struct _BRB_L2CA_ACL_TRANSFER* brb =
+        (struct _BRB_L2CA_ACL_TRANSFER*)Context;
+    PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
+        (PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+    const PBTHPS3_PDO_CONTEXT pPdoCtx =
+        (PBTHPS3_PDO_CONTEXT)brb->Hdr.ClientContext[1];
+    const PBTHPS3_DECODED_READ pImuRead =
+        CONTAINING_RECORD(brb->Buffer, BTHPS3_DECODED_READ, Report);
+    const ULONG64 arrivalTime = KeQueryInterruptTime();
+    BOOLEAN isUnpacked;
+
+    UNREFERENCED_PARAMETER(Target);
+
+    HotTraceVerbose(
+        TRACE_L2CAP,
+        "IMU read transfer request completed with status %!STATUS!",
+        status
+    );
+
+    BthPS3_FlightRecorderRecord(
+        &deviceCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_READ,
+        pPdoCtx->SerialNumber,
+        (ULONG)status | ((ULONG64)brb->BufferSize << 32)
+    );
+
+    if (NT_SUCCESS(status))
+    {
+        BthPS3_PDO_RecordActivity(pPdoCtx);
+        InterlockedAdd64(&deviceCtxHdr->BytesTransferred, brb->BufferSize);
+
+        BthPS3_PDO_PublishStatePage(
+            pPdoCtx,
+            pImuRead->Report,
+            brb->BufferSize,
+            arrivalTime
+        );
+
+        WdfSpinLockAcquire(pPdoCtx->MotionImu.Lock);
+        isUnpacked = BthPS3_MotionImuUnpack(
+            &pPdoCtx->MotionImu.Clock,
+            pImuRead->Report,
+            brb->BufferSize,
+            arrivalTime,
+            (PBTHPS3_MOTION_IMU_SAMPLE)pImuRead->Output
+        );
+        WdfSpinLockRelease(pPdoCtx->MotionImu.Lock);
+
+        if (isUnpacked)
+        {
+            length = 2 * sizeof(BTHPS3_MOTION_IMU_SAMPLE);
+        }
+        else
+        {
+            status = STATUS_INVALID_DEVICE_STATE;
+        }
+    }
+
+    deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
+    WdfRequestCompleteWithInformation(
+        Request,
+        status,
+        length
+    );
+}
+
+//
+// Submits an incoming interrupt request to be decoded into a controller state
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTSTATUS
+L2CAP_PS3_ReadControllerStateTransferAsync(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
+    _In_ WDFREQUEST Request,
+    _Out_ PBTHPS3_CONTROLLER_STATE State
+)
+{
+    if (ClientConnection->DeviceType == DS_DEVICE_TYPE_UNKNOWN)
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    return L2CAP_PS3_ReadDecodedTransferAsync(
+        ClientConnection,
+        Request,
+        State,
+        L2CAP_PS3_AsyncReadControllerStateTransferCompleted
+    );
+}
+
+//
+// Incoming interrupt transfer for a controller state has been completed
+// 
+void
+L2CAP_PS3_AsyncReadControllerStateTransferCompleted(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+    _In_ WDFCONTEXT Context
+)
+{
+    NTSTATUS status = Params->IoStatus.Status;
+    size_t length = 0;
+    struct _BRB_L2CA_ACL_TRANSFER* brb =
+        (struct _BRB_L2CA_ACL_TRANSFER*)Context;
+    PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
+        (PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+    const PBTHPS3_PDO_CONTEXT pPdoCtx =
+        (PBTHPS3_PDO_CONTEXT)brb->Hdr.ClientContext[1];
+    const PBTHPS3_DECODED_READ pRead =
+        CONTAINING_RECORD(brb->Buffer, BTHPS3_DECODED_READ, Report);
+    const PBTHPS3_CONTROLLER_STATE pState = (PBTHPS3_CONTROLLER_STATE)pRead->Output;
+    const ULONG64 arrivalTime = KeQueryInterruptTime();
+
+    UNREFERENCED_PARAMETER(Target);
+
+    HotTraceVerbose(
+        TRACE_L2CAP,
+        "State read transfer request completed with status %!STATUS!",
+        status
+    );
+
+    BthPS3_FlightRecorderRecord(
+        &deviceCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_READ,
+        pPdoCtx->SerialNumber,
+        (ULONG)status | ((ULONG64)brb->BufferSize << 32)
+    );
+
+    if (NT_SUCCESS(status))
+    {
+        BthPS3_PDO_RecordActivity(pPdoCtx);
+        InterlockedAdd64(&deviceCtxHdr->BytesTransferred, brb->BufferSize);
+
+        //
+        // Decoding garbage is worse than dropping the report
+        // 
+        if (pPdoCtx->DeviceType == DS_DEVICE_TYPE_WIRELESS
+            && !L2CAP_PS3_IsInputCrcValid(brb))
+        {
+            InterlockedIncrement64(&deviceCtxHdr->InputCrcFailures);
+            status = STATUS_CRC_ERROR;
+        }
+        else
+        {
+            BthPS3_PDO_PublishStatePage(
+                pPdoCtx,
+                pRead->Report,
+                brb->BufferSize,
+                arrivalTime
+            );
+
+            if (BthPS3_ControllerStateDecode(
+                pPdoCtx->DeviceType,
+                pRead->Report,
+                brb->BufferSize,
+                pState
+            ))
+            {
+                pState->Timestamp = arrivalTime;
+                length = sizeof(BTHPS3_CONTROLLER_STATE);
+            }
+            else
+            {
+                status = STATUS_INVALID_DEVICE_STATE;
+            }
+        }
+    }
+
+    deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
+    WdfRequestCompleteWithInformation(
+        Request,
+        status,
+        length
+    );
+}
+
+//
+// Lets plain control reads through again and sends those held back
+// 
+static
+VOID
+L2CAP_PS3_ControlTransactionEnd(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection
+)
+{
+    WdfSpinLockAcquire(ClientConnection->ControlTransaction.Lock);
+    ClientConnection->ControlTransaction.IsActive = FALSE;
+    WdfSpinLockRelease(ClientConnection->ControlTransaction.Lock);
+
+    //
+    // Queue is non-empty already, no ready notification will come for them
+    // 
+    BthPS3_PDO_DispatchHidControlRead(
+        ClientConnection->Queues.HidControlReadRequests,
+        ClientConnection
+    );
+}
+
+//
+// Drops one outstanding transfer of the control transaction, the last one
+// completes the transaction request
+// 
+static
+VOID
+L2CAP_PS3_ControlTransactionRelease(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection
+)
+{
+    NTSTATUS status;
+    size_t length = 0;
+    WDFREQUEST request;
+
+    if (InterlockedDecrement(&ClientConnection->ControlTransaction.Outstanding) != 0)
+    {
+        return;
+    }
+
+    request = ClientConnection->ControlTransaction.Request;
+    ClientConnection->ControlTransaction.Request = NULL;
+
+    //
+    // A failed send explains a canceled read better than the read does
+    // 
+    status = NT_SUCCESS(ClientConnection->ControlTransaction.SendStatus)
+        ? ClientConnection->ControlTransaction.ReadStatus
+        : ClientConnection->ControlTransaction.SendStatus;
+
+    if (NT_SUCCESS(status))
+    {
+        length = ClientConnection->ControlTransaction.ResponseLength;
+    }
+
+    L2CAP_PS3_ControlTransactionEnd(ClientConnection);
+
+    //
+    // May dispatch the next transaction right away
+    // 
+    WdfRequestCompleteWithInformation(request, status, length);
+}
+
+//
+// Arms the response read with the transaction request and sends the report
+// on the control channel with a request of its own, deleted once the send
+// completed. The transaction request gets completed by the transaction
+// once this succeeded
+// 
+static
+NTSTATUS
+L2CAP_PS3_ControlTransactionStart(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection
+)
+{
+    NTSTATUS status;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDFREQUEST sendRequest;
+    const WDFREQUEST request = ClientConnection->ControlTransaction.Request;
+
+    //
+    // The transfer buffer memory gets parented to the send request, a
+    // reused request would accumulate one per transaction
+    // 
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = WdfObjectContextGetObject(ClientConnection);
+
+    if (!NT_SUCCESS(status = WdfRequestCreate(
+        &attributes,
+        ClientConnection->DevCtxHdr->IoTarget,
+        &sendRequest
+    )))
+    {
+        TraceError(
+            TRACE_L2CAP,
+            "WdfRequestCreate failed with status %!STATUS!",
+            status
+        );
+
+        ClientConnection->ControlTransaction.Request = NULL;
+        L2CAP_PS3_ControlTransactionEnd(ClientConnection);
+
+        return status;
+    }
+
+    ClientConnection->ControlTransaction.Outstanding = 2;
+    ClientConnection->ControlTransaction.SendStatus = STATUS_SUCCESS;
+    ClientConnection->ControlTransaction.ReadStatus = STATUS_SUCCESS;
+    ClientConnection->ControlTransaction.ResponseLength = 0;
+
+    //
+    // Pending before the device can possibly answer, canceling the
+    // transaction request cancels this read
+    // 
+    if (!NT_SUCCESS(status = L2CAP_PS3_ReadControlTransferAsync(
+        ClientConnection,
+        request,
+        NULL,
+        ClientConnection->ControlTransaction.ResponseMDL,
+        ClientConnection->ControlTransaction.ResponseBufferLength,
+        L2CAP_PS3_ControlTransactionReadCompleted
+    )))
+    {
+        ClientConnection->ControlTransaction.Request = NULL;
+        WdfObjectDelete(sendRequest);
+        L2CAP_PS3_ControlTransactionEnd(ClientConnection);
+
+        return status;
+    }
+
+    if (!NT_SUCCESS(status = L2CAP_PS3_SendControlTransferAsync(
+        ClientConnection,
+        sendRequest,
+        ClientConnection->ControlTransaction.Report,
+        NULL,
+        ClientConnection->ControlTransaction.ReportLength,
+        L2CAP_PS3_ControlTransactionSendCompleted
+    )))
+    {
+        TraceError(
+            TRACE_L2CAP,
+            "L2CAP_PS3_SendControlTransferAsync failed with status %!STATUS!",
+            status
+        );
+
+        //
+        // No answer is coming, the read completes as canceled
+        // 
+        WdfObjectDelete(sendRequest);
+        ClientConnection->ControlTransaction.SendStatus = status;
+        WdfRequestCancelSentRequest(request);
+        L2CAP_PS3_ControlTransactionRelease(ClientConnection);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Runs Report on the control channel and completes Request with the
+// response once this succeeded, callers serialize transactions. Plain
+// control reads would race for the response, new ones are held back until
+// completion and the transaction waits for those already pending
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTSTATUS
+L2CAP_PS3_ControlTransactionAsync(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
+    _In_ WDFREQUEST Request,
+    _In_ PVOID Report,
+    _In_ size_t ReportLength,
+    _In_ PMDL ResponseMDL,
+    _In_ size_t ResponseLength
+)
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    BOOLEAN isWaiting;
+
+    WdfSpinLockAcquire(ClientConnection->ControlTransaction.Lock);
+
+    ClientConnection->ControlTransaction.IsActive = TRUE;
+    ClientConnection->ControlTransaction.Request = Request;
+    ClientConnection->ControlTransaction.Report = Report;
+    ClientConnection->ControlTransaction.ReportLength = ReportLength;
+    ClientConnection->ControlTransaction.ResponseMDL = ResponseMDL;
+    ClientConnection->ControlTransaction.ResponseBufferLength = ResponseLength;
+
+    isWaiting = ClientConnection->ControlTransaction.PlainReads != 0;
+
+    //
+    // The last pending read starts it, unless it gets canceled meanwhile
+    // 
+    if (isWaiting && !NT_SUCCESS(status = WdfRequestMarkCancelableEx(
+        Request,
+        L2CAP_PS3_EvtControlTransactionCanceled
+    )))
+    {
+        ClientConnection->ControlTransaction.Request = NULL;
+    }
+
+    ClientConnection->ControlTransaction.IsWaiting = NT_SUCCESS(status) && isWaiting;
+
+    WdfSpinLockRelease(ClientConnection->ControlTransaction.Lock);
+
+    if (!NT_SUCCESS(status))
+    {
+        TraceError(
+            TRACE_L2CAP,
+            "WdfRequestMarkCancelableEx failed with status %!STATUS!",
+            status
+        );
+
+        L2CAP_PS3_ControlTransactionEnd(ClientConnection);
+
+        return status;
+    }
+
+    if (isWaiting)
+    {
+        TraceVerbose(
+            TRACE_L2CAP,
+            "Control reads pending, transaction waiting"
+        );
+
+        return STATUS_SUCCESS;
+    }
+
+    return L2CAP_PS3_ControlTransactionStart(ClientConnection);
+}
+
+//
+// A plain control read is done, the last one starts the transaction
+// waiting for it
+// 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+L2CAP_PS3_ControlReadDone(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection
+)
+{
+    NTSTATUS status;
+    BOOLEAN isWaiting;
+    WDFREQUEST request;
+
+    WdfSpinLockAcquire(ClientConnection->ControlTransaction.Lock);
+
+    isWaiting = InterlockedDecrement(&ClientConnection->ControlTransaction.PlainReads) == 0
+        && ClientConnection->ControlTransaction.IsWaiting;
+
+    if (isWaiting)
+    {
+        ClientConnection->ControlTransaction.IsWaiting = FALSE;
+    }
+
+    request = ClientConnection->ControlTransaction.Request;
+
+    WdfSpinLockRelease(ClientConnection->ControlTransaction.Lock);
+
+    if (!isWaiting)
+    {
+        return;
+    }
+
+    //
+    // The cancel routine found it taken and left completion to us
+    // 
+    if (WdfRequestUnmarkCancelable(request) == STATUS_CANCELLED)
+    {
+        ClientConnection->ControlTransaction.Request = NULL;
+        L2CAP_PS3_ControlTransactionEnd(ClientConnection);
+        WdfRequestComplete(request, STATUS_CANCELLED);
+
+        return;
+    }
+
+    if (!NT_SUCCESS(status = L2CAP_PS3_ControlTransactionStart(ClientConnection)))
+    {
+        WdfRequestComplete(request, status);
+    }
+}
+
+//
+// Transaction got canceled while waiting for plain control reads
+// 
+void
+L2CAP_PS3_EvtControlTransactionCanceled(
+    _In_ WDFREQUEST Request
+)
+{
+    const WDFDEVICE device = WdfIoQueueGetDevice(WdfRequestGetIoQueue(Request));
+    const PBTHPS3_PDO_CONTEXT pPdoCtx = GetPdoContext(device);
+    BOOLEAN isWaiting;
+
+    WdfSpinLockAcquire(pPdoCtx->ControlTransaction.Lock);
+
+    isWaiting = pPdoCtx->ControlTransaction.IsWaiting
+        && pPdoCtx->ControlTransaction.Request == Request;
+
+    if (isWaiting)
+    {
+        pPdoCtx->ControlTransaction.IsWaiting = FALSE;
+        pPdoCtx->ControlTransaction.Request = NULL;
+    }
+
+    WdfSpinLockRelease(pPdoCtx->ControlTransaction.Lock);
+
+    if (!isWaiting)
+    {
+        return;
+    }
+
+    L2CAP_PS3_ControlTransactionEnd(pPdoCtx);
+    WdfRequestComplete(Request, STATUS_CANCELLED);
+}
+
+//
+// Outgoing part of a control transaction has been completed
+// 
+void
+L2CAP_PS3_ControlTransactionSendCompleted(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+    _In_ WDFCONTEXT Context
+)
+{
+    struct _BRB_L2CA_ACL_TRANSFER* brb =
+        (struct _BRB_L2CA_ACL_TRANSFER*)Context;
+    PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
+        (PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+    const PBTHPS3_PDO_CONTEXT pPdoCtx =
+        (PBTHPS3_PDO_CONTEXT)brb->Hdr.ClientContext[1];
+
+    UNREFERENCED_PARAMETER(Target);
+
+    HotTraceVerbose(
+        TRACE_L2CAP,
+        "Control transaction send completed with status %!STATUS!",
+        Params->IoStatus.Status
+    );
+
+    BthPS3_FlightRecorderRecord(
+        &deviceCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_WRITE,
+        pPdoCtx->SerialNumber,
+        (ULONG)Params->IoStatus.Status | ((ULONG64)brb->BufferSize << 32)
+    );
+
+    if (NT_SUCCESS(Params->IoStatus.Status))
+    {
+        BthPS3_PDO_RecordActivity(pPdoCtx);
+        InterlockedAdd64(&deviceCtxHdr->BytesTransferred, brb->BufferSize);
+    }
+    else
+    {
+        //
+        // Still outstanding as we hold a reference, stop waiting for an answer
+        // 
+        pPdoCtx->ControlTransaction.SendStatus = Params->IoStatus.Status;
+        WdfRequestCancelSentRequest(pPdoCtx->ControlTransaction.Request);
+    }
+
+    deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
+
+    //
+    // Created per transaction, takes the transfer buffer memory with it
+    // 
+    WdfObjectDelete(Request);
+
+    L2CAP_PS3_ControlTransactionRelease(pPdoCtx);
+}
+
+//
+// Response part of a control transaction has been completed
+// 
+void
+L2CAP_PS3_ControlTransactionReadCompleted(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+    _In_ WDFCONTEXT Context
+)
+{
+    struct _BRB_L2CA_ACL_TRANSFER* brb =
+        (struct _BRB_L2CA_ACL_TRANSFER*)Context;
+    PBTHPS3_DEVICE_CONTEXT_HEADER deviceCtxHdr =
+        (PBTHPS3_DEVICE_CONTEXT_HEADER)brb->Hdr.ClientContext[0];
+    const PBTHPS3_PDO_CONTEXT pPdoCtx =
+        (PBTHPS3_PDO_CONTEXT)brb->Hdr.ClientContext[1];
+
+    UNREFERENCED_PARAMETER(Request);
+    UNREFERENCED_PARAMETER(Target);
+
+    HotTraceVerbose(
+        TRACE_L2CAP,
+        "Control transaction read completed with status %!STATUS!",
+        Params->IoStatus.Status
+    );
+
+    BthPS3_FlightRecorderRecord(
+        &deviceCtxHdr->FlightRecorder,
+        BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+        BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_READ,
+        pPdoCtx->SerialNumber,
+        (ULONG)Params->IoStatus.Status | ((ULONG64)brb->BufferSize << 32)
+    );
+
+    if (NT_SUCCESS(Params->IoStatus.Status))
+    {
+        BthPS3_PDO_RecordActivity(pPdoCtx);
+        InterlockedAdd64(&deviceCtxHdr->BytesTransferred, brb->BufferSize);
+        L2CAP_PS3_CacheFeatureResponse(pPdoCtx, brb);
+    }
+
+    pPdoCtx->ControlTransaction.ReadStatus = Params->IoStatus.Status;
+    pPdoCtx->ControlTransaction.ResponseLength = brb->BufferSize;
+
+    deviceCtxHdr->ProfileDrvInterface.BthFreeBrb((PBRB)brb);
+
+    L2CAP_PS3_ControlTransactionRelease(pPdoCtx);
+}
+
+//
+// Output report didn't reach the device, the next command must go out even
+// if it changes nothing
+// 
+static
+VOID
+L2CAP_PS3_FeedbackSendFailed(
+    _In_ PVOID Context
+)
+{
+    struct _BRB_L2CA_ACL_TRANSFER* brb =
+        (struct _BRB_L2CA_ACL_TRANSFER*)Context;
+    const PBTHPS3_PDO_CONTEXT pPdoCtx =
+        (PBTHPS3_PDO_CONTEXT)brb->Hdr.ClientContext[1];
+
+    WdfSpinLockAcquire(pPdoCtx->Feedback.Lock);
+    pPdoCtx->Feedback.State.IsSent = FALSE;
+    WdfSpinLockRelease(pPdoCtx->Feedback.Lock);
+}
+
+//
+// Output report sent as SET_REPORT on the control channel has been completed
+// 
+void
+L2CAP_PS3_FeedbackSendControlCompleted(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+    _In_ WDFCONTEXT Context
+)
+{
+    if (!NT_SUCCESS(Params->IoStatus.Status))
+    {
+        L2CAP_PS3_FeedbackSendFailed(Context);
+    }
+
+    L2CAP_PS3_AsyncSendControlTransferCompleted(Request, Target, Params, Context);
+}
+
+//
+// Output report sent on the interrupt channel has been completed
+// 
+void
+L2CAP_PS3_FeedbackSendInterruptCompleted(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+    _In_ WDFCONTEXT Context
+)
+{
+    if (!NT_SUCCESS(Params->IoStatus.Status))
+    {
+        L2CAP_PS3_FeedbackSendFailed(Context);
+    }
+
+    L2CAP_PS3_AsyncSendInterruptTransferCompleted(Request, Target, Params, Context);
+}
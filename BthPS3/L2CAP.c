@@ -75,7 +75,7 @@ L2CAP_PS3_ControlConnectResponseCompleted(
 	{
 		WdfSpinLockAcquire(pPdoCtx->HidControlChannel.ConnectionStateLock);
 
-		pPdoCtx->HidControlChannel.ConnectionState = ConnectionStateConnected;
+		BthPS3_ConnectionStateConnectCompleted(&pPdoCtx->HidControlChannel.ConnectionState);
 
 		//
 		// This will be set again once disconnect has occurred
@@ -175,7 +175,7 @@ L2CAP_PS3_InterruptConnectResponseCompleted(
 	{
 		WdfSpinLockAcquire(pPdoCtx->HidInterruptChannel.ConnectionStateLock);
 
-		pPdoCtx->HidInterruptChannel.ConnectionState = ConnectionStateConnected;
+		BthPS3_ConnectionStateConnectCompleted(&pPdoCtx->HidInterruptChannel.ConnectionState);
 
 		//
 		// This will be set again once disconnect has occurred
@@ -243,6 +243,15 @@ L2CAP_PS3_InterruptConnectResponseCompleted(
 			EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfIoQueueReadyNotify (HidInterruptWriteRequests)", status);
 		}
 
+		//
+		// Get input reports flowing before the function driver got loaded
+		// 
+		if (pPdoCtx->DeviceType == DS_DEVICE_TYPE_SIXAXIS
+			&& GetServerDeviceContext(pPdoCtx->DevCtxHdr->Device)->Settings.SIXAXISEnableOnConnect)
+		{
+			(void)L2CAP_PS3_SendSixaxisEnable(pPdoCtx);
+		}
+
 		EventWriteRemoteDeviceOnline(NULL, pPdoCtx->RemoteAddress);
 	}
 	else
@@ -290,6 +299,14 @@ L2CAP_PS3_DenyRemoteConnect(
 
 	FuncEntry(TRACE_L2CAP);
 
+	BthPS3_FlightRecorderRecord(
+		&DevCtx->Header.FlightRecorder,
+		BTHPS3_FLIGHT_RECORDER_CONNECT_STAGE,
+		BTHPS3_FLIGHT_RECORDER_CONNECT_DENIED,
+		0,
+		ConnectParams->BtAddress
+	);
+
 	if (!NT_SUCCESS(status = WdfRequestCreate(
 		WDF_NO_OBJECT_ATTRIBUTES,
 		DevCtx->Header.IoTarget,
@@ -83,6 +83,7 @@ L2CAP_PS3_SendControlTransferAsync(
     PBTHPS3_PDO_CONTEXT ClientConnection,
     WDFREQUEST Request,
     PVOID Buffer,
+    PMDL BufferMDL,
     size_t BufferLength,
     PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
 );
@@ -93,6 +94,7 @@ L2CAP_PS3_ReadControlTransferAsync(
     PBTHPS3_PDO_CONTEXT ClientConnection,
     WDFREQUEST Request,
     PVOID Buffer,
+    PMDL BufferMDL,
     size_t BufferLength,
     PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
 );
@@ -102,7 +104,8 @@ NTSTATUS
 L2CAP_PS3_ReadInterruptTransferAsync(
     _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
     _In_ WDFREQUEST Request,
-    _In_ PVOID Buffer,
+    _In_opt_ PVOID Buffer,
+    _In_opt_ PMDL BufferMDL,
     _In_ size_t BufferLength,
     _In_ PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
 );
@@ -112,7 +115,8 @@ NTSTATUS
 L2CAP_PS3_SendInterruptTransferAsync(
     _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
     _In_ WDFREQUEST Request,
-    _In_ PVOID Buffer,
+    _In_opt_ PVOID Buffer,
+    _In_opt_ PMDL BufferMDL,
     _In_ size_t BufferLength,
     _In_ PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine
 );
@@ -127,6 +131,15 @@ L2CAP_PS3_RemoteDisconnect(
 
 EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_ChannelDisconnectCompleted;
 
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTSTATUS
+L2CAP_PS3_SendSixaxisEnable(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection
+);
+
+EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_SixaxisEnableSendCompleted;
+EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_SixaxisEnableHandshakeCompleted;
+
 //
 // HID Control Channel Completion Routines
 // 
@@ -138,3 +151,54 @@ EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_AsyncSendControlTransferCompleted;
 // 
 EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_AsyncReadInterruptTransferCompleted;
 EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_AsyncSendInterruptTransferCompleted;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTSTATUS
+L2CAP_PS3_ReadMotionImuTransferAsync(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
+    _In_ WDFREQUEST Request,
+    _Out_writes_(2) PBTHPS3_MOTION_IMU_SAMPLE Samples
+);
+
+EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_AsyncReadMotionImuTransferCompleted;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTSTATUS
+L2CAP_PS3_ReadControllerStateTransferAsync(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
+    _In_ WDFREQUEST Request,
+    _Out_ PBTHPS3_CONTROLLER_STATE State
+);
+
+EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_AsyncReadControllerStateTransferCompleted;
+
+//
+// HID Control Channel Transactions
+// 
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTSTATUS
+L2CAP_PS3_ControlTransactionAsync(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection,
+    _In_ WDFREQUEST Request,
+    _In_ PVOID Report,
+    _In_ size_t ReportLength,
+    _In_ PMDL ResponseMDL,
+    _In_ size_t ResponseLength
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+L2CAP_PS3_ControlReadDone(
+    _In_ PBTHPS3_PDO_CONTEXT ClientConnection
+);
+
+EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_ControlTransactionSendCompleted;
+EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_ControlTransactionReadCompleted;
+EVT_WDF_REQUEST_CANCEL L2CAP_PS3_EvtControlTransactionCanceled;
+
+//
+// Output Report Completion Routines
+// 
+EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_FeedbackSendControlCompleted;
+EVT_WDF_REQUEST_COMPLETION_ROUTINE L2CAP_PS3_FeedbackSendInterruptCompleted;
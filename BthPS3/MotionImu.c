@@ -0,0 +1,151 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "MotionImu.h"
+#else
+#include "Driver.h"
+#endif
+
+
+//
+// Offsets within the report including the HIDP DATA header
+// 
+#define MOTION_OFFSET_REPORT_ID                 1
+#define MOTION_OFFSET_SEQUENCE                  5
+#define MOTION_OFFSET_ACCELEROMETER             14
+#define MOTION_OFFSET_GYROSCOPE                 26
+
+//
+// Bytes per three-axis sample of one sensor
+// 
+#define MOTION_SENSOR_SAMPLE_SIZE               6
+
+//
+// Observed spacings this far off the nominal one are dropped
+// 
+#define MOTION_INTERVAL_TOLERANCE               4
+
+
+VOID
+BthPS3_MotionImuInit(
+	PBTHPS3_MOTION_IMU_CLOCK Clock
+)
+{
+	Clock->LastArrival = 0;
+	Clock->SampleInterval = BTHPS3_MOTION_IMU_NOMINAL_INTERVAL;
+	Clock->LastSequence = 0;
+}
+
+//
+// Sensor values are little-endian and biased by 0x8000
+// 
+FORCEINLINE
+SHORT
+BthPS3_MotionImuAxis(
+	_In_ const UCHAR* Value
+)
+{
+	return (SHORT)(((ULONG)Value[0] | ((ULONG)Value[1] << 8)) - 0x8000);
+}
+
+BOOLEAN
+BthPS3_MotionImuUnpack(
+	PBTHPS3_MOTION_IMU_CLOCK Clock,
+	const UCHAR* Report,
+	ULONG ReportLength,
+	ULONG64 ArrivalTime,
+	PBTHPS3_MOTION_IMU_SAMPLE Samples
+)
+{
+	if (ReportLength < BTHPS3_MOTION_IMU_MIN_REPORT_SIZE || Report[MOTION_OFFSET_REPORT_ID] != 0x01)
+	{
+		return FALSE;
+	}
+
+	const UCHAR sequence = Report[MOTION_OFFSET_SEQUENCE] & 0x0F;
+
+	//
+	// Two samples per report, reports the counter skipped got lost on the way
+	// 
+	if (Clock->LastArrival != 0 && ArrivalTime > Clock->LastArrival)
+	{
+		const ULONG reports = (ULONG)(sequence - Clock->LastSequence) & 0x0F;
+
+		if (reports != 0)
+		{
+			const ULONG64 observed = (ArrivalTime - Clock->LastArrival) / (2ULL * reports);
+
+			if (observed >= BTHPS3_MOTION_IMU_NOMINAL_INTERVAL / MOTION_INTERVAL_TOLERANCE
+				&& observed <= BTHPS3_MOTION_IMU_NOMINAL_INTERVAL * MOTION_INTERVAL_TOLERANCE)
+			{
+				Clock->SampleInterval = Clock->SampleInterval - (Clock->SampleInterval >> 3) + (observed >> 3);
+			}
+		}
+	}
+
+	Clock->LastArrival = ArrivalTime;
+	Clock->LastSequence = sequence;
+
+	//
+	// Fixed offsets, no data dependent branches
+	// 
+	for (ULONG sample = 0; sample < 2; sample++)
+	{
+		const UCHAR* accelerometer = &Report[MOTION_OFFSET_ACCELEROMETER + sample * MOTION_SENSOR_SAMPLE_SIZE];
+		const UCHAR* gyroscope = &Report[MOTION_OFFSET_GYROSCOPE + sample * MOTION_SENSOR_SAMPLE_SIZE];
+
+		for (ULONG axis = 0; axis < 3; axis++)
+		{
+			Samples[sample].Accelerometer[axis] = BthPS3_MotionImuAxis(&accelerometer[axis * 2]);
+			Samples[sample].Gyroscope[axis] = BthPS3_MotionImuAxis(&gyroscope[axis * 2]);
+		}
+
+		Samples[sample].Sequence = sequence;
+		Samples[sample].Frame = (UCHAR)sample;
+		Samples[sample].Reserved = 0;
+	}
+
+	//
+	// The newer sample got taken right before the report went out
+	// 
+	Samples[1].Timestamp = ArrivalTime;
+	Samples[0].Timestamp = ArrivalTime - Clock->SampleInterval;
+
+	return TRUE;
+}
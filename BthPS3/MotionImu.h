@@ -0,0 +1,91 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// Unpacks Motion Controller input reports into IMU samples. Each report
+// carries two accelerometer/gyroscope samples, the spacing between them is
+// learned from report arrival times and the 4-bit report sequence counter
+// so lost reports don't skew it. Only depends on basic types so the logic
+// can be built and exercised outside the driver.
+// 
+
+//
+// Reports are shorter than this if they lack the second gyroscope sample
+// 
+#define BTHPS3_MOTION_IMU_MIN_REPORT_SIZE       38
+
+//
+// Assumed sample spacing (in 100ns units) until one got observed
+// 
+#define BTHPS3_MOTION_IMU_NOMINAL_INTERVAL      56000
+
+typedef struct _BTHPS3_MOTION_IMU_CLOCK
+{
+	//
+	// Interrupt time (in 100ns units) the previous report arrived at, 0 if none
+	// 
+	ULONG64 LastArrival;
+
+	//
+	// Smoothed spacing of two samples in 100ns units
+	// 
+	ULONG64 SampleInterval;
+
+	UCHAR LastSequence;
+
+} BTHPS3_MOTION_IMU_CLOCK, * PBTHPS3_MOTION_IMU_CLOCK;
+
+
+VOID
+BthPS3_MotionImuInit(
+	_Out_ PBTHPS3_MOTION_IMU_CLOCK Clock
+);
+
+//
+// Splits a report (including the HIDP header) into its older and newer
+// sample, returns FALSE if the report isn't a Motion input report
+// 
+BOOLEAN
+BthPS3_MotionImuUnpack(
+	_Inout_ PBTHPS3_MOTION_IMU_CLOCK Clock,
+	_In_reads_bytes_(ReportLength) const UCHAR* Report,
+	_In_ ULONG ReportLength,
+	_In_ ULONG64 ArrivalTime,
+	_Out_writes_(2) PBTHPS3_MOTION_IMU_SAMPLE Samples
+);
@@ -0,0 +1,182 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "OutputReport.h"
+#else
+#include "Driver.h"
+#endif
+
+
+//
+// HIDP SET_REPORT (Output) header, report ID 0x01 and the DualShock 3 defaults
+// 
+static const UCHAR G_SixaxisOutputReport[BTHPS3_SIXAXIS_HID_OUTPUT_REPORT_SIZE] =
+{
+	0x52, 0x01, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0xFF, 0x27, 0x10, 0x00,
+	0x32, 0xFF, 0x27, 0x10, 0x00, 0x32, 0xFF, 0x27,
+	0x10, 0x00, 0x32, 0xFF, 0x27, 0x10, 0x00, 0x32,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00
+};
+
+#define SIXAXIS_OFFSET_SMALL_MOTOR_DURATION     3
+#define SIXAXIS_OFFSET_SMALL_MOTOR_ON           4
+#define SIXAXIS_OFFSET_LARGE_MOTOR_DURATION     5
+#define SIXAXIS_OFFSET_LARGE_MOTOR_FORCE        6
+#define SIXAXIS_OFFSET_LEDS                     11
+
+//
+// HIDP DATA (Output) header and report ID 0x02 of the Motion Controller
+// 
+#define MOTION_OUTPUT_REPORT_SIZE               0x32
+#define MOTION_OFFSET_RED                       3
+#define MOTION_OFFSET_GREEN                     4
+#define MOTION_OFFSET_BLUE                      5
+#define MOTION_OFFSET_RUMBLE                    7
+
+
+BOOLEAN
+BthPS3_OutputReportInit(
+	PBTHPS3_OUTPUT_REPORT OutputReport,
+	DS_DEVICE_TYPE DeviceType
+)
+{
+	RtlZeroMemory(OutputReport, sizeof(*OutputReport));
+
+	OutputReport->DeviceType = DeviceType;
+
+	switch (DeviceType)
+	{
+	case DS_DEVICE_TYPE_SIXAXIS:
+	case DS_DEVICE_TYPE_NAVIGATION:
+		//
+		// Navigation shares the layout, it simply has no motors
+		// 
+		RtlCopyMemory(OutputReport->Report, G_SixaxisOutputReport, sizeof(G_SixaxisOutputReport));
+		OutputReport->Length = sizeof(G_SixaxisOutputReport);
+		OutputReport->IsControlChannel = TRUE;
+		return TRUE;
+	case DS_DEVICE_TYPE_MOTION:
+		OutputReport->Report[0] = 0xA2;
+		OutputReport->Report[1] = 0x02;
+		OutputReport->Length = MOTION_OUTPUT_REPORT_SIZE;
+		OutputReport->IsControlChannel = FALSE;
+		return TRUE;
+	default:
+		//
+		// DualShock 4 reports need a checksum, not synthesized (yet)
+		// 
+		return FALSE;
+	}
+}
+
+static
+VOID
+BthPS3_OutputReportPatch(
+	_Inout_ PBTHPS3_OUTPUT_REPORT OutputReport,
+	_In_ ULONG Offset,
+	_In_ UCHAR Value,
+	_Inout_ PBOOLEAN IsChanged
+)
+{
+	if (OutputReport->Report[Offset] != Value)
+	{
+		OutputReport->Report[Offset] = Value;
+		*IsChanged = TRUE;
+	}
+}
+
+BOOLEAN
+BthPS3_OutputReportApply(
+	PBTHPS3_OUTPUT_REPORT OutputReport,
+	const BTHPS3_SET_FEEDBACK* Feedback
+)
+{
+	BOOLEAN isChanged = FALSE;
+
+	switch (OutputReport->DeviceType)
+	{
+	case DS_DEVICE_TYPE_SIXAXIS:
+	case DS_DEVICE_TYPE_NAVIGATION:
+		//
+		// The small motor only knows on and off
+		// 
+		BthPS3_OutputReportPatch(OutputReport, SIXAXIS_OFFSET_SMALL_MOTOR_DURATION,
+			Feedback->Duration, &isChanged);
+		BthPS3_OutputReportPatch(OutputReport, SIXAXIS_OFFSET_SMALL_MOTOR_ON,
+			Feedback->SmallMotor ? 0x01 : 0x00, &isChanged);
+		BthPS3_OutputReportPatch(OutputReport, SIXAXIS_OFFSET_LARGE_MOTOR_DURATION,
+			Feedback->Duration, &isChanged);
+		BthPS3_OutputReportPatch(OutputReport, SIXAXIS_OFFSET_LARGE_MOTOR_FORCE,
+			Feedback->LargeMotor, &isChanged);
+		//
+		// LED 1 is bit 1 on the wire
+		// 
+		BthPS3_OutputReportPatch(OutputReport, SIXAXIS_OFFSET_LEDS,
+			(UCHAR)((Feedback->LedMask & 0x0F) << 1), &isChanged);
+		break;
+	case DS_DEVICE_TYPE_MOTION:
+		//
+		// Single motor and the sphere, each mask bit drives one color at full brightness
+		// 
+		BthPS3_OutputReportPatch(OutputReport, MOTION_OFFSET_RED,
+			(Feedback->LedMask & 0x01) ? 0xFF : 0x00, &isChanged);
+		BthPS3_OutputReportPatch(OutputReport, MOTION_OFFSET_GREEN,
+			(Feedback->LedMask & 0x02) ? 0xFF : 0x00, &isChanged);
+		BthPS3_OutputReportPatch(OutputReport, MOTION_OFFSET_BLUE,
+			(Feedback->LedMask & 0x04) ? 0xFF : 0x00, &isChanged);
+		BthPS3_OutputReportPatch(OutputReport, MOTION_OFFSET_RUMBLE,
+			(UCHAR)(Feedback->LargeMotor > Feedback->SmallMotor ? Feedback->LargeMotor : Feedback->SmallMotor),
+			&isChanged);
+		break;
+	default:
+		return FALSE;
+	}
+
+	if (!isChanged && OutputReport->IsSent && !(Feedback->Flags & BTHPS3_SET_FEEDBACK_FLAG_FORCE))
+	{
+		return FALSE;
+	}
+
+	OutputReport->IsSent = TRUE;
+
+	return TRUE;
+}
@@ -0,0 +1,95 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// Synthesizes HID output reports from compact feedback commands. The last
+// report handed to the radio is kept per child so a command only patches the
+// bytes it owns and nothing goes out if the result equals what the device
+// already got. Only depends on basic types and DS_DEVICE_TYPE so the logic
+// can be built and exercised outside the driver.
+// 
+
+//
+// Largest report of any supported device type, including the HIDP header
+// 
+#define BTHPS3_OUTPUT_REPORT_MAX_SIZE           BTHPS3_SIXAXIS_HID_OUTPUT_REPORT_SIZE
+
+typedef struct _BTHPS3_OUTPUT_REPORT
+{
+	DS_DEVICE_TYPE DeviceType;
+
+	//
+	// Last report handed to the radio, the template until then
+	// 
+	UCHAR Report[BTHPS3_OUTPUT_REPORT_MAX_SIZE];
+
+	ULONG Length;
+
+	//
+	// SET_REPORT on the control channel, DATA on the interrupt channel otherwise
+	// 
+	BOOLEAN IsControlChannel;
+
+	//
+	// Report got handed to the radio since (re-)initialization
+	// 
+	BOOLEAN IsSent;
+
+} BTHPS3_OUTPUT_REPORT, * PBTHPS3_OUTPUT_REPORT;
+
+
+//
+// Loads the template report of the device type, returns FALSE if unsupported
+// 
+BOOLEAN
+BthPS3_OutputReportInit(
+	_Out_ PBTHPS3_OUTPUT_REPORT OutputReport,
+	_In_ DS_DEVICE_TYPE DeviceType
+);
+
+//
+// Patches the feedback bytes into the report, returns TRUE if it has to be
+// sent. The caller clears IsSent if handing the report to the radio or its
+// transfer failed.
+// 
+BOOLEAN
+BthPS3_OutputReportApply(
+	_Inout_ PBTHPS3_OUTPUT_REPORT OutputReport,
+	_In_ const BTHPS3_SET_FEEDBACK* Feedback
+);
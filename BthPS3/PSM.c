@@ -71,6 +71,41 @@ BthPS3PSM_DisablePatchSync(
 	);
 }
 
+//
+// Request filter driver to disable PSM patching until the supplied remote
+// completed or failed its next connection attempt (PASSIVE_LEVEL only)
+// 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_SuspendPatchSync(
+	WDFIOTARGET IoTarget,
+	ULONG DeviceIndex,
+	BTH_ADDR RemoteAddress
+)
+{
+	WDF_MEMORY_DESCRIPTOR MemoryDescriptor;
+	BTHPS3PSM_SUSPEND_PSM_PATCHING payload;
+
+	payload.DeviceIndex = DeviceIndex;
+	payload.RemoteAddress = RemoteAddress;
+
+	WDF_MEMORY_DESCRIPTOR_INIT_BUFFER(
+		&MemoryDescriptor,
+		(PVOID)&payload,
+		sizeof(payload)
+	);
+
+	return WdfIoTargetSendIoctlSynchronously(
+		IoTarget,
+		NULL,
+		IOCTL_BTHPS3PSM_SUSPEND_PSM_PATCHING,
+		&MemoryDescriptor,
+		NULL,
+		NULL,
+		NULL
+	);
+}
+
 //
 // Request filter driver to enable PSM patching (PASSIVE_LEVEL only)
 // 
@@ -103,6 +138,128 @@ BthPS3PSM_EnablePatchSync(
 	);
 }
 
+//
+// Replace the filter's allow-list of always patched remotes (PASSIVE_LEVEL only)
+// 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_SetAddressFilterSync(
+	WDFIOTARGET IoTarget,
+	ULONG DeviceIndex,
+	const BTH_ADDR* Addresses,
+	ULONG AddressCount
+)
+{
+	NTSTATUS status;
+	WDF_MEMORY_DESCRIPTOR MemoryDescriptor;
+	WDF_OBJECT_ATTRIBUTES attribs;
+	WDFMEMORY memory;
+	PBTHPS3PSM_SET_ADDRESS_FILTER pPayload;
+
+	if (AddressCount > BTHPS3PSM_ADDRESS_FILTER_MAX_ADDRESSES)
+	{
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attribs);
+
+	//
+	// Too big for the stack
+	// 
+	if (!NT_SUCCESS(status = WdfMemoryCreate(&attribs,
+		PagedPool,
+		POOLTAG_BTHPS3,
+		sizeof(BTHPS3PSM_SET_ADDRESS_FILTER),
+		&memory,
+		(PVOID)&pPayload
+	)))
+	{
+		return status;
+	}
+
+	RtlZeroMemory(pPayload, sizeof(BTHPS3PSM_SET_ADDRESS_FILTER));
+
+	pPayload->DeviceIndex = DeviceIndex;
+	pPayload->AddressCount = AddressCount;
+
+	for (ULONG index = 0; index < AddressCount; index++)
+	{
+		pPayload->Addresses[index] = Addresses[index];
+	}
+
+	WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(
+		&MemoryDescriptor,
+		memory,
+		NULL
+	);
+
+	status = WdfIoTargetSendIoctlSynchronously(
+		IoTarget,
+		NULL,
+		IOCTL_BTHPS3PSM_SET_ADDRESS_FILTER,
+		&MemoryDescriptor,
+		NULL,
+		NULL,
+		NULL
+	);
+
+	WdfObjectDelete(memory);
+
+	return status;
+}
+
+//
+// Pushes all known remotes to the filter so their connections get patched
+// even while the radio-wide patch is disabled (PASSIVE_LEVEL only)
+// 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_RefreshAddressFilterSync(
+	PBTHPS3_SERVER_CONTEXT DevCtx
+)
+{
+	NTSTATUS status;
+	BTH_ADDR addresses[BTHPS3PSM_ADDRESS_FILTER_MAX_ADDRESSES];
+	ULONG count = 0;
+
+	if (!NT_SUCCESS(status = BthPS3_PDO_QueryCachedAddresses(
+		addresses,
+		ARRAYSIZE(addresses),
+		&count
+	)))
+	{
+		TraceError(
+			TRACE_PSM,
+			"BthPS3_PDO_QueryCachedAddresses failed with status %!STATUS!",
+			status
+		);
+		return status;
+	}
+
+	if (!NT_SUCCESS(status = BthPS3PSM_SetAddressFilterSync(
+		DevCtx->PsmFilter.IoTarget,
+		0,
+		addresses,
+		count
+	)))
+	{
+		TraceError(
+			TRACE_PSM,
+			"BthPS3PSM_SetAddressFilterSync failed with status %!STATUS!",
+			status
+		);
+		return status;
+	}
+
+	TraceVerbose(
+		TRACE_PSM,
+		"Filter allow-list updated with %d addresses",
+		count
+	);
+
+	return status;
+}
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 NTSTATUS
 BthPS3PSM_EnablePatchAsync(
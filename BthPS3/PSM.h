@@ -44,6 +44,14 @@ BthPS3PSM_DisablePatchSync(
 	ULONG DeviceIndex
 );
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_SuspendPatchSync(
+	WDFIOTARGET IoTarget,
+	ULONG DeviceIndex,
+	BTH_ADDR RemoteAddress
+);
+
 _IRQL_requires_max_(PASSIVE_LEVEL)
 NTSTATUS
 BthPS3PSM_EnablePatchSync(
@@ -51,6 +59,21 @@ BthPS3PSM_EnablePatchSync(
 	ULONG DeviceIndex
 );
 
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_SetAddressFilterSync(
+	WDFIOTARGET IoTarget,
+	ULONG DeviceIndex,
+	const BTH_ADDR* Addresses,
+	ULONG AddressCount
+);
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_RefreshAddressFilterSync(
+	PBTHPS3_SERVER_CONTEXT DevCtx
+);
+
 _IRQL_requires_max_(DISPATCH_LEVEL)
 NTSTATUS
 BthPS3PSM_EnablePatchAsync(
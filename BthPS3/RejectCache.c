@@ -0,0 +1,132 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "RejectCache.h"
+#else
+#include "Driver.h"
+#endif
+
+
+VOID
+BthPS3_RejectCacheInit(
+	PBTHPS3_REJECT_CACHE Cache
+)
+{
+	RtlZeroMemory(Cache, sizeof(BTHPS3_REJECT_CACHE));
+}
+
+BOOLEAN
+BthPS3_RejectCacheContains(
+	PBTHPS3_REJECT_CACHE Cache,
+	BTH_ADDR RemoteAddress,
+	ULONG64 Now
+)
+{
+	for (ULONG index = 0; index < BTHPS3_REJECT_CACHE_ENTRIES; index++)
+	{
+		const PBTHPS3_REJECT_CACHE_ENTRY entry = &Cache->Entries[index];
+
+		if ((BTH_ADDR)ReadAcquire64(&entry->RemoteAddress) != RemoteAddress)
+		{
+			continue;
+		}
+
+		const ULONG64 expiry = (ULONG64)ReadAcquire64(&entry->Expiry);
+
+		//
+		// A writer clears the expiry before changing the address, if the
+		// address still matches the expiry belongs to this device
+		// 
+		if ((BTH_ADDR)ReadAcquire64(&entry->RemoteAddress) == RemoteAddress
+			&& Now < expiry)
+		{
+			InterlockedIncrement64(&Cache->Hits);
+			return TRUE;
+		}
+
+		//
+		// Writers never store an address twice
+		// 
+		break;
+	}
+
+	return FALSE;
+}
+
+VOID
+BthPS3_RejectCacheInsert(
+	PBTHPS3_REJECT_CACHE Cache,
+	BTH_ADDR RemoteAddress,
+	ULONG64 Expiry
+)
+{
+	PBTHPS3_REJECT_CACHE_ENTRY victim = &Cache->Entries[0];
+
+	for (ULONG index = 0; index < BTHPS3_REJECT_CACHE_ENTRIES; index++)
+	{
+		const PBTHPS3_REJECT_CACHE_ENTRY entry = &Cache->Entries[index];
+
+		if ((BTH_ADDR)entry->RemoteAddress == RemoteAddress)
+		{
+			InterlockedExchange64(&entry->Expiry, (LONG64)Expiry);
+			InterlockedIncrement64(&Cache->Inserts);
+			return;
+		}
+
+		//
+		// Free entries have no expiry and are picked first
+		// 
+		if ((ULONG64)entry->Expiry < (ULONG64)victim->Expiry)
+		{
+			victim = entry;
+		}
+	}
+
+	//
+	// Interlocked operations are full barriers, readers that see the new
+	// address see either no expiry or the new one
+	// 
+	InterlockedExchange64(&victim->Expiry, 0);
+	InterlockedExchange64(&victim->RemoteAddress, (LONG64)RemoteAddress);
+	InterlockedExchange64(&victim->Expiry, (LONG64)Expiry);
+
+	InterlockedIncrement64(&Cache->Inserts);
+}
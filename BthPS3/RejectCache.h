@@ -0,0 +1,108 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#pragma once
+
+//
+// Remembers remote devices recently denied for not being identified so
+// their retries get dropped without querying the radio again. Lookups
+// don't take a lock and may run concurrently with a writer, callers
+// serialize writers. Only depends on basic types and interlocked
+// operations so the logic can be built and exercised outside the driver.
+// 
+
+#define BTHPS3_REJECT_CACHE_ENTRIES     32
+
+typedef struct _BTHPS3_REJECT_CACHE_ENTRY
+{
+	//
+	// 0 while free
+	// 
+	volatile LONG64 RemoteAddress;
+
+	//
+	// Interrupt time (100ns units) the entry stops applying at, 0 while
+	// being replaced
+	// 
+	volatile LONG64 Expiry;
+
+} BTHPS3_REJECT_CACHE_ENTRY, * PBTHPS3_REJECT_CACHE_ENTRY;
+
+typedef struct _BTHPS3_REJECT_CACHE
+{
+	//
+	// Connection attempts answered from the cache
+	// 
+	volatile LONG64 Hits;
+
+	//
+	// Devices added or refreshed
+	// 
+	volatile LONG64 Inserts;
+
+	BTHPS3_REJECT_CACHE_ENTRY Entries[BTHPS3_REJECT_CACHE_ENTRIES];
+
+} BTHPS3_REJECT_CACHE, * PBTHPS3_REJECT_CACHE;
+
+
+VOID
+BthPS3_RejectCacheInit(
+	_Out_ PBTHPS3_REJECT_CACHE Cache
+);
+
+//
+// Returns TRUE if the device got denied and its entry didn't expire by Now
+// 
+BOOLEAN
+BthPS3_RejectCacheContains(
+	_Inout_ PBTHPS3_REJECT_CACHE Cache,
+	_In_ BTH_ADDR RemoteAddress,
+	_In_ ULONG64 Now
+);
+
+//
+// Adds or refreshes the device, replacing the entry closest to expiry
+// once all are taken
+// 
+VOID
+BthPS3_RejectCacheInsert(
+	_Inout_ PBTHPS3_REJECT_CACHE Cache,
+	_In_ BTH_ADDR RemoteAddress,
+	_In_ ULONG64 Expiry
+);
@@ -0,0 +1,276 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// Bitmap helpers for the PDO serial number slots. Only depend on basic
+// types so the allocation logic can be built and exercised outside the driver.
+// 
+
+#define BTHPS3_SLOT_BITMAP_BITS_PER_WORD	32
+
+FORCEINLINE
+VOID
+BthPS3_SlotBitmapSet(
+	_Inout_ UINT32* Bitmap,
+	_In_ ULONG Slot
+)
+{
+	Bitmap[Slot / BTHPS3_SLOT_BITMAP_BITS_PER_WORD] |= (1U << (Slot % BTHPS3_SLOT_BITMAP_BITS_PER_WORD));
+}
+
+FORCEINLINE
+VOID
+BthPS3_SlotBitmapClear(
+	_Inout_ UINT32* Bitmap,
+	_In_ ULONG Slot
+)
+{
+	Bitmap[Slot / BTHPS3_SLOT_BITMAP_BITS_PER_WORD] &= ~(1U << (Slot % BTHPS3_SLOT_BITMAP_BITS_PER_WORD));
+}
+
+FORCEINLINE
+BOOLEAN
+BthPS3_SlotBitmapTest(
+	_In_ const UINT32* Bitmap,
+	_In_ ULONG Slot
+)
+{
+	return (Bitmap[Slot / BTHPS3_SLOT_BITMAP_BITS_PER_WORD] & (1U << (Slot % BTHPS3_SLOT_BITMAP_BITS_PER_WORD))) != 0;
+}
+
+//
+// Index of the lowest clear bit of a word that has at least one clear bit
+// 
+FORCEINLINE
+ULONG
+BthPS3_SlotBitmapLowestClear(
+	_In_ UINT32 Word
+)
+{
+	static const UCHAR positions[32] =
+	{
+		0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+		31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+	};
+	const UINT32 clear = ~Word;
+
+	//
+	// Isolate the lowest set bit of the inverted word and map it via de Bruijn multiplication
+	// 
+	return positions[(UINT32)((clear & (0U - clear)) * 0x077CB531U) >> 27];
+}
+
+//
+// Two-level slot map, a summary bit is set once its leaf word is fully
+// occupied so finding a clear slot never looks at more than
+// BTHPS3_SLOT_MAP_SUMMARY_WORDS + 1 words
+// 
+#define BTHPS3_SLOT_MAP_SUMMARY_WORDS		4
+#define BTHPS3_SLOT_MAP_MAX_SLOTS			(BTHPS3_SLOT_MAP_SUMMARY_WORDS * BTHPS3_SLOT_BITMAP_BITS_PER_WORD * BTHPS3_SLOT_BITMAP_BITS_PER_WORD)
+
+typedef struct _BTHPS3_SLOT_MAP
+{
+	//
+	// Leaf bitmap holding Capacity bits
+	// 
+	UINT32* Words;
+
+	//
+	// Number of slots, multiple of BTHPS3_SLOT_BITMAP_BITS_PER_WORD
+	// 
+	ULONG Capacity;
+
+	//
+	// One bit per leaf word, words beyond Capacity count as full
+	// 
+	UINT32 Summary[BTHPS3_SLOT_MAP_SUMMARY_WORDS];
+
+} BTHPS3_SLOT_MAP, * PBTHPS3_SLOT_MAP;
+
+FORCEINLINE
+VOID
+BthPS3_SlotMapSet(
+	_Inout_ PBTHPS3_SLOT_MAP Map,
+	_In_ ULONG Slot
+)
+{
+	const ULONG word = Slot / BTHPS3_SLOT_BITMAP_BITS_PER_WORD;
+
+	BthPS3_SlotBitmapSet(Map->Words, Slot);
+
+	if (Map->Words[word] == 0xFFFFFFFF)
+	{
+		BthPS3_SlotBitmapSet(Map->Summary, word);
+	}
+}
+
+FORCEINLINE
+VOID
+BthPS3_SlotMapClear(
+	_Inout_ PBTHPS3_SLOT_MAP Map,
+	_In_ ULONG Slot
+)
+{
+	BthPS3_SlotBitmapClear(Map->Words, Slot);
+	BthPS3_SlotBitmapClear(Map->Summary, Slot / BTHPS3_SLOT_BITMAP_BITS_PER_WORD);
+}
+
+FORCEINLINE
+BOOLEAN
+BthPS3_SlotMapTest(
+	_In_ const BTHPS3_SLOT_MAP* Map,
+	_In_ ULONG Slot
+)
+{
+	return Slot < Map->Capacity && BthPS3_SlotBitmapTest(Map->Words, Slot);
+}
+
+//
+// Recomputes the summary after the leaf words got replaced or resized
+// 
+FORCEINLINE
+VOID
+BthPS3_SlotMapRebuildSummary(
+	_Inout_ PBTHPS3_SLOT_MAP Map
+)
+{
+	ULONG word;
+	const ULONG words = Map->Capacity / BTHPS3_SLOT_BITMAP_BITS_PER_WORD;
+
+	for (word = 0; word < BTHPS3_SLOT_MAP_SUMMARY_WORDS * BTHPS3_SLOT_BITMAP_BITS_PER_WORD; word++)
+	{
+		if (word >= words || Map->Words[word] == 0xFFFFFFFF)
+		{
+			BthPS3_SlotBitmapSet(Map->Summary, word);
+		}
+		else
+		{
+			BthPS3_SlotBitmapClear(Map->Summary, word);
+		}
+	}
+}
+
+//
+// Returns the lowest clear slot or Map->Capacity if all are occupied
+// 
+FORCEINLINE
+ULONG
+BthPS3_SlotMapFindClear(
+	_In_ const BTHPS3_SLOT_MAP* Map
+)
+{
+	ULONG index;
+
+	for (index = 0; index < BTHPS3_SLOT_MAP_SUMMARY_WORDS; index++)
+	{
+		if (Map->Summary[index] != 0xFFFFFFFF)
+		{
+			const ULONG word = (index * BTHPS3_SLOT_BITMAP_BITS_PER_WORD)
+				+ BthPS3_SlotBitmapLowestClear(Map->Summary[index]);
+
+			return (word * BTHPS3_SLOT_BITMAP_BITS_PER_WORD)
+				+ BthPS3_SlotBitmapLowestClear(Map->Words[word]);
+		}
+	}
+
+	return Map->Capacity;
+}
+
+//
+// Picks the slot to take over once the map can't grow any further: the
+// one of the least recently connected cached device that isn't present
+// 
+typedef struct _BTHPS3_SLOT_RECLAIM
+{
+	//
+	// Slots at or beyond this can't be handed out
+	// 
+	ULONG Capacity;
+
+	//
+	// Best candidate so far, zero if none
+	// 
+	ULONG OldestSlot;
+
+	//
+	// DEVPKEY_Bluetooth_LastConnectedTime of the best candidate
+	// 
+	ULONG64 OldestTime;
+
+} BTHPS3_SLOT_RECLAIM, * PBTHPS3_SLOT_RECLAIM;
+
+FORCEINLINE
+VOID
+BthPS3_SlotReclaimInit(
+	_Out_ PBTHPS3_SLOT_RECLAIM Reclaim,
+	_In_ ULONG Capacity
+)
+{
+	Reclaim->Capacity = Capacity;
+	Reclaim->OldestSlot = 0;
+	Reclaim->OldestTime = MAXULONG64;
+}
+
+//
+// TRUE if a cached device is a better candidate than the current one,
+// checked before the more expensive presence lookup. Slot 0 is never
+// handed out and devices cached without a time count as oldest.
+// 
+FORCEINLINE
+BOOLEAN
+BthPS3_SlotReclaimIsOlder(
+	_In_ const BTHPS3_SLOT_RECLAIM* Reclaim,
+	_In_ ULONG Slot,
+	_In_ ULONG64 LastConnectedTime
+)
+{
+	return Slot > 0 && Slot < Reclaim->Capacity && LastConnectedTime < Reclaim->OldestTime;
+}
+
+FORCEINLINE
+VOID
+BthPS3_SlotReclaimTake(
+	_Inout_ PBTHPS3_SLOT_RECLAIM Reclaim,
+	_In_ ULONG Slot,
+	_In_ ULONG64 LastConnectedTime
+)
+{
+	Reclaim->OldestSlot = Slot;
+	Reclaim->OldestTime = LastConnectedTime;
+}
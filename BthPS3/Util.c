@@ -36,7 +36,6 @@
 
 
 #include "Driver.h"
-#include <ntstrsafe.h>
 #include "util.tmh"
 
 //
@@ -48,9 +47,7 @@ StringUtil_BthNameIsEqual(
     WDFSTRING Rhs
 )
 {
-    NTSTATUS status;
     UNICODE_STRING usRhs;
-    DECLARE_UNICODE_STRING_SIZE(usLhs, BTH_MAX_NAME_SIZE);
 
     //
     // WDFSTRING to UNICODE_STRING
@@ -60,28 +57,20 @@ StringUtil_BthNameIsEqual(
         &usRhs
     );
 
-    //
-    // CHAR to UNICODE_STRING
-    // 
-    if (!NT_SUCCESS(status = RtlUnicodeStringPrintf(&usLhs, L"%hs", Lhs))) 
-    {
-        TraceError(
-            TRACE_UTIL,
-            "RtlUnicodeStringPrintf failed with status %!STATUS!",
-            status
-        );
-    }
-
     TraceVerbose(
         TRACE_UTIL,
-        "LHS: \"%wZ\" RHS: \"%wZ\"",
-        &usLhs, &usRhs
+        "LHS: \"%s\" RHS: \"%wZ\"",
+        Lhs, &usRhs
     );
 
     //
     // Compare case-insensitive
     // 
-    return RtlEqualUnicodeString(&usLhs, &usRhs, TRUE);
+    return BthPS3_NameMatchIsEqual(
+        Lhs,
+        usRhs.Buffer,
+        usRhs.Length / sizeof(WCHAR)
+    );
 }
 
 //
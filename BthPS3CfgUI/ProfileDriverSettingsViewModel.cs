@@ -2,6 +2,7 @@
 using System.ComponentModel;
 using System.Diagnostics.CodeAnalysis;
 using System.Runtime.CompilerServices;
+using System.Threading.Tasks;
 using System.Windows.Threading;
 
 using Microsoft.Win32;
@@ -32,11 +33,14 @@ public class ProfileDriverSettingsViewModel : INotifyPropertyChanged
         if (BluetoothHelper.IsBluetoothRadioAvailable)
         {
             //
-            // Periodically refresh patch state value
+            // Refresh patch state value whenever the filter reports a change
             // 
             _dispatcherTimer = new DispatcherTimer { Interval = new TimeSpan(0, 0, 1) };
             _dispatcherTimer.Tick += DispatcherTimerOnTick;
-            _dispatcherTimer.Start();
+
+            Dispatcher dispatcher = Dispatcher.CurrentDispatcher;
+
+            Task.Factory.StartNew(() => WatchPatchState(dispatcher), TaskCreationOptions.LongRunning);
         }
     }
 
@@ -54,6 +58,29 @@ public class ProfileDriverSettingsViewModel : INotifyPropertyChanged
 
     public event PropertyChangedEventHandler PropertyChanged;
 
+    private void WatchPatchState(Dispatcher dispatcher)
+    {
+        ulong sequence = 0;
+
+        try
+        {
+            while (true)
+            {
+                FilterDriver.WaitForPatchStateChange(ref sequence, out _);
+
+                dispatcher.BeginInvoke(new Action(() =>
+                    PropertyChanged?.Invoke(this, new PropertyChangedEventArgs("IsPSMPatchEnabled"))));
+            }
+        }
+        catch
+        {
+            //
+            // Filter doesn't support notifications (or went away), fall back to polling
+            // 
+            dispatcher.BeginInvoke(new Action(() => _dispatcherTimer.Start()));
+        }
+    }
+
     private void DispatcherTimerOnTick(object sender, EventArgs e)
     {
         //
@@ -0,0 +1,231 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include "Driver.h"
+#include "AddressFilter.tmh"
+#include <BthPS3PSMETW.h>
+
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, BthPS3PSM_AddressFilterInitialize)
+#endif
+
+
+_Use_decl_annotations_
+NTSTATUS
+BthPS3PSM_AddressFilterInitialize(
+    WDFDEVICE Device,
+    PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter
+)
+{
+    NTSTATUS status;
+    WDF_OBJECT_ATTRIBUTES attributes;
+
+    PAGED_CODE();
+
+    RtlZeroMemory(Filter, sizeof(BTHPS3PSM_DEVICE_ADDRESS_FILTER));
+
+    BthPS3PSM_PatchPolicyInit(&Filter->Policy);
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = Device;
+
+    if (!NT_SUCCESS(status = WdfSpinLockCreate(
+        &attributes,
+        &Filter->Lock
+    )))
+    {
+        TraceError(
+            TRACE_ADDRESS_FILTER,
+            "WdfSpinLockCreate failed with status %!STATUS!",
+            status
+        );
+        EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfSpinLockCreate", status);
+    }
+
+    return status;
+}
+
+//
+// Replaces the allow-list, takes effect with the next connection request
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_AddressFilterSetAddresses(
+    PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter,
+    const ULONGLONG* Addresses,
+    ULONG AddressCount
+)
+{
+    WdfSpinLockAcquire(Filter->Lock);
+    BthPS3PSM_PatchPolicySetAddresses(&Filter->Policy, Addresses, AddressCount);
+    WdfSpinLockRelease(Filter->Lock);
+
+    TraceVerbose(
+        TRACE_ADDRESS_FILTER,
+        "Allow-list replaced with %d addresses",
+        min(AddressCount, BTHPS3PSM_ADDRESS_FILTER_MAX_ADDRESSES)
+    );
+}
+
+//
+// Feeds an event pipe transfer to the tracker, NULL signals a failed transfer
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_AddressFilterProcessEvents(
+    PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter,
+    const UCHAR* Buffer,
+    ULONG Length
+)
+{
+    WdfSpinLockAcquire(Filter->Lock);
+    BthPS3PSM_PatchPolicyProcessEvents(&Filter->Policy, Buffer, Length);
+    WdfSpinLockRelease(Filter->Lock);
+}
+
+//
+// Patching got suspended because of Address, watch it for re-arming.
+// Returns FALSE if too many remotes are being watched already.
+// 
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_AddressFilterSuspendFor(
+    PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter,
+    ULONGLONG Address
+)
+{
+    BOOLEAN isSuspended;
+
+    WdfSpinLockAcquire(Filter->Lock);
+    isSuspended = BthPS3PSM_PatchPolicySuspendFor(&Filter->Policy, Address);
+    WdfSpinLockRelease(Filter->Lock);
+
+    if (isSuspended)
+    {
+        TraceVerbose(
+            TRACE_ADDRESS_FILTER,
+            "Patching suspended for remote %012llX",
+            Address
+        );
+    }
+    else
+    {
+        TraceEvents(
+            TRACE_LEVEL_WARNING,
+            TRACE_ADDRESS_FILTER,
+            "Too many suspended remotes, not watching %012llX",
+            Address
+        );
+    }
+
+    return isSuspended;
+}
+
+//
+// Forgets about all suspensions, e.g. once patching got enabled explicitly
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_AddressFilterResume(
+    PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter
+)
+{
+    WdfSpinLockAcquire(Filter->Lock);
+    BthPS3PSM_PatchPolicyResume(&Filter->Policy);
+    WdfSpinLockRelease(Filter->Lock);
+}
+
+//
+// Returns TRUE if a suspended remote lost its link mid-attempt
+// 
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_AddressFilterOnLinkLoss(
+    PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter
+)
+{
+    BOOLEAN rearm;
+
+    WdfSpinLockAcquire(Filter->Lock);
+    rearm = BthPS3PSM_PatchPolicyOnLinkLoss(&Filter->Policy);
+    WdfSpinLockRelease(Filter->Lock);
+
+    return rearm;
+}
+
+//
+// Runs the per-packet patch decision of a bulk IN transfer
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_AddressFilterProcessAcl(
+    PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter,
+    PBTHPS3PSM_DEVICE_PSM_REMAP Remap,
+    BOOLEAN IsPatchingEnabled,
+    PUCHAR Buffer,
+    ULONG Length,
+    PBTHPS3PSM_PATCH_RESULT Result
+)
+{
+    //
+    // Keeps HID data, the bulk of all transfers, off the locks
+    // 
+    if (!L2CAP_IS_SIGNALLING_PACKET(Buffer, Length))
+    {
+        RtlZeroMemory(Result, sizeof(BTHPS3PSM_PATCH_RESULT));
+        return;
+    }
+
+    //
+    // Same order everywhere both get taken: remap table first
+    // 
+    WdfSpinLockAcquire(Remap->Lock);
+    WdfSpinLockAcquire(Filter->Lock);
+
+    BthPS3PSM_PatchPolicyProcessAcl(
+        &Filter->Policy,
+        Remap->Table,
+        IsPatchingEnabled,
+        Buffer,
+        Length,
+        Result
+    );
+
+    WdfSpinLockRelease(Filter->Lock);
+    WdfSpinLockRelease(Remap->Lock);
+}
@@ -0,0 +1,113 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+#include "PatchPolicy.h"
+
+//
+// Remote addresses whose connections get patched regardless of the
+// radio-wide patch state
+// 
+typedef struct _BTHPS3PSM_DEVICE_ADDRESS_FILTER
+{
+    //
+    // Guards Policy, updated from event and data pipe completions
+    // 
+    WDFSPINLOCK Lock;
+
+    //
+    // ACL links, allow-list and suspension state
+    // 
+    BTHPS3PSM_PATCH_POLICY Policy;
+
+} BTHPS3PSM_DEVICE_ADDRESS_FILTER, * PBTHPS3PSM_DEVICE_ADDRESS_FILTER;
+
+
+_Must_inspect_result_
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_AddressFilterInitialize(
+    _In_ WDFDEVICE Device,
+    _Out_ PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_AddressFilterSetAddresses(
+    _Inout_ PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter,
+    _In_reads_(AddressCount) const ULONGLONG* Addresses,
+    _In_ ULONG AddressCount
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_AddressFilterProcessEvents(
+    _Inout_ PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter,
+    _In_reads_bytes_opt_(Length) const UCHAR* Buffer,
+    _In_ ULONG Length
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BthPS3PSM_AddressFilterSuspendFor(
+    _Inout_ PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter,
+    _In_ ULONGLONG Address
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_AddressFilterResume(
+    _Inout_ PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BthPS3PSM_AddressFilterOnLinkLoss(
+    _Inout_ PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_AddressFilterProcessAcl(
+    _Inout_ PBTHPS3PSM_DEVICE_ADDRESS_FILTER Filter,
+    _In_ PBTHPS3PSM_DEVICE_PSM_REMAP Remap,
+    _In_ BOOLEAN IsPatchingEnabled,
+    _Inout_updates_bytes_(Length) PUCHAR Buffer,
+    _In_ ULONG Length,
+    _Out_ PBTHPS3PSM_PATCH_RESULT Result
+);
@@ -0,0 +1,211 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include "Driver.h"
+#include "Capture.tmh"
+#include <BthPS3PSMETW.h>
+
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, BthPS3PSM_CaptureEnable)
+#endif
+
+
+//
+// Starts recording packets, allocates the ring on first use
+// 
+_Use_decl_annotations_
+NTSTATUS
+BthPS3PSM_CaptureEnable(
+    WDFDEVICE Device,
+    PBTHPS3PSM_CAPTURE Capture,
+    ULONG SnapLength
+)
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    PVOID buffer;
+
+    FuncEntry(TRACE_CAPTURE);
+
+    PAGED_CODE();
+
+    do
+    {
+        if (SnapLength == 0)
+        {
+            SnapLength = BTHPS3PSM_CAPTURE_DEFAULT_SNAP_LEN;
+        }
+
+        if (SnapLength > BTHPS3PSM_CAPTURE_MAX_SNAP_LEN)
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Memory stays around until the device is gone so producers
+        // never race against a free when capture gets disabled
+        // 
+        if (Capture->Ring.Slots == NULL)
+        {
+            WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+            attributes.ParentObject = Device;
+
+            if (!NT_SUCCESS(status = WdfMemoryCreate(
+                &attributes,
+                NonPagedPoolNx,
+                BTHPS3PSM_POOL_TAG,
+                sizeof(BTHPS3PSM_CAPTURE_SLOT) * BTHPS3PSM_CAPTURE_SLOT_COUNT,
+                &Capture->Memory,
+                &buffer
+            )))
+            {
+                TraceError(
+                    TRACE_CAPTURE,
+                    "WdfMemoryCreate failed with status %!STATUS!",
+                    status
+                );
+                EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfMemoryCreate", status);
+                break;
+            }
+
+            RtlZeroMemory(buffer, sizeof(BTHPS3PSM_CAPTURE_SLOT) * BTHPS3PSM_CAPTURE_SLOT_COUNT);
+
+            Capture->Ring.Slots = (PBTHPS3PSM_CAPTURE_SLOT)buffer;
+        }
+
+        InterlockedExchange(&Capture->Ring.SnapLength, (LONG)SnapLength);
+        InterlockedExchange(&Capture->IsEnabled, TRUE);
+
+        TraceInformation(
+            TRACE_CAPTURE,
+            "Capture enabled with snap length %d",
+            SnapLength
+        );
+    }
+    while (FALSE);
+
+    FuncExit(TRACE_CAPTURE, "status=%!STATUS!", status);
+
+    return status;
+}
+
+//
+// Stops recording packets, already captured ones can still get drained
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_CaptureDisable(
+    PBTHPS3PSM_CAPTURE Capture
+)
+{
+    InterlockedExchange(&Capture->IsEnabled, FALSE);
+
+    TraceInformation(
+        TRACE_CAPTURE,
+        "Capture disabled"
+    );
+}
+
+//
+// Records a packet if capture is enabled
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_CaptureRecord(
+    PBTHPS3PSM_CAPTURE Capture,
+    UCHAR Direction,
+    UCHAR PacketType,
+    PUCHAR Buffer,
+    ULONG Length
+)
+{
+    LARGE_INTEGER timestamp;
+    KIRQL oldIrql;
+
+    if (!ReadNoFence(&Capture->IsEnabled))
+    {
+        return;
+    }
+
+    //
+    // Can't get preempted by a producer spinning on the slot we own
+    // 
+    KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+
+    KeQuerySystemTimePrecise(&timestamp);
+
+    BthPS3PSM_CaptureRingPush(
+        &Capture->Ring,
+        (ULONG64)timestamp.QuadPart,
+        Direction,
+        PacketType,
+        Buffer,
+        Length
+    );
+
+    KeLowerIrql(oldIrql);
+}
+
+//
+// Moves as many published packets as fit into the supplied buffer
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_CaptureDrain(
+    PBTHPS3PSM_CAPTURE Capture,
+    PUCHAR Buffer,
+    size_t Length,
+    size_t* BytesWritten,
+    PULONG RecordCount,
+    PULONG64 DroppedCount
+)
+{
+    FuncEntry(TRACE_CAPTURE);
+
+    BthPS3PSM_CaptureRingDrain(
+        &Capture->Ring,
+        Buffer,
+        Length,
+        BytesWritten,
+        RecordCount,
+        DroppedCount
+    );
+
+    FuncExit(TRACE_CAPTURE, "records=%d", *RecordCount);
+}
@@ -0,0 +1,96 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+#include "CaptureRing.h"
+
+//
+// Opt-in packet capture of a filter device
+// 
+typedef struct _BTHPS3PSM_CAPTURE
+{
+    //
+    // Memory object backing the ring slots, allocated on first enable
+    // 
+    WDFMEMORY Memory;
+
+    //
+    // Producers skip recording if FALSE
+    // 
+    volatile LONG IsEnabled;
+
+    BTHPS3PSM_CAPTURE_RING Ring;
+
+} BTHPS3PSM_CAPTURE, * PBTHPS3PSM_CAPTURE;
+
+
+_Must_inspect_result_
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_CaptureEnable(
+    _In_ WDFDEVICE Device,
+    _Inout_ PBTHPS3PSM_CAPTURE Capture,
+    _In_ ULONG SnapLength
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_CaptureDisable(
+    _Inout_ PBTHPS3PSM_CAPTURE Capture
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_CaptureRecord(
+    _Inout_ PBTHPS3PSM_CAPTURE Capture,
+    _In_ UCHAR Direction,
+    _In_ UCHAR PacketType,
+    _In_reads_bytes_(Length) PUCHAR Buffer,
+    _In_ ULONG Length
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_CaptureDrain(
+    _Inout_ PBTHPS3PSM_CAPTURE Capture,
+    _Out_writes_bytes_to_(Length, *BytesWritten) PUCHAR Buffer,
+    _In_ size_t Length,
+    _Out_ size_t* BytesWritten,
+    _Out_ PULONG RecordCount,
+    _Out_ PULONG64 DroppedCount
+);
@@ -0,0 +1,205 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "CaptureRing.h"
+#else
+#include "Driver.h"
+#endif
+
+
+//
+// Copies a packet into the next free slot, overwriting the oldest if full
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_CaptureRingPush(
+    PBTHPS3PSM_CAPTURE_RING Ring,
+    ULONG64 Timestamp,
+    UCHAR Direction,
+    UCHAR PacketType,
+    PUCHAR Buffer,
+    ULONG Length
+)
+{
+    LONG64 sequence;
+
+    //
+    // Claiming an index is the only contended operation
+    // 
+    const LONG64 index = InterlockedIncrement64(&Ring->WriteIndex) - 1;
+    const PBTHPS3PSM_CAPTURE_SLOT pSlot = &Ring->Slots[index & (BTHPS3PSM_CAPTURE_SLOT_COUNT - 1)];
+    const ULONG captured = min(Length, (ULONG)ReadNoFence(&Ring->SnapLength));
+
+    //
+    // Producers a lap apart share the slot, the newest packet wins and
+    // only its owner writes the payload
+    // 
+    for (;;)
+    {
+        sequence = InterlockedCompareExchange64(&pSlot->Sequence, 0, 0);
+
+        //
+        // Owned by an older packet, its producer is about to publish
+        // 
+        if (sequence < 0 && -sequence < index + 1)
+        {
+            YieldProcessor();
+            continue;
+        }
+
+        //
+        // A newer packet got here first, ours counts as overwritten
+        // 
+        if (sequence < 0 || sequence > index + 1)
+        {
+            return;
+        }
+
+        //
+        // Mark busy so the consumer doesn't pick up a half-written slot
+        // 
+        if (InterlockedCompareExchange64(&pSlot->Sequence, -(index + 1), sequence) == sequence)
+        {
+            break;
+        }
+    }
+
+    pSlot->Record.Timestamp = Timestamp;
+    pSlot->Record.OriginalLength = Length;
+    pSlot->Record.CapturedLength = (USHORT)captured;
+    pSlot->Record.Direction = Direction;
+    pSlot->Record.PacketType = PacketType;
+
+    RtlCopyMemory(pSlot->Data, Buffer, captured);
+
+    //
+    // Publish
+    // 
+    InterlockedExchange64(&pSlot->Sequence, index + 1);
+}
+
+//
+// Moves as many published packets as fit into the supplied buffer
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_CaptureRingDrain(
+    PBTHPS3PSM_CAPTURE_RING Ring,
+    PUCHAR Buffer,
+    size_t Length,
+    size_t* BytesWritten,
+    PULONG RecordCount,
+    PULONG64 DroppedCount
+)
+{
+    size_t offset = 0;
+    ULONG count = 0;
+
+    if (Ring->Slots != NULL)
+    {
+        const LONG64 writeIndex = InterlockedCompareExchange64(&Ring->WriteIndex, 0, 0);
+
+        //
+        // Producers lapped us, skip what got overwritten
+        // 
+        if (writeIndex - Ring->ReadIndex > BTHPS3PSM_CAPTURE_SLOT_COUNT)
+        {
+            Ring->DroppedCount += (ULONG64)(writeIndex - Ring->ReadIndex - BTHPS3PSM_CAPTURE_SLOT_COUNT);
+            Ring->ReadIndex = writeIndex - BTHPS3PSM_CAPTURE_SLOT_COUNT;
+        }
+
+        while (Ring->ReadIndex < writeIndex)
+        {
+            const PBTHPS3PSM_CAPTURE_SLOT pSlot = &Ring->Slots[Ring->ReadIndex & (BTHPS3PSM_CAPTURE_SLOT_COUNT - 1)];
+            const LONG64 sequence = InterlockedCompareExchange64(&pSlot->Sequence, 0, 0);
+
+            //
+            // Still being written, pick it up next time
+            // 
+            if (sequence <= 0 || sequence < Ring->ReadIndex + 1)
+            {
+                break;
+            }
+
+            //
+            // Already reused by a newer packet
+            // 
+            if (sequence > Ring->ReadIndex + 1)
+            {
+                Ring->DroppedCount++;
+                Ring->ReadIndex++;
+                continue;
+            }
+
+            const BTHPS3PSM_CAPTURE_RECORD record = pSlot->Record;
+            const size_t recordSize = sizeof(BTHPS3PSM_CAPTURE_RECORD) + record.CapturedLength;
+
+            if (Length - offset < recordSize)
+            {
+                break;
+            }
+
+            RtlCopyMemory(&Buffer[offset], &record, sizeof(BTHPS3PSM_CAPTURE_RECORD));
+            RtlCopyMemory(&Buffer[offset + sizeof(BTHPS3PSM_CAPTURE_RECORD)], pSlot->Data, record.CapturedLength);
+
+            //
+            // Discard the copy if a producer overwrote the slot meanwhile
+            // 
+            if (InterlockedCompareExchange64(&pSlot->Sequence, 0, 0) != sequence)
+            {
+                Ring->DroppedCount++;
+            }
+            else
+            {
+                offset += recordSize;
+                count++;
+            }
+
+            Ring->ReadIndex++;
+        }
+    }
+
+    *BytesWritten = offset;
+    *RecordCount = count;
+    *DroppedCount = Ring->DroppedCount;
+
+    Ring->DroppedCount = 0;
+}
@@ -0,0 +1,117 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#pragma once
+
+//
+// Number of packets the ring can hold (must be a power of two)
+// 
+#define BTHPS3PSM_CAPTURE_SLOT_COUNT    0x200
+
+//
+// Single ring entry
+// 
+typedef struct _BTHPS3PSM_CAPTURE_SLOT
+{
+    //
+    // Write index + 1 once published, negated while the producer owning
+    // the slot is filling it, 0 if never written
+    // 
+    volatile LONG64 Sequence;
+
+    BTHPS3PSM_CAPTURE_RECORD Record;
+
+    UCHAR Data[BTHPS3PSM_CAPTURE_MAX_SNAP_LEN];
+
+} BTHPS3PSM_CAPTURE_SLOT, * PBTHPS3PSM_CAPTURE_SLOT;
+
+//
+// Multi-producer, single-consumer packet ring
+// 
+typedef struct _BTHPS3PSM_CAPTURE_RING
+{
+    //
+    // Array of BTHPS3PSM_CAPTURE_SLOT_COUNT zeroed elements
+    // 
+    PBTHPS3PSM_CAPTURE_SLOT Slots;
+
+    //
+    // Bytes to copy per packet
+    // 
+    volatile LONG SnapLength;
+
+    //
+    // Next index to claim by producers
+    // 
+    volatile LONG64 WriteIndex;
+
+    //
+    // Next index to drain, only touched by the (sequential) consumer
+    // 
+    LONG64 ReadIndex;
+
+    //
+    // Packets overwritten before they could get drained
+    // 
+    ULONG64 DroppedCount;
+
+} BTHPS3PSM_CAPTURE_RING, * PBTHPS3PSM_CAPTURE_RING;
+
+
+_IRQL_requires_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_CaptureRingPush(
+    _Inout_ PBTHPS3PSM_CAPTURE_RING Ring,
+    _In_ ULONG64 Timestamp,
+    _In_ UCHAR Direction,
+    _In_ UCHAR PacketType,
+    _In_reads_bytes_(Length) PUCHAR Buffer,
+    _In_ ULONG Length
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_CaptureRingDrain(
+    _Inout_ PBTHPS3PSM_CAPTURE_RING Ring,
+    _Out_writes_bytes_to_(Length, *BytesWritten) PUCHAR Buffer,
+    _In_ size_t Length,
+    _Out_ size_t* BytesWritten,
+    _Out_ PULONG RecordCount,
+    _Out_ PULONG64 DroppedCount
+);
@@ -148,6 +148,37 @@ BthPS3PSM_CreateDevice(
 
         deviceContext->InstanceId = instanceId;
 
+        //
+        // Per-processor counters must exist before the first URB arrives
+        //
+        if (!NT_SUCCESS(status = BthPS3PSM_StatisticsInitialize(
+            device,
+            &deviceContext->Statistics
+        )))
+        {
+            TraceError(
+                TRACE_DEVICE,
+                "BthPS3PSM_StatisticsInitialize failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"BthPS3PSM_StatisticsInitialize", status);
+            break;
+        }
+
+        if (!NT_SUCCESS(status = BthPS3PSM_AddressFilterInitialize(
+            device,
+            &deviceContext->AddressFilter
+        )))
+        {
+            TraceError(
+                TRACE_DEVICE,
+                "BthPS3PSM_AddressFilterInitialize failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"BthPS3PSM_AddressFilterInitialize", status);
+            break;
+        }
+
 #pragma region Add this device to global collection
 
 #ifdef BTHPS3PSM_WITH_CONTROL_DEVICE
@@ -256,6 +287,24 @@ BthPS3PSM_CreateDevice(
             );
         }
 
+        //
+        // Remap table must exist before the first connection request arrives
+        // 
+        if (!NT_SUCCESS(status = BthPS3PSM_PsmRemapInitialize(
+            device,
+            deviceContext->RegKeyDeviceNode,
+            &deviceContext->PsmRemap
+        )))
+        {
+            TraceError(
+                TRACE_DEVICE,
+                "BthPS3PSM_PsmRemapInitialize failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"BthPS3PSM_PsmRemapInitialize", status);
+            break;
+        }
+
         WDF_OBJECT_ATTRIBUTES_INIT(&stringAttributes);
         stringAttributes.ParentObject = device;
 
@@ -38,6 +38,11 @@
 #pragma once
 
 #include "BthPS3.h"
+#include "Statistics.h"
+#include "Capture.h"
+#include "PsmRemap.h"
+#include "AddressFilter.h"
+#include "PatchState.h"
 #include <usb.h>
 
 EXTERN_C_START
@@ -54,6 +59,11 @@ EXTERN_C_START
 // 
 #define G_SymbolicLinkName  L"SymbolicLinkName"
 
+//
+// PSM remap rules as array of BTHPS3PSM_PSM_REMAP_RULE (REG_BINARY)
+// 
+#define G_PsmRemapRegValue  L"BthPS3PSMRemapRules"
+
 #define MAX_DEVICE_ID_LEN   200
 
 #pragma endregion
@@ -68,6 +78,11 @@ typedef struct _DEVICE_CONTEXT
 	// 
 	USBD_PIPE_HANDLE BulkReadPipe;
 
+	//
+	// USB Interrupt Read (in) handle (HCI events)
+	// 
+	USBD_PIPE_HANDLE InterruptReadPipe;
+
 	//
 	// Patches PSM values if TRUE
 	// 
@@ -88,6 +103,26 @@ typedef struct _DEVICE_CONTEXT
     // 
     WDFKEY RegKeyDeviceNode;
 
+    //
+    // Per-processor traffic counters
+    // 
+    BTHPS3PSM_DEVICE_STATISTICS Statistics;
+
+    //
+    // Opt-in packet capture ring
+    // 
+    BTHPS3PSM_CAPTURE Capture;
+
+    //
+    // Compiled PSM remap rules
+    // 
+    BTHPS3PSM_DEVICE_PSM_REMAP PsmRemap;
+
+    //
+    // Remote addresses patched regardless of IsPsmPatchingEnabled
+    // 
+    BTHPS3PSM_DEVICE_ADDRESS_FILTER AddressFilter;
+
 } DEVICE_CONTEXT, * PDEVICE_CONTEXT;
 
 //
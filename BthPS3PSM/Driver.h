@@ -45,6 +45,8 @@
 // 
 #define BTHPS3PSM_WITH_CONTROL_DEVICE
 
+#define BTHPS3PSM_POOL_TAG  'MSPB'
+
 #include "device.h"
 #include "queue.h"
 #include "trace.h"
@@ -92,7 +92,20 @@ UrbSelectConfigurationCompleted(
                 );
                 // store handle so we later only hook the relevant transfer
                 pDevCtx->BulkReadPipe = pipeInfo->PipeHandle;
-                break;
+            }
+        }
+
+        if (pipeInfo->PipeType == UsbdPipeTypeInterrupt)
+        {
+            if (USB_ENDPOINT_DIRECTION_IN(pipeInfo->EndpointAddress))
+            {
+                TraceInformation(
+                    TRACE_FILTER,
+                    "Found Interrupt IN pipe handle 0x%p for endpoint 0x%02X",
+                    pipeInfo->PipeHandle, pipeInfo->EndpointAddress
+                );
+                // HCI events tell us which remote is behind an ACL handle
+                pDevCtx->InterruptReadPipe = pipeInfo->PipeHandle;
             }
         }
     }
@@ -124,10 +137,14 @@ UrbFunctionBulkInTransferCompleted(
 )
 {
     PUCHAR buffer;
+    KIRQL oldIrql;
+    ULONG64 patched = 0, notPatched = 0;
+    BTHPS3PSM_PATCH_RESULT result;
     UNREFERENCED_PARAMETER(Target);
 
-    FuncEntry(TRACE_FILTER);
+    HotFuncEntry(TRACE_FILTER);
 
+    const LARGE_INTEGER start = KeQueryPerformanceCounter(NULL);
     const WDFDEVICE device = (WDFDEVICE)Context;
     const PDEVICE_CONTEXT pDevCtx = DeviceGetContext(device);
     const PIRP pIrp = WdfRequestWdmGetIrp(Request);
@@ -142,74 +159,151 @@ UrbFunctionBulkInTransferCompleted(
         pTransfer->TransferBufferMDL
     );
 
-    if (
-        bufferLength >= L2CAP_MIN_BUFFER_LEN
-        && L2CAP_IS_CONTROL_CHANNEL(buffer)
-        && L2CAP_IS_SIGNALLING_COMMAND_CODE(buffer)
-    )
+    //
+    // Record the packet as it arrived from the radio, before any patching
+    // 
+    if (buffer != NULL && NT_SUCCESS(Params->IoStatus.Status))
     {
-        const L2CAP_SIGNALLING_COMMAND_CODE code = L2CAP_GET_SIGNALLING_COMMAND_CODE(buffer);
+        BthPS3PSM_CaptureRecord(
+            &pDevCtx->Capture,
+            BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED,
+            BTHPS3PSM_CAPTURE_PACKET_ACL_DATA,
+            buffer,
+            bufferLength
+        );
+    }
 
-        if (code == L2CAP_Connection_Request)
-        {
-            const PL2CAP_SIGNALLING_CONNECTION_REQUEST pConReq = (PL2CAP_SIGNALLING_CONNECTION_REQUEST)&buffer[8];
+    BthPS3PSM_AddressFilterProcessAcl(
+        &pDevCtx->AddressFilter,
+        &pDevCtx->PsmRemap,
+        pDevCtx->IsPsmPatchingEnabled,
+        buffer,
+        bufferLength,
+        &result
+    );
 
-            if (pConReq->PSM == PSM_HID_CONTROL)
-            {
-                TraceVerbose(
-                    TRACE_FILTER,
-                    ">> Connection request for HID Control PSM 0x%04X arrived",
-                    pConReq->PSM
-                );
+    switch (result.Verdict)
+    {
+    case PatchVerdictPatched:
+        TraceInformation(
+            TRACE_FILTER,
+            "++ Patching PSM 0x%04X to 0x%04X",
+            result.OriginalPsm,
+            result.PatchedPsm
+        );
+        patched++;
+        break;
+    case PatchVerdictNotPatched:
+        HotTraceVerbose(
+            TRACE_FILTER,
+            "-- NOT Patching PSM 0x%04X",
+            result.OriginalPsm
+        );
+        notPatched++;
+        break;
+#ifdef BTHPS3PSM_WITH_CONTROL_DEVICE
+    case PatchVerdictRearm:
+        BthPS3PSM_RearmPatchAsync(device);
+        break;
+#endif
+    default:
+        break;
+    }
 
-                if (pDevCtx->IsPsmPatchingEnabled)
-                {
-                    pConReq->PSM = PSM_DS3_HID_CONTROL;
-
-                    TraceInformation(
-                        TRACE_FILTER,
-                        "++ Patching HID Control PSM to 0x%04X",
-                        pConReq->PSM);
-                }
-                else
-                {
-                    TraceVerbose(
-                        TRACE_FILTER,
-                        "-- NOT Patching HID Control PSM"
-                    );
-                }
-            }
+    //
+    // Raise so we stay on this processor's counter block while updating
+    // 
+    KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+    {
+        const PBTHPS3PSM_STATISTICS pStats = BthPS3PSM_StatisticsGetCurrent(&pDevCtx->Statistics);
+        const ULONG64 elapsed = (ULONG64)(KeQueryPerformanceCounter(NULL).QuadPart - start.QuadPart);
 
-            if (pConReq->PSM == PSM_HID_INTERRUPT)
-            {
-                TraceVerbose(
-                    TRACE_FILTER,
-                    ">> Connection request for HID Interrupt PSM 0x%04X arrived",
-                    pConReq->PSM
-                );
+        pStats->BulkInTransfers++;
+        pStats->BulkInBytes += bufferLength;
+        pStats->PsmsPatched += patched;
+        pStats->PsmsNotPatched += notPatched;
+        pStats->CompletionRoutineTicks += elapsed;
 
-                if (pDevCtx->IsPsmPatchingEnabled)
-                {
-                    pConReq->PSM = PSM_DS3_HID_INTERRUPT;
-
-                    TraceInformation(
-                        TRACE_FILTER,
-                        "++ Patching HID Interrupt PSM to 0x%04X",
-                        pConReq->PSM
-                    );
-                }
-                else
-                {
-                    TraceVerbose(
-                        TRACE_FILTER,
-                        "-- NOT Patching HID Interrupt PSM"
-                    );
-                }
-            }
+        if (result.Code != L2CAP_Reserved)
+        {
+            pStats->SignallingCommands[result.Code]++;
+        }
+
+        if (elapsed > pStats->CompletionRoutineTicksMax)
+        {
+            pStats->CompletionRoutineTicksMax = elapsed;
         }
     }
+    KeLowerIrql(oldIrql);
 
     WdfRequestComplete(Request, Params->IoStatus.Status);
 
-    FuncExitNoReturn(TRACE_FILTER);
+    HotFuncExitNoReturn(TRACE_FILTER);
+}
+
+//
+// Gets called when Interrupt IN (HCI event) data is available
+// 
+_Use_decl_annotations_
+VOID
+UrbFunctionInterruptInTransferCompleted(
+    IN WDFREQUEST Request,
+    IN WDFIOTARGET Target,
+    IN PWDF_REQUEST_COMPLETION_PARAMS Params,
+    IN WDFCONTEXT Context
+)
+{
+    UNREFERENCED_PARAMETER(Target);
+
+    HotFuncEntry(TRACE_FILTER);
+
+    const WDFDEVICE device = (WDFDEVICE)Context;
+    const PDEVICE_CONTEXT pDevCtx = DeviceGetContext(device);
+    const PIRP pIrp = WdfRequestWdmGetIrp(Request);
+    const PURB pUrb = (PURB)URB_FROM_IRP(pIrp);
+
+    const struct _URB_BULK_OR_INTERRUPT_TRANSFER* pTransfer = &pUrb->UrbBulkOrInterruptTransfer;
+
+    const PUCHAR buffer = (PUCHAR)USBPcapURBGetBufferPointer(
+        pTransfer->TransferBufferLength,
+        pTransfer->TransferBuffer,
+        pTransfer->TransferBufferMDL
+    );
+
+    //
+    // Connection events let a capture replay resolve ACL handles to remotes
+    // 
+    if (buffer != NULL && NT_SUCCESS(Params->IoStatus.Status))
+    {
+        BthPS3PSM_CaptureRecord(
+            &pDevCtx->Capture,
+            BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED,
+            BTHPS3PSM_CAPTURE_PACKET_HCI_EVENT,
+            buffer,
+            pTransfer->TransferBufferLength
+        );
+    }
+
+    //
+    // A lost transfer leaves a partial event behind, start over with the next one
+    // 
+    BthPS3PSM_AddressFilterProcessEvents(
+        &pDevCtx->AddressFilter,
+        NT_SUCCESS(Params->IoStatus.Status) ? buffer : NULL,
+        pTransfer->TransferBufferLength
+    );
+
+#ifdef BTHPS3PSM_WITH_CONTROL_DEVICE
+    //
+    // Link of the remote patching got suspended for dropped mid-attempt
+    // 
+    if (BthPS3PSM_AddressFilterOnLinkLoss(&pDevCtx->AddressFilter))
+    {
+        BthPS3PSM_RearmPatchAsync(device);
+    }
+#endif
+
+    WdfRequestComplete(Request, Params->IoStatus.Status);
+
+    HotFuncExitNoReturn(TRACE_FILTER);
 }
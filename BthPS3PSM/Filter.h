@@ -40,9 +40,9 @@
 #include <usb.h>
 #include "L2CAP.h"
 
-#define L2CAP_MIN_BUFFER_LEN    0x10
-
 
 EVT_WDF_REQUEST_COMPLETION_ROUTINE UrbSelectConfigurationCompleted;
 
 EVT_WDF_REQUEST_COMPLETION_ROUTINE UrbFunctionBulkInTransferCompleted;
+
+EVT_WDF_REQUEST_COMPLETION_ROUTINE UrbFunctionInterruptInTransferCompleted;
@@ -0,0 +1,215 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "HciTracker.h"
+#else
+#include "Driver.h"
+#endif
+
+
+//
+// Updates the connection table from a complete event
+// 
+static
+VOID
+BthPS3PSM_HciTrackerProcessEvent(
+    _Inout_ PBTHPS3PSM_HCI_TRACKER Tracker
+)
+{
+    const PUCHAR event = Tracker->Event;
+    const UCHAR length = event[1];
+    USHORT handle;
+    ULONG index;
+    PBTHPS3PSM_HCI_CONNECTION pFree = NULL;
+
+    switch (event[0])
+    {
+    case HCI_EVENT_CONNECTION_COMPLETE:
+
+        //
+        // Status, Handle, BD_ADDR, Link_Type, Encryption_Enabled
+        // 
+        if (length < 11 || event[2] != 0x00 || event[11] != HCI_LINK_TYPE_ACL)
+        {
+            break;
+        }
+
+        handle = (USHORT)((event[3] | (event[4] << 8)) & HCI_ACL_HANDLE_MASK);
+
+        for (index = 0; index < BTHPS3PSM_HCI_MAX_CONNECTIONS; index++)
+        {
+            const PBTHPS3PSM_HCI_CONNECTION pConnection = &Tracker->Connections[index];
+
+            //
+            // Handles get reused, a stale entry must not survive a missed disconnect
+            // 
+            if (pConnection->IsActive && pConnection->Handle == handle)
+            {
+                pFree = pConnection;
+                break;
+            }
+
+            if (!pConnection->IsActive && pFree == NULL)
+            {
+                pFree = pConnection;
+            }
+        }
+
+        if (pFree == NULL)
+        {
+            break;
+        }
+
+        pFree->Handle = handle;
+        pFree->Address = 0;
+
+        //
+        // BD_ADDR is transmitted least significant octet first, just like BTH_ADDR is laid out
+        // 
+        for (index = 0; index < 6; index++)
+        {
+            pFree->Address |= (ULONGLONG)event[5 + index] << (8 * index);
+        }
+
+        pFree->IsActive = TRUE;
+
+        break;
+
+    case HCI_EVENT_DISCONNECTION_COMPLETE:
+
+        //
+        // Status, Handle, Reason
+        // 
+        if (length < 4 || event[2] != 0x00)
+        {
+            break;
+        }
+
+        handle = (USHORT)((event[3] | (event[4] << 8)) & HCI_ACL_HANDLE_MASK);
+
+        for (index = 0; index < BTHPS3PSM_HCI_MAX_CONNECTIONS; index++)
+        {
+            if (Tracker->Connections[index].IsActive && Tracker->Connections[index].Handle == handle)
+            {
+                Tracker->Connections[index].IsActive = FALSE;
+            }
+        }
+
+        break;
+
+    default:
+        break;
+    }
+}
+
+_Use_decl_annotations_
+VOID
+BthPS3PSM_HciTrackerInit(
+    PBTHPS3PSM_HCI_TRACKER Tracker
+)
+{
+    RtlZeroMemory(Tracker, sizeof(BTHPS3PSM_HCI_TRACKER));
+}
+
+//
+// Consumes the payload of one event pipe transfer
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_HciTrackerFeed(
+    PBTHPS3PSM_HCI_TRACKER Tracker,
+    const UCHAR* Buffer,
+    ULONG Length
+)
+{
+    ULONG offset = 0;
+
+    while (offset < Length)
+    {
+        //
+        // Header first, then as many parameter bytes as it announces
+        // 
+        const ULONG expected = (Tracker->EventLength < 2)
+            ? 2
+            : 2 + (ULONG)Tracker->Event[1];
+        const ULONG chunk = min(expected - Tracker->EventLength, Length - offset);
+
+        RtlCopyMemory(&Tracker->Event[Tracker->EventLength], &Buffer[offset], chunk);
+        Tracker->EventLength += chunk;
+        offset += chunk;
+
+        if (Tracker->EventLength >= 2 && Tracker->EventLength == 2 + (ULONG)Tracker->Event[1])
+        {
+            BthPS3PSM_HciTrackerProcessEvent(Tracker);
+            Tracker->EventLength = 0;
+        }
+    }
+}
+
+//
+// Discards a partially collected event, e.g. after a failed transfer
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_HciTrackerResync(
+    PBTHPS3PSM_HCI_TRACKER Tracker
+)
+{
+    Tracker->EventLength = 0;
+}
+
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_HciTrackerGetAddress(
+    const BTHPS3PSM_HCI_TRACKER* Tracker,
+    USHORT Handle,
+    PULONGLONG Address
+)
+{
+    for (ULONG index = 0; index < BTHPS3PSM_HCI_MAX_CONNECTIONS; index++)
+    {
+        if (Tracker->Connections[index].IsActive && Tracker->Connections[index].Handle == Handle)
+        {
+            *Address = Tracker->Connections[index].Address;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
@@ -0,0 +1,122 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// HCI event code, parameter length and up to 255 bytes of parameters
+// 
+#define BTHPS3PSM_HCI_EVENT_MAX_LEN             (2 + 0xFF)
+
+//
+// Upper limit of concurrently tracked ACL links
+// 
+#define BTHPS3PSM_HCI_MAX_CONNECTIONS           0x10
+
+#define HCI_EVENT_CONNECTION_COMPLETE           0x03
+#define HCI_EVENT_DISCONNECTION_COMPLETE        0x05
+
+#define HCI_LINK_TYPE_ACL                       0x01
+
+//
+// Lower 12 bits of the first ACL data header word
+// 
+#define HCI_ACL_HANDLE_MASK                     0x0FFF
+
+#define HCI_GET_ACL_HANDLE(_buf_)               ((USHORT)(((_buf_)[0] | ((_buf_)[1] << 8)) & HCI_ACL_HANDLE_MASK))
+
+//
+// ACL link the controller reported as established
+// 
+typedef struct _BTHPS3PSM_HCI_CONNECTION
+{
+    BOOLEAN IsActive;
+
+    USHORT Handle;
+
+    //
+    // Remote address (BTH_ADDR)
+    // 
+    ULONGLONG Address;
+
+} BTHPS3PSM_HCI_CONNECTION, * PBTHPS3PSM_HCI_CONNECTION;
+
+//
+// Follows the HCI event stream and maps ACL handles to remote addresses
+// 
+typedef struct _BTHPS3PSM_HCI_TRACKER
+{
+    //
+    // Bytes of the current event collected so far (events may span transfers)
+    // 
+    ULONG EventLength;
+
+    UCHAR Event[BTHPS3PSM_HCI_EVENT_MAX_LEN];
+
+    BTHPS3PSM_HCI_CONNECTION Connections[BTHPS3PSM_HCI_MAX_CONNECTIONS];
+
+} BTHPS3PSM_HCI_TRACKER, * PBTHPS3PSM_HCI_TRACKER;
+
+
+//
+// The tracker has no dependencies on the framework so it can be built
+// and fed recorded event streams outside the driver.
+// 
+
+VOID
+BthPS3PSM_HciTrackerInit(
+    _Out_ PBTHPS3PSM_HCI_TRACKER Tracker
+);
+
+VOID
+BthPS3PSM_HciTrackerFeed(
+    _Inout_ PBTHPS3PSM_HCI_TRACKER Tracker,
+    _In_reads_bytes_(Length) const UCHAR* Buffer,
+    _In_ ULONG Length
+);
+
+VOID
+BthPS3PSM_HciTrackerResync(
+    _Inout_ PBTHPS3PSM_HCI_TRACKER Tracker
+);
+
+BOOLEAN
+BthPS3PSM_HciTrackerGetAddress(
+    _In_ const BTHPS3PSM_HCI_TRACKER* Tracker,
+    _In_ USHORT Handle,
+    _Out_ PULONGLONG Address
+);
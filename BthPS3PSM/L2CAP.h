@@ -323,10 +323,15 @@ typedef struct _L2CAP_SIGNALLING_DISCONNECTION_RESPONSE
 // 
 #define L2CAP_GET_SIGNALLING_COMMAND_CODE(_buf_)            ((L2CAP_SIGNALLING_COMMAND_CODE)(_buf_)[8])
 
+//
+// Shortest ACL packet carrying a signalling command
+// 
+#define L2CAP_MIN_BUFFER_LEN    0x10
+
 //
 // Checks if the supplied buffer represents a valid L2CAP signaling command code
 // 
-BOOLEAN FORCEINLINE L2CAP_IS_SIGNALLING_COMMAND_CODE(
+FORCEINLINE BOOLEAN L2CAP_IS_SIGNALLING_COMMAND_CODE(
     PUCHAR Buffer
 )
 {
@@ -337,3 +342,17 @@ BOOLEAN FORCEINLINE L2CAP_IS_SIGNALLING_COMMAND_CODE(
 
     return FALSE;
 }
+
+//
+// Checks if the supplied ACL packet carries a signalling command on the control channel
+// 
+FORCEINLINE BOOLEAN L2CAP_IS_SIGNALLING_PACKET(
+    PUCHAR Buffer,
+    ULONG Length
+)
+{
+    return Buffer != NULL
+        && Length >= L2CAP_MIN_BUFFER_LEN
+        && L2CAP_IS_CONTROL_CHANNEL(Buffer)
+        && L2CAP_IS_SIGNALLING_COMMAND_CODE(Buffer);
+}
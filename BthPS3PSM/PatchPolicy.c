@@ -0,0 +1,377 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "PatchPolicy.h"
+#else
+#include "Driver.h"
+#endif
+
+
+_Use_decl_annotations_
+VOID
+BthPS3PSM_PatchPolicyInit(
+    PBTHPS3PSM_PATCH_POLICY Policy
+)
+{
+    RtlZeroMemory(Policy, sizeof(BTHPS3PSM_PATCH_POLICY));
+
+    BthPS3PSM_HciTrackerInit(&Policy->Tracker);
+}
+
+//
+// Replaces the allow-list, takes effect with the next connection request
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_PatchPolicySetAddresses(
+    PBTHPS3PSM_PATCH_POLICY Policy,
+    const ULONGLONG* Addresses,
+    ULONG AddressCount
+)
+{
+    const ULONG count = min(AddressCount, BTHPS3PSM_ADDRESS_FILTER_MAX_ADDRESSES);
+
+    RtlCopyMemory(Policy->Addresses, Addresses, count * sizeof(ULONGLONG));
+    Policy->AddressCount = count;
+}
+
+//
+// Feeds an event pipe transfer to the tracker, NULL signals a failed transfer
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_PatchPolicyProcessEvents(
+    PBTHPS3PSM_PATCH_POLICY Policy,
+    const UCHAR* Buffer,
+    ULONG Length
+)
+{
+    if (Buffer == NULL)
+    {
+        BthPS3PSM_HciTrackerResync(&Policy->Tracker);
+    }
+    else
+    {
+        BthPS3PSM_HciTrackerFeed(&Policy->Tracker, Buffer, Length);
+    }
+}
+
+//
+// TRUE if the remote behind the ACL handle is on the allow-list
+// 
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_PatchPolicyIsAllowed(
+    const BTHPS3PSM_PATCH_POLICY* Policy,
+    USHORT AclHandle
+)
+{
+    ULONGLONG address;
+
+    if (!BthPS3PSM_HciTrackerGetAddress(&Policy->Tracker, AclHandle, &address))
+    {
+        return FALSE;
+    }
+
+    for (ULONG index = 0; index < Policy->AddressCount; index++)
+    {
+        if (Policy->Addresses[index] == address)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+//
+// Returns the entry watching Address or NULL
+// 
+static
+PBTHPS3PSM_PATCH_SUSPENSION
+BthPS3PSM_PatchPolicyFindSuspension(
+    _In_ const BTHPS3PSM_PATCH_POLICY* Policy,
+    _In_ ULONGLONG Address
+)
+{
+    for (ULONG index = 0; index < BTHPS3PSM_PATCH_POLICY_MAX_SUSPENSIONS; index++)
+    {
+        if (Address != 0 && Policy->Suspensions[index].Address == Address)
+        {
+            return (PBTHPS3PSM_PATCH_SUSPENSION)&Policy->Suspensions[index];
+        }
+    }
+
+    return NULL;
+}
+
+//
+// TRUE if the link a re-armed suspension kept excluded is gone
+// 
+static
+BOOLEAN
+BthPS3PSM_PatchPolicyIsRetired(
+    _In_ const BTHPS3PSM_PATCH_POLICY* Policy,
+    _In_ const BTHPS3PSM_PATCH_SUSPENSION* Suspension
+)
+{
+    ULONGLONG address;
+
+    return Suspension->RearmState == RearmStateIdle
+        && (!BthPS3PSM_HciTrackerGetAddress(&Policy->Tracker, Suspension->Handle, &address)
+            || address != Suspension->Address);
+}
+
+//
+// Patching got suspended because of Address, watch it for re-arming
+// 
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_PatchPolicySuspendFor(
+    PBTHPS3PSM_PATCH_POLICY Policy,
+    ULONGLONG Address
+)
+{
+    PBTHPS3PSM_PATCH_SUSPENSION suspension = BthPS3PSM_PatchPolicyFindSuspension(Policy, Address);
+
+    //
+    // Free entry or one whose remote is done, never one still being watched
+    // 
+    for (ULONG index = 0; suspension == NULL && index < BTHPS3PSM_PATCH_POLICY_MAX_SUSPENSIONS; index++)
+    {
+        const PBTHPS3PSM_PATCH_SUSPENSION candidate = &Policy->Suspensions[index];
+
+        if (candidate->Address == 0 || BthPS3PSM_PatchPolicyIsRetired(Policy, candidate))
+        {
+            suspension = candidate;
+        }
+    }
+
+    if (suspension == NULL)
+    {
+        return FALSE;
+    }
+
+    suspension->RearmState = RearmStateWaitingForAttempt;
+    suspension->Address = Address;
+    suspension->Handle = 0;
+
+    return TRUE;
+}
+
+//
+// Forgets about all suspensions, e.g. once patching got enabled explicitly
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_PatchPolicyResume(
+    PBTHPS3PSM_PATCH_POLICY Policy
+)
+{
+    RtlZeroMemory(Policy->Suspensions, sizeof(Policy->Suspensions));
+}
+
+//
+// TRUE if the ACL handle still belongs to a remote patching got suspended for
+// 
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_PatchPolicyIsExcluded(
+    const BTHPS3PSM_PATCH_POLICY* Policy,
+    USHORT AclHandle
+)
+{
+    ULONGLONG address;
+    PBTHPS3PSM_PATCH_SUSPENSION suspension;
+
+    if (!BthPS3PSM_HciTrackerGetAddress(&Policy->Tracker, AclHandle, &address)
+        || (suspension = BthPS3PSM_PatchPolicyFindSuspension(Policy, address)) == NULL)
+    {
+        return FALSE;
+    }
+
+    return (suspension->RearmState != RearmStateIdle) || (AclHandle == suspension->Handle);
+}
+
+//
+// A suspended remote retries and its request passes through unmodified
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_PatchPolicyOnUnpatchedConnect(
+    PBTHPS3PSM_PATCH_POLICY Policy,
+    USHORT AclHandle
+)
+{
+    ULONGLONG address;
+    PBTHPS3PSM_PATCH_SUSPENSION suspension;
+
+    if (BthPS3PSM_HciTrackerGetAddress(&Policy->Tracker, AclHandle, &address)
+        && (suspension = BthPS3PSM_PatchPolicyFindSuspension(Policy, address)) != NULL
+        && suspension->RearmState == RearmStateWaitingForAttempt)
+    {
+        suspension->RearmState = RearmStateAttemptInProgress;
+        suspension->Handle = AclHandle;
+    }
+}
+
+//
+// Returns TRUE once a suspended remote configures a channel, which
+// means its unpatched connection got accepted and patching can resume
+// 
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_PatchPolicyOnConfiguration(
+    PBTHPS3PSM_PATCH_POLICY Policy,
+    USHORT AclHandle
+)
+{
+    for (ULONG index = 0; index < BTHPS3PSM_PATCH_POLICY_MAX_SUSPENSIONS; index++)
+    {
+        const PBTHPS3PSM_PATCH_SUSPENSION suspension = &Policy->Suspensions[index];
+
+        if (suspension->RearmState == RearmStateAttemptInProgress && suspension->Handle == AclHandle)
+        {
+            suspension->RearmState = RearmStateIdle;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+//
+// Returns TRUE if a suspended remote lost its link mid-attempt, frees the
+// entries of remotes that are done
+// 
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_PatchPolicyOnLinkLoss(
+    PBTHPS3PSM_PATCH_POLICY Policy
+)
+{
+    BOOLEAN rearm = FALSE;
+    ULONGLONG address;
+
+    for (ULONG index = 0; index < BTHPS3PSM_PATCH_POLICY_MAX_SUSPENSIONS; index++)
+    {
+        const PBTHPS3PSM_PATCH_SUSPENSION suspension = &Policy->Suspensions[index];
+
+        if (suspension->RearmState == RearmStateAttemptInProgress
+            && (!BthPS3PSM_HciTrackerGetAddress(&Policy->Tracker, suspension->Handle, &address)
+                || address != suspension->Address))
+        {
+            RtlZeroMemory(suspension, sizeof(BTHPS3PSM_PATCH_SUSPENSION));
+            rearm = TRUE;
+        }
+        else if (suspension->Address != 0 && BthPS3PSM_PatchPolicyIsRetired(Policy, suspension))
+        {
+            RtlZeroMemory(suspension, sizeof(BTHPS3PSM_PATCH_SUSPENSION));
+        }
+    }
+
+    return rearm;
+}
+
+_Use_decl_annotations_
+VOID
+BthPS3PSM_PatchPolicyProcessAcl(
+    PBTHPS3PSM_PATCH_POLICY Policy,
+    const BTHPS3PSM_PSM_REMAP_TABLE* Table,
+    BOOLEAN IsPatchingEnabled,
+    PUCHAR Buffer,
+    ULONG Length,
+    PBTHPS3PSM_PATCH_RESULT Result
+)
+{
+    USHORT aclHandle;
+
+    RtlZeroMemory(Result, sizeof(BTHPS3PSM_PATCH_RESULT));
+
+    if (!L2CAP_IS_SIGNALLING_PACKET(Buffer, Length))
+    {
+        Result->Verdict = PatchVerdictNone;
+        Result->Code = L2CAP_Reserved;
+        return;
+    }
+
+    aclHandle = HCI_GET_ACL_HANDLE(Buffer);
+
+    Result->Verdict = PatchVerdictSignalling;
+    Result->Code = L2CAP_GET_SIGNALLING_COMMAND_CODE(Buffer);
+
+    if (Result->Code == L2CAP_Connection_Request)
+    {
+        const PL2CAP_SIGNALLING_CONNECTION_REQUEST pConReq = (PL2CAP_SIGNALLING_CONNECTION_REQUEST)&Buffer[8];
+
+        if (!BthPS3PSM_PsmRemapLookup(Table, pConReq->PSM, &Result->PatchedPsm))
+        {
+            return;
+        }
+
+        Result->OriginalPsm = pConReq->PSM;
+
+        //
+        // Allow-listed remotes don't depend on the radio-wide state,
+        // a remote patching got suspended for never gets patched
+        // 
+        if (!BthPS3PSM_PatchPolicyIsExcluded(Policy, aclHandle)
+            && (IsPatchingEnabled || BthPS3PSM_PatchPolicyIsAllowed(Policy, aclHandle)))
+        {
+            pConReq->PSM = Result->PatchedPsm;
+            Result->Verdict = PatchVerdictPatched;
+        }
+        else
+        {
+            Result->PatchedPsm = Result->OriginalPsm;
+            Result->Verdict = PatchVerdictNotPatched;
+
+            BthPS3PSM_PatchPolicyOnUnpatchedConnect(Policy, aclHandle);
+        }
+    }
+    else if (Result->Code == L2CAP_Configuration_Request)
+    {
+        //
+        // Remote configures a channel it opened unpatched, so its connection
+        // got accepted by the native stack and patching can resume
+        // 
+        if (BthPS3PSM_PatchPolicyOnConfiguration(Policy, aclHandle))
+        {
+            Result->Verdict = PatchVerdictRearm;
+        }
+    }
+}
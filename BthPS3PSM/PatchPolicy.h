@@ -0,0 +1,257 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+#pragma once
+
+#include "L2CAP.h"
+#include "HciTracker.h"
+#include "PsmRemapTable.h"
+
+//
+// Progress of a remote that caused patching to be suspended
+// 
+typedef enum _BTHPS3PSM_REARM_STATE
+{
+    //
+    // Nothing suspended
+    // 
+    RearmStateIdle = 0,
+
+    //
+    // Waiting for the remote to retry with an unpatched connection request
+    // 
+    RearmStateWaitingForAttempt,
+
+    //
+    // Unpatched connection request seen, waiting for configuration or link loss
+    // 
+    RearmStateAttemptInProgress
+
+} BTHPS3PSM_REARM_STATE;
+
+//
+// Remotes patching can be suspended for at the same time
+// 
+#define BTHPS3PSM_PATCH_POLICY_MAX_SUSPENSIONS      8
+
+//
+// Remote that caused patching to be suspended
+// 
+typedef struct _BTHPS3PSM_PATCH_SUSPENSION
+{
+    //
+    // Suspension progress of Address
+    // 
+    BTHPS3PSM_REARM_STATE RearmState;
+
+    //
+    // Remote (BTH_ADDR), 0 while the entry is free
+    // 
+    ULONGLONG Address;
+
+    //
+    // ACL link of Address, stays excluded from patching after re-arming
+    // until the link is gone
+    // 
+    USHORT Handle;
+
+} BTHPS3PSM_PATCH_SUSPENSION, * PBTHPS3PSM_PATCH_SUSPENSION;
+
+//
+// Per-radio state deciding which connection requests get their PSM
+// patched: the ACL link table, the allow-list and the remotes patching
+// got suspended for
+// 
+typedef struct _BTHPS3PSM_PATCH_POLICY
+{
+    //
+    // ACL handle to remote address mapping
+    // 
+    BTHPS3PSM_HCI_TRACKER Tracker;
+
+    //
+    // Number of valid entries in Addresses
+    // 
+    ULONG AddressCount;
+
+    //
+    // Allow-listed remote addresses (BTH_ADDR)
+    // 
+    ULONGLONG Addresses[BTHPS3PSM_ADDRESS_FILTER_MAX_ADDRESSES];
+
+    //
+    // One entry per remote, so a second unsupported remote doesn't take
+    // the exemption away from the first
+    // 
+    BTHPS3PSM_PATCH_SUSPENSION Suspensions[BTHPS3PSM_PATCH_POLICY_MAX_SUSPENSIONS];
+
+} BTHPS3PSM_PATCH_POLICY, * PBTHPS3PSM_PATCH_POLICY;
+
+//
+// What the bulk IN completion has to do about an ACL packet
+// 
+typedef enum _BTHPS3PSM_PATCH_VERDICT
+{
+    //
+    // Not a signalling command, e.g. HID data
+    // 
+    PatchVerdictNone = 0,
+
+    //
+    // Signalling command that needs no action
+    // 
+    PatchVerdictSignalling,
+
+    //
+    // Connection request for a remapped PSM, patched in place
+    // 
+    PatchVerdictPatched,
+
+    //
+    // Connection request for a remapped PSM, left alone
+    // 
+    PatchVerdictNotPatched,
+
+    //
+    // The suspended remote configures the channel it opened unpatched,
+    // radio-wide patching can be re-enabled
+    // 
+    PatchVerdictRearm
+
+} BTHPS3PSM_PATCH_VERDICT;
+
+//
+// Outcome of BthPS3PSM_PatchPolicyProcessAcl
+// 
+typedef struct _BTHPS3PSM_PATCH_RESULT
+{
+    BTHPS3PSM_PATCH_VERDICT Verdict;
+
+    //
+    // Signalling command code, L2CAP_Reserved for PatchVerdictNone
+    // 
+    L2CAP_SIGNALLING_COMMAND_CODE Code;
+
+    //
+    // PSM of a connection request as received and as forwarded
+    // 
+    USHORT OriginalPsm;
+    USHORT PatchedPsm;
+
+} BTHPS3PSM_PATCH_RESULT, * PBTHPS3PSM_PATCH_RESULT;
+
+
+//
+// The policy has no dependencies on the framework so the filter and the
+// capture replay of BthPS3Util run the very same decision. Callers
+// serialize access to a policy.
+// 
+
+VOID
+BthPS3PSM_PatchPolicyInit(
+    _Out_ PBTHPS3PSM_PATCH_POLICY Policy
+);
+
+VOID
+BthPS3PSM_PatchPolicySetAddresses(
+    _Inout_ PBTHPS3PSM_PATCH_POLICY Policy,
+    _In_reads_(AddressCount) const ULONGLONG* Addresses,
+    _In_ ULONG AddressCount
+);
+
+VOID
+BthPS3PSM_PatchPolicyProcessEvents(
+    _Inout_ PBTHPS3PSM_PATCH_POLICY Policy,
+    _In_reads_bytes_opt_(Length) const UCHAR* Buffer,
+    _In_ ULONG Length
+);
+
+BOOLEAN
+BthPS3PSM_PatchPolicyIsAllowed(
+    _In_ const BTHPS3PSM_PATCH_POLICY* Policy,
+    _In_ USHORT AclHandle
+);
+
+//
+// Returns FALSE if all entries are taken by remotes still being watched
+// 
+BOOLEAN
+BthPS3PSM_PatchPolicySuspendFor(
+    _Inout_ PBTHPS3PSM_PATCH_POLICY Policy,
+    _In_ ULONGLONG Address
+);
+
+VOID
+BthPS3PSM_PatchPolicyResume(
+    _Inout_ PBTHPS3PSM_PATCH_POLICY Policy
+);
+
+BOOLEAN
+BthPS3PSM_PatchPolicyIsExcluded(
+    _In_ const BTHPS3PSM_PATCH_POLICY* Policy,
+    _In_ USHORT AclHandle
+);
+
+VOID
+BthPS3PSM_PatchPolicyOnUnpatchedConnect(
+    _Inout_ PBTHPS3PSM_PATCH_POLICY Policy,
+    _In_ USHORT AclHandle
+);
+
+BOOLEAN
+BthPS3PSM_PatchPolicyOnConfiguration(
+    _Inout_ PBTHPS3PSM_PATCH_POLICY Policy,
+    _In_ USHORT AclHandle
+);
+
+BOOLEAN
+BthPS3PSM_PatchPolicyOnLinkLoss(
+    _Inout_ PBTHPS3PSM_PATCH_POLICY Policy
+);
+
+//
+// Per-packet decision of the bulk IN completion: classifies the packet,
+// patches the PSM of a remapped connection request if the remote is
+// eligible and advances the suspension of patching
+// 
+VOID
+BthPS3PSM_PatchPolicyProcessAcl(
+    _Inout_ PBTHPS3PSM_PATCH_POLICY Policy,
+    _In_ const BTHPS3PSM_PSM_REMAP_TABLE* Table,
+    _In_ BOOLEAN IsPatchingEnabled,
+    _Inout_updates_bytes_(Length) PUCHAR Buffer,
+    _In_ ULONG Length,
+    _Out_ PBTHPS3PSM_PATCH_RESULT Result
+);
@@ -0,0 +1,83 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "PatchState.h"
+#else
+#include "Driver.h"
+#endif
+
+
+//
+// Switches the patch state of a device, returns TRUE if it actually flipped
+// and waiters need to learn about it
+// 
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_PatchStateSet(
+    PULONG IsPsmPatchingEnabled,
+    BOOLEAN IsEnabled
+)
+{
+    //
+    // The registry value may hold any non-zero value for enabled
+    // 
+    const BOOLEAN wasEnabled = (*IsPsmPatchingEnabled != 0);
+
+    *IsPsmPatchingEnabled = IsEnabled ? TRUE : FALSE;
+
+    return (wasEnabled != (IsEnabled != 0));
+}
+
+//
+// Records a patch state change under a new sequence number
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_PatchStateRecordChange(
+    PBTHPS3PSM_WAIT_PSM_PATCHING_CHANGE LastChange,
+    ULONG DeviceIndex,
+    BOOLEAN IsEnabled
+)
+{
+    LastChange->Sequence++;
+    LastChange->DeviceIndex = DeviceIndex;
+    LastChange->IsEnabled = IsEnabled ? TRUE : FALSE;
+}
@@ -0,0 +1,279 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include "Driver.h"
+#include "PsmRemap.tmh"
+#include <bthdef.h>
+#include <BthPS3PSMETW.h>
+
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, BthPS3PSM_PsmRemapInitialize)
+#pragma alloc_text (PAGE, BthPS3PSM_PsmRemapReplace)
+#endif
+
+
+//
+// Rules used if none are configured for the device
+// 
+static const BTHPS3PSM_PSM_REMAP_RULE G_DefaultPsmRemapRules[] =
+{
+    { PSM_HID_CONTROL, PSM_DS3_HID_CONTROL },
+    { PSM_HID_INTERRUPT, PSM_DS3_HID_INTERRUPT }
+};
+
+
+//
+// Loads the rules from the device node or falls back to the defaults
+// 
+_Use_decl_annotations_
+NTSTATUS
+BthPS3PSM_PsmRemapInitialize(
+    WDFDEVICE Device,
+    WDFKEY Key,
+    PBTHPS3PSM_DEVICE_PSM_REMAP Remap
+)
+{
+    NTSTATUS status;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    BTHPS3PSM_PSM_REMAP_RULE rules[BTHPS3PSM_PSM_REMAP_MAX_RULES];
+    ULONG valueLength = 0;
+    ULONG valueType = REG_NONE;
+
+    DECLARE_CONST_UNICODE_STRING(remapRegValue, G_PsmRemapRegValue);
+
+    FuncEntry(TRACE_PSM_REMAP);
+
+    PAGED_CODE();
+
+    RtlZeroMemory(Remap, sizeof(BTHPS3PSM_DEVICE_PSM_REMAP));
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = Device;
+
+    if (!NT_SUCCESS(status = WdfSpinLockCreate(
+        &attributes,
+        &Remap->Lock
+    )))
+    {
+        TraceError(
+            TRACE_PSM_REMAP,
+            "WdfSpinLockCreate failed with status %!STATUS!",
+            status
+        );
+        EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfSpinLockCreate", status);
+
+        FuncExit(TRACE_PSM_REMAP, "status=%!STATUS!", status);
+        return status;
+    }
+
+    status = WdfRegistryQueryValue(
+        Key,
+        &remapRegValue,
+        sizeof(rules),
+        rules,
+        &valueLength,
+        &valueType
+    );
+
+    if (NT_SUCCESS(status)
+        && valueType == REG_BINARY
+        && (valueLength % sizeof(BTHPS3PSM_PSM_REMAP_RULE)) == 0)
+    {
+        if (NT_SUCCESS(status = BthPS3PSM_PsmRemapReplace(
+            Device,
+            Remap,
+            rules,
+            valueLength / sizeof(BTHPS3PSM_PSM_REMAP_RULE)
+        )))
+        {
+            TraceInformation(
+                TRACE_PSM_REMAP,
+                "Loaded %d PSM remap rules from registry",
+                Remap->Table->RuleCount
+            );
+
+            FuncExit(TRACE_PSM_REMAP, "status=%!STATUS!", status);
+            return status;
+        }
+    }
+
+    //
+    // Missing on first launch, anything else is a broken value
+    // 
+    if (status != STATUS_OBJECT_NAME_NOT_FOUND)
+    {
+        TraceError(
+            TRACE_PSM_REMAP,
+            "Invalid %ws value (status %!STATUS!, type %d, length %d), using defaults",
+            G_PsmRemapRegValue,
+            status,
+            valueType,
+            valueLength
+        );
+        EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRegistryQueryValue", status);
+    }
+
+    status = BthPS3PSM_PsmRemapReplace(
+        Device,
+        Remap,
+        G_DefaultPsmRemapRules,
+        ARRAYSIZE(G_DefaultPsmRemapRules)
+    );
+
+    FuncExit(TRACE_PSM_REMAP, "status=%!STATUS!", status);
+
+    return status;
+}
+
+//
+// Compiles the rules into a new table and swaps it with the active one
+// 
+_Use_decl_annotations_
+NTSTATUS
+BthPS3PSM_PsmRemapReplace(
+    WDFDEVICE Device,
+    PBTHPS3PSM_DEVICE_PSM_REMAP Remap,
+    const BTHPS3PSM_PSM_REMAP_RULE* Rules,
+    ULONG RuleCount
+)
+{
+    NTSTATUS status;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDFMEMORY memory = NULL;
+    WDFMEMORY oldMemory;
+    PVOID buffer;
+
+    FuncEntryArguments(TRACE_PSM_REMAP, "RuleCount=%d", RuleCount);
+
+    PAGED_CODE();
+
+    do
+    {
+        WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+        attributes.ParentObject = Device;
+
+        if (!NT_SUCCESS(status = WdfMemoryCreate(
+            &attributes,
+            NonPagedPoolNx,
+            BTHPS3PSM_POOL_TAG,
+            sizeof(BTHPS3PSM_PSM_REMAP_TABLE),
+            &memory,
+            &buffer
+        )))
+        {
+            TraceError(
+                TRACE_PSM_REMAP,
+                "WdfMemoryCreate failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfMemoryCreate", status);
+            break;
+        }
+
+        if (!NT_SUCCESS(status = BthPS3PSM_PsmRemapCompile(
+            Rules,
+            RuleCount,
+            buffer
+        )))
+        {
+            TraceError(
+                TRACE_PSM_REMAP,
+                "BthPS3PSM_PsmRemapCompile failed with status %!STATUS!",
+                status
+            );
+            break;
+        }
+
+        //
+        // Lookups either see the old or the new table, never a mix
+        // 
+        WdfSpinLockAcquire(Remap->Lock);
+        oldMemory = Remap->Memory;
+        Remap->Memory = memory;
+        Remap->Table = buffer;
+        WdfSpinLockRelease(Remap->Lock);
+
+        memory = oldMemory;
+
+    } while (FALSE);
+
+    if (memory != NULL)
+    {
+        WdfObjectDelete(memory);
+    }
+
+    FuncExit(TRACE_PSM_REMAP, "status=%!STATUS!", status);
+
+    return status;
+}
+
+//
+// Copies out the rules of the active table
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_PsmRemapGetRules(
+    PBTHPS3PSM_DEVICE_PSM_REMAP Remap,
+    PBTHPS3PSM_PSM_REMAP_RULE Rules,
+    PULONG RuleCount
+)
+{
+    WdfSpinLockAcquire(Remap->Lock);
+    BthPS3PSM_PsmRemapDecompile(Remap->Table, Rules, RuleCount);
+    WdfSpinLockRelease(Remap->Lock);
+}
+
+//
+// Looks up the replacement of a PSM, called for every connection request
+// 
+_Use_decl_annotations_
+BOOLEAN
+BthPS3PSM_PsmRemapTranslate(
+    PBTHPS3PSM_DEVICE_PSM_REMAP Remap,
+    USHORT Psm,
+    PUSHORT PatchedPsm
+)
+{
+    BOOLEAN found;
+
+    WdfSpinLockAcquire(Remap->Lock);
+    found = BthPS3PSM_PsmRemapLookup(Remap->Table, Psm, PatchedPsm);
+    WdfSpinLockRelease(Remap->Lock);
+
+    return found;
+}
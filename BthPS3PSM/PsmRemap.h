@@ -0,0 +1,98 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+#include "PsmRemapTable.h"
+
+//
+// Active remap table of a filter device
+// 
+typedef struct _BTHPS3PSM_DEVICE_PSM_REMAP
+{
+    //
+    // Guards swapping Memory and Table against lookups
+    // 
+    WDFSPINLOCK Lock;
+
+    //
+    // Memory object backing Table (parented to the device)
+    // 
+    WDFMEMORY Memory;
+
+    //
+    // Compiled lookup table
+    // 
+    PBTHPS3PSM_PSM_REMAP_TABLE Table;
+
+} BTHPS3PSM_DEVICE_PSM_REMAP, * PBTHPS3PSM_DEVICE_PSM_REMAP;
+
+
+_Must_inspect_result_
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_PsmRemapInitialize(
+    _In_ WDFDEVICE Device,
+    _In_ WDFKEY Key,
+    _Out_ PBTHPS3PSM_DEVICE_PSM_REMAP Remap
+);
+
+_Must_inspect_result_
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_PsmRemapReplace(
+    _In_ WDFDEVICE Device,
+    _Inout_ PBTHPS3PSM_DEVICE_PSM_REMAP Remap,
+    _In_reads_(RuleCount) const BTHPS3PSM_PSM_REMAP_RULE* Rules,
+    _In_ ULONG RuleCount
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_PsmRemapGetRules(
+    _In_ PBTHPS3PSM_DEVICE_PSM_REMAP Remap,
+    _Out_writes_(BTHPS3PSM_PSM_REMAP_MAX_RULES) PBTHPS3PSM_PSM_REMAP_RULE Rules,
+    _Out_ PULONG RuleCount
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+BOOLEAN
+BthPS3PSM_PsmRemapTranslate(
+    _In_ PBTHPS3PSM_DEVICE_PSM_REMAP Remap,
+    _In_ USHORT Psm,
+    _Out_ PUSHORT PatchedPsm
+);
@@ -0,0 +1,182 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "PsmRemapTable.h"
+#else
+#include "Driver.h"
+#endif
+
+
+//
+// Multiplier candidates tried per table size before doubling it
+// 
+#define BTHPS3PSM_PSM_REMAP_MULTIPLIER_ATTEMPTS 0x40
+
+//
+// Valid PSMs are odd and have the lowest bit of the most significant octet cleared
+// 
+#define BTHPS3PSM_PSM_IS_VALID(_psm_)   (((_psm_) & 0x0101) == 0x0001)
+
+
+//
+// Searches the smallest table and an odd multiplier that hash all rules
+// into distinct slots
+// 
+_Use_decl_annotations_
+NTSTATUS
+BthPS3PSM_PsmRemapCompile(
+    const BTHPS3PSM_PSM_REMAP_RULE* Rules,
+    ULONG RuleCount,
+    PBTHPS3PSM_PSM_REMAP_TABLE Table
+)
+{
+    ULONG bits = 1;
+    ULONG i, j;
+
+    RtlZeroMemory(Table, sizeof(BTHPS3PSM_PSM_REMAP_TABLE));
+
+    //
+    // Empty slots must never match, shift out everything for an empty table
+    // 
+    Table->Shift = 31;
+
+    if (RuleCount > BTHPS3PSM_PSM_REMAP_MAX_RULES)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    for (i = 0; i < RuleCount; i++)
+    {
+        if (!BTHPS3PSM_PSM_IS_VALID(Rules[i].OriginalPsm) || !BTHPS3PSM_PSM_IS_VALID(Rules[i].PatchedPsm))
+        {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        for (j = 0; j < i; j++)
+        {
+            if (Rules[j].OriginalPsm == Rules[i].OriginalPsm)
+            {
+                return STATUS_DUPLICATE_NAME;
+            }
+        }
+    }
+
+    if (RuleCount == 0)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    while ((1UL << bits) < RuleCount)
+    {
+        bits++;
+    }
+
+    for (; (1UL << bits) <= BTHPS3PSM_PSM_REMAP_MAX_SLOTS; bits++)
+    {
+        //
+        // Golden ratio based sequence of odd candidates
+        // 
+        ULONG multiplier = 0x9E3779B1;
+
+        for (ULONG attempt = 0; attempt < BTHPS3PSM_PSM_REMAP_MULTIPLIER_ATTEMPTS; attempt++)
+        {
+            ULONG used[BTHPS3PSM_PSM_REMAP_MAX_SLOTS / 32] = { 0 };
+            BOOLEAN collision = FALSE;
+
+            for (i = 0; i < RuleCount; i++)
+            {
+                const ULONG index = ((ULONG)Rules[i].OriginalPsm * multiplier) >> (32 - bits);
+
+                if (used[index / 32] & (1UL << (index % 32)))
+                {
+                    collision = TRUE;
+                    break;
+                }
+
+                used[index / 32] |= (1UL << (index % 32));
+            }
+
+            if (!collision)
+            {
+                Table->Multiplier = multiplier;
+                Table->Shift = 32 - bits;
+                Table->RuleCount = RuleCount;
+
+                for (i = 0; i < RuleCount; i++)
+                {
+                    const ULONG index = ((ULONG)Rules[i].OriginalPsm * multiplier) >> Table->Shift;
+
+                    Table->Slots[index].OriginalPsm = Rules[i].OriginalPsm;
+                    Table->Slots[index].PatchedPsm = Rules[i].PatchedPsm;
+                }
+
+                return STATUS_SUCCESS;
+            }
+
+            multiplier = (multiplier + 0xC13FA9A9) | 1;
+        }
+    }
+
+    return STATUS_UNSUCCESSFUL;
+}
+
+_Use_decl_annotations_
+VOID
+BthPS3PSM_PsmRemapDecompile(
+    const BTHPS3PSM_PSM_REMAP_TABLE* Table,
+    PBTHPS3PSM_PSM_REMAP_RULE Rules,
+    PULONG RuleCount
+)
+{
+    ULONG count = 0;
+
+    for (ULONG index = 0; index < BTHPS3PSM_PSM_REMAP_MAX_SLOTS && count < BTHPS3PSM_PSM_REMAP_MAX_RULES; index++)
+    {
+        if (Table->Slots[index].OriginalPsm == 0)
+        {
+            continue;
+        }
+
+        Rules[count].OriginalPsm = Table->Slots[index].OriginalPsm;
+        Rules[count].PatchedPsm = Table->Slots[index].PatchedPsm;
+        count++;
+    }
+
+    *RuleCount = count;
+}
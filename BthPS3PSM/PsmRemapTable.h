@@ -0,0 +1,125 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// Upper limit of lookup slots, must be a power of two
+// 
+#define BTHPS3PSM_PSM_REMAP_MAX_SLOTS   0x100
+
+//
+// Single lookup slot, an OriginalPsm of zero marks it unused
+// 
+typedef struct _BTHPS3PSM_PSM_REMAP_SLOT
+{
+    USHORT OriginalPsm;
+
+    USHORT PatchedPsm;
+
+} BTHPS3PSM_PSM_REMAP_SLOT, * PBTHPS3PSM_PSM_REMAP_SLOT;
+
+//
+// Collision-free multiplicative hash of all rules, every PSM maps to
+// exactly one slot so a lookup is a single compare
+// 
+typedef struct _BTHPS3PSM_PSM_REMAP_TABLE
+{
+    //
+    // Odd multiplier the compiler found to be collision-free for all rules
+    // 
+    ULONG Multiplier;
+
+    //
+    // 32 - log2(number of used slots)
+    // 
+    ULONG Shift;
+
+    //
+    // Number of rules compiled into Slots
+    // 
+    ULONG RuleCount;
+
+    BTHPS3PSM_PSM_REMAP_SLOT Slots[BTHPS3PSM_PSM_REMAP_MAX_SLOTS];
+
+} BTHPS3PSM_PSM_REMAP_TABLE, * PBTHPS3PSM_PSM_REMAP_TABLE;
+
+
+//
+// Builds a lookup table from a rule set. Has no dependencies on the
+// framework so it can be built and exercised outside the driver.
+// 
+_Must_inspect_result_
+NTSTATUS
+BthPS3PSM_PsmRemapCompile(
+    _In_reads_(RuleCount) const BTHPS3PSM_PSM_REMAP_RULE* Rules,
+    _In_ ULONG RuleCount,
+    _Out_ PBTHPS3PSM_PSM_REMAP_TABLE Table
+);
+
+//
+// Copies the rules of a compiled table back out in slot order
+// 
+VOID
+BthPS3PSM_PsmRemapDecompile(
+    _In_ const BTHPS3PSM_PSM_REMAP_TABLE* Table,
+    _Out_writes_(BTHPS3PSM_PSM_REMAP_MAX_RULES) PBTHPS3PSM_PSM_REMAP_RULE Rules,
+    _Out_ PULONG RuleCount
+);
+
+//
+// Returns TRUE and the replacement if a rule exists for Psm
+// 
+FORCEINLINE
+BOOLEAN
+BthPS3PSM_PsmRemapLookup(
+    _In_ const BTHPS3PSM_PSM_REMAP_TABLE* Table,
+    _In_ USHORT Psm,
+    _Out_ PUSHORT PatchedPsm
+)
+{
+    const BTHPS3PSM_PSM_REMAP_SLOT* slot = &Table->Slots[((ULONG)Psm * Table->Multiplier) >> Table->Shift];
+
+    if (Psm == 0 || slot->OriginalPsm != Psm)
+    {
+        return FALSE;
+    }
+
+    *PatchedPsm = slot->PatchedPsm;
+
+    return TRUE;
+}
@@ -185,6 +185,17 @@ BthPS3PSMEvtIoInternalDeviceControl(
     if (IoControlCode == IOCTL_INTERNAL_USB_SUBMIT_URB)
     {
         const PURB urb = (PURB)URB_FROM_IRP(irp);
+        KIRQL oldIrql;
+
+        //
+        // Raise so we stay on this processor's counter block while updating
+        //
+        KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+        (*BthPS3PSM_StatisticsUrbCounter(
+            BthPS3PSM_StatisticsGetCurrent(&pContext->Statistics),
+            urb->UrbHeader.Function
+        ))++;
+        KeLowerIrql(oldIrql);
 
         switch (urb->UrbHeader.Function)
         {
@@ -270,6 +281,40 @@ BthPS3PSMEvtIoInternalDeviceControl(
                 return;
             }
 
+            //
+            // This URB targets the interrupt IN pipe, HCI events are
+            // tracked to learn which remote is behind an ACL handle.
+            // 
+            if (urb->UrbBulkOrInterruptTransfer.PipeHandle == pContext->InterruptReadPipe)
+            {
+                WdfRequestFormatRequestUsingCurrentType(Request);
+
+                WdfRequestSetCompletionRoutine(
+                    Request,
+                    UrbFunctionInterruptInTransferCompleted,
+                    device
+                );
+
+                ret = WdfRequestSend(
+                    Request,
+                    WdfDeviceGetIoTarget(WdfIoQueueGetDevice(Queue)),
+                    WDF_NO_SEND_OPTIONS
+                );
+
+                if (ret == FALSE)
+                {
+                    status = WdfRequestGetStatus(Request);
+                    TraceError(
+                        TRACE_QUEUE,
+                        "WdfRequestSend failed with status %!STATUS!",
+                        status
+                    );
+                    WdfRequestComplete(Request, status);
+                }
+
+                return;
+            }
+
             break;
 
 #pragma endregion
@@ -47,6 +47,16 @@ WDFCOLLECTION FilterDeviceCollection;
 WDFWAITLOCK FilterDeviceCollectionLock;
 WDFDEVICE ControlDevice = NULL;
 
+//
+// Manual queue holding pending IOCTL_BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE requests
+// 
+WDFQUEUE PatchStateNotificationQueue = NULL;
+
+//
+// Most recent patch state change, only accessed with FilterDeviceCollectionLock held
+// 
+BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE LastPatchStateChange = { 0 };
+
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text (PAGE, BthPS3PSM_CreateControlDevice)
 #pragma alloc_text (PAGE, BthPS3PSM_DeleteControlDevice)
@@ -201,6 +211,30 @@ BthPS3PSM_CreateControlDevice(
             break;
         }
 
+        //
+        // Pending state change notifications get parked here
+        //
+        WDF_IO_QUEUE_CONFIG_INIT(
+            &ioQueueConfig,
+            WdfIoQueueDispatchManual
+        );
+
+        if (!NT_SUCCESS(status = WdfIoQueueCreate(
+            controlDevice,
+            &ioQueueConfig,
+            WDF_NO_OBJECT_ATTRIBUTES,
+            &PatchStateNotificationQueue
+        )))
+        {
+            TraceError(
+                TRACE_SIDEBAND,
+                "WdfIoQueueCreate (notification) failed with %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfIoQueueCreate", status);
+            break;
+        }
+
         //
         // Control devices must notify WDF when they are done initializing.   I/O is
         // rejected until this call is made.
@@ -218,6 +252,8 @@ BthPS3PSM_CreateControlDevice(
 
     if (!NT_SUCCESS(status) && controlDevice != NULL)
     {
+        PatchStateNotificationQueue = NULL;
+
         //
         // Release the reference on the newly created object, since
         // we couldn't initialize it.
@@ -251,6 +287,7 @@ BthPS3PSM_DeleteControlDevice(
 
     if (ControlDevice)
     {
+        PatchStateNotificationQueue = NULL;
         WdfObjectDelete(ControlDevice);
         ControlDevice = NULL;
     }
@@ -274,6 +311,16 @@ VOID BthPS3PSM_SidebandIoDeviceControl(
     PBTHPS3PSM_ENABLE_PSM_PATCHING pEnable = NULL;
     PBTHPS3PSM_DISABLE_PSM_PATCHING pDisable = NULL;
     PBTHPS3PSM_GET_PSM_PATCHING pGet = NULL;
+    PBTHPS3PSM_GET_STATISTICS pStats = NULL;
+    PBTHPS3PSM_SET_CAPTURE pSetCapture = NULL;
+    PBTHPS3PSM_DRAIN_CAPTURE pDrain = NULL;
+    PBTHPS3PSM_WAIT_PSM_PATCHING_CHANGE pWait = NULL;
+    BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE lastChange;
+    PBTHPS3PSM_SET_PSM_REMAP pSetRemap = NULL;
+    PBTHPS3PSM_GET_PSM_REMAP pGetRemap = NULL;
+    PBTHPS3PSM_SET_ADDRESS_FILTER pAddressFilter = NULL;
+    PBTHPS3PSM_SUSPEND_PSM_PATCHING pSuspend = NULL;
+    ULONG deviceIndex;
     UNICODE_STRING linkName;
     WDF_WORKITEM_CONFIG wiCfg;
     WDF_OBJECT_ATTRIBUTES attributes;
@@ -323,7 +370,13 @@ VOID BthPS3PSM_SidebandIoDeviceControl(
         else
         {
             pDevCtx = DeviceGetContext(device);
-            pDevCtx->IsPsmPatchingEnabled = TRUE;
+
+            BthPS3PSM_AddressFilterResume(&pDevCtx->AddressFilter);
+
+            if (BthPS3PSM_PatchStateSet(&pDevCtx->IsPsmPatchingEnabled, TRUE))
+            {
+                BthPS3PSM_NotifyPatchStateChange(pEnable->DeviceIndex, TRUE);
+            }
 
             TraceEvents(
                 TRACE_LEVEL_VERBOSE,
@@ -399,7 +452,11 @@ VOID BthPS3PSM_SidebandIoDeviceControl(
         else
         {
             pDevCtx = DeviceGetContext(device);
-            pDevCtx->IsPsmPatchingEnabled = FALSE;
+
+            if (BthPS3PSM_PatchStateSet(&pDevCtx->IsPsmPatchingEnabled, FALSE))
+            {
+                BthPS3PSM_NotifyPatchStateChange(pDisable->DeviceIndex, FALSE);
+            }
 
             TraceEvents(
                 TRACE_LEVEL_VERBOSE,
@@ -524,21 +581,765 @@ VOID BthPS3PSM_SidebandIoDeviceControl(
 
 #pragma endregion
 
-    default:
-        TraceEvents(
-            TRACE_LEVEL_WARNING,
-            TRACE_SIDEBAND,
-            "Unknown I/O Control Code submitted: %X",
-            IoControlCode
+#pragma region IOCTL_BTHPS3PSM_GET_STATISTICS
+
+    case IOCTL_BTHPS3PSM_GET_STATISTICS:
+
+        status = WdfRequestRetrieveInputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_GET_STATISTICS),
+            (void*)&pStats,
+            &length
+        );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_GET_STATISTICS))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveInputBuffer", status);
+
+            break;
+        }
+
+        deviceIndex = pStats->DeviceIndex;
+
+        status = WdfRequestRetrieveOutputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_GET_STATISTICS),
+            (void*)&pStats,
+            &length
         );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_GET_STATISTICS))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveOutputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveOutputBuffer", status);
+
+            break;
+        }
+
+        WdfWaitLockAcquire(FilterDeviceCollectionLock, NULL);
+
+        device = WdfCollectionGetItem(FilterDeviceCollection, deviceIndex);
+
+        if (device == NULL)
+        {
+            status = STATUS_NO_SUCH_DEVICE;
+        }
+        else
+        {
+            LARGE_INTEGER frequency;
+
+            pDevCtx = DeviceGetContext(device);
+
+            (void)KeQueryPerformanceCounter(&frequency);
+
+            pStats->DeviceIndex = deviceIndex;
+            pStats->ProcessorCount = pDevCtx->Statistics.SlotCount;
+            pStats->PerformanceFrequency = (ULONG64)frequency.QuadPart;
+
+            BthPS3PSM_StatisticsAggregate(&pDevCtx->Statistics, &pStats->Statistics);
+
+            TraceEvents(
+                TRACE_LEVEL_VERBOSE,
+                TRACE_SIDEBAND,
+                "Statistics of %d processors aggregated for device %d",
+                pStats->ProcessorCount,
+                deviceIndex
+            );
+
+            WdfRequestSetInformation(Request, sizeof(BTHPS3PSM_GET_STATISTICS));
+        }
+
+        WdfWaitLockRelease(FilterDeviceCollectionLock);
+
         break;
-    }
 
-    WdfRequestComplete(Request, status);
+#pragma endregion
 
-    FuncExitNoReturn(TRACE_SIDEBAND);
-}
-#pragma warning(pop) // enable 28118 again
+#pragma region IOCTL_BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE
+
+    case IOCTL_BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE:
+
+        status = WdfRequestRetrieveInputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE),
+            (void*)&pWait,
+            &length
+        );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveInputBuffer", status);
+
+            break;
+        }
+
+        //
+        // A change in between the compare and parking would go unnoticed
+        // 
+        WdfWaitLockAcquire(FilterDeviceCollectionLock, NULL);
+
+        lastChange = LastPatchStateChange;
+
+        //
+        // Caller missed a change, report the latest right away
+        // 
+        if (BthPS3PSM_PatchStateWaitIsStale(&lastChange, pWait->Sequence))
+        {
+            WdfWaitLockRelease(FilterDeviceCollectionLock);
+
+            BthPS3PSM_CompletePatchStateWait(Request, &lastChange);
+
+            FuncExitNoReturn(TRACE_SIDEBAND);
+            return;
+        }
+
+        //
+        // Park until the next change
+        // 
+        status = WdfRequestForwardToIoQueue(
+            Request,
+            PatchStateNotificationQueue
+        );
+
+        WdfWaitLockRelease(FilterDeviceCollectionLock);
+
+        if (!NT_SUCCESS(status))
+        {
+            TraceError(
+                TRACE_SIDEBAND,
+                "WdfRequestForwardToIoQueue failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestForwardToIoQueue", status);
+
+            break;
+        }
+
+        FuncExitNoReturn(TRACE_SIDEBAND);
+        return;
+
+#pragma endregion
+
+#pragma region IOCTL_BTHPS3PSM_SET_CAPTURE
+
+    case IOCTL_BTHPS3PSM_SET_CAPTURE:
+
+        status = WdfRequestRetrieveInputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_SET_CAPTURE),
+            (void*)&pSetCapture,
+            &length
+        );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_SET_CAPTURE))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveInputBuffer", status);
+
+            break;
+        }
+
+        WdfWaitLockAcquire(FilterDeviceCollectionLock, NULL);
+
+        device = WdfCollectionGetItem(FilterDeviceCollection, pSetCapture->DeviceIndex);
+
+        if (device == NULL)
+        {
+            status = STATUS_NO_SUCH_DEVICE;
+        }
+        else
+        {
+            pDevCtx = DeviceGetContext(device);
+
+            if (pSetCapture->IsEnabled)
+            {
+                if (!NT_SUCCESS(status = BthPS3PSM_CaptureEnable(
+                    device,
+                    &pDevCtx->Capture,
+                    pSetCapture->SnapLength
+                )))
+                {
+                    TraceError(
+                        TRACE_SIDEBAND,
+                        "BthPS3PSM_CaptureEnable failed with status %!STATUS!",
+                        status
+                    );
+                }
+            }
+            else
+            {
+                BthPS3PSM_CaptureDisable(&pDevCtx->Capture);
+            }
+
+            TraceEvents(
+                TRACE_LEVEL_VERBOSE,
+                TRACE_SIDEBAND,
+                "Capture state %d requested for device %d",
+                pSetCapture->IsEnabled,
+                pSetCapture->DeviceIndex
+            );
+        }
+
+        WdfWaitLockRelease(FilterDeviceCollectionLock);
+
+        break;
+
+#pragma endregion
+
+#pragma region IOCTL_BTHPS3PSM_DRAIN_CAPTURE
+
+    case IOCTL_BTHPS3PSM_DRAIN_CAPTURE:
+
+        status = WdfRequestRetrieveInputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_DRAIN_CAPTURE),
+            (void*)&pDrain,
+            &length
+        );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_DRAIN_CAPTURE))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveInputBuffer", status);
+
+            break;
+        }
+
+        deviceIndex = pDrain->DeviceIndex;
+
+        //
+        // Records get appended behind the header up to the full buffer size
+        // 
+        status = WdfRequestRetrieveOutputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_DRAIN_CAPTURE),
+            (void*)&pDrain,
+            &length
+        );
+
+        if (!NT_SUCCESS(status))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveOutputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveOutputBuffer", status);
+
+            break;
+        }
+
+        WdfWaitLockAcquire(FilterDeviceCollectionLock, NULL);
+
+        device = WdfCollectionGetItem(FilterDeviceCollection, deviceIndex);
+
+        if (device == NULL)
+        {
+            status = STATUS_NO_SUCH_DEVICE;
+        }
+        else
+        {
+            size_t written = 0;
+
+            pDevCtx = DeviceGetContext(device);
+
+            pDrain->DeviceIndex = deviceIndex;
+
+            BthPS3PSM_CaptureDrain(
+                &pDevCtx->Capture,
+                (PUCHAR)pDrain + sizeof(BTHPS3PSM_DRAIN_CAPTURE),
+                length - sizeof(BTHPS3PSM_DRAIN_CAPTURE),
+                &written,
+                &pDrain->RecordCount,
+                &pDrain->DroppedCount
+            );
+
+            WdfRequestSetInformation(Request, sizeof(BTHPS3PSM_DRAIN_CAPTURE) + written);
+        }
+
+        WdfWaitLockRelease(FilterDeviceCollectionLock);
+
+        break;
+
+#pragma endregion
+
+#pragma region IOCTL_BTHPS3PSM_SET_PSM_REMAP
+
+    case IOCTL_BTHPS3PSM_SET_PSM_REMAP:
+
+        status = WdfRequestRetrieveInputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_SET_PSM_REMAP),
+            (void*)&pSetRemap,
+            &length
+        );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_SET_PSM_REMAP))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveInputBuffer", status);
+
+            break;
+        }
+
+        if (pSetRemap->RuleCount > BTHPS3PSM_PSM_REMAP_MAX_RULES)
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        WdfWaitLockAcquire(FilterDeviceCollectionLock, NULL);
+
+        device = WdfCollectionGetItem(FilterDeviceCollection, pSetRemap->DeviceIndex);
+
+        if (device == NULL)
+        {
+            status = STATUS_NO_SUCH_DEVICE;
+        }
+        else
+        {
+            pDevCtx = DeviceGetContext(device);
+
+            status = BthPS3PSM_PsmRemapReplace(
+                device,
+                &pDevCtx->PsmRemap,
+                pSetRemap->Rules,
+                pSetRemap->RuleCount
+            );
+
+            TraceEvents(
+                TRACE_LEVEL_VERBOSE,
+                TRACE_SIDEBAND,
+                "Replacing PSM remap with %d rules for device %d returned %!STATUS!",
+                pSetRemap->RuleCount,
+                pSetRemap->DeviceIndex,
+                status
+            );
+        }
+
+        WdfWaitLockRelease(FilterDeviceCollectionLock);
+
+        break;
+
+#pragma endregion
+
+#pragma region IOCTL_BTHPS3PSM_GET_PSM_REMAP
+
+    case IOCTL_BTHPS3PSM_GET_PSM_REMAP:
+
+        status = WdfRequestRetrieveInputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_GET_PSM_REMAP),
+            (void*)&pGetRemap,
+            &length
+        );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_GET_PSM_REMAP))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveInputBuffer", status);
+
+            break;
+        }
+
+        deviceIndex = pGetRemap->DeviceIndex;
+
+        status = WdfRequestRetrieveOutputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_GET_PSM_REMAP),
+            (void*)&pGetRemap,
+            &length
+        );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_GET_PSM_REMAP))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveOutputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveOutputBuffer", status);
+
+            break;
+        }
+
+        WdfWaitLockAcquire(FilterDeviceCollectionLock, NULL);
+
+        device = WdfCollectionGetItem(FilterDeviceCollection, deviceIndex);
+
+        if (device == NULL)
+        {
+            status = STATUS_NO_SUCH_DEVICE;
+        }
+        else
+        {
+            pDevCtx = DeviceGetContext(device);
+
+            pGetRemap->DeviceIndex = deviceIndex;
+
+            BthPS3PSM_PsmRemapGetRules(
+                &pDevCtx->PsmRemap,
+                pGetRemap->Rules,
+                &pGetRemap->RuleCount
+            );
+
+            WdfRequestSetInformation(Request, sizeof(BTHPS3PSM_GET_PSM_REMAP));
+        }
+
+        WdfWaitLockRelease(FilterDeviceCollectionLock);
+
+        break;
+
+#pragma endregion
+
+#pragma region IOCTL_BTHPS3PSM_SET_ADDRESS_FILTER
+
+    case IOCTL_BTHPS3PSM_SET_ADDRESS_FILTER:
+
+        status = WdfRequestRetrieveInputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_SET_ADDRESS_FILTER),
+            (void*)&pAddressFilter,
+            &length
+        );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_SET_ADDRESS_FILTER))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveInputBuffer", status);
+
+            break;
+        }
+
+        if (pAddressFilter->AddressCount > BTHPS3PSM_ADDRESS_FILTER_MAX_ADDRESSES)
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        WdfWaitLockAcquire(FilterDeviceCollectionLock, NULL);
+
+        device = WdfCollectionGetItem(FilterDeviceCollection, pAddressFilter->DeviceIndex);
+
+        if (device == NULL)
+        {
+            status = STATUS_NO_SUCH_DEVICE;
+        }
+        else
+        {
+            pDevCtx = DeviceGetContext(device);
+
+            BthPS3PSM_AddressFilterSetAddresses(
+                &pDevCtx->AddressFilter,
+                pAddressFilter->Addresses,
+                pAddressFilter->AddressCount
+            );
+
+            TraceEvents(
+                TRACE_LEVEL_VERBOSE,
+                TRACE_SIDEBAND,
+                "Allow-list of %d addresses set for device %d",
+                pAddressFilter->AddressCount,
+                pAddressFilter->DeviceIndex
+            );
+        }
+
+        WdfWaitLockRelease(FilterDeviceCollectionLock);
+
+        break;
+
+#pragma endregion
+
+#pragma region IOCTL_BTHPS3PSM_SUSPEND_PSM_PATCHING
+
+    case IOCTL_BTHPS3PSM_SUSPEND_PSM_PATCHING:
+
+        status = WdfRequestRetrieveInputBuffer(
+            Request,
+            sizeof(BTHPS3PSM_SUSPEND_PSM_PATCHING),
+            (void*)&pSuspend,
+            &length
+        );
+
+        if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_SUSPEND_PSM_PATCHING))
+        {
+            TraceEvents(
+                TRACE_LEVEL_ERROR,
+                TRACE_SIDEBAND,
+                "WdfRequestRetrieveInputBuffer failed with status %!STATUS!",
+                status
+            );
+            EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveInputBuffer", status);
+
+            break;
+        }
+
+        WdfWaitLockAcquire(FilterDeviceCollectionLock, NULL);
+
+        device = WdfCollectionGetItem(FilterDeviceCollection, pSuspend->DeviceIndex);
+
+        if (device == NULL)
+        {
+            status = STATUS_NO_SUCH_DEVICE;
+        }
+        else
+        {
+            pDevCtx = DeviceGetContext(device);
+
+            //
+            // Suspension is transient so nothing gets written to the registry.
+            // If the remote can't be watched the caller falls back to a plain
+            // disable.
+            // 
+            if (!BthPS3PSM_AddressFilterSuspendFor(&pDevCtx->AddressFilter, pSuspend->RemoteAddress))
+            {
+                status = STATUS_INSUFFICIENT_RESOURCES;
+            }
+            else
+            {
+                if (BthPS3PSM_PatchStateSet(&pDevCtx->IsPsmPatchingEnabled, FALSE))
+                {
+                    BthPS3PSM_NotifyPatchStateChange(pSuspend->DeviceIndex, FALSE);
+                }
+
+                TraceEvents(
+                    TRACE_LEVEL_VERBOSE,
+                    TRACE_SIDEBAND,
+                    "PSM patch suspended for device %d until remote %012llX connected",
+                    pSuspend->DeviceIndex,
+                    pSuspend->RemoteAddress
+                );
+            }
+        }
+
+        WdfWaitLockRelease(FilterDeviceCollectionLock);
+
+        break;
+
+#pragma endregion
+
+    default:
+        TraceEvents(
+            TRACE_LEVEL_WARNING,
+            TRACE_SIDEBAND,
+            "Unknown I/O Control Code submitted: %X",
+            IoControlCode
+        );
+        break;
+    }
+
+    WdfRequestComplete(Request, status);
+
+    FuncExitNoReturn(TRACE_SIDEBAND);
+}
+#pragma warning(pop) // enable 28118 again
+
+//
+// Completes a state change wait request with a copy of the most recent
+// change taken under FilterDeviceCollectionLock
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_CompletePatchStateWait(
+    WDFREQUEST Request,
+    const BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE* Change
+)
+{
+    NTSTATUS status;
+    size_t length = 0;
+    PBTHPS3PSM_WAIT_PSM_PATCHING_CHANGE pWait = NULL;
+
+    status = WdfRequestRetrieveOutputBuffer(
+        Request,
+        sizeof(BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE),
+        (void*)&pWait,
+        &length
+    );
+
+    if (!NT_SUCCESS(status) || length != sizeof(BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE))
+    {
+        TraceEvents(
+            TRACE_LEVEL_ERROR,
+            TRACE_SIDEBAND,
+            "WdfRequestRetrieveOutputBuffer failed with status %!STATUS!",
+            status
+        );
+        EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfRequestRetrieveOutputBuffer", status);
+    }
+    else
+    {
+        *pWait = *Change;
+
+        WdfRequestSetInformation(Request, sizeof(BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE));
+    }
+
+    WdfRequestComplete(Request, status);
+}
+
+//
+// Records a patch state change and wakes up all pending waiters, called
+// with FilterDeviceCollectionLock held
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_NotifyPatchStateChange(
+    ULONG DeviceIndex,
+    ULONG IsEnabled
+)
+{
+    WDFREQUEST request;
+
+    FuncEntry(TRACE_SIDEBAND);
+
+    BthPS3PSM_PatchStateRecordChange(&LastPatchStateChange, DeviceIndex, (BOOLEAN)IsEnabled);
+
+    TraceVerbose(
+        TRACE_SIDEBAND,
+        "Patch state change %I64u for device %d (enabled: %d)",
+        LastPatchStateChange.Sequence,
+        DeviceIndex,
+        IsEnabled
+    );
+
+    if (PatchStateNotificationQueue == NULL)
+    {
+        FuncExitNoReturn(TRACE_SIDEBAND);
+        return;
+    }
+
+    while (NT_SUCCESS(WdfIoQueueRetrieveNextRequest(
+        PatchStateNotificationQueue,
+        &request
+    )))
+    {
+        BthPS3PSM_CompletePatchStateWait(request, &LastPatchStateChange);
+    }
+
+    FuncExitNoReturn(TRACE_SIDEBAND);
+}
+
+//
+// Schedules re-enabling patching once a suspension has been resolved
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_RearmPatchAsync(
+    WDFDEVICE Device
+)
+{
+    NTSTATUS status;
+    WDF_WORKITEM_CONFIG wiCfg;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDFWORKITEM workItem;
+
+    WDF_WORKITEM_CONFIG_INIT(&wiCfg, BthPS3PSM_EvtRearmPatch);
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = Device;
+
+    if (!NT_SUCCESS(status = WdfWorkItemCreate(
+        &wiCfg,
+        &attributes,
+        &workItem
+    )))
+    {
+        TraceError(
+            TRACE_SIDEBAND,
+            "WdfWorkItemCreate failed with status %!STATUS!",
+            status
+        );
+        EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfWorkItemCreate", status);
+        return;
+    }
+
+    WdfWorkItemEnqueue(workItem);
+}
+
+//
+// Re-enables patching at PASSIVE_LEVEL so the collection lock can be taken
+// 
+_Use_decl_annotations_
+void BthPS3PSM_EvtRearmPatch(
+    WDFWORKITEM WorkItem
+)
+{
+    const WDFDEVICE device = WdfWorkItemGetParentObject(WorkItem);
+    const PDEVICE_CONTEXT pDevCtx = DeviceGetContext(device);
+
+    FuncEntry(TRACE_SIDEBAND);
+
+    WdfWaitLockAcquire(FilterDeviceCollectionLock, NULL);
+
+    for (ULONG index = 0; index < WdfCollectionGetCount(FilterDeviceCollection); index++)
+    {
+        if (WdfCollectionGetItem(FilterDeviceCollection, index) != device)
+        {
+            continue;
+        }
+
+        if (BthPS3PSM_PatchStateSet(&pDevCtx->IsPsmPatchingEnabled, TRUE))
+        {
+            BthPS3PSM_NotifyPatchStateChange(index, TRUE);
+
+            TraceInformation(
+                TRACE_SIDEBAND,
+                "PSM patch re-armed for device %d",
+                index
+            );
+        }
+
+        break;
+    }
+
+    WdfWaitLockRelease(FilterDeviceCollectionLock);
+
+    WdfObjectDelete(WorkItem);
+
+    FuncExitNoReturn(TRACE_SIDEBAND);
+}
 
 //
 // Async operation to store changed settings to registry at PASSIVE_LEVEL
@@ -57,4 +57,26 @@ BthPS3PSM_DeleteControlDevice(
 
 EVT_WDF_WORKITEM BthPS3PSM_EvtSaveConfigToRegistry;
 
+EVT_WDF_WORKITEM BthPS3PSM_EvtRearmPatch;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_RearmPatchAsync(
+    WDFDEVICE Device
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_CompletePatchStateWait(
+    WDFREQUEST Request,
+    const BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE* Change
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_NotifyPatchStateChange(
+    ULONG DeviceIndex,
+    ULONG IsEnabled
+);
+
 #endif
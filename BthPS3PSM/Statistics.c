@@ -0,0 +1,127 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include "Driver.h"
+#include "Statistics.tmh"
+#include <BthPS3PSMETW.h>
+
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, BthPS3PSM_StatisticsInitialize)
+#endif
+
+
+//
+// Allocates one zeroed counter block per possible processor, the maximum
+// count covers processors that get hot-added later on
+// 
+_Use_decl_annotations_
+NTSTATUS
+BthPS3PSM_StatisticsInitialize(
+    WDFDEVICE Device,
+    PBTHPS3PSM_DEVICE_STATISTICS Statistics
+)
+{
+    NTSTATUS status;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    size_t size;
+    PVOID buffer;
+
+    FuncEntry(TRACE_STATISTICS);
+
+    PAGED_CODE();
+
+    RtlZeroMemory(Statistics, sizeof(BTHPS3PSM_DEVICE_STATISTICS));
+
+    Statistics->SlotCount = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    //
+    // Over-allocate so the first slot can be moved to a cache line boundary
+    // 
+    size = ((size_t)Statistics->SlotCount * sizeof(BTHPS3PSM_STATISTICS_SLOT)) + SYSTEM_CACHE_ALIGNMENT_SIZE;
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = Device;
+
+    if (!NT_SUCCESS(status = WdfMemoryCreate(
+        &attributes,
+        NonPagedPoolNx,
+        BTHPS3PSM_POOL_TAG,
+        size,
+        &Statistics->Memory,
+        &buffer
+    )))
+    {
+        TraceError(
+            TRACE_STATISTICS,
+            "WdfMemoryCreate failed with status %!STATUS!",
+            status
+        );
+        EventWriteFailedWithNTStatus(NULL, __FUNCTION__, L"WdfMemoryCreate", status);
+
+        FuncExit(TRACE_STATISTICS, "status=%!STATUS!", status);
+
+        return status;
+    }
+
+    RtlZeroMemory(buffer, size);
+
+    Statistics->Slots = (PBTHPS3PSM_STATISTICS_SLOT)ALIGN_UP_POINTER_BY(buffer, SYSTEM_CACHE_ALIGNMENT_SIZE);
+
+    TraceVerbose(
+        TRACE_STATISTICS,
+        "Allocated %d statistics slots",
+        Statistics->SlotCount
+    );
+
+    FuncExit(TRACE_STATISTICS, "status=%!STATUS!", status);
+
+    return status;
+}
+
+//
+// Sums up the counter blocks of all processors
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_StatisticsAggregate(
+    PBTHPS3PSM_DEVICE_STATISTICS Statistics,
+    PBTHPS3PSM_STATISTICS Result
+)
+{
+    BthPS3PSM_StatisticsSumSlots(Statistics->Slots, Statistics->SlotCount, Result);
+}
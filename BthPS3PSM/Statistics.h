@@ -0,0 +1,100 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+#include "StatisticsSlots.h"
+
+//
+// Per-processor counters of a filter device
+// 
+typedef struct _BTHPS3PSM_DEVICE_STATISTICS
+{
+    //
+    // Memory object backing the slots (parented to the device)
+    // 
+    WDFMEMORY Memory;
+
+    //
+    // Cache-aligned array of counter blocks, one per processor
+    // 
+    PBTHPS3PSM_STATISTICS_SLOT Slots;
+
+    //
+    // Number of elements in Slots
+    // 
+    ULONG SlotCount;
+
+} BTHPS3PSM_DEVICE_STATISTICS, * PBTHPS3PSM_DEVICE_STATISTICS;
+
+
+_Must_inspect_result_
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTSTATUS
+BthPS3PSM_StatisticsInitialize(
+    _In_ WDFDEVICE Device,
+    _Out_ PBTHPS3PSM_DEVICE_STATISTICS Statistics
+);
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_StatisticsAggregate(
+    _In_ PBTHPS3PSM_DEVICE_STATISTICS Statistics,
+    _Out_ PBTHPS3PSM_STATISTICS Result
+);
+
+//
+// Returns the counter block of the current processor. The caller must run
+// at DISPATCH_LEVEL so it can't get migrated while updating the block.
+// 
+_IRQL_requires_(DISPATCH_LEVEL)
+FORCEINLINE
+PBTHPS3PSM_STATISTICS
+BthPS3PSM_StatisticsGetCurrent(
+    _In_ PBTHPS3PSM_DEVICE_STATISTICS Statistics
+)
+{
+    const ULONG index = KeGetCurrentProcessorNumberEx(NULL);
+
+    //
+    // Blocks are allocated for all processors that can ever be present,
+    // hot-added ones included, so no two processors share one
+    // 
+    NT_ASSERT(index < Statistics->SlotCount);
+
+    return &Statistics->Slots[index].Counters;
+}
@@ -0,0 +1,88 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#ifdef BTHPS3_PORTABLE
+#include <BthPS3Portable.h>
+#include "StatisticsSlots.h"
+#else
+#include "Driver.h"
+#endif
+
+
+//
+// Sums up the counter blocks of all processors. Blocks are read without
+// synchronization so the result is a close approximation while traffic flows.
+// 
+_Use_decl_annotations_
+VOID
+BthPS3PSM_StatisticsSumSlots(
+    const BTHPS3PSM_STATISTICS_SLOT* Slots,
+    ULONG SlotCount,
+    PBTHPS3PSM_STATISTICS Result
+)
+{
+    ULONG i, j;
+
+    RtlZeroMemory(Result, sizeof(BTHPS3PSM_STATISTICS));
+
+    for (i = 0; i < SlotCount; i++)
+    {
+        const volatile BTHPS3PSM_STATISTICS* pSlot = &Slots[i].Counters;
+
+        for (j = 0; j < BTHPS3PSM_STATS_URB_FUNCTION_COUNT; j++)
+        {
+            Result->UrbsByFunction[j] += pSlot->UrbsByFunction[j];
+        }
+
+        Result->UrbsOtherFunction += pSlot->UrbsOtherFunction;
+
+        Result->BulkInTransfers += pSlot->BulkInTransfers;
+        Result->BulkInBytes += pSlot->BulkInBytes;
+
+        for (j = 0; j < BTHPS3PSM_STATS_SIGNALLING_CODE_COUNT; j++)
+        {
+            Result->SignallingCommands[j] += pSlot->SignallingCommands[j];
+        }
+
+        Result->PsmsPatched += pSlot->PsmsPatched;
+        Result->PsmsNotPatched += pSlot->PsmsNotPatched;
+        Result->CompletionRoutineTicks += pSlot->CompletionRoutineTicks;
+        Result->CompletionRoutineTicksMax = max(Result->CompletionRoutineTicksMax, pSlot->CompletionRoutineTicksMax);
+    }
+}
@@ -0,0 +1,75 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3PSM - Windows kernel-mode BTHUSB lower filter driver                     *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#pragma once
+
+//
+// Per-processor counter block, padded to a full cache line so that two
+// processors never write to the same line
+// 
+typedef struct DECLSPEC_CACHEALIGN _BTHPS3PSM_STATISTICS_SLOT
+{
+    BTHPS3PSM_STATISTICS Counters;
+
+} BTHPS3PSM_STATISTICS_SLOT, * PBTHPS3PSM_STATISTICS_SLOT;
+
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+BthPS3PSM_StatisticsSumSlots(
+    _In_reads_(SlotCount) const BTHPS3PSM_STATISTICS_SLOT* Slots,
+    _In_ ULONG SlotCount,
+    _Out_ PBTHPS3PSM_STATISTICS Result
+);
+
+//
+// Returns the counter of an URB function code, codes without a bucket of
+// their own share the overflow counter
+// 
+FORCEINLINE
+PULONG64
+BthPS3PSM_StatisticsUrbCounter(
+    _In_ PBTHPS3PSM_STATISTICS Counters,
+    _In_ USHORT Function
+)
+{
+    return (Function < BTHPS3PSM_STATS_URB_FUNCTION_COUNT)
+        ? &Counters->UrbsByFunction[Function]
+        : &Counters->UrbsOtherFunction;
+}
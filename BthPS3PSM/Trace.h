@@ -52,6 +52,10 @@
         WPP_DEFINE_BIT(TRACE_FILTER)                                   \
         WPP_DEFINE_BIT(TRACE_DIAG)                                     \
         WPP_DEFINE_BIT(TRACE_SIDEBAND)                                 \
+        WPP_DEFINE_BIT(TRACE_STATISTICS)                               \
+        WPP_DEFINE_BIT(TRACE_CAPTURE)                                  \
+        WPP_DEFINE_BIT(TRACE_PSM_REMAP)                                \
+        WPP_DEFINE_BIT(TRACE_ADDRESS_FILTER)                           \
         )                             
 
 #define WPP_FLAG_LEVEL_LOGGER(flag, level)                                  \
@@ -75,6 +79,23 @@
 #define WPP_RECORDER_FLAGS_LEVEL_ARGS(flags, lvl) WPP_RECORDER_LEVEL_FLAGS_ARGS(lvl, flags)
 #define WPP_RECORDER_FLAGS_LEVEL_FILTER(flags, lvl) WPP_RECORDER_LEVEL_FLAGS_FILTER(lvl, flags)
 
+//
+// Hot-path tier used on per-transfer code paths. The HOTLEVEL keyword maps
+// onto the regular level/flags checks (and the in-flight recorder) unless
+// BTHPS3_HOT_PATH_TRACING_DISABLED is defined, in which case the condition
+// is constant FALSE and the compiler drops the call and its arguments.
+// 
+#define WPP_HOTLEVEL_FLAGS_LOGGER(lvl, flags) WPP_LEVEL_FLAGS_LOGGER(lvl, flags)
+#define WPP_RECORDER_HOTLEVEL_FLAGS_ARGS(lvl, flags) WPP_RECORDER_LEVEL_FLAGS_ARGS(lvl, flags)
+
+#ifdef BTHPS3_HOT_PATH_TRACING_DISABLED
+#define WPP_HOTLEVEL_FLAGS_ENABLED(lvl, flags) (FALSE)
+#define WPP_RECORDER_HOTLEVEL_FLAGS_FILTER(lvl, flags) (FALSE)
+#else
+#define WPP_HOTLEVEL_FLAGS_ENABLED(lvl, flags) WPP_LEVEL_FLAGS_ENABLED(lvl, flags)
+#define WPP_RECORDER_HOTLEVEL_FLAGS_FILTER(lvl, flags) WPP_RECORDER_LEVEL_FLAGS_FILTER(lvl, flags)
+#endif
+
 //
 // This comment block is scanned by the trace preprocessor to define our
 // Trace function.
@@ -93,6 +114,10 @@
 // FUNC TraceInformation{LEVEL=TRACE_LEVEL_INFORMATION}(FLAGS, MSG, ...);
 // FUNC TraceVerbose{LEVEL=TRACE_LEVEL_VERBOSE}(FLAGS, MSG, ...);
 // FUNC FuncExitNoReturn{LEVEL=TRACE_LEVEL_VERBOSE}(FLAGS);
+// FUNC HotFuncEntry{HOTLEVEL=TRACE_LEVEL_VERBOSE}(FLAGS);
+// FUNC HotFuncExit{HOTLEVEL=TRACE_LEVEL_VERBOSE}(FLAGS, MSG, ...);
+// FUNC HotFuncExitNoReturn{HOTLEVEL=TRACE_LEVEL_VERBOSE}(FLAGS);
+// FUNC HotTraceVerbose{HOTLEVEL=TRACE_LEVEL_VERBOSE}(FLAGS, MSG, ...);
 // USEPREFIX(FuncEntry, "%!STDPREFIX! [%!FUNC!] --> Entry");
 // USEPREFIX(FuncEntryArguments, "%!STDPREFIX! [%!FUNC!] --> Entry <");
 // USEPREFIX(FuncExit, "%!STDPREFIX! [%!FUNC!] <-- Exit <");
@@ -103,4 +128,9 @@
 // USEPREFIX(TraceInformation, "%!STDPREFIX! [%!FUNC!] ");
 // USEPREFIX(TraceVerbose, "%!STDPREFIX! [%!FUNC!] ");
 // USEPREFIX(FuncExitNoReturn, "%!STDPREFIX! [%!FUNC!] <--");
+// USEPREFIX(HotFuncEntry, "%!STDPREFIX! [%!FUNC!] --> Entry");
+// USEPREFIX(HotFuncExit, "%!STDPREFIX! [%!FUNC!] <-- Exit <");
+// USESUFFIX(HotFuncExit, ">");
+// USEPREFIX(HotFuncExitNoReturn, "%!STDPREFIX! [%!FUNC!] <--");
+// USEPREFIX(HotTraceVerbose, "%!STDPREFIX! [%!FUNC!] ");
 // end_wpp
@@ -17,123 +17,567 @@ processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 
 namespace
 {
-    bool enable_psm_patch(DWORD deviceIndex = 0)
+    volatile bool g_IsCapturing = false;
+
+    BOOL WINAPI capture_ctrl_handler(DWORD ctrlType)
     {
-        DWORD bytesReturned = 0;
-
-        const auto hDevice = CreateFile(
-            BTHPS3PSM_CONTROL_DEVICE_PATH,
-            GENERIC_READ | GENERIC_WRITE,
-            FILE_SHARE_READ | FILE_SHARE_WRITE,
-            nullptr,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            nullptr
-        );
+        if (ctrlType == CTRL_C_EVENT || ctrlType == CTRL_BREAK_EVENT)
+        {
+            g_IsCapturing = false;
+            return TRUE;
+        }
+
+        return FALSE;
+    }
 
-        if (hDevice == INVALID_HANDLE_VALUE)
+    DWORD capture_to_file(
+        bthps3::FilterClient& filter,
+        const std::string& path,
+        DWORD deviceIndex,
+        DWORD snapLength,
+        DWORD durationSeconds
+    )
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+        if (!file)
         {
-            return false;
+            return ERROR_CANNOT_MAKE;
         }
 
-        BTHPS3PSM_ENABLE_PSM_PATCHING req;
-        req.DeviceIndex = deviceIndex;
+        DWORD error = filter.SetCapture(deviceIndex, true, snapLength);
 
-        const auto ret = DeviceIoControl(
-            hDevice,
-            IOCTL_BTHPS3PSM_ENABLE_PSM_PATCHING,
-            &req,
-            sizeof(BTHPS3PSM_ENABLE_PSM_PATCHING),
-            nullptr,
-            0,
-            &bytesReturned,
-            nullptr
-        );
+        if (error != ERROR_SUCCESS)
+        {
+            return error;
+        }
+
+        PcapWriter writer(file, snapLength ? snapLength : BTHPS3PSM_CAPTURE_DEFAULT_SNAP_LEN);
+        std::vector<UCHAR> buffer(0x40000);
+        ULONG64 packets = 0, dropped = 0;
+        const auto start = GetTickCount64();
 
-        DWORD err = GetLastError();
-        CloseHandle(hDevice);
-        SetLastError(err);
+        g_IsCapturing = true;
+        SetConsoleCtrlHandler(capture_ctrl_handler, TRUE);
 
-        return ret > 0;
+        std::cout << color(cyan) << "Capturing, press Ctrl+C to stop" << std::endl;
+
+        while (true)
+        {
+            //
+            // Evaluate exit condition first so a final drain still happens
+            // 
+            const bool isLast = !g_IsCapturing
+                || (durationSeconds > 0 && GetTickCount64() - start >= durationSeconds * 1000ULL);
+
+            std::uint32_t bytesReturned = 0;
+
+            if ((error = filter.DrainCapture(deviceIndex, buffer, &bytesReturned)) != ERROR_SUCCESS)
+            {
+                break;
+            }
+
+            const auto pDrain = reinterpret_cast<PBTHPS3PSM_DRAIN_CAPTURE>(buffer.data());
+            size_t offset = sizeof(BTHPS3PSM_DRAIN_CAPTURE);
+
+            for (ULONG i = 0; i < pDrain->RecordCount; i++)
+            {
+                if (offset + sizeof(BTHPS3PSM_CAPTURE_RECORD) > bytesReturned)
+                {
+                    break;
+                }
+
+                const auto pRecord = reinterpret_cast<PBTHPS3PSM_CAPTURE_RECORD>(&buffer[offset]);
+                offset += sizeof(BTHPS3PSM_CAPTURE_RECORD);
+
+                if (offset + pRecord->CapturedLength > bytesReturned)
+                {
+                    break;
+                }
+
+                writer.write(
+                    pRecord->Timestamp,
+                    pRecord->Direction,
+                    pRecord->PacketType,
+                    &buffer[offset],
+                    pRecord->CapturedLength,
+                    pRecord->OriginalLength
+                );
+
+                offset += pRecord->CapturedLength;
+                packets++;
+            }
+
+            dropped += pDrain->DroppedCount;
+
+            if (isLast)
+            {
+                break;
+            }
+
+            //
+            // Come back immediately if the buffer was too small for everything
+            // 
+            if (pDrain->RecordCount == 0 || bytesReturned < buffer.size() / 2)
+            {
+                Sleep(100);
+            }
+        }
+
+        SetConsoleCtrlHandler(capture_ctrl_handler, FALSE);
+        (void)filter.SetCapture(deviceIndex, false, 0);
+        writer.flush();
+
+        std::cout << color(cyan) << "Captured "
+            << color(magenta) << packets
+            << color(cyan) << " packets, dropped "
+            << color(magenta) << dropped << std::endl;
+
+        return error;
     }
 
-    bool disable_psm_patch(DWORD deviceIndex = 0)
+    //
+    // Runs all received packets of a capture through the patch policy the
+    // filter's completion routines apply: ACL data through the bulk IN
+    // decision, HCI events through the ACL link tracker
+    // 
+    DWORD replay_capture(
+        const std::string& path,
+        const std::vector<BTHPS3PSM_PSM_REMAP_RULE>& rules,
+        const std::vector<ULONGLONG>& allowList,
+        ULONGLONG suspendFor,
+        bool isPatchingEnabled,
+        ULONG iterations
+    )
     {
-        DWORD bytesReturned = 0;
-
-        const auto hDevice = CreateFile(
-            BTHPS3PSM_CONTROL_DEVICE_PATH,
-            GENERIC_READ | GENERIC_WRITE,
-            FILE_SHARE_READ | FILE_SHARE_WRITE,
-            nullptr,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            nullptr
-        );
+        struct ReplayPacket
+        {
+            UCHAR PacketType;
+            std::vector<UCHAR> Data;
+        };
 
-        if (hDevice == INVALID_HANDLE_VALUE)
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file)
         {
-            return false;
+            return ERROR_FILE_NOT_FOUND;
         }
 
-        BTHPS3PSM_DISABLE_PSM_PATCHING req;
-        req.DeviceIndex = deviceIndex;
+        PcapReader reader(file);
 
-        const auto ret = DeviceIoControl(
-            hDevice,
-            IOCTL_BTHPS3PSM_DISABLE_PSM_PATCHING,
-            &req,
-            sizeof(BTHPS3PSM_DISABLE_PSM_PATCHING),
-            nullptr,
-            0,
-            &bytesReturned,
-            nullptr
-        );
+        if (!reader.isValid())
+        {
+            return ERROR_BAD_FORMAT;
+        }
+
+        BTHPS3PSM_PSM_REMAP_TABLE table;
+
+        if (!NT_SUCCESS(BthPS3PSM_PsmRemapCompile(rules.data(), static_cast<ULONG>(rules.size()), &table)))
+        {
+            return ERROR_INVALID_PARAMETER;
+        }
+
+        //
+        // Keep only what the filter gets to see so the timed loop is pure parsing
+        // 
+        std::vector<ReplayPacket> packets;
+        PcapReader::Packet packet;
+        ULONG64 total = 0, aclPackets = 0;
+
+        while (reader.next(packet))
+        {
+            total++;
+
+            if (packet.Direction != BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED)
+            {
+                continue;
+            }
+
+            if (packet.PacketType == BTHPS3PSM_CAPTURE_PACKET_ACL_DATA)
+            {
+                aclPackets++;
+            }
+            else if (packet.PacketType != BTHPS3PSM_CAPTURE_PACKET_HCI_EVENT)
+            {
+                continue;
+            }
+
+            packets.push_back({ packet.PacketType, packet.Data });
+        }
+
+        std::vector<ULONG64> patchedByRule(rules.size());
+        ULONG64 connectionRequests = 0, notPatched = 0, rearmed = 0;
+        LONGLONG ticks = 0;
+        LARGE_INTEGER frequency, start, end;
+        BTHPS3PSM_PATCH_POLICY policy;
+        BTHPS3PSM_PATCH_RESULT result;
+
+        QueryPerformanceFrequency(&frequency);
+
+        for (ULONG iteration = 0; iteration < iterations; iteration++)
+        {
+            //
+            // Patching happens in place, every pass starts from the capture
+            // 
+            auto working = packets;
+            BOOLEAN isEnabled = isPatchingEnabled ? TRUE : FALSE;
+
+            BthPS3PSM_PatchPolicyInit(&policy);
+            BthPS3PSM_PatchPolicySetAddresses(&policy, allowList.data(), static_cast<ULONG>(allowList.size()));
+
+            if (suspendFor != 0)
+            {
+                (void)BthPS3PSM_PatchPolicySuspendFor(&policy, suspendFor);
+                isEnabled = FALSE;
+            }
+
+            QueryPerformanceCounter(&start);
+
+            for (auto& replayed : working)
+            {
+                const auto length = static_cast<ULONG>(replayed.Data.size());
+
+                if (replayed.PacketType == BTHPS3PSM_CAPTURE_PACKET_HCI_EVENT)
+                {
+                    BthPS3PSM_PatchPolicyProcessEvents(&policy, replayed.Data.data(), length);
+
+                    if (BthPS3PSM_PatchPolicyOnLinkLoss(&policy))
+                    {
+                        isEnabled = TRUE;
+                        rearmed++;
+                    }
+
+                    continue;
+                }
+
+                BthPS3PSM_PatchPolicyProcessAcl(&policy, &table, isEnabled, replayed.Data.data(), length, &result);
+
+                switch (result.Verdict)
+                {
+                case PatchVerdictPatched:
+                {
+                    const auto rule = std::find_if(rules.begin(), rules.end(),
+                        [&result](const BTHPS3PSM_PSM_REMAP_RULE& r) { return r.OriginalPsm == result.OriginalPsm; });
+
+                    connectionRequests++;
+                    patchedByRule[rule - rules.begin()]++;
+                    break;
+                }
+                case PatchVerdictNotPatched:
+                    connectionRequests++;
+                    notPatched++;
+                    break;
+                case PatchVerdictRearm:
+                    isEnabled = TRUE;
+                    rearmed++;
+                    break;
+                default:
+                    break;
+                }
+            }
 
-        DWORD err = GetLastError();
-        CloseHandle(hDevice);
-        SetLastError(err);
+            QueryPerformanceCounter(&end);
 
-        return ret > 0;
+            ticks += end.QuadPart - start.QuadPart;
+        }
+
+        const double seconds = static_cast<double>(ticks) / frequency.QuadPart;
+        const ULONG64 inspected = static_cast<ULONG64>(packets.size()) * iterations;
+
+        std::cout << color(cyan) << "Read "
+            << color(magenta) << total
+            << color(cyan) << " packets, "
+            << color(magenta) << aclPackets
+            << color(cyan) << " received ACL packets and "
+            << color(magenta) << (packets.size() - aclPackets)
+            << color(cyan) << " events replayed "
+            << color(magenta) << iterations
+            << color(cyan) << " time(s)" << std::endl;
+
+        std::cout << color(cyan) << "  Remapped requests:    " << color(white) << connectionRequests << std::endl;
+
+        for (size_t i = 0; i < rules.size(); i++)
+        {
+            std::cout << color(gray) << "    0x" << std::hex << std::setw(4) << std::setfill('0') << rules[i].OriginalPsm
+                << " -> 0x" << std::setw(4) << rules[i].PatchedPsm << std::dec << ": "
+                << color(white) << patchedByRule[i] << std::endl;
+        }
+
+        std::cout << color(cyan) << "  PSMs not patched:     " << color(white) << notPatched << std::endl;
+        std::cout << color(cyan) << "  Patching re-armed:    " << color(white) << rearmed << std::endl;
+        std::cout << color(cyan) << "  Packets per second:   " << color(white)
+            << (seconds > 0.0 ? static_cast<ULONG64>(inspected / seconds) : 0) << std::endl;
+
+        return ERROR_SUCCESS;
     }
 
-    bool get_psm_patch(PBTHPS3PSM_GET_PSM_PATCHING request, DWORD deviceIndex = 0)
+    //
+    // Parses remote addresses in the form of "001BDC0FAA58,00:1B:DC:0F:AA:59"
+    // 
+    bool parse_addresses(const std::string& value, std::vector<ULONGLONG>& addresses)
     {
-        DWORD bytesReturned = 0;
-
-        const auto hDevice = CreateFile(
-            BTHPS3PSM_CONTROL_DEVICE_PATH,
-            GENERIC_READ | GENERIC_WRITE,
-            FILE_SHARE_READ | FILE_SHARE_WRITE,
-            nullptr,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            nullptr
-        );
+        std::istringstream stream(value);
+        std::string entry;
+
+        addresses.clear();
 
-        if (hDevice == INVALID_HANDLE_VALUE)
+        while (std::getline(stream, entry, ','))
         {
-            return false;
+            entry.erase(std::remove(entry.begin(), entry.end(), ':'), entry.end());
+
+            if (entry.empty() || entry.size() > 12
+                || entry.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+            {
+                return false;
+            }
+
+            addresses.push_back(std::stoull(entry, nullptr, 16));
         }
 
-        request->DeviceIndex = deviceIndex;
+        return true;
+    }
 
-        const auto ret = DeviceIoControl(
-            hDevice,
-            IOCTL_BTHPS3PSM_GET_PSM_PATCHING,
-            request,
-            sizeof(*request),
-            request,
-            sizeof(*request),
-            &bytesReturned,
-            nullptr
-        );
+    //
+    // Parses rules in the form of "0x0011=0x5053,0x0013=0x5055"
+    // 
+    bool parse_psm_remap(const std::string& value, std::vector<BTHPS3PSM_PSM_REMAP_RULE>& rules)
+    {
+        std::istringstream stream(value);
+        std::string rule;
+
+        rules.clear();
+
+        while (std::getline(stream, rule, ','))
+        {
+            const auto separator = rule.find('=');
+
+            if (separator == std::string::npos)
+            {
+                return false;
+            }
+
+            try
+            {
+                const auto original = std::stoul(rule.substr(0, separator), nullptr, 0);
+                const auto patched = std::stoul(rule.substr(separator + 1), nullptr, 0);
+
+                if (original > 0xFFFF || patched > 0xFFFF)
+                {
+                    return false;
+                }
+
+                BTHPS3PSM_PSM_REMAP_RULE entry;
+                entry.OriginalPsm = static_cast<USHORT>(original);
+                entry.PatchedPsm = static_cast<USHORT>(patched);
+                rules.push_back(entry);
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //
+    // Fetches the flight recorder of the first BthPS3 PDO and prints it in time order
+    // 
+    DWORD dump_flight_recorder()
+    {
+        const auto paths = bthps3::EnumerateInterfaces(GUID_DEVINTERFACE_BTHPS3);
+
+        if (paths.empty())
+        {
+            return ERROR_FILE_NOT_FOUND;
+        }
+
+        bthps3::PdoClient pdo(bthps3::OpenWin32Transport, paths.front());
+        BTHPS3_GET_FLIGHT_RECORDER header = {};
+        std::vector<BTHPS3_FLIGHT_RECORDER_EVENT> events;
+
+        //
+        // One full ring per processor fits any system up to 64 logical processors
+        // 
+        const DWORD error = pdo.GetFlightRecorder(header, events, BTHPS3_FLIGHT_RECORDER_RING_EVENTS * 64);
+
+        if (error != ERROR_SUCCESS)
+        {
+            return error;
+        }
+
+        std::sort(events.begin(), events.end(), [](const auto& lhs, const auto& rhs)
+        {
+            return lhs.Timestamp < rhs.Timestamp;
+        });
+
+        static const char* const channels[] = { "CTRL-IN", "CTRL-OUT", "INTR-IN", "INTR-OUT" };
+        static const char* const connectStages[] = { "indicated", "accepted", "denied", "pdo-created" };
+        static const char* const disconnectStages[] = { "requested", "indicated", "channel-close" };
+
+        const auto detailName = [](const char* const* names, size_t count, UCHAR detail)
+        {
+            return detail < count ? names[detail] : "?";
+        };
+
+        std::cout << color(cyan) << "Recorded " << color(magenta) << events.size()
+            << color(cyan) << " events on " << color(magenta) << header.ProcessorCount
+            << color(cyan) << " processors, " << color(magenta) << header.LostCount
+            << color(cyan) << " overwritten" << std::endl;
+
+        const ULONG64 origin = events.empty() ? 0 : events.front().Timestamp;
+
+        for (const auto& event : events)
+        {
+            const double offset = header.PerformanceFrequency
+                ? ((event.Timestamp - origin) * 1000000.0) / header.PerformanceFrequency
+                : 0.0;
+
+            std::cout << color(gray) << std::fixed << std::setprecision(1) << std::setw(12) << offset << " us"
+                << " cpu " << std::setw(2) << event.Processor
+                << " slot " << std::setw(3) << event.Slot << "  " << color(white);
+
+            switch (event.Type)
+            {
+            case BTHPS3_FLIGHT_RECORDER_TRANSFER_SUBMIT:
+                std::cout << "submit     " << detailName(channels, _countof(channels), event.Detail)
+                    << " length=" << event.Argument;
+                break;
+            case BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE:
+                std::cout << "complete   " << detailName(channels, _countof(channels), event.Detail)
+                    << " status=0x" << std::hex << static_cast<ULONG>(event.Argument) << std::dec
+                    << " length=" << (event.Argument >> 32);
+                break;
+            case BTHPS3_FLIGHT_RECORDER_QUEUE_DEPTH:
+                std::cout << "queued     " << detailName(channels, _countof(channels), event.Detail)
+                    << " pending=" << event.Argument;
+                break;
+            case BTHPS3_FLIGHT_RECORDER_CONNECT_STAGE:
+                std::cout << "connect    " << detailName(connectStages, _countof(connectStages), event.Detail)
+                    << " address=" << std::hex << std::setw(12) << std::setfill('0') << event.Argument
+                    << std::setfill(' ') << std::dec;
+                break;
+            case BTHPS3_FLIGHT_RECORDER_DISCONNECT_STAGE:
+                std::cout << "disconnect " << detailName(disconnectStages, _countof(disconnectStages), event.Detail)
+                    << " address=" << std::hex << std::setw(12) << std::setfill('0') << event.Argument
+                    << std::setfill(' ') << std::dec;
+                break;
+            default:
+                std::cout << "unknown    type=" << static_cast<ULONG>(event.Type)
+                    << " argument=" << event.Argument;
+                break;
+            }
+
+            std::cout << std::endl;
+        }
+
+        return ERROR_SUCCESS;
+    }
+
+    //
+    // Takes two radio load snapshots one second apart and prints the throughput in between
+    // 
+    DWORD get_radio_load()
+    {
+        const auto paths = bthps3::EnumerateInterfaces(GUID_DEVINTERFACE_BTHPS3);
+
+        if (paths.empty())
+        {
+            return ERROR_FILE_NOT_FOUND;
+        }
+
+        bthps3::PdoClient pdo(bthps3::OpenWin32Transport, paths.front());
+        BTHPS3_GET_RADIO_LOAD before = {};
+        BTHPS3_GET_RADIO_LOAD after = {};
+        DWORD error;
+
+        if ((error = pdo.GetRadioLoad(before)) != ERROR_SUCCESS)
+        {
+            return error;
+        }
+
+        Sleep(1000);
+
+        if ((error = pdo.GetRadioLoad(after)) != ERROR_SUCCESS)
+        {
+            return error;
+        }
+
+        //
+        // Timestamps are in 100ns units
+        // 
+        const double seconds = after.Timestamp > before.Timestamp
+            ? (after.Timestamp - before.Timestamp) / 10000000.0
+            : 1.0;
+
+        for (ULONG index = 0; index < after.RadioCount && index < BTHPS3_MAX_RADIOS; index++)
+        {
+            const auto& radio = after.Radios[index];
+            ULONG64 previous = radio.BytesTransferred;
+
+            //
+            // Radios may have come or gone in between, match by address
+            // 
+            for (ULONG other = 0; other < before.RadioCount && other < BTHPS3_MAX_RADIOS; other++)
+            {
+                if (before.Radios[other].RadioAddress == radio.RadioAddress)
+                {
+                    previous = before.Radios[other].BytesTransferred;
+                    break;
+                }
+            }
+
+            std::cout << color(cyan) << "Radio " << color(white)
+                << std::hex << std::setw(12) << std::setfill('0') << radio.RadioAddress
+                << std::setfill(' ') << std::dec
+                << color(cyan) << " links " << color(magenta) << radio.ActiveLinks;
+
+            if (radio.MaxLinks)
+            {
+                std::cout << color(cyan) << "/" << color(magenta) << radio.MaxLinks;
+            }
+
+            std::cout << color(cyan) << ", " << color(magenta)
+                << std::fixed << std::setprecision(1) << ((radio.BytesTransferred - previous) / seconds)
+                << color(cyan) << " bytes/s, " << color(magenta) << radio.BytesTransferred
+                << color(cyan) << " bytes total, " << color(magenta) << radio.DeniedConnections
+                << color(cyan) << " denied, " << color(magenta) << radio.InputCrcFailures
+                << color(cyan) << " CRC failures, " << color(magenta) << radio.CachedDenials
+                << color(cyan) << " cached denials" << std::endl;
+        }
+
+        const auto next = bthps3::LeastLoadedRadio(after);
 
-        DWORD err = GetLastError();
-        CloseHandle(hDevice);
-        SetLastError(err);
+        if (next < after.RadioCount)
+        {
+            std::cout << color(cyan) << "Pair new controllers to radio " << color(white)
+                << std::hex << std::setw(12) << std::setfill('0') << after.Radios[next].RadioAddress
+                << std::setfill(' ') << std::dec << std::endl;
+        }
+        else if (after.RadioCount > 0)
+        {
+            std::cout << color(cyan) << "All radios are at their controller limit" << std::endl;
+        }
 
-        return ret > 0;
+        return ERROR_SUCCESS;
+    }
+
+    void print_psm_patch(const BTHPS3PSM_GET_PSM_PATCHING& state)
+    {
+        if (state.IsEnabled)
+        {
+            std::cout << color(cyan) << "PSM Patching is "
+                << color(magenta) << "enabled"
+                << color(cyan) << " for device ";
+            std::wcout << std::wstring(state.SymbolicLinkName) << std::endl;
+        }
+        else
+        {
+            std::cout << color(cyan) << "PSM Patching is "
+                << color(gray) << "disabled"
+                << color(cyan) << " for device ";
+            std::wcout << std::wstring(state.SymbolicLinkName) << std::endl;
+        }
     }
 
     std::string GetVersionFromFile(std::string FilePath)
@@ -219,12 +663,27 @@ int main(int, char* argv[])
     argh::parser cmdl;
     cmdl.add_params({
         "--device-index",
+        "--capture",
+        "--snap-length",
+        "--duration",
+        "--set-psm-remap",
+        "--replay-capture",
+        "--rules",
+        "--iterations",
+        "--allow",
+        "--suspend-for",
     });
     cmdl.parse(argv);
     ULONG deviceIndex = 0;
 
 #pragma region Filter settings
 
+    //
+    // Keeps the control device handle open for the whole run
+    // 
+    bthps3::FilterClient filter(bthps3::OpenWin32Transport);
+    DWORD error;
+
     if (cmdl[{"--enable-psm-patch"}])
     {
         if (!(cmdl({"--device-index"}) >> deviceIndex))
@@ -232,12 +691,12 @@ int main(int, char* argv[])
             std::cout << color(yellow) << "Device index missing, defaulting to 0" << std::endl;
         }
 
-        if (!enable_psm_patch(deviceIndex))
+        if ((error = filter.EnablePatch(deviceIndex)) != ERROR_SUCCESS)
         {
             std::cout << color(red) <<
                 "Couldn't enable PSM patch, error: "
-                << GetLastErrorStdStr() << std::endl;
-            return GetLastError();
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
         }
 
         std::cout << color(green) << "PSM Patch enabled successfully" << std::endl;
@@ -252,12 +711,12 @@ int main(int, char* argv[])
             std::cout << color(yellow) << "Device index missing, defaulting to 0" << std::endl;
         }
 
-        if (!disable_psm_patch(deviceIndex))
+        if ((error = filter.DisablePatch(deviceIndex)) != ERROR_SUCCESS)
         {
             std::cout << color(red) <<
                 "Couldn't disable PSM patch, error: "
-                << GetLastErrorStdStr() << std::endl;
-            return GetLastError();
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
         }
 
         std::cout << color(green) << "PSM Patch disabled successfully" << std::endl;
@@ -267,6 +726,27 @@ int main(int, char* argv[])
 
     if (cmdl[{"--get-psm-patch"}])
     {
+        if (cmdl[{"--all"}])
+        {
+            std::vector<BTHPS3PSM_GET_PSM_PATCHING> states;
+
+            if ((error = filter.GetPatchAll(states)) != ERROR_SUCCESS)
+            {
+                std::cout << color(red) <<
+                    "Couldn't fetch PSM patch states, error: "
+                    << GetLastErrorStdStr(error) << std::endl;
+                return error;
+            }
+
+            for (const auto& state : states)
+            {
+                std::cout << color(gray) << "[" << state.DeviceIndex << "] ";
+                print_psm_patch(state);
+            }
+
+            return EXIT_SUCCESS;
+        }
+
         if (!(cmdl({"--device-index"}) >> deviceIndex))
         {
             std::cout << color(yellow) << "Device index missing, defaulting to 0" << std::endl;
@@ -274,27 +754,287 @@ int main(int, char* argv[])
 
         BTHPS3PSM_GET_PSM_PATCHING req;
 
-        if (!get_psm_patch(&req, deviceIndex))
+        if ((error = filter.GetPatch(deviceIndex, req)) != ERROR_SUCCESS)
         {
             std::cout << color(red) <<
                 "Couldn't fetch PSM patch state, error: "
-                << GetLastErrorStdStr() << std::endl;
-            return GetLastError();
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
         }
 
-        if (req.IsEnabled)
+        print_psm_patch(req);
+
+        return EXIT_SUCCESS;
+    }
+
+    if (cmdl[{"--watch-psm-patch"}])
+    {
+        BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE req = {};
+
+        std::cout << color(cyan) << "Waiting for PSM patch state changes, press Ctrl+C to stop" << std::endl;
+
+        //
+        // Blocks until the filter reports a change, no polling involved
+        // 
+        while ((error = filter.WaitPatchChange(req)) == ERROR_SUCCESS)
         {
             std::cout << color(cyan) << "PSM Patching is "
-                << color(magenta) << "enabled"
-                << color(cyan) << " for device ";
-            std::wcout << std::wstring(req.SymbolicLinkName) << std::endl;
+                << color(req.IsEnabled ? magenta : gray)
+                << (req.IsEnabled ? "enabled" : "disabled")
+                << color(cyan) << " for device index " << req.DeviceIndex << std::endl;
+        }
+
+        std::cout << color(red) <<
+            "Waiting for PSM patch state change failed, error: "
+            << GetLastErrorStdStr(error) << std::endl;
+
+        return error;
+    }
+
+    if (cmdl[{"--get-psm-statistics"}])
+    {
+        if (!(cmdl({"--device-index"}) >> deviceIndex))
+        {
+            std::cout << color(yellow) << "Device index missing, defaulting to 0" << std::endl;
+        }
+
+        BTHPS3PSM_GET_STATISTICS req;
+
+        if ((error = filter.GetStatistics(deviceIndex, req)) != ERROR_SUCCESS)
+        {
+            std::cout << color(red) <<
+                "Couldn't fetch filter statistics, error: "
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
+        }
+
+        const auto& stats = req.Statistics;
+        const auto toMicroseconds = [&req](ULONG64 ticks)
+        {
+            return req.PerformanceFrequency ? (ticks * 1000000.0) / req.PerformanceFrequency : 0.0;
+        };
+
+        std::cout << color(cyan) << "Statistics aggregated over "
+            << color(magenta) << req.ProcessorCount
+            << color(cyan) << " processors" << std::endl;
+
+        std::cout << color(cyan) << "  URBs by function:" << std::endl;
+        for (ULONG i = 0; i < BTHPS3PSM_STATS_URB_FUNCTION_COUNT; i++)
+        {
+            if (stats.UrbsByFunction[i] == 0)
+            {
+                continue;
+            }
+
+            std::cout << color(gray) << "    0x" << std::hex << std::setw(4) << std::setfill('0') << i
+                << std::dec << ": " << color(white) << stats.UrbsByFunction[i] << std::endl;
+        }
+        if (stats.UrbsOtherFunction != 0)
+        {
+            std::cout << color(gray) << "    other: " << color(white) << stats.UrbsOtherFunction << std::endl;
+        }
+
+        std::cout << color(cyan) << "  Bulk IN transfers:    " << color(white) << stats.BulkInTransfers << std::endl;
+        std::cout << color(cyan) << "  Bulk IN bytes:        " << color(white) << stats.BulkInBytes << std::endl;
+
+        std::cout << color(cyan) << "  Signalling commands:" << std::endl;
+        for (ULONG i = 1; i < BTHPS3PSM_STATS_SIGNALLING_CODE_COUNT; i++)
+        {
+            std::cout << color(gray) << "    0x" << std::hex << std::setw(2) << std::setfill('0') << i
+                << std::dec << ": " << color(white) << stats.SignallingCommands[i] << std::endl;
+        }
+
+        std::cout << color(cyan) << "  PSMs patched:         " << color(white) << stats.PsmsPatched << std::endl;
+        std::cout << color(cyan) << "  PSMs not patched:     " << color(white) << stats.PsmsNotPatched << std::endl;
+        std::cout << color(cyan) << "  Completion time avg:  " << color(white)
+            << (stats.BulkInTransfers ? toMicroseconds(stats.CompletionRoutineTicks) / stats.BulkInTransfers : 0.0)
+            << " us" << std::endl;
+        std::cout << color(cyan) << "  Completion time max:  " << color(white)
+            << toMicroseconds(stats.CompletionRoutineTicksMax) << " us" << std::endl;
+
+        return EXIT_SUCCESS;
+    }
+
+    if (cmdl[{"--get-psm-remap"}])
+    {
+        if (!(cmdl({"--device-index"}) >> deviceIndex))
+        {
+            std::cout << color(yellow) << "Device index missing, defaulting to 0" << std::endl;
+        }
+
+        std::vector<BTHPS3PSM_PSM_REMAP_RULE> rules;
+
+        if ((error = filter.GetPsmRemap(deviceIndex, rules)) != ERROR_SUCCESS)
+        {
+            std::cout << color(red) <<
+                "Couldn't fetch PSM remap rules, error: "
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
+        }
+
+        std::cout << color(cyan) << "PSM remap rules for device index " << deviceIndex << ":" << std::endl;
+
+        for (const auto& rule : rules)
+        {
+            std::cout << color(gray) << "    0x" << std::hex << std::setw(4) << std::setfill('0') << rule.OriginalPsm
+                << " -> 0x" << std::setw(4) << rule.PatchedPsm << std::dec << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    std::string remap;
+
+    if (cmdl({"--set-psm-remap"}) >> remap)
+    {
+        if (!(cmdl({"--device-index"}) >> deviceIndex))
+        {
+            std::cout << color(yellow) << "Device index missing, defaulting to 0" << std::endl;
+        }
+
+        std::vector<BTHPS3PSM_PSM_REMAP_RULE> rules;
+
+        if (!parse_psm_remap(remap, rules))
+        {
+            std::cout << color(red) << "Malformed PSM remap rules, expected e.g. 0x0011=0x5053,0x0013=0x5055" << std::endl;
+            return ERROR_INVALID_PARAMETER;
+        }
+
+        if ((error = filter.SetPsmRemap(deviceIndex, rules)) != ERROR_SUCCESS)
+        {
+            std::cout << color(red) <<
+                "Couldn't set PSM remap rules, error: "
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
+        }
+
+        std::cout << color(green) << "PSM remap rules replaced successfully" << std::endl;
+
+        return EXIT_SUCCESS;
+    }
+
+#pragma endregion
+
+#pragma region Diagnostics
+
+    std::string path;
+
+    if (cmdl({"--capture"}) >> path)
+    {
+        ULONG snapLength = 0;
+        ULONG duration = 0;
+
+        if (!(cmdl({"--device-index"}) >> deviceIndex))
+        {
+            std::cout << color(yellow) << "Device index missing, defaulting to 0" << std::endl;
+        }
+
+        (void)(cmdl({"--snap-length"}) >> snapLength);
+        (void)(cmdl({"--duration"}) >> duration);
+
+        if ((error = capture_to_file(filter, path, deviceIndex, snapLength, duration)) != ERROR_SUCCESS)
+        {
+            std::cout << color(red) <<
+                "Couldn't capture traffic, error: "
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
+        }
+
+        std::cout << color(green) << "Capture written to " << path << std::endl;
+
+        return EXIT_SUCCESS;
+    }
+
+    if (cmdl({"--replay-capture"}) >> path)
+    {
+        std::vector<BTHPS3PSM_PSM_REMAP_RULE> rules;
+        ULONG iterations = 1;
+
+        if (cmdl({"--rules"}) >> remap)
+        {
+            if (!parse_psm_remap(remap, rules))
+            {
+                std::cout << color(red) << "Malformed PSM remap rules, expected e.g. 0x0011=0x5053,0x0013=0x5055" << std::endl;
+                return ERROR_INVALID_PARAMETER;
+            }
         }
         else
         {
-            std::cout << color(cyan) << "PSM Patching is "
-                << color(gray) << "disabled"
-                << color(cyan) << " for device ";
-            std::wcout << std::wstring(req.SymbolicLinkName) << std::endl;
+            (void)(cmdl({"--device-index"}) >> deviceIndex);
+
+            //
+            // Replay against the live rule set if the filter is around
+            // 
+            if (filter.GetPsmRemap(deviceIndex, rules) != ERROR_SUCCESS)
+            {
+                std::cout << color(yellow) << "Filter not reachable, replaying with default rules" << std::endl;
+
+                rules.clear();
+                rules.push_back({ L2CAP_PSM_HID_Command, PSM_DS3_HID_CONTROL });
+                rules.push_back({ L2CAP_PSM_HID_Interrupt, PSM_DS3_HID_INTERRUPT });
+            }
+        }
+
+        std::vector<ULONGLONG> allowList, suspendFor;
+        std::string addresses;
+
+        if ((cmdl({"--allow"}) >> addresses) && !parse_addresses(addresses, allowList))
+        {
+            std::cout << color(red) << "Malformed remote addresses, expected e.g. 001BDC0FAA58,00:1B:DC:0F:AA:59" << std::endl;
+            return ERROR_INVALID_PARAMETER;
+        }
+
+        if ((cmdl({"--suspend-for"}) >> addresses) && (!parse_addresses(addresses, suspendFor) || suspendFor.size() != 1))
+        {
+            std::cout << color(red) << "Malformed remote address, expected e.g. 001BDC0FAA58" << std::endl;
+            return ERROR_INVALID_PARAMETER;
+        }
+
+        (void)(cmdl({"--iterations"}) >> iterations);
+
+        if ((error = replay_capture(
+            path,
+            rules,
+            allowList,
+            suspendFor.empty() ? 0 : suspendFor.front(),
+            !cmdl[{"--patching-disabled"}],
+            iterations ? iterations : 1
+        )) != ERROR_SUCCESS)
+        {
+            std::cout << color(red) <<
+                "Couldn't replay capture, error: "
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+#pragma endregion
+
+#pragma region Bus driver diagnostics
+
+    if (cmdl[{"--dump-flight-recorder"}])
+    {
+        if ((error = dump_flight_recorder()) != ERROR_SUCCESS)
+        {
+            std::cout << color(red) <<
+                "Couldn't fetch flight recorder, error: "
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    if (cmdl[{"--get-radio-load"}])
+    {
+        if ((error = get_radio_load()) != ERROR_SUCCESS)
+        {
+            std::cout << color(red) <<
+                "Couldn't fetch radio load, error: "
+                << GetLastErrorStdStr(error) << std::endl;
+            return error;
         }
 
         return EXIT_SUCCESS;
@@ -325,6 +1065,27 @@ int main(int, char* argv[])
     std::cout << "      --device-index          Zero-based index of affected device (optional)" << std::endl;
     std::cout << "    --get-psm-patch           Reports the current state of the PSM patch" << std::endl;
     std::cout << "      --device-index          Zero-based index of affected device (optional)" << std::endl;
+    std::cout << "      --all                   Reports the state of all devices" << std::endl;
+    std::cout << "    --watch-psm-patch         Reports PSM patch state changes as they happen" << std::endl;
+    std::cout << "    --get-psm-statistics      Reports the filter traffic statistics" << std::endl;
+    std::cout << "      --device-index          Zero-based index of affected device (optional)" << std::endl;
+    std::cout << "    --get-psm-remap           Reports the PSM remap rules" << std::endl;
+    std::cout << "      --device-index          Zero-based index of affected device (optional)" << std::endl;
+    std::cout << "    --set-psm-remap <rules>   Replaces the PSM remap rules (e.g. 0x11=0x5053,0x13=0x5055)" << std::endl;
+    std::cout << "      --device-index          Zero-based index of affected device (optional)" << std::endl;
+    std::cout << "    --capture <file>          Captures radio traffic into a pcap file" << std::endl;
+    std::cout << "      --device-index          Zero-based index of affected device (optional)" << std::endl;
+    std::cout << "      --snap-length           Bytes to capture per packet (optional)" << std::endl;
+    std::cout << "      --duration              Seconds to capture, Ctrl+C stops otherwise (optional)" << std::endl;
+    std::cout << "    --replay-capture <file>   Replays a pcap/btsnoop capture through the PSM patch logic" << std::endl;
+    std::cout << "      --rules                 PSM remap rules to apply, queried from filter otherwise (optional)" << std::endl;
+    std::cout << "      --device-index          Zero-based index of device to query rules from (optional)" << std::endl;
+    std::cout << "      --iterations            Number of passes over the capture (optional)" << std::endl;
+    std::cout << "      --allow                 Allow-listed remote addresses, patched regardless of state (optional)" << std::endl;
+    std::cout << "      --suspend-for           Remote address patching starts suspended for (optional)" << std::endl;
+    std::cout << "      --patching-disabled     Start with radio-wide patching disabled (optional)" << std::endl;
+    std::cout << "    --dump-flight-recorder    Prints recent bus driver transfer and connection events" << std::endl;
+    std::cout << "    --get-radio-load          Reports links, throughput, denied connections and CRC failures per radio" << std::endl;
     std::cout << "    -v, --version             Display version of this utility" << std::endl;
     std::cout << std::endl;
 
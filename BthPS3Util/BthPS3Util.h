@@ -31,6 +31,9 @@
 #include <algorithm>
 #include <vector>
 #include <string>
+#include <sstream>
+#include <iomanip>
+#include <fstream>
 
 //
 // Driver constants
@@ -47,3 +50,26 @@
 // 
 #include "colorwin.hpp"
 
+//
+// Driver client library
+// 
+#include "BthPS3Client.hpp"
+#include "BthPS3ClientWin32.hpp"
+
+//
+// Capture file input and output
+// 
+#include "PcapWriter.h"
+#include "PcapReader.h"
+
+//
+// Filter signalling definitions and patch policy for capture replay
+// 
+#include "BthPS3Portable.h"
+#include "..\BthPS3PSM\L2CAP.h"
+extern "C" {
+#include "..\BthPS3PSM\HciTracker.h"
+#include "..\BthPS3PSM\PsmRemapTable.h"
+#include "..\BthPS3PSM\PatchPolicy.h"
+}
+
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+//
+// Minimal reader for Bluetooth HCI captures, accepts what PcapWriter
+// produces as well as btsnoop files recorded by other tools
+// 
+class PcapReader
+{
+public:
+    struct Packet
+    {
+        //
+        // BTHPS3PSM_CAPTURE_DIRECTION_*
+        // 
+        std::uint8_t Direction = 0;
+
+        //
+        // BTHPS3PSM_CAPTURE_PACKET_* (H4 type indicator)
+        // 
+        std::uint8_t PacketType = 0;
+
+        std::vector<std::uint8_t> Data;
+    };
+
+    explicit PcapReader(std::istream& stream)
+        : _stream(stream)
+    {
+        std::uint8_t magic[8] = {};
+
+        if (!_stream.read(reinterpret_cast<char*>(magic), sizeof(magic)))
+        {
+            return;
+        }
+
+        if (magic[0] == 0xD4 && magic[1] == 0xC3 && magic[2] == 0xB2 && magic[3] == 0xA1)
+        {
+            //
+            // Remainder of the global header, link type is the last field
+            // 
+            std::uint8_t header[16] = {};
+
+            if (_stream.read(reinterpret_cast<char*>(header), sizeof(header))
+                && get32le(&header[12]) == LinkTypeH4WithPhdr)
+            {
+                _format = Format::Pcap;
+                _snapLength = get32le(&header[8]);
+            }
+        }
+        else if (std::equal(magic, magic + sizeof(magic), "btsnoop\0"))
+        {
+            std::uint8_t header[8] = {};
+
+            if (_stream.read(reinterpret_cast<char*>(header), sizeof(header))
+                && get32be(&header[0]) == 1)
+            {
+                const auto dataLink = get32be(&header[4]);
+
+                if (dataLink == DataLinkH1)
+                {
+                    _format = Format::BtsnoopH1;
+                }
+                else if (dataLink == DataLinkH4)
+                {
+                    _format = Format::BtsnoopH4;
+                }
+            }
+        }
+    }
+
+    bool isValid() const
+    {
+        return _format != Format::Unknown;
+    }
+
+    //
+    // Returns false once the end of the file, a truncated or an oversized
+    // record is reached
+    // 
+    bool next(Packet& packet)
+    {
+        switch (_format)
+        {
+        case Format::Pcap:
+            return nextPcap(packet);
+        case Format::BtsnoopH1:
+        case Format::BtsnoopH4:
+            return nextBtsnoop(packet);
+        default:
+            return false;
+        }
+    }
+
+private:
+    //
+    // LINKTYPE_BLUETOOTH_HCI_H4_WITH_PHDR
+    // 
+    static constexpr std::uint32_t LinkTypeH4WithPhdr = 201;
+
+    //
+    // btsnoop un-encapsulated HCI and HCI UART (H4)
+    // 
+    static constexpr std::uint32_t DataLinkH1 = 1001;
+    static constexpr std::uint32_t DataLinkH4 = 1002;
+
+    //
+    // No HCI packet comes close, anything larger is a corrupt record
+    // 
+    static constexpr std::uint32_t MaxRecordLength = 0x10000;
+
+    enum class Format
+    {
+        Unknown,
+        Pcap,
+        BtsnoopH1,
+        BtsnoopH4
+    };
+
+    std::istream& _stream;
+    Format _format = Format::Unknown;
+
+    //
+    // Largest record the pcap header announces, 0 if unknown
+    // 
+    std::uint32_t _snapLength = 0;
+
+    bool nextPcap(Packet& packet)
+    {
+        std::uint8_t record[16] = {};
+
+        if (!_stream.read(reinterpret_cast<char*>(record), sizeof(record)))
+        {
+            return false;
+        }
+
+        const auto capturedLength = get32le(&record[8]);
+
+        //
+        // Direction pseudo-header (big-endian) and H4 type
+        // 
+        if (capturedLength < 5)
+        {
+            return false;
+        }
+
+        std::uint8_t prefix[5] = {};
+
+        if (!_stream.read(reinterpret_cast<char*>(prefix), sizeof(prefix)))
+        {
+            return false;
+        }
+
+        packet.Direction = static_cast<std::uint8_t>(get32be(prefix) & 1);
+        packet.PacketType = prefix[4];
+
+        return readData(packet, capturedLength - sizeof(prefix));
+    }
+
+    bool nextBtsnoop(Packet& packet)
+    {
+        std::uint8_t record[24] = {};
+
+        if (!_stream.read(reinterpret_cast<char*>(record), sizeof(record)))
+        {
+            return false;
+        }
+
+        auto includedLength = get32be(&record[4]);
+        const auto flags = get32be(&record[8]);
+
+        packet.Direction = static_cast<std::uint8_t>(flags & 1);
+
+        if (_format == Format::BtsnoopH4)
+        {
+            if (includedLength < 1 || !_stream.read(reinterpret_cast<char*>(&packet.PacketType), 1))
+            {
+                return false;
+            }
+
+            includedLength--;
+        }
+        else
+        {
+            //
+            // Bit 1 distinguishes command/event from ACL data
+            // 
+            packet.PacketType = (flags & 2)
+                ? static_cast<std::uint8_t>(packet.Direction ? 0x04 : 0x01)
+                : static_cast<std::uint8_t>(0x02);
+        }
+
+        return readData(packet, includedLength);
+    }
+
+    bool readData(Packet& packet, std::uint32_t length)
+    {
+        //
+        // Lengths come from the file, don't allocate what it claims blindly
+        // 
+        if (length > MaxRecordLength || (_snapLength != 0 && length > _snapLength))
+        {
+            return false;
+        }
+
+        packet.Data.resize(length);
+
+        return length == 0
+            || static_cast<bool>(_stream.read(reinterpret_cast<char*>(packet.Data.data()), length));
+    }
+
+    static std::uint32_t get32le(const std::uint8_t* bytes)
+    {
+        return bytes[0]
+            | (static_cast<std::uint32_t>(bytes[1]) << 8)
+            | (static_cast<std::uint32_t>(bytes[2]) << 16)
+            | (static_cast<std::uint32_t>(bytes[3]) << 24);
+    }
+
+    static std::uint32_t get32be(const std::uint8_t* bytes)
+    {
+        return (static_cast<std::uint32_t>(bytes[0]) << 24)
+            | (static_cast<std::uint32_t>(bytes[1]) << 16)
+            | (static_cast<std::uint32_t>(bytes[2]) << 8)
+            | bytes[3];
+    }
+};
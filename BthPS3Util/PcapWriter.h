@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+//
+// Minimal writer for classic libpcap files carrying Bluetooth HCI packets
+// with the H4 type indicator and a direction pseudo-header
+// 
+class PcapWriter
+{
+public:
+    //
+    // LINKTYPE_BLUETOOTH_HCI_H4_WITH_PHDR
+    // 
+    static constexpr std::uint32_t LinkType = 201;
+
+    //
+    // Bytes preceding the packet data (pseudo-header + H4 type)
+    // 
+    static constexpr std::uint32_t PacketPrefixLength = 5;
+
+    //
+    // Difference between January 1, 1601 and January 1, 1970 in 100 ns intervals
+    // 
+    static constexpr std::uint64_t FileTimeUnixEpoch = 116444736000000000ULL;
+
+    PcapWriter(std::ostream& stream, std::uint32_t snapLength)
+        : _stream(stream)
+    {
+        put32(0xA1B2C3D4); // magic (microsecond resolution)
+        put16(2); // major version
+        put16(4); // minor version
+        put32(0); // this zone
+        put32(0); // significant figures
+        put32(snapLength + PacketPrefixLength);
+        put32(LinkType);
+    }
+
+    //
+    // Appends a packet, timestamp is in FILETIME units
+    // 
+    void write(
+        std::uint64_t fileTime,
+        std::uint8_t direction,
+        std::uint8_t packetType,
+        const std::uint8_t* data,
+        std::uint32_t capturedLength,
+        std::uint32_t originalLength
+    )
+    {
+        const std::uint64_t unixTime = (fileTime > FileTimeUnixEpoch) ? fileTime - FileTimeUnixEpoch : 0;
+
+        put32(static_cast<std::uint32_t>(unixTime / 10000000ULL));
+        put32(static_cast<std::uint32_t>((unixTime % 10000000ULL) / 10ULL));
+        put32(capturedLength + PacketPrefixLength);
+        put32(originalLength + PacketPrefixLength);
+
+        //
+        // Pseudo-header direction is stored big-endian
+        // 
+        const std::uint8_t phdr[PacketPrefixLength] = {0, 0, 0, direction, packetType};
+
+        _stream.write(reinterpret_cast<const char*>(phdr), sizeof(phdr));
+        _stream.write(reinterpret_cast<const char*>(data), capturedLength);
+    }
+
+    void flush() const
+    {
+        _stream.flush();
+    }
+
+private:
+    std::ostream& _stream;
+
+    void put16(std::uint16_t value) const
+    {
+        const std::uint8_t bytes[] = {
+            static_cast<std::uint8_t>(value),
+            static_cast<std::uint8_t>(value >> 8)
+        };
+        _stream.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    }
+
+    void put32(std::uint32_t value) const
+    {
+        const std::uint8_t bytes[] = {
+            static_cast<std::uint8_t>(value),
+            static_cast<std::uint8_t>(value >> 8),
+            static_cast<std::uint8_t>(value >> 16),
+            static_cast<std::uint8_t>(value >> 24)
+        };
+        _stream.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    }
+};
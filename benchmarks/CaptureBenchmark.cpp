@@ -0,0 +1,183 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include <BthPS3Util/PcapWriter.h>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/CaptureRing.h>
+}
+
+namespace
+{
+    std::vector<BTHPS3PSM_CAPTURE_SLOT> Slots(BTHPS3PSM_CAPTURE_SLOT_COUNT);
+    BTHPS3PSM_CAPTURE_RING Ring{};
+
+    //
+    // Discards everything so only the writer's own cost gets measured
+    // 
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        std::streamsize xsputn(const char*, std::streamsize count) override
+        {
+            return count;
+        }
+
+        int_type overflow(int_type ch) override
+        {
+            return ch;
+        }
+    };
+}
+
+//
+// Recording a packet of the given length from the given number of threads,
+// the ring wraps constantly so this includes overwriting undrained slots
+// 
+static void BM_CaptureRingPush(benchmark::State& state)
+{
+    std::vector<UCHAR> packet(static_cast<size_t>(state.range(0)), 0x5A);
+
+    if (state.thread_index() == 0)
+    {
+        memset(Slots.data(), 0, Slots.size() * sizeof(BTHPS3PSM_CAPTURE_SLOT));
+
+        Ring = {};
+        Ring.Slots = Slots.data();
+        Ring.SnapLength = BTHPS3PSM_CAPTURE_MAX_SNAP_LEN;
+    }
+
+    ULONG64 timestamp = 0;
+
+    for (auto _ : state)
+    {
+        BthPS3PSM_CaptureRingPush(
+            &Ring,
+            timestamp++,
+            BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED,
+            BTHPS3PSM_CAPTURE_PACKET_ACL_DATA,
+            packet.data(),
+            static_cast<ULONG>(packet.size())
+        );
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CaptureRingPush)->Arg(BTHPS3PSM_CAPTURE_DEFAULT_SNAP_LEN)->Arg(BTHPS3PSM_CAPTURE_MAX_SNAP_LEN)->Threads(1)->Threads(4);
+
+//
+// Draining a full ring of default snap length packets
+// 
+static void BM_CaptureRingDrain(benchmark::State& state)
+{
+    std::vector<BTHPS3PSM_CAPTURE_SLOT> slots(BTHPS3PSM_CAPTURE_SLOT_COUNT);
+    std::vector<UCHAR> packet(BTHPS3PSM_CAPTURE_DEFAULT_SNAP_LEN, 0x5A);
+    std::vector<UCHAR> buffer((sizeof(BTHPS3PSM_CAPTURE_RECORD) + packet.size()) * BTHPS3PSM_CAPTURE_SLOT_COUNT);
+    BTHPS3PSM_CAPTURE_RING ring{};
+    size_t written;
+    ULONG count;
+    ULONG64 dropped;
+
+    memset(slots.data(), 0, slots.size() * sizeof(BTHPS3PSM_CAPTURE_SLOT));
+
+    ring.Slots = slots.data();
+    ring.SnapLength = BTHPS3PSM_CAPTURE_DEFAULT_SNAP_LEN;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+
+        for (ULONG i = 0; i < BTHPS3PSM_CAPTURE_SLOT_COUNT; i++)
+        {
+            BthPS3PSM_CaptureRingPush(
+                &ring,
+                i,
+                BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED,
+                BTHPS3PSM_CAPTURE_PACKET_ACL_DATA,
+                packet.data(),
+                static_cast<ULONG>(packet.size())
+            );
+        }
+
+        state.ResumeTiming();
+
+        BthPS3PSM_CaptureRingDrain(&ring, buffer.data(), buffer.size(), &written, &count, &dropped);
+        benchmark::DoNotOptimize(count);
+    }
+
+    state.SetItemsProcessed(state.iterations() * BTHPS3PSM_CAPTURE_SLOT_COUNT);
+}
+BENCHMARK(BM_CaptureRingDrain);
+
+//
+// Converting a drained record into a pcap packet record
+// 
+static void BM_PcapWriterWrite(benchmark::State& state)
+{
+    NullBuffer buffer;
+    std::ostream stream(&buffer);
+    PcapWriter writer(stream, BTHPS3PSM_CAPTURE_MAX_SNAP_LEN);
+    std::vector<std::uint8_t> packet(static_cast<size_t>(state.range(0)), 0x5A);
+    std::uint64_t timestamp = PcapWriter::FileTimeUnixEpoch;
+
+    for (auto _ : state)
+    {
+        writer.write(
+            timestamp++,
+            BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED,
+            BTHPS3PSM_CAPTURE_PACKET_ACL_DATA,
+            packet.data(),
+            static_cast<std::uint32_t>(packet.size()),
+            static_cast<std::uint32_t>(packet.size())
+        );
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PcapWriterWrite)->Arg(BTHPS3PSM_CAPTURE_DEFAULT_SNAP_LEN)->Arg(BTHPS3PSM_CAPTURE_MAX_SNAP_LEN);
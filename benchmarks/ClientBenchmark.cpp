@@ -0,0 +1,200 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <benchmark/benchmark.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+}
+
+#include <BthPS3Client.hpp>
+
+namespace
+{
+    using namespace bthps3;
+
+    //
+    // Device that answers every request right away and parks asynchronous
+    // ones until the benchmark completes them, so only the client's own
+    // queuing and re-arming gets measured
+    // 
+    class ImmediateTransport final : public IDeviceTransport
+    {
+    public:
+        struct Request
+        {
+            void* Out;
+            std::uint32_t OutLength;
+            TransferCompletion Completion;
+        };
+
+        explicit ImmediateTransport(std::deque<Request>& pending, bool completeInline)
+            : _pending(pending), _completeInline(completeInline)
+        {
+        }
+
+        std::uint32_t Control(
+            std::uint32_t,
+            const void*,
+            std::uint32_t,
+            void*,
+            std::uint32_t outLength,
+            std::uint32_t* bytesReturned
+        ) override
+        {
+            *bytesReturned = outLength;
+            return ErrorSuccess;
+        }
+
+        std::uint32_t ControlAsync(
+            std::uint32_t,
+            const void*,
+            std::uint32_t,
+            void* outBuffer,
+            std::uint32_t outLength,
+            TransferCompletion completion
+        ) override
+        {
+            if (_completeInline)
+            {
+                completion(ErrorSuccess, outLength);
+            }
+            else
+            {
+                _pending.push_back({outBuffer, outLength, std::move(completion)});
+            }
+
+            return ErrorSuccess;
+        }
+
+        void CancelAll() override
+        {
+            while (!_pending.empty())
+            {
+                auto request = std::move(_pending.front());
+                _pending.pop_front();
+                request.Completion(ErrorOperationAborted, 0);
+            }
+        }
+
+    private:
+        std::deque<Request>& _pending;
+        bool _completeInline;
+    };
+
+    TransportFactory FactoryFor(std::deque<ImmediateTransport::Request>& pending, bool completeInline)
+    {
+        return [&pending, completeInline](const std::wstring&, std::uint32_t*)
+        {
+            return std::unique_ptr<IDeviceTransport>(new ImmediateTransport(pending, completeInline));
+        };
+    }
+}
+
+//
+// Single query over the cached handle
+// 
+static void BM_FilterClientGetPatch(benchmark::State& state)
+{
+    std::deque<ImmediateTransport::Request> pending;
+    FilterClient client(FactoryFor(pending, true));
+    BTHPS3PSM_GET_PSM_PATCHING result;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(client.GetPatch(0, result));
+    }
+}
+BENCHMARK(BM_FilterClientGetPatch);
+
+//
+// Batch query across the given number of device indices
+// 
+static void BM_FilterClientGetPatchAll(benchmark::State& state)
+{
+    std::deque<ImmediateTransport::Request> pending;
+    FilterClient client(FactoryFor(pending, true));
+    std::vector<BTHPS3PSM_GET_PSM_PATCHING> results;
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(client.GetPatchAll(results, static_cast<std::uint32_t>(state.range(0))));
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FilterClientGetPatchAll)->Arg(1)->Arg(8)->Arg(64);
+
+//
+// Delivering one input report and re-arming its read with the given
+// number of reads kept in flight
+// 
+static void BM_PdoClientInputReport(benchmark::State& state)
+{
+    std::deque<ImmediateTransport::Request> pending;
+    PdoClient client(FactoryFor(pending, false), L"pdo");
+    std::uint64_t received = 0;
+
+    client.StartInputReports(
+        static_cast<std::uint32_t>(state.range(0)),
+        0x32,
+        [&received](const std::uint8_t*, std::uint32_t) { received++; }
+    );
+
+    for (auto _ : state)
+    {
+        auto request = std::move(pending.front());
+        pending.pop_front();
+
+        static_cast<std::uint8_t*>(request.Out)[0] = 0xA1;
+        request.Completion(ErrorSuccess, request.OutLength);
+    }
+
+    client.StopInputReports();
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(received));
+}
+BENCHMARK(BM_PdoClientInputReport)->Arg(1)->Arg(4)->Arg(16);
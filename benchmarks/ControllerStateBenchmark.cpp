@@ -0,0 +1,109 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/ControllerState.h>
+}
+
+namespace
+{
+    constexpr ULONG CorpusSize = 64;
+
+    //
+    // Input reports of one device type with buttons, sticks and sensors
+    // changing from one to the next
+    // 
+    std::vector<std::vector<UCHAR>> MakeCorpus(DS_DEVICE_TYPE DeviceType)
+    {
+        const size_t length = DeviceType == DS_DEVICE_TYPE_WIRELESS ? 79 : BTHPS3_SIXAXIS_HID_INPUT_REPORT_SIZE;
+        const UCHAR reportId = DeviceType == DS_DEVICE_TYPE_WIRELESS ? 0x11 : 0x01;
+        std::vector<std::vector<UCHAR>> corpus(CorpusSize);
+
+        for (ULONG index = 0; index < CorpusSize; index++)
+        {
+            auto& report = corpus[index];
+
+            report.resize(length);
+            report[0] = 0xA1;
+            report[1] = reportId;
+
+            for (size_t offset = 2; offset < length; offset++)
+            {
+                report[offset] = static_cast<UCHAR>(index * 37 + offset * 11);
+            }
+        }
+
+        return corpus;
+    }
+}
+
+//
+// Decoding cost per report for each device type
+// 
+static void BM_ControllerStateDecode(benchmark::State& state)
+{
+    const auto type = static_cast<DS_DEVICE_TYPE>(state.range(0));
+    const auto corpus = MakeCorpus(type);
+    BTHPS3_CONTROLLER_STATE decoded;
+
+    for (auto _ : state)
+    {
+        for (const auto& report : corpus)
+        {
+            benchmark::DoNotOptimize(BthPS3_ControllerStateDecode(
+                type,
+                report.data(),
+                static_cast<ULONG>(report.size()),
+                &decoded
+            ));
+            benchmark::ClobberMemory();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * CorpusSize);
+}
+BENCHMARK(BM_ControllerStateDecode)
+    ->ArgName("type")
+    ->Arg(DS_DEVICE_TYPE_SIXAXIS)
+    ->Arg(DS_DEVICE_TYPE_NAVIGATION)
+    ->Arg(DS_DEVICE_TYPE_MOTION)
+    ->Arg(DS_DEVICE_TYPE_WIRELESS);
@@ -0,0 +1,141 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/Crc32.h>
+}
+
+namespace
+{
+    std::vector<UCHAR> MakeData(size_t Length)
+    {
+        std::vector<UCHAR> data(Length);
+
+        for (size_t index = 0; index < Length; index++)
+        {
+            data[index] = static_cast<UCHAR>(index * 31 + 7);
+        }
+
+        return data;
+    }
+
+    //
+    // One table lookup per byte, the usual user-mode implementation
+    // 
+    ULONG Bytewise(const ULONG* Table, const UCHAR* Data, size_t Length)
+    {
+        ULONG crc = 0xFFFFFFFF;
+
+        for (size_t index = 0; index < Length; index++)
+        {
+            crc = (crc >> 8) ^ Table[(crc ^ Data[index]) & 0xFF];
+        }
+
+        return ~crc;
+    }
+}
+
+//
+// Slicing-by-8 across widths, 79 bytes is a DualShock 4 output report
+// 
+static void BM_Crc32Update(benchmark::State& state)
+{
+    const auto data = MakeData(static_cast<size_t>(state.range(0)));
+
+    BthPS3_Crc32Init();
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(BthPS3_Crc32Update(0, data.data(), static_cast<ULONG>(data.size())));
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Crc32Update)->Arg(8)->Arg(32)->Arg(79)->Arg(256)->Arg(1024)->Arg(4096);
+
+//
+// Byte at a time over the same widths for comparison
+// 
+static void BM_Crc32Bytewise(benchmark::State& state)
+{
+    const auto data = MakeData(static_cast<size_t>(state.range(0)));
+    ULONG table[256];
+
+    for (ULONG index = 0; index < 256; index++)
+    {
+        ULONG crc = index;
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0xEDB88320 : 0);
+        }
+
+        table[index] = crc;
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Bytewise(table, data.data(), data.size()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Crc32Bytewise)->Arg(8)->Arg(32)->Arg(79)->Arg(256)->Arg(1024)->Arg(4096);
+
+//
+// What the write path adds per DualShock 4 output report
+// 
+static void BM_Crc32Seal(benchmark::State& state)
+{
+    auto report = MakeData(79);
+
+    BthPS3_Crc32Init();
+
+    for (auto _ : state)
+    {
+        BthPS3_Crc32Seal(report.data(), static_cast<ULONG>(report.size()));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Crc32Seal);
@@ -0,0 +1,143 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/FlightRecorderRing.h>
+}
+
+namespace
+{
+    std::unique_ptr<BTHPS3_FLIGHT_RECORDER_RING> MakeRing()
+    {
+        auto ring = std::make_unique<BTHPS3_FLIGHT_RECORDER_RING>();
+
+        std::memset(ring.get(), 0, sizeof(BTHPS3_FLIGHT_RECORDER_RING));
+
+        return ring;
+    }
+}
+
+//
+// Recording cost without taking the timestamp, budget is ~20 ns per event
+// 
+static void BM_FlightRecorderRingWrite(benchmark::State& state)
+{
+    const auto ring = MakeRing();
+    ULONG64 timestamp = 0;
+
+    for (auto _ : state)
+    {
+        BthPS3_FlightRecorderRingWrite(
+            ring.get(),
+            timestamp++,
+            0,
+            BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+            BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_READ,
+            1,
+            49ULL << 32
+        );
+    }
+
+    benchmark::DoNotOptimize(ring->Head);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FlightRecorderRingWrite);
+
+//
+// Same with a monotonic clock read standing in for KeQueryPerformanceCounter
+// 
+static void BM_FlightRecorderRingWriteTimestamped(benchmark::State& state)
+{
+    const auto ring = MakeRing();
+
+    for (auto _ : state)
+    {
+        BthPS3_FlightRecorderRingWrite(
+            ring.get(),
+            static_cast<ULONG64>(std::chrono::steady_clock::now().time_since_epoch().count()),
+            0,
+            BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+            BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_READ,
+            1,
+            49ULL << 32
+        );
+    }
+
+    benchmark::DoNotOptimize(ring->Head);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FlightRecorderRingWriteTimestamped);
+
+//
+// Dump of a full ring as done per processor by IOCTL_BTHPS3_GET_FLIGHT_RECORDER
+// 
+static void BM_FlightRecorderRingSnapshot(benchmark::State& state)
+{
+    const auto ring = MakeRing();
+    std::vector<BTHPS3_FLIGHT_RECORDER_EVENT> events(BTHPS3_FLIGHT_RECORDER_RING_EVENTS);
+
+    for (ULONG64 index = 0; index < BTHPS3_FLIGHT_RECORDER_RING_EVENTS * 2; index++)
+    {
+        BthPS3_FlightRecorderRingWrite(ring.get(), index, 0, BTHPS3_FLIGHT_RECORDER_QUEUE_DEPTH, 0, 1, index);
+    }
+
+    for (auto _ : state)
+    {
+        ULONG64 lost = 0;
+
+        benchmark::DoNotOptimize(BthPS3_FlightRecorderRingSnapshot(
+            ring.get(),
+            events.data(),
+            BTHPS3_FLIGHT_RECORDER_RING_EVENTS,
+            &lost
+        ));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * BTHPS3_FLIGHT_RECORDER_RING_EVENTS);
+}
+BENCHMARK(BM_FlightRecorderRingSnapshot);
@@ -0,0 +1,81 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/L2CAP.h>
+}
+
+//
+// Classification every bulk IN transfer goes through, mostly HID input
+// reports on an interrupt channel and the odd signalling command
+// 
+static void BM_L2capClassifyTransfers(benchmark::State& state)
+{
+    std::vector<std::vector<UCHAR>> packets;
+
+    for (int index = 0; index < 64; index++)
+    {
+        std::vector<UCHAR> packet(0x36);
+
+        packet[0] = 0x2A;
+        packet[1] = 0x20;
+        packet[6] = (index % 16 == 0) ? 0x01 : 0x41;
+        packet[8] = (index % 16 == 0) ? L2CAP_Connection_Request : 0xA1;
+        packet[9] = 0x01;
+
+        packets.push_back(packet);
+    }
+
+    size_t index = 0;
+    ULONG signalling = 0;
+
+    for (auto _ : state)
+    {
+        auto& packet = packets[index++ & 63];
+
+        signalling += L2CAP_IS_SIGNALLING_PACKET(packet.data(), static_cast<ULONG>(packet.size()));
+        benchmark::DoNotOptimize(signalling);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_L2capClassifyTransfers);
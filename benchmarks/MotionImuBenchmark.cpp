@@ -0,0 +1,111 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/MotionImu.h>
+}
+
+namespace
+{
+    constexpr ULONG ReportSize = 50;
+
+    //
+    // Reports as they arrive 11.2 ms apart, sequence counter and sensor
+    // values changing from one to the next
+    // 
+    std::vector<UCHAR> MakeReports(ULONG Count)
+    {
+        std::vector<UCHAR> reports(static_cast<size_t>(Count) * ReportSize);
+
+        for (ULONG index = 0; index < Count; index++)
+        {
+            UCHAR* report = &reports[static_cast<size_t>(index) * ReportSize];
+
+            report[0] = 0xA1;
+            report[1] = 0x01;
+            report[5] = static_cast<UCHAR>(index & 0x0F);
+
+            for (ULONG offset = 14; offset < ReportSize; offset++)
+            {
+                report[offset] = static_cast<UCHAR>(index * 7 + offset);
+            }
+        }
+
+        return reports;
+    }
+}
+
+//
+// Unpacking cost per report, i.e. per two IMU samples
+// 
+static void BM_MotionImuUnpack(benchmark::State& state)
+{
+    const auto count = static_cast<ULONG>(state.range(0));
+    const auto reports = MakeReports(count);
+    std::vector<BTHPS3_MOTION_IMU_SAMPLE> samples(2 * static_cast<size_t>(count));
+    BTHPS3_MOTION_IMU_CLOCK clock;
+    ULONG64 arrival = 1000000;
+
+    BthPS3_MotionImuInit(&clock);
+
+    for (auto _ : state)
+    {
+        for (ULONG index = 0; index < count; index++)
+        {
+            arrival += 112000;
+
+            benchmark::DoNotOptimize(BthPS3_MotionImuUnpack(
+                &clock,
+                &reports[static_cast<size_t>(index) * ReportSize],
+                ReportSize,
+                arrival,
+                &samples[2 * static_cast<size_t>(index)]
+            ));
+        }
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetBytesProcessed(state.iterations() * count * ReportSize);
+}
+BENCHMARK(BM_MotionImuUnpack)->Arg(1)->Arg(64)->Arg(1024);
@@ -0,0 +1,110 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/PatchPolicy.h>
+}
+
+//
+// Full per-packet decision of the bulk IN completion over a stream of HID
+// input reports with a connection request for a remapped PSM every 16th
+// packet, patching disabled and one allow-listed remote
+// 
+static void BM_PatchPolicyProcessAcl(benchmark::State& state)
+{
+    const BTHPS3PSM_PSM_REMAP_RULE rules[] = {
+        { 0x0011, PSM_DS3_HID_CONTROL },
+        { 0x0013, PSM_DS3_HID_INTERRUPT }
+    };
+    const UCHAR connectionComplete[] = {
+        0x03, 0x0B, 0x00, 0x2A, 0x00, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, 0x01, 0x00
+    };
+    const ULONGLONG address = 0x112233445566ULL;
+
+    BTHPS3PSM_PSM_REMAP_TABLE table;
+    BTHPS3PSM_PATCH_POLICY policy;
+
+    if (BthPS3PSM_PsmRemapCompile(rules, ARRAYSIZE(rules), &table) != STATUS_SUCCESS)
+    {
+        state.SkipWithError("rule compilation failed");
+        return;
+    }
+
+    BthPS3PSM_PatchPolicyInit(&policy);
+    BthPS3PSM_PatchPolicyProcessEvents(&policy, connectionComplete, sizeof(connectionComplete));
+    BthPS3PSM_PatchPolicySetAddresses(&policy, &address, 1);
+
+    std::vector<std::vector<UCHAR>> packets;
+
+    for (int index = 0; index < 64; index++)
+    {
+        std::vector<UCHAR> packet(0x36);
+
+        packet[0] = 0x2A;
+        packet[1] = 0x20;
+        packet[6] = (index % 16 == 0) ? 0x01 : 0x41;
+        packet[8] = (index % 16 == 0) ? L2CAP_Connection_Request : 0xA1;
+        packet[9] = 0x01;
+
+        packets.push_back(packet);
+    }
+
+    size_t index = 0;
+    BTHPS3PSM_PATCH_RESULT result;
+
+    for (auto _ : state)
+    {
+        auto& packet = packets[index++ & 63];
+
+        //
+        // Undo the previous patch so every request is seen as received
+        // 
+        packet[12] = 0x11;
+        packet[13] = 0x00;
+
+        BthPS3PSM_PatchPolicyProcessAcl(&policy, &table, FALSE, packet.data(), static_cast<ULONG>(packet.size()), &result);
+        benchmark::DoNotOptimize(result);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PatchPolicyProcessAcl);
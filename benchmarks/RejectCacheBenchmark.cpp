@@ -0,0 +1,119 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/RejectCache.h>
+}
+
+namespace
+{
+    constexpr BTH_ADDR DeviceBase = 0x001A7D000000ULL;
+
+    //
+    // All entries taken, device n expires at n + 1000
+    // 
+    void Fill(BTHPS3_REJECT_CACHE* Cache)
+    {
+        BthPS3_RejectCacheInit(Cache);
+
+        for (ULONG index = 0; index < BTHPS3_REJECT_CACHE_ENTRIES; index++)
+        {
+            BthPS3_RejectCacheInsert(Cache, DeviceBase + index, 1000 + index);
+        }
+    }
+}
+
+//
+// Retry of a denied device, the argument selects the entry it sits in
+// 
+static void BM_RejectCacheHit(benchmark::State& state)
+{
+    BTHPS3_REJECT_CACHE cache;
+    const BTH_ADDR device = DeviceBase + static_cast<BTH_ADDR>(state.range(0));
+
+    Fill(&cache);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(BthPS3_RejectCacheContains(&cache, device, 0));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RejectCacheHit)->Arg(0)->Arg(BTHPS3_REJECT_CACHE_ENTRIES / 2)->Arg(BTHPS3_REJECT_CACHE_ENTRIES - 1);
+
+//
+// What every supported controller pays on connect, a scan of all entries
+// 
+static void BM_RejectCacheMiss(benchmark::State& state)
+{
+    BTHPS3_REJECT_CACHE cache;
+
+    Fill(&cache);
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(BthPS3_RejectCacheContains(&cache, 0x0019C1A2B3C4ULL, 0));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RejectCacheMiss);
+
+//
+// Denying a new device once the cache is full
+// 
+static void BM_RejectCacheInsert(benchmark::State& state)
+{
+    BTHPS3_REJECT_CACHE cache;
+    ULONG64 expiry = 2000;
+    BTH_ADDR device = DeviceBase + BTHPS3_REJECT_CACHE_ENTRIES;
+
+    Fill(&cache);
+
+    for (auto _ : state)
+    {
+        BthPS3_RejectCacheInsert(&cache, device++, expiry++);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RejectCacheInsert);
@@ -0,0 +1,113 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/SlotBitmap.h>
+}
+
+//
+// Allocating and releasing a slot with the given number of slots occupied
+// 
+static void BM_SlotMapAllocateRelease(benchmark::State& state)
+{
+    const ULONG occupied = static_cast<ULONG>(state.range(0));
+    std::vector<UINT32> words(BTHPS3_SLOT_MAP_MAX_SLOTS / BTHPS3_SLOT_BITMAP_BITS_PER_WORD);
+    BTHPS3_SLOT_MAP map{};
+
+    map.Words = words.data();
+    map.Capacity = BTHPS3_SLOT_MAP_MAX_SLOTS;
+    BthPS3_SlotMapRebuildSummary(&map);
+
+    for (ULONG slot = 0; slot < occupied; slot++)
+    {
+        BthPS3_SlotMapSet(&map, slot);
+    }
+
+    for (auto _ : state)
+    {
+        const ULONG slot = BthPS3_SlotMapFindClear(&map);
+
+        BthPS3_SlotMapSet(&map, slot);
+        benchmark::DoNotOptimize(slot);
+        BthPS3_SlotMapClear(&map, slot);
+    }
+}
+BENCHMARK(BM_SlotMapAllocateRelease)->Arg(0)->Arg(255)->Arg(2047)->Arg(BTHPS3_SLOT_MAP_MAX_SLOTS - 1);
+
+//
+// Reclaim walk over a test lab's worth of cached devices once the slot
+// space is exhausted, the registry access of the driver is not included
+// 
+static void BM_SlotReclaimScan(benchmark::State& state)
+{
+    const ULONG deviceCount = static_cast<ULONG>(state.range(0));
+    std::vector<ULONG> slots(deviceCount);
+    std::vector<ULONG64> times(deviceCount);
+    std::mt19937 random(0x5107);
+
+    for (ULONG index = 0; index < deviceCount; index++)
+    {
+        slots[index] = 1 + (index % (BTHPS3_SLOT_MAP_MAX_SLOTS - 1));
+        times[index] = random();
+    }
+
+    for (auto _ : state)
+    {
+        BTHPS3_SLOT_RECLAIM reclaim;
+
+        BthPS3_SlotReclaimInit(&reclaim, BTHPS3_SLOT_MAP_MAX_SLOTS);
+
+        for (ULONG index = 0; index < deviceCount; index++)
+        {
+            if (BthPS3_SlotReclaimIsOlder(&reclaim, slots[index], times[index]))
+            {
+                BthPS3_SlotReclaimTake(&reclaim, slots[index], times[index]);
+            }
+        }
+
+        benchmark::DoNotOptimize(reclaim.OldestSlot);
+    }
+
+    state.SetItemsProcessed(state.iterations() * deviceCount);
+}
+BENCHMARK(BM_SlotReclaimScan)->Arg(256)->Arg(BTHPS3_SLOT_MAP_MAX_SLOTS)->Arg(10000);
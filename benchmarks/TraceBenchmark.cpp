@@ -0,0 +1,194 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+
+extern "C" {
+#include <BthPS3Portable.h>
+}
+
+//
+// Stand-ins for the code WPP generates for a transfer function of
+// BusLogic.IO.c: HotFuncEntry, the transfer itself and HotFuncExit with
+// its status argument. Each trace point tests the session and the
+// in-flight recorder conditions the way the FUNC definitions of Trace.h
+// expand, the message call only happens if one of them passes.
+// 
+
+namespace
+{
+    constexpr UCHAR TraceLevelVerbose = 5;
+    constexpr ULONG TraceBusLogic = 1 << 7;
+
+    //
+    // Mirrors the fields of WPP_CONTROL the conditions read, volatile like
+    // the real block which a session can update at any time
+    // 
+    struct TraceControl
+    {
+        volatile ULONG Flags;
+        volatile UCHAR Level;
+        volatile BOOLEAN AutoLogVerboseEnabled;
+    };
+
+    TraceControl Control;
+
+    ULONG64 MessageSink;
+
+    //
+    // WPP_SF_* style message call, kept out of line like the real one
+    // 
+    __attribute__((noinline)) void TraceMessage(ULONG MessageId, const void* Function, NTSTATUS Status)
+    {
+        MessageSink += MessageId + reinterpret_cast<ULONG_PTR>(Function) + static_cast<ULONG>(Status);
+        benchmark::ClobberMemory();
+    }
+
+#define STUB_LEVEL_FLAGS_ENABLED(lvl, flags) \
+    ((Control.Flags & (flags)) && Control.Level >= (lvl))
+#define STUB_RECORDER_LEVEL_FLAGS_FILTER(lvl, flags) \
+    ((lvl) < TraceLevelVerbose || Control.AutoLogVerboseEnabled)
+
+#define STUB_TRACE(_enabled_, _filter_, _id_, _status_) \
+    do { if ((_enabled_) || (_filter_)) { TraceMessage((_id_), __func__, (_status_)); } } while (0)
+
+#define STUB_FUNC_ENTRY(flags) \
+    STUB_TRACE(STUB_LEVEL_FLAGS_ENABLED(TraceLevelVerbose, flags), \
+        STUB_RECORDER_LEVEL_FLAGS_FILTER(TraceLevelVerbose, flags), 10, STATUS_SUCCESS)
+#define STUB_FUNC_EXIT(flags, status) \
+    STUB_TRACE(STUB_LEVEL_FLAGS_ENABLED(TraceLevelVerbose, flags), \
+        STUB_RECORDER_LEVEL_FLAGS_FILTER(TraceLevelVerbose, flags), 11, (status))
+
+    //
+    // What BTHPS3_HOT_PATH_TRACING_DISABLED turns the hot tier into
+    // 
+#define STUB_HOT_FUNC_ENTRY(flags) \
+    STUB_TRACE(FALSE, FALSE, 10, STATUS_SUCCESS)
+#define STUB_HOT_FUNC_EXIT(flags, status) \
+    STUB_TRACE(FALSE, FALSE, 11, (status))
+
+    //
+    // Body of a transfer function, copies an output report into the request
+    // 
+    inline NTSTATUS Transfer(UCHAR* Destination, const UCHAR* Source)
+    {
+        std::memcpy(Destination, Source, 48);
+        benchmark::ClobberMemory();
+
+        return STATUS_SUCCESS;
+    }
+
+    void SetControl(ULONG Flags, UCHAR Level)
+    {
+        Control.Flags = Flags;
+        Control.Level = Level;
+        Control.AutoLogVerboseEnabled = FALSE;
+    }
+}
+
+//
+// Normal build with no session listening, the common case in the field
+// 
+static void BM_TraceTransferIdleSession(benchmark::State& state)
+{
+    UCHAR source[48] = { 0x52, 0x01 };
+    UCHAR destination[48];
+
+    SetControl(0, 0);
+
+    for (auto _ : state)
+    {
+        STUB_FUNC_ENTRY(TraceBusLogic);
+        const NTSTATUS status = Transfer(destination, source);
+        STUB_FUNC_EXIT(TraceBusLogic, status);
+
+        benchmark::DoNotOptimize(destination);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceTransferIdleSession);
+
+//
+// Normal build with a verbose session attached
+// 
+static void BM_TraceTransferVerboseSession(benchmark::State& state)
+{
+    UCHAR source[48] = { 0x52, 0x01 };
+    UCHAR destination[48];
+
+    SetControl(TraceBusLogic, TraceLevelVerbose);
+
+    for (auto _ : state)
+    {
+        STUB_FUNC_ENTRY(TraceBusLogic);
+        const NTSTATUS status = Transfer(destination, source);
+        STUB_FUNC_EXIT(TraceBusLogic, status);
+
+        benchmark::DoNotOptimize(destination);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceTransferVerboseSession);
+
+//
+// Performance build, the hot tier is gone at compile time
+// 
+static void BM_TraceTransferHotPathDisabled(benchmark::State& state)
+{
+    UCHAR source[48] = { 0x52, 0x01 };
+    UCHAR destination[48];
+
+    SetControl(TraceBusLogic, TraceLevelVerbose);
+
+    for (auto _ : state)
+    {
+        STUB_HOT_FUNC_ENTRY(TraceBusLogic);
+        const NTSTATUS status = Transfer(destination, source);
+        STUB_HOT_FUNC_EXIT(TraceBusLogic, status);
+
+        benchmark::DoNotOptimize(destination);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceTransferHotPathDisabled);
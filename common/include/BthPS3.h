@@ -245,6 +245,41 @@ DEFINE_GUID(GUID_DEVINTERFACE_BTHPS3_WIRELESS,
 // 
 #define BTHPS3_REG_VALUE_CHILD_IDLE_TIMEOUT     L"ChildIdleTimeout"
 
+//
+// Bounds (in milliseconds) the idle timeout may be adapted within based
+// on observed activity, adaptation is off if they are equal or missing
+// 
+#define BTHPS3_REG_VALUE_CHILD_IDLE_TIMEOUT_MIN L"ChildIdleTimeoutMin"
+#define BTHPS3_REG_VALUE_CHILD_IDLE_TIMEOUT_MAX L"ChildIdleTimeoutMax"
+
+//
+// Connections to a radio already serving this many controllers are rejected, 0 for no limit
+// 
+#define BTHPS3_REG_VALUE_MAX_CONTROLLERS_PER_RADIO  L"MaxControllersPerRadio"
+
+//
+// Should the profile driver send the SIXAXIS report enable command itself
+// once both channels are connected
+// 
+#define BTHPS3_REG_VALUE_SIXAXIS_ENABLE_ON_CONNECT  L"SIXAXISEnableOnConnect"
+
+//
+// Binary list of feature report IDs to answer GET_REPORT for from memory
+// once a device returned them
+// 
+#define BTHPS3_REG_VALUE_FEATURE_REPORT_CACHE_IDS   L"FeatureReportCacheIds"
+
+//
+// Should cached feature reports be kept in the device key across reboots
+// 
+#define BTHPS3_REG_VALUE_FEATURE_REPORT_CACHE_PERSIST   L"FeatureReportCachePersist"
+
+//
+// Seconds connection attempts of a device that couldn't be identified get
+// dropped without looking it up again, 0 to always look it up
+// 
+#define BTHPS3_REG_VALUE_REJECTED_DEVICE_CACHE_TIMEOUT  L"RejectedDeviceCacheTimeout"
+
 //
 // Should the profile driver attempt to auto-enable the patch again
 // 
@@ -313,6 +348,11 @@ DEFINE_GUID(GUID_DEVINTERFACE_BTHPS3_WIRELESS,
 // 
 #define BTHPS3_REG_VALUE_SLOT_NO    L"SlotNo"
 
+//
+// FILETIME of the last connection of a cached device, oldest gets its slot reclaimed first
+// 
+#define BTHPS3_REG_VALUE_LAST_CONNECTED_TIME    L"LastConnectedTime"
+
 #pragma endregion
 
 //
@@ -362,6 +402,9 @@ typedef enum _DS_DEVICE_TYPE
 #define BUSENUM_W_IOCTL(_index_)        CTL_CODE(FILE_DEVICE_BUSENUM, _index_, METHOD_BUFFERED, FILE_WRITE_DATA)
 #define BUSENUM_R_IOCTL(_index_)        CTL_CODE(FILE_DEVICE_BUSENUM, _index_, METHOD_BUFFERED, FILE_READ_DATA)
 #define BUSENUM_RW_IOCTL(_index_)       CTL_CODE(FILE_DEVICE_BUSENUM, _index_, METHOD_BUFFERED, FILE_WRITE_DATA | FILE_READ_DATA)
+#define BUSENUM_W_DIRECT_IOCTL(_index_) CTL_CODE(FILE_DEVICE_BUSENUM, _index_, METHOD_IN_DIRECT, FILE_WRITE_DATA)
+#define BUSENUM_R_DIRECT_IOCTL(_index_) CTL_CODE(FILE_DEVICE_BUSENUM, _index_, METHOD_OUT_DIRECT, FILE_READ_DATA)
+#define BUSENUM_RW_DIRECT_IOCTL(_index_) CTL_CODE(FILE_DEVICE_BUSENUM, _index_, METHOD_OUT_DIRECT, FILE_WRITE_DATA | FILE_READ_DATA)
 
 #define IOCTL_BTHPS3_BASE 0x801
 
@@ -389,6 +432,127 @@ typedef enum _DS_DEVICE_TYPE
 // 
 #define IOCTL_BTHPS3_HID_INTERRUPT_WRITE        BUSENUM_W_IOCTL (IOCTL_BTHPS3_BASE + 0x203)
 
+// 
+// Dump the bus driver's flight recorder
+// 
+#define IOCTL_BTHPS3_GET_FLIGHT_RECORDER        BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x204)
+
+// 
+// Snapshot of the load of all radios served by BthPS3
+// 
+#define IOCTL_BTHPS3_GET_RADIO_LOAD             BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x205)
+
+// 
+// Read from control channel straight into the caller's buffer
+// 
+#define IOCTL_BTHPS3_HID_CONTROL_READ_DIRECT    BUSENUM_R_DIRECT_IOCTL (IOCTL_BTHPS3_BASE + 0x206)
+
+// 
+// Write to control channel straight from the caller's buffer, data is
+// passed as the output buffer of DeviceIoControl
+// 
+#define IOCTL_BTHPS3_HID_CONTROL_WRITE_DIRECT   BUSENUM_W_DIRECT_IOCTL (IOCTL_BTHPS3_BASE + 0x207)
+
+// 
+// Read from interrupt channel straight into the caller's buffer
+// 
+#define IOCTL_BTHPS3_HID_INTERRUPT_READ_DIRECT  BUSENUM_R_DIRECT_IOCTL (IOCTL_BTHPS3_BASE + 0x208)
+
+// 
+// Write to interrupt channel straight from the caller's buffer, data is
+// passed as the output buffer of DeviceIoControl
+// 
+#define IOCTL_BTHPS3_HID_INTERRUPT_WRITE_DIRECT BUSENUM_W_DIRECT_IOCTL (IOCTL_BTHPS3_BASE + 0x209)
+
+// 
+// Query optional features of the bus driver, fails on older versions
+// 
+#define IOCTL_BTHPS3_GET_CAPABILITIES           BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x20A)
+
+// 
+// Set rumble and LEDs, the bus driver synthesizes the output report
+// 
+#define IOCTL_BTHPS3_SET_FEEDBACK               BUSENUM_W_IOCTL (IOCTL_BTHPS3_BASE + 0x20B)
+
+// 
+// Read from interrupt channel, Motion Controller reports get unpacked
+// into two BTHPS3_MOTION_IMU_SAMPLE records
+// 
+#define IOCTL_BTHPS3_HID_INTERRUPT_READ_IMU     BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x20C)
+
+// 
+// Write to interrupt channel, the bus driver fills in the trailing CRC32
+// of DualShock 4 reports
+// 
+#define IOCTL_BTHPS3_HID_INTERRUPT_WRITE_CRC    BUSENUM_W_IOCTL (IOCTL_BTHPS3_BASE + 0x20D)
+
+// 
+// Read from interrupt channel, the input report gets decoded into a
+// BTHPS3_CONTROLLER_STATE regardless of the device type
+// 
+#define IOCTL_BTHPS3_HID_INTERRUPT_READ_STATE   BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x20E)
+
+// 
+// Share a BTHPS3_STATE_PAGE in the output buffer with the bus driver, the
+// request stays pending while the driver keeps publishing into it
+// 
+#define IOCTL_BTHPS3_MAP_STATE_PAGE             BUSENUM_R_DIRECT_IOCTL (IOCTL_BTHPS3_BASE + 0x20F)
+
+// 
+// Send the input buffer to control channel and complete with the response
+// in the output buffer, transactions of a device run one at a time. A
+// transaction waits for plain control reads pending before it to complete
+// or get canceled, control reads issued meanwhile wait for it to complete
+// 
+#define IOCTL_BTHPS3_HID_CONTROL_TRANSACT       BUSENUM_RW_DIRECT_IOCTL (IOCTL_BTHPS3_BASE + 0x210)
+
+//
+// Radios reported by IOCTL_BTHPS3_GET_RADIO_LOAD at most
+// 
+#define BTHPS3_MAX_RADIOS                       0x10
+
+//
+// TRUE if a radio serving _links_ controllers has reached a cap of _max_, 0 for no limit
+// 
+#define BTHPS3_RADIO_IS_FULL(_links_, _max_)    ((_max_) != 0 && (_links_) >= (_max_))
+
+//
+// Events kept per processor in the flight recorder, must be a power of two
+// 
+#define BTHPS3_FLIGHT_RECORDER_RING_EVENTS      0x100
+
+//
+// Flight recorder event types
+// 
+#define BTHPS3_FLIGHT_RECORDER_TRANSFER_SUBMIT      0x01    // Argument: buffer length
+#define BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE    0x02    // Argument: NTSTATUS | (length << 32)
+#define BTHPS3_FLIGHT_RECORDER_QUEUE_DEPTH          0x03    // Argument: requests pending in queue
+#define BTHPS3_FLIGHT_RECORDER_CONNECT_STAGE        0x04    // Argument: remote BTH_ADDR
+#define BTHPS3_FLIGHT_RECORDER_DISCONNECT_STAGE     0x05    // Argument: remote BTH_ADDR
+
+//
+// Detail of transfer and queue depth events
+// 
+#define BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_READ         0x00
+#define BTHPS3_FLIGHT_RECORDER_CHANNEL_CONTROL_WRITE        0x01
+#define BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_READ       0x02
+#define BTHPS3_FLIGHT_RECORDER_CHANNEL_INTERRUPT_WRITE      0x03
+
+//
+// Detail of connect stage events
+// 
+#define BTHPS3_FLIGHT_RECORDER_CONNECT_INDICATED    0x00
+#define BTHPS3_FLIGHT_RECORDER_CONNECT_ACCEPTED     0x01
+#define BTHPS3_FLIGHT_RECORDER_CONNECT_DENIED       0x02
+#define BTHPS3_FLIGHT_RECORDER_CONNECT_PDO_CREATED  0x03
+
+//
+// Detail of disconnect stage events
+// 
+#define BTHPS3_FLIGHT_RECORDER_DISCONNECT_REQUESTED     0x00    // by the function driver
+#define BTHPS3_FLIGHT_RECORDER_DISCONNECT_INDICATED     0x01    // by the remote
+#define BTHPS3_FLIGHT_RECORDER_DISCONNECT_CHANNEL_CLOSE 0x02    // close channel BRB sent
+
 
 /*************************************************************/
 /* I/O control codes for filter control device communication */
@@ -409,6 +573,91 @@ typedef enum _DS_DEVICE_TYPE
 // 
 #define IOCTL_BTHPS3PSM_GET_PSM_PATCHING        BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x302)
 
+//
+// Retrieve aggregated traffic statistics for a supplied device index
+// 
+#define IOCTL_BTHPS3PSM_GET_STATISTICS          BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x303)
+
+//
+// Number of URB function code buckets, higher codes count as UrbsOtherFunction
+// 
+#define BTHPS3PSM_STATS_URB_FUNCTION_COUNT      0x40
+
+//
+// Number of L2CAP signalling command code buckets (codes 0x01 to 0x0B)
+// 
+#define BTHPS3PSM_STATS_SIGNALLING_CODE_COUNT   0x0C
+
+//
+// Enable or disable packet capture for a supplied device index
+// 
+#define IOCTL_BTHPS3PSM_SET_CAPTURE             BUSENUM_W_IOCTL (IOCTL_BTHPS3_BASE + 0x304)
+
+//
+// Fetch and remove captured packets for a supplied device index
+// 
+#define IOCTL_BTHPS3PSM_DRAIN_CAPTURE           BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x305)
+
+//
+// Wait for the PSM patch state of any device to change
+// 
+#define IOCTL_BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x306)
+
+//
+// Replace the PSM remap rules for a supplied device index
+// 
+#define IOCTL_BTHPS3PSM_SET_PSM_REMAP           BUSENUM_W_IOCTL (IOCTL_BTHPS3_BASE + 0x307)
+
+//
+// Retrieve the PSM remap rules for a supplied device index
+// 
+#define IOCTL_BTHPS3PSM_GET_PSM_REMAP           BUSENUM_R_IOCTL (IOCTL_BTHPS3_BASE + 0x308)
+
+//
+// Upper limit of PSM remap rules per device
+// 
+#define BTHPS3PSM_PSM_REMAP_MAX_RULES           0x20
+
+//
+// Replace the remote address allow-list for a supplied device index
+// 
+#define IOCTL_BTHPS3PSM_SET_ADDRESS_FILTER      BUSENUM_W_IOCTL (IOCTL_BTHPS3_BASE + 0x309)
+
+//
+// Upper limit of allow-listed remote addresses per device
+// 
+#define BTHPS3PSM_ADDRESS_FILTER_MAX_ADDRESSES  0x40
+
+//
+// Disable PSM patch for a supplied device index until the supplied remote
+// completed or failed an unpatched connection attempt. Several remotes can be
+// suspended at once, fails with STATUS_INSUFFICIENT_RESOURCES if too many are
+// still being watched.
+// 
+#define IOCTL_BTHPS3PSM_SUSPEND_PSM_PATCHING    BUSENUM_W_IOCTL (IOCTL_BTHPS3_BASE + 0x30A)
+
+//
+// Upper limit of bytes captured per packet
+// 
+#define BTHPS3PSM_CAPTURE_MAX_SNAP_LEN          0x200
+
+//
+// Snap length used if none is supplied (covers HCI ACL, L2CAP and signalling headers)
+// 
+#define BTHPS3PSM_CAPTURE_DEFAULT_SNAP_LEN      0x20
+
+//
+// Packet types of captured records (identical to HCI UART transport indicators)
+// 
+#define BTHPS3PSM_CAPTURE_PACKET_ACL_DATA       0x02
+#define BTHPS3PSM_CAPTURE_PACKET_HCI_EVENT      0x04
+
+//
+// Directions of captured records (identical to pcap Bluetooth pseudo-header)
+// 
+#define BTHPS3PSM_CAPTURE_DIRECTION_SENT        0x00
+#define BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED    0x01
+
 #include <pshpack1.h>
 
 //
@@ -442,6 +691,588 @@ typedef struct _BTHPS3PSM_GET_PSM_PATCHING
 
 } BTHPS3PSM_GET_PSM_PATCHING, *PBTHPS3PSM_GET_PSM_PATCHING;
 
+//
+// Payload for IOCTL_BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE
+// 
+typedef struct _BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE
+{
+    //
+    // Sequence of the last change the caller has seen (zero initially). The
+    // request stays pending while it matches the latest change and returns
+    // the sequence of the reported change otherwise.
+    // 
+    IN OUT ULONG64 Sequence;
+
+    //
+    // Device index the change occurred on
+    // 
+    OUT ULONG DeviceIndex;
+
+    //
+    // New patch state of that device
+    // 
+    OUT ULONG IsEnabled;
+
+} BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE, *PBTHPS3PSM_WAIT_PSM_PATCHING_CHANGE;
+
+//
+// Traffic counters of a filter device
+// 
+typedef struct _BTHPS3PSM_STATISTICS
+{
+    //
+    // IOCTL_INTERNAL_USB_SUBMIT_URB requests seen, indexed by URB function code
+    // 
+    ULONG64 UrbsByFunction[BTHPS3PSM_STATS_URB_FUNCTION_COUNT];
+
+    //
+    // IOCTL_INTERNAL_USB_SUBMIT_URB requests with a function code beyond
+    // UrbsByFunction
+    // 
+    ULONG64 UrbsOtherFunction;
+
+    //
+    // Completed bulk IN (L2CAP) transfers
+    // 
+    ULONG64 BulkInTransfers;
+
+    //
+    // Total payload bytes of completed bulk IN transfers
+    // 
+    ULONG64 BulkInBytes;
+
+    //
+    // L2CAP signalling commands seen, indexed by command code
+    // 
+    ULONG64 SignallingCommands[BTHPS3PSM_STATS_SIGNALLING_CODE_COUNT];
+
+    //
+    // HID PSMs that got patched
+    // 
+    ULONG64 PsmsPatched;
+
+    //
+    // HID PSMs that were left alone because patching was disabled
+    // 
+    ULONG64 PsmsNotPatched;
+
+    //
+    // Accumulated time spent in the bulk IN completion routine (performance counter ticks)
+    // 
+    ULONG64 CompletionRoutineTicks;
+
+    //
+    // Longest single bulk IN completion routine run (performance counter ticks)
+    // 
+    ULONG64 CompletionRoutineTicksMax;
+
+} BTHPS3PSM_STATISTICS, *PBTHPS3PSM_STATISTICS;
+
+//
+// Payload for IOCTL_BTHPS3PSM_GET_STATISTICS
+// 
+typedef struct _BTHPS3PSM_GET_STATISTICS
+{
+    IN ULONG DeviceIndex;
+
+    //
+    // Number of per-processor counter blocks that got summed up
+    // 
+    OUT ULONG ProcessorCount;
+
+    //
+    // Performance counter frequency to convert ticks to time
+    // 
+    OUT ULONG64 PerformanceFrequency;
+
+    OUT BTHPS3PSM_STATISTICS Statistics;
+
+} BTHPS3PSM_GET_STATISTICS, *PBTHPS3PSM_GET_STATISTICS;
+
+//
+// Payload for IOCTL_BTHPS3PSM_SET_CAPTURE
+// 
+typedef struct _BTHPS3PSM_SET_CAPTURE
+{
+    IN ULONG DeviceIndex;
+
+    IN ULONG IsEnabled;
+
+    //
+    // Bytes to capture per packet, zero selects BTHPS3PSM_CAPTURE_DEFAULT_SNAP_LEN
+    // 
+    IN ULONG SnapLength;
+
+} BTHPS3PSM_SET_CAPTURE, *PBTHPS3PSM_SET_CAPTURE;
+
+//
+// Single captured packet, CapturedLength bytes of data follow immediately
+// 
+typedef struct _BTHPS3PSM_CAPTURE_RECORD
+{
+    //
+    // System time of capture (100 ns intervals since January 1, 1601 UTC)
+    // 
+    ULONG64 Timestamp;
+
+    //
+    // Length of the packet on the wire
+    // 
+    ULONG OriginalLength;
+
+    //
+    // Length of the data following this record
+    // 
+    USHORT CapturedLength;
+
+    //
+    // BTHPS3PSM_CAPTURE_DIRECTION_*
+    // 
+    UCHAR Direction;
+
+    //
+    // BTHPS3PSM_CAPTURE_PACKET_*
+    // 
+    UCHAR PacketType;
+
+} BTHPS3PSM_CAPTURE_RECORD, *PBTHPS3PSM_CAPTURE_RECORD;
+
+//
+// Payload for IOCTL_BTHPS3PSM_DRAIN_CAPTURE, RecordCount variable-length
+// records follow immediately up to the size of the output buffer
+// 
+typedef struct _BTHPS3PSM_DRAIN_CAPTURE
+{
+    IN ULONG DeviceIndex;
+
+    OUT ULONG RecordCount;
+
+    //
+    // Packets lost since the previous drain because the ring was full
+    // 
+    OUT ULONG64 DroppedCount;
+
+} BTHPS3PSM_DRAIN_CAPTURE, *PBTHPS3PSM_DRAIN_CAPTURE;
+
+//
+// Rewrites OriginalPsm of incoming L2CAP connection requests to PatchedPsm
+// 
+typedef struct _BTHPS3PSM_PSM_REMAP_RULE
+{
+    USHORT OriginalPsm;
+
+    USHORT PatchedPsm;
+
+} BTHPS3PSM_PSM_REMAP_RULE, *PBTHPS3PSM_PSM_REMAP_RULE;
+
+//
+// Payload for IOCTL_BTHPS3PSM_SET_PSM_REMAP
+// 
+typedef struct _BTHPS3PSM_SET_PSM_REMAP
+{
+    IN ULONG DeviceIndex;
+
+    IN ULONG RuleCount;
+
+    IN BTHPS3PSM_PSM_REMAP_RULE Rules[BTHPS3PSM_PSM_REMAP_MAX_RULES];
+
+} BTHPS3PSM_SET_PSM_REMAP, *PBTHPS3PSM_SET_PSM_REMAP;
+
+//
+// Payload for IOCTL_BTHPS3PSM_GET_PSM_REMAP
+// 
+typedef struct _BTHPS3PSM_GET_PSM_REMAP
+{
+    IN ULONG DeviceIndex;
+
+    OUT ULONG RuleCount;
+
+    OUT BTHPS3PSM_PSM_REMAP_RULE Rules[BTHPS3PSM_PSM_REMAP_MAX_RULES];
+
+} BTHPS3PSM_GET_PSM_REMAP, *PBTHPS3PSM_GET_PSM_REMAP;
+
+//
+// Payload for IOCTL_BTHPS3PSM_SET_ADDRESS_FILTER
+// 
+// Connections from these remotes get patched even while PSM patching
+// is disabled for the radio.
+// 
+typedef struct _BTHPS3PSM_SET_ADDRESS_FILTER
+{
+    IN ULONG DeviceIndex;
+
+    IN ULONG AddressCount;
+
+    //
+    // Remote addresses (BTH_ADDR)
+    // 
+    IN ULONGLONG Addresses[BTHPS3PSM_ADDRESS_FILTER_MAX_ADDRESSES];
+
+} BTHPS3PSM_SET_ADDRESS_FILTER, *PBTHPS3PSM_SET_ADDRESS_FILTER;
+
+//
+// Payload for IOCTL_BTHPS3PSM_SUSPEND_PSM_PATCHING
+// 
+typedef struct _BTHPS3PSM_SUSPEND_PSM_PATCHING
+{
+    IN ULONG DeviceIndex;
+
+    //
+    // Remote (BTH_ADDR) whose patched connection got rejected
+    // 
+    IN ULONGLONG RemoteAddress;
+
+} BTHPS3PSM_SUSPEND_PSM_PATCHING, *PBTHPS3PSM_SUSPEND_PSM_PATCHING;
+
+//
+// Single flight recorder event, recorded without any formatting
+// 
+typedef struct _BTHPS3_FLIGHT_RECORDER_EVENT
+{
+    //
+    // Performance counter value at record time
+    // 
+    ULONG64 Timestamp;
+
+    //
+    // Event specific, see BTHPS3_FLIGHT_RECORDER_* types
+    // 
+    ULONG64 Argument;
+
+    //
+    // Serial number of the affected device, zero if none
+    // 
+    USHORT Slot;
+
+    //
+    // BTHPS3_FLIGHT_RECORDER_* type
+    // 
+    UCHAR Type;
+
+    //
+    // Channel or stage, depending on Type
+    // 
+    UCHAR Detail;
+
+    //
+    // Processor the event got recorded on
+    // 
+    ULONG Processor;
+
+} BTHPS3_FLIGHT_RECORDER_EVENT, *PBTHPS3_FLIGHT_RECORDER_EVENT;
+
+//
+// Payload for IOCTL_BTHPS3_GET_FLIGHT_RECORDER, EventCount events follow
+// immediately, oldest first per processor, up to the size of the output buffer
+// 
+typedef struct _BTHPS3_GET_FLIGHT_RECORDER
+{
+    OUT ULONG64 PerformanceFrequency;
+
+    OUT ULONG ProcessorCount;
+
+    OUT ULONG EventCount;
+
+    //
+    // Events overwritten before they could be dumped
+    // 
+    OUT ULONG64 LostCount;
+
+} BTHPS3_GET_FLIGHT_RECORDER, *PBTHPS3_GET_FLIGHT_RECORDER;
+
+//
+// Load of a single radio
+// 
+typedef struct _BTHPS3_RADIO_LOAD
+{
+    //
+    // Address of the local radio
+    // 
+    OUT ULONGLONG RadioAddress;
+
+    //
+    // Currently connected controllers
+    // 
+    OUT ULONG ActiveLinks;
+
+    //
+    // Configured controller cap, 0 if unlimited
+    // 
+    OUT ULONG MaxLinks;
+
+    //
+    // HID payload bytes moved since the radio got started
+    // 
+    OUT ULONG64 BytesTransferred;
+
+    //
+    // Connections rejected because the radio was at its cap
+    // 
+    OUT ULONG64 DeniedConnections;
+
+    //
+    // DualShock 4 input reports that failed the CRC32 check
+    // 
+    OUT ULONG64 InputCrcFailures;
+
+    //
+    // Connections of unidentified devices dropped without looking them up again
+    // 
+    OUT ULONG64 CachedDenials;
+
+    //
+    // Unidentified devices remembered for RejectedDeviceCacheTimeout
+    // 
+    OUT ULONG64 RejectedDevices;
+
+} BTHPS3_RADIO_LOAD, *PBTHPS3_RADIO_LOAD;
+
+//
+// Payload for IOCTL_BTHPS3_GET_RADIO_LOAD, throughput is derived from the
+// difference of two snapshots
+// 
+typedef struct _BTHPS3_GET_RADIO_LOAD
+{
+    //
+    // Interrupt time (100ns units) the snapshot got taken at
+    // 
+    OUT ULONG64 Timestamp;
+
+    OUT ULONG RadioCount;
+
+    OUT BTHPS3_RADIO_LOAD Radios[BTHPS3_MAX_RADIOS];
+
+} BTHPS3_GET_RADIO_LOAD, *PBTHPS3_GET_RADIO_LOAD;
+
+//
+// Optional features reported by IOCTL_BTHPS3_GET_CAPABILITIES
+// 
+typedef enum _BTHPS3_CAPABILITY
+{
+    //
+    // IOCTL_BTHPS3_HID_*_DIRECT are supported
+    // 
+    BTHPS3_CAPABILITY_DIRECT_HID_IO = 0x00000001,
+
+    //
+    // IOCTL_BTHPS3_SET_FEEDBACK is supported
+    // 
+    BTHPS3_CAPABILITY_SET_FEEDBACK = 0x00000002,
+
+    //
+    // IOCTL_BTHPS3_HID_INTERRUPT_READ_IMU is supported
+    // 
+    BTHPS3_CAPABILITY_MOTION_IMU = 0x00000004,
+
+    //
+    // IOCTL_BTHPS3_HID_INTERRUPT_WRITE_CRC is supported
+    // 
+    BTHPS3_CAPABILITY_WRITE_CRC = 0x00000008,
+
+    //
+    // IOCTL_BTHPS3_HID_INTERRUPT_READ_STATE is supported
+    // 
+    BTHPS3_CAPABILITY_DECODED_STATE = 0x00000010,
+
+    //
+    // IOCTL_BTHPS3_MAP_STATE_PAGE is supported
+    // 
+    BTHPS3_CAPABILITY_STATE_PAGE = 0x00000020,
+
+    //
+    // IOCTL_BTHPS3_HID_CONTROL_TRANSACT is supported
+    // 
+    BTHPS3_CAPABILITY_CONTROL_TRANSACTION = 0x00000040
+
+} BTHPS3_CAPABILITY;
+
+//
+// Payload for IOCTL_BTHPS3_GET_CAPABILITIES
+// 
+typedef struct _BTHPS3_GET_CAPABILITIES
+{
+    //
+    // Combination of BTHPS3_CAPABILITY flags
+    // 
+    OUT ULONG Capabilities;
+
+} BTHPS3_GET_CAPABILITIES, *PBTHPS3_GET_CAPABILITIES;
+
+//
+// Send the output report even if it equals the last one sent
+// 
+#define BTHPS3_SET_FEEDBACK_FLAG_FORCE          0x01
+
+//
+// Payload for IOCTL_BTHPS3_SET_FEEDBACK, unsupported device types fail
+// with STATUS_NOT_SUPPORTED
+// 
+typedef struct _BTHPS3_SET_FEEDBACK
+{
+    //
+    // Small (right) motor, on if non-zero
+    // 
+    IN UCHAR SmallMotor;
+
+    //
+    // Large (left) motor strength
+    // 
+    IN UCHAR LargeMotor;
+
+    //
+    // Rumble duration, 0xFF lasts until changed
+    // 
+    IN UCHAR Duration;
+
+    //
+    // Bits 0-3 for player LEDs 1-4, red/green/blue sphere on the Motion Controller
+    // 
+    IN UCHAR LedMask;
+
+    //
+    // BTHPS3_SET_FEEDBACK_FLAG_*
+    // 
+    IN UCHAR Flags;
+
+} BTHPS3_SET_FEEDBACK, *PBTHPS3_SET_FEEDBACK;
+
+//
+// One accelerometer/gyroscope sample of a Motion Controller, returned in
+// pairs (older first) by IOCTL_BTHPS3_HID_INTERRUPT_READ_IMU
+// 
+typedef struct _BTHPS3_MOTION_IMU_SAMPLE
+{
+    //
+    // Interrupt time (100ns units), interpolated for the older sample
+    // 
+    OUT ULONG64 Timestamp;
+
+    //
+    // Raw X, Y, Z readings centered around zero
+    // 
+    OUT SHORT Accelerometer[3];
+
+    OUT SHORT Gyroscope[3];
+
+    //
+    // 4-bit report sequence counter
+    // 
+    OUT UCHAR Sequence;
+
+    //
+    // 0 for the older, 1 for the newer sample of the report
+    // 
+    OUT UCHAR Frame;
+
+    OUT USHORT Reserved;
+
+} BTHPS3_MOTION_IMU_SAMPLE, *PBTHPS3_MOTION_IMU_SAMPLE;
+
+//
+// Buttons of BTHPS3_CONTROLLER_STATE, devices only report a subset
+// 
+#define BTHPS3_BUTTON_DPAD_UP                   0x00000001
+#define BTHPS3_BUTTON_DPAD_DOWN                 0x00000002
+#define BTHPS3_BUTTON_DPAD_LEFT                 0x00000004
+#define BTHPS3_BUTTON_DPAD_RIGHT                0x00000008
+#define BTHPS3_BUTTON_START                     0x00000010
+#define BTHPS3_BUTTON_SELECT                    0x00000020
+#define BTHPS3_BUTTON_L3                        0x00000040
+#define BTHPS3_BUTTON_R3                        0x00000080
+#define BTHPS3_BUTTON_L1                        0x00000100
+#define BTHPS3_BUTTON_R1                        0x00000200
+#define BTHPS3_BUTTON_L2                        0x00000400
+#define BTHPS3_BUTTON_R2                        0x00000800
+#define BTHPS3_BUTTON_CROSS                     0x00001000
+#define BTHPS3_BUTTON_CIRCLE                    0x00002000
+#define BTHPS3_BUTTON_SQUARE                    0x00004000
+#define BTHPS3_BUTTON_TRIANGLE                  0x00008000
+#define BTHPS3_BUTTON_PS                        0x00010000
+#define BTHPS3_BUTTON_TOUCHPAD                  0x00020000
+#define BTHPS3_BUTTON_MOVE                      0x00040000
+#define BTHPS3_BUTTON_T                         0x00080000
+
+//
+// Device independent input state returned by IOCTL_BTHPS3_HID_INTERRUPT_READ_STATE
+// 
+typedef struct _BTHPS3_CONTROLLER_STATE
+{
+    //
+    // Interrupt time (100ns units) the report arrived at
+    // 
+    OUT ULONG64 Timestamp;
+
+    //
+    // Combination of BTHPS3_BUTTON_* flags
+    // 
+    OUT ULONG Buttons;
+
+    //
+    // Left X, left Y, right X, right Y, 0x80 is centered
+    // 
+    OUT UCHAR Sticks[4];
+
+    //
+    // Left and right analog trigger, the Motion Controller only has T (right)
+    // 
+    OUT UCHAR Triggers[2];
+
+    //
+    // Raw battery/charging status byte, encoding differs per device type
+    // 
+    OUT UCHAR Battery;
+
+    //
+    // DS_DEVICE_TYPE of the device
+    // 
+    OUT UCHAR DeviceType;
+
+    //
+    // Raw X, Y, Z readings centered around zero, the SIXAXIS only reports yaw
+    // 
+    OUT SHORT Accelerometer[3];
+
+    OUT SHORT Gyroscope[3];
+
+} BTHPS3_CONTROLLER_STATE, *PBTHPS3_CONTROLLER_STATE;
+
+//
+// Longest input report kept in BTHPS3_STATE_PAGE, longer ones are truncated
+// 
+#define BTHPS3_STATE_PAGE_REPORT_SIZE           0x80
+
+//
+// Latest input report of a device, published by the bus driver into the
+// buffer of a pending IOCTL_BTHPS3_MAP_STATE_PAGE. Sequence is odd while an
+// update is in progress; a copy taken between two equal even reads of it is
+// consistent, otherwise the reader retries
+// 
+typedef struct _BTHPS3_STATE_PAGE
+{
+    OUT volatile LONG Sequence;
+
+    //
+    // Valid bytes in Report
+    // 
+    OUT ULONG ReportLength;
+
+    //
+    // Interrupt time (100ns units) the report arrived at
+    // 
+    OUT ULONG64 Timestamp;
+
+    //
+    // Reports published since the page got mapped
+    // 
+    OUT ULONG64 ReportCount;
+
+    //
+    // Including the HIDP DATA header
+    // 
+    OUT UCHAR Report[BTHPS3_STATE_PAGE_REPORT_SIZE];
+
+} BTHPS3_STATE_PAGE, *PBTHPS3_STATE_PAGE;
+
 #include <poppack.h>
 
 #pragma endregion
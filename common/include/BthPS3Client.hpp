@@ -0,0 +1,839 @@
+#pragma once
+
+//
+// User-mode client library for the filter control device and the PDO interfaces.
+//
+// The logic in this header talks to devices exclusively through IDeviceTransport so
+// it can be driven by a fake device; BthPS3ClientWin32.hpp provides the real one.
+// Requires BthPS3.h (and the Windows types it relies on) to be included first.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace bthps3
+{
+    //
+    // Win32 error codes the library reacts to
+    //
+    constexpr std::uint32_t ErrorSuccess = 0;
+    constexpr std::uint32_t ErrorFileNotFound = 2;
+    constexpr std::uint32_t ErrorInvalidHandle = 6;
+    constexpr std::uint32_t ErrorNotReady = 21;
+    constexpr std::uint32_t ErrorInvalidParameter = 87;
+    constexpr std::uint32_t ErrorOperationAborted = 995;
+    constexpr std::uint32_t ErrorDeviceRemoved = 1617;
+
+    //
+    // Invoked once an asynchronous transfer finished (error code, bytes transferred)
+    //
+    using TransferCompletion = std::function<void(std::uint32_t, std::uint32_t)>;
+
+    //
+    // Abstraction of an open device handle
+    //
+    class IDeviceTransport
+    {
+    public:
+        virtual ~IDeviceTransport() = default;
+
+        //
+        // Issues a request and waits for it to finish, returns error code
+        //
+        virtual std::uint32_t Control(
+            std::uint32_t ioControlCode,
+            const void* inBuffer,
+            std::uint32_t inLength,
+            void* outBuffer,
+            std::uint32_t outLength,
+            std::uint32_t* bytesReturned
+        ) = 0;
+
+        //
+        // Issues a request without waiting. Buffers must stay valid until the
+        // completion got invoked, which happens exactly once if ErrorSuccess
+        // got returned and never otherwise.
+        //
+        virtual std::uint32_t ControlAsync(
+            std::uint32_t ioControlCode,
+            const void* inBuffer,
+            std::uint32_t inLength,
+            void* outBuffer,
+            std::uint32_t outLength,
+            TransferCompletion completion
+        ) = 0;
+
+        //
+        // Aborts all outstanding asynchronous requests
+        //
+        virtual void CancelAll() = 0;
+    };
+
+    //
+    // Opens a transport to the given device path, returns nullptr and sets error on failure
+    //
+    using TransportFactory = std::function<std::unique_ptr<IDeviceTransport>(const std::wstring&, std::uint32_t*)>;
+
+    //
+    // Keeps a transport open across calls and re-opens it once if the device went away
+    //
+    class CachedTransport
+    {
+    public:
+        CachedTransport(TransportFactory factory, std::wstring path)
+            : _factory(std::move(factory)), _path(std::move(path))
+        {
+        }
+
+        std::uint32_t Control(
+            std::uint32_t ioControlCode,
+            const void* inBuffer,
+            std::uint32_t inLength,
+            void* outBuffer,
+            std::uint32_t outLength,
+            std::uint32_t* bytesReturned = nullptr
+        )
+        {
+            std::uint32_t returned = 0;
+            std::uint32_t error = ErrorSuccess;
+
+            for (int attempt = 0; attempt < 2; attempt++)
+            {
+                std::shared_ptr<IDeviceTransport> transport = Acquire(&error);
+
+                if (!transport)
+                {
+                    return error;
+                }
+
+                error = transport->Control(ioControlCode, inBuffer, inLength, outBuffer, outLength, &returned);
+
+                if (!IsStaleHandleError(error))
+                {
+                    break;
+                }
+
+                Invalidate(transport);
+            }
+
+            if (bytesReturned)
+            {
+                *bytesReturned = returned;
+            }
+
+            return error;
+        }
+
+        std::uint32_t ControlAsync(
+            std::uint32_t ioControlCode,
+            const void* inBuffer,
+            std::uint32_t inLength,
+            void* outBuffer,
+            std::uint32_t outLength,
+            TransferCompletion completion
+        )
+        {
+            std::uint32_t error = ErrorSuccess;
+            std::shared_ptr<IDeviceTransport> transport = Acquire(&error);
+
+            if (!transport)
+            {
+                return error;
+            }
+
+            //
+            // Stale handles are only dropped on the synchronous path as this one
+            // also gets called from completion callbacks running on the transport
+            //
+            return transport->ControlAsync(ioControlCode, inBuffer, inLength, outBuffer, outLength, std::move(completion));
+        }
+
+        void CancelAll()
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+
+            if (_transport)
+            {
+                _transport->CancelAll();
+            }
+        }
+
+        //
+        // Closes the handle, the next call re-opens it
+        //
+        void Reset()
+        {
+            std::shared_ptr<IDeviceTransport> transport;
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                transport.swap(_transport);
+            }
+        }
+
+    private:
+        TransportFactory _factory;
+        std::wstring _path;
+        std::mutex _lock;
+        std::shared_ptr<IDeviceTransport> _transport;
+
+        static bool IsStaleHandleError(std::uint32_t error)
+        {
+            return error == ErrorInvalidHandle || error == ErrorDeviceRemoved || error == ErrorNotReady;
+        }
+
+        std::shared_ptr<IDeviceTransport> Acquire(std::uint32_t* error)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+
+            if (!_transport)
+            {
+                _transport = std::shared_ptr<IDeviceTransport>(_factory(_path, error));
+            }
+
+            return _transport;
+        }
+
+        void Invalidate(const std::shared_ptr<IDeviceTransport>& stale)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+
+            if (_transport == stale)
+            {
+                _transport.reset();
+            }
+        }
+    };
+
+    //
+    // Counts outstanding asynchronous requests and lets callers wait for all of them
+    //
+    class PendingCounter
+    {
+    public:
+        void Add()
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _count++;
+        }
+
+        void Release()
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+
+            if (--_count == 0)
+            {
+                _drained.notify_all();
+            }
+        }
+
+        void WaitDrained()
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _drained.wait(guard, [this] { return _count == 0; });
+        }
+
+    private:
+        std::mutex _lock;
+        std::condition_variable _drained;
+        std::size_t _count = 0;
+    };
+
+    //
+    // Client for the BthPS3PSM filter control device
+    //
+    class FilterClient
+    {
+    public:
+        explicit FilterClient(TransportFactory factory, std::wstring path = BTHPS3PSM_CONTROL_DEVICE_PATH)
+            : _device(std::move(factory), std::move(path))
+        {
+        }
+
+        std::uint32_t EnablePatch(std::uint32_t deviceIndex)
+        {
+            BTHPS3PSM_ENABLE_PSM_PATCHING req = {};
+            req.DeviceIndex = deviceIndex;
+
+            return _device.Control(IOCTL_BTHPS3PSM_ENABLE_PSM_PATCHING, &req, sizeof(req), nullptr, 0);
+        }
+
+        std::uint32_t DisablePatch(std::uint32_t deviceIndex)
+        {
+            BTHPS3PSM_DISABLE_PSM_PATCHING req = {};
+            req.DeviceIndex = deviceIndex;
+
+            return _device.Control(IOCTL_BTHPS3PSM_DISABLE_PSM_PATCHING, &req, sizeof(req), nullptr, 0);
+        }
+
+        std::uint32_t GetPatch(std::uint32_t deviceIndex, BTHPS3PSM_GET_PSM_PATCHING& result)
+        {
+            result = {};
+            result.DeviceIndex = deviceIndex;
+
+            return _device.Control(IOCTL_BTHPS3PSM_GET_PSM_PATCHING, &result, sizeof(result), &result, sizeof(result));
+        }
+
+        std::uint32_t GetStatistics(std::uint32_t deviceIndex, BTHPS3PSM_GET_STATISTICS& result)
+        {
+            result = {};
+            result.DeviceIndex = deviceIndex;
+
+            return _device.Control(IOCTL_BTHPS3PSM_GET_STATISTICS, &result, sizeof(result), &result, sizeof(result));
+        }
+
+        std::uint32_t SetPsmRemap(std::uint32_t deviceIndex, const std::vector<BTHPS3PSM_PSM_REMAP_RULE>& rules)
+        {
+            if (rules.size() > BTHPS3PSM_PSM_REMAP_MAX_RULES)
+            {
+                return ErrorInvalidParameter;
+            }
+
+            BTHPS3PSM_SET_PSM_REMAP req = {};
+            req.DeviceIndex = deviceIndex;
+            req.RuleCount = static_cast<std::uint32_t>(rules.size());
+            std::copy(rules.begin(), rules.end(), req.Rules);
+
+            return _device.Control(IOCTL_BTHPS3PSM_SET_PSM_REMAP, &req, sizeof(req), nullptr, 0);
+        }
+
+        std::uint32_t GetPsmRemap(std::uint32_t deviceIndex, std::vector<BTHPS3PSM_PSM_REMAP_RULE>& rules)
+        {
+            BTHPS3PSM_GET_PSM_REMAP req = {};
+            req.DeviceIndex = deviceIndex;
+
+            const std::uint32_t error = _device.Control(IOCTL_BTHPS3PSM_GET_PSM_REMAP, &req, sizeof(req), &req, sizeof(req));
+
+            if (error == ErrorSuccess)
+            {
+                rules.assign(req.Rules, req.Rules + (std::min)(req.RuleCount, static_cast<ULONG>(BTHPS3PSM_PSM_REMAP_MAX_RULES)));
+            }
+
+            return error;
+        }
+
+        std::uint32_t SetCapture(std::uint32_t deviceIndex, bool isEnabled, std::uint32_t snapLength)
+        {
+            BTHPS3PSM_SET_CAPTURE req = {};
+            req.DeviceIndex = deviceIndex;
+            req.IsEnabled = isEnabled;
+            req.SnapLength = snapLength;
+
+            return _device.Control(IOCTL_BTHPS3PSM_SET_CAPTURE, &req, sizeof(req), nullptr, 0);
+        }
+
+        //
+        // Fills buffer with a BTHPS3PSM_DRAIN_CAPTURE header followed by records
+        //
+        std::uint32_t DrainCapture(std::uint32_t deviceIndex, std::vector<std::uint8_t>& buffer, std::uint32_t* bytesReturned)
+        {
+            if (buffer.size() < sizeof(BTHPS3PSM_DRAIN_CAPTURE))
+            {
+                return ErrorInvalidParameter;
+            }
+
+            const auto pDrain = reinterpret_cast<PBTHPS3PSM_DRAIN_CAPTURE>(buffer.data());
+            pDrain->DeviceIndex = deviceIndex;
+
+            return _device.Control(
+                IOCTL_BTHPS3PSM_DRAIN_CAPTURE,
+                pDrain,
+                sizeof(BTHPS3PSM_DRAIN_CAPTURE),
+                buffer.data(),
+                static_cast<std::uint32_t>(buffer.size()),
+                bytesReturned
+            );
+        }
+
+        //
+        // Blocks until the patch state of any device changed since state.Sequence
+        //
+        std::uint32_t WaitPatchChange(BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE& state)
+        {
+            return _device.Control(IOCTL_BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE, &state, sizeof(state), &state, sizeof(state));
+        }
+
+        //
+        // Queries devices 0 to maxDevices - 1 with all requests in flight at once
+        // and returns the consecutive run of devices that exist, starting at 0
+        //
+        std::uint32_t GetPatchAll(std::vector<BTHPS3PSM_GET_PSM_PATCHING>& results, std::uint32_t maxDevices = 8)
+        {
+            std::vector<BTHPS3PSM_GET_PSM_PATCHING> requests(maxDevices);
+            std::vector<std::uint32_t> errors(maxDevices, ErrorOperationAborted);
+            PendingCounter pending;
+            std::uint32_t error = ErrorSuccess;
+
+            results.clear();
+
+            for (std::uint32_t index = 0; index < maxDevices; index++)
+            {
+                requests[index] = {};
+                requests[index].DeviceIndex = index;
+
+                pending.Add();
+
+                error = _device.ControlAsync(
+                    IOCTL_BTHPS3PSM_GET_PSM_PATCHING,
+                    &requests[index],
+                    sizeof(BTHPS3PSM_GET_PSM_PATCHING),
+                    &requests[index],
+                    sizeof(BTHPS3PSM_GET_PSM_PATCHING),
+                    [&errors, &pending, index](std::uint32_t status, std::uint32_t)
+                    {
+                        errors[index] = status;
+                        pending.Release();
+                    }
+                );
+
+                if (error != ErrorSuccess)
+                {
+                    pending.Release();
+                    break;
+                }
+            }
+
+            pending.WaitDrained();
+
+            for (std::uint32_t index = 0; index < maxDevices && errors[index] == ErrorSuccess; index++)
+            {
+                results.push_back(requests[index]);
+            }
+
+            return results.empty() ? (error != ErrorSuccess ? error : errors[0]) : ErrorSuccess;
+        }
+
+    private:
+        CachedTransport _device;
+    };
+
+    //
+    // Radio a new controller is best paired to: the one with the fewest links
+    // that isn't at its cap, ties go to the one that moved fewer bytes. Returns
+    // load.RadioCount if every radio is full.
+    //
+    inline std::uint32_t LeastLoadedRadio(const BTHPS3_GET_RADIO_LOAD& load)
+    {
+        const std::uint32_t count = std::min<std::uint32_t>(load.RadioCount, BTHPS3_MAX_RADIOS);
+        std::uint32_t best = load.RadioCount;
+
+        for (std::uint32_t index = 0; index < count; index++)
+        {
+            const auto& radio = load.Radios[index];
+
+            if (BTHPS3_RADIO_IS_FULL(radio.ActiveLinks, radio.MaxLinks))
+            {
+                continue;
+            }
+
+            if (best == load.RadioCount
+                || radio.ActiveLinks < load.Radios[best].ActiveLinks
+                || (radio.ActiveLinks == load.Radios[best].ActiveLinks
+                    && radio.BytesTransferred < load.Radios[best].BytesTransferred))
+            {
+                best = index;
+            }
+        }
+
+        return best;
+    }
+
+    //
+    // Client for a single PDO device interface exposed by BthPS3
+    //
+    class PdoClient
+    {
+    public:
+        using ReportCallback = std::function<void(const std::uint8_t*, std::uint32_t)>;
+        using ErrorCallback = std::function<void(std::uint32_t)>;
+
+        PdoClient(TransportFactory factory, std::wstring interfacePath)
+            : _device(std::move(factory), std::move(interfacePath))
+        {
+        }
+
+        PdoClient(const PdoClient&) = delete;
+        PdoClient& operator=(const PdoClient&) = delete;
+
+        ~PdoClient()
+        {
+            StopInputReports();
+        }
+
+        //
+        // Queries the optional features (BTHPS3_CAPABILITY) of the bus driver
+        //
+        std::uint32_t GetCapabilities(std::uint32_t& capabilities)
+        {
+            BTHPS3_GET_CAPABILITIES caps = {};
+
+            const std::uint32_t error = _device.Control(
+                IOCTL_BTHPS3_GET_CAPABILITIES,
+                nullptr,
+                0,
+                &caps,
+                sizeof(BTHPS3_GET_CAPABILITIES)
+            );
+
+            capabilities = (error == ErrorSuccess) ? caps.Capabilities : 0;
+
+            return error;
+        }
+
+        //
+        // Switches HID transfers to the direct I/O variants if the bus driver
+        // supports them, older versions keep using the buffered ones
+        //
+        bool NegotiateDirectIo()
+        {
+            std::uint32_t capabilities = 0;
+
+            (void)GetCapabilities(capabilities);
+
+            _isDirectIo = (capabilities & BTHPS3_CAPABILITY_DIRECT_HID_IO) != 0;
+
+            return _isDirectIo;
+        }
+
+        std::uint32_t ReadControl(void* buffer, std::uint32_t length, std::uint32_t* bytesRead)
+        {
+            return _device.Control(
+                _isDirectIo ? IOCTL_BTHPS3_HID_CONTROL_READ_DIRECT : IOCTL_BTHPS3_HID_CONTROL_READ,
+                nullptr, 0, buffer, length, bytesRead);
+        }
+
+        std::uint32_t WriteControl(const void* buffer, std::uint32_t length)
+        {
+            return Write(IOCTL_BTHPS3_HID_CONTROL_WRITE, IOCTL_BTHPS3_HID_CONTROL_WRITE_DIRECT, buffer, length);
+        }
+
+        std::uint32_t ReadInterrupt(void* buffer, std::uint32_t length, std::uint32_t* bytesRead)
+        {
+            return _device.Control(
+                _isDirectIo ? IOCTL_BTHPS3_HID_INTERRUPT_READ_DIRECT : IOCTL_BTHPS3_HID_INTERRUPT_READ,
+                nullptr, 0, buffer, length, bytesRead);
+        }
+
+        std::uint32_t WriteInterrupt(const void* buffer, std::uint32_t length)
+        {
+            return Write(IOCTL_BTHPS3_HID_INTERRUPT_WRITE, IOCTL_BTHPS3_HID_INTERRUPT_WRITE_DIRECT, buffer, length);
+        }
+
+        //
+        // Writes a DualShock 4 report, the bus driver fills in its last four (CRC32) bytes
+        //
+        std::uint32_t WriteInterruptWithCrc(const void* buffer, std::uint32_t length)
+        {
+            return _device.Control(IOCTL_BTHPS3_HID_INTERRUPT_WRITE_CRC, buffer, length, nullptr, 0);
+        }
+
+        //
+        // Sends a control channel request (e.g. GET_REPORT) and receives its
+        // response in one round trip, fails as busy while plain control
+        // reads are pending
+        //
+        std::uint32_t TransactControl(
+            const void* request,
+            std::uint32_t requestLength,
+            void* response,
+            std::uint32_t responseLength,
+            std::uint32_t* bytesReturned
+        )
+        {
+            return _device.Control(
+                IOCTL_BTHPS3_HID_CONTROL_TRANSACT,
+                request,
+                requestLength,
+                response,
+                responseLength,
+                bytesReturned
+            );
+        }
+
+        //
+        // Reads the next Motion Controller report as two timestamped IMU samples
+        //
+        std::uint32_t ReadMotionImu(BTHPS3_MOTION_IMU_SAMPLE (&samples)[2])
+        {
+            return _device.Control(IOCTL_BTHPS3_HID_INTERRUPT_READ_IMU, nullptr, 0, samples, sizeof(samples));
+        }
+
+        //
+        // Reads the next input report decoded into the device independent layout
+        //
+        std::uint32_t ReadControllerState(BTHPS3_CONTROLLER_STATE& state)
+        {
+            return _device.Control(IOCTL_BTHPS3_HID_INTERRUPT_READ_STATE, nullptr, 0, &state, sizeof(BTHPS3_CONTROLLER_STATE));
+        }
+
+        //
+        // Sets rumble and LEDs, the bus driver skips sending unchanged reports
+        //
+        std::uint32_t SetFeedback(const BTHPS3_SET_FEEDBACK& feedback)
+        {
+            return _device.Control(IOCTL_BTHPS3_SET_FEEDBACK, &feedback, sizeof(BTHPS3_SET_FEEDBACK), nullptr, 0);
+        }
+
+        //
+        // Snapshots the bus driver flight recorder, events are returned unsorted
+        //
+        std::uint32_t GetFlightRecorder(
+            BTHPS3_GET_FLIGHT_RECORDER& header,
+            std::vector<BTHPS3_FLIGHT_RECORDER_EVENT>& events,
+            std::uint32_t maxEvents
+        )
+        {
+            std::vector<std::uint8_t> buffer(
+                sizeof(BTHPS3_GET_FLIGHT_RECORDER) + static_cast<size_t>(maxEvents) * sizeof(BTHPS3_FLIGHT_RECORDER_EVENT));
+            std::uint32_t bytesReturned = 0;
+
+            const std::uint32_t error = _device.Control(
+                IOCTL_BTHPS3_GET_FLIGHT_RECORDER,
+                nullptr,
+                0,
+                buffer.data(),
+                static_cast<std::uint32_t>(buffer.size()),
+                &bytesReturned
+            );
+
+            if (error != ErrorSuccess)
+            {
+                return error;
+            }
+
+            std::memcpy(&header, buffer.data(), sizeof(header));
+
+            const auto pEvents = reinterpret_cast<const BTHPS3_FLIGHT_RECORDER_EVENT*>(
+                buffer.data() + sizeof(BTHPS3_GET_FLIGHT_RECORDER));
+            const std::uint32_t count = (std::min)(header.EventCount, maxEvents);
+
+            events.assign(pEvents, pEvents + count);
+
+            return ErrorSuccess;
+        }
+
+        //
+        // Snapshots the load of all radios, diff two snapshots to derive throughput
+        //
+        std::uint32_t GetRadioLoad(BTHPS3_GET_RADIO_LOAD& load)
+        {
+            return _device.Control(
+                IOCTL_BTHPS3_GET_RADIO_LOAD,
+                nullptr,
+                0,
+                &load,
+                sizeof(BTHPS3_GET_RADIO_LOAD)
+            );
+        }
+
+        //
+        // Shares page with the bus driver which then publishes every input
+        // report into it until the device disconnects or the I/O gets canceled
+        // (which StopInputReports does as well), onReleased is called after
+        // that and the page must stay valid until then
+        //
+        std::uint32_t MapStatePage(BTHPS3_STATE_PAGE& page, ErrorCallback onReleased)
+        {
+            _pending.Add();
+
+            const std::uint32_t error = _device.ControlAsync(
+                IOCTL_BTHPS3_MAP_STATE_PAGE,
+                nullptr,
+                0,
+                &page,
+                sizeof(BTHPS3_STATE_PAGE),
+                [this, onReleased = std::move(onReleased)](std::uint32_t status, std::uint32_t)
+                {
+                    if (onReleased)
+                    {
+                        onReleased(status);
+                    }
+
+                    _pending.Release();
+                }
+            );
+
+            if (error != ErrorSuccess)
+            {
+                _pending.Release();
+            }
+
+            return error;
+        }
+
+        //
+        // Takes a consistent copy of a mapped page without any system call,
+        // returns false if the driver kept updating it for maxAttempts tries
+        //
+        static bool ReadStatePage(
+            const BTHPS3_STATE_PAGE& page,
+            BTHPS3_STATE_PAGE& snapshot,
+            std::uint32_t maxAttempts = 64
+        )
+        {
+            for (std::uint32_t attempt = 0; attempt < maxAttempts; attempt++)
+            {
+                const auto begin = page.Sequence;
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                //
+                // Update in progress
+                //
+                if (begin & 1)
+                {
+                    continue;
+                }
+
+                std::memcpy(&snapshot, &page, sizeof(BTHPS3_STATE_PAGE));
+
+                //
+                // Payload loads have to finish before the sequence gets checked again
+                //
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (page.Sequence == begin)
+                {
+                    snapshot.Sequence = begin;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        //
+        // Keeps inFlight interrupt reads pending at all times so a report can
+        // complete while the previous one is still being processed
+        //
+        std::uint32_t StartInputReports(
+            std::uint32_t inFlight,
+            std::uint32_t reportLength,
+            ReportCallback onReport,
+            ErrorCallback onError = nullptr
+        )
+        {
+            if (inFlight == 0 || reportLength == 0 || !onReport)
+            {
+                return ErrorInvalidParameter;
+            }
+
+            StopInputReports();
+
+            _onReport = std::move(onReport);
+            _onError = std::move(onError);
+            _isRunning = true;
+            _buffers.assign(inFlight, std::vector<std::uint8_t>(reportLength));
+
+            for (std::uint32_t slot = 0; slot < inFlight; slot++)
+            {
+                const std::uint32_t error = SubmitRead(slot);
+
+                if (error != ErrorSuccess)
+                {
+                    StopInputReports();
+                    return error;
+                }
+            }
+
+            return ErrorSuccess;
+        }
+
+        //
+        // Cancels all pending reads and waits for their completions
+        //
+        void StopInputReports()
+        {
+            _isRunning = false;
+            _device.CancelAll();
+            _pending.WaitDrained();
+        }
+
+    private:
+        CachedTransport _device;
+        std::vector<std::vector<std::uint8_t>> _buffers;
+        ReportCallback _onReport;
+        ErrorCallback _onError;
+        std::atomic<bool> _isRunning{false};
+        std::atomic<bool> _isDirectIo{false};
+        PendingCounter _pending;
+
+        //
+        // Direct writes pass the data as output buffer, it is only ever read from
+        //
+        std::uint32_t Write(
+            std::uint32_t bufferedCode,
+            std::uint32_t directCode,
+            const void* buffer,
+            std::uint32_t length
+        )
+        {
+            if (_isDirectIo)
+            {
+                return _device.Control(directCode, nullptr, 0, const_cast<void*>(buffer), length);
+            }
+
+            return _device.Control(bufferedCode, buffer, length, nullptr, 0);
+        }
+
+        std::uint32_t SubmitRead(std::uint32_t slot)
+        {
+            std::vector<std::uint8_t>& buffer = _buffers[slot];
+
+            _pending.Add();
+
+            const std::uint32_t error = _device.ControlAsync(
+                _isDirectIo ? IOCTL_BTHPS3_HID_INTERRUPT_READ_DIRECT : IOCTL_BTHPS3_HID_INTERRUPT_READ,
+                nullptr,
+                0,
+                buffer.data(),
+                static_cast<std::uint32_t>(buffer.size()),
+                [this, slot](std::uint32_t status, std::uint32_t transferred)
+                {
+                    OnReadCompleted(slot, status, transferred);
+                }
+            );
+
+            if (error != ErrorSuccess)
+            {
+                _pending.Release();
+            }
+
+            return error;
+        }
+
+        void OnReadCompleted(std::uint32_t slot, std::uint32_t status, std::uint32_t transferred)
+        {
+            if (status == ErrorSuccess)
+            {
+                _onReport(_buffers[slot].data(), transferred);
+            }
+            else if (status != ErrorOperationAborted && _onError)
+            {
+                _onError(status);
+            }
+
+            //
+            // Re-arm the slot unless we're shutting down or the device is gone
+            //
+            if (_isRunning && status == ErrorSuccess)
+            {
+                const std::uint32_t error = SubmitRead(slot);
+
+                if (error != ErrorSuccess && _onError)
+                {
+                    _onError(error);
+                }
+            }
+
+            _pending.Release();
+        }
+    };
+}
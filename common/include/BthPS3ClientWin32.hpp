@@ -0,0 +1,276 @@
+#pragma once
+
+//
+// Win32 transport for BthPS3Client.hpp based on overlapped I/O and a completion port
+//
+
+#include <Windows.h>
+#include <SetupAPI.h>
+#include <thread>
+
+#include "BthPS3Client.hpp"
+
+namespace bthps3
+{
+    class Win32Transport final : public IDeviceTransport
+    {
+    public:
+        static std::unique_ptr<IDeviceTransport> Open(const std::wstring& path, std::uint32_t* error)
+        {
+            const HANDLE hDevice = CreateFileW(
+                path.c_str(),
+                GENERIC_READ | GENERIC_WRITE,
+                FILE_SHARE_READ | FILE_SHARE_WRITE,
+                nullptr,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+                nullptr
+            );
+
+            if (hDevice == INVALID_HANDLE_VALUE)
+            {
+                if (error)
+                {
+                    *error = GetLastError();
+                }
+                return nullptr;
+            }
+
+            const HANDLE hPort = CreateIoCompletionPort(hDevice, nullptr, 0, 1);
+
+            if (hPort == nullptr)
+            {
+                if (error)
+                {
+                    *error = GetLastError();
+                }
+                CloseHandle(hDevice);
+                return nullptr;
+            }
+
+            return std::unique_ptr<IDeviceTransport>(new Win32Transport(hDevice, hPort));
+        }
+
+        Win32Transport(const Win32Transport&) = delete;
+        Win32Transport& operator=(const Win32Transport&) = delete;
+
+        ~Win32Transport() override
+        {
+            CancelIoEx(_hDevice, nullptr);
+
+            //
+            // Aborted requests still post their packets, let the worker consume them
+            //
+            _pending.WaitDrained();
+
+            PostQueuedCompletionStatus(_hPort, 0, ShutdownKey, nullptr);
+            _worker.join();
+
+            CloseHandle(_hDevice);
+            CloseHandle(_hPort);
+        }
+
+        std::uint32_t Control(
+            std::uint32_t ioControlCode,
+            const void* inBuffer,
+            std::uint32_t inLength,
+            void* outBuffer,
+            std::uint32_t outLength,
+            std::uint32_t* bytesReturned
+        ) override
+        {
+            OVERLAPPED overlapped = {};
+            DWORD transferred = 0;
+
+            overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+            if (overlapped.hEvent == nullptr)
+            {
+                return GetLastError();
+            }
+
+            //
+            // Setting the low-order bit keeps the completion off the port
+            //
+            overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<ULONG_PTR>(overlapped.hEvent) | 1);
+
+            BOOL ret = DeviceIoControl(
+                _hDevice,
+                ioControlCode,
+                const_cast<void*>(inBuffer),
+                inLength,
+                outBuffer,
+                outLength,
+                &transferred,
+                &overlapped
+            );
+
+            if (!ret && GetLastError() == ERROR_IO_PENDING)
+            {
+                ret = GetOverlappedResult(_hDevice, &overlapped, &transferred, TRUE);
+            }
+
+            const DWORD error = ret ? ERROR_SUCCESS : GetLastError();
+
+            CloseHandle(reinterpret_cast<HANDLE>(reinterpret_cast<ULONG_PTR>(overlapped.hEvent) & ~static_cast<ULONG_PTR>(1)));
+
+            if (bytesReturned)
+            {
+                *bytesReturned = transferred;
+            }
+
+            return error;
+        }
+
+        std::uint32_t ControlAsync(
+            std::uint32_t ioControlCode,
+            const void* inBuffer,
+            std::uint32_t inLength,
+            void* outBuffer,
+            std::uint32_t outLength,
+            TransferCompletion completion
+        ) override
+        {
+            auto* operation = new Operation();
+            operation->Completion = std::move(completion);
+
+            _pending.Add();
+
+            const BOOL ret = DeviceIoControl(
+                _hDevice,
+                ioControlCode,
+                const_cast<void*>(inBuffer),
+                inLength,
+                outBuffer,
+                outLength,
+                nullptr,
+                &operation->Overlapped
+            );
+
+            if (!ret && GetLastError() != ERROR_IO_PENDING)
+            {
+                const DWORD error = GetLastError();
+
+                delete operation;
+                _pending.Release();
+
+                return error;
+            }
+
+            //
+            // Synchronous success still queues a completion packet
+            //
+            return ERROR_SUCCESS;
+        }
+
+        void CancelAll() override
+        {
+            CancelIoEx(_hDevice, nullptr);
+        }
+
+    private:
+        static constexpr ULONG_PTR ShutdownKey = 1;
+
+        struct Operation
+        {
+            OVERLAPPED Overlapped = {};
+            TransferCompletion Completion;
+        };
+
+        HANDLE _hDevice;
+        HANDLE _hPort;
+        PendingCounter _pending;
+        std::thread _worker;
+
+        Win32Transport(HANDLE hDevice, HANDLE hPort)
+            : _hDevice(hDevice), _hPort(hPort)
+        {
+            _worker = std::thread(&Win32Transport::Worker, this);
+        }
+
+        void Worker()
+        {
+            while (true)
+            {
+                DWORD transferred = 0;
+                ULONG_PTR key = 0;
+                LPOVERLAPPED overlapped = nullptr;
+
+                const BOOL ret = GetQueuedCompletionStatus(_hPort, &transferred, &key, &overlapped, INFINITE);
+
+                if (key == ShutdownKey)
+                {
+                    break;
+                }
+
+                if (overlapped == nullptr)
+                {
+                    continue;
+                }
+
+                auto* operation = CONTAINING_RECORD(overlapped, Operation, Overlapped);
+
+                operation->Completion(ret ? ERROR_SUCCESS : GetLastError(), transferred);
+
+                delete operation;
+                _pending.Release();
+            }
+        }
+    };
+
+    //
+    // Default factory for CachedTransport users
+    //
+    inline std::unique_ptr<IDeviceTransport> OpenWin32Transport(const std::wstring& path, std::uint32_t* error)
+    {
+        return Win32Transport::Open(path, error);
+    }
+
+    //
+    // Returns the paths of all present devices exposing the supplied interface
+    //
+    inline std::vector<std::wstring> EnumerateInterfaces(const GUID& interfaceGuid)
+    {
+        std::vector<std::wstring> paths;
+
+        const HDEVINFO hDevInfo = SetupDiGetClassDevsW(
+            &interfaceGuid,
+            nullptr,
+            nullptr,
+            DIGCF_PRESENT | DIGCF_DEVICEINTERFACE
+        );
+
+        if (hDevInfo == INVALID_HANDLE_VALUE)
+        {
+            return paths;
+        }
+
+        SP_DEVICE_INTERFACE_DATA interfaceData = {};
+        interfaceData.cbSize = sizeof(SP_DEVICE_INTERFACE_DATA);
+
+        for (DWORD index = 0; SetupDiEnumDeviceInterfaces(hDevInfo, nullptr, &interfaceGuid, index, &interfaceData); index++)
+        {
+            DWORD required = 0;
+
+            (void)SetupDiGetDeviceInterfaceDetailW(hDevInfo, &interfaceData, nullptr, 0, &required, nullptr);
+
+            if (required == 0)
+            {
+                continue;
+            }
+
+            std::vector<std::uint8_t> buffer(required);
+            const auto pDetail = reinterpret_cast<PSP_DEVICE_INTERFACE_DETAIL_DATA_W>(buffer.data());
+            pDetail->cbSize = sizeof(SP_DEVICE_INTERFACE_DETAIL_DATA_W);
+
+            if (SetupDiGetDeviceInterfaceDetailW(hDevInfo, &interfaceData, pDetail, required, nullptr, nullptr))
+            {
+                paths.emplace_back(pDetail->DevicePath);
+            }
+        }
+
+        SetupDiDestroyDeviceInfoList(hDevInfo);
+
+        return paths;
+    }
+}
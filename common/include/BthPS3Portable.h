@@ -0,0 +1,256 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// Minimal environment for the framework-free units (slot bitmap, PSM remap
+// table, HCI tracker, report decoders, caches) when they get built outside
+// the drivers with BTHPS3_PORTABLE defined. Inside the drivers the units
+// include their Driver.h instead and this header is never used.
+// 
+
+#if defined(_WIN32)
+
+#include <Windows.h>
+#include <bthdef.h>
+
+#ifndef _NTDEF_
+typedef _Return_type_success_(return >= 0) LONG NTSTATUS;
+#endif
+
+#ifndef NT_SUCCESS
+#define NT_SUCCESS(Status)              (((NTSTATUS)(Status)) >= 0)
+#endif
+
+#ifndef NT_ASSERT
+#define NT_ASSERT(_exp_)                ((void)0)
+#endif
+
+#ifndef STATUS_SUCCESS
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000L)
+#endif
+#ifndef STATUS_UNSUCCESSFUL
+#define STATUS_UNSUCCESSFUL             ((NTSTATUS)0xC0000001L)
+#endif
+#ifndef STATUS_INVALID_PARAMETER
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000DL)
+#endif
+#ifndef STATUS_BUFFER_TOO_SMALL
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023L)
+#endif
+#ifndef STATUS_DUPLICATE_NAME
+#define STATUS_DUPLICATE_NAME           ((NTSTATUS)0xC00000BDL)
+#endif
+
+#else
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <wchar.h>
+#include <assert.h>
+
+typedef void VOID, * PVOID;
+typedef char CHAR, * PCHAR;
+typedef const char* PCSTR;
+typedef unsigned char UCHAR, * PUCHAR, BYTE, * PBYTE;
+typedef int16_t SHORT, * PSHORT;
+typedef uint16_t USHORT, * PUSHORT, WORD;
+typedef int32_t LONG, * PLONG, INT;
+typedef uint32_t ULONG, * PULONG, UINT32, DWORD, UINT;
+typedef int64_t LONG64, * PLONG64, LONGLONG;
+typedef uint64_t ULONG64, * PULONG64, ULONGLONG, * PULONGLONG, UINT64;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T;
+typedef wchar_t WCHAR, * PWCHAR;
+typedef const wchar_t* PCWSTR;
+typedef uint8_t BOOLEAN, * PBOOLEAN;
+typedef int32_t NTSTATUS;
+typedef ULONGLONG BTH_ADDR, * PBTH_ADDR;
+
+#define BTH_MAX_NAME_SIZE               248
+
+#define MAXULONG                        0xFFFFFFFF
+#define MAXULONG64                      ((ULONG64)~((ULONG64)0))
+
+typedef struct _GUID
+{
+	uint32_t Data1;
+	uint16_t Data2;
+	uint16_t Data3;
+	uint8_t Data4[8];
+
+} GUID;
+
+typedef struct _DEVPROPKEY
+{
+	GUID fmtid;
+	ULONG pid;
+
+} DEVPROPKEY;
+
+#ifndef TRUE
+#define TRUE                            1
+#endif
+#ifndef FALSE
+#define FALSE                           0
+#endif
+
+#define IN
+#define OUT
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Out_opt_
+#define _Inout_
+#define _Inout_opt_
+#define _In_reads_(_n_)
+#define _In_reads_bytes_(_n_)
+#define _In_reads_bytes_opt_(_n_)
+#define _Out_writes_(_n_)
+#define _Out_writes_to_(_n_, _c_)
+#define _Out_writes_bytes_(_n_)
+#define _Out_writes_bytes_to_(_n_, _c_)
+#define _Inout_updates_(_n_)
+#define _Inout_updates_bytes_(_n_)
+#define _Must_inspect_result_
+#define _Use_decl_annotations_
+#define _IRQL_requires_max_(_irql_)
+#define _IRQL_requires_(_irql_)
+#define _Return_type_success_(_expr_)
+
+#define FORCEINLINE                     static inline __attribute__((always_inline))
+#define DECLSPEC_CACHEALIGN             __attribute__((aligned(64)))
+#define __declspec(_x_)                 __attribute__((weak))
+#define C_ASSERT(_e_)                   _Static_assert(_e_, #_e_)
+#define UNREFERENCED_PARAMETER(_p_)     ((void)(_p_))
+#define NT_ASSERT(_exp_)                assert(_exp_)
+
+#define NT_SUCCESS(Status)              (((NTSTATUS)(Status)) >= 0)
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000L)
+#define STATUS_UNSUCCESSFUL             ((NTSTATUS)0xC0000001L)
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000DL)
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023L)
+#define STATUS_DUPLICATE_NAME           ((NTSTATUS)0xC00000BDL)
+
+#ifndef min
+#define min(_a_, _b_)                   (((_a_) < (_b_)) ? (_a_) : (_b_))
+#endif
+#ifndef max
+#define max(_a_, _b_)                   (((_a_) > (_b_)) ? (_a_) : (_b_))
+#endif
+
+#define ARRAYSIZE(_a_)                  (sizeof(_a_) / sizeof((_a_)[0]))
+
+#define RtlZeroMemory(_d_, _l_)         memset((_d_), 0, (_l_))
+#define RtlCopyMemory(_d_, _s_, _l_)    memcpy((_d_), (_s_), (_l_))
+#define RtlEqualMemory(_a_, _b_, _l_)   (memcmp((_a_), (_b_), (_l_)) == 0)
+
+#define MemoryBarrier()                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define YieldProcessor()                ((void)0)
+#define ReadNoFence(_p_)                __atomic_load_n((_p_), __ATOMIC_RELAXED)
+#define ReadAcquire64(_p_)              __atomic_load_n((_p_), __ATOMIC_ACQUIRE)
+#define WriteRelease64(_p_, _v_)        __atomic_store_n((_p_), (_v_), __ATOMIC_RELEASE)
+#define InterlockedIncrement(_p_)       __atomic_add_fetch((_p_), 1, __ATOMIC_SEQ_CST)
+#define InterlockedDecrement(_p_)       __atomic_sub_fetch((_p_), 1, __ATOMIC_SEQ_CST)
+#define InterlockedIncrement64(_p_)     __atomic_add_fetch((_p_), 1, __ATOMIC_SEQ_CST)
+#define InterlockedExchange64(_p_, _v_) __atomic_exchange_n((_p_), (_v_), __ATOMIC_SEQ_CST)
+
+FORCEINLINE
+LONG64
+InterlockedCompareExchange64(
+	_Inout_ volatile LONG64* Destination,
+	_In_ LONG64 Exchange,
+	_In_ LONG64 Comperand
+)
+{
+	__atomic_compare_exchange_n(Destination, &Comperand, Exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return Comperand;
+}
+
+//
+// ASCII and Latin-1 subset of the kernel's case mapping, remote names get
+// widened byte by byte so nothing above U+00FF needs folding
+// 
+FORCEINLINE
+WCHAR
+RtlUpcaseUnicodeChar(
+	_In_ WCHAR SourceCharacter
+)
+{
+	if ((SourceCharacter >= L'a' && SourceCharacter <= L'z')
+		|| (SourceCharacter >= 0xE0 && SourceCharacter <= 0xFE && SourceCharacter != 0xF7))
+	{
+		return SourceCharacter - 0x20;
+	}
+
+	if (SourceCharacter == 0xB5)
+	{
+		return 0x039C;
+	}
+
+	if (SourceCharacter == 0xFF)
+	{
+		return 0x0178;
+	}
+
+	return SourceCharacter;
+}
+
+//
+// I/O control code layout of devioctl.h
+// 
+#define CTL_CODE(_type_, _function_, _method_, _access_) \
+	(((_type_) << 16) | ((_access_) << 14) | ((_function_) << 2) | (_method_))
+#define FILE_DEVICE_BUS_EXTENDER        0x0000002A
+#define METHOD_BUFFERED                 0
+#define METHOD_IN_DIRECT                1
+#define METHOD_OUT_DIRECT               2
+#define METHOD_NEITHER                  3
+#define FILE_ANY_ACCESS                 0
+#define FILE_READ_DATA                  0x0001
+#define FILE_WRITE_DATA                 0x0002
+
+#define DEFINE_GUID(_name_, _l_, _w1_, _w2_, _b1_, _b2_, _b3_, _b4_, _b5_, _b6_, _b7_, _b8_) \
+	static const GUID _name_ = { _l_, _w1_, _w2_, { _b1_, _b2_, _b3_, _b4_, _b5_, _b6_, _b7_, _b8_ } }
+#define DEFINE_DEVPROPKEY(_name_, _l_, _w1_, _w2_, _b1_, _b2_, _b3_, _b4_, _b5_, _b6_, _b7_, _b8_, _pid_) \
+	static const DEVPROPKEY _name_ = { { _l_, _w1_, _w2_, { _b1_, _b2_, _b3_, _b4_, _b5_, _b6_, _b7_, _b8_ } }, _pid_ }
+
+#endif
+
+#include <BthPS3.h>
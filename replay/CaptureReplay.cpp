@@ -0,0 +1,537 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+//
+// Runs the received packets of HCI captures through the filter's patch
+// decision, the same PatchPolicy the bulk and interrupt IN completions
+// use, and compares every decision against a stored expectation. With
+// several radios each keeps its own policy and the capture is fed to all
+// of them interleaved, every radio has to come to the same decisions.
+// 
+// bthps3_replay --capture FILE [--expected FILE] [--write-expected FILE]
+//               [--rules PSM=PSM[,PSM=PSM]] [--allow ADDRESS[,ADDRESS]]
+//               [--suspend-for ADDRESS] [--patching-disabled 0|1]
+//               [--radios N] [--iterations N]
+// 
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <BthPS3Util/PcapReader.h>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/PatchPolicy.h>
+}
+
+
+namespace
+{
+    struct Options
+    {
+        std::string CapturePath;
+        std::string ExpectedPath;
+        std::string WriteExpectedPath;
+        std::vector<BTHPS3PSM_PSM_REMAP_RULE> Rules;
+        std::vector<ULONGLONG> AllowList;
+        ULONGLONG SuspendFor = 0;
+        bool IsPatchingEnabled = true;
+        ULONG Radios = 1;
+        ULONG Iterations = 1;
+    };
+
+    struct ReplayPacket
+    {
+        //
+        // Record number in the capture, counting from 1
+        // 
+        ULONG Number;
+
+        UCHAR PacketType;
+
+        std::vector<UCHAR> Data;
+    };
+
+    //
+    // What the filter does on one radio: its policy and the radio-wide
+    // patch state the suspension and re-arming flip
+    // 
+    struct Radio
+    {
+        BTHPS3PSM_PATCH_POLICY Policy;
+        BOOLEAN IsPatchingEnabled;
+        std::vector<std::string> Decisions;
+    };
+
+    bool ParseNumber(const std::string& Text, ULONGLONG* Value)
+    {
+        char* end = nullptr;
+
+        *Value = strtoull(Text.c_str(), &end, 16);
+
+        return !Text.empty() && end != nullptr && *end == '\0';
+    }
+
+    //
+    // "001BDC0FAA58,00:1B:DC:0F:AA:59"
+    // 
+    bool ParseAddresses(const std::string& Text, std::vector<ULONGLONG>* Addresses)
+    {
+        std::istringstream stream(Text);
+        std::string entry;
+
+        while (std::getline(stream, entry, ','))
+        {
+            std::string digits;
+            ULONGLONG address;
+
+            for (const char character : entry)
+            {
+                if (character != ':')
+                {
+                    digits.push_back(character);
+                }
+            }
+
+            if (digits.size() != 12 || !ParseNumber(digits, &address))
+            {
+                return false;
+            }
+
+            Addresses->push_back(address);
+        }
+
+        return !Addresses->empty();
+    }
+
+    //
+    // "0x0011=0x5053,0x0013=0x5055"
+    // 
+    bool ParseRules(const std::string& Text, std::vector<BTHPS3PSM_PSM_REMAP_RULE>* Rules)
+    {
+        std::istringstream stream(Text);
+        std::string entry;
+
+        while (std::getline(stream, entry, ','))
+        {
+            const auto separator = entry.find('=');
+            ULONGLONG original;
+            ULONGLONG patched;
+
+            if (separator == std::string::npos
+                || !ParseNumber(entry.substr(0, separator), &original)
+                || !ParseNumber(entry.substr(separator + 1), &patched)
+                || original > 0xFFFF || patched > 0xFFFF)
+            {
+                return false;
+            }
+
+            Rules->push_back({ static_cast<USHORT>(original), static_cast<USHORT>(patched) });
+        }
+
+        return !Rules->empty();
+    }
+
+    bool ParseOptions(int argc, char** argv, Options* Config)
+    {
+        for (int index = 1; index < argc; index++)
+        {
+            const std::string name = argv[index];
+
+            if (index + 1 >= argc)
+            {
+                fprintf(stderr, "missing value for %s\n", name.c_str());
+                return false;
+            }
+
+            const char* value = argv[++index];
+
+            if (name == "--capture")
+            {
+                Config->CapturePath = value;
+            }
+            else if (name == "--expected")
+            {
+                Config->ExpectedPath = value;
+            }
+            else if (name == "--write-expected")
+            {
+                Config->WriteExpectedPath = value;
+            }
+            else if (name == "--rules")
+            {
+                if (!ParseRules(value, &Config->Rules))
+                {
+                    fprintf(stderr, "malformed PSM remap rules %s\n", value);
+                    return false;
+                }
+            }
+            else if (name == "--allow")
+            {
+                if (!ParseAddresses(value, &Config->AllowList))
+                {
+                    fprintf(stderr, "malformed remote addresses %s\n", value);
+                    return false;
+                }
+            }
+            else if (name == "--suspend-for")
+            {
+                std::vector<ULONGLONG> addresses;
+
+                if (!ParseAddresses(value, &addresses) || addresses.size() != 1)
+                {
+                    fprintf(stderr, "malformed remote address %s\n", value);
+                    return false;
+                }
+
+                Config->SuspendFor = addresses.front();
+            }
+            else if (name == "--patching-disabled")
+            {
+                Config->IsPatchingEnabled = strtoul(value, nullptr, 0) == 0;
+            }
+            else if (name == "--radios")
+            {
+                Config->Radios = (std::max)(1UL, strtoul(value, nullptr, 0));
+            }
+            else if (name == "--iterations")
+            {
+                Config->Iterations = (std::max)(1UL, strtoul(value, nullptr, 0));
+            }
+            else
+            {
+                fprintf(stderr, "unknown option %s\n", name.c_str());
+                return false;
+            }
+        }
+
+        if (Config->CapturePath.empty())
+        {
+            fprintf(stderr, "--capture is required\n");
+            return false;
+        }
+
+        //
+        // Defaults of the filter
+        // 
+        if (Config->Rules.empty())
+        {
+            Config->Rules.push_back({ L2CAP_PSM_HID_Command, PSM_DS3_HID_CONTROL });
+            Config->Rules.push_back({ L2CAP_PSM_HID_Interrupt, PSM_DS3_HID_INTERRUPT });
+        }
+
+        return true;
+    }
+
+    //
+    // Keeps what the filter gets to see: received ACL data and HCI events
+    // 
+    bool LoadCapture(const std::string& Path, std::vector<ReplayPacket>* Packets)
+    {
+        std::ifstream file(Path, std::ios::binary);
+
+        if (!file)
+        {
+            return false;
+        }
+
+        PcapReader reader(file);
+        PcapReader::Packet packet;
+        ULONG number = 0;
+
+        if (!reader.isValid())
+        {
+            return false;
+        }
+
+        while (reader.next(packet))
+        {
+            number++;
+
+            if (packet.Direction != BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED
+                || (packet.PacketType != BTHPS3PSM_CAPTURE_PACKET_ACL_DATA
+                    && packet.PacketType != BTHPS3PSM_CAPTURE_PACKET_HCI_EVENT))
+            {
+                continue;
+            }
+
+            Packets->push_back({ number, packet.PacketType, packet.Data });
+        }
+
+        return true;
+    }
+
+    //
+    // Lines that aren't empty or comments
+    // 
+    bool LoadExpected(const std::string& Path, std::vector<std::string>* Decisions)
+    {
+        std::ifstream file(Path);
+        std::string line;
+
+        if (!file)
+        {
+            return false;
+        }
+
+        while (std::getline(file, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+
+            if (!line.empty() && line.front() != '#')
+            {
+                Decisions->push_back(line);
+            }
+        }
+
+        return true;
+    }
+
+    std::string Describe(ULONG Number, const char* Verdict, const BTHPS3PSM_PATCH_RESULT* Result, USHORT AclHandle)
+    {
+        char line[96];
+
+        if (Result == nullptr)
+        {
+            snprintf(line, sizeof(line), "%u %s", Number, Verdict);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "%u %s 0x%04X 0x%04X 0x%04X",
+                Number, Verdict, AclHandle, Result->OriginalPsm, Result->PatchedPsm);
+        }
+
+        return line;
+    }
+
+    void ResetRadio(const Options& Config, Radio* State)
+    {
+        BthPS3PSM_PatchPolicyInit(&State->Policy);
+        BthPS3PSM_PatchPolicySetAddresses(
+            &State->Policy,
+            Config.AllowList.data(),
+            static_cast<ULONG>(Config.AllowList.size())
+        );
+
+        State->IsPatchingEnabled = Config.IsPatchingEnabled ? TRUE : FALSE;
+        State->Decisions.clear();
+
+        //
+        // What IOCTL_BTHPS3PSM_SUSPEND_PSM_PATCHING does
+        // 
+        if (Config.SuspendFor != 0)
+        {
+            (void)BthPS3PSM_PatchPolicySuspendFor(&State->Policy, Config.SuspendFor);
+            State->IsPatchingEnabled = FALSE;
+        }
+    }
+
+    //
+    // One packet the way the filter's completion routines handle it
+    // 
+    void ReplayPacketOn(const BTHPS3PSM_PSM_REMAP_TABLE* Table, ReplayPacket& Packet, Radio* State)
+    {
+        const auto length = static_cast<ULONG>(Packet.Data.size());
+        BTHPS3PSM_PATCH_RESULT result;
+
+        if (Packet.PacketType == BTHPS3PSM_CAPTURE_PACKET_HCI_EVENT)
+        {
+            BthPS3PSM_PatchPolicyProcessEvents(&State->Policy, Packet.Data.data(), length);
+
+            if (BthPS3PSM_PatchPolicyOnLinkLoss(&State->Policy))
+            {
+                State->IsPatchingEnabled = TRUE;
+                State->Decisions.push_back(Describe(Packet.Number, "rearm-link-loss", nullptr, 0));
+            }
+
+            return;
+        }
+
+        BthPS3PSM_PatchPolicyProcessAcl(
+            &State->Policy,
+            Table,
+            State->IsPatchingEnabled,
+            Packet.Data.data(),
+            length,
+            &result
+        );
+
+        switch (result.Verdict)
+        {
+        case PatchVerdictPatched:
+            State->Decisions.push_back(Describe(Packet.Number, "patched", &result, HCI_GET_ACL_HANDLE(Packet.Data.data())));
+            break;
+        case PatchVerdictNotPatched:
+            State->Decisions.push_back(Describe(Packet.Number, "not-patched", &result, HCI_GET_ACL_HANDLE(Packet.Data.data())));
+            break;
+        case PatchVerdictRearm:
+            State->IsPatchingEnabled = TRUE;
+            State->Decisions.push_back(Describe(Packet.Number, "rearm", nullptr, 0));
+            break;
+        default:
+            break;
+        }
+    }
+
+    //
+    // Prints every line that differs, returns the number of mismatches
+    // 
+    size_t Compare(ULONG RadioIndex, const std::vector<std::string>& Expected, const std::vector<std::string>& Actual)
+    {
+        size_t mismatches = 0;
+
+        for (size_t index = 0; index < (std::max)(Expected.size(), Actual.size()); index++)
+        {
+            const std::string expected = index < Expected.size() ? Expected[index] : "(nothing)";
+            const std::string actual = index < Actual.size() ? Actual[index] : "(nothing)";
+
+            if (expected != actual)
+            {
+                printf("radio %u decision %zu: expected \"%s\", got \"%s\"\n",
+                    RadioIndex, index + 1, expected.c_str(), actual.c_str());
+                mismatches++;
+            }
+        }
+
+        return mismatches;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options config;
+    std::vector<ReplayPacket> packets;
+    std::vector<std::string> expected;
+    BTHPS3PSM_PSM_REMAP_TABLE table;
+
+    if (!ParseOptions(argc, argv, &config))
+    {
+        return 2;
+    }
+
+    if (!LoadCapture(config.CapturePath, &packets))
+    {
+        fprintf(stderr, "couldn't read capture %s\n", config.CapturePath.c_str());
+        return 2;
+    }
+
+    if (!config.ExpectedPath.empty() && !LoadExpected(config.ExpectedPath, &expected))
+    {
+        fprintf(stderr, "couldn't read expected decisions %s\n", config.ExpectedPath.c_str());
+        return 2;
+    }
+
+    if (!NT_SUCCESS(BthPS3PSM_PsmRemapCompile(config.Rules.data(), static_cast<ULONG>(config.Rules.size()), &table)))
+    {
+        fprintf(stderr, "PSM remap rules don't compile\n");
+        return 2;
+    }
+
+    std::vector<Radio> radios(config.Radios);
+    std::chrono::steady_clock::duration elapsed{};
+    size_t mismatches = 0;
+
+    for (ULONG iteration = 0; iteration < config.Iterations; iteration++)
+    {
+        //
+        // Patching happens in place, every radio starts from the capture
+        // 
+        std::vector<std::vector<ReplayPacket>> working(radios.size(), packets);
+
+        for (Radio& radio : radios)
+        {
+            ResetRadio(config, &radio);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (size_t index = 0; index < packets.size(); index++)
+        {
+            for (size_t radio = 0; radio < radios.size(); radio++)
+            {
+                ReplayPacketOn(&table, working[radio][index], &radios[radio]);
+            }
+        }
+
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    if (!config.WriteExpectedPath.empty())
+    {
+        std::ofstream file(config.WriteExpectedPath);
+
+        file << "# " << config.CapturePath.substr(config.CapturePath.find_last_of("/\\") + 1)
+            << ": record, verdict, ACL handle, PSM received and forwarded\n";
+
+        for (const std::string& decision : radios.front().Decisions)
+        {
+            file << decision << "\n";
+        }
+
+        if (!file)
+        {
+            fprintf(stderr, "couldn't write expected decisions %s\n", config.WriteExpectedPath.c_str());
+            return 2;
+        }
+    }
+
+    for (ULONG index = 0; index < radios.size(); index++)
+    {
+        //
+        // Without a stored expectation every radio has to agree with the first
+        // 
+        mismatches += Compare(index, config.ExpectedPath.empty() ? radios.front().Decisions : expected, radios[index].Decisions);
+    }
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    const double inspected = static_cast<double>(packets.size()) * radios.size() * config.Iterations;
+
+    printf("%zu packets replayed on %u radio(s) %u time(s), %zu decisions per radio\n",
+        packets.size(), config.Radios, config.Iterations, radios.front().Decisions.size());
+    printf("packets per second: %.0f\n", seconds > 0.0 ? inspected / seconds : 0.0);
+    printf("mismatches: %zu\n", mismatches);
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,384 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+//
+// Writes the capture corpus bthps3_replay checks the patch decision
+// against. Each capture follows what the filter sees of a remote paging
+// the host: the HCI connection events, the L2CAP signalling of the HID
+// control and interrupt channels in both directions and the first input
+// reports, in the format BthPS3Util --capture records.
+// 
+// bthps3_make_corpus DIRECTORY
+// 
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <BthPS3Util/PcapWriter.h>
+
+
+namespace
+{
+    //
+    // H4 packet type indicators
+    // 
+    constexpr std::uint8_t PacketCommand = 0x01;
+    constexpr std::uint8_t PacketAcl = 0x02;
+    constexpr std::uint8_t PacketEvent = 0x04;
+
+    constexpr std::uint8_t Sent = 0x00;
+    constexpr std::uint8_t Received = 0x01;
+
+    constexpr std::uint16_t PsmSdp = 0x0001;
+    constexpr std::uint16_t PsmHidControl = 0x0011;
+    constexpr std::uint16_t PsmHidInterrupt = 0x0013;
+
+    constexpr std::uint64_t Sixaxis = 0x0019C1A2B3C4ULL;
+    constexpr std::uint64_t Navigation = 0x0019C1D5E6F7ULL;
+    constexpr std::uint64_t Motion = 0x0006F5112233ULL;
+    constexpr std::uint64_t Wireless = 0x001C4D445566ULL;
+    constexpr std::uint64_t Headset = 0x001A7DDA7113ULL;
+
+    //
+    // Input report as the remote sends it: HIDP DATA header, report ID
+    // and payload length
+    // 
+    struct ReportLayout
+    {
+        std::uint8_t ReportId;
+        std::uint16_t Length;
+    };
+
+    constexpr ReportLayout Ds3Report = { 0x01, 0x31 };
+    constexpr ReportLayout Ds4Report = { 0x11, 0x4E };
+
+    class Capture
+    {
+    public:
+        explicit Capture(const std::string& Path)
+            : _file(Path, std::ios::binary), _writer(_file, 0x200)
+        {
+        }
+
+        //
+        // FALSE if the file couldn't be created or written
+        // 
+        bool IsGood() const
+        {
+            return static_cast<bool>(_file);
+        }
+
+        //
+        // Remote pages the host, the host accepts and the link comes up
+        // 
+        void Connect(std::uint16_t Handle, std::uint64_t Address)
+        {
+            std::vector<std::uint8_t> request = { 0x04, 0x0A };
+            AppendAddress(request, Address);
+            request.insert(request.end(), { 0x08, 0x05, 0x00, 0x01 });
+            Write(Received, PacketEvent, request);
+
+            std::vector<std::uint8_t> accept = { 0x09, 0x04, 0x07 };
+            AppendAddress(accept, Address);
+            accept.push_back(0x01);
+            Write(Sent, PacketCommand, accept);
+
+            std::vector<std::uint8_t> complete = {
+                0x03, 0x0B, 0x00,
+                static_cast<std::uint8_t>(Handle), static_cast<std::uint8_t>(Handle >> 8)
+            };
+            AppendAddress(complete, Address);
+            complete.insert(complete.end(), { 0x01, 0x00 });
+            Write(Received, PacketEvent, complete);
+        }
+
+        void Disconnect(std::uint16_t Handle)
+        {
+            Write(Received, PacketEvent, {
+                0x05, 0x04, 0x00,
+                static_cast<std::uint8_t>(Handle), static_cast<std::uint8_t>(Handle >> 8),
+                0x13
+            });
+        }
+
+        //
+        // Remote opens a channel and configures it, the host accepts and
+        // configures its side. Remotes that get turned down only see the
+        // connection request answered with "PSM not supported".
+        // 
+        void OpenChannel(std::uint16_t Handle, std::uint16_t Psm, std::uint16_t SourceCid, bool IsAccepted = true)
+        {
+            const std::uint16_t destinationCid = static_cast<std::uint16_t>(SourceCid + 0x30);
+
+            Signalling(Received, Handle, 0x02, { Lo(Psm), Hi(Psm), Lo(SourceCid), Hi(SourceCid) });
+
+            if (!IsAccepted)
+            {
+                Signalling(Sent, Handle, 0x03, { 0x00, 0x00, Lo(SourceCid), Hi(SourceCid), 0x02, 0x00, 0x00, 0x00 });
+                return;
+            }
+
+            Signalling(Sent, Handle, 0x03, {
+                Lo(destinationCid), Hi(destinationCid), Lo(SourceCid), Hi(SourceCid), 0x00, 0x00, 0x00, 0x00
+            });
+
+            Signalling(Received, Handle, 0x04, { Lo(destinationCid), Hi(destinationCid), 0x00, 0x00 });
+            Signalling(Sent, Handle, 0x05, { Lo(SourceCid), Hi(SourceCid), 0x00, 0x00, 0x00, 0x00 });
+            Signalling(Sent, Handle, 0x04, { Lo(SourceCid), Hi(SourceCid), 0x00, 0x00, 0x01, 0x02, 0xA0, 0x02 });
+            Signalling(Received, Handle, 0x05, { Lo(destinationCid), Hi(destinationCid), 0x00, 0x00, 0x00, 0x00 });
+        }
+
+        //
+        // Input reports on the interrupt channel, the bulk of all traffic
+        // 
+        void Reports(std::uint16_t Handle, std::uint16_t Cid, ReportLayout Layout, int Count)
+        {
+            for (int index = 0; index < Count; index++)
+            {
+                std::vector<std::uint8_t> payload(Layout.Length + 2u, static_cast<std::uint8_t>(index));
+
+                payload[0] = 0xA1;
+                payload[1] = Layout.ReportId;
+
+                Acl(Received, Handle, Cid, payload);
+            }
+        }
+
+    private:
+        std::ofstream _file;
+        PcapWriter _writer;
+
+        //
+        // 2026-01-01 in FILETIME units, one millisecond per packet
+        // 
+        std::uint64_t _time = 134116992000000000ULL;
+
+        std::uint8_t _identifier = 1;
+
+        static std::uint8_t Lo(std::uint16_t Value)
+        {
+            return static_cast<std::uint8_t>(Value);
+        }
+
+        static std::uint8_t Hi(std::uint16_t Value)
+        {
+            return static_cast<std::uint8_t>(Value >> 8);
+        }
+
+        static void AppendAddress(std::vector<std::uint8_t>& Packet, std::uint64_t Address)
+        {
+            for (int index = 0; index < 6; index++)
+            {
+                Packet.push_back(static_cast<std::uint8_t>(Address >> (8 * index)));
+            }
+        }
+
+        void Signalling(std::uint8_t Direction, std::uint16_t Handle, std::uint8_t Code, const std::vector<std::uint8_t>& Data)
+        {
+            std::vector<std::uint8_t> command = {
+                Code, _identifier++, Lo(static_cast<std::uint16_t>(Data.size())), Hi(static_cast<std::uint16_t>(Data.size()))
+            };
+
+            command.insert(command.end(), Data.begin(), Data.end());
+
+            Acl(Direction, Handle, 0x0001, command);
+        }
+
+        void Acl(std::uint8_t Direction, std::uint16_t Handle, std::uint16_t Cid, const std::vector<std::uint8_t>& Payload)
+        {
+            const auto l2capLength = static_cast<std::uint16_t>(Payload.size());
+            const auto aclLength = static_cast<std::uint16_t>(l2capLength + 4);
+
+            std::vector<std::uint8_t> packet = {
+                Lo(Handle), static_cast<std::uint8_t>(0x20 | (Hi(Handle) & 0x0F)),
+                Lo(aclLength), Hi(aclLength),
+                Lo(l2capLength), Hi(l2capLength),
+                Lo(Cid), Hi(Cid)
+            };
+
+            packet.insert(packet.end(), Payload.begin(), Payload.end());
+
+            Write(Direction, PacketAcl, packet);
+        }
+
+        void Write(std::uint8_t Direction, std::uint8_t PacketType, const std::vector<std::uint8_t>& Data)
+        {
+            const auto length = static_cast<std::uint32_t>(Data.size());
+
+            _writer.write(_time, Direction, PacketType, Data.data(), length, length);
+            _time += 10000;
+        }
+    };
+
+    //
+    // A supported controller reconnecting to the host it's paired with
+    // 
+    void WriteController(Capture& Out, std::uint16_t Handle, std::uint64_t Address, ReportLayout Layout)
+    {
+        Out.Connect(Handle, Address);
+        Out.OpenChannel(Handle, PsmHidControl, 0x0040);
+        Out.OpenChannel(Handle, PsmHidInterrupt, 0x0041);
+        Out.Reports(Handle, 0x0071, Layout, 8);
+        Out.Disconnect(Handle);
+    }
+
+    bool WriteCorpus(const std::string& Directory)
+    {
+        const auto write = [&Directory](const char* Name, const auto& Record)
+        {
+            Capture out(Directory + "/" + Name + ".pcap");
+
+            Record(out);
+
+            return out.IsGood();
+        };
+
+        bool isWritten = true;
+
+        isWritten &= write("sixaxis", [](Capture& Out)
+        {
+            WriteController(Out, 0x000B, Sixaxis, Ds3Report);
+        });
+
+        isWritten &= write("navigation", [](Capture& Out)
+        {
+            WriteController(Out, 0x000C, Navigation, Ds3Report);
+        });
+
+        isWritten &= write("motion", [](Capture& Out)
+        {
+            WriteController(Out, 0x000D, Motion, Ds3Report);
+        });
+
+        //
+        // The DS4 browses SDP first, that PSM is never remapped
+        // 
+        isWritten &= write("wireless", [](Capture& Out)
+        {
+            Out.Connect(0x000E, Wireless);
+            Out.OpenChannel(0x000E, PsmSdp, 0x0042);
+            Out.OpenChannel(0x000E, PsmHidControl, 0x0040);
+            Out.OpenChannel(0x000E, PsmHidInterrupt, 0x0041);
+            Out.Reports(0x000E, 0x0071, Ds4Report, 8);
+            Out.Disconnect(0x000E);
+        });
+
+        //
+        // Patching got suspended for a headset the profile driver turned
+        // down. Its retry passes unpatched, once the stock stack accepted
+        // it a SIXAXIS gets patched again while the headset's link stays
+        // excluded. After the headset left it counts as unknown again.
+        // 
+        isWritten &= write("foreign_retry", [](Capture& Out)
+        {
+            Out.Connect(0x000B, Headset);
+            Out.OpenChannel(0x000B, PsmHidControl, 0x0040);
+            Out.Connect(0x000C, Sixaxis);
+            Out.OpenChannel(0x000C, PsmHidControl, 0x0040);
+            Out.OpenChannel(0x000B, PsmHidInterrupt, 0x0041);
+            Out.OpenChannel(0x000C, PsmHidInterrupt, 0x0041);
+            Out.Reports(0x000C, 0x0071, Ds3Report, 4);
+            Out.Disconnect(0x000B);
+            Out.Connect(0x000D, Headset);
+            Out.OpenChannel(0x000D, PsmHidControl, 0x0040, false);
+            Out.Disconnect(0x000D);
+            Out.Disconnect(0x000C);
+        });
+
+        //
+        // The suspended headset gives up before configuring a channel, the
+        // lost link re-arms patching for the SIXAXIS after it
+        // 
+        isWritten &= write("link_loss", [](Capture& Out)
+        {
+            Out.Connect(0x000B, Headset);
+            Out.OpenChannel(0x000B, PsmHidControl, 0x0040, false);
+            Out.Disconnect(0x000B);
+            WriteController(Out, 0x000C, Sixaxis, Ds3Report);
+        });
+
+        //
+        // Several controllers interleaved on one radio, the Navigation
+        // leaves and a Motion Controller gets its ACL handle
+        // 
+        isWritten &= write("mixed", [](Capture& Out)
+        {
+            Out.Connect(0x000B, Sixaxis);
+            Out.Connect(0x000C, Navigation);
+            Out.OpenChannel(0x000B, PsmHidControl, 0x0040);
+            Out.OpenChannel(0x000C, PsmHidControl, 0x0040);
+            Out.Connect(0x000D, Wireless);
+            Out.OpenChannel(0x000B, PsmHidInterrupt, 0x0041);
+            Out.OpenChannel(0x000D, PsmSdp, 0x0042);
+            Out.OpenChannel(0x000C, PsmHidInterrupt, 0x0041);
+            Out.OpenChannel(0x000D, PsmHidControl, 0x0040);
+            Out.OpenChannel(0x000D, PsmHidInterrupt, 0x0041);
+            Out.Reports(0x000B, 0x0071, Ds3Report, 4);
+            Out.Reports(0x000D, 0x0071, Ds4Report, 4);
+            Out.Disconnect(0x000C);
+            Out.Connect(0x000C, Motion);
+            Out.OpenChannel(0x000C, PsmHidControl, 0x0040);
+            Out.OpenChannel(0x000C, PsmHidInterrupt, 0x0041);
+            Out.Reports(0x000C, 0x0071, Ds3Report, 4);
+            Out.Disconnect(0x000B);
+            Out.Disconnect(0x000C);
+            Out.Disconnect(0x000D);
+        });
+
+        return isWritten;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: bthps3_make_corpus DIRECTORY\n");
+        return 2;
+    }
+
+    if (!WriteCorpus(argv[1]))
+    {
+        fprintf(stderr, "couldn't write the corpus to %s\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
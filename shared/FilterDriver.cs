@@ -12,6 +12,7 @@ public class FilterDriver
     private const uint IOCTL_BTHPS3PSM_ENABLE_PSM_PATCHING = 0x002AAC04;
     private const uint IOCTL_BTHPS3PSM_DISABLE_PSM_PATCHING = 0x002AAC08;
     private const uint IOCTL_BTHPS3PSM_GET_PSM_PATCHING = 0x002A6C0C;
+    private const uint IOCTL_BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE = 0x002A6C1C;
 
     private static readonly string BTHPS3PSM_CONTROL_DEVICE_PATH = "\\\\.\\BthPS3PSMControl";
 
@@ -134,6 +135,65 @@ public class FilterDriver
         }
     }
 
+    /// <summary>
+    ///     Blocks until the PSM patch state of any radio changes.
+    /// </summary>
+    /// <param name="sequence">
+    ///     Sequence of the last change seen by the caller (zero initially). Gets updated to the sequence of the
+    ///     reported change.
+    /// </param>
+    /// <param name="deviceIndex">Index of the radio the change occurred on.</param>
+    /// <returns>True if patching got enabled, false if it got disabled.</returns>
+    public static bool WaitForPatchStateChange(ref ulong sequence, out uint deviceIndex)
+    {
+        using Kernel32.SafeObjectHandle handle = Kernel32.CreateFile(BTHPS3PSM_CONTROL_DEVICE_PATH,
+            Kernel32.ACCESS_MASK.GenericRight.GENERIC_READ | Kernel32.ACCESS_MASK.GenericRight.GENERIC_WRITE,
+            Kernel32.FileShare.FILE_SHARE_READ | Kernel32.FileShare.FILE_SHARE_WRITE,
+            IntPtr.Zero, Kernel32.CreationDisposition.OPEN_EXISTING,
+            Kernel32.CreateFileFlags.FILE_ATTRIBUTE_NORMAL,
+            Kernel32.SafeObjectHandle.Null
+        );
+        if (handle.IsInvalid)
+        {
+            throw new Exception(ErrorMessage);
+        }
+
+        IntPtr payloadBuffer = Marshal.AllocHGlobal(Marshal.SizeOf<BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE>());
+        BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE payload = new() { Sequence = sequence };
+
+        try
+        {
+            Marshal.StructureToPtr(payload, payloadBuffer, false);
+
+            bool ret = Kernel32.DeviceIoControl(
+                handle,
+                unchecked((int)IOCTL_BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE),
+                payloadBuffer,
+                Marshal.SizeOf<BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE>(),
+                payloadBuffer,
+                Marshal.SizeOf<BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE>(),
+                out _,
+                IntPtr.Zero
+            );
+
+            if (!ret)
+            {
+                throw new Exception(ErrorMessage);
+            }
+
+            payload = Marshal.PtrToStructure<BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE>(payloadBuffer);
+        }
+        finally
+        {
+            Marshal.FreeHGlobal(payloadBuffer);
+        }
+
+        sequence = payload.Sequence;
+        deviceIndex = payload.DeviceIndex;
+
+        return payload.IsEnabled > 0;
+    }
+
     [StructLayout(LayoutKind.Sequential, Pack = 1)]
     private struct BTHPS3PSM_ENABLE_PSM_PATCHING
     {
@@ -157,4 +217,15 @@ public class FilterDriver
         [MarshalAs(UnmanagedType.ByValTStr, SizeConst = 0xC8)]
         public readonly string SymbolicLinkName;
     }
+
+    [StructLayout(LayoutKind.Sequential, Pack = 1)]
+    [SuppressMessage("ReSharper", "MemberCanBePrivate.Local")]
+    private struct BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE
+    {
+        public ulong Sequence;
+
+        public readonly uint DeviceIndex;
+
+        public readonly uint IsEnabled;
+    }
 }
\ No newline at end of file
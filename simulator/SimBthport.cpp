@@ -0,0 +1,801 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+//
+// Virtual BTHPORT: one radio per I/O target, remotes on it produce input
+// reports at a fixed rate and answer control channel requests. ACL
+// transfers complete asynchronously like the real port driver does.
+// 
+
+#include "Simulator.h"
+
+#include <bthioctl.h>
+
+EXTERN_C_START
+#include <BthPS3/Crc32.h>
+EXTERN_C_END
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+
+using SimRemote = struct _SIM_REMOTE;
+
+namespace
+{
+    //
+    // HIDP transaction headers the remote model reacts to
+    // 
+    constexpr UCHAR HidpHandshakeSuccessful = 0x00;
+    constexpr UCHAR HidpGetReport = 0x40;
+    constexpr UCHAR HidpSetReport = 0x50;
+    constexpr UCHAR HidpTransactionMask = 0xF0;
+    constexpr UCHAR HidpReportIdPresent = 0x08;
+    constexpr UCHAR HidpReportTypeMask = 0x03;
+    constexpr UCHAR HidpReportTypeFeature = 0x03;
+    constexpr UCHAR HidpDataInput = 0xA1;
+    constexpr UCHAR HidpDataFeature = 0xA3;
+
+    constexpr UCHAR SixaxisEnableReportId = 0xF4;
+
+    constexpr ULONG FeatureReportPayloadSize = 48;
+    constexpr ULONG DefaultInboundLimit = 64;
+
+    struct SimRadio;
+    struct SimChannel;
+
+    struct AclPacket
+    {
+        std::vector<UCHAR> Data;
+        ULONG64 GeneratedAt;
+        ULONG64 ArrivesAt;
+    };
+
+    struct Transfer
+    {
+        WDFREQUEST Request;
+        struct _BRB_L2CA_ACL_TRANSFER* Brb;
+        ULONG64 CompletesAt;
+    };
+
+    struct SimChannel
+    {
+        SimRemote* Remote;
+        bool IsControl;
+
+        //
+        // Packets on the air, ordered by arrival
+        // 
+        std::deque<AclPacket> InFlight;
+
+        //
+        // Arrived, waiting for a read to pick them up
+        // 
+        std::deque<AclPacket> Inbound;
+
+        std::deque<Transfer> PendingReads;
+        std::deque<Transfer> PendingWrites;
+        std::deque<Transfer> Canceled;
+
+        ULONG64 LastArrival = 0;
+        ULONG64 LastWriteCompletion = 0;
+        bool IsDeliveryPosted = false;
+        bool IsCancelPosted = false;
+    };
+}
+
+struct _SIM_REMOTE
+{
+    SimRadio* Radio;
+    BTH_ADDR Address;
+    SIM_REMOTE_CONFIG Config;
+    SimChannel Control;
+    SimChannel Interrupt;
+    std::mt19937_64 Random;
+    SIM_REMOTE_STATS Stats;
+    SIM_EVT_REMOTE_PACKET* EvtPacket;
+    PVOID PacketContext;
+    UCHAR Sequence;
+    bool IsEnabled;
+    bool IsStopped;
+};
+
+namespace
+{
+    struct Failure
+    {
+        WDFREQUEST Request;
+        NTSTATUS Status;
+    };
+
+    struct SimRadio
+    {
+        WDFIOTARGET Target = nullptr;
+        std::vector<std::unique_ptr<SimRemote>> Remotes;
+        std::unordered_set<PVOID> Channels;
+        std::deque<Failure> Failures;
+        bool IsFailurePosted = false;
+    };
+
+    typedef struct _SIM_RADIO_CONTEXT
+    {
+        SimRadio* Radio;
+
+    } SIM_RADIO_CONTEXT, * PSIM_RADIO_CONTEXT;
+
+    WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(SIM_RADIO_CONTEXT, GetSimRadioContext)
+
+    VOID EvtFreeBrb(
+        _In_ PBRB Brb
+    )
+    {
+        SimCountBrbAllocation(TRUE);
+        free(Brb);
+    }
+
+    SimRadio* RadioOf(WDFIOTARGET Target)
+    {
+        return GetSimRadioContext(Target)->Radio;
+    }
+
+    //
+    // Radio goes away with the target, transfers it still holds are freed
+    // along with it since nobody is left to complete them
+    // 
+    VOID EvtRadioDestroy(_In_ WDFOBJECT Object)
+    {
+        SimRadio* radio = GetSimRadioContext(Object)->Radio;
+
+        for (const auto& remote : radio->Remotes)
+        {
+            for (SimChannel* channel : { &remote->Control, &remote->Interrupt })
+            {
+                for (auto* transfers : { &channel->PendingReads, &channel->PendingWrites, &channel->Canceled })
+                {
+                    for (const Transfer& transfer : *transfers)
+                    {
+                        EvtFreeBrb(reinterpret_cast<PBRB>(transfer.Brb));
+                    }
+                }
+            }
+        }
+
+        delete radio;
+    }
+
+    ULONG64 Jittered(SimRemote* Remote, ULONG64 Value)
+    {
+        const ULONG64 jitter = Remote->Config.Jitter;
+
+        if (jitter == 0)
+        {
+            return Value;
+        }
+
+        const ULONG64 offset = Remote->Random() % (2 * jitter + 1);
+
+        return Value + offset > jitter ? Value + offset - jitter : 0;
+    }
+
+    //
+    // Packets on one channel never overtake each other
+    // 
+    ULONG64 ArrivalTime(SimChannel* Channel)
+    {
+        const ULONG64 arrival = std::max(
+            Channel->LastArrival,
+            SimNow() + Jittered(Channel->Remote, Channel->Remote->Config.Latency)
+        );
+
+        Channel->LastArrival = arrival;
+
+        return arrival;
+    }
+
+    void EvtDeliver(PVOID Context);
+
+    void PostDelivery(SimChannel* Channel)
+    {
+        if (!Channel->IsDeliveryPosted && !Channel->Inbound.empty() && !Channel->PendingReads.empty())
+        {
+            Channel->IsDeliveryPosted = true;
+            SimPost(0, EvtDeliver, Channel);
+        }
+    }
+
+    void EvtArrive(PVOID Context)
+    {
+        auto* channel = static_cast<SimChannel*>(Context);
+        SimRemote* remote = channel->Remote;
+
+        if (channel->InFlight.empty())
+        {
+            return;
+        }
+
+        channel->Inbound.push_back(std::move(channel->InFlight.front()));
+        channel->InFlight.pop_front();
+
+        //
+        // The port driver only buffers so much for a channel nobody reads
+        // 
+        const ULONG limit = remote->Config.InboundLimit != 0 ? remote->Config.InboundLimit : DefaultInboundLimit;
+
+        while (channel->Inbound.size() > limit)
+        {
+            channel->Inbound.pop_front();
+            remote->Stats.ReportsDropped++;
+        }
+
+        PostDelivery(channel);
+    }
+
+    void Transmit(SimChannel* Channel, std::vector<UCHAR>&& Data)
+    {
+        const ULONG64 arrival = ArrivalTime(Channel);
+
+        Channel->InFlight.push_back(AclPacket{ std::move(Data), SimNow(), arrival });
+        SimPost(arrival - SimNow(), EvtArrive, Channel);
+    }
+
+    //
+    // Copies an arrived packet into a pending read, truncating to the
+    // buffer the BRB offers
+    // 
+    void EvtDeliver(PVOID Context)
+    {
+        auto* channel = static_cast<SimChannel*>(Context);
+
+        channel->IsDeliveryPosted = false;
+
+        while (!channel->Inbound.empty() && !channel->PendingReads.empty())
+        {
+            const AclPacket packet = std::move(channel->Inbound.front());
+            const Transfer transfer = channel->PendingReads.front();
+            struct _BRB_L2CA_ACL_TRANSFER* brb = transfer.Brb;
+
+            channel->Inbound.pop_front();
+            channel->PendingReads.pop_front();
+
+            const auto buffer = static_cast<PUCHAR>(brb->BufferMDL != nullptr
+                ? brb->BufferMDL->MappedSystemVa
+                : brb->Buffer);
+            const auto length = static_cast<ULONG>(packet.Data.size());
+            const ULONG copied = std::min(length, brb->BufferSize);
+            NTSTATUS status = STATUS_SUCCESS;
+
+            memcpy(buffer, packet.Data.data(), copied);
+
+            brb->BufferSize = copied;
+            brb->RemainingBufferSize = length - copied;
+
+            if (copied < length)
+            {
+                status = STATUS_BUFFER_OVERFLOW;
+            }
+
+            brb->Hdr.Status = status;
+
+            if (!channel->IsControl)
+            {
+                channel->Remote->Stats.ReportsDelivered++;
+            }
+
+            SimRequestSetTag(transfer.Request, packet.GeneratedAt);
+            SimIoTargetCompleteRequest(transfer.Request, status, copied);
+        }
+    }
+
+    void EvtCanceled(PVOID Context)
+    {
+        auto* channel = static_cast<SimChannel*>(Context);
+
+        channel->IsCancelPosted = false;
+
+        while (!channel->Canceled.empty())
+        {
+            const Transfer transfer = channel->Canceled.front();
+
+            channel->Canceled.pop_front();
+            transfer.Brb->Hdr.Status = STATUS_CANCELLED;
+            SimIoTargetCompleteRequest(transfer.Request, STATUS_CANCELLED, 0);
+        }
+    }
+
+    void EvtFailed(PVOID Context)
+    {
+        auto* radio = static_cast<SimRadio*>(Context);
+
+        radio->IsFailurePosted = false;
+
+        while (!radio->Failures.empty())
+        {
+            const Failure failure = radio->Failures.front();
+
+            radio->Failures.pop_front();
+            SimIoTargetCompleteRequest(failure.Request, failure.Status, 0);
+        }
+    }
+
+    void Fail(SimRadio* Radio, WDFREQUEST Request, NTSTATUS Status)
+    {
+        Radio->Failures.push_back(Failure{ Request, Status });
+
+        if (!Radio->IsFailurePosted)
+        {
+            Radio->IsFailurePosted = true;
+            SimPost(0, EvtFailed, Radio);
+        }
+    }
+
+    void StartReports(SimRemote* Remote);
+
+    //
+    // What the controller answers on the control channel
+    // 
+    void ReceiveControl(SimRemote* Remote, const UCHAR* Data, ULONG Length)
+    {
+        if (Length == 0)
+        {
+            return;
+        }
+
+        switch (Data[0] & HidpTransactionMask)
+        {
+        case HidpSetReport:
+            if (Length > 1 && (Data[0] & HidpReportTypeMask) == HidpReportTypeFeature && Data[1] == SixaxisEnableReportId
+                && !Remote->IsEnabled)
+            {
+                Remote->IsEnabled = true;
+                StartReports(Remote);
+            }
+
+            Remote->Stats.ControlResponses++;
+            Transmit(&Remote->Control, std::vector<UCHAR>{ HidpHandshakeSuccessful });
+            break;
+
+        case HidpGetReport:
+        {
+            const UCHAR reportId = (Data[0] & HidpReportIdPresent) != 0 || Length > 1 ? Data[1] : 0;
+            std::vector<UCHAR> response(2 + FeatureReportPayloadSize);
+
+            response[0] = HidpDataFeature;
+            response[1] = reportId;
+
+            for (ULONG index = 0; index < FeatureReportPayloadSize; index++)
+            {
+                response[2 + index] = static_cast<UCHAR>(reportId + index);
+            }
+
+            Remote->Stats.ControlResponses++;
+            Transmit(&Remote->Control, std::move(response));
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    void EvtWriteCompleted(PVOID Context)
+    {
+        auto* channel = static_cast<SimChannel*>(Context);
+        SimRemote* remote = channel->Remote;
+
+        if (channel->PendingWrites.empty())
+        {
+            return;
+        }
+
+        const Transfer transfer = channel->PendingWrites.front();
+        struct _BRB_L2CA_ACL_TRANSFER* brb = transfer.Brb;
+        const auto* buffer = static_cast<const UCHAR*>(brb->BufferMDL != nullptr
+            ? brb->BufferMDL->MappedSystemVa
+            : brb->Buffer);
+
+        channel->PendingWrites.pop_front();
+
+        if (channel->IsControl)
+        {
+            remote->Stats.ControlPacketsOut++;
+        }
+        else
+        {
+            remote->Stats.InterruptPacketsOut++;
+        }
+
+        if (remote->EvtPacket != nullptr)
+        {
+            remote->EvtPacket(remote->PacketContext, channel->IsControl, buffer, brb->BufferSize);
+        }
+
+        if (channel->IsControl)
+        {
+            ReceiveControl(remote, buffer, brb->BufferSize);
+        }
+
+        brb->Hdr.Status = STATUS_SUCCESS;
+        SimIoTargetCompleteRequest(transfer.Request, STATUS_SUCCESS, brb->BufferSize);
+    }
+
+    //
+    // Input report layout of the emulated device type, contents change with
+    // every report so consumers can't get away with comparing stale data
+    // 
+    std::vector<UCHAR> BuildInputReport(SimRemote* Remote)
+    {
+        const UCHAR sequence = Remote->Sequence++;
+        std::vector<UCHAR> report;
+
+        switch (Remote->Config.DeviceType)
+        {
+        case DS_DEVICE_TYPE_WIRELESS:
+            report.resize(79);
+            report[1] = 0x11;
+            break;
+
+        case DS_DEVICE_TYPE_MOTION:
+            report.resize(BTHPS3_SIXAXIS_HID_INPUT_REPORT_SIZE);
+            report[1] = 0x01;
+            break;
+
+        default:
+            report.resize(BTHPS3_SIXAXIS_HID_INPUT_REPORT_SIZE);
+            report[1] = 0x01;
+            break;
+        }
+
+        report[0] = HidpDataInput;
+
+        for (size_t index = 2; index < report.size(); index++)
+        {
+            report[index] = static_cast<UCHAR>(sequence + index);
+        }
+
+        switch (Remote->Config.DeviceType)
+        {
+        case DS_DEVICE_TYPE_WIRELESS:
+            BthPS3_Crc32Seal(report.data(), static_cast<ULONG>(report.size()));
+            break;
+
+        case DS_DEVICE_TYPE_MOTION:
+            report[5] = static_cast<UCHAR>((report[5] & 0xF0) | (sequence & 0x0F));
+            break;
+
+        default:
+            break;
+        }
+
+        return report;
+    }
+
+    void EvtGenerate(PVOID Context)
+    {
+        auto* remote = static_cast<SimRemote*>(Context);
+
+        if (remote->IsStopped)
+        {
+            return;
+        }
+
+        remote->Stats.ReportsGenerated++;
+        Transmit(&remote->Interrupt, BuildInputReport(remote));
+
+        SimPost(Jittered(remote, 10000000ULL / remote->Config.ReportRate), EvtGenerate, remote);
+    }
+
+    //
+    // Spread the first report over one period so controllers don't fire in lockstep
+    // 
+    void StartReports(SimRemote* Remote)
+    {
+        if (Remote->Config.ReportRate != 0)
+        {
+            const ULONG64 period = 10000000ULL / Remote->Config.ReportRate;
+
+            SimPost(Remote->Random() % period, EvtGenerate, Remote);
+        }
+    }
+
+    void EvtTargetSubmit(
+        _In_ PVOID Context,
+        _In_ WDFREQUEST Request,
+        _In_ ULONG IoControlCode,
+        _In_opt_ PVOID InputBuffer,
+        _In_ size_t InputBufferLength
+    )
+    {
+        auto* radio = static_cast<SimRadio*>(Context);
+
+        if (IoControlCode == IOCTL_BTH_DISCONNECT_DEVICE)
+        {
+            Fail(radio, Request, STATUS_SUCCESS);
+            return;
+        }
+
+        if (IoControlCode != IOCTL_INTERNAL_BTH_SUBMIT_BRB || InputBuffer == nullptr
+            || InputBufferLength < sizeof(BRB_HEADER))
+        {
+            Fail(radio, Request, STATUS_INVALID_DEVICE_REQUEST);
+            return;
+        }
+
+        auto* brb = static_cast<struct _BRB_L2CA_ACL_TRANSFER*>(InputBuffer);
+
+        if (brb->Hdr.Type != BRB_L2CA_ACL_TRANSFER)
+        {
+            brb->Hdr.Status = STATUS_NOT_SUPPORTED;
+            Fail(radio, Request, STATUS_NOT_SUPPORTED);
+            return;
+        }
+
+        if (radio->Channels.count(brb->ChannelHandle) == 0)
+        {
+            brb->Hdr.Status = STATUS_INVALID_PARAMETER;
+            Fail(radio, Request, STATUS_INVALID_PARAMETER);
+            return;
+        }
+
+        auto* channel = static_cast<SimChannel*>(brb->ChannelHandle);
+
+        if ((brb->TransferFlags & ACL_TRANSFER_DIRECTION_IN) != 0)
+        {
+            channel->PendingReads.push_back(Transfer{ Request, brb, 0 });
+            PostDelivery(channel);
+            return;
+        }
+
+        const ULONG64 completion = std::max(
+            channel->LastWriteCompletion,
+            SimNow() + Jittered(channel->Remote, channel->Remote->Config.Latency)
+        );
+
+        channel->LastWriteCompletion = completion;
+        channel->PendingWrites.push_back(Transfer{ Request, brb, completion });
+        SimPost(completion - SimNow(), EvtWriteCompleted, channel);
+    }
+
+    //
+    // Only reads waiting for data can be pulled back, packets already
+    // handed to the radio go out regardless
+    // 
+    BOOLEAN EvtTargetCancel(
+        _In_ PVOID Context,
+        _In_ WDFREQUEST Request
+    )
+    {
+        auto* radio = static_cast<SimRadio*>(Context);
+
+        for (const auto& remote : radio->Remotes)
+        {
+            for (SimChannel* channel : { &remote->Control, &remote->Interrupt })
+            {
+                auto& reads = channel->PendingReads;
+                const auto it = std::find_if(reads.begin(), reads.end(), [Request](const Transfer& transfer)
+                {
+                    return transfer.Request == Request;
+                });
+
+                if (it == reads.end())
+                {
+                    continue;
+                }
+
+                channel->Canceled.push_back(*it);
+                reads.erase(it);
+
+                if (!channel->IsCancelPosted)
+                {
+                    channel->IsCancelPosted = true;
+                    SimPost(0, EvtCanceled, channel);
+                }
+
+                return TRUE;
+            }
+        }
+
+        return FALSE;
+    }
+
+    PBRB EvtAllocateBrb(
+        _In_ BRB_TYPE BrbType,
+        _In_ ULONG PoolTag
+    )
+    {
+        UNREFERENCED_PARAMETER(PoolTag);
+
+        auto* brb = static_cast<PBRB>(calloc(1, sizeof(BRB)));
+
+        if (brb != nullptr)
+        {
+            brb->BrbHeader.Type = static_cast<USHORT>(BrbType);
+            brb->BrbHeader.Length = sizeof(BRB);
+            SimCountBrbAllocation(FALSE);
+        }
+
+        return brb;
+    }
+
+    VOID EvtInitializeBrb(
+        _Inout_ PBRB Brb,
+        _In_ BRB_TYPE BrbType
+    )
+    {
+        memset(Brb, 0, sizeof(BRB));
+        Brb->BrbHeader.Type = static_cast<USHORT>(BrbType);
+        Brb->BrbHeader.Length = sizeof(BRB);
+    }
+}
+
+NTSTATUS
+SimBthportRadioCreate(
+    _In_ WDFDEVICE Radio,
+    _Out_ WDFIOTARGET* IoTarget,
+    _Out_ PBTH_PROFILE_DRIVER_INTERFACE Interface
+)
+{
+    WDF_OBJECT_ATTRIBUTES attributes;
+    PSIM_RADIO_CONTEXT context = nullptr;
+    WDFIOTARGET target;
+    auto radio = std::make_unique<SimRadio>();
+
+    NTSTATUS status = SimIoTargetCreate(Radio, EvtTargetSubmit, EvtTargetCancel, radio.get(), &target);
+
+    if (!NT_SUCCESS(status))
+    {
+        return status;
+    }
+
+    WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, SIM_RADIO_CONTEXT);
+    attributes.EvtDestroyCallback = EvtRadioDestroy;
+
+    if (!NT_SUCCESS(status = WdfObjectAllocateContext(target, &attributes, reinterpret_cast<PVOID*>(&context))))
+    {
+        WdfObjectDelete(target);
+        return status;
+    }
+
+    radio->Target = target;
+    context->Radio = radio.release();
+
+    RtlZeroMemory(Interface, sizeof(*Interface));
+    Interface->Interface.Size = sizeof(*Interface);
+    Interface->Interface.Version = 1;
+    Interface->BthAllocateBrb = EvtAllocateBrb;
+    Interface->BthFreeBrb = EvtFreeBrb;
+    Interface->BthInitializeBrb = EvtInitializeBrb;
+    Interface->BthReuseBrb = EvtInitializeBrb;
+
+    *IoTarget = target;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+SimBthportRemoteConnect(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ BTH_ADDR RemoteAddress,
+    _In_ PCSIM_REMOTE_CONFIG Config,
+    _Out_ L2CAP_CHANNEL_HANDLE* ControlChannel,
+    _Out_ L2CAP_CHANNEL_HANDLE* InterruptChannel,
+    _Out_ PSIM_REMOTE* Remote
+)
+{
+    SimRadio* radio = RadioOf(IoTarget);
+
+    auto remote = std::make_unique<SimRemote>();
+
+    remote->Radio = radio;
+    remote->Address = RemoteAddress;
+    remote->Config = *Config;
+    remote->Control.Remote = remote.get();
+    remote->Control.IsControl = true;
+    remote->Interrupt.Remote = remote.get();
+    remote->Interrupt.IsControl = false;
+    remote->Random.seed(Config->Seed ^ RemoteAddress);
+    remote->Stats = SIM_REMOTE_STATS{};
+    remote->EvtPacket = nullptr;
+    remote->PacketContext = nullptr;
+    remote->Sequence = 0;
+    remote->IsEnabled = !Config->IsSilentUntilEnabled;
+    remote->IsStopped = false;
+
+    radio->Channels.insert(&remote->Control);
+    radio->Channels.insert(&remote->Interrupt);
+
+    *ControlChannel = &remote->Control;
+    *InterruptChannel = &remote->Interrupt;
+    *Remote = remote.get();
+
+    if (remote->IsEnabled)
+    {
+        StartReports(remote.get());
+    }
+
+    radio->Remotes.push_back(std::move(remote));
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+SimBthportRemoteStop(
+    _In_ PSIM_REMOTE Remote
+)
+{
+    Remote->IsStopped = true;
+}
+
+VOID
+SimBthportRemoteInject(
+    _In_ PSIM_REMOTE Remote,
+    _In_ BOOLEAN IsControlChannel,
+    _In_reads_bytes_(Length) const UCHAR* Packet,
+    _In_ ULONG Length,
+    _In_ ULONG64 Delay
+)
+{
+    SimChannel* channel = IsControlChannel ? &Remote->Control : &Remote->Interrupt;
+    const ULONG64 arrival = std::max(channel->LastArrival, SimNow() + Delay);
+
+    channel->LastArrival = arrival;
+    channel->InFlight.push_back(AclPacket{ std::vector<UCHAR>(Packet, Packet + Length), SimNow(), arrival });
+    SimPost(arrival - SimNow(), EvtArrive, channel);
+}
+
+VOID
+SimBthportRemoteSetPacketObserver(
+    _In_ PSIM_REMOTE Remote,
+    _In_opt_ SIM_EVT_REMOTE_PACKET* EvtPacket,
+    _In_opt_ PVOID Context
+)
+{
+    Remote->EvtPacket = EvtPacket;
+    Remote->PacketContext = Context;
+}
+
+VOID
+SimBthportRemoteGetStats(
+    _In_ PSIM_REMOTE Remote,
+    _Out_ PSIM_REMOTE_STATS Stats
+)
+{
+    *Stats = Remote->Stats;
+}
@@ -0,0 +1,451 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+//
+// Bus driver glue: brings radios and children up the way DriverEntry,
+// Bluetooth.Context.c, BusLogic.c and L2CAP.c do, minus everything that
+// talks to the real BTHPORT, PnP or DMF's PDO module
+// 
+
+#include "Driver.h"
+#include "Simulator.h"
+
+
+NTSTATUS
+SimDriverInitialize(
+    VOID
+)
+{
+    BthPS3_Crc32Init();
+
+    return BthPS3_RadiosInitialize(WdfGetDriver());
+}
+
+//
+// Mirrors BthPS3_ServerContextInit for what the I/O path depends on
+// 
+NTSTATUS
+SimDriverRadioAdd(
+    _In_ BTH_ADDR LocalAddress,
+    _Out_ WDFDEVICE* Radio
+)
+{
+    NTSTATUS status;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDFDEVICE device = NULL;
+    PBTHPS3_SERVER_CONTEXT pSrvCtx;
+
+    WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, BTHPS3_SERVER_CONTEXT);
+
+    if (!NT_SUCCESS(status = SimDeviceCreate(NULL, &attributes, &device)))
+    {
+        return status;
+    }
+
+    pSrvCtx = GetServerDeviceContext(device);
+
+    pSrvCtx->Header.Device = device;
+    pSrvCtx->Header.LocalBthAddr = LocalAddress;
+
+    do
+    {
+        if (!NT_SUCCESS(status = SimBthportRadioCreate(
+            device,
+            &pSrvCtx->Header.IoTarget,
+            &pSrvCtx->Header.ProfileDrvInterface
+        )))
+        {
+            break;
+        }
+
+        WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+        attributes.ParentObject = device;
+
+        if (!NT_SUCCESS(status = WdfRequestCreate(
+            &attributes,
+            pSrvCtx->Header.IoTarget,
+            &pSrvCtx->Header.HostInitRequest
+        )))
+        {
+            break;
+        }
+
+        if (!NT_SUCCESS(status = WdfWaitLockCreate(
+            &attributes,
+            &pSrvCtx->Header.ClientsLock
+        )))
+        {
+            break;
+        }
+
+        if (!NT_SUCCESS(status = WdfCollectionCreate(
+            &attributes,
+            &pSrvCtx->Header.Clients
+        )))
+        {
+            break;
+        }
+
+        if (!NT_SUCCESS(status = WdfWaitLockCreate(
+            &attributes,
+            &pSrvCtx->Header.SlotsLock
+        )))
+        {
+            break;
+        }
+
+        if (!NT_SUCCESS(status = BthPS3_FlightRecorderInitialize(
+            device,
+            &pSrvCtx->Header.FlightRecorder
+        )))
+        {
+            break;
+        }
+
+        if (!NT_SUCCESS(status = WdfSpinLockCreate(
+            &attributes,
+            &pSrvCtx->FeatureReports.Lock
+        )))
+        {
+            break;
+        }
+
+        BthPS3_FeatureCacheInit(&pSrvCtx->FeatureReports.Cache);
+
+        if (!NT_SUCCESS(status = WdfSpinLockCreate(
+            &attributes,
+            &pSrvCtx->RejectedDevices.Lock
+        )))
+        {
+            break;
+        }
+
+        BthPS3_RejectCacheInit(&pSrvCtx->RejectedDevices.Cache);
+
+        pSrvCtx->Settings.IsSIXAXISSupported = TRUE;
+        pSrvCtx->Settings.IsNAVIGATIONSupported = TRUE;
+        pSrvCtx->Settings.IsMOTIONSupported = TRUE;
+        pSrvCtx->Settings.IsWIRELESSSupported = TRUE;
+
+        status = BthPS3_RadioAdd(device);
+
+    } while (FALSE);
+
+    if (!NT_SUCCESS(status))
+    {
+        WdfObjectDelete(device);
+        return status;
+    }
+
+    *Radio = device;
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+SimDriverRadioAllowFeatureReport(
+    _In_ WDFDEVICE Radio,
+    _In_ UCHAR ReportId
+)
+{
+    const PBTHPS3_SERVER_CONTEXT pSrvCtx = GetServerDeviceContext(Radio);
+
+    WdfSpinLockAcquire(pSrvCtx->FeatureReports.Lock);
+    (void)BthPS3_FeatureCacheAllow(&pSrvCtx->FeatureReports.Cache, ReportId);
+    WdfSpinLockRelease(pSrvCtx->FeatureReports.Lock);
+}
+
+VOID
+SimDriverRadioSetSixaxisEnableOnConnect(
+    _In_ WDFDEVICE Radio,
+    _In_ BOOLEAN IsEnabled
+)
+{
+    GetServerDeviceContext(Radio)->Settings.SIXAXISEnableOnConnect = IsEnabled;
+}
+
+//
+// Mirrors the PDO context setup of BthPS3_PDO_Create
+// 
+static
+NTSTATUS
+SimDriverPdoContextInit(
+    _In_ PBTHPS3_SERVER_CONTEXT Context,
+    _In_ WDFDEVICE Device,
+    _In_ BTH_ADDR RemoteAddress,
+    _In_ DS_DEVICE_TYPE DeviceType,
+    _In_ PBTHPS3_PDO_CONTEXT PdoContext
+)
+{
+    NTSTATUS status;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDF_WORKITEM_CONFIG workItemConfig;
+    PBTHPS3_CLIENT_L2CAP_CHANNEL channels[] =
+    {
+        &PdoContext->HidControlChannel,
+        &PdoContext->HidInterruptChannel
+    };
+    WDFSPINLOCK* locks[] =
+    {
+        &PdoContext->IdleState.Lock,
+        &PdoContext->Feedback.Lock,
+        &PdoContext->MotionImu.Lock,
+        &PdoContext->StatePage.Lock,
+        &PdoContext->ControlTransaction.Lock
+    };
+
+    PdoContext->RemoteAddress = RemoteAddress;
+    PdoContext->DevCtxHdr = &Context->Header;
+    PdoContext->DeviceType = DeviceType;
+    PdoContext->SerialNumber = (ULONG)InterlockedIncrement(&Context->Header.ActiveLinks);
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = Device;
+
+    for (ULONG index = 0; index < ARRAYSIZE(channels); index++)
+    {
+        if (!NT_SUCCESS(status = WdfRequestCreate(
+            &attributes,
+            Context->Header.IoTarget,
+            &channels[index]->ConnectDisconnectRequest
+        )))
+        {
+            return status;
+        }
+
+        KeInitializeEvent(&channels[index]->DisconnectEvent, NotificationEvent, TRUE);
+
+        if (!NT_SUCCESS(status = WdfSpinLockCreate(
+            &attributes,
+            &channels[index]->ConnectionStateLock
+        )))
+        {
+            return status;
+        }
+
+        channels[index]->ConnectionState = ConnectionStateInitialized;
+    }
+
+    for (ULONG index = 0; index < ARRAYSIZE(locks); index++)
+    {
+        if (!NT_SUCCESS(status = WdfSpinLockCreate(&attributes, locks[index])))
+        {
+            return status;
+        }
+    }
+
+    WDF_WORKITEM_CONFIG_INIT(&workItemConfig, BthPS3_PDO_EvtIdlePolicyWorkItem);
+
+    if (!NT_SUCCESS(status = WdfWorkItemCreate(
+        &workItemConfig,
+        &attributes,
+        &PdoContext->IdleState.ApplyWorkItem
+    )))
+    {
+        return status;
+    }
+
+    PdoContext->Feedback.IsSupported = BthPS3_OutputReportInit(
+        &PdoContext->Feedback.State,
+        PdoContext->DeviceType
+    );
+
+    BthPS3_MotionImuInit(&PdoContext->MotionImu.Clock);
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Mirrors both connect response completions of L2CAP.c
+// 
+static
+NTSTATUS
+SimDriverPdoConnect(
+    _In_ PBTHPS3_PDO_CONTEXT PdoContext
+)
+{
+    NTSTATUS status;
+    PBTHPS3_CLIENT_L2CAP_CHANNEL channels[] =
+    {
+        &PdoContext->HidControlChannel,
+        &PdoContext->HidInterruptChannel
+    };
+
+    for (ULONG index = 0; index < ARRAYSIZE(channels); index++)
+    {
+        WdfSpinLockAcquire(channels[index]->ConnectionStateLock);
+        BthPS3_ConnectionStateConnectCompleted(&channels[index]->ConnectionState);
+        KeClearEvent(&channels[index]->DisconnectEvent);
+        WdfSpinLockRelease(channels[index]->ConnectionStateLock);
+    }
+
+    if (!NT_SUCCESS(status = WdfIoQueueReadyNotify(
+        PdoContext->Queues.HidControlReadRequests,
+        BthPS3_PDO_DispatchHidControlRead,
+        PdoContext
+    )))
+    {
+        return status;
+    }
+
+    if (!NT_SUCCESS(status = WdfIoQueueReadyNotify(
+        PdoContext->Queues.HidControlWriteRequests,
+        BthPS3_PDO_DispatchHidControlWrite,
+        PdoContext
+    )))
+    {
+        return status;
+    }
+
+    if (!NT_SUCCESS(status = WdfIoQueueReadyNotify(
+        PdoContext->Queues.HidInterruptReadRequests,
+        BthPS3_PDO_DispatchHidInterruptRead,
+        PdoContext
+    )))
+    {
+        return status;
+    }
+
+    if (!NT_SUCCESS(status = WdfIoQueueReadyNotify(
+        PdoContext->Queues.HidInterruptWriteRequests,
+        BthPS3_PDO_DispatchHidInterruptWrite,
+        PdoContext
+    )))
+    {
+        return status;
+    }
+
+    if (PdoContext->DeviceType == DS_DEVICE_TYPE_SIXAXIS
+        && GetServerDeviceContext(PdoContext->DevCtxHdr->Device)->Settings.SIXAXISEnableOnConnect)
+    {
+        (void)L2CAP_PS3_SendSixaxisEnable(PdoContext);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+SimDriverChildAdd(
+    _In_ WDFDEVICE Radio,
+    _In_ BTH_ADDR RemoteAddress,
+    _In_ PCSIM_REMOTE_CONFIG Config,
+    _Out_ WDFDEVICE* Child,
+    _Out_ PSIM_REMOTE* Remote
+)
+{
+    NTSTATUS status;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    PWDFDEVICE_INIT pInit = SimDeviceInitAllocate();
+    const PBTHPS3_SERVER_CONTEXT pSrvCtx = GetServerDeviceContext(Radio);
+    PBTHPS3_PDO_CONTEXT pPdoCtx;
+    WDFDEVICE device = NULL;
+
+    if (!NT_SUCCESS(status = BthPS3_PDO_EvtPreCreate(NULL, pInit, NULL, NULL)))
+    {
+        WdfDeviceInitFree(pInit);
+        return status;
+    }
+
+    WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, BTHPS3_PDO_CONTEXT);
+    attributes.ParentObject = Radio;
+
+    if (!NT_SUCCESS(status = SimDeviceCreate(&pInit, &attributes, &device)))
+    {
+        return status;
+    }
+
+    pPdoCtx = GetPdoContext(device);
+
+    do
+    {
+        if (!NT_SUCCESS(status = SimDmfIoctlHandlerCreate(
+            device,
+            G_PDO_IoctlSpecification,
+            G_PDO_IoctlSpecificationCount,
+            &pPdoCtx->DmfModuleIoctlHandler
+        )))
+        {
+            break;
+        }
+
+        if (!NT_SUCCESS(status = SimDriverPdoContextInit(
+            pSrvCtx,
+            device,
+            RemoteAddress,
+            Config->DeviceType,
+            pPdoCtx
+        )))
+        {
+            break;
+        }
+
+        if (!NT_SUCCESS(status = BthPS3_PDO_EvtPostCreate(NULL, device, NULL, NULL)))
+        {
+            break;
+        }
+
+        if (!NT_SUCCESS(status = SimDeviceStart(device)))
+        {
+            break;
+        }
+
+        if (!NT_SUCCESS(status = SimBthportRemoteConnect(
+            pSrvCtx->Header.IoTarget,
+            RemoteAddress,
+            Config,
+            &pPdoCtx->HidControlChannel.ChannelHandle,
+            &pPdoCtx->HidInterruptChannel.ChannelHandle,
+            Remote
+        )))
+        {
+            break;
+        }
+
+        status = SimDriverPdoConnect(pPdoCtx);
+
+    } while (FALSE);
+
+    if (!NT_SUCCESS(status))
+    {
+        WdfObjectDelete(device);
+        return status;
+    }
+
+    *Child = device;
+
+    return STATUS_SUCCESS;
+}
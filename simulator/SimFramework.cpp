@@ -0,0 +1,2549 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+//
+// Single threaded stand-in for KMDF, DMF's IoctlHandler and the I/O manager.
+// Object lifetime, queue dispatch and request ownership follow the
+// framework's documented rules closely enough for the bus driver's I/O path
+// to run unchanged; everything else either succeeds trivially or isn't
+// there. Time only moves through the event loop.
+// 
+
+#include "Simulator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace
+{
+    enum class ObjectType
+    {
+        Driver,
+        Device,
+        Queue,
+        Request,
+        IoTarget,
+        Memory,
+        SpinLock,
+        WaitLock,
+        Collection,
+        WorkItem,
+        Key,
+        DmfModule
+    };
+
+    struct SimObject;
+
+    //
+    // Precedes every context so WdfObjectContextGetObject finds the owner
+    // 
+    struct alignas(16) ContextHeader
+    {
+        SimObject* Owner;
+        PCWDF_OBJECT_CONTEXT_TYPE_INFO Type;
+        PFN_WDF_OBJECT_CONTEXT_CLEANUP EvtCleanup;
+        PFN_WDF_OBJECT_CONTEXT_DESTROY EvtDestroy;
+    };
+
+    struct SimObject
+    {
+        explicit SimObject(ObjectType type) : Type(type) {}
+        virtual ~SimObject() = default;
+
+        ObjectType Type;
+        ULONG64 Serial = 0;
+        SimObject* Parent = nullptr;
+        std::vector<SimObject*> Children;
+        std::vector<ContextHeader*> Contexts;
+        PFN_WDF_OBJECT_CONTEXT_CLEANUP EvtCleanup = nullptr;
+        PFN_WDF_OBJECT_CONTEXT_DESTROY EvtDestroy = nullptr;
+        bool IsDeleting = false;
+    };
+
+    struct SimQueue;
+    struct SimRequest;
+    struct SimDmfModule;
+
+    struct SimDevice : SimObject
+    {
+        SimDevice() : SimObject(ObjectType::Device) {}
+
+        SimQueue* DefaultQueue = nullptr;
+        SimDmfModule* IoctlHandler = nullptr;
+        PFN_WDF_DEVICE_SELF_MANAGED_IO_INIT EvtSelfManagedIoInit = nullptr;
+        ULONG IdleTimeout = 0;
+    };
+
+    struct SimQueue : SimObject
+    {
+        SimQueue() : SimObject(ObjectType::Queue) {}
+
+        SimDevice* Device = nullptr;
+        WDF_IO_QUEUE_DISPATCH_TYPE DispatchType = WdfIoQueueDispatchInvalid;
+        PFN_WDF_IO_QUEUE_IO_DEVICE_CONTROL EvtIoDeviceControl = nullptr;
+        std::deque<SimRequest*> Pending;
+        ULONG DriverOwned = 0;
+
+        PFN_WDF_IO_QUEUE_STATE EvtReady = nullptr;
+        WDFCONTEXT ReadyContext = nullptr;
+        bool IsInReady = false;
+        bool IsReadyAgain = false;
+
+        bool IsInDispatch = false;
+        bool IsDispatchPosted = false;
+    };
+
+    struct SimIoTarget : SimObject
+    {
+        SimIoTarget() : SimObject(ObjectType::IoTarget) {}
+
+        SIM_EVT_IO_TARGET_SUBMIT* EvtSubmit = nullptr;
+        SIM_EVT_IO_TARGET_CANCEL* EvtCancel = nullptr;
+        PVOID Context = nullptr;
+    };
+
+    struct SimMemory : SimObject
+    {
+        SimMemory() : SimObject(ObjectType::Memory) {}
+        ~SimMemory() override
+        {
+            if (IsOwned)
+            {
+                free(Buffer);
+            }
+        }
+
+        PVOID Buffer = nullptr;
+        size_t Size = 0;
+        bool IsOwned = false;
+    };
+
+    enum class RequestState
+    {
+        //
+        // Driver-created, not sent or back from the target
+        // 
+        Idle,
+        Queued,
+        DriverOwned,
+        Sent,
+        Completed
+    };
+
+    struct SimRequest : SimObject
+    {
+        SimRequest() : SimObject(ObjectType::Request) {}
+        ~SimRequest() override
+        {
+            if (IsSystemBufferOwned)
+            {
+                free(SystemBuffer);
+            }
+        }
+
+        bool IsFromIoManager = false;
+        RequestState State = RequestState::Idle;
+
+        //
+        // As received from the I/O manager
+        // 
+        WDF_REQUEST_PARAMETERS Params{};
+        PVOID SystemBuffer = nullptr;
+        bool IsSystemBufferOwned = false;
+        MDL OutputMdl{};
+        bool HasOutputMdl = false;
+        PVOID UserOutput = nullptr;
+
+        //
+        // As formatted for an I/O target
+        // 
+        SimIoTarget* FormattedTarget = nullptr;
+        ULONG FormattedIoctl = 0;
+        bool IsFormattedInternal = false;
+        SimMemory* FormattedInput = nullptr;
+        SimIoTarget* SentTarget = nullptr;
+
+        PFN_WDF_REQUEST_COMPLETION_ROUTINE EvtCompletion = nullptr;
+        WDFCONTEXT CompletionContext = nullptr;
+
+        SimQueue* Queue = nullptr;
+        SimQueue* PresentedBy = nullptr;
+
+        PFN_WDF_REQUEST_CANCEL EvtCancel = nullptr;
+        bool IsCanceled = false;
+
+        NTSTATUS Status = STATUS_SUCCESS;
+        ULONG_PTR Information = 0;
+
+        //
+        // Client side bookkeeping
+        // 
+        ULONG64 Identifier = 0;
+        SIM_IO_COMPLETION* EvtIoCompletion = nullptr;
+        PVOID IoCompletionContext = nullptr;
+        SIM_IO_RESULT Result{};
+        ULONG64 IssueHostNs = 0;
+        ULONG64 TargetCompletionHostNs = 0;
+        bool IsSubmitMeasured = false;
+    };
+
+    struct SimSpinLock : SimObject
+    {
+        explicit SimSpinLock(ObjectType type) : SimObject(type) {}
+
+        bool IsHeld = false;
+    };
+
+    struct SimCollection : SimObject
+    {
+        SimCollection() : SimObject(ObjectType::Collection) {}
+
+        std::vector<WDFOBJECT> Items;
+    };
+
+    struct SimWorkItem : SimObject
+    {
+        SimWorkItem() : SimObject(ObjectType::WorkItem) {}
+
+        PFN_WDF_WORKITEM EvtWorkItem = nullptr;
+        bool IsEnqueued = false;
+    };
+
+    struct SimDmfModule : SimObject
+    {
+        SimDmfModule() : SimObject(ObjectType::DmfModule) {}
+
+        SimDevice* Device = nullptr;
+        const IoctlHandler_IoctlRecord* IoctlRecords = nullptr;
+        ULONG IoctlRecordCount = 0;
+    };
+
+    struct SimEvent
+    {
+        ULONG64 Time;
+        ULONG64 Sequence;
+        SIM_EVENT_CALLBACK* Callback;
+        PVOID Context;
+
+        bool operator>(const SimEvent& Other) const
+        {
+            return Time != Other.Time ? Time > Other.Time : Sequence > Other.Sequence;
+        }
+    };
+
+    struct SimState
+    {
+        ULONG64 Now = 0;
+        ULONG64 NextSequence = 0;
+        std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>> Events;
+
+        ULONG64 NextSerial = 0;
+        std::unordered_map<ULONG64, SimObject*> Objects;
+
+        ULONG64 NextIoIdentifier = 0;
+        std::unordered_map<ULONG64, SimRequest*> PendingIo;
+
+        std::map<std::wstring, ULONG> Registry;
+
+        SimObject* Driver = nullptr;
+
+        KIRQL Irql = PASSIVE_LEVEL;
+
+        SIM_COUNTERS Counters{};
+    };
+
+    SimState& State()
+    {
+        static SimState state;
+        return state;
+    }
+
+    template <typename T>
+    T* FromHandle(PVOID Handle, ObjectType Type)
+    {
+        auto* object = static_cast<SimObject*>(Handle);
+        assert(object != nullptr && object->Type == Type);
+        (void)Type;
+        return static_cast<T*>(object);
+    }
+
+    template <typename THandle>
+    THandle ToHandle(SimObject* Object)
+    {
+        return reinterpret_cast<THandle>(Object);
+    }
+
+    void AttachContext(
+        SimObject* Object,
+        PWDF_OBJECT_ATTRIBUTES Attributes
+    )
+    {
+        const size_t size = Attributes->ContextSizeOverride != 0
+            ? Attributes->ContextSizeOverride
+            : Attributes->ContextTypeInfo->ContextSize;
+        auto* header = static_cast<ContextHeader*>(calloc(1, sizeof(ContextHeader) + size));
+
+        assert(header != nullptr);
+
+        header->Owner = Object;
+        header->Type = Attributes->ContextTypeInfo;
+        header->EvtCleanup = Attributes->EvtCleanupCallback;
+        header->EvtDestroy = Attributes->EvtDestroyCallback;
+
+        Object->Contexts.push_back(header);
+    }
+
+    void SetParent(SimObject* Object, SimObject* Parent)
+    {
+        Object->Parent = Parent;
+
+        if (Parent != nullptr)
+        {
+            Parent->Children.push_back(Object);
+        }
+    }
+
+    //
+    // Registers a new object, applying parent, context and callbacks
+    // 
+    template <typename T>
+    T* Track(T* Object, PWDF_OBJECT_ATTRIBUTES Attributes, SimObject* DefaultParent = nullptr)
+    {
+        auto& state = State();
+
+        Object->Serial = ++state.NextSerial;
+        state.Objects.emplace(Object->Serial, Object);
+        state.Counters.LiveObjects++;
+
+        SimObject* parent = DefaultParent;
+
+        if (Attributes != nullptr)
+        {
+            if (Attributes->ParentObject != nullptr)
+            {
+                parent = static_cast<SimObject*>(Attributes->ParentObject);
+            }
+
+            if (Attributes->ContextTypeInfo != nullptr)
+            {
+                AttachContext(Object, Attributes);
+            }
+            else
+            {
+                Object->EvtCleanup = Attributes->EvtCleanupCallback;
+                Object->EvtDestroy = Attributes->EvtDestroyCallback;
+            }
+        }
+
+        SetParent(Object, parent);
+
+        return Object;
+    }
+
+    SimObject* Lookup(ULONG64 Serial)
+    {
+        auto& objects = State().Objects;
+        const auto it = objects.find(Serial);
+
+        return it != objects.end() ? it->second : nullptr;
+    }
+
+    void DeleteObject(SimObject* Object)
+    {
+        if (Object->IsDeleting)
+        {
+            return;
+        }
+
+        Object->IsDeleting = true;
+
+        //
+        // Children go first, the youngest one leading
+        // 
+        while (!Object->Children.empty())
+        {
+            DeleteObject(Object->Children.back());
+        }
+
+        const WDFOBJECT handle = Object;
+
+        for (const auto* context : Object->Contexts)
+        {
+            if (context->EvtCleanup != nullptr)
+            {
+                context->EvtCleanup(handle);
+            }
+        }
+
+        if (Object->EvtCleanup != nullptr)
+        {
+            Object->EvtCleanup(handle);
+        }
+
+        for (const auto* context : Object->Contexts)
+        {
+            if (context->EvtDestroy != nullptr)
+            {
+                context->EvtDestroy(handle);
+            }
+        }
+
+        if (Object->EvtDestroy != nullptr)
+        {
+            Object->EvtDestroy(handle);
+        }
+
+        if (Object->Parent != nullptr)
+        {
+            auto& siblings = Object->Parent->Children;
+            siblings.erase(std::find(siblings.begin(), siblings.end(), Object));
+        }
+
+        for (auto* context : Object->Contexts)
+        {
+            free(context);
+        }
+
+        auto& state = State();
+
+        state.Objects.erase(Object->Serial);
+        state.Counters.LiveObjects--;
+
+        delete Object;
+    }
+
+    ULONG64 HostNanoseconds()
+    {
+        return static_cast<ULONG64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void PostSerial(ULONG64 Delay, SIM_EVENT_CALLBACK* Callback, ULONG64 Serial)
+    {
+        SimPost(Delay, Callback, reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(Serial)));
+    }
+
+    ULONG64 SerialOf(PVOID Context)
+    {
+        return static_cast<ULONG64>(reinterpret_cast<ULONG_PTR>(Context));
+    }
+
+    void DispatchQueue(SimQueue* Queue);
+
+    void EvtDeferredDispatch(PVOID Context)
+    {
+        auto* object = Lookup(SerialOf(Context));
+
+        if (object != nullptr)
+        {
+            auto* queue = static_cast<SimQueue*>(object);
+
+            queue->IsDispatchPosted = false;
+            DispatchQueue(queue);
+        }
+    }
+
+    void PostDispatch(SimQueue* Queue)
+    {
+        if (!Queue->IsDispatchPosted)
+        {
+            Queue->IsDispatchPosted = true;
+            PostSerial(0, EvtDeferredDispatch, Queue->Serial);
+        }
+    }
+
+    void NotifyReady(SimQueue* Queue)
+    {
+        if (Queue->IsInReady)
+        {
+            Queue->IsReadyAgain = true;
+            return;
+        }
+
+        Queue->IsInReady = true;
+
+        do
+        {
+            Queue->IsReadyAgain = false;
+            Queue->EvtReady(ToHandle<WDFQUEUE>(Queue), Queue->ReadyContext);
+        } while (Queue->IsReadyAgain && !Queue->Pending.empty());
+
+        Queue->IsInReady = false;
+    }
+
+    void EvtDeferredReady(PVOID Context)
+    {
+        auto* object = Lookup(SerialOf(Context));
+
+        if (object != nullptr)
+        {
+            auto* queue = static_cast<SimQueue*>(object);
+
+            if (queue->EvtReady != nullptr && !queue->Pending.empty())
+            {
+                NotifyReady(queue);
+            }
+        }
+    }
+
+    void PresentRequest(SimQueue* Queue, SimRequest* Request)
+    {
+        Request->State = RequestState::DriverOwned;
+        Request->Queue = nullptr;
+        Request->PresentedBy = Queue;
+        Queue->DriverOwned++;
+    }
+
+    void DispatchIoctlHandler(SimDmfModule* Module, SimQueue* Queue, SimRequest* Request);
+
+    //
+    // Presents requests to the driver as far as the dispatch type allows
+    // 
+    void DispatchQueue(SimQueue* Queue)
+    {
+        if (Queue->IsInDispatch)
+        {
+            return;
+        }
+
+        Queue->IsInDispatch = true;
+
+        while (!Queue->Pending.empty())
+        {
+            if (Queue->DispatchType == WdfIoQueueDispatchSequential && Queue->DriverOwned != 0)
+            {
+                break;
+            }
+
+            SimRequest* request = Queue->Pending.front();
+            Queue->Pending.pop_front();
+            PresentRequest(Queue, request);
+
+            if (Queue == Queue->Device->DefaultQueue && Queue->Device->IoctlHandler != nullptr)
+            {
+                DispatchIoctlHandler(Queue->Device->IoctlHandler, Queue, request);
+            }
+            else
+            {
+                Queue->EvtIoDeviceControl(
+                    ToHandle<WDFQUEUE>(Queue),
+                    ToHandle<WDFREQUEST>(request),
+                    request->Params.Parameters.DeviceIoControl.OutputBufferLength,
+                    request->Params.Parameters.DeviceIoControl.InputBufferLength,
+                    request->Params.Parameters.DeviceIoControl.IoControlCode
+                );
+            }
+        }
+
+        Queue->IsInDispatch = false;
+    }
+
+    void EnqueueRequest(SimQueue* Queue, SimRequest* Request)
+    {
+        const bool wasEmpty = Queue->Pending.empty();
+
+        Request->State = RequestState::Queued;
+        Request->Queue = Queue;
+        Queue->Pending.push_back(Request);
+
+        if (Queue->DispatchType == WdfIoQueueDispatchManual)
+        {
+            if (wasEmpty && Queue->EvtReady != nullptr)
+            {
+                NotifyReady(Queue);
+            }
+            return;
+        }
+
+        DispatchQueue(Queue);
+    }
+
+    //
+    // Driver gives up ownership of a request it got presented
+    // 
+    void ReleaseOwnership(SimRequest* Request)
+    {
+        SimQueue* queue = Request->PresentedBy;
+
+        if (queue == nullptr)
+        {
+            return;
+        }
+
+        assert(queue->DriverOwned > 0);
+        queue->DriverOwned--;
+
+        //
+        // Next one goes out after the completing code unwound
+        // 
+        if (queue->DispatchType == WdfIoQueueDispatchSequential && !queue->Pending.empty())
+        {
+            PostDispatch(queue);
+        }
+    }
+
+    void CompleteRequest(SimRequest* Request, NTSTATUS Status, ULONG_PTR Information)
+    {
+        auto& state = State();
+
+        assert(Request->IsFromIoManager);
+        assert(Request->State == RequestState::DriverOwned || Request->State == RequestState::Queued);
+
+        if (Request->State == RequestState::Queued)
+        {
+            auto& pending = Request->Queue->Pending;
+            pending.erase(std::find(pending.begin(), pending.end(), Request));
+            Request->Queue = nullptr;
+        }
+        else
+        {
+            ReleaseOwnership(Request);
+        }
+
+        Request->State = RequestState::Completed;
+        Request->EvtCancel = nullptr;
+
+        SIM_IO_RESULT result = Request->Result;
+
+        result.Status = Status;
+        result.Information = Information;
+        result.CompletionTime = state.Now;
+
+        //
+        // I/O manager copies the system buffer back for buffered requests
+        // 
+        const ULONG method = METHOD_FROM_CTL_CODE(Request->Params.Parameters.DeviceIoControl.IoControlCode);
+        const size_t outputLength = Request->Params.Parameters.DeviceIoControl.OutputBufferLength;
+
+        if (method == METHOD_BUFFERED && NT_SUCCESS(Status) && outputLength != 0 && Information != 0)
+        {
+            const size_t copy = std::min<size_t>(Information, outputLength);
+
+            memcpy(Request->UserOutput, Request->SystemBuffer, copy);
+            state.Counters.IoManagerBytesCopied += copy;
+        }
+
+        const ULONG64 now = HostNanoseconds();
+
+        if (!Request->IsSubmitMeasured)
+        {
+            result.SubmitNanoseconds = now - Request->IssueHostNs;
+        }
+
+        if (Request->TargetCompletionHostNs != 0)
+        {
+            result.CompletionNanoseconds = now - Request->TargetCompletionHostNs;
+        }
+
+        SIM_IO_COMPLETION* completion = Request->EvtIoCompletion;
+        PVOID context = Request->IoCompletionContext;
+
+        state.PendingIo.erase(Request->Identifier);
+        state.Counters.RequestsCompleted++;
+
+        DeleteObject(Request);
+
+        completion(context, &result);
+    }
+
+    NTSTATUS RetrieveInput(SimRequest* Request, size_t Minimum, PVOID* Buffer, size_t* Length)
+    {
+        const size_t length = Request->Params.Parameters.DeviceIoControl.InputBufferLength;
+
+        if (length == 0 || Request->SystemBuffer == nullptr)
+        {
+            return STATUS_INVALID_DEVICE_REQUEST;
+        }
+
+        if (length < Minimum)
+        {
+            return STATUS_BUFFER_TOO_SMALL;
+        }
+
+        *Buffer = Request->SystemBuffer;
+
+        if (Length != nullptr)
+        {
+            *Length = length;
+        }
+
+        return STATUS_SUCCESS;
+    }
+
+    NTSTATUS RetrieveOutput(SimRequest* Request, size_t Minimum, PVOID* Buffer, size_t* Length)
+    {
+        const size_t length = Request->Params.Parameters.DeviceIoControl.OutputBufferLength;
+
+        if (length == 0)
+        {
+            return STATUS_INVALID_DEVICE_REQUEST;
+        }
+
+        if (length < Minimum)
+        {
+            return STATUS_BUFFER_TOO_SMALL;
+        }
+
+        *Buffer = Request->HasOutputMdl ? Request->OutputMdl.MappedSystemVa : Request->SystemBuffer;
+
+        if (Length != nullptr)
+        {
+            *Length = length;
+        }
+
+        return STATUS_SUCCESS;
+    }
+
+    //
+    // DMF IoctlHandler: table lookup, minimum sizes, then the handler
+    // 
+    void DispatchIoctlHandler(SimDmfModule* Module, SimQueue* Queue, SimRequest* Request)
+    {
+        const ULONG ioctlCode = Request->Params.Parameters.DeviceIoControl.IoControlCode;
+        const IoctlHandler_IoctlRecord* record = nullptr;
+
+        for (ULONG index = 0; index < Module->IoctlRecordCount; index++)
+        {
+            if (Module->IoctlRecords[index].IoctlCode == ioctlCode)
+            {
+                record = &Module->IoctlRecords[index];
+                break;
+            }
+        }
+
+        if (record == nullptr)
+        {
+            CompleteRequest(Request, STATUS_NOT_SUPPORTED, 0);
+            return;
+        }
+
+        NTSTATUS status = STATUS_SUCCESS;
+        PVOID inputBuffer = nullptr;
+        size_t inputBufferSize = 0;
+        PVOID outputBuffer = nullptr;
+        size_t outputBufferSize = 0;
+        size_t bytesReturned = 0;
+
+        if (record->InputBufferMinimumSize > 0)
+        {
+            status = RetrieveInput(Request, record->InputBufferMinimumSize, &inputBuffer, &inputBufferSize);
+        }
+
+        if (NT_SUCCESS(status) && record->OutputBufferMinimumSize > 0)
+        {
+            status = RetrieveOutput(Request, record->OutputBufferMinimumSize, &outputBuffer, &outputBufferSize);
+        }
+
+        if (!NT_SUCCESS(status))
+        {
+            CompleteRequest(Request, status, 0);
+            return;
+        }
+
+        //
+        // Request may be gone once the handler returned pending
+        // 
+        status = record->EvtIoctlHandlerFunction(
+            ToHandle<DMFMODULE>(Module),
+            ToHandle<WDFQUEUE>(Queue),
+            ToHandle<WDFREQUEST>(Request),
+            ioctlCode,
+            inputBuffer,
+            inputBufferSize,
+            outputBuffer,
+            outputBufferSize,
+            &bytesReturned
+        );
+
+        if (status != STATUS_PENDING)
+        {
+            CompleteRequest(Request, status, NT_SUCCESS(status) ? bytesReturned : 0);
+        }
+    }
+
+    void EvtWorkItemRun(PVOID Context)
+    {
+        auto* object = Lookup(SerialOf(Context));
+
+        if (object != nullptr)
+        {
+            auto* workItem = static_cast<SimWorkItem*>(object);
+
+            workItem->IsEnqueued = false;
+            workItem->EvtWorkItem(ToHandle<WDFWORKITEM>(workItem));
+        }
+    }
+
+    std::wstring FromUnicodeString(PCUNICODE_STRING String)
+    {
+        return std::wstring(String->Buffer, String->Length / sizeof(WCHAR));
+    }
+}
+
+struct WDFDEVICE_INIT
+{
+    PFN_WDF_DEVICE_SELF_MANAGED_IO_INIT EvtSelfManagedIoInit;
+};
+
+#pragma region Clock and events
+
+ULONG64
+SimNow(
+    VOID
+)
+{
+    return State().Now;
+}
+
+ULONG64
+SimHostNanoseconds(
+    VOID
+)
+{
+    return HostNanoseconds();
+}
+
+VOID
+SimPost(
+    _In_ ULONG64 Delay,
+    _In_ SIM_EVENT_CALLBACK* Callback,
+    _In_opt_ PVOID Context
+)
+{
+    auto& state = State();
+
+    state.Events.push(SimEvent{ state.Now + Delay, state.NextSequence++, Callback, Context });
+}
+
+VOID
+SimRunUntil(
+    _In_ ULONG64 Time
+)
+{
+    auto& state = State();
+
+    while (!state.Events.empty() && state.Events.top().Time <= Time)
+    {
+        const SimEvent event = state.Events.top();
+
+        state.Events.pop();
+        state.Now = event.Time;
+        event.Callback(event.Context);
+    }
+
+    state.Now = std::max(state.Now, Time);
+}
+
+BOOLEAN
+SimRunUntilIdle(
+    _In_ ULONG64 MaxEvents
+)
+{
+    auto& state = State();
+
+    for (ULONG64 count = 0; count < MaxEvents; count++)
+    {
+        if (state.Events.empty())
+        {
+            return TRUE;
+        }
+
+        const SimEvent event = state.Events.top();
+
+        state.Events.pop();
+        state.Now = event.Time;
+        event.Callback(event.Context);
+    }
+
+    return state.Events.empty();
+}
+
+VOID
+SimReset(
+    VOID
+)
+{
+    auto& state = State();
+
+    state.Events = decltype(state.Events)();
+
+    //
+    // Roots take their descendants with them
+    // 
+    std::vector<SimObject*> roots;
+
+    for (const auto& entry : state.Objects)
+    {
+        if (entry.second->Parent == nullptr)
+        {
+            roots.push_back(entry.second);
+        }
+    }
+
+    std::sort(roots.begin(), roots.end(), [](const SimObject* a, const SimObject* b)
+    {
+        return a->Serial > b->Serial;
+    });
+
+    for (auto* root : roots)
+    {
+        DeleteObject(root);
+    }
+
+    state.Events = decltype(state.Events)();
+    state.PendingIo.clear();
+    state.Registry.clear();
+    state.Driver = nullptr;
+    state.Now = 0;
+    state.NextSequence = 0;
+    state.Irql = PASSIVE_LEVEL;
+    state.Counters = SIM_COUNTERS{};
+}
+
+#pragma endregion
+
+#pragma region Counters
+
+VOID
+SimGetCounters(
+    _Out_ PSIM_COUNTERS Counters
+)
+{
+    *Counters = State().Counters;
+}
+
+VOID
+SimCountBrbAllocation(
+    _In_ BOOLEAN IsFree
+)
+{
+    auto& counters = State().Counters;
+
+    if (IsFree)
+    {
+        counters.BrbFrees++;
+    }
+    else
+    {
+        counters.BrbAllocations++;
+    }
+}
+
+#pragma endregion
+
+#pragma region Registry
+
+VOID
+SimRegistrySetULong(
+    _In_ const WCHAR* Name,
+    _In_ ULONG Value
+)
+{
+    State().Registry[Name] = Value;
+}
+
+WDFDRIVER
+WdfGetDriver(
+    VOID
+)
+{
+    auto& state = State();
+
+    if (state.Driver == nullptr)
+    {
+        state.Driver = Track(new SimObject(ObjectType::Driver), nullptr);
+    }
+
+    return ToHandle<WDFDRIVER>(state.Driver);
+}
+
+NTSTATUS
+WdfDriverOpenParametersRegistryKey(
+    _In_ WDFDRIVER Driver,
+    _In_ ACCESS_MASK DesiredAccess,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES KeyAttributes,
+    _Out_ WDFKEY* Key
+)
+{
+    UNREFERENCED_PARAMETER(DesiredAccess);
+
+    *Key = ToHandle<WDFKEY>(Track(new SimObject(ObjectType::Key), KeyAttributes, reinterpret_cast<SimObject*>(Driver)));
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRegistryQueryULong(
+    _In_ WDFKEY Key,
+    _In_ PCUNICODE_STRING ValueName,
+    _Out_ PULONG Value
+)
+{
+    UNREFERENCED_PARAMETER(Key);
+
+    const auto& registry = State().Registry;
+    const auto it = registry.find(FromUnicodeString(ValueName));
+
+    if (it == registry.end())
+    {
+        return STATUS_OBJECT_NAME_NOT_FOUND;
+    }
+
+    *Value = it->second;
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+WdfRegistryClose(
+    _In_ WDFKEY Key
+)
+{
+    DeleteObject(FromHandle<SimObject>(Key, ObjectType::Key));
+}
+
+#pragma endregion
+
+#pragma region Objects and contexts
+
+PVOID
+WdfObjectGetTypedContextWorker(
+    _In_ WDFOBJECT Handle,
+    _In_ PCWDF_OBJECT_CONTEXT_TYPE_INFO TypeInfo
+)
+{
+    const auto* object = static_cast<SimObject*>(Handle);
+
+    for (auto* context : object->Contexts)
+    {
+        if (context->Type == TypeInfo
+            || context->Type->UniqueType == TypeInfo->UniqueType
+            || strcmp(context->Type->ContextName, TypeInfo->ContextName) == 0)
+        {
+            return context + 1;
+        }
+    }
+
+    return nullptr;
+}
+
+NTSTATUS
+WdfObjectAllocateContext(
+    _In_ WDFOBJECT Handle,
+    _In_ PWDF_OBJECT_ATTRIBUTES ContextAttributes,
+    _Outptr_opt_ PVOID* Context
+)
+{
+    auto* object = static_cast<SimObject*>(Handle);
+
+    if (WdfObjectGetTypedContextWorker(Handle, ContextAttributes->ContextTypeInfo) != nullptr)
+    {
+        return STATUS_OBJECT_NAME_COLLISION;
+    }
+
+    AttachContext(object, ContextAttributes);
+
+    if (Context != nullptr)
+    {
+        *Context = object->Contexts.back() + 1;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+WDFOBJECT
+WdfObjectContextGetObject(
+    _In_ PVOID ContextPointer
+)
+{
+    return (static_cast<ContextHeader*>(ContextPointer) - 1)->Owner;
+}
+
+VOID
+WdfObjectDelete(
+    _In_ WDFOBJECT Object
+)
+{
+    auto* object = static_cast<SimObject*>(Object);
+
+    //
+    // Requests the framework delivered are deleted by completing them
+    // 
+    assert(object->Type != ObjectType::Request || !static_cast<SimRequest*>(object)->IsFromIoManager);
+    assert(object->Type != ObjectType::Request || static_cast<SimRequest*>(object)->State != RequestState::Sent);
+
+    DeleteObject(object);
+}
+
+#pragma endregion
+
+#pragma region Device
+
+PWDFDEVICE_INIT
+SimDeviceInitAllocate(
+    VOID
+)
+{
+    return new WDFDEVICE_INIT{};
+}
+
+VOID
+WdfDeviceInitFree(
+    _In_ PWDFDEVICE_INIT DeviceInit
+)
+{
+    delete DeviceInit;
+}
+
+NTSTATUS
+SimDeviceCreate(
+    _Inout_opt_ PWDFDEVICE_INIT* DeviceInit,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _Out_ WDFDEVICE* Device
+)
+{
+    auto* device = Track(new SimDevice(), Attributes);
+
+    if (DeviceInit != nullptr && *DeviceInit != nullptr)
+    {
+        device->EvtSelfManagedIoInit = (*DeviceInit)->EvtSelfManagedIoInit;
+
+        delete *DeviceInit;
+        *DeviceInit = nullptr;
+    }
+
+    *Device = ToHandle<WDFDEVICE>(device);
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+SimDeviceStart(
+    _In_ WDFDEVICE Device
+)
+{
+    const auto* device = FromHandle<SimDevice>(Device, ObjectType::Device);
+
+    return device->EvtSelfManagedIoInit != nullptr
+        ? device->EvtSelfManagedIoInit(Device)
+        : STATUS_SUCCESS;
+}
+
+ULONG
+SimDeviceGetIdleTimeout(
+    _In_ WDFDEVICE Device
+)
+{
+    return FromHandle<SimDevice>(Device, ObjectType::Device)->IdleTimeout;
+}
+
+NTSTATUS
+SimDmfIoctlHandlerCreate(
+    _In_ WDFDEVICE Device,
+    _In_reads_(IoctlRecordCount) const IoctlHandler_IoctlRecord* IoctlRecords,
+    _In_ ULONG IoctlRecordCount,
+    _Out_ DMFMODULE* Module
+)
+{
+    auto* device = FromHandle<SimDevice>(Device, ObjectType::Device);
+    auto* module = Track(new SimDmfModule(), nullptr, device);
+    WDF_IO_QUEUE_CONFIG queueConfig;
+    WDFQUEUE queue;
+
+    module->Device = device;
+    module->IoctlRecords = IoctlRecords;
+    module->IoctlRecordCount = IoctlRecordCount;
+    device->IoctlHandler = module;
+
+    //
+    // DMF owns the default queue and routes it through the table
+    // 
+    WDF_IO_QUEUE_CONFIG_INIT(&queueConfig, WdfIoQueueDispatchParallel);
+    queueConfig.DefaultQueue = TRUE;
+
+    const NTSTATUS status = WdfIoQueueCreate(Device, &queueConfig, WDF_NO_OBJECT_ATTRIBUTES, &queue);
+
+    *Module = ToHandle<DMFMODULE>(module);
+
+    return status;
+}
+
+WDFDEVICE
+DMF_ParentDeviceGet(
+    _In_ DMFMODULE DmfModule
+)
+{
+    return ToHandle<WDFDEVICE>(FromHandle<SimDmfModule>(DmfModule, ObjectType::DmfModule)->Device);
+}
+
+const UNICODE_STRING SDDL_DEVOBJ_SYS_ALL_ADM_ALL =
+    RTL_CONSTANT_STRING(L"D:P(A;;GA;;;SY)(A;;GA;;;BA)");
+
+const UNICODE_STRING SDDL_DEVOBJ_SYS_ALL_ADM_RWX_WORLD_RWX_RES_RWX =
+    RTL_CONSTANT_STRING(L"D:P(A;;GA;;;SY)(A;;GRGWGX;;;BA)(A;;GRGWGX;;;WD)(A;;GRGWGX;;;RC)");
+
+VOID
+WdfDeviceInitSetDeviceType(
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_ DEVICE_TYPE DeviceType
+)
+{
+    UNREFERENCED_PARAMETER(DeviceInit);
+    UNREFERENCED_PARAMETER(DeviceType);
+}
+
+VOID
+WdfPdoInitAllowForwardingRequestToParent(
+    _In_ PWDFDEVICE_INIT DeviceInit
+)
+{
+    UNREFERENCED_PARAMETER(DeviceInit);
+}
+
+VOID
+WdfDeviceInitSetPnpPowerEventCallbacks(
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_ PWDF_PNPPOWER_EVENT_CALLBACKS PnpPowerEventCallbacks
+)
+{
+    DeviceInit->EvtSelfManagedIoInit = PnpPowerEventCallbacks->EvtDeviceSelfManagedIoInit;
+}
+
+VOID
+WdfDeviceInitSetExclusive(
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_ BOOLEAN IsExclusive
+)
+{
+    UNREFERENCED_PARAMETER(DeviceInit);
+    UNREFERENCED_PARAMETER(IsExclusive);
+}
+
+NTSTATUS
+WdfDeviceInitAssignSDDLString(
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_opt_ PCUNICODE_STRING SDDLString
+)
+{
+    UNREFERENCED_PARAMETER(DeviceInit);
+    UNREFERENCED_PARAMETER(SDDLString);
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+WdfDeviceSetPnpCapabilities(
+    _In_ WDFDEVICE Device,
+    _In_ PWDF_DEVICE_PNP_CAPABILITIES PnpCapabilities
+)
+{
+    UNREFERENCED_PARAMETER(Device);
+    UNREFERENCED_PARAMETER(PnpCapabilities);
+}
+
+NTSTATUS
+WdfDeviceAssignS0IdleSettings(
+    _In_ WDFDEVICE Device,
+    _In_ PWDF_DEVICE_POWER_POLICY_IDLE_SETTINGS Settings
+)
+{
+    FromHandle<SimDevice>(Device, ObjectType::Device)->IdleTimeout = Settings->IdleTimeout;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfDeviceWdmDispatchPreprocessedIrp(
+    _In_ WDFDEVICE Device,
+    _In_ PIRP Irp
+)
+{
+    UNREFERENCED_PARAMETER(Device);
+    UNREFERENCED_PARAMETER(Irp);
+
+    return STATUS_NOT_SUPPORTED;
+}
+
+VOID
+IofCompleteRequest(
+    _In_ PIRP Irp,
+    _In_ CCHAR PriorityBoost
+)
+{
+    UNREFERENCED_PARAMETER(Irp);
+    UNREFERENCED_PARAMETER(PriorityBoost);
+}
+
+#pragma endregion
+
+#pragma region Memory
+
+NTSTATUS
+WdfMemoryCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ POOL_TYPE PoolType,
+    _In_opt_ ULONG PoolTag,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY* Memory,
+    _Outptr_opt_result_bytebuffer_(BufferSize) PVOID* Buffer
+)
+{
+    UNREFERENCED_PARAMETER(PoolType);
+    UNREFERENCED_PARAMETER(PoolTag);
+
+    auto& counters = State().Counters;
+    PVOID buffer = malloc(BufferSize != 0 ? BufferSize : 1);
+
+    if (buffer == nullptr)
+    {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    auto* memory = Track(new SimMemory(), Attributes);
+
+    memory->Buffer = buffer;
+    memory->Size = BufferSize;
+    memory->IsOwned = true;
+
+    counters.MemoryAllocations++;
+    counters.MemoryBytes += BufferSize;
+
+    *Memory = ToHandle<WDFMEMORY>(memory);
+
+    if (Buffer != nullptr)
+    {
+        *Buffer = buffer;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfMemoryCreatePreallocated(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ PVOID Buffer,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY* Memory
+)
+{
+    auto* memory = Track(new SimMemory(), Attributes);
+
+    memory->Buffer = Buffer;
+    memory->Size = BufferSize;
+
+    State().Counters.PreallocatedMemoryObjects++;
+
+    *Memory = ToHandle<WDFMEMORY>(memory);
+
+    return STATUS_SUCCESS;
+}
+
+PVOID
+WdfMemoryGetBuffer(
+    _In_ WDFMEMORY Memory,
+    _Out_opt_ size_t* BufferSize
+)
+{
+    const auto* memory = FromHandle<SimMemory>(Memory, ObjectType::Memory);
+
+    if (BufferSize != nullptr)
+    {
+        *BufferSize = memory->Size;
+    }
+
+    return memory->Buffer;
+}
+
+#pragma endregion
+
+#pragma region Synchronization
+
+NTSTATUS
+WdfSpinLockCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES SpinLockAttributes,
+    _Out_ WDFSPINLOCK* SpinLock
+)
+{
+    *SpinLock = ToHandle<WDFSPINLOCK>(Track(new SimSpinLock(ObjectType::SpinLock), SpinLockAttributes));
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Nothing runs concurrently, a lock taken twice is a recursion bug
+// 
+VOID
+WdfSpinLockAcquire(
+    _In_ WDFSPINLOCK SpinLock
+)
+{
+    auto* lock = FromHandle<SimSpinLock>(SpinLock, ObjectType::SpinLock);
+
+    assert(!lock->IsHeld);
+    lock->IsHeld = true;
+}
+
+VOID
+WdfSpinLockRelease(
+    _In_ WDFSPINLOCK SpinLock
+)
+{
+    auto* lock = FromHandle<SimSpinLock>(SpinLock, ObjectType::SpinLock);
+
+    assert(lock->IsHeld);
+    lock->IsHeld = false;
+}
+
+NTSTATUS
+WdfWaitLockCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES LockAttributes,
+    _Out_ WDFWAITLOCK* Lock
+)
+{
+    *Lock = ToHandle<WDFWAITLOCK>(Track(new SimSpinLock(ObjectType::WaitLock), LockAttributes));
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfWaitLockAcquire(
+    _In_ WDFWAITLOCK Lock,
+    _In_opt_ PLONGLONG Timeout
+)
+{
+    UNREFERENCED_PARAMETER(Timeout);
+
+    auto* lock = FromHandle<SimSpinLock>(Lock, ObjectType::WaitLock);
+
+    assert(!lock->IsHeld);
+    lock->IsHeld = true;
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+WdfWaitLockRelease(
+    _In_ WDFWAITLOCK Lock
+)
+{
+    auto* lock = FromHandle<SimSpinLock>(Lock, ObjectType::WaitLock);
+
+    assert(lock->IsHeld);
+    lock->IsHeld = false;
+}
+
+#pragma endregion
+
+#pragma region Collections
+
+NTSTATUS
+WdfCollectionCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES CollectionAttributes,
+    _Out_ WDFCOLLECTION* Collection
+)
+{
+    *Collection = ToHandle<WDFCOLLECTION>(Track(new SimCollection(), CollectionAttributes));
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfCollectionAdd(
+    _In_ WDFCOLLECTION Collection,
+    _In_ WDFOBJECT Object
+)
+{
+    FromHandle<SimCollection>(Collection, ObjectType::Collection)->Items.push_back(Object);
+
+    return STATUS_SUCCESS;
+}
+
+ULONG
+WdfCollectionGetCount(
+    _In_ WDFCOLLECTION Collection
+)
+{
+    return static_cast<ULONG>(FromHandle<SimCollection>(Collection, ObjectType::Collection)->Items.size());
+}
+
+WDFOBJECT
+WdfCollectionGetItem(
+    _In_ WDFCOLLECTION Collection,
+    _In_ ULONG Index
+)
+{
+    const auto& items = FromHandle<SimCollection>(Collection, ObjectType::Collection)->Items;
+
+    return Index < items.size() ? items[Index] : nullptr;
+}
+
+VOID
+WdfCollectionRemove(
+    _In_ WDFCOLLECTION Collection,
+    _In_ WDFOBJECT Item
+)
+{
+    auto& items = FromHandle<SimCollection>(Collection, ObjectType::Collection)->Items;
+
+    items.erase(std::find(items.begin(), items.end(), Item));
+}
+
+VOID
+WdfCollectionRemoveItem(
+    _In_ WDFCOLLECTION Collection,
+    _In_ ULONG Index
+)
+{
+    auto& items = FromHandle<SimCollection>(Collection, ObjectType::Collection)->Items;
+
+    items.erase(items.begin() + Index);
+}
+
+#pragma endregion
+
+#pragma region Work items
+
+NTSTATUS
+WdfWorkItemCreate(
+    _In_ PWDF_WORKITEM_CONFIG Config,
+    _In_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _Out_ WDFWORKITEM* WorkItem
+)
+{
+    if (Attributes == nullptr || Attributes->ParentObject == nullptr)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    auto* workItem = Track(new SimWorkItem(), Attributes);
+
+    workItem->EvtWorkItem = Config->EvtWorkItemFunc;
+
+    *WorkItem = ToHandle<WDFWORKITEM>(workItem);
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Runs on the next turn of the event loop, enqueueing twice runs it once
+// 
+VOID
+WdfWorkItemEnqueue(
+    _In_ WDFWORKITEM WorkItem
+)
+{
+    auto* workItem = FromHandle<SimWorkItem>(WorkItem, ObjectType::WorkItem);
+
+    if (!workItem->IsEnqueued)
+    {
+        workItem->IsEnqueued = true;
+        PostSerial(0, EvtWorkItemRun, workItem->Serial);
+    }
+}
+
+WDFOBJECT
+WdfWorkItemGetParentObject(
+    _In_ WDFWORKITEM WorkItem
+)
+{
+    return FromHandle<SimWorkItem>(WorkItem, ObjectType::WorkItem)->Parent;
+}
+
+#pragma endregion
+
+#pragma region Queues
+
+NTSTATUS
+WdfIoQueueCreate(
+    _In_ WDFDEVICE Device,
+    _In_ PWDF_IO_QUEUE_CONFIG Config,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES QueueAttributes,
+    _Out_opt_ WDFQUEUE* Queue
+)
+{
+    auto* device = FromHandle<SimDevice>(Device, ObjectType::Device);
+
+    if (Config->DispatchType != WdfIoQueueDispatchManual && Config->EvtIoDeviceControl == nullptr
+        && !(Config->DefaultQueue && device->IoctlHandler != nullptr))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    auto* queue = Track(new SimQueue(), QueueAttributes, device);
+
+    queue->Device = device;
+    queue->DispatchType = Config->DispatchType;
+    queue->EvtIoDeviceControl = Config->EvtIoDeviceControl;
+
+    if (Config->DefaultQueue)
+    {
+        device->DefaultQueue = queue;
+    }
+
+    if (Queue != nullptr)
+    {
+        *Queue = ToHandle<WDFQUEUE>(queue);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfIoQueueRetrieveNextRequest(
+    _In_ WDFQUEUE Queue,
+    _Out_ WDFREQUEST* OutRequest
+)
+{
+    auto* queue = FromHandle<SimQueue>(Queue, ObjectType::Queue);
+
+    assert(queue->DispatchType == WdfIoQueueDispatchManual);
+
+    if (queue->Pending.empty())
+    {
+        return STATUS_NO_MORE_ENTRIES;
+    }
+
+    SimRequest* request = queue->Pending.front();
+    queue->Pending.pop_front();
+    PresentRequest(queue, request);
+
+    *OutRequest = ToHandle<WDFREQUEST>(request);
+
+    return STATUS_SUCCESS;
+}
+
+WDF_IO_QUEUE_STATE
+WdfIoQueueGetState(
+    _In_ WDFQUEUE Queue,
+    _Out_opt_ PULONG QueueRequests,
+    _Out_opt_ PULONG DriverRequests
+)
+{
+    const auto* queue = FromHandle<SimQueue>(Queue, ObjectType::Queue);
+    int state = WdfIoQueueAcceptRequests | WdfIoQueueDispatchRequests;
+
+    if (queue->Pending.empty())
+    {
+        state |= WdfIoQueueNoRequests;
+    }
+
+    if (queue->DriverOwned == 0)
+    {
+        state |= WdfIoQueueDriverNoRequests;
+    }
+
+    if (QueueRequests != nullptr)
+    {
+        *QueueRequests = static_cast<ULONG>(queue->Pending.size());
+    }
+
+    if (DriverRequests != nullptr)
+    {
+        *DriverRequests = queue->DriverOwned;
+    }
+
+    return static_cast<WDF_IO_QUEUE_STATE>(state);
+}
+
+WDFDEVICE
+WdfIoQueueGetDevice(
+    _In_ WDFQUEUE Queue
+)
+{
+    return ToHandle<WDFDEVICE>(FromHandle<SimQueue>(Queue, ObjectType::Queue)->Device);
+}
+
+//
+// Called whenever the queue goes from empty to not empty, or right away
+// on the next turn if requests are waiting already
+// 
+NTSTATUS
+WdfIoQueueReadyNotify(
+    _In_ WDFQUEUE Queue,
+    _In_opt_ PFN_WDF_IO_QUEUE_STATE QueueReady,
+    _In_opt_ WDFCONTEXT Context
+)
+{
+    auto* queue = FromHandle<SimQueue>(Queue, ObjectType::Queue);
+
+    if (queue->DispatchType != WdfIoQueueDispatchManual)
+    {
+        return STATUS_INVALID_DEVICE_REQUEST;
+    }
+
+    if (QueueReady != nullptr && queue->EvtReady != nullptr)
+    {
+        return STATUS_INVALID_DEVICE_STATE;
+    }
+
+    queue->EvtReady = QueueReady;
+    queue->ReadyContext = Context;
+
+    if (QueueReady != nullptr && !queue->Pending.empty())
+    {
+        PostSerial(0, EvtDeferredReady, queue->Serial);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+#pragma endregion
+
+#pragma region Requests
+
+NTSTATUS
+WdfRequestCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES RequestAttributes,
+    _In_opt_ WDFIOTARGET IoTarget,
+    _Out_ WDFREQUEST* Request
+)
+{
+    UNREFERENCED_PARAMETER(IoTarget);
+
+    auto* request = Track(new SimRequest(), RequestAttributes);
+
+    State().Counters.RequestsCreated++;
+
+    *Request = ToHandle<WDFREQUEST>(request);
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRequestReuse(
+    _In_ WDFREQUEST Request,
+    _In_ PWDF_REQUEST_REUSE_PARAMS ReuseParams
+)
+{
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+
+    if (request->IsFromIoManager || request->State == RequestState::Sent)
+    {
+        return STATUS_INVALID_DEVICE_REQUEST;
+    }
+
+    request->State = RequestState::Idle;
+    request->Status = ReuseParams->Status;
+    request->Information = 0;
+    request->FormattedTarget = nullptr;
+    request->FormattedInput = nullptr;
+    request->FormattedIoctl = 0;
+    request->EvtCompletion = nullptr;
+    request->CompletionContext = nullptr;
+
+    return STATUS_SUCCESS;
+}
+
+static
+NTSTATUS
+FormatRequest(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_ BOOLEAN IsInternal,
+    _In_opt_ WDFMEMORY Input
+)
+{
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+
+    if (request->State == RequestState::Sent || request->State == RequestState::Queued)
+    {
+        return STATUS_INVALID_DEVICE_STATE;
+    }
+
+    request->FormattedTarget = FromHandle<SimIoTarget>(IoTarget, ObjectType::IoTarget);
+    request->FormattedIoctl = IoctlCode;
+    request->IsFormattedInternal = IsInternal;
+    request->FormattedInput = Input != nullptr ? FromHandle<SimMemory>(Input, ObjectType::Memory) : nullptr;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfIoTargetFormatRequestForIoctl(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_opt_ WDFMEMORY InputBuffer,
+    _In_opt_ PWDFMEMORY_OFFSET InputBufferOffset,
+    _In_opt_ WDFMEMORY OutputBuffer,
+    _In_opt_ PWDFMEMORY_OFFSET OutputBufferOffset
+)
+{
+    UNREFERENCED_PARAMETER(InputBufferOffset);
+    UNREFERENCED_PARAMETER(OutputBuffer);
+    UNREFERENCED_PARAMETER(OutputBufferOffset);
+
+    return FormatRequest(IoTarget, Request, IoctlCode, FALSE, InputBuffer);
+}
+
+NTSTATUS
+WdfIoTargetFormatRequestForInternalIoctlOthers(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_opt_ WDFMEMORY OtherArg1,
+    _In_opt_ PWDFMEMORY_OFFSET OtherArg1Offset,
+    _In_opt_ WDFMEMORY OtherArg2,
+    _In_opt_ PWDFMEMORY_OFFSET OtherArg2Offset,
+    _In_opt_ WDFMEMORY OtherArg4,
+    _In_opt_ PWDFMEMORY_OFFSET OtherArg4Offset
+)
+{
+    UNREFERENCED_PARAMETER(OtherArg1Offset);
+    UNREFERENCED_PARAMETER(OtherArg2);
+    UNREFERENCED_PARAMETER(OtherArg2Offset);
+    UNREFERENCED_PARAMETER(OtherArg4);
+    UNREFERENCED_PARAMETER(OtherArg4Offset);
+
+    return FormatRequest(IoTarget, Request, IoctlCode, TRUE, OtherArg1);
+}
+
+VOID
+WdfRequestSetCompletionRoutine(
+    _In_ WDFREQUEST Request,
+    _In_opt_ PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine,
+    _In_opt_ WDFCONTEXT CompletionContext
+)
+{
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+
+    request->EvtCompletion = CompletionRoutine;
+    request->CompletionContext = CompletionContext;
+}
+
+//
+// Hands the request to the target's submit callback, which may complete it
+// before this returns
+// 
+BOOLEAN
+WdfRequestSend(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS Options
+)
+{
+    UNREFERENCED_PARAMETER(Options);
+
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+    auto* target = FromHandle<SimIoTarget>(Target, ObjectType::IoTarget);
+
+    if (request->FormattedTarget != target || request->State == RequestState::Sent
+        || request->State == RequestState::Queued)
+    {
+        request->Status = STATUS_INVALID_DEVICE_STATE;
+        return FALSE;
+    }
+
+    if (request->IsFromIoManager && !request->IsSubmitMeasured)
+    {
+        request->IsSubmitMeasured = true;
+        request->Result.SubmitNanoseconds = HostNanoseconds() - request->IssueHostNs;
+    }
+
+    request->State = RequestState::Sent;
+    request->SentTarget = target;
+    request->Status = STATUS_PENDING;
+
+    target->EvtSubmit(
+        target->Context,
+        Request,
+        request->FormattedIoctl,
+        request->FormattedInput != nullptr ? request->FormattedInput->Buffer : nullptr,
+        request->FormattedInput != nullptr ? request->FormattedInput->Size : 0
+    );
+
+    return TRUE;
+}
+
+NTSTATUS
+WdfRequestGetStatus(
+    _In_ WDFREQUEST Request
+)
+{
+    return FromHandle<SimRequest>(Request, ObjectType::Request)->Status;
+}
+
+BOOLEAN
+WdfRequestCancelSentRequest(
+    _In_ WDFREQUEST Request
+)
+{
+    const auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+
+    if (request->State != RequestState::Sent || request->SentTarget->EvtCancel == nullptr)
+    {
+        return FALSE;
+    }
+
+    return request->SentTarget->EvtCancel(request->SentTarget->Context, Request);
+}
+
+VOID
+WdfRequestComplete(
+    _In_ WDFREQUEST Request,
+    _In_ NTSTATUS Status
+)
+{
+    CompleteRequest(FromHandle<SimRequest>(Request, ObjectType::Request), Status, 0);
+}
+
+VOID
+WdfRequestCompleteWithInformation(
+    _In_ WDFREQUEST Request,
+    _In_ NTSTATUS Status,
+    _In_ ULONG_PTR Information
+)
+{
+    CompleteRequest(FromHandle<SimRequest>(Request, ObjectType::Request), Status, Information);
+}
+
+VOID
+WdfRequestGetParameters(
+    _In_ WDFREQUEST Request,
+    _Out_ PWDF_REQUEST_PARAMETERS Parameters
+)
+{
+    *Parameters = FromHandle<SimRequest>(Request, ObjectType::Request)->Params;
+}
+
+NTSTATUS
+WdfRequestRetrieveInputBuffer(
+    _In_ WDFREQUEST Request,
+    _In_ size_t MinimumRequiredLength,
+    _Outptr_result_bytebuffer_(*Length) PVOID* Buffer,
+    _Out_opt_ size_t* Length
+)
+{
+    return RetrieveInput(FromHandle<SimRequest>(Request, ObjectType::Request), MinimumRequiredLength, Buffer, Length);
+}
+
+NTSTATUS
+WdfRequestRetrieveOutputBuffer(
+    _In_ WDFREQUEST Request,
+    _In_ size_t MinimumRequiredSize,
+    _Outptr_result_bytebuffer_(*Length) PVOID* Buffer,
+    _Out_opt_ size_t* Length
+)
+{
+    return RetrieveOutput(FromHandle<SimRequest>(Request, ObjectType::Request), MinimumRequiredSize, Buffer, Length);
+}
+
+//
+// Buffered requests get an MDL describing the system buffer
+// 
+NTSTATUS
+WdfRequestRetrieveOutputWdmMdl(
+    _In_ WDFREQUEST Request,
+    _Outptr_ PMDL* Mdl
+)
+{
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+    const size_t length = request->Params.Parameters.DeviceIoControl.OutputBufferLength;
+
+    if (length == 0)
+    {
+        return STATUS_INVALID_DEVICE_REQUEST;
+    }
+
+    if (!request->HasOutputMdl)
+    {
+        request->OutputMdl.MappedSystemVa = request->SystemBuffer;
+        request->OutputMdl.StartVa = request->SystemBuffer;
+        request->OutputMdl.ByteCount = static_cast<ULONG>(length);
+        request->HasOutputMdl = true;
+    }
+
+    *Mdl = &request->OutputMdl;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRequestForwardToIoQueue(
+    _In_ WDFREQUEST Request,
+    _In_ WDFQUEUE DestinationQueue
+)
+{
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+    auto* queue = FromHandle<SimQueue>(DestinationQueue, ObjectType::Queue);
+
+    if (!request->IsFromIoManager || request->State != RequestState::DriverOwned
+        || request->PresentedBy == nullptr || request->PresentedBy->Device != queue->Device)
+    {
+        return STATUS_INVALID_DEVICE_REQUEST;
+    }
+
+    if (request->IsCanceled)
+    {
+        return STATUS_CANCELLED;
+    }
+
+    ReleaseOwnership(request);
+    request->PresentedBy = nullptr;
+
+    EnqueueRequest(queue, request);
+
+    return STATUS_SUCCESS;
+}
+
+WDFQUEUE
+WdfRequestGetIoQueue(
+    _In_ WDFREQUEST Request
+)
+{
+    return ToHandle<WDFQUEUE>(FromHandle<SimRequest>(Request, ObjectType::Request)->PresentedBy);
+}
+
+NTSTATUS
+WdfRequestMarkCancelableEx(
+    _In_ WDFREQUEST Request,
+    _In_ PFN_WDF_REQUEST_CANCEL EvtRequestCancel
+)
+{
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+
+    if (request->IsCanceled)
+    {
+        return STATUS_CANCELLED;
+    }
+
+    request->EvtCancel = EvtRequestCancel;
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRequestUnmarkCancelable(
+    _In_ WDFREQUEST Request
+)
+{
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+
+    if (request->EvtCancel == nullptr)
+    {
+        return request->IsCanceled ? STATUS_CANCELLED : STATUS_INVALID_DEVICE_REQUEST;
+    }
+
+    request->EvtCancel = nullptr;
+
+    return STATUS_SUCCESS;
+}
+
+#pragma endregion
+
+#pragma region I/O targets
+
+NTSTATUS
+SimIoTargetCreate(
+    _In_ WDFDEVICE Device,
+    _In_ SIM_EVT_IO_TARGET_SUBMIT* EvtSubmit,
+    _In_ SIM_EVT_IO_TARGET_CANCEL* EvtCancel,
+    _In_opt_ PVOID Context,
+    _Out_ WDFIOTARGET* IoTarget
+)
+{
+    auto* target = Track(new SimIoTarget(), nullptr, FromHandle<SimDevice>(Device, ObjectType::Device));
+
+    target->EvtSubmit = EvtSubmit;
+    target->EvtCancel = EvtCancel;
+    target->Context = Context;
+
+    *IoTarget = ToHandle<WDFIOTARGET>(target);
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Runs the sender's completion routine, the request must not be touched
+// afterwards as the routine may have deleted or completed it
+// 
+VOID
+SimIoTargetCompleteRequest(
+    _In_ WDFREQUEST Request,
+    _In_ NTSTATUS Status,
+    _In_ ULONG_PTR Information
+)
+{
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+    WDF_REQUEST_COMPLETION_PARAMS params{};
+
+    assert(request->State == RequestState::Sent);
+
+    if (request->IsFromIoManager)
+    {
+        request->TargetCompletionHostNs = HostNanoseconds();
+    }
+
+    SimIoTarget* target = request->SentTarget;
+
+    request->State = request->IsFromIoManager ? RequestState::DriverOwned : RequestState::Idle;
+    request->SentTarget = nullptr;
+    request->Status = Status;
+    request->Information = Information;
+
+    params.Size = sizeof(params);
+    params.Type = request->IsFormattedInternal ? WdfRequestTypeDeviceControlInternal : WdfRequestTypeDeviceControl;
+    params.IoStatus.Status = Status;
+    params.IoStatus.Information = Information;
+
+    if (request->IsFormattedInternal)
+    {
+        params.Parameters.Others.Argument1.Ptr = request->FormattedInput;
+    }
+    else
+    {
+        params.Parameters.Ioctl.IoControlCode = request->FormattedIoctl;
+        params.Parameters.Ioctl.Input.Buffer = ToHandle<WDFMEMORY>(request->FormattedInput);
+    }
+
+    if (request->EvtCompletion != nullptr)
+    {
+        request->EvtCompletion(Request, ToHandle<WDFIOTARGET>(target), &params, request->CompletionContext);
+    }
+    else if (request->IsFromIoManager)
+    {
+        CompleteRequest(request, Status, Information);
+    }
+}
+
+VOID
+SimRequestSetTag(
+    _In_ WDFREQUEST Request,
+    _In_ ULONG64 Tag
+)
+{
+    auto* request = FromHandle<SimRequest>(Request, ObjectType::Request);
+
+    if (request->IsFromIoManager)
+    {
+        request->Result.Tag = Tag;
+    }
+}
+
+namespace
+{
+    struct SynchronousSend
+    {
+        bool IsDone;
+        NTSTATUS Status;
+        ULONG_PTR Information;
+    };
+
+    VOID EvtSynchronousSendCompleted(
+        _In_ WDFREQUEST Request,
+        _In_ WDFIOTARGET Target,
+        _In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+        _In_ WDFCONTEXT Context
+    )
+    {
+        UNREFERENCED_PARAMETER(Request);
+        UNREFERENCED_PARAMETER(Target);
+
+        auto* send = static_cast<SynchronousSend*>(Context);
+
+        send->IsDone = true;
+        send->Status = Params->IoStatus.Status;
+        send->Information = Params->IoStatus.Information;
+    }
+}
+
+//
+// Runs the event loop until the target answered
+// 
+NTSTATUS
+WdfIoTargetSendInternalIoctlOthersSynchronously(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OtherArg1,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OtherArg2,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OtherArg4,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS RequestOptions,
+    _Out_opt_ PULONG_PTR BytesReturned
+)
+{
+    UNREFERENCED_PARAMETER(OtherArg2);
+    UNREFERENCED_PARAMETER(OtherArg4);
+
+    auto& state = State();
+    WDFREQUEST request = Request;
+    WDFMEMORY input = nullptr;
+    SynchronousSend send{ false, STATUS_PENDING, 0 };
+    WDF_OBJECT_ATTRIBUTES attributes;
+
+    if (request == nullptr)
+    {
+        (void)WdfRequestCreate(WDF_NO_OBJECT_ATTRIBUTES, IoTarget, &request);
+    }
+
+    if (OtherArg1 != nullptr && OtherArg1->Type == WdfMemoryDescriptorTypeBuffer)
+    {
+        WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+        attributes.ParentObject = request;
+
+        (void)WdfMemoryCreatePreallocated(
+            &attributes,
+            OtherArg1->u.BufferType.Buffer,
+            OtherArg1->u.BufferType.Length,
+            &input
+        );
+    }
+
+    (void)WdfIoTargetFormatRequestForInternalIoctlOthers(
+        IoTarget, request, IoctlCode, input, nullptr, nullptr, nullptr, nullptr, nullptr);
+    WdfRequestSetCompletionRoutine(request, EvtSynchronousSendCompleted, &send);
+
+    if (WdfRequestSend(request, IoTarget, RequestOptions))
+    {
+        while (!send.IsDone && !state.Events.empty())
+        {
+            (void)SimRunUntilIdle(1);
+        }
+    }
+    else
+    {
+        send.IsDone = true;
+        send.Status = WdfRequestGetStatus(request);
+    }
+
+    WdfRequestSetCompletionRoutine(request, nullptr, nullptr);
+
+    if (input != nullptr)
+    {
+        WdfObjectDelete(input);
+    }
+
+    if (Request == nullptr)
+    {
+        WdfObjectDelete(request);
+    }
+
+    if (BytesReturned != nullptr)
+    {
+        *BytesReturned = send.Information;
+    }
+
+    return send.IsDone ? send.Status : STATUS_IO_TIMEOUT;
+}
+
+#pragma endregion
+
+#pragma region Client I/O
+
+ULONG64
+SimDeviceIoControl(
+    _In_ WDFDEVICE Device,
+    _In_ ULONG IoControlCode,
+    _In_reads_bytes_opt_(InputBufferLength) PVOID InputBuffer,
+    _In_ size_t InputBufferLength,
+    _Out_writes_bytes_opt_(OutputBufferLength) PVOID OutputBuffer,
+    _In_ size_t OutputBufferLength,
+    _In_ SIM_IO_COMPLETION* Completion,
+    _In_opt_ PVOID Context
+)
+{
+    auto& state = State();
+    auto* device = FromHandle<SimDevice>(Device, ObjectType::Device);
+    const ULONG method = METHOD_FROM_CTL_CODE(IoControlCode);
+    auto* request = Track(new SimRequest(), nullptr);
+
+    request->IsFromIoManager = true;
+    request->IssueHostNs = HostNanoseconds();
+    request->Identifier = ++state.NextIoIdentifier;
+    request->EvtIoCompletion = Completion;
+    request->IoCompletionContext = Context;
+    request->Result.IssueTime = state.Now;
+    request->UserOutput = OutputBuffer;
+
+    WDF_REQUEST_PARAMETERS_INIT(&request->Params);
+    request->Params.Type = WdfRequestTypeDeviceControl;
+    request->Params.Parameters.DeviceIoControl.IoControlCode = IoControlCode;
+    request->Params.Parameters.DeviceIoControl.InputBufferLength = InputBufferLength;
+    request->Params.Parameters.DeviceIoControl.OutputBufferLength = OutputBufferLength;
+
+    //
+    // Buffered requests share one system buffer for both directions, direct
+    // ones only buffer the input and lock the output in place
+    // 
+    const size_t systemLength = method == METHOD_BUFFERED
+        ? std::max(InputBufferLength, OutputBufferLength)
+        : InputBufferLength;
+
+    if (systemLength != 0)
+    {
+        request->SystemBuffer = malloc(systemLength);
+        request->IsSystemBufferOwned = true;
+        state.Counters.IoManagerBuffers++;
+
+        if (InputBufferLength != 0)
+        {
+            memcpy(request->SystemBuffer, InputBuffer, InputBufferLength);
+            state.Counters.IoManagerBytesCopied += InputBufferLength;
+        }
+    }
+
+    if (method != METHOD_BUFFERED && OutputBufferLength != 0)
+    {
+        request->OutputMdl.MappedSystemVa = OutputBuffer;
+        request->OutputMdl.StartVa = OutputBuffer;
+        request->OutputMdl.ByteCount = static_cast<ULONG>(OutputBufferLength);
+        request->HasOutputMdl = true;
+    }
+
+    state.PendingIo.emplace(request->Identifier, request);
+
+    const ULONG64 identifier = request->Identifier;
+
+    if (device->DefaultQueue == nullptr)
+    {
+        request->State = RequestState::DriverOwned;
+        CompleteRequest(request, STATUS_INVALID_DEVICE_REQUEST, 0);
+        return identifier;
+    }
+
+    EnqueueRequest(device->DefaultQueue, request);
+
+    return identifier;
+}
+
+//
+// Queued requests complete as canceled, driver-owned ones run their cancel
+// routine, sent ones are canceled at the target
+// 
+BOOLEAN
+SimCancelIo(
+    _In_ ULONG64 Identifier
+)
+{
+    auto& state = State();
+    const auto it = state.PendingIo.find(Identifier);
+
+    if (it == state.PendingIo.end())
+    {
+        return FALSE;
+    }
+
+    SimRequest* request = it->second;
+
+    if (request->IsCanceled)
+    {
+        return TRUE;
+    }
+
+    request->IsCanceled = true;
+
+    switch (request->State)
+    {
+    case RequestState::Queued:
+        CompleteRequest(request, STATUS_CANCELLED, 0);
+        break;
+
+    case RequestState::Sent:
+        (void)WdfRequestCancelSentRequest(ToHandle<WDFREQUEST>(request));
+        break;
+
+    case RequestState::DriverOwned:
+        if (request->EvtCancel != nullptr)
+        {
+            const PFN_WDF_REQUEST_CANCEL evtCancel = request->EvtCancel;
+
+            request->EvtCancel = nullptr;
+            evtCancel(ToHandle<WDFREQUEST>(request));
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return TRUE;
+}
+
+#pragma endregion
+
+#pragma region Kernel
+
+ULONGLONG
+KeQueryInterruptTime(
+    VOID
+)
+{
+    return State().Now;
+}
+
+LARGE_INTEGER
+KeQueryPerformanceCounter(
+    _Out_opt_ PLARGE_INTEGER PerformanceFrequency
+)
+{
+    LARGE_INTEGER counter;
+
+    if (PerformanceFrequency != nullptr)
+    {
+        PerformanceFrequency->QuadPart = 10000000;
+    }
+
+    counter.QuadPart = static_cast<LONGLONG>(HostNanoseconds() / 100);
+
+    return counter;
+}
+
+ULONG
+KeQueryMaximumProcessorCountEx(
+    _In_ USHORT GroupNumber
+)
+{
+    UNREFERENCED_PARAMETER(GroupNumber);
+
+    return 1;
+}
+
+ULONG
+KeGetCurrentProcessorNumberEx(
+    _Out_opt_ PPROCESSOR_NUMBER ProcNumber
+)
+{
+    if (ProcNumber != nullptr)
+    {
+        *ProcNumber = PROCESSOR_NUMBER{};
+    }
+
+    return 0;
+}
+
+KIRQL
+KeGetCurrentIrql(
+    VOID
+)
+{
+    return State().Irql;
+}
+
+VOID
+KeRaiseIrql(
+    _In_ KIRQL NewIrql,
+    _Out_ PKIRQL OldIrql
+)
+{
+    auto& state = State();
+
+    assert(NewIrql >= state.Irql);
+
+    *OldIrql = state.Irql;
+    state.Irql = NewIrql;
+}
+
+VOID
+KeLowerIrql(
+    _In_ KIRQL NewIrql
+)
+{
+    auto& state = State();
+
+    assert(NewIrql <= state.Irql);
+
+    state.Irql = NewIrql;
+}
+
+VOID
+KeInitializeEvent(
+    _Out_ PRKEVENT Event,
+    _In_ EVENT_TYPE Type,
+    _In_ BOOLEAN State
+)
+{
+    UNREFERENCED_PARAMETER(Type);
+
+    Event->Signaled = State;
+}
+
+LONG
+KeSetEvent(
+    _Inout_ PRKEVENT Event,
+    _In_ KPRIORITY Increment,
+    _In_ BOOLEAN Wait
+)
+{
+    UNREFERENCED_PARAMETER(Increment);
+    UNREFERENCED_PARAMETER(Wait);
+
+    const LONG previous = Event->Signaled;
+
+    Event->Signaled = TRUE;
+
+    return previous;
+}
+
+VOID
+KeClearEvent(
+    _Inout_ PRKEVENT Event
+)
+{
+    Event->Signaled = FALSE;
+}
+
+SIZE_T
+SimRtlCompareMemory(
+    _In_ const VOID* Source1,
+    _In_ const VOID* Source2,
+    _In_ SIZE_T Length
+)
+{
+    const auto* a = static_cast<const UCHAR*>(Source1);
+    const auto* b = static_cast<const UCHAR*>(Source2);
+    SIZE_T index = 0;
+
+    while (index < Length && a[index] == b[index])
+    {
+        index++;
+    }
+
+    return index;
+}
+
+#pragma endregion
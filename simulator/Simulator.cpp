@@ -0,0 +1,1076 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+//
+// Runs the bus driver's I/O path against virtual controllers and reports
+// throughput, report latency and what every report cost in allocations
+// and copies.
+// 
+// bthps3_simulator [--controllers N] [--radios N] [--rate HZ]
+//                  [--latency-us US] [--jitter-us US] [--duration-s S]
+//                  [--reads N] [--mode buffered|direct|state|imu]
+//                  [--device sixaxis|navigation|motion|wireless]
+//                  [--feedback-hz HZ] [--seed N]
+//                  [--max-copied-per-report BYTES]
+//                  [--driver-load-ms MS] [--enable-on-connect 0|1]
+//                  [--max-first-report-ms MS]
+//                  [--control-clients N] [--control transact|pair]
+//                  [--held-control-read-ms MS]
+// 
+
+#include "Simulator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    struct Options
+    {
+        ULONG Controllers = 4;
+        ULONG Radios = 1;
+        ULONG Rate = 250;
+        ULONG64 LatencyMicroseconds = 1250;
+        ULONG64 JitterMicroseconds = 250;
+        double DurationSeconds = 10.0;
+        ULONG Reads = 2;
+        std::string Mode = "buffered";
+        DS_DEVICE_TYPE DeviceType = DS_DEVICE_TYPE_SIXAXIS;
+        ULONG FeedbackRate = 0;
+        ULONG Seed = 1;
+
+        //
+        // Fails the run if the I/O manager copied more per report, negative to not check
+        // 
+        double MaxCopiedPerReport = -1.0;
+
+        //
+        // Time from channel-up until the function driver starts talking to
+        // the child, and whether the bus driver enables SIXAXIS reports
+        // itself in the meantime
+        // 
+        ULONG64 DriverLoadMilliseconds = 0;
+        bool EnableOnConnect = false;
+
+        //
+        // Fails the run if a controller took longer to its first report,
+        // negative to not check
+        // 
+        double MaxFirstReportMilliseconds = -1.0;
+
+        //
+        // Feature report requests kept in flight per controller, as one
+        // transaction each or as a control write followed by a control read
+        // 
+        ULONG ControlClients = 0;
+        std::string ControlMode = "transact";
+
+        //
+        // Plain control read posted ahead of the transactions and canceled
+        // after this long, zero for none
+        // 
+        ULONG64 HeldControlReadMilliseconds = 0;
+    };
+
+    //
+    // HIDP SET_REPORT (Feature) 0xF4, what the function driver sends
+    // 
+    const UCHAR SixaxisEnableCommand[] = { 0x53, 0xF4, 0x42, 0x03, 0x00, 0x00 };
+
+    struct Controller;
+
+    struct ReadSlot
+    {
+        Controller* Owner;
+        std::vector<UCHAR> Buffer;
+        ULONG64 Identifier;
+        bool IsPending;
+    };
+
+    struct ControlSlot
+    {
+        Controller* Owner;
+        UCHAR ReportId;
+        std::vector<UCHAR> Request;
+        std::vector<UCHAR> Response;
+        ULONG64 IssueTime;
+        ULONG64 HostNanoseconds;
+    };
+
+    struct Controller
+    {
+        WDFDEVICE Device;
+        PSIM_REMOTE Remote;
+        std::vector<ReadSlot> Slots;
+        BTHPS3_SET_FEEDBACK Feedback;
+        bool IsFeedbackPending;
+        std::vector<UCHAR> Control;
+        std::vector<ControlSlot> ControlSlots;
+        ULONG64 ConnectedAt;
+        ULONG64 FirstReportAt;
+        bool HasReported;
+        ULONG64 HeldControlRead;
+        bool IsHoldingControlRead;
+    };
+
+    struct Harness
+    {
+        Options Config;
+        ULONG IoControlCode = 0;
+        size_t OutputLength = 0;
+        std::vector<Controller> Controllers;
+        bool IsStopping = false;
+
+        ULONG64 Reports = 0;
+        ULONG64 Failures = 0;
+        ULONG64 FeedbackSent = 0;
+        ULONG64 ControlExchanges = 0;
+        ULONG64 ControlMismatches = 0;
+        ULONG64 ControlFailures = 0;
+        ULONG64 HeldControlReadsCanceled = 0;
+        std::vector<ULONG64> ControlLatency;
+        std::vector<ULONG64> ControlNanoseconds;
+        std::vector<ULONG64> Latency;
+        std::vector<ULONG64> SubmitNanoseconds;
+        std::vector<ULONG64> CompletionNanoseconds;
+    };
+
+    Harness G_Harness;
+
+    void SubmitRead(ReadSlot* Slot);
+
+    void EvtResubmit(PVOID Context)
+    {
+        auto* slot = static_cast<ReadSlot*>(Context);
+
+        if (!G_Harness.IsStopping)
+        {
+            SubmitRead(slot);
+        }
+    }
+
+    void EvtReadCompleted(PVOID Context, PCSIM_IO_RESULT Result)
+    {
+        auto* slot = static_cast<ReadSlot*>(Context);
+
+        slot->IsPending = false;
+
+        if (G_Harness.IsStopping)
+        {
+            return;
+        }
+
+        if (NT_SUCCESS(Result->Status))
+        {
+            if (!slot->Owner->HasReported)
+            {
+                slot->Owner->HasReported = true;
+                slot->Owner->FirstReportAt = Result->CompletionTime;
+            }
+
+            G_Harness.Reports++;
+            G_Harness.Latency.push_back(Result->CompletionTime - Result->Tag);
+            G_Harness.SubmitNanoseconds.push_back(Result->SubmitNanoseconds);
+            G_Harness.CompletionNanoseconds.push_back(Result->CompletionNanoseconds);
+        }
+        else
+        {
+            G_Harness.Failures++;
+        }
+
+        //
+        // Like an application would, from its own completion thread
+        // 
+        SimPost(0, EvtResubmit, slot);
+    }
+
+    void SubmitRead(ReadSlot* Slot)
+    {
+        Slot->IsPending = true;
+        Slot->Identifier = SimDeviceIoControl(
+            Slot->Owner->Device,
+            G_Harness.IoControlCode,
+            nullptr,
+            0,
+            Slot->Buffer.data(),
+            Slot->Buffer.size(),
+            EvtReadCompleted,
+            Slot
+        );
+    }
+
+    void EvtFeedbackCompleted(PVOID Context, PCSIM_IO_RESULT Result)
+    {
+        auto* controller = static_cast<Controller*>(Context);
+
+        controller->IsFeedbackPending = false;
+
+        if (NT_SUCCESS(Result->Status))
+        {
+            G_Harness.FeedbackSent++;
+        }
+    }
+
+    //
+    // Periodic rumble and LED update, skipped while the last one is in flight
+    // 
+    void EvtFeedback(PVOID Context)
+    {
+        auto* controller = static_cast<Controller*>(Context);
+
+        if (G_Harness.IsStopping)
+        {
+            return;
+        }
+
+        if (!controller->IsFeedbackPending)
+        {
+            controller->Feedback.LargeMotor++;
+            controller->Feedback.LedMask = static_cast<UCHAR>((controller->Feedback.LedMask + 1) & 0x0F);
+            controller->IsFeedbackPending = true;
+
+            (void)SimDeviceIoControl(
+                controller->Device,
+                IOCTL_BTHPS3_SET_FEEDBACK,
+                &controller->Feedback,
+                sizeof(controller->Feedback),
+                nullptr,
+                0,
+                EvtFeedbackCompleted,
+                controller
+            );
+        }
+
+        SimPost(10000000ULL / G_Harness.Config.FeedbackRate, EvtFeedback, controller);
+    }
+
+    void SubmitControl(ControlSlot* Slot);
+
+    //
+    // Response has to carry the requested report, anything else got paired
+    // with the wrong request
+    // 
+    void EvtControlCompleted(PVOID Context, PCSIM_IO_RESULT Result)
+    {
+        auto* slot = static_cast<ControlSlot*>(Context);
+
+        slot->HostNanoseconds += Result->SubmitNanoseconds + Result->CompletionNanoseconds;
+
+        if (!NT_SUCCESS(Result->Status))
+        {
+            G_Harness.ControlFailures++;
+        }
+        else
+        {
+            //
+            // Held read still pending, the transaction raced it for the response
+            // 
+            if (slot->Owner->IsHoldingControlRead)
+            {
+                G_Harness.ControlMismatches++;
+            }
+
+            G_Harness.ControlExchanges++;
+            G_Harness.ControlLatency.push_back(Result->CompletionTime - slot->IssueTime);
+            G_Harness.ControlNanoseconds.push_back(slot->HostNanoseconds);
+
+            if (Result->Information < 2 || slot->Response[1] != slot->ReportId)
+            {
+                G_Harness.ControlMismatches++;
+            }
+        }
+
+        if (!G_Harness.IsStopping)
+        {
+            SubmitControl(slot);
+        }
+    }
+
+    //
+    // First half of a pair got sent, the response is read separately
+    // 
+    void EvtControlWritten(PVOID Context, PCSIM_IO_RESULT Result)
+    {
+        auto* slot = static_cast<ControlSlot*>(Context);
+
+        if (!NT_SUCCESS(Result->Status))
+        {
+            EvtControlCompleted(Context, Result);
+            return;
+        }
+
+        slot->HostNanoseconds += Result->SubmitNanoseconds + Result->CompletionNanoseconds;
+
+        (void)SimDeviceIoControl(
+            slot->Owner->Device,
+            IOCTL_BTHPS3_HID_CONTROL_READ,
+            nullptr,
+            0,
+            slot->Response.data(),
+            slot->Response.size(),
+            EvtControlCompleted,
+            slot
+        );
+    }
+
+    void SubmitControl(ControlSlot* Slot)
+    {
+        Slot->IssueTime = SimNow();
+        Slot->HostNanoseconds = 0;
+        std::fill(Slot->Response.begin(), Slot->Response.end(), 0);
+
+        if (G_Harness.Config.ControlMode == "transact")
+        {
+            (void)SimDeviceIoControl(
+                Slot->Owner->Device,
+                IOCTL_BTHPS3_HID_CONTROL_TRANSACT,
+                Slot->Request.data(),
+                Slot->Request.size(),
+                Slot->Response.data(),
+                Slot->Response.size(),
+                EvtControlCompleted,
+                Slot
+            );
+        }
+        else
+        {
+            (void)SimDeviceIoControl(
+                Slot->Owner->Device,
+                IOCTL_BTHPS3_HID_CONTROL_WRITE,
+                Slot->Request.data(),
+                Slot->Request.size(),
+                nullptr,
+                0,
+                EvtControlWritten,
+                Slot
+            );
+        }
+    }
+
+    void EvtHeldControlReadCompleted(PVOID Context, PCSIM_IO_RESULT Result)
+    {
+        auto* controller = static_cast<Controller*>(Context);
+
+        controller->IsHoldingControlRead = false;
+
+        if (Result->Status == STATUS_CANCELLED)
+        {
+            G_Harness.HeldControlReadsCanceled++;
+        }
+    }
+
+    void EvtCancelHeldControlRead(PVOID Context)
+    {
+        auto* controller = static_cast<Controller*>(Context);
+
+        (void)SimCancelIo(controller->HeldControlRead);
+    }
+
+    void StartControl(Controller* Owner)
+    {
+        //
+        // Nothing answers it, transactions have to wait until it got canceled
+        // 
+        if (G_Harness.Config.HeldControlReadMilliseconds != 0 && !Owner->ControlSlots.empty())
+        {
+            Owner->Control.assign(0x40, 0);
+            Owner->IsHoldingControlRead = true;
+            Owner->HeldControlRead = SimDeviceIoControl(
+                Owner->Device,
+                IOCTL_BTHPS3_HID_CONTROL_READ,
+                nullptr,
+                0,
+                Owner->Control.data(),
+                Owner->Control.size(),
+                EvtHeldControlReadCompleted,
+                Owner
+            );
+
+            SimPost(G_Harness.Config.HeldControlReadMilliseconds * 10000ULL, EvtCancelHeldControlRead, Owner);
+        }
+
+        for (ControlSlot& slot : Owner->ControlSlots)
+        {
+            SubmitControl(&slot);
+        }
+    }
+
+    void EvtHandshakeReceived(PVOID Context, PCSIM_IO_RESULT Result)
+    {
+        UNREFERENCED_PARAMETER(Result);
+
+        if (!G_Harness.IsStopping)
+        {
+            StartControl(static_cast<Controller*>(Context));
+        }
+    }
+
+    //
+    // Report enable command is out, consume the HANDSHAKE reply
+    // 
+    void EvtEnableSent(PVOID Context, PCSIM_IO_RESULT Result)
+    {
+        auto* controller = static_cast<Controller*>(Context);
+
+        if (!NT_SUCCESS(Result->Status))
+        {
+            G_Harness.Failures++;
+            return;
+        }
+
+        controller->Control.assign(0x40, 0);
+
+        (void)SimDeviceIoControl(
+            controller->Device,
+            G_Harness.Config.Mode == "direct" ? IOCTL_BTHPS3_HID_CONTROL_READ_DIRECT : IOCTL_BTHPS3_HID_CONTROL_READ,
+            nullptr,
+            0,
+            controller->Control.data(),
+            controller->Control.size(),
+            EvtHandshakeReceived,
+            controller
+        );
+    }
+
+    //
+    // Function driver got loaded: enables reports unless the bus driver
+    // did so already, then starts reading
+    // 
+    void EvtDriverLoaded(PVOID Context)
+    {
+        auto* controller = static_cast<Controller*>(Context);
+        const Options& config = G_Harness.Config;
+
+        if (G_Harness.IsStopping)
+        {
+            return;
+        }
+
+        if (config.DeviceType == DS_DEVICE_TYPE_SIXAXIS && !config.EnableOnConnect)
+        {
+            controller->Control.assign(std::begin(SixaxisEnableCommand), std::end(SixaxisEnableCommand));
+
+            //
+            // Direct reads come with a function driver that writes directly too,
+            // the data goes in the output buffer then
+            // 
+            if (config.Mode == "direct")
+            {
+                (void)SimDeviceIoControl(
+                    controller->Device,
+                    IOCTL_BTHPS3_HID_CONTROL_WRITE_DIRECT,
+                    nullptr,
+                    0,
+                    controller->Control.data(),
+                    controller->Control.size(),
+                    EvtEnableSent,
+                    controller
+                );
+            }
+            else
+            {
+                (void)SimDeviceIoControl(
+                    controller->Device,
+                    IOCTL_BTHPS3_HID_CONTROL_WRITE,
+                    controller->Control.data(),
+                    controller->Control.size(),
+                    nullptr,
+                    0,
+                    EvtEnableSent,
+                    controller
+                );
+            }
+        }
+        else
+        {
+            StartControl(controller);
+        }
+
+        for (ReadSlot& slot : controller->Slots)
+        {
+            SubmitRead(&slot);
+        }
+
+        if (config.FeedbackRate != 0)
+        {
+            SimPost(0, EvtFeedback, controller);
+        }
+    }
+
+    void EvtRadioLoadCompleted(PVOID Context, PCSIM_IO_RESULT Result)
+    {
+        *static_cast<SIM_IO_RESULT*>(Context) = *Result;
+    }
+
+    ULONG64 Percentile(std::vector<ULONG64>& Samples, double Fraction)
+    {
+        if (Samples.empty())
+        {
+            return 0;
+        }
+
+        const auto index = static_cast<size_t>(Fraction * static_cast<double>(Samples.size() - 1));
+
+        std::nth_element(Samples.begin(), Samples.begin() + index, Samples.end());
+
+        return Samples[index];
+    }
+
+    void PrintDistribution(const char* Name, std::vector<ULONG64>& Samples, double Scale, const char* Unit)
+    {
+        printf(
+            "%-22s p50 %9.2f  p90 %9.2f  p99 %9.2f  p99.9 %9.2f  max %9.2f %s\n",
+            Name,
+            Percentile(Samples, 0.50) * Scale,
+            Percentile(Samples, 0.90) * Scale,
+            Percentile(Samples, 0.99) * Scale,
+            Percentile(Samples, 0.999) * Scale,
+            Percentile(Samples, 1.0) * Scale,
+            Unit
+        );
+    }
+
+    bool ParseDeviceType(const std::string& Name, DS_DEVICE_TYPE* DeviceType)
+    {
+        static const struct
+        {
+            const char* Name;
+            DS_DEVICE_TYPE Type;
+        } types[] =
+        {
+            { "sixaxis", DS_DEVICE_TYPE_SIXAXIS },
+            { "navigation", DS_DEVICE_TYPE_NAVIGATION },
+            { "motion", DS_DEVICE_TYPE_MOTION },
+            { "wireless", DS_DEVICE_TYPE_WIRELESS }
+        };
+
+        for (const auto& type : types)
+        {
+            if (Name == type.Name)
+            {
+                *DeviceType = type.Type;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool ParseOptions(int argc, char** argv, Options* Config)
+    {
+        for (int index = 1; index < argc; index++)
+        {
+            const std::string name = argv[index];
+
+            if (index + 1 >= argc)
+            {
+                fprintf(stderr, "missing value for %s\n", name.c_str());
+                return false;
+            }
+
+            const char* value = argv[++index];
+
+            if (name == "--controllers")
+            {
+                Config->Controllers = strtoul(value, nullptr, 0);
+            }
+            else if (name == "--radios")
+            {
+                Config->Radios = std::max(1UL, strtoul(value, nullptr, 0));
+            }
+            else if (name == "--rate")
+            {
+                Config->Rate = strtoul(value, nullptr, 0);
+            }
+            else if (name == "--latency-us")
+            {
+                Config->LatencyMicroseconds = strtoull(value, nullptr, 0);
+            }
+            else if (name == "--jitter-us")
+            {
+                Config->JitterMicroseconds = strtoull(value, nullptr, 0);
+            }
+            else if (name == "--duration-s")
+            {
+                Config->DurationSeconds = strtod(value, nullptr);
+            }
+            else if (name == "--reads")
+            {
+                Config->Reads = std::max(1UL, strtoul(value, nullptr, 0));
+            }
+            else if (name == "--mode")
+            {
+                Config->Mode = value;
+            }
+            else if (name == "--device")
+            {
+                if (!ParseDeviceType(value, &Config->DeviceType))
+                {
+                    fprintf(stderr, "unknown device type %s\n", value);
+                    return false;
+                }
+            }
+            else if (name == "--feedback-hz")
+            {
+                Config->FeedbackRate = strtoul(value, nullptr, 0);
+            }
+            else if (name == "--seed")
+            {
+                Config->Seed = strtoul(value, nullptr, 0);
+            }
+            else if (name == "--max-copied-per-report")
+            {
+                Config->MaxCopiedPerReport = strtod(value, nullptr);
+            }
+            else if (name == "--driver-load-ms")
+            {
+                Config->DriverLoadMilliseconds = strtoull(value, nullptr, 0);
+            }
+            else if (name == "--enable-on-connect")
+            {
+                Config->EnableOnConnect = strtoul(value, nullptr, 0) != 0;
+            }
+            else if (name == "--max-first-report-ms")
+            {
+                Config->MaxFirstReportMilliseconds = strtod(value, nullptr);
+            }
+            else if (name == "--control-clients")
+            {
+                Config->ControlClients = strtoul(value, nullptr, 0);
+            }
+            else if (name == "--control")
+            {
+                Config->ControlMode = value;
+            }
+            else if (name == "--held-control-read-ms")
+            {
+                Config->HeldControlReadMilliseconds = strtoull(value, nullptr, 0);
+            }
+            else
+            {
+                fprintf(stderr, "unknown option %s\n", name.c_str());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool SelectMode(Harness* State)
+    {
+        const std::string& mode = State->Config.Mode;
+
+        if (mode == "buffered")
+        {
+            State->IoControlCode = IOCTL_BTHPS3_HID_INTERRUPT_READ;
+            State->OutputLength = 0x80;
+        }
+        else if (mode == "direct")
+        {
+            State->IoControlCode = IOCTL_BTHPS3_HID_INTERRUPT_READ_DIRECT;
+            State->OutputLength = 0x80;
+        }
+        else if (mode == "state")
+        {
+            State->IoControlCode = IOCTL_BTHPS3_HID_INTERRUPT_READ_STATE;
+            State->OutputLength = sizeof(BTHPS3_CONTROLLER_STATE);
+        }
+        else if (mode == "imu")
+        {
+            State->IoControlCode = IOCTL_BTHPS3_HID_INTERRUPT_READ_IMU;
+            State->OutputLength = 2 * sizeof(BTHPS3_MOTION_IMU_SAMPLE);
+        }
+        else
+        {
+            fprintf(stderr, "unknown mode %s\n", mode.c_str());
+            return false;
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Harness& harness = G_Harness;
+    Options& config = harness.Config;
+    std::vector<WDFDEVICE> radios;
+    SIM_COUNTERS before;
+    SIM_COUNTERS after;
+
+    if (!ParseOptions(argc, argv, &config) || !SelectMode(&harness))
+    {
+        return 2;
+    }
+
+    if (config.ControlMode != "transact" && config.ControlMode != "pair")
+    {
+        fprintf(stderr, "unknown control mode %s\n", config.ControlMode.c_str());
+        return 2;
+    }
+
+    if (config.HeldControlReadMilliseconds != 0 && config.ControlMode != "transact")
+    {
+        fprintf(stderr, "--held-control-read-ms needs --control transact\n");
+        return 2;
+    }
+
+    if (config.Mode == "imu" && config.DeviceType != DS_DEVICE_TYPE_MOTION)
+    {
+        fprintf(stderr, "--mode imu needs --device motion\n");
+        return 2;
+    }
+
+    if (!NT_SUCCESS(SimDriverInitialize()))
+    {
+        fprintf(stderr, "driver initialization failed\n");
+        return 1;
+    }
+
+    for (ULONG index = 0; index < config.Radios; index++)
+    {
+        WDFDEVICE radio;
+
+        if (!NT_SUCCESS(SimDriverRadioAdd(0x001A7D000000ULL + index, &radio)))
+        {
+            fprintf(stderr, "radio %u failed to come up\n", index);
+            return 1;
+        }
+
+        SimDriverRadioSetSixaxisEnableOnConnect(radio, config.EnableOnConnect ? TRUE : FALSE);
+
+        radios.push_back(radio);
+    }
+
+    harness.Controllers.resize(config.Controllers);
+
+    for (ULONG index = 0; index < config.Controllers; index++)
+    {
+        Controller& controller = harness.Controllers[index];
+        SIM_REMOTE_CONFIG remote{};
+
+        remote.DeviceType = config.DeviceType;
+        remote.ReportRate = config.Rate;
+        remote.Latency = config.LatencyMicroseconds * 10;
+        remote.Jitter = config.JitterMicroseconds * 10;
+        remote.IsSilentUntilEnabled = config.DeviceType == DS_DEVICE_TYPE_SIXAXIS;
+        remote.Seed = config.Seed + index;
+
+        if (!NT_SUCCESS(SimDriverChildAdd(
+            radios[index % radios.size()],
+            0x0019C1000000ULL + index,
+            &remote,
+            &controller.Device,
+            &controller.Remote
+        )))
+        {
+            fprintf(stderr, "controller %u failed to connect\n", index);
+            return 1;
+        }
+
+        controller.Feedback = BTHPS3_SET_FEEDBACK{};
+        controller.Feedback.Duration = 0xFF;
+        controller.IsFeedbackPending = false;
+        controller.ConnectedAt = SimNow();
+        controller.FirstReportAt = 0;
+        controller.HasReported = false;
+        controller.IsHoldingControlRead = false;
+        controller.Slots.resize(config.Reads);
+
+        for (ReadSlot& slot : controller.Slots)
+        {
+            slot.Owner = &controller;
+            slot.Buffer.resize(harness.OutputLength);
+            slot.Identifier = 0;
+            slot.IsPending = false;
+        }
+
+        //
+        // GET_REPORT (Feature) with a report ID of its own per client
+        // 
+        controller.ControlSlots.resize(config.ControlClients);
+
+        for (ULONG client = 0; client < config.ControlClients; client++)
+        {
+            ControlSlot& slot = controller.ControlSlots[client];
+
+            slot.Owner = &controller;
+            slot.ReportId = static_cast<UCHAR>(0x10 + client);
+            slot.Request = { 0x4B, slot.ReportId };
+            slot.Response.resize(0x40);
+            slot.IssueTime = 0;
+            slot.HostNanoseconds = 0;
+        }
+    }
+
+    SimGetCounters(&before);
+
+    const ULONG64 hostStart = SimHostNanoseconds();
+
+    for (Controller& controller : harness.Controllers)
+    {
+        SimPost(config.DriverLoadMilliseconds * 10000, EvtDriverLoaded, &controller);
+    }
+
+    const auto duration = static_cast<ULONG64>(config.DurationSeconds * 10000000.0);
+
+    SimRunUntil(duration);
+
+    const ULONG64 hostElapsed = SimHostNanoseconds() - hostStart;
+
+    SimGetCounters(&after);
+
+    //
+    // Wind down: no new reports, pull back what's still pending
+    // 
+    harness.IsStopping = true;
+
+    for (Controller& controller : harness.Controllers)
+    {
+        SimBthportRemoteStop(controller.Remote);
+
+        for (const ReadSlot& slot : controller.Slots)
+        {
+            if (slot.IsPending)
+            {
+                (void)SimCancelIo(slot.Identifier);
+            }
+        }
+    }
+
+    (void)SimRunUntilIdle(~0ULL);
+
+    SIM_COUNTERS drained;
+    ULONG64 generated = 0;
+    ULONG64 dropped = 0;
+
+    SimGetCounters(&drained);
+
+    for (Controller& controller : harness.Controllers)
+    {
+        SIM_REMOTE_STATS stats;
+
+        SimBthportRemoteGetStats(controller.Remote, &stats);
+        generated += stats.ReportsGenerated;
+        dropped += stats.ReportsDropped;
+    }
+
+    const double reports = static_cast<double>(std::max<ULONG64>(harness.Reports, 1));
+    const double seconds = static_cast<double>(duration) / 1e7;
+    const ULONG64 memory = after.MemoryAllocations - before.MemoryAllocations;
+    const ULONG64 preallocated = after.PreallocatedMemoryObjects - before.PreallocatedMemoryObjects;
+    const ULONG64 requests = after.RequestsCreated - before.RequestsCreated;
+    const ULONG64 brbs = after.BrbAllocations - before.BrbAllocations;
+    const ULONG64 buffers = after.IoManagerBuffers - before.IoManagerBuffers;
+
+    printf("mode %s, %u controller(s) on %u radio(s), %u Hz, %llu us +/- %llu us, %u read(s) each\n",
+        config.Mode.c_str(),
+        config.Controllers,
+        config.Radios,
+        config.Rate,
+        static_cast<unsigned long long>(config.LatencyMicroseconds),
+        static_cast<unsigned long long>(config.JitterMicroseconds),
+        config.Reads
+    );
+    printf("reports                %llu delivered, %llu generated, %llu dropped, %llu failed\n",
+        static_cast<unsigned long long>(harness.Reports),
+        static_cast<unsigned long long>(generated),
+        static_cast<unsigned long long>(dropped),
+        static_cast<unsigned long long>(harness.Failures)
+    );
+    printf("throughput             %.0f reports/s simulated, %.0f reports/s wall clock\n",
+        static_cast<double>(harness.Reports) / seconds,
+        static_cast<double>(harness.Reports) / (static_cast<double>(hostElapsed) / 1e9)
+    );
+
+    if (config.FeedbackRate != 0)
+    {
+        printf("feedback               %llu output reports\n", static_cast<unsigned long long>(harness.FeedbackSent));
+    }
+
+    std::vector<ULONG64> firstReport;
+
+    for (const Controller& controller : harness.Controllers)
+    {
+        if (controller.HasReported)
+        {
+            firstReport.push_back(controller.FirstReportAt - controller.ConnectedAt);
+        }
+    }
+
+    const ULONG64 slowestFirstReport = firstReport.empty()
+        ? 0
+        : *std::max_element(firstReport.begin(), firstReport.end());
+
+    PrintDistribution("time to first report", firstReport, 0.0001, "ms");
+    PrintDistribution("report latency", harness.Latency, 0.1, "us");
+
+    if (config.ControlClients != 0)
+    {
+        printf("control %-14s %llu exchanges, %llu mismatched, %llu failed\n",
+            config.ControlMode.c_str(),
+            static_cast<unsigned long long>(harness.ControlExchanges),
+            static_cast<unsigned long long>(harness.ControlMismatches),
+            static_cast<unsigned long long>(harness.ControlFailures)
+        );
+        PrintDistribution("control latency", harness.ControlLatency, 0.1, "us");
+        PrintDistribution("control host cost", harness.ControlNanoseconds, 1.0, "ns");
+    }
+
+    PrintDistribution("host submit", harness.SubmitNanoseconds, 1.0, "ns");
+    PrintDistribution("host completion", harness.CompletionNanoseconds, 1.0, "ns");
+
+    printf("allocations/report     %.3f (memory %.3f, preallocated %.3f, requests %.3f, BRBs %.3f, system buffers %.3f)\n",
+        static_cast<double>(memory + preallocated + requests + brbs + buffers) / reports,
+        static_cast<double>(memory) / reports,
+        static_cast<double>(preallocated) / reports,
+        static_cast<double>(requests) / reports,
+        static_cast<double>(brbs) / reports,
+        static_cast<double>(buffers) / reports
+    );
+    const double copiedPerReport =
+        static_cast<double>(after.IoManagerBytesCopied - before.IoManagerBytesCopied) / reports;
+
+    printf("bytes copied/report    %.1f by the I/O manager\n", copiedPerReport);
+
+    if (config.MaxCopiedPerReport >= 0.0 && copiedPerReport > config.MaxCopiedPerReport)
+    {
+        fprintf(stderr, "%.1f bytes copied per report, at most %.1f expected\n",
+            copiedPerReport, config.MaxCopiedPerReport);
+        return 1;
+    }
+
+    //
+    // A transaction must always come back with its own response
+    // 
+    if (config.ControlClients != 0 && config.ControlMode == "transact"
+        && (harness.ControlExchanges == 0 || harness.ControlMismatches != 0 || harness.ControlFailures != 0))
+    {
+        fprintf(stderr, "control transactions out of order or failing\n");
+        return 1;
+    }
+
+    if (config.ControlClients != 0 && config.HeldControlReadMilliseconds != 0
+        && harness.HeldControlReadsCanceled != harness.Controllers.size())
+    {
+        fprintf(stderr, "%zu held control read(s) not canceled\n",
+            harness.Controllers.size() - static_cast<size_t>(harness.HeldControlReadsCanceled));
+        return 1;
+    }
+
+    if (config.MaxFirstReportMilliseconds >= 0.0)
+    {
+        if (firstReport.size() != harness.Controllers.size())
+        {
+            fprintf(stderr, "%zu controller(s) never reported\n", harness.Controllers.size() - firstReport.size());
+            return 1;
+        }
+
+        if (static_cast<double>(slowestFirstReport) / 10000.0 > config.MaxFirstReportMilliseconds)
+        {
+            fprintf(stderr, "first report took %.2f ms, at most %.2f ms expected\n",
+                static_cast<double>(slowestFirstReport) / 10000.0, config.MaxFirstReportMilliseconds);
+            return 1;
+        }
+    }
+
+    //
+    // The radio registry must account for every controller on its radio
+    // 
+    if (!harness.Controllers.empty())
+    {
+        BTHPS3_GET_RADIO_LOAD load = {};
+        SIM_IO_RESULT loadResult = {};
+
+        (void)SimDeviceIoControl(
+            harness.Controllers.front().Device,
+            IOCTL_BTHPS3_GET_RADIO_LOAD,
+            nullptr,
+            0,
+            &load,
+            sizeof(load),
+            EvtRadioLoadCompleted,
+            &loadResult
+        );
+        (void)SimRunUntilIdle(~0ULL);
+
+        if (!NT_SUCCESS(loadResult.Status) || load.RadioCount != radios.size())
+        {
+            fprintf(stderr, "radio load query failed\n");
+            return 1;
+        }
+
+        for (ULONG index = 0; index < load.RadioCount; index++)
+        {
+            const BTHPS3_RADIO_LOAD& radio = load.Radios[index];
+            const ULONG expected = (config.Controllers / config.Radios)
+                + (index < config.Controllers % config.Radios ? 1 : 0);
+
+            printf("radio %012llX      %u link(s), %llu bytes\n",
+                static_cast<unsigned long long>(radio.RadioAddress),
+                radio.ActiveLinks,
+                static_cast<unsigned long long>(radio.BytesTransferred)
+            );
+
+            if (radio.ActiveLinks != expected)
+            {
+                fprintf(stderr, "radio %u reports %u link(s), expected %u\n", index, radio.ActiveLinks, expected);
+                return 1;
+            }
+        }
+    }
+
+    //
+    // Every BRB handed out must have come back
+    // 
+    if (drained.BrbAllocations != drained.BrbFrees)
+    {
+        fprintf(stderr, "%llu BRB(s) leaked\n",
+            static_cast<unsigned long long>(drained.BrbAllocations - drained.BrbFrees));
+        return 1;
+    }
+
+    SimReset();
+
+    return 0;
+}
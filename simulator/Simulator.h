@@ -0,0 +1,536 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// Entry points of the user-mode simulator. The framework half stands in for
+// KMDF, DMF and the I/O manager, the BTHPORT half for the Bluetooth stack
+// and the remote devices, SimDriver.c wires the bus driver's own contexts
+// to both. Everything runs on one thread against a virtual clock.
+// 
+
+#include <ntddk.h>
+#include <wdf.h>
+#include <bthddi.h>
+#include <DmfModules.Library.h>
+#include <BthPS3.h>
+
+EXTERN_C_START
+
+#pragma region Clock and events
+
+//
+// Virtual interrupt time in 100ns units, advanced by the event loop only
+// 
+ULONG64
+SimNow(
+    VOID
+);
+
+//
+// Host monotonic clock in nanoseconds, for measuring driver code
+// 
+ULONG64
+SimHostNanoseconds(
+    VOID
+);
+
+typedef VOID SIM_EVENT_CALLBACK(
+    _In_opt_ PVOID Context
+);
+
+//
+// Runs Callback once the virtual clock advanced by Delay, events due at the
+// same time run in the order they got posted
+// 
+VOID
+SimPost(
+    _In_ ULONG64 Delay,
+    _In_ SIM_EVENT_CALLBACK* Callback,
+    _In_opt_ PVOID Context
+);
+
+//
+// Runs all events due up to Time, the clock ends up at Time
+// 
+VOID
+SimRunUntil(
+    _In_ ULONG64 Time
+);
+
+//
+// Runs events until none are left, returns FALSE if MaxEvents ran out first
+// 
+BOOLEAN
+SimRunUntilIdle(
+    _In_ ULONG64 MaxEvents
+);
+
+//
+// Deletes all objects, drops pending events and rewinds the clock
+// 
+VOID
+SimReset(
+    VOID
+);
+
+#pragma endregion
+
+#pragma region Counters
+
+//
+// Cumulative since the last SimReset, take deltas around a run
+// 
+typedef struct _SIM_COUNTERS
+{
+    //
+    // WdfMemoryCreate calls and bytes requested by the driver
+    // 
+    ULONG64 MemoryAllocations;
+    ULONG64 MemoryBytes;
+
+    //
+    // WdfMemoryCreatePreallocated calls, wrap existing buffers
+    // 
+    ULONG64 PreallocatedMemoryObjects;
+
+    //
+    // WdfRequestCreate calls
+    // 
+    ULONG64 RequestsCreated;
+
+    //
+    // BRBs handed out by BthAllocateBrb and returned by BthFreeBrb
+    // 
+    ULONG64 BrbAllocations;
+    ULONG64 BrbFrees;
+
+    //
+    // System buffers the I/O manager allocated for buffered requests and
+    // the bytes it copied between them and the caller's buffers
+    // 
+    ULONG64 IoManagerBuffers;
+    ULONG64 IoManagerBytesCopied;
+
+    //
+    // Client requests completed
+    // 
+    ULONG64 RequestsCompleted;
+
+    //
+    // Framework objects not deleted yet
+    // 
+    ULONG64 LiveObjects;
+
+} SIM_COUNTERS, * PSIM_COUNTERS;
+
+VOID
+SimGetCounters(
+    _Out_ PSIM_COUNTERS Counters
+);
+
+//
+// For allocations done on the driver's behalf outside the framework
+// 
+VOID
+SimCountBrbAllocation(
+    _In_ BOOLEAN IsFree
+);
+
+#pragma endregion
+
+#pragma region Registry
+
+//
+// Values under the Parameters key, unset ones are reported as missing
+// 
+VOID
+SimRegistrySetULong(
+    _In_ const WCHAR* Name,
+    _In_ ULONG Value
+);
+
+#pragma endregion
+
+#pragma region Devices and targets
+
+//
+// Stand-in for the PnP manager's device init, consumed by SimDeviceCreate
+// 
+PWDFDEVICE_INIT
+SimDeviceInitAllocate(
+    VOID
+);
+
+//
+// WdfDeviceCreate, DeviceInit may be NULL for devices nobody configured
+// 
+NTSTATUS
+SimDeviceCreate(
+    _Inout_opt_ PWDFDEVICE_INIT* DeviceInit,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _Out_ WDFDEVICE* Device
+);
+
+//
+// Enters D0, runs the self-managed I/O initialization set up in DeviceInit
+// 
+NTSTATUS
+SimDeviceStart(
+    _In_ WDFDEVICE Device
+);
+
+//
+// IoctlHandler instance owning the default queue of Device and dispatching
+// through the given table
+// 
+NTSTATUS
+SimDmfIoctlHandlerCreate(
+    _In_ WDFDEVICE Device,
+    _In_reads_(IoctlRecordCount) const IoctlHandler_IoctlRecord* IoctlRecords,
+    _In_ ULONG IoctlRecordCount,
+    _Out_ DMFMODULE* Module
+);
+
+//
+// Last idle timeout the power policy accepted, 0 if none
+// 
+ULONG
+SimDeviceGetIdleTimeout(
+    _In_ WDFDEVICE Device
+);
+
+//
+// A lower driver receiving what the bus driver sends to an I/O target.
+// Submit takes ownership of Request until it is passed to
+// SimIoTargetCompleteRequest, Cancel returns FALSE if it already let go.
+// 
+typedef VOID SIM_EVT_IO_TARGET_SUBMIT(
+    _In_ PVOID Context,
+    _In_ WDFREQUEST Request,
+    _In_ ULONG IoControlCode,
+    _In_opt_ PVOID InputBuffer,
+    _In_ size_t InputBufferLength
+);
+
+typedef BOOLEAN SIM_EVT_IO_TARGET_CANCEL(
+    _In_ PVOID Context,
+    _In_ WDFREQUEST Request
+);
+
+NTSTATUS
+SimIoTargetCreate(
+    _In_ WDFDEVICE Device,
+    _In_ SIM_EVT_IO_TARGET_SUBMIT* EvtSubmit,
+    _In_ SIM_EVT_IO_TARGET_CANCEL* EvtCancel,
+    _In_opt_ PVOID Context,
+    _Out_ WDFIOTARGET* IoTarget
+);
+
+VOID
+SimIoTargetCompleteRequest(
+    _In_ WDFREQUEST Request,
+    _In_ NTSTATUS Status,
+    _In_ ULONG_PTR Information
+);
+
+//
+// Travels with the request to the client's completion, the virtual BTHPORT
+// stores the time the delivered report got generated at
+// 
+VOID
+SimRequestSetTag(
+    _In_ WDFREQUEST Request,
+    _In_ ULONG64 Tag
+);
+
+#pragma endregion
+
+#pragma region Client I/O
+
+typedef struct _SIM_IO_RESULT
+{
+    NTSTATUS Status;
+
+    ULONG_PTR Information;
+
+    //
+    // Set by the lower driver, see SimRequestSetTag
+    // 
+    ULONG64 Tag;
+
+    //
+    // Virtual times the request got issued and completed at
+    // 
+    ULONG64 IssueTime;
+    ULONG64 CompletionTime;
+
+    //
+    // Host nanoseconds spent from issuing until the request reached the
+    // lower driver (or got completed without it)
+    // 
+    ULONG64 SubmitNanoseconds;
+
+    //
+    // Host nanoseconds spent from the lower driver's completion until the
+    // result got handed to the client, 0 if it never got sent down
+    // 
+    ULONG64 CompletionNanoseconds;
+
+} SIM_IO_RESULT, * PSIM_IO_RESULT;
+
+typedef const SIM_IO_RESULT* PCSIM_IO_RESULT;
+
+typedef VOID SIM_IO_COMPLETION(
+    _In_opt_ PVOID Context,
+    _In_ PCSIM_IO_RESULT Result
+);
+
+//
+// DeviceIoControl against Device, buffers are handled like the I/O manager
+// does for the transfer method of IoControlCode. Completion runs in the
+// context of whoever completes the request. Returns an identifier for
+// SimCancelIo.
+// 
+ULONG64
+SimDeviceIoControl(
+    _In_ WDFDEVICE Device,
+    _In_ ULONG IoControlCode,
+    _In_reads_bytes_opt_(InputBufferLength) PVOID InputBuffer,
+    _In_ size_t InputBufferLength,
+    _Out_writes_bytes_opt_(OutputBufferLength) PVOID OutputBuffer,
+    _In_ size_t OutputBufferLength,
+    _In_ SIM_IO_COMPLETION* Completion,
+    _In_opt_ PVOID Context
+);
+
+//
+// CancelIoEx, returns FALSE if the request completed already
+// 
+BOOLEAN
+SimCancelIo(
+    _In_ ULONG64 Identifier
+);
+
+#pragma endregion
+
+#pragma region Virtual BTHPORT
+
+typedef struct _SIM_REMOTE* PSIM_REMOTE;
+
+typedef struct _SIM_REMOTE_CONFIG
+{
+    DS_DEVICE_TYPE DeviceType;
+
+    //
+    // Input reports per second on the interrupt channel, 0 for none
+    // 
+    ULONG ReportRate;
+
+    //
+    // Air and stack latency of every packet in either direction, each
+    // packet deviates by up to Jitter (100ns units)
+    // 
+    ULONG64 Latency;
+    ULONG64 Jitter;
+
+    //
+    // Input reports held per channel while no read is pending, the oldest
+    // one is dropped beyond that
+    // 
+    ULONG InboundLimit;
+
+    //
+    // Stays silent until the report enable command (SET_REPORT feature
+    // 0xF4) arrived on the control channel, like a real SIXAXIS
+    // 
+    BOOLEAN IsSilentUntilEnabled;
+
+    ULONG Seed;
+
+} SIM_REMOTE_CONFIG, * PSIM_REMOTE_CONFIG;
+
+typedef const SIM_REMOTE_CONFIG* PCSIM_REMOTE_CONFIG;
+
+typedef struct _SIM_REMOTE_STATS
+{
+    ULONG64 ReportsGenerated;
+
+    ULONG64 ReportsDelivered;
+
+    //
+    // Overwritten while waiting for a read
+    // 
+    ULONG64 ReportsDropped;
+
+    //
+    // Packets received from the host per channel
+    // 
+    ULONG64 ControlPacketsOut;
+    ULONG64 InterruptPacketsOut;
+
+    //
+    // HANDSHAKE and DATA answers sent on the control channel
+    // 
+    ULONG64 ControlResponses;
+
+} SIM_REMOTE_STATS, * PSIM_REMOTE_STATS;
+
+//
+// Observes the packets the host sent to a remote, in order of arrival
+// 
+typedef VOID SIM_EVT_REMOTE_PACKET(
+    _In_opt_ PVOID Context,
+    _In_ BOOLEAN IsControlChannel,
+    _In_reads_bytes_(Length) const UCHAR* Packet,
+    _In_ ULONG Length
+);
+
+//
+// BTHPORT instance of a radio, fills in the profile driver interface
+// 
+NTSTATUS
+SimBthportRadioCreate(
+    _In_ WDFDEVICE Radio,
+    _Out_ WDFIOTARGET* IoTarget,
+    _Out_ PBTH_PROFILE_DRIVER_INTERFACE Interface
+);
+
+//
+// Brings up both HID channels to a remote and starts its report stream
+// 
+NTSTATUS
+SimBthportRemoteConnect(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ BTH_ADDR RemoteAddress,
+    _In_ PCSIM_REMOTE_CONFIG Config,
+    _Out_ L2CAP_CHANNEL_HANDLE* ControlChannel,
+    _Out_ L2CAP_CHANNEL_HANDLE* InterruptChannel,
+    _Out_ PSIM_REMOTE* Remote
+);
+
+//
+// Stops generating reports, pending transfers are not affected
+// 
+VOID
+SimBthportRemoteStop(
+    _In_ PSIM_REMOTE Remote
+);
+
+//
+// Queues Packet for delivery on one of the channels after Delay
+// 
+VOID
+SimBthportRemoteInject(
+    _In_ PSIM_REMOTE Remote,
+    _In_ BOOLEAN IsControlChannel,
+    _In_reads_bytes_(Length) const UCHAR* Packet,
+    _In_ ULONG Length,
+    _In_ ULONG64 Delay
+);
+
+VOID
+SimBthportRemoteSetPacketObserver(
+    _In_ PSIM_REMOTE Remote,
+    _In_opt_ SIM_EVT_REMOTE_PACKET* EvtPacket,
+    _In_opt_ PVOID Context
+);
+
+VOID
+SimBthportRemoteGetStats(
+    _In_ PSIM_REMOTE Remote,
+    _Out_ PSIM_REMOTE_STATS Stats
+);
+
+#pragma endregion
+
+#pragma region Bus driver
+
+//
+// Creates the driver object and the radio registry
+// 
+NTSTATUS
+SimDriverInitialize(
+    VOID
+);
+
+//
+// Radio device with a server context, as Device.c creates it
+// 
+NTSTATUS
+SimDriverRadioAdd(
+    _In_ BTH_ADDR LocalAddress,
+    _Out_ WDFDEVICE* Radio
+);
+
+//
+// Allows feature report ReportId into the radio's cache, as the
+// FeatureReportCacheIds value does
+// 
+VOID
+SimDriverRadioAllowFeatureReport(
+    _In_ WDFDEVICE Radio,
+    _In_ UCHAR ReportId
+);
+
+//
+// Has the radio send the SIXAXIS report enable command at channel-up, as
+// the SIXAXISEnableOnConnect value does
+// 
+VOID
+SimDriverRadioSetSixaxisEnableOnConnect(
+    _In_ WDFDEVICE Radio,
+    _In_ BOOLEAN IsEnabled
+);
+
+//
+// Child device with both HID channels connected, as BusLogic.c and
+// L2CAP.c set it up
+// 
+NTSTATUS
+SimDriverChildAdd(
+    _In_ WDFDEVICE Radio,
+    _In_ BTH_ADDR RemoteAddress,
+    _In_ PCSIM_REMOTE_CONFIG Config,
+    _Out_ WDFDEVICE* Child,
+    _Out_ PSIM_REMOTE* Remote
+);
+
+#pragma endregion
+
+EXTERN_C_END
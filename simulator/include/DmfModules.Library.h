@@ -0,0 +1,118 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// The DMF surface the bus driver's I/O path touches. Only IoctlHandler
+// is emulated, its table dispatch lives in SimFramework.cpp.
+// 
+
+#include <ntddk.h>
+#include <wdf.h>
+
+EXTERN_C_START
+
+SIM_DECLARE_HANDLE(DMFMODULE);
+
+typedef struct DMFMODULE_INIT* PDMFMODULE_INIT;
+typedef struct DMFDEVICE_INIT* PDMFDEVICE_INIT;
+typedef struct _PDO_RECORD PDO_RECORD;
+
+typedef NTSTATUS EVT_DMF_IoctlHandler_Callback(
+    _In_ DMFMODULE DmfModule,
+    _In_ WDFQUEUE Queue,
+    _In_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_reads_(InputBufferSize) VOID* InputBuffer,
+    _In_ size_t InputBufferSize,
+    _Out_writes_(OutputBufferSize) VOID* OutputBuffer,
+    _In_ size_t OutputBufferSize,
+    _Out_ size_t* BytesReturned
+);
+
+typedef struct
+{
+    ULONG IoctlCode;
+    ULONG InputBufferMinimumSize;
+    ULONG OutputBufferMinimumSize;
+    EVT_DMF_IoctlHandler_Callback* EvtIoctlHandlerFunction;
+    BOOLEAN AdministratorAccessOnly;
+
+} IoctlHandler_IoctlRecord;
+
+typedef enum
+{
+    ScheduledTask_WorkResult_Invalid,
+    ScheduledTask_WorkResult_Success,
+    ScheduledTask_WorkResult_Fail,
+    ScheduledTask_WorkResult_FailButTryAgain,
+    ScheduledTask_WorkResult_SuccessButTryAgain
+
+} ScheduledTask_Result_Type;
+
+typedef ScheduledTask_Result_Type EVT_DMF_QueuedWorkItem_Callback(
+    _In_ DMFMODULE DmfModule,
+    _In_ VOID* ClientBuffer,
+    _In_ VOID* ClientBufferContext
+);
+
+typedef NTSTATUS EVT_DMF_Pdo_PreCreate(
+    _In_ DMFMODULE DmfModule,
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_ PDMFDEVICE_INIT DmfDeviceInit,
+    _In_ PDO_RECORD* PdoRecord
+);
+
+typedef NTSTATUS EVT_DMF_Pdo_PostCreate(
+    _In_ DMFMODULE DmfModule,
+    _In_ WDFDEVICE ChildDevice,
+    _In_ PDMFDEVICE_INIT DmfDeviceInit,
+    _In_ PDO_RECORD* PdoRecord
+);
+
+typedef VOID EVT_DMF_DEVICE_MODULES_ADD(
+    _In_ WDFDEVICE Device,
+    _In_ PDMFMODULE_INIT DmfModuleInit
+);
+
+WDFDEVICE
+DMF_ParentDeviceGet(
+    _In_ DMFMODULE DmfModule
+);
+
+EXTERN_C_END
@@ -0,0 +1,189 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// Bluetooth profile DDI as far as ACL transfers and indications go, BRBs
+// of other types are rejected by the virtual BTHPORT
+// 
+
+#include <ntddk.h>
+#include <bthdef.h>
+
+EXTERN_C_START
+
+typedef PVOID L2CAP_CHANNEL_HANDLE, * PL2CAP_CHANNEL_HANDLE;
+typedef PVOID L2CAP_SERVER_HANDLE, * PL2CAP_SERVER_HANDLE;
+
+#define BTHPORT_CONTEXT_SIZE            4
+#define BTHPORT_RESERVED_FIELD_SIZE     2
+
+typedef enum _BRB_TYPE
+{
+    BRB_HCI_GET_LOCAL_BD_ADDR = 0x0001,
+    BRB_L2CA_REGISTER_SERVER = 0x0100,
+    BRB_L2CA_UNREGISTER_SERVER = 0x0101,
+    BRB_L2CA_OPEN_CHANNEL = 0x0102,
+    BRB_L2CA_OPEN_CHANNEL_RESPONSE = 0x0103,
+    BRB_L2CA_CLOSE_CHANNEL = 0x0104,
+    BRB_L2CA_ACL_TRANSFER = 0x0105,
+    BRB_L2CA_UPDATE_CHANNEL = 0x0106,
+    BRB_L2CA_PING = 0x0107,
+    BRB_REGISTER_PSM = 0x0108,
+    BRB_UNREGISTER_PSM = 0x0109
+
+} BRB_TYPE;
+
+typedef struct _BRB_HEADER
+{
+    LIST_ENTRY ListEntry;
+    ULONG Length;
+    USHORT Version;
+    USHORT Type;
+    ULONG BthportFlags;
+    NTSTATUS Status;
+    BTHSTATUS BtStatus;
+    PVOID Context[BTHPORT_CONTEXT_SIZE];
+    PVOID ClientContext[BTHPORT_CONTEXT_SIZE];
+    ULONG Reserved[BTHPORT_RESERVED_FIELD_SIZE];
+
+} BRB_HEADER;
+
+#define ACL_TRANSFER_DIRECTION_IN       0x00000001
+#define ACL_TRANSFER_DIRECTION_OUT      0x00000000
+#define ACL_SHORT_TRANSFER_OK           0x00000002
+
+struct _BRB_L2CA_ACL_TRANSFER
+{
+    BRB_HEADER Hdr;
+    BTH_ADDR BtAddress;
+    L2CAP_CHANNEL_HANDLE ChannelHandle;
+    ULONG TransferFlags;
+    ULONG BufferSize;
+    PVOID Buffer;
+    PMDL BufferMDL;
+    LONGLONG Timeout;
+    ULONG RemainingBufferSize;
+};
+
+typedef struct _BRB
+{
+    union
+    {
+        BRB_HEADER BrbHeader;
+        struct _BRB_L2CA_ACL_TRANSFER BrbL2caAclTransfer;
+    };
+
+} BRB, * PBRB;
+
+typedef enum _INDICATION_CODE
+{
+    IndicationAddReference = 0,
+    IndicationReleaseReference,
+    IndicationRemoteConnect,
+    IndicationRemoteDisconnect,
+    IndicationRemoteConfigRequest,
+    IndicationRemoteConfigResponse,
+    IndicationFreeExtraOptions,
+    IndicationRecvPacket,
+    IndicationPairDevice,
+    IndicationUnpairDevice,
+    IndicationUnpersonalizeDevice
+
+} INDICATION_CODE, * PINDICATION_CODE;
+
+typedef enum _L2CAP_DISCONNECT_REASON
+{
+    HciDisconnect = 1,
+    L2capDisconnectRequest,
+    RadioPoweredDown,
+    HardwareRemoval
+
+} L2CAP_DISCONNECT_REASON;
+
+typedef struct _INDICATION_PARAMETERS
+{
+    L2CAP_CHANNEL_HANDLE ConnectionHandle;
+    BTH_ADDR BtAddress;
+
+    union
+    {
+        struct
+        {
+            struct
+            {
+                USHORT PSM;
+            } Request;
+        } Connect;
+
+        struct
+        {
+            L2CAP_DISCONNECT_REASON Reason;
+            BOOLEAN CloseNow;
+        } Disconnect;
+
+    } Parameters;
+
+} INDICATION_PARAMETERS, * PINDICATION_PARAMETERS;
+
+typedef PBRB (*PFNBTH_ALLOCATE_BRB)(_In_ BRB_TYPE BrbType, _In_ ULONG PoolTag);
+typedef VOID (*PFNBTH_FREE_BRB)(_In_ PBRB Brb);
+typedef VOID (*PFNBTH_INITIALIZE_BRB)(_Inout_ PBRB Brb, _In_ BRB_TYPE BrbType);
+typedef VOID (*PFNBTH_REUSE_BRB)(_Inout_ PBRB Brb, _In_ BRB_TYPE BrbType);
+
+typedef struct _INTERFACE
+{
+    USHORT Size;
+    USHORT Version;
+    PVOID Context;
+    PVOID InterfaceReference;
+    PVOID InterfaceDereference;
+
+} INTERFACE, * PINTERFACE;
+
+typedef struct _BTH_PROFILE_DRIVER_INTERFACE
+{
+    INTERFACE Interface;
+    PFNBTH_ALLOCATE_BRB BthAllocateBrb;
+    PFNBTH_FREE_BRB BthFreeBrb;
+    PFNBTH_INITIALIZE_BRB BthInitializeBrb;
+    PFNBTH_REUSE_BRB BthReuseBrb;
+
+} BTH_PROFILE_DRIVER_INTERFACE, * PBTH_PROFILE_DRIVER_INTERFACE;
+
+EXTERN_C_END
@@ -0,0 +1,494 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// Kernel environment of the simulator, builds on the portable shim and
+// adds what the bus driver's I/O path expects from ntddk.h. Everything the
+// shim already provides is left alone.
+// 
+
+#include <limits.h>
+#include <BthPS3Portable.h>
+
+#ifdef __cplusplus
+#define EXTERN_C                        extern "C"
+#define EXTERN_C_START                  extern "C" {
+#define EXTERN_C_END                    }
+#else
+#define EXTERN_C                        extern
+#define EXTERN_C_START
+#define EXTERN_C_END
+#endif
+
+//
+// Annotations the shim has no use for
+// 
+#define _Outptr_
+#define _Outptr_opt_
+#define _Outptr_result_maybenull_
+#define _Outptr_result_bytebuffer_(_n_)
+#define _Outptr_opt_result_bytebuffer_(_n_)
+#define _Out_writes_bytes_opt_(_n_)
+#define _Out_writes_opt_(_n_)
+#define _In_reads_opt_(_n_)
+#define _Inout_updates_bytes_opt_(_n_)
+#define _When_(_e_, _a_)
+#define _IRQL_raises_(_irql_)
+#define _IRQL_saves_
+#define _IRQL_restores_
+#define _Requires_lock_held_(_l_)
+#define _Releases_lock_(_l_)
+#define _Acquires_lock_(_l_)
+#define _Analysis_assume_(_e_)
+#define _Success_(_e_)
+#define _Function_class_(_c_)
+#define _Strict_type_match_
+#define _Null_terminated_
+#define _Post_writable_byte_size_(_s_)
+#define _Printf_format_string_
+
+EXTERN_C_START
+
+typedef int8_t CCHAR;
+typedef int16_t CSHORT;
+typedef uint8_t KIRQL, * PKIRQL;
+typedef intptr_t LONG_PTR;
+typedef ULONG_PTR KAFFINITY;
+typedef ULONG ACCESS_MASK;
+typedef ULONG DEVICE_TYPE;
+typedef PVOID HANDLE;
+typedef ULONG_PTR* PULONG_PTR;
+typedef LONG KPRIORITY;
+typedef ULONG LOGICAL;
+typedef SIZE_T* PSIZE_T;
+typedef const UCHAR* PCUCHAR;
+typedef WCHAR* PWSTR, * PWCH;
+typedef char* PSTR;
+typedef NTSTATUS* PNTSTATUS;
+typedef LONGLONG* PLONGLONG;
+
+#define PASSIVE_LEVEL                   0
+#define APC_LEVEL                       1
+#define DISPATCH_LEVEL                  2
+
+#define MAXUCHAR                        0xFF
+#define MAXUSHORT                       0xFFFF
+#define MAXLONG                         0x7FFFFFFF
+
+#define STATUS_PENDING                  ((NTSTATUS)0x00000103L)
+#define STATUS_MORE_PROCESSING_REQUIRED ((NTSTATUS)0xC0000016L)
+#define STATUS_CONTINUE_COMPLETION      STATUS_SUCCESS
+#define STATUS_BUFFER_OVERFLOW          ((NTSTATUS)0x80000005L)
+#define STATUS_NOT_IMPLEMENTED          ((NTSTATUS)0xC0000002L)
+#define STATUS_INVALID_HANDLE           ((NTSTATUS)0xC0000008L)
+#define STATUS_INVALID_DEVICE_REQUEST   ((NTSTATUS)0xC0000010L)
+#define STATUS_NO_MEMORY                ((NTSTATUS)0xC0000017L)
+#define STATUS_ACCESS_DENIED            ((NTSTATUS)0xC0000022L)
+#define STATUS_OBJECT_NAME_NOT_FOUND    ((NTSTATUS)0xC0000034L)
+#define STATUS_OBJECT_NAME_COLLISION    ((NTSTATUS)0xC0000035L)
+#define STATUS_INSUFFICIENT_RESOURCES   ((NTSTATUS)0xC000009AL)
+#define STATUS_DEVICE_BUSY              ((NTSTATUS)0x80000011L)
+#define STATUS_NOT_SUPPORTED            ((NTSTATUS)0xC00000BBL)
+#define STATUS_CANCELLED                ((NTSTATUS)0xC0000120L)
+#define STATUS_INVALID_DEVICE_STATE     ((NTSTATUS)0xC0000184L)
+#define STATUS_DEVICE_NOT_CONNECTED     ((NTSTATUS)0xC000009DL)
+#define STATUS_CRC_ERROR                ((NTSTATUS)0xC000003FL)
+#define STATUS_NOT_FOUND                ((NTSTATUS)0xC0000225L)
+#define STATUS_NO_MORE_ENTRIES          ((NTSTATUS)0x8000001AL)
+#define STATUS_INVALID_BUFFER_SIZE      ((NTSTATUS)0xC0000206L)
+#define STATUS_TIMEOUT                  ((NTSTATUS)0x00000102L)
+#define STATUS_DEVICE_DOES_NOT_EXIST    ((NTSTATUS)0xC00000C0L)
+#define STATUS_REQUEST_ABORTED          ((NTSTATUS)0xC0000240L)
+#define STATUS_ALREADY_REGISTERED       ((NTSTATUS)0xC0000718L)
+#define STATUS_IO_TIMEOUT               ((NTSTATUS)0xC00000B5L)
+
+#define STANDARD_RIGHTS_READ            0x00020000L
+#define STANDARD_RIGHTS_ALL             0x001F0000L
+#define KEY_READ                        0x00020019L
+#define KEY_WRITE                       0x00020006L
+
+#define ANSI_NULL                       ((CHAR)0)
+#define UNICODE_NULL                    ((WCHAR)0)
+
+#define FIELD_OFFSET(_type_, _field_)   offsetof(_type_, _field_)
+#define RTL_FIELD_SIZE(_type_, _field_) (sizeof(((_type_*)0)->_field_))
+#define CONTAINING_RECORD(_address_, _type_, _field_) \
+    ((_type_*)((PUCHAR)(_address_) - offsetof(_type_, _field_)))
+
+#define ALIGN_DOWN_BY(_length_, _alignment_) \
+    ((ULONG_PTR)(_length_) & ~((ULONG_PTR)(_alignment_) - 1))
+#define ALIGN_UP_BY(_length_, _alignment_) \
+    (ALIGN_DOWN_BY(((ULONG_PTR)(_length_) + (_alignment_) - 1), (_alignment_)))
+#define ALIGN_UP_POINTER_BY(_pointer_, _alignment_) \
+    ((PVOID)ALIGN_UP_BY((_pointer_), (_alignment_)))
+
+#define METHOD_FROM_CTL_CODE(_code_)   ((ULONG)((_code_) & 3))
+#define DEVICE_TYPE_FROM_CTL_CODE(_code_) (((ULONG)(_code_) & 0xFFFF0000) >> 16)
+
+#define SYSTEM_CACHE_ALIGNMENT_SIZE     64
+#define ALL_PROCESSOR_GROUPS            0xFFFF
+
+#define PAGED_CODE()                    ((void)0)
+#define PAGED_CODE_LOCKED()             ((void)0)
+#define NT_VERIFY(_exp_)                ((void)(_exp_))
+#define ASSERT(_exp_)                   assert(_exp_)
+
+#define RtlFillMemory(_d_, _l_, _f_)    memset((_d_), (_f_), (_l_))
+#define RtlMoveMemory(_d_, _s_, _l_)    memmove((_d_), (_s_), (_l_))
+#define RtlCompareMemory(_a_, _b_, _l_) SimRtlCompareMemory((_a_), (_b_), (_l_))
+
+#ifndef InterlockedAdd
+#define InterlockedAdd(_p_, _v_)        __atomic_add_fetch((_p_), (_v_), __ATOMIC_SEQ_CST)
+#endif
+#ifndef InterlockedAdd64
+#define InterlockedAdd64(_p_, _v_)      __atomic_add_fetch((_p_), (_v_), __ATOMIC_SEQ_CST)
+#endif
+#ifndef InterlockedExchange
+#define InterlockedExchange(_p_, _v_)   __atomic_exchange_n((_p_), (_v_), __ATOMIC_SEQ_CST)
+#endif
+#ifndef InterlockedExchangePointer
+#define InterlockedExchangePointer(_p_, _v_) __atomic_exchange_n((_p_), (_v_), __ATOMIC_SEQ_CST)
+#endif
+#ifndef InterlockedDecrement64
+#define InterlockedDecrement64(_p_)     __atomic_sub_fetch((_p_), 1, __ATOMIC_SEQ_CST)
+#endif
+#ifndef InterlockedOr
+#define InterlockedOr(_p_, _v_)         __atomic_fetch_or((_p_), (_v_), __ATOMIC_SEQ_CST)
+#endif
+#ifndef InterlockedAnd
+#define InterlockedAnd(_p_, _v_)        __atomic_fetch_and((_p_), (_v_), __ATOMIC_SEQ_CST)
+#endif
+#ifndef ReadNoFence64
+#define ReadNoFence64(_p_)              __atomic_load_n((_p_), __ATOMIC_RELAXED)
+#endif
+#ifndef ReadAcquire
+#define ReadAcquire(_p_)                __atomic_load_n((_p_), __ATOMIC_ACQUIRE)
+#endif
+#ifndef WriteRelease
+#define WriteRelease(_p_, _v_)          __atomic_store_n((_p_), (_v_), __ATOMIC_RELEASE)
+#endif
+
+FORCEINLINE
+LONG
+SimInterlockedCompareExchange(
+    volatile LONG* Destination,
+    LONG Exchange,
+    LONG Comperand
+)
+{
+    __atomic_compare_exchange_n(Destination, &Comperand, Exchange, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return Comperand;
+}
+
+#define InterlockedCompareExchange      SimInterlockedCompareExchange
+
+typedef union _LARGE_INTEGER
+{
+    struct
+    {
+        ULONG LowPart;
+        LONG HighPart;
+    };
+
+    LONGLONG QuadPart;
+
+} LARGE_INTEGER, * PLARGE_INTEGER;
+
+typedef struct _LIST_ENTRY
+{
+    struct _LIST_ENTRY* Flink;
+    struct _LIST_ENTRY* Blink;
+
+} LIST_ENTRY, * PLIST_ENTRY;
+
+typedef struct _UNICODE_STRING
+{
+    USHORT Length;
+    USHORT MaximumLength;
+    PWCH Buffer;
+
+} UNICODE_STRING, * PUNICODE_STRING;
+
+typedef const UNICODE_STRING* PCUNICODE_STRING;
+
+typedef struct _STRING
+{
+    USHORT Length;
+    USHORT MaximumLength;
+    PCHAR Buffer;
+
+} ANSI_STRING, * PANSI_STRING, STRING, * PSTRING;
+
+#define DECLARE_CONST_UNICODE_STRING(_var_, _string_) \
+    const UNICODE_STRING _var_ = { sizeof(_string_) - sizeof(WCHAR), sizeof(_string_), (PWCH)(_string_) }
+#define DECLARE_UNICODE_STRING_SIZE(_var_, _size_) \
+    WCHAR _var_ ## _buffer[_size_]; \
+    UNICODE_STRING _var_ = { 0, (_size_) * sizeof(WCHAR), _var_ ## _buffer }
+#define RTL_CONSTANT_STRING(_s_)        { sizeof(_s_) - sizeof((_s_)[0]), sizeof(_s_), (PWCH)(_s_) }
+
+//
+// Kernel objects the driver embeds by value, never waited on in the
+// single threaded simulation
+// 
+typedef struct _KEVENT
+{
+    LONG Signaled;
+
+} KEVENT, * PKEVENT, * PRKEVENT;
+
+typedef enum _EVENT_TYPE
+{
+    NotificationEvent,
+    SynchronizationEvent
+
+} EVENT_TYPE;
+
+typedef ULONG_PTR KSPIN_LOCK, * PKSPIN_LOCK;
+
+typedef enum _POOL_TYPE
+{
+    NonPagedPool,
+    PagedPool = 1,
+    NonPagedPoolNx = 512
+
+} POOL_TYPE;
+
+typedef enum _MM_PAGE_PRIORITY
+{
+    LowPagePriority,
+    NormalPagePriority = 16,
+    HighPagePriority = 32
+
+} MM_PAGE_PRIORITY;
+
+#define MdlMappingNoExecute             0x40000000
+
+//
+// Describes a caller buffer locked for direct I/O, in user mode the
+// buffer is always "mapped" at its original address
+// 
+typedef struct _MDL
+{
+    struct _MDL* Next;
+    CSHORT Size;
+    CSHORT MdlFlags;
+    PVOID MappedSystemVa;
+    PVOID StartVa;
+    ULONG ByteCount;
+    ULONG ByteOffset;
+
+} MDL, * PMDL;
+
+#define MmGetSystemAddressForMdlSafe(_mdl_, _priority_) ((void)(_priority_), (_mdl_)->MappedSystemVa)
+#define MmGetMdlByteCount(_mdl_)        ((_mdl_)->ByteCount)
+#define MmGetMdlVirtualAddress(_mdl_)   ((_mdl_)->StartVa)
+
+typedef struct _DRIVER_OBJECT* PDRIVER_OBJECT;
+typedef struct _DEVICE_OBJECT* PDEVICE_OBJECT;
+typedef struct _FILE_OBJECT* PFILE_OBJECT;
+
+typedef enum _SYSTEM_POWER_STATE
+{
+    PowerSystemUnspecified,
+    PowerSystemWorking,
+    PowerSystemSleeping1,
+    PowerSystemSleeping2,
+    PowerSystemSleeping3,
+    PowerSystemHibernate,
+    PowerSystemShutdown,
+    PowerSystemMaximum
+
+} SYSTEM_POWER_STATE;
+
+typedef enum _DEVICE_POWER_STATE
+{
+    PowerDeviceUnspecified,
+    PowerDeviceD0,
+    PowerDeviceD1,
+    PowerDeviceD2,
+    PowerDeviceD3,
+    PowerDeviceMaximum
+
+} DEVICE_POWER_STATE;
+
+typedef enum _POWER_STATE_TYPE
+{
+    SystemPowerState,
+    DevicePowerState
+
+} POWER_STATE_TYPE;
+
+typedef union _POWER_STATE
+{
+    SYSTEM_POWER_STATE SystemState;
+    DEVICE_POWER_STATE DeviceState;
+
+} POWER_STATE;
+
+typedef struct _IO_STATUS_BLOCK
+{
+    union
+    {
+        NTSTATUS Status;
+        PVOID Pointer;
+    };
+
+    ULONG_PTR Information;
+
+} IO_STATUS_BLOCK, * PIO_STATUS_BLOCK;
+
+//
+// Just enough IRP for power preprocessing code to compile, the simulator
+// never builds one
+// 
+typedef struct _IO_STACK_LOCATION
+{
+    UCHAR MajorFunction;
+    UCHAR MinorFunction;
+
+    union
+    {
+        struct
+        {
+            ULONG SystemContext;
+            POWER_STATE_TYPE Type;
+            POWER_STATE State;
+        } Power;
+
+    } Parameters;
+
+} IO_STACK_LOCATION, * PIO_STACK_LOCATION;
+
+typedef struct _IRP
+{
+    IO_STATUS_BLOCK IoStatus;
+    PIO_STACK_LOCATION CurrentStackLocation;
+
+} IRP, * PIRP;
+
+#define IO_NO_INCREMENT                 0
+#define IoGetCurrentIrpStackLocation(_irp_) ((_irp_)->CurrentStackLocation)
+#define IoSkipCurrentIrpStackLocation(_irp_) ((void)(_irp_))
+
+VOID
+IofCompleteRequest(
+    _In_ PIRP Irp,
+    _In_ CCHAR PriorityBoost
+);
+
+typedef NTSTATUS DRIVER_INITIALIZE(
+    _In_ PDRIVER_OBJECT DriverObject,
+    _In_ PUNICODE_STRING RegistryPath
+);
+
+typedef struct _PROCESSOR_NUMBER
+{
+    USHORT Group;
+    UCHAR Number;
+    UCHAR Reserved;
+
+} PROCESSOR_NUMBER, * PPROCESSOR_NUMBER;
+
+//
+// Interrupt time follows the simulator's virtual clock, the performance
+// counter is the host's monotonic clock in 100ns units
+// 
+ULONGLONG
+KeQueryInterruptTime(
+    VOID
+);
+
+LARGE_INTEGER
+KeQueryPerformanceCounter(
+    _Out_opt_ PLARGE_INTEGER PerformanceFrequency
+);
+
+ULONG
+KeQueryMaximumProcessorCountEx(
+    _In_ USHORT GroupNumber
+);
+
+ULONG
+KeGetCurrentProcessorNumberEx(
+    _Out_opt_ PPROCESSOR_NUMBER ProcNumber
+);
+
+KIRQL
+KeGetCurrentIrql(
+    VOID
+);
+
+VOID
+KeRaiseIrql(
+    _In_ KIRQL NewIrql,
+    _Out_ PKIRQL OldIrql
+);
+
+VOID
+KeLowerIrql(
+    _In_ KIRQL NewIrql
+);
+
+VOID
+KeInitializeEvent(
+    _Out_ PRKEVENT Event,
+    _In_ EVENT_TYPE Type,
+    _In_ BOOLEAN State
+);
+
+LONG
+KeSetEvent(
+    _Inout_ PRKEVENT Event,
+    _In_ KPRIORITY Increment,
+    _In_ BOOLEAN Wait
+);
+
+VOID
+KeClearEvent(
+    _Inout_ PRKEVENT Event
+);
+
+SIZE_T
+SimRtlCompareMemory(
+    _In_ const VOID* Source1,
+    _In_ const VOID* Source2,
+    _In_ SIZE_T Length
+);
+
+EXTERN_C_END
@@ -0,0 +1,1050 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#pragma once
+
+//
+// The subset of KMDF the bus driver's I/O path uses. Handles point at
+// simulator objects, see SimFramework.cpp for the semantics.
+// 
+
+#include <ntddk.h>
+
+EXTERN_C_START
+
+typedef PVOID WDFOBJECT, * PWDFOBJECT;
+typedef PVOID WDFCONTEXT;
+
+#define SIM_DECLARE_HANDLE(_name_) \
+    typedef struct _name_ ## __ { int Unused; } * _name_, ** P ## _name_
+
+SIM_DECLARE_HANDLE(WDFDRIVER);
+SIM_DECLARE_HANDLE(WDFDEVICE);
+SIM_DECLARE_HANDLE(WDFQUEUE);
+SIM_DECLARE_HANDLE(WDFREQUEST);
+SIM_DECLARE_HANDLE(WDFIOTARGET);
+SIM_DECLARE_HANDLE(WDFMEMORY);
+SIM_DECLARE_HANDLE(WDFSPINLOCK);
+SIM_DECLARE_HANDLE(WDFWAITLOCK);
+SIM_DECLARE_HANDLE(WDFCOLLECTION);
+SIM_DECLARE_HANDLE(WDFWORKITEM);
+SIM_DECLARE_HANDLE(WDFTIMER);
+SIM_DECLARE_HANDLE(WDFKEY);
+SIM_DECLARE_HANDLE(WDFSTRING);
+SIM_DECLARE_HANDLE(WDFFILEOBJECT);
+
+typedef struct WDFDEVICE_INIT* PWDFDEVICE_INIT;
+
+#define WDF_NO_OBJECT_ATTRIBUTES        NULL
+#define WDF_NO_SEND_OPTIONS             NULL
+#define WDF_NO_HANDLE                   NULL
+#define WDF_NO_CONTEXT                  NULL
+
+typedef enum _WDF_TRI_STATE
+{
+    WdfFalse = FALSE,
+    WdfTrue = TRUE,
+    WdfUseDefault = 2
+
+} WDF_TRI_STATE, * PWDF_TRI_STATE;
+
+typedef enum _WDF_EXECUTION_LEVEL
+{
+    WdfExecutionLevelInvalid = 0,
+    WdfExecutionLevelInheritFromParent,
+    WdfExecutionLevelPassive,
+    WdfExecutionLevelDispatch
+
+} WDF_EXECUTION_LEVEL;
+
+typedef enum _WDF_SYNCHRONIZATION_SCOPE
+{
+    WdfSynchronizationScopeInvalid = 0,
+    WdfSynchronizationScopeInheritFromParent,
+    WdfSynchronizationScopeDevice,
+    WdfSynchronizationScopeQueue,
+    WdfSynchronizationScopeNone
+
+} WDF_SYNCHRONIZATION_SCOPE;
+
+#pragma region Objects and contexts
+
+typedef struct _WDF_OBJECT_CONTEXT_TYPE_INFO
+{
+    ULONG Size;
+    PCHAR ContextName;
+    size_t ContextSize;
+    const struct _WDF_OBJECT_CONTEXT_TYPE_INFO* UniqueType;
+    PVOID EvtDriverGetUniqueContextType;
+
+} WDF_OBJECT_CONTEXT_TYPE_INFO, * PWDF_OBJECT_CONTEXT_TYPE_INFO;
+
+typedef const WDF_OBJECT_CONTEXT_TYPE_INFO* PCWDF_OBJECT_CONTEXT_TYPE_INFO;
+
+typedef VOID EVT_WDF_OBJECT_CONTEXT_CLEANUP(_In_ WDFOBJECT Object);
+typedef EVT_WDF_OBJECT_CONTEXT_CLEANUP* PFN_WDF_OBJECT_CONTEXT_CLEANUP;
+
+typedef VOID EVT_WDF_OBJECT_CONTEXT_DESTROY(_In_ WDFOBJECT Object);
+typedef EVT_WDF_OBJECT_CONTEXT_DESTROY* PFN_WDF_OBJECT_CONTEXT_DESTROY;
+
+typedef struct _WDF_OBJECT_ATTRIBUTES
+{
+    ULONG Size;
+    PFN_WDF_OBJECT_CONTEXT_CLEANUP EvtCleanupCallback;
+    PFN_WDF_OBJECT_CONTEXT_DESTROY EvtDestroyCallback;
+    WDF_EXECUTION_LEVEL ExecutionLevel;
+    WDF_SYNCHRONIZATION_SCOPE SynchronizationScope;
+    WDFOBJECT ParentObject;
+    size_t ContextSizeOverride;
+    PCWDF_OBJECT_CONTEXT_TYPE_INFO ContextTypeInfo;
+
+} WDF_OBJECT_ATTRIBUTES, * PWDF_OBJECT_ATTRIBUTES;
+
+FORCEINLINE
+VOID
+WDF_OBJECT_ATTRIBUTES_INIT(
+    _Out_ PWDF_OBJECT_ATTRIBUTES Attributes
+)
+{
+    RtlZeroMemory(Attributes, sizeof(WDF_OBJECT_ATTRIBUTES));
+    Attributes->Size = sizeof(WDF_OBJECT_ATTRIBUTES);
+    Attributes->ExecutionLevel = WdfExecutionLevelInheritFromParent;
+    Attributes->SynchronizationScope = WdfSynchronizationScopeInheritFromParent;
+}
+
+#define WDF_TYPE_NAME_TO_TYPE_INFO(_contexttype) _WDF_ ## _contexttype ## _TYPE_INFO
+
+#define WDF_GET_CONTEXT_TYPE_INFO(_contexttype) (WDF_TYPE_NAME_TO_TYPE_INFO(_contexttype).UniqueType)
+
+#define WDF_OBJECT_ATTRIBUTES_SET_CONTEXT_TYPE(_attributes, _contexttype) \
+    (_attributes)->ContextTypeInfo = WDF_GET_CONTEXT_TYPE_INFO(_contexttype)
+
+#define WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(_attributes, _contexttype) \
+    WDF_OBJECT_ATTRIBUTES_INIT(_attributes); \
+    WDF_OBJECT_ATTRIBUTES_SET_CONTEXT_TYPE(_attributes, _contexttype)
+
+PVOID
+WdfObjectGetTypedContextWorker(
+    _In_ WDFOBJECT Handle,
+    _In_ PCWDF_OBJECT_CONTEXT_TYPE_INFO TypeInfo
+);
+
+//
+// Weak like selectany, every unit declaring a context type shares one
+// type info instance so lookups compare pointers
+// 
+//
+// Type info is shared by every unit declaring the context, C++ needs the
+// explicit linkage or the constant stays private to the unit
+// 
+#ifdef __cplusplus
+#define SIM_CONTEXT_TYPE_INFO_LINKAGE extern "C"
+#else
+#define SIM_CONTEXT_TYPE_INFO_LINKAGE
+#endif
+
+#define WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(_contexttype, _castingfunction) \
+    SIM_CONTEXT_TYPE_INFO_LINKAGE __attribute__((weak)) const WDF_OBJECT_CONTEXT_TYPE_INFO WDF_TYPE_NAME_TO_TYPE_INFO(_contexttype) = \
+    { \
+        sizeof(WDF_OBJECT_CONTEXT_TYPE_INFO), \
+        (PCHAR)#_contexttype, \
+        sizeof(_contexttype), \
+        &WDF_TYPE_NAME_TO_TYPE_INFO(_contexttype), \
+        NULL \
+    }; \
+    FORCEINLINE _contexttype* _castingfunction(_In_ WDFOBJECT Handle) \
+    { \
+        return (_contexttype*)WdfObjectGetTypedContextWorker(Handle, WDF_GET_CONTEXT_TYPE_INFO(_contexttype)); \
+    }
+
+#define WDF_DECLARE_CONTEXT_TYPE(_contexttype) \
+    WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(_contexttype, WdfObjectGet_ ## _contexttype)
+
+NTSTATUS
+WdfObjectAllocateContext(
+    _In_ WDFOBJECT Handle,
+    _In_ PWDF_OBJECT_ATTRIBUTES ContextAttributes,
+    _Outptr_opt_ PVOID* Context
+);
+
+WDFOBJECT
+WdfObjectContextGetObject(
+    _In_ PVOID ContextPointer
+);
+
+VOID
+WdfObjectDelete(
+    _In_ WDFOBJECT Object
+);
+
+#pragma endregion
+
+#pragma region Driver and registry
+
+WDFDRIVER
+WdfGetDriver(
+    VOID
+);
+
+NTSTATUS
+WdfDriverOpenParametersRegistryKey(
+    _In_ WDFDRIVER Driver,
+    _In_ ACCESS_MASK DesiredAccess,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES KeyAttributes,
+    _Out_ WDFKEY* Key
+);
+
+NTSTATUS
+WdfRegistryQueryULong(
+    _In_ WDFKEY Key,
+    _In_ PCUNICODE_STRING ValueName,
+    _Out_ PULONG Value
+);
+
+VOID
+WdfRegistryClose(
+    _In_ WDFKEY Key
+);
+
+#pragma endregion
+
+#pragma region Device
+
+typedef NTSTATUS EVT_WDF_DRIVER_DEVICE_ADD(_In_ WDFDRIVER Driver, _Inout_ PWDFDEVICE_INIT DeviceInit);
+typedef EVT_WDF_DRIVER_DEVICE_ADD* PFN_WDF_DRIVER_DEVICE_ADD;
+
+typedef NTSTATUS EVT_WDF_DEVICE_SELF_MANAGED_IO_INIT(_In_ WDFDEVICE Device);
+typedef EVT_WDF_DEVICE_SELF_MANAGED_IO_INIT* PFN_WDF_DEVICE_SELF_MANAGED_IO_INIT;
+
+typedef VOID EVT_WDF_DEVICE_SELF_MANAGED_IO_CLEANUP(_In_ WDFDEVICE Device);
+typedef EVT_WDF_DEVICE_SELF_MANAGED_IO_CLEANUP* PFN_WDF_DEVICE_SELF_MANAGED_IO_CLEANUP;
+
+typedef struct _WDF_PNPPOWER_EVENT_CALLBACKS
+{
+    ULONG Size;
+    PVOID EvtDeviceD0Entry;
+    PVOID EvtDeviceD0EntryPostInterruptsEnabled;
+    PVOID EvtDeviceD0Exit;
+    PVOID EvtDeviceD0ExitPreInterruptsDisabled;
+    PVOID EvtDevicePrepareHardware;
+    PVOID EvtDeviceReleaseHardware;
+    PFN_WDF_DEVICE_SELF_MANAGED_IO_CLEANUP EvtDeviceSelfManagedIoCleanup;
+    PVOID EvtDeviceSelfManagedIoFlush;
+    PFN_WDF_DEVICE_SELF_MANAGED_IO_INIT EvtDeviceSelfManagedIoInit;
+    PVOID EvtDeviceSelfManagedIoSuspend;
+    PVOID EvtDeviceSelfManagedIoRestart;
+    PVOID EvtDeviceSurpriseRemoval;
+    PVOID EvtDeviceQueryRemove;
+    PVOID EvtDeviceQueryStop;
+    PVOID EvtDeviceUsageNotification;
+    PVOID EvtDeviceRelationsQuery;
+    PVOID EvtDeviceUsageNotificationEx;
+
+} WDF_PNPPOWER_EVENT_CALLBACKS, * PWDF_PNPPOWER_EVENT_CALLBACKS;
+
+FORCEINLINE
+VOID
+WDF_PNPPOWER_EVENT_CALLBACKS_INIT(
+    _Out_ PWDF_PNPPOWER_EVENT_CALLBACKS Callbacks
+)
+{
+    RtlZeroMemory(Callbacks, sizeof(WDF_PNPPOWER_EVENT_CALLBACKS));
+    Callbacks->Size = sizeof(WDF_PNPPOWER_EVENT_CALLBACKS);
+}
+
+typedef struct _WDF_DEVICE_PNP_CAPABILITIES
+{
+    ULONG Size;
+    WDF_TRI_STATE LockSupported;
+    WDF_TRI_STATE EjectSupported;
+    WDF_TRI_STATE Removable;
+    WDF_TRI_STATE DockDevice;
+    WDF_TRI_STATE UniqueID;
+    WDF_TRI_STATE SilentInstall;
+    WDF_TRI_STATE SurpriseRemovalOK;
+    WDF_TRI_STATE HardwareDisabled;
+    WDF_TRI_STATE NoDisplayInUI;
+    ULONG Address;
+    ULONG UINumber;
+
+} WDF_DEVICE_PNP_CAPABILITIES, * PWDF_DEVICE_PNP_CAPABILITIES;
+
+FORCEINLINE
+VOID
+WDF_DEVICE_PNP_CAPABILITIES_INIT(
+    _Out_ PWDF_DEVICE_PNP_CAPABILITIES Caps
+)
+{
+    RtlZeroMemory(Caps, sizeof(WDF_DEVICE_PNP_CAPABILITIES));
+    Caps->Size = sizeof(WDF_DEVICE_PNP_CAPABILITIES);
+    Caps->LockSupported = WdfUseDefault;
+    Caps->EjectSupported = WdfUseDefault;
+    Caps->Removable = WdfUseDefault;
+    Caps->DockDevice = WdfUseDefault;
+    Caps->UniqueID = WdfUseDefault;
+    Caps->SilentInstall = WdfUseDefault;
+    Caps->SurpriseRemovalOK = WdfUseDefault;
+    Caps->HardwareDisabled = WdfUseDefault;
+    Caps->NoDisplayInUI = WdfUseDefault;
+    Caps->Address = (ULONG)-1;
+    Caps->UINumber = (ULONG)-1;
+}
+
+typedef enum _WDF_POWER_POLICY_S0_IDLE_CAPABILITIES
+{
+    IdleCapsInvalid = 0,
+    IdleCannotWakeFromS0,
+    IdleCanWakeFromS0,
+    IdleUsbSelectiveSuspend
+
+} WDF_POWER_POLICY_S0_IDLE_CAPABILITIES;
+
+typedef struct _WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS
+{
+    ULONG Size;
+    WDF_POWER_POLICY_S0_IDLE_CAPABILITIES IdleCaps;
+    DEVICE_POWER_STATE DxState;
+    ULONG IdleTimeout;
+    WDF_TRI_STATE UserControlOfIdleSettings;
+    WDF_TRI_STATE Enabled;
+    WDF_TRI_STATE PowerUpIdleDeviceOnSystemWake;
+
+} WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS, * PWDF_DEVICE_POWER_POLICY_IDLE_SETTINGS;
+
+FORCEINLINE
+VOID
+WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS_INIT(
+    _Out_ PWDF_DEVICE_POWER_POLICY_IDLE_SETTINGS Settings,
+    _In_ WDF_POWER_POLICY_S0_IDLE_CAPABILITIES IdleCaps
+)
+{
+    RtlZeroMemory(Settings, sizeof(WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS));
+    Settings->Size = sizeof(WDF_DEVICE_POWER_POLICY_IDLE_SETTINGS);
+    Settings->IdleCaps = IdleCaps;
+    Settings->DxState = PowerDeviceD3;
+    Settings->IdleTimeout = 0;
+    Settings->UserControlOfIdleSettings = WdfUseDefault;
+    Settings->Enabled = WdfUseDefault;
+    Settings->PowerUpIdleDeviceOnSystemWake = WdfUseDefault;
+}
+
+extern const UNICODE_STRING SDDL_DEVOBJ_SYS_ALL_ADM_ALL;
+extern const UNICODE_STRING SDDL_DEVOBJ_SYS_ALL_ADM_RWX_WORLD_RWX_RES_RWX;
+
+VOID
+WdfDeviceInitFree(
+    _In_ PWDFDEVICE_INIT DeviceInit
+);
+
+VOID
+WdfDeviceInitSetDeviceType(
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_ DEVICE_TYPE DeviceType
+);
+
+VOID
+WdfPdoInitAllowForwardingRequestToParent(
+    _In_ PWDFDEVICE_INIT DeviceInit
+);
+
+VOID
+WdfDeviceInitSetPnpPowerEventCallbacks(
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_ PWDF_PNPPOWER_EVENT_CALLBACKS PnpPowerEventCallbacks
+);
+
+VOID
+WdfDeviceInitSetExclusive(
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_ BOOLEAN IsExclusive
+);
+
+NTSTATUS
+WdfDeviceInitAssignSDDLString(
+    _In_ PWDFDEVICE_INIT DeviceInit,
+    _In_opt_ PCUNICODE_STRING SDDLString
+);
+
+VOID
+WdfDeviceSetPnpCapabilities(
+    _In_ WDFDEVICE Device,
+    _In_ PWDF_DEVICE_PNP_CAPABILITIES PnpCapabilities
+);
+
+NTSTATUS
+WdfDeviceAssignS0IdleSettings(
+    _In_ WDFDEVICE Device,
+    _In_ PWDF_DEVICE_POWER_POLICY_IDLE_SETTINGS Settings
+);
+
+NTSTATUS
+WdfDeviceWdmDispatchPreprocessedIrp(
+    _In_ WDFDEVICE Device,
+    _In_ PIRP Irp
+);
+
+#pragma endregion
+
+#pragma region Memory
+
+typedef struct _WDFMEMORY_OFFSET
+{
+    size_t BufferOffset;
+    size_t BufferLength;
+
+} WDFMEMORY_OFFSET, * PWDFMEMORY_OFFSET;
+
+typedef enum _WDF_MEMORY_DESCRIPTOR_TYPE
+{
+    WdfMemoryDescriptorTypeInvalid = 0,
+    WdfMemoryDescriptorTypeBuffer,
+    WdfMemoryDescriptorTypeMdl,
+    WdfMemoryDescriptorTypeHandle
+
+} WDF_MEMORY_DESCRIPTOR_TYPE;
+
+typedef struct _WDF_MEMORY_DESCRIPTOR
+{
+    WDF_MEMORY_DESCRIPTOR_TYPE Type;
+
+    union
+    {
+        struct
+        {
+            PVOID Buffer;
+            ULONG Length;
+        } BufferType;
+
+        struct
+        {
+            PMDL Mdl;
+            ULONG BufferLength;
+        } MdlType;
+
+        struct
+        {
+            WDFMEMORY Memory;
+            PWDFMEMORY_OFFSET Offsets;
+        } HandleType;
+
+    } u;
+
+} WDF_MEMORY_DESCRIPTOR, * PWDF_MEMORY_DESCRIPTOR;
+
+FORCEINLINE
+VOID
+WDF_MEMORY_DESCRIPTOR_INIT_BUFFER(
+    _Out_ PWDF_MEMORY_DESCRIPTOR Descriptor,
+    _In_ PVOID Buffer,
+    _In_ ULONG BufferLength
+)
+{
+    RtlZeroMemory(Descriptor, sizeof(WDF_MEMORY_DESCRIPTOR));
+    Descriptor->Type = WdfMemoryDescriptorTypeBuffer;
+    Descriptor->u.BufferType.Buffer = Buffer;
+    Descriptor->u.BufferType.Length = BufferLength;
+}
+
+NTSTATUS
+WdfMemoryCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ POOL_TYPE PoolType,
+    _In_opt_ ULONG PoolTag,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY* Memory,
+    _Outptr_opt_result_bytebuffer_(BufferSize) PVOID* Buffer
+);
+
+NTSTATUS
+WdfMemoryCreatePreallocated(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ PVOID Buffer,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY* Memory
+);
+
+PVOID
+WdfMemoryGetBuffer(
+    _In_ WDFMEMORY Memory,
+    _Out_opt_ size_t* BufferSize
+);
+
+#pragma endregion
+
+#pragma region Synchronization
+
+NTSTATUS
+WdfSpinLockCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES SpinLockAttributes,
+    _Out_ WDFSPINLOCK* SpinLock
+);
+
+VOID
+WdfSpinLockAcquire(
+    _In_ WDFSPINLOCK SpinLock
+);
+
+VOID
+WdfSpinLockRelease(
+    _In_ WDFSPINLOCK SpinLock
+);
+
+NTSTATUS
+WdfWaitLockCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES LockAttributes,
+    _Out_ WDFWAITLOCK* Lock
+);
+
+NTSTATUS
+WdfWaitLockAcquire(
+    _In_ WDFWAITLOCK Lock,
+    _In_opt_ PLONGLONG Timeout
+);
+
+VOID
+WdfWaitLockRelease(
+    _In_ WDFWAITLOCK Lock
+);
+
+#pragma endregion
+
+#pragma region Collections
+
+NTSTATUS
+WdfCollectionCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES CollectionAttributes,
+    _Out_ WDFCOLLECTION* Collection
+);
+
+NTSTATUS
+WdfCollectionAdd(
+    _In_ WDFCOLLECTION Collection,
+    _In_ WDFOBJECT Object
+);
+
+ULONG
+WdfCollectionGetCount(
+    _In_ WDFCOLLECTION Collection
+);
+
+WDFOBJECT
+WdfCollectionGetItem(
+    _In_ WDFCOLLECTION Collection,
+    _In_ ULONG Index
+);
+
+VOID
+WdfCollectionRemove(
+    _In_ WDFCOLLECTION Collection,
+    _In_ WDFOBJECT Item
+);
+
+VOID
+WdfCollectionRemoveItem(
+    _In_ WDFCOLLECTION Collection,
+    _In_ ULONG Index
+);
+
+#pragma endregion
+
+#pragma region Work items
+
+typedef VOID EVT_WDF_WORKITEM(_In_ WDFWORKITEM WorkItem);
+typedef EVT_WDF_WORKITEM* PFN_WDF_WORKITEM;
+
+typedef struct _WDF_WORKITEM_CONFIG
+{
+    ULONG Size;
+    PFN_WDF_WORKITEM EvtWorkItemFunc;
+    BOOLEAN AutomaticSerialization;
+
+} WDF_WORKITEM_CONFIG, * PWDF_WORKITEM_CONFIG;
+
+FORCEINLINE
+VOID
+WDF_WORKITEM_CONFIG_INIT(
+    _Out_ PWDF_WORKITEM_CONFIG Config,
+    _In_ PFN_WDF_WORKITEM EvtWorkItemFunc
+)
+{
+    RtlZeroMemory(Config, sizeof(WDF_WORKITEM_CONFIG));
+    Config->Size = sizeof(WDF_WORKITEM_CONFIG);
+    Config->EvtWorkItemFunc = EvtWorkItemFunc;
+    Config->AutomaticSerialization = TRUE;
+}
+
+NTSTATUS
+WdfWorkItemCreate(
+    _In_ PWDF_WORKITEM_CONFIG Config,
+    _In_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _Out_ WDFWORKITEM* WorkItem
+);
+
+VOID
+WdfWorkItemEnqueue(
+    _In_ WDFWORKITEM WorkItem
+);
+
+WDFOBJECT
+WdfWorkItemGetParentObject(
+    _In_ WDFWORKITEM WorkItem
+);
+
+typedef VOID EVT_WDF_TIMER(_In_ WDFTIMER Timer);
+typedef EVT_WDF_TIMER* PFN_WDF_TIMER;
+
+#pragma endregion
+
+#pragma region Requests
+
+typedef enum _WDF_REQUEST_TYPE
+{
+    WdfRequestTypeCreate = 0x0,
+    WdfRequestTypeClose = 0x2,
+    WdfRequestTypeRead = 0x3,
+    WdfRequestTypeWrite = 0x4,
+    WdfRequestTypeDeviceControl = 0xE,
+    WdfRequestTypeDeviceControlInternal = 0xF,
+    WdfRequestTypeOther = 0x1C
+
+} WDF_REQUEST_TYPE;
+
+typedef struct _WDF_REQUEST_PARAMETERS
+{
+    USHORT Size;
+    UCHAR MinorFunction;
+    WDF_REQUEST_TYPE Type;
+
+    union
+    {
+        struct
+        {
+            size_t OutputBufferLength;
+            size_t InputBufferLength;
+            ULONG IoControlCode;
+            PVOID Type3InputBuffer;
+        } DeviceIoControl;
+
+        struct
+        {
+            union
+            {
+                PVOID Ptr;
+                ULONG_PTR Value;
+            } Argument1;
+
+            union
+            {
+                PVOID Ptr;
+                ULONG_PTR Value;
+            } Argument2;
+
+            ULONG IoControlCode;
+
+            union
+            {
+                PVOID Ptr;
+                ULONG_PTR Value;
+            } Argument4;
+        } Others;
+
+    } Parameters;
+
+} WDF_REQUEST_PARAMETERS, * PWDF_REQUEST_PARAMETERS;
+
+FORCEINLINE
+VOID
+WDF_REQUEST_PARAMETERS_INIT(
+    _Out_ PWDF_REQUEST_PARAMETERS Parameters
+)
+{
+    RtlZeroMemory(Parameters, sizeof(WDF_REQUEST_PARAMETERS));
+    Parameters->Size = sizeof(WDF_REQUEST_PARAMETERS);
+}
+
+typedef struct _WDF_REQUEST_COMPLETION_PARAMS
+{
+    ULONG Size;
+    WDF_REQUEST_TYPE Type;
+    IO_STATUS_BLOCK IoStatus;
+
+    union
+    {
+        struct
+        {
+            ULONG IoControlCode;
+
+            struct
+            {
+                WDFMEMORY Buffer;
+                size_t Offset;
+            } Input;
+
+            struct
+            {
+                WDFMEMORY Buffer;
+                size_t Offset;
+                size_t Length;
+            } Output;
+        } Ioctl;
+
+        struct
+        {
+            union
+            {
+                PVOID Ptr;
+                ULONG_PTR Value;
+            } Argument1;
+
+            union
+            {
+                PVOID Ptr;
+                ULONG_PTR Value;
+            } Argument2;
+
+            union
+            {
+                PVOID Ptr;
+                ULONG_PTR Value;
+            } Argument3;
+
+            union
+            {
+                PVOID Ptr;
+                ULONG_PTR Value;
+            } Argument4;
+        } Others;
+
+    } Parameters;
+
+} WDF_REQUEST_COMPLETION_PARAMS, * PWDF_REQUEST_COMPLETION_PARAMS;
+
+typedef VOID EVT_WDF_REQUEST_COMPLETION_ROUTINE(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_ PWDF_REQUEST_COMPLETION_PARAMS Params,
+    _In_ WDFCONTEXT Context
+);
+typedef EVT_WDF_REQUEST_COMPLETION_ROUTINE* PFN_WDF_REQUEST_COMPLETION_ROUTINE;
+
+typedef VOID EVT_WDF_REQUEST_CANCEL(_In_ WDFREQUEST Request);
+typedef EVT_WDF_REQUEST_CANCEL* PFN_WDF_REQUEST_CANCEL;
+
+typedef enum _WDF_REQUEST_REUSE_FLAGS
+{
+    WDF_REQUEST_REUSE_NO_FLAGS = 0x00000000,
+    WDF_REQUEST_REUSE_SET_NEW_IRP = 0x00000001
+
+} WDF_REQUEST_REUSE_FLAGS;
+
+typedef struct _WDF_REQUEST_REUSE_PARAMS
+{
+    ULONG Size;
+    ULONG Flags;
+    NTSTATUS Status;
+    PIRP NewIrp;
+
+} WDF_REQUEST_REUSE_PARAMS, * PWDF_REQUEST_REUSE_PARAMS;
+
+FORCEINLINE
+VOID
+WDF_REQUEST_REUSE_PARAMS_INIT(
+    _Out_ PWDF_REQUEST_REUSE_PARAMS Params,
+    _In_ ULONG Flags,
+    _In_ NTSTATUS Status
+)
+{
+    RtlZeroMemory(Params, sizeof(WDF_REQUEST_REUSE_PARAMS));
+    Params->Size = sizeof(WDF_REQUEST_REUSE_PARAMS);
+    Params->Flags = Flags;
+    Params->Status = Status;
+}
+
+typedef struct _WDF_REQUEST_SEND_OPTIONS
+{
+    ULONG Size;
+    ULONG Flags;
+    LONGLONG Timeout;
+
+} WDF_REQUEST_SEND_OPTIONS, * PWDF_REQUEST_SEND_OPTIONS;
+
+NTSTATUS
+WdfRequestCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES RequestAttributes,
+    _In_opt_ WDFIOTARGET IoTarget,
+    _Out_ WDFREQUEST* Request
+);
+
+NTSTATUS
+WdfRequestReuse(
+    _In_ WDFREQUEST Request,
+    _In_ PWDF_REQUEST_REUSE_PARAMS ReuseParams
+);
+
+BOOLEAN
+WdfRequestSend(
+    _In_ WDFREQUEST Request,
+    _In_ WDFIOTARGET Target,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS Options
+);
+
+NTSTATUS
+WdfRequestGetStatus(
+    _In_ WDFREQUEST Request
+);
+
+BOOLEAN
+WdfRequestCancelSentRequest(
+    _In_ WDFREQUEST Request
+);
+
+VOID
+WdfRequestSetCompletionRoutine(
+    _In_ WDFREQUEST Request,
+    _In_opt_ PFN_WDF_REQUEST_COMPLETION_ROUTINE CompletionRoutine,
+    _In_opt_ WDFCONTEXT CompletionContext
+);
+
+VOID
+WdfRequestComplete(
+    _In_ WDFREQUEST Request,
+    _In_ NTSTATUS Status
+);
+
+VOID
+WdfRequestCompleteWithInformation(
+    _In_ WDFREQUEST Request,
+    _In_ NTSTATUS Status,
+    _In_ ULONG_PTR Information
+);
+
+VOID
+WdfRequestGetParameters(
+    _In_ WDFREQUEST Request,
+    _Out_ PWDF_REQUEST_PARAMETERS Parameters
+);
+
+NTSTATUS
+WdfRequestRetrieveInputBuffer(
+    _In_ WDFREQUEST Request,
+    _In_ size_t MinimumRequiredLength,
+    _Outptr_result_bytebuffer_(*Length) PVOID* Buffer,
+    _Out_opt_ size_t* Length
+);
+
+NTSTATUS
+WdfRequestRetrieveOutputBuffer(
+    _In_ WDFREQUEST Request,
+    _In_ size_t MinimumRequiredSize,
+    _Outptr_result_bytebuffer_(*Length) PVOID* Buffer,
+    _Out_opt_ size_t* Length
+);
+
+NTSTATUS
+WdfRequestRetrieveOutputWdmMdl(
+    _In_ WDFREQUEST Request,
+    _Outptr_ PMDL* Mdl
+);
+
+NTSTATUS
+WdfRequestForwardToIoQueue(
+    _In_ WDFREQUEST Request,
+    _In_ WDFQUEUE DestinationQueue
+);
+
+WDFQUEUE
+WdfRequestGetIoQueue(
+    _In_ WDFREQUEST Request
+);
+
+NTSTATUS
+WdfRequestMarkCancelableEx(
+    _In_ WDFREQUEST Request,
+    _In_ PFN_WDF_REQUEST_CANCEL EvtRequestCancel
+);
+
+NTSTATUS
+WdfRequestUnmarkCancelable(
+    _In_ WDFREQUEST Request
+);
+
+#pragma endregion
+
+#pragma region Queues
+
+typedef enum _WDF_IO_QUEUE_DISPATCH_TYPE
+{
+    WdfIoQueueDispatchInvalid = 0,
+    WdfIoQueueDispatchSequential,
+    WdfIoQueueDispatchParallel,
+    WdfIoQueueDispatchManual,
+    WdfIoQueueDispatchMax
+
+} WDF_IO_QUEUE_DISPATCH_TYPE;
+
+typedef enum _WDF_IO_QUEUE_STATE
+{
+    WdfIoQueueAcceptRequests = 0x01,
+    WdfIoQueueDispatchRequests = 0x02,
+    WdfIoQueueNoRequests = 0x04,
+    WdfIoQueueDriverNoRequests = 0x08,
+    WdfIoQueuePnpHeld = 0x10
+
+} WDF_IO_QUEUE_STATE;
+
+typedef VOID EVT_WDF_IO_QUEUE_STATE(_In_ WDFQUEUE Queue, _In_ WDFCONTEXT Context);
+typedef EVT_WDF_IO_QUEUE_STATE* PFN_WDF_IO_QUEUE_STATE;
+
+typedef VOID EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL(
+    _In_ WDFQUEUE Queue,
+    _In_ WDFREQUEST Request,
+    _In_ size_t OutputBufferLength,
+    _In_ size_t InputBufferLength,
+    _In_ ULONG IoControlCode
+);
+typedef EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL* PFN_WDF_IO_QUEUE_IO_DEVICE_CONTROL;
+
+typedef VOID EVT_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE(_In_ WDFQUEUE Queue, _In_ WDFREQUEST Request);
+typedef EVT_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE* PFN_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE;
+
+typedef struct _WDF_IO_QUEUE_CONFIG
+{
+    ULONG Size;
+    WDF_IO_QUEUE_DISPATCH_TYPE DispatchType;
+    WDF_TRI_STATE PowerManaged;
+    BOOLEAN AllowZeroLengthRequests;
+    BOOLEAN DefaultQueue;
+    PVOID EvtIoDefault;
+    PVOID EvtIoRead;
+    PVOID EvtIoWrite;
+    PFN_WDF_IO_QUEUE_IO_DEVICE_CONTROL EvtIoDeviceControl;
+    PFN_WDF_IO_QUEUE_IO_DEVICE_CONTROL EvtIoInternalDeviceControl;
+    PVOID EvtIoStop;
+    PVOID EvtIoResume;
+    PFN_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE EvtIoCanceledOnQueue;
+
+} WDF_IO_QUEUE_CONFIG, * PWDF_IO_QUEUE_CONFIG;
+
+FORCEINLINE
+VOID
+WDF_IO_QUEUE_CONFIG_INIT(
+    _Out_ PWDF_IO_QUEUE_CONFIG Config,
+    _In_ WDF_IO_QUEUE_DISPATCH_TYPE DispatchType
+)
+{
+    RtlZeroMemory(Config, sizeof(WDF_IO_QUEUE_CONFIG));
+    Config->Size = sizeof(WDF_IO_QUEUE_CONFIG);
+    Config->PowerManaged = WdfUseDefault;
+    Config->DispatchType = DispatchType;
+}
+
+NTSTATUS
+WdfIoQueueCreate(
+    _In_ WDFDEVICE Device,
+    _In_ PWDF_IO_QUEUE_CONFIG Config,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES QueueAttributes,
+    _Out_opt_ WDFQUEUE* Queue
+);
+
+NTSTATUS
+WdfIoQueueRetrieveNextRequest(
+    _In_ WDFQUEUE Queue,
+    _Out_ WDFREQUEST* OutRequest
+);
+
+WDF_IO_QUEUE_STATE
+WdfIoQueueGetState(
+    _In_ WDFQUEUE Queue,
+    _Out_opt_ PULONG QueueRequests,
+    _Out_opt_ PULONG DriverRequests
+);
+
+WDFDEVICE
+WdfIoQueueGetDevice(
+    _In_ WDFQUEUE Queue
+);
+
+NTSTATUS
+WdfIoQueueReadyNotify(
+    _In_ WDFQUEUE Queue,
+    _In_opt_ PFN_WDF_IO_QUEUE_STATE QueueReady,
+    _In_opt_ WDFCONTEXT Context
+);
+
+#pragma endregion
+
+#pragma region I/O targets
+
+NTSTATUS
+WdfIoTargetFormatRequestForIoctl(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_opt_ WDFMEMORY InputBuffer,
+    _In_opt_ PWDFMEMORY_OFFSET InputBufferOffset,
+    _In_opt_ WDFMEMORY OutputBuffer,
+    _In_opt_ PWDFMEMORY_OFFSET OutputBufferOffset
+);
+
+NTSTATUS
+WdfIoTargetFormatRequestForInternalIoctlOthers(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_opt_ WDFMEMORY OtherArg1,
+    _In_opt_ PWDFMEMORY_OFFSET OtherArg1Offset,
+    _In_opt_ WDFMEMORY OtherArg2,
+    _In_opt_ PWDFMEMORY_OFFSET OtherArg2Offset,
+    _In_opt_ WDFMEMORY OtherArg4,
+    _In_opt_ PWDFMEMORY_OFFSET OtherArg4Offset
+);
+
+NTSTATUS
+WdfIoTargetSendInternalIoctlOthersSynchronously(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OtherArg1,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OtherArg2,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OtherArg4,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS RequestOptions,
+    _Out_opt_ PULONG_PTR BytesReturned
+);
+
+#pragma endregion
+
+EXTERN_C_END
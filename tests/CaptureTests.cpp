@@ -0,0 +1,382 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <BthPS3Util/PcapWriter.h>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/CaptureRing.h>
+}
+
+namespace
+{
+    //
+    // Zeroed slots and a ring pointing at them, like a freshly enabled capture
+    // 
+    class CaptureRingTest : public ::testing::Test
+    {
+    protected:
+        std::vector<BTHPS3PSM_CAPTURE_SLOT> Slots;
+        BTHPS3PSM_CAPTURE_RING Ring = {};
+
+        void SetUp() override
+        {
+            Slots.resize(BTHPS3PSM_CAPTURE_SLOT_COUNT);
+            memset(Slots.data(), 0, Slots.size() * sizeof(BTHPS3PSM_CAPTURE_SLOT));
+
+            Ring.Slots = Slots.data();
+            Ring.SnapLength = BTHPS3PSM_CAPTURE_MAX_SNAP_LEN;
+        }
+
+        void Push(ULONG64 Timestamp, std::vector<UCHAR> Packet)
+        {
+            BthPS3PSM_CaptureRingPush(
+                &Ring,
+                Timestamp,
+                BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED,
+                BTHPS3PSM_CAPTURE_PACKET_ACL_DATA,
+                Packet.data(),
+                static_cast<ULONG>(Packet.size())
+            );
+        }
+    };
+
+    struct DrainResult
+    {
+        std::vector<BTHPS3PSM_CAPTURE_RECORD> Records;
+        std::vector<std::vector<UCHAR>> Data;
+        ULONG64 Dropped = 0;
+        size_t Written = 0;
+    };
+
+    DrainResult Drain(PBTHPS3PSM_CAPTURE_RING Ring, size_t BufferLength)
+    {
+        std::vector<UCHAR> buffer(BufferLength);
+        DrainResult result;
+        ULONG count = 0;
+
+        BthPS3PSM_CaptureRingDrain(Ring, buffer.data(), buffer.size(), &result.Written, &count, &result.Dropped);
+
+        size_t offset = 0;
+
+        for (ULONG i = 0; i < count; i++)
+        {
+            BTHPS3PSM_CAPTURE_RECORD record;
+
+            memcpy(&record, &buffer[offset], sizeof(record));
+            offset += sizeof(record);
+
+            result.Records.push_back(record);
+            result.Data.emplace_back(&buffer[offset], &buffer[offset + record.CapturedLength]);
+
+            offset += record.CapturedLength;
+        }
+
+        EXPECT_EQ(offset, result.Written);
+
+        return result;
+    }
+
+    std::uint32_t Get32(const std::string& Bytes, size_t Offset)
+    {
+        return static_cast<std::uint8_t>(Bytes[Offset])
+            | (static_cast<std::uint8_t>(Bytes[Offset + 1]) << 8)
+            | (static_cast<std::uint8_t>(Bytes[Offset + 2]) << 16)
+            | (static_cast<std::uint32_t>(static_cast<std::uint8_t>(Bytes[Offset + 3])) << 24);
+    }
+}
+
+TEST_F(CaptureRingTest, DrainsPacketsInOrder)
+{
+    Push(100, {0x01, 0x02, 0x03});
+    Push(200, {0x04});
+
+    const auto result = Drain(&Ring, 0x1000);
+
+    ASSERT_EQ(result.Records.size(), 2u);
+    EXPECT_EQ(result.Dropped, 0u);
+
+    EXPECT_EQ(result.Records[0].Timestamp, 100u);
+    EXPECT_EQ(result.Records[0].OriginalLength, 3u);
+    EXPECT_EQ(result.Records[0].CapturedLength, 3u);
+    EXPECT_EQ(result.Records[0].Direction, BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED);
+    EXPECT_EQ(result.Records[0].PacketType, BTHPS3PSM_CAPTURE_PACKET_ACL_DATA);
+    EXPECT_EQ(result.Data[0], (std::vector<UCHAR>{0x01, 0x02, 0x03}));
+
+    EXPECT_EQ(result.Records[1].Timestamp, 200u);
+    EXPECT_EQ(result.Data[1], (std::vector<UCHAR>{0x04}));
+
+    EXPECT_TRUE(Drain(&Ring, 0x1000).Records.empty());
+}
+
+TEST_F(CaptureRingTest, CopiesOnlySnapLength)
+{
+    Ring.SnapLength = 4;
+
+    Push(1, {0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17});
+
+    const auto result = Drain(&Ring, 0x1000);
+
+    ASSERT_EQ(result.Records.size(), 1u);
+    EXPECT_EQ(result.Records[0].OriginalLength, 8u);
+    EXPECT_EQ(result.Records[0].CapturedLength, 4u);
+    EXPECT_EQ(result.Data[0], (std::vector<UCHAR>{0x10, 0x11, 0x12, 0x13}));
+}
+
+TEST_F(CaptureRingTest, ResumesWhereSmallBufferStopped)
+{
+    Push(1, {0xAA, 0xAA});
+    Push(2, {0xBB, 0xBB});
+
+    //
+    // Room for exactly one record, the second one has to wait
+    // 
+    auto result = Drain(&Ring, sizeof(BTHPS3PSM_CAPTURE_RECORD) + 2);
+
+    ASSERT_EQ(result.Records.size(), 1u);
+    EXPECT_EQ(result.Records[0].Timestamp, 1u);
+
+    result = Drain(&Ring, sizeof(BTHPS3PSM_CAPTURE_RECORD) + 1);
+
+    EXPECT_TRUE(result.Records.empty());
+
+    result = Drain(&Ring, 0x1000);
+
+    ASSERT_EQ(result.Records.size(), 1u);
+    EXPECT_EQ(result.Records[0].Timestamp, 2u);
+    EXPECT_EQ(result.Dropped, 0u);
+}
+
+TEST_F(CaptureRingTest, OverwritesOldestAndCountsThemDropped)
+{
+    constexpr ULONG extra = 10;
+
+    for (ULONG i = 0; i < BTHPS3PSM_CAPTURE_SLOT_COUNT + extra; i++)
+    {
+        Push(i, {static_cast<UCHAR>(i)});
+    }
+
+    auto result = Drain(&Ring, (sizeof(BTHPS3PSM_CAPTURE_RECORD) + 1) * BTHPS3PSM_CAPTURE_SLOT_COUNT);
+
+    ASSERT_EQ(result.Records.size(), static_cast<size_t>(BTHPS3PSM_CAPTURE_SLOT_COUNT));
+    EXPECT_EQ(result.Dropped, extra);
+    EXPECT_EQ(result.Records.front().Timestamp, extra);
+    EXPECT_EQ(result.Records.back().Timestamp, BTHPS3PSM_CAPTURE_SLOT_COUNT + extra - 1);
+
+    //
+    // Dropped count is reported once per drain
+    // 
+    Push(0, {0x00});
+
+    result = Drain(&Ring, 0x1000);
+
+    EXPECT_EQ(result.Records.size(), 1u);
+    EXPECT_EQ(result.Dropped, 0u);
+}
+
+TEST(CaptureRingTests, DrainWithoutSlotsReturnsNothing)
+{
+    BTHPS3PSM_CAPTURE_RING ring = {};
+    UCHAR buffer[0x40];
+    size_t written = 1;
+    ULONG count = 1;
+    ULONG64 dropped = 1;
+
+    BthPS3PSM_CaptureRingDrain(&ring, buffer, sizeof(buffer), &written, &count, &dropped);
+
+    EXPECT_EQ(written, 0u);
+    EXPECT_EQ(count, 0u);
+    EXPECT_EQ(dropped, 0u);
+}
+
+TEST_F(CaptureRingTest, ConcurrentProducersNeverTearRecords)
+{
+    constexpr ULONG producers = 4;
+    constexpr ULONG packetsPerProducer = 20000;
+    constexpr ULONG packetLength = 0x40;
+
+    std::atomic<ULONG> finished{0};
+    std::vector<std::thread> threads;
+    std::vector<ULONG64> lastSequence(producers, 0);
+    ULONG64 drained = 0;
+    ULONG64 dropped = 0;
+
+    for (ULONG p = 0; p < producers; p++)
+    {
+        threads.emplace_back([this, p, &finished]
+        {
+            std::vector<UCHAR> packet(packetLength);
+
+            for (ULONG i = 1; i <= packetsPerProducer; i++)
+            {
+                //
+                // Every byte carries the producer, timestamp the sequence,
+                // a torn copy shows up as mixed bytes or a mismatch
+                // 
+                memset(packet.data(), static_cast<int>(p + 1), packet.size());
+
+                BthPS3PSM_CaptureRingPush(
+                    &Ring,
+                    (static_cast<ULONG64>(p) << 32) | i,
+                    BTHPS3PSM_CAPTURE_DIRECTION_SENT,
+                    BTHPS3PSM_CAPTURE_PACKET_ACL_DATA,
+                    packet.data(),
+                    packetLength
+                );
+            }
+
+            ++finished;
+        });
+    }
+
+    auto consume = [&]
+    {
+        const auto result = Drain(&Ring, 0x10000);
+
+        dropped += result.Dropped;
+
+        for (size_t i = 0; i < result.Records.size(); i++)
+        {
+            const ULONG producer = static_cast<ULONG>(result.Records[i].Timestamp >> 32);
+            const ULONG64 sequence = result.Records[i].Timestamp & 0xFFFFFFFF;
+
+            ASSERT_LT(producer, producers);
+            ASSERT_EQ(result.Data[i].size(), packetLength);
+            ASSERT_EQ(result.Data[i], std::vector<UCHAR>(packetLength, static_cast<UCHAR>(producer + 1)));
+
+            //
+            // Packets of one producer come out in the order they went in
+            // 
+            ASSERT_GT(sequence, lastSequence[producer]);
+            lastSequence[producer] = sequence;
+
+            drained++;
+        }
+    };
+
+    while (finished < producers)
+    {
+        consume();
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    consume();
+
+    EXPECT_EQ(drained + dropped, static_cast<ULONG64>(producers) * packetsPerProducer);
+}
+
+TEST(PcapWriterTests, WritesGlobalHeader)
+{
+    std::ostringstream stream;
+
+    PcapWriter writer(stream, 0x20);
+
+    const auto bytes = stream.str();
+
+    ASSERT_EQ(bytes.size(), 24u);
+    EXPECT_EQ(Get32(bytes, 0), 0xA1B2C3D4u);
+    EXPECT_EQ(Get32(bytes, 4), 0x00040002u);
+    EXPECT_EQ(Get32(bytes, 8), 0u);
+    EXPECT_EQ(Get32(bytes, 12), 0u);
+    EXPECT_EQ(Get32(bytes, 16), 0x20u + PcapWriter::PacketPrefixLength);
+    EXPECT_EQ(Get32(bytes, 20), 201u);
+}
+
+TEST(PcapWriterTests, WritesRecordWithPseudoHeader)
+{
+    std::ostringstream stream;
+
+    PcapWriter writer(stream, 0x20);
+
+    const std::uint8_t data[] = {0x40, 0x20, 0x08, 0x00};
+
+    //
+    // 2 s and 123456.7 us past the Unix epoch, sub-microsecond part gets cut
+    // 
+    writer.write(
+        PcapWriter::FileTimeUnixEpoch + 21234567ULL,
+        BTHPS3PSM_CAPTURE_DIRECTION_RECEIVED,
+        BTHPS3PSM_CAPTURE_PACKET_ACL_DATA,
+        data,
+        sizeof(data),
+        0x100
+    );
+
+    const auto bytes = stream.str();
+
+    ASSERT_EQ(bytes.size(), 24u + 16u + PcapWriter::PacketPrefixLength + sizeof(data));
+    EXPECT_EQ(Get32(bytes, 24), 2u);
+    EXPECT_EQ(Get32(bytes, 28), 123456u);
+    EXPECT_EQ(Get32(bytes, 32), sizeof(data) + PcapWriter::PacketPrefixLength);
+    EXPECT_EQ(Get32(bytes, 36), 0x100u + PcapWriter::PacketPrefixLength);
+
+    //
+    // Big-endian direction, then the H4 type indicator
+    // 
+    EXPECT_EQ(bytes.substr(40, 5), std::string("\x00\x00\x00\x01\x02", 5));
+    EXPECT_EQ(bytes.substr(45), std::string(reinterpret_cast<const char*>(data), sizeof(data)));
+}
+
+TEST(PcapWriterTests, ClampsTimestampsBeforeUnixEpoch)
+{
+    std::ostringstream stream;
+
+    PcapWriter writer(stream, 0x20);
+
+    const std::uint8_t data[] = {0x01};
+
+    writer.write(1, BTHPS3PSM_CAPTURE_DIRECTION_SENT, BTHPS3PSM_CAPTURE_PACKET_HCI_EVENT, data, sizeof(data), sizeof(data));
+
+    const auto bytes = stream.str();
+
+    EXPECT_EQ(Get32(bytes, 24), 0u);
+    EXPECT_EQ(Get32(bytes, 28), 0u);
+}
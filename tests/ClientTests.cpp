@@ -0,0 +1,573 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+extern "C" {
+#include <BthPS3Portable.h>
+}
+
+#include <BthPS3Client.hpp>
+
+namespace
+{
+    using namespace bthps3;
+
+    //
+    // Device behind the fake handles, outlives every transport opened to it.
+    // Asynchronous requests complete on a worker thread like on a completion
+    // port; with Hold set they stay pending until released or canceled.
+    // 
+    class FakeDevice
+    {
+    public:
+        using Handler = std::function<std::uint32_t(std::uint32_t, const void*, std::uint32_t, void*, std::uint32_t, std::uint32_t*)>;
+
+        struct Request
+        {
+            std::uint32_t Code;
+            const void* In;
+            std::uint32_t InLength;
+            void* Out;
+            std::uint32_t OutLength;
+            TransferCompletion Completion;
+        };
+
+        explicit FakeDevice(Handler handler)
+            : _handler(std::move(handler)), _worker([this] { Run(); })
+        {
+        }
+
+        ~FakeDevice()
+        {
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                _isShutdown = true;
+            }
+            _changed.notify_all();
+            _worker.join();
+        }
+
+        std::uint32_t Complete(const Request& request, std::uint32_t* bytesReturned)
+        {
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                Codes.push_back(request.Code);
+            }
+
+            return _handler(request.Code, request.In, request.InLength, request.Out, request.OutLength, bytesReturned);
+        }
+
+        void Submit(Request request)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+
+            _queue.push_back(std::move(request));
+            MaxOutstanding = (std::max)(MaxOutstanding, _queue.size());
+            _changed.notify_all();
+        }
+
+        void CancelAll()
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+
+            _isCanceling = true;
+            _changed.notify_all();
+        }
+
+        void Release()
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+
+            Hold = false;
+            _changed.notify_all();
+        }
+
+        //
+        // Waits until the given number of asynchronous requests is pending
+        // 
+        bool WaitOutstanding(size_t count)
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+
+            return _changed.wait_for(guard, std::chrono::seconds(5), [&] { return _queue.size() >= count; });
+        }
+
+        std::mutex& Lock()
+        {
+            return _lock;
+        }
+
+        bool Hold = false;
+        std::uint32_t OpenError = ErrorSuccess;
+        std::uint32_t Opens = 0;
+        size_t MaxOutstanding = 0;
+        std::vector<std::uint32_t> Codes;
+
+    private:
+        Handler _handler;
+        std::mutex _lock;
+        std::condition_variable _changed;
+        std::deque<Request> _queue;
+        bool _isCanceling = false;
+        bool _isShutdown = false;
+        std::thread _worker;
+
+        void Run()
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+
+            for (;;)
+            {
+                _changed.wait(guard, [this]
+                {
+                    return _isShutdown || _isCanceling || (!Hold && !_queue.empty());
+                });
+
+                if (_isShutdown && _queue.empty())
+                {
+                    return;
+                }
+
+                if (_queue.empty())
+                {
+                    _isCanceling = false;
+                    continue;
+                }
+
+                Request request = std::move(_queue.front());
+                _queue.pop_front();
+
+                const bool isCanceled = _isCanceling;
+
+                if (_queue.empty())
+                {
+                    _isCanceling = false;
+                }
+
+                guard.unlock();
+
+                std::uint32_t returned = 0;
+                const std::uint32_t status = isCanceled ? ErrorOperationAborted : Complete(request, &returned);
+
+                request.Completion(status, returned);
+
+                guard.lock();
+            }
+        }
+    };
+
+    class FakeTransport final : public IDeviceTransport
+    {
+    public:
+        explicit FakeTransport(FakeDevice& device)
+            : _device(device)
+        {
+        }
+
+        std::uint32_t Control(
+            std::uint32_t ioControlCode,
+            const void* inBuffer,
+            std::uint32_t inLength,
+            void* outBuffer,
+            std::uint32_t outLength,
+            std::uint32_t* bytesReturned
+        ) override
+        {
+            return _device.Complete({ioControlCode, inBuffer, inLength, outBuffer, outLength, nullptr}, bytesReturned);
+        }
+
+        std::uint32_t ControlAsync(
+            std::uint32_t ioControlCode,
+            const void* inBuffer,
+            std::uint32_t inLength,
+            void* outBuffer,
+            std::uint32_t outLength,
+            TransferCompletion completion
+        ) override
+        {
+            _device.Submit({ioControlCode, inBuffer, inLength, outBuffer, outLength, std::move(completion)});
+
+            return ErrorSuccess;
+        }
+
+        void CancelAll() override
+        {
+            _device.CancelAll();
+        }
+
+    private:
+        FakeDevice& _device;
+    };
+
+    TransportFactory FactoryFor(FakeDevice& device)
+    {
+        return [&device](const std::wstring&, std::uint32_t* error) -> std::unique_ptr<IDeviceTransport>
+        {
+            std::lock_guard<std::mutex> guard(device.Lock());
+
+            device.Opens++;
+
+            if (device.OpenError != ErrorSuccess)
+            {
+                *error = device.OpenError;
+                return nullptr;
+            }
+
+            return std::make_unique<FakeTransport>(device);
+        };
+    }
+
+    //
+    // Filter with the given number of radios, patching enabled on odd indices
+    // 
+    FakeDevice::Handler FilterWithDevices(std::uint32_t count)
+    {
+        return [count](std::uint32_t code, const void* in, std::uint32_t, void* out, std::uint32_t, std::uint32_t* returned)
+        {
+            if (code != IOCTL_BTHPS3PSM_GET_PSM_PATCHING)
+            {
+                return ErrorSuccess;
+            }
+
+            const auto request = static_cast<const BTHPS3PSM_GET_PSM_PATCHING*>(in);
+
+            if (request->DeviceIndex >= count)
+            {
+                return ErrorInvalidParameter;
+            }
+
+            const auto result = static_cast<BTHPS3PSM_GET_PSM_PATCHING*>(out);
+            result->IsEnabled = request->DeviceIndex & 1;
+            *returned = sizeof(BTHPS3PSM_GET_PSM_PATCHING);
+
+            return ErrorSuccess;
+        };
+    }
+}
+
+TEST(ClientTests, KeepsHandleOpenAcrossCalls)
+{
+    FakeDevice device(FilterWithDevices(1));
+    FilterClient client(FactoryFor(device));
+
+    EXPECT_EQ(client.EnablePatch(0), ErrorSuccess);
+    EXPECT_EQ(client.DisablePatch(0), ErrorSuccess);
+
+    BTHPS3PSM_GET_PSM_PATCHING state;
+
+    EXPECT_EQ(client.GetPatch(0, state), ErrorSuccess);
+
+    EXPECT_EQ(device.Opens, 1u);
+    EXPECT_EQ(device.Codes, (std::vector<std::uint32_t>{
+        IOCTL_BTHPS3PSM_ENABLE_PSM_PATCHING,
+        IOCTL_BTHPS3PSM_DISABLE_PSM_PATCHING,
+        IOCTL_BTHPS3PSM_GET_PSM_PATCHING
+    }));
+}
+
+TEST(ClientTests, ReopensOnceAfterDeviceWentAway)
+{
+    std::uint32_t failures = 1;
+    FakeDevice device([&failures](std::uint32_t, const void*, std::uint32_t, void*, std::uint32_t, std::uint32_t*)
+    {
+        if (failures > 0)
+        {
+            failures--;
+            return ErrorDeviceRemoved;
+        }
+
+        return ErrorSuccess;
+    });
+    FilterClient client(FactoryFor(device));
+
+    EXPECT_EQ(client.EnablePatch(0), ErrorSuccess);
+    EXPECT_EQ(device.Opens, 2u);
+
+    //
+    // A device that stays gone isn't retried forever
+    // 
+    failures = 10;
+
+    EXPECT_EQ(client.EnablePatch(0), ErrorDeviceRemoved);
+    EXPECT_EQ(device.Opens, 3u);
+}
+
+TEST(ClientTests, OtherErrorsKeepTheHandle)
+{
+    FakeDevice device([](std::uint32_t, const void*, std::uint32_t, void*, std::uint32_t, std::uint32_t*)
+    {
+        return ErrorInvalidParameter;
+    });
+    FilterClient client(FactoryFor(device));
+
+    EXPECT_EQ(client.EnablePatch(0), ErrorInvalidParameter);
+    EXPECT_EQ(client.EnablePatch(0), ErrorInvalidParameter);
+    EXPECT_EQ(device.Opens, 1u);
+}
+
+TEST(ClientTests, OpenFailureIsReported)
+{
+    FakeDevice device(FilterWithDevices(1));
+    device.OpenError = ErrorFileNotFound;
+
+    FilterClient client(FactoryFor(device));
+
+    EXPECT_EQ(client.EnablePatch(0), ErrorFileNotFound);
+    EXPECT_TRUE(device.Codes.empty());
+
+    //
+    // Filter showed up later on
+    // 
+    device.OpenError = ErrorSuccess;
+
+    EXPECT_EQ(client.EnablePatch(0), ErrorSuccess);
+}
+
+TEST(ClientTests, RejectsTooManyRemapRulesLocally)
+{
+    FakeDevice device(FilterWithDevices(1));
+    FilterClient client(FactoryFor(device));
+
+    const std::vector<BTHPS3PSM_PSM_REMAP_RULE> rules(BTHPS3PSM_PSM_REMAP_MAX_RULES + 1);
+
+    EXPECT_EQ(client.SetPsmRemap(0, rules), ErrorInvalidParameter);
+    EXPECT_TRUE(device.Codes.empty());
+}
+
+TEST(ClientTests, BatchQueryKeepsAllRequestsInFlight)
+{
+    constexpr std::uint32_t maxDevices = 8;
+
+    FakeDevice device(FilterWithDevices(3));
+    device.Hold = true;
+
+    FilterClient client(FactoryFor(device));
+    std::vector<BTHPS3PSM_GET_PSM_PATCHING> results;
+    std::uint32_t error = ErrorInvalidHandle;
+
+    std::thread caller([&] { error = client.GetPatchAll(results, maxDevices); });
+
+    //
+    // Nothing completes before every index got submitted
+    // 
+    EXPECT_TRUE(device.WaitOutstanding(maxDevices));
+
+    device.Release();
+    caller.join();
+
+    EXPECT_EQ(device.MaxOutstanding, maxDevices);
+    EXPECT_EQ(error, ErrorSuccess);
+    ASSERT_EQ(results.size(), 3u);
+
+    for (std::uint32_t index = 0; index < results.size(); index++)
+    {
+        EXPECT_EQ(results[index].DeviceIndex, index);
+        EXPECT_EQ(results[index].IsEnabled, index & 1);
+    }
+}
+
+TEST(ClientTests, BatchQueryWithoutDevicesReturnsFirstError)
+{
+    FakeDevice device(FilterWithDevices(0));
+    FilterClient client(FactoryFor(device));
+    std::vector<BTHPS3PSM_GET_PSM_PATCHING> results;
+
+    EXPECT_EQ(client.GetPatchAll(results, 4), ErrorInvalidParameter);
+    EXPECT_TRUE(results.empty());
+}
+
+TEST(ClientTests, InputReportsKeepReadsInFlight)
+{
+    constexpr std::uint32_t inFlight = 4;
+    constexpr std::uint32_t reportLength = 0x32;
+
+    std::atomic<std::uint32_t> sequence{0};
+    FakeDevice device([&sequence](std::uint32_t code, const void*, std::uint32_t, void* out, std::uint32_t length, std::uint32_t* returned)
+    {
+        if (code != IOCTL_BTHPS3_HID_INTERRUPT_READ)
+        {
+            return ErrorInvalidParameter;
+        }
+
+        static_cast<std::uint8_t*>(out)[0] = static_cast<std::uint8_t>(++sequence);
+        *returned = length;
+
+        return ErrorSuccess;
+    });
+    device.Hold = true;
+
+    std::mutex lock;
+    std::condition_variable received;
+    std::vector<std::uint8_t> reports;
+
+    {
+        PdoClient client(FactoryFor(device), L"pdo");
+
+        ASSERT_EQ(client.StartInputReports(inFlight, reportLength, [&](const std::uint8_t* data, std::uint32_t length)
+        {
+            EXPECT_EQ(length, reportLength);
+
+            std::lock_guard<std::mutex> guard(lock);
+            reports.push_back(data[0]);
+            received.notify_all();
+        }), ErrorSuccess);
+
+        EXPECT_TRUE(device.WaitOutstanding(inFlight));
+
+        device.Release();
+
+        std::unique_lock<std::mutex> guard(lock);
+
+        ASSERT_TRUE(received.wait_for(guard, std::chrono::seconds(5), [&] { return reports.size() >= 100; }));
+    }
+
+    //
+    // Every completed read got re-armed, so the count never dropped below inFlight
+    // 
+    EXPECT_EQ(device.MaxOutstanding, inFlight);
+    EXPECT_EQ(reports.size(), sequence.load());
+}
+
+TEST(ClientTests, StopCancelsPendingReadsWithoutReportingErrors)
+{
+    FakeDevice device(FilterWithDevices(0));
+    device.Hold = true;
+
+    std::atomic<std::uint32_t> reports{0};
+    std::atomic<std::uint32_t> errors{0};
+
+    PdoClient client(FactoryFor(device), L"pdo");
+
+    ASSERT_EQ(client.StartInputReports(
+        3,
+        0x40,
+        [&](const std::uint8_t*, std::uint32_t) { ++reports; },
+        [&](std::uint32_t) { ++errors; }
+    ), ErrorSuccess);
+
+    EXPECT_TRUE(device.WaitOutstanding(3));
+
+    //
+    // Returns only once all three aborted completions ran
+    // 
+    client.StopInputReports();
+
+    EXPECT_EQ(reports.load(), 0u);
+    EXPECT_EQ(errors.load(), 0u);
+}
+
+TEST(ClientTests, FailedReadIsReportedAndNotRearmed)
+{
+    FakeDevice device([](std::uint32_t, const void*, std::uint32_t, void*, std::uint32_t, std::uint32_t*)
+    {
+        return ErrorDeviceRemoved;
+    });
+
+    std::atomic<std::uint32_t> errors{0};
+
+    PdoClient client(FactoryFor(device), L"pdo");
+
+    ASSERT_EQ(client.StartInputReports(
+        2,
+        0x40,
+        [](const std::uint8_t*, std::uint32_t) {},
+        [&](std::uint32_t error) { EXPECT_EQ(error, ErrorDeviceRemoved); ++errors; }
+    ), ErrorSuccess);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    while (errors < 2 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+
+    client.StopInputReports();
+
+    EXPECT_EQ(errors.load(), 2u);
+    EXPECT_EQ(device.Codes.size(), 2u);
+}
+
+TEST(ClientTests, NegotiatesDirectIoFromCapabilities)
+{
+    FakeDevice device([](std::uint32_t code, const void*, std::uint32_t, void* out, std::uint32_t, std::uint32_t*)
+    {
+        if (code == IOCTL_BTHPS3_GET_CAPABILITIES)
+        {
+            static_cast<BTHPS3_GET_CAPABILITIES*>(out)->Capabilities = BTHPS3_CAPABILITY_DIRECT_HID_IO;
+        }
+
+        return ErrorSuccess;
+    });
+
+    PdoClient client(FactoryFor(device), L"pdo");
+    std::uint8_t report[0x10] = {};
+    std::uint32_t bytesRead;
+
+    EXPECT_TRUE(client.NegotiateDirectIo());
+    EXPECT_EQ(client.WriteInterrupt(report, sizeof(report)), ErrorSuccess);
+    EXPECT_EQ(client.ReadControl(report, sizeof(report), &bytesRead), ErrorSuccess);
+
+    EXPECT_EQ(device.Codes, (std::vector<std::uint32_t>{
+        IOCTL_BTHPS3_GET_CAPABILITIES,
+        IOCTL_BTHPS3_HID_INTERRUPT_WRITE_DIRECT,
+        IOCTL_BTHPS3_HID_CONTROL_READ_DIRECT
+    }));
+}
+
+TEST(ClientTests, OlderBusDriverKeepsBufferedIo)
+{
+    FakeDevice device([](std::uint32_t code, const void*, std::uint32_t, void*, std::uint32_t, std::uint32_t*)
+    {
+        return code == IOCTL_BTHPS3_GET_CAPABILITIES ? ErrorInvalidParameter : ErrorSuccess;
+    });
+
+    PdoClient client(FactoryFor(device), L"pdo");
+    std::uint8_t report[0x10] = {};
+
+    EXPECT_FALSE(client.NegotiateDirectIo());
+    EXPECT_EQ(client.WriteControl(report, sizeof(report)), ErrorSuccess);
+    EXPECT_EQ(device.Codes.back(), static_cast<std::uint32_t>(IOCTL_BTHPS3_HID_CONTROL_WRITE));
+}
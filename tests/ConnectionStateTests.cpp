@@ -0,0 +1,120 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/ConnectionState.h>
+}
+
+TEST(ConnectionState, ConnectedChannelClosesNow)
+{
+    BTHPS3_CONNECTION_STATE state = ConnectionStateInitialized;
+
+    BthPS3_ConnectionStateConnectCompleted(&state);
+    ASSERT_EQ(ConnectionStateConnected, state);
+
+    EXPECT_EQ(BthPS3DisconnectActionClose, BthPS3_ConnectionStateDisconnect(&state));
+    EXPECT_EQ(ConnectionStateDisconnecting, state);
+
+    BthPS3_ConnectionStateDisconnectCompleted(&state);
+    EXPECT_EQ(ConnectionStateDisconnected, state);
+}
+
+TEST(ConnectionState, ConnectingChannelDefersClose)
+{
+    BTHPS3_CONNECTION_STATE state = ConnectionStateConnecting;
+
+    EXPECT_EQ(BthPS3DisconnectActionDeferred, BthPS3_ConnectionStateDisconnect(&state));
+    EXPECT_EQ(ConnectionStateDisconnecting, state);
+}
+
+TEST(ConnectionState, DisconnectIsIdempotent)
+{
+    BTHPS3_CONNECTION_STATE state = ConnectionStateConnected;
+
+    ASSERT_EQ(BthPS3DisconnectActionClose, BthPS3_ConnectionStateDisconnect(&state));
+
+    //
+    // Both the remote and the PDO tear-down may ask, only one close goes down
+    // 
+    EXPECT_EQ(BthPS3DisconnectActionNone, BthPS3_ConnectionStateDisconnect(&state));
+    EXPECT_EQ(ConnectionStateDisconnecting, state);
+
+    BthPS3_ConnectionStateDisconnectCompleted(&state);
+
+    EXPECT_EQ(BthPS3DisconnectActionNone, BthPS3_ConnectionStateDisconnect(&state));
+    EXPECT_EQ(ConnectionStateDisconnected, state);
+}
+
+TEST(ConnectionState, ChannelsNotConnectedStayPut)
+{
+    for (const auto initial : {
+             ConnectionStateUninitialized,
+             ConnectionStateInitialized,
+             ConnectionStateConnectFailed,
+             ConnectionStateDisconnecting,
+             ConnectionStateDisconnected })
+    {
+        BTHPS3_CONNECTION_STATE state = initial;
+
+        EXPECT_EQ(BthPS3DisconnectActionNone, BthPS3_ConnectionStateDisconnect(&state)) << initial;
+        EXPECT_EQ(initial, state);
+    }
+}
+
+TEST(ConnectionState, CleanUpWaitsForBothChannels)
+{
+    BTHPS3_CONNECTION_STATE control = ConnectionStateConnected;
+    BTHPS3_CONNECTION_STATE interrupt = ConnectionStateConnected;
+
+    EXPECT_FALSE(BthPS3_ConnectionStateBothDisconnected(control, interrupt));
+
+    BthPS3_ConnectionStateDisconnect(&interrupt);
+    BthPS3_ConnectionStateDisconnectCompleted(&interrupt);
+
+    EXPECT_FALSE(BthPS3_ConnectionStateBothDisconnected(control, interrupt));
+
+    BthPS3_ConnectionStateDisconnect(&control);
+
+    EXPECT_FALSE(BthPS3_ConnectionStateBothDisconnected(control, interrupt));
+
+    BthPS3_ConnectionStateDisconnectCompleted(&control);
+
+    EXPECT_TRUE(BthPS3_ConnectionStateBothDisconnected(control, interrupt));
+}
@@ -0,0 +1,421 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/ControllerState.h>
+}
+
+namespace
+{
+    //
+    // Input report of a controller lying untouched on the desk, in the
+    // layout each device type sends including the HIDP DATA header
+    // 
+    std::vector<UCHAR> RestingReport(DS_DEVICE_TYPE DeviceType)
+    {
+        std::vector<UCHAR> report;
+
+        switch (DeviceType)
+        {
+        case DS_DEVICE_TYPE_SIXAXIS:
+        case DS_DEVICE_TYPE_NAVIGATION:
+            report.assign(BTHPS3_SIXAXIS_HID_INPUT_REPORT_SIZE, 0);
+            report[1] = 0x01;
+            report[7] = report[8] = report[9] = report[10] = 0x80;
+            report[31] = 0x05;
+            // Accelerometer 512 + (-12, 0, 113), gyroscope 512 + 2
+            report[42] = 0x01; report[43] = 0xF4;
+            report[44] = 0x02; report[45] = 0x00;
+            report[46] = 0x02; report[47] = 0x71;
+            report[48] = 0x02; report[49] = 0x02;
+            break;
+
+        case DS_DEVICE_TYPE_MOTION:
+            report.assign(BTHPS3_SIXAXIS_HID_INPUT_REPORT_SIZE, 0);
+            report[1] = 0x01;
+            report[13] = 0x04;
+            // Newer sample, accelerometer (-3, 5, 4096), gyroscope (16, -16, 0)
+            report[20] = 0xFD; report[21] = 0x7F;
+            report[22] = 0x05; report[23] = 0x80;
+            report[24] = 0x00; report[25] = 0x90;
+            report[32] = 0x10; report[33] = 0x80;
+            report[34] = 0xF0; report[35] = 0x7F;
+            report[36] = 0x00; report[37] = 0x80;
+            break;
+
+        case DS_DEVICE_TYPE_WIRELESS:
+            report.assign(79, 0);
+            report[1] = 0x11;
+            report[2] = 0xC0;
+            report[4] = report[5] = report[6] = report[7] = 0x80;
+            // Hat released
+            report[8] = 0x08;
+            report[33] = 0x1B;
+            // Gyroscope (-2, 1, 0), accelerometer (120, 8192, -300)
+            report[16] = 0xFE; report[17] = 0xFF;
+            report[18] = 0x01; report[19] = 0x00;
+            report[22] = 0x78; report[23] = 0x00;
+            report[24] = 0x00; report[25] = 0x20;
+            report[26] = 0xD4; report[27] = 0xFE;
+            break;
+
+        default:
+            break;
+        }
+
+        return report;
+    }
+
+    BTHPS3_CONTROLLER_STATE Decode(DS_DEVICE_TYPE DeviceType, const std::vector<UCHAR>& Report)
+    {
+        BTHPS3_CONTROLLER_STATE state;
+
+        EXPECT_TRUE(BthPS3_ControllerStateDecode(
+            DeviceType,
+            Report.data(),
+            static_cast<ULONG>(Report.size()),
+            &state
+        ));
+
+        return state;
+    }
+
+    //
+    // Report bit (byte offset, mask) to the button it carries
+    // 
+    using ButtonBit = std::pair<std::pair<size_t, UCHAR>, ULONG>;
+
+    void ExpectButtons(DS_DEVICE_TYPE DeviceType, std::initializer_list<ButtonBit> Bits)
+    {
+        const auto resting = RestingReport(DeviceType);
+
+        EXPECT_EQ(0u, Decode(DeviceType, resting).Buttons);
+
+        for (const auto& bit : Bits)
+        {
+            auto report = resting;
+
+            report[bit.first.first] |= bit.first.second;
+
+            EXPECT_EQ(bit.second, Decode(DeviceType, report).Buttons)
+                << "byte " << bit.first.first << ", mask 0x" << std::hex << static_cast<int>(bit.first.second);
+        }
+    }
+}
+
+TEST(ControllerStateTests, SixaxisRestingReport)
+{
+    const auto state = Decode(DS_DEVICE_TYPE_SIXAXIS, RestingReport(DS_DEVICE_TYPE_SIXAXIS));
+
+    EXPECT_EQ(0u, state.Timestamp);
+    EXPECT_EQ(DS_DEVICE_TYPE_SIXAXIS, state.DeviceType);
+    EXPECT_EQ(0u, state.Buttons);
+
+    for (const UCHAR stick : state.Sticks)
+    {
+        EXPECT_EQ(0x80, stick);
+    }
+
+    EXPECT_EQ(0, state.Triggers[0]);
+    EXPECT_EQ(0, state.Triggers[1]);
+    EXPECT_EQ(0x05, state.Battery);
+    EXPECT_EQ(-12, state.Accelerometer[0]);
+    EXPECT_EQ(0, state.Accelerometer[1]);
+    EXPECT_EQ(113, state.Accelerometer[2]);
+
+    //
+    // Yaw only
+    // 
+    EXPECT_EQ(0, state.Gyroscope[0]);
+    EXPECT_EQ(0, state.Gyroscope[1]);
+    EXPECT_EQ(2, state.Gyroscope[2]);
+}
+
+TEST(ControllerStateTests, SixaxisButtons)
+{
+    ExpectButtons(DS_DEVICE_TYPE_SIXAXIS, {
+        { { 3, 0x01 }, BTHPS3_BUTTON_SELECT },
+        { { 3, 0x02 }, BTHPS3_BUTTON_L3 },
+        { { 3, 0x04 }, BTHPS3_BUTTON_R3 },
+        { { 3, 0x08 }, BTHPS3_BUTTON_START },
+        { { 3, 0x10 }, BTHPS3_BUTTON_DPAD_UP },
+        { { 3, 0x20 }, BTHPS3_BUTTON_DPAD_RIGHT },
+        { { 3, 0x40 }, BTHPS3_BUTTON_DPAD_DOWN },
+        { { 3, 0x80 }, BTHPS3_BUTTON_DPAD_LEFT },
+        { { 4, 0x01 }, BTHPS3_BUTTON_L2 },
+        { { 4, 0x02 }, BTHPS3_BUTTON_R2 },
+        { { 4, 0x04 }, BTHPS3_BUTTON_L1 },
+        { { 4, 0x08 }, BTHPS3_BUTTON_R1 },
+        { { 4, 0x10 }, BTHPS3_BUTTON_TRIANGLE },
+        { { 4, 0x20 }, BTHPS3_BUTTON_CIRCLE },
+        { { 4, 0x40 }, BTHPS3_BUTTON_CROSS },
+        { { 4, 0x80 }, BTHPS3_BUTTON_SQUARE },
+        { { 5, 0x01 }, BTHPS3_BUTTON_PS },
+        // Unassigned bits stay quiet
+        { { 5, 0x02 }, 0 },
+        { { 5, 0x80 }, 0 }
+    });
+}
+
+TEST(ControllerStateTests, SixaxisSticksAndTriggers)
+{
+    auto report = RestingReport(DS_DEVICE_TYPE_SIXAXIS);
+
+    report[7] = 0x00;
+    report[8] = 0xFF;
+    report[9] = 0x12;
+    report[10] = 0xED;
+    report[19] = 0x40;
+    report[20] = 0xFF;
+
+    const auto state = Decode(DS_DEVICE_TYPE_SIXAXIS, report);
+
+    EXPECT_EQ(0x00, state.Sticks[0]);
+    EXPECT_EQ(0xFF, state.Sticks[1]);
+    EXPECT_EQ(0x12, state.Sticks[2]);
+    EXPECT_EQ(0xED, state.Sticks[3]);
+    EXPECT_EQ(0x40, state.Triggers[0]);
+    EXPECT_EQ(0xFF, state.Triggers[1]);
+}
+
+TEST(ControllerStateTests, NavigationSharesSixaxisLayout)
+{
+    auto report = RestingReport(DS_DEVICE_TYPE_NAVIGATION);
+
+    report[3] = 0x10;
+    report[19] = 0x7F;
+
+    const auto navigation = Decode(DS_DEVICE_TYPE_NAVIGATION, report);
+    const auto sixaxis = Decode(DS_DEVICE_TYPE_SIXAXIS, report);
+
+    EXPECT_EQ(DS_DEVICE_TYPE_NAVIGATION, navigation.DeviceType);
+    EXPECT_EQ(sixaxis.Buttons, navigation.Buttons);
+    EXPECT_EQ(0x7F, navigation.Triggers[0]);
+}
+
+TEST(ControllerStateTests, MotionRestingReport)
+{
+    const auto state = Decode(DS_DEVICE_TYPE_MOTION, RestingReport(DS_DEVICE_TYPE_MOTION));
+
+    EXPECT_EQ(DS_DEVICE_TYPE_MOTION, state.DeviceType);
+    EXPECT_EQ(0u, state.Buttons);
+
+    //
+    // No sticks, reported centered
+    // 
+    for (const UCHAR stick : state.Sticks)
+    {
+        EXPECT_EQ(0x80, stick);
+    }
+
+    EXPECT_EQ(0x04, state.Battery);
+    EXPECT_EQ(-3, state.Accelerometer[0]);
+    EXPECT_EQ(5, state.Accelerometer[1]);
+    EXPECT_EQ(4096, state.Accelerometer[2]);
+    EXPECT_EQ(16, state.Gyroscope[0]);
+    EXPECT_EQ(-16, state.Gyroscope[1]);
+    EXPECT_EQ(0, state.Gyroscope[2]);
+}
+
+TEST(ControllerStateTests, MotionButtonsAndTrigger)
+{
+    ExpectButtons(DS_DEVICE_TYPE_MOTION, {
+        { { 2, 0x01 }, BTHPS3_BUTTON_SELECT },
+        { { 2, 0x08 }, BTHPS3_BUTTON_START },
+        { { 3, 0x10 }, BTHPS3_BUTTON_TRIANGLE },
+        { { 3, 0x20 }, BTHPS3_BUTTON_CIRCLE },
+        { { 3, 0x40 }, BTHPS3_BUTTON_CROSS },
+        { { 3, 0x80 }, BTHPS3_BUTTON_SQUARE },
+        { { 4, 0x01 }, BTHPS3_BUTTON_PS },
+        { { 5, 0x40 }, BTHPS3_BUTTON_MOVE },
+        { { 5, 0x80 }, BTHPS3_BUTTON_T },
+        { { 2, 0x02 }, 0 },
+        { { 3, 0x01 }, 0 }
+    });
+
+    auto report = RestingReport(DS_DEVICE_TYPE_MOTION);
+
+    report[6] = 0xC8;
+
+    const auto state = Decode(DS_DEVICE_TYPE_MOTION, report);
+
+    EXPECT_EQ(0, state.Triggers[0]);
+    EXPECT_EQ(0xC8, state.Triggers[1]);
+}
+
+TEST(ControllerStateTests, WirelessRestingReport)
+{
+    const auto state = Decode(DS_DEVICE_TYPE_WIRELESS, RestingReport(DS_DEVICE_TYPE_WIRELESS));
+
+    EXPECT_EQ(DS_DEVICE_TYPE_WIRELESS, state.DeviceType);
+    EXPECT_EQ(0u, state.Buttons);
+
+    for (const UCHAR stick : state.Sticks)
+    {
+        EXPECT_EQ(0x80, stick);
+    }
+
+    EXPECT_EQ(0x1B, state.Battery);
+    EXPECT_EQ(-2, state.Gyroscope[0]);
+    EXPECT_EQ(1, state.Gyroscope[1]);
+    EXPECT_EQ(0, state.Gyroscope[2]);
+    EXPECT_EQ(120, state.Accelerometer[0]);
+    EXPECT_EQ(8192, state.Accelerometer[1]);
+    EXPECT_EQ(-300, state.Accelerometer[2]);
+}
+
+TEST(ControllerStateTests, WirelessHatSwitch)
+{
+    const ULONG expected[16] =
+    {
+        BTHPS3_BUTTON_DPAD_UP,
+        BTHPS3_BUTTON_DPAD_UP | BTHPS3_BUTTON_DPAD_RIGHT,
+        BTHPS3_BUTTON_DPAD_RIGHT,
+        BTHPS3_BUTTON_DPAD_RIGHT | BTHPS3_BUTTON_DPAD_DOWN,
+        BTHPS3_BUTTON_DPAD_DOWN,
+        BTHPS3_BUTTON_DPAD_DOWN | BTHPS3_BUTTON_DPAD_LEFT,
+        BTHPS3_BUTTON_DPAD_LEFT,
+        BTHPS3_BUTTON_DPAD_LEFT | BTHPS3_BUTTON_DPAD_UP
+    };
+    auto report = RestingReport(DS_DEVICE_TYPE_WIRELESS);
+
+    for (UCHAR position = 0; position < 16; position++)
+    {
+        report[8] = position;
+
+        EXPECT_EQ(expected[position], Decode(DS_DEVICE_TYPE_WIRELESS, report).Buttons)
+            << "hat position " << static_cast<int>(position);
+    }
+}
+
+TEST(ControllerStateTests, WirelessButtons)
+{
+    ExpectButtons(DS_DEVICE_TYPE_WIRELESS, {
+        { { 8, 0x10 }, BTHPS3_BUTTON_SQUARE },
+        { { 8, 0x20 }, BTHPS3_BUTTON_CROSS },
+        { { 8, 0x40 }, BTHPS3_BUTTON_CIRCLE },
+        { { 8, 0x80 }, BTHPS3_BUTTON_TRIANGLE },
+        { { 9, 0x01 }, BTHPS3_BUTTON_L1 },
+        { { 9, 0x02 }, BTHPS3_BUTTON_R1 },
+        { { 9, 0x04 }, BTHPS3_BUTTON_L2 },
+        { { 9, 0x08 }, BTHPS3_BUTTON_R2 },
+        { { 9, 0x10 }, BTHPS3_BUTTON_SELECT },
+        { { 9, 0x20 }, BTHPS3_BUTTON_START },
+        { { 9, 0x40 }, BTHPS3_BUTTON_L3 },
+        { { 9, 0x80 }, BTHPS3_BUTTON_R3 },
+        { { 10, 0x01 }, BTHPS3_BUTTON_PS },
+        { { 10, 0x02 }, BTHPS3_BUTTON_TOUCHPAD },
+        // Report counter shares the byte
+        { { 10, 0xFC }, 0 }
+    });
+}
+
+TEST(ControllerStateTests, WirelessSticksAndTriggers)
+{
+    auto report = RestingReport(DS_DEVICE_TYPE_WIRELESS);
+
+    report[4] = 0x01;
+    report[5] = 0xFE;
+    report[6] = 0x33;
+    report[7] = 0xCC;
+    report[11] = 0x10;
+    report[12] = 0xF0;
+
+    const auto state = Decode(DS_DEVICE_TYPE_WIRELESS, report);
+
+    EXPECT_EQ(0x01, state.Sticks[0]);
+    EXPECT_EQ(0xFE, state.Sticks[1]);
+    EXPECT_EQ(0x33, state.Sticks[2]);
+    EXPECT_EQ(0xCC, state.Sticks[3]);
+    EXPECT_EQ(0x10, state.Triggers[0]);
+    EXPECT_EQ(0xF0, state.Triggers[1]);
+}
+
+TEST(ControllerStateTests, RejectsUnknownDeviceTypes)
+{
+    const auto report = RestingReport(DS_DEVICE_TYPE_SIXAXIS);
+    BTHPS3_CONTROLLER_STATE state;
+
+    EXPECT_FALSE(BthPS3_ControllerStateDecode(
+        DS_DEVICE_TYPE_UNKNOWN,
+        report.data(),
+        static_cast<ULONG>(report.size()),
+        &state
+    ));
+    EXPECT_FALSE(BthPS3_ControllerStateDecode(
+        static_cast<DS_DEVICE_TYPE>(DS_DEVICE_TYPE_WIRELESS + 1),
+        report.data(),
+        static_cast<ULONG>(report.size()),
+        &state
+    ));
+}
+
+TEST(ControllerStateTests, RejectsShortAndForeignReports)
+{
+    for (const DS_DEVICE_TYPE type : { DS_DEVICE_TYPE_SIXAXIS, DS_DEVICE_TYPE_NAVIGATION, DS_DEVICE_TYPE_MOTION, DS_DEVICE_TYPE_WIRELESS })
+    {
+        auto report = RestingReport(type);
+        BTHPS3_CONTROLLER_STATE state;
+
+        //
+        // Cut off before the last decoded byte
+        // 
+        const ULONG minimum = type == DS_DEVICE_TYPE_WIRELESS ? 37 : type == DS_DEVICE_TYPE_MOTION ? 38 : 50;
+
+        EXPECT_FALSE(BthPS3_ControllerStateDecode(type, report.data(), minimum - 1, &state)) << "type " << type;
+        EXPECT_TRUE(BthPS3_ControllerStateDecode(type, report.data(), minimum, &state)) << "type " << type;
+
+        //
+        // Feature or other input reports on the interrupt channel
+        // 
+        report[1] = 0xF2;
+
+        EXPECT_FALSE(BthPS3_ControllerStateDecode(
+            type,
+            report.data(),
+            static_cast<ULONG>(report.size()),
+            &state
+        )) << "type " << type;
+    }
+}
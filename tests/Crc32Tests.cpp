@@ -0,0 +1,217 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/Crc32.h>
+}
+
+namespace
+{
+    //
+    // Bit at a time, what consumers used to compute in user mode
+    // 
+    ULONG Reference(const UCHAR* Data, size_t Length)
+    {
+        ULONG crc = 0xFFFFFFFF;
+
+        for (size_t index = 0; index < Length; index++)
+        {
+            crc ^= Data[index];
+
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0xEDB88320 : 0);
+            }
+        }
+
+        return ~crc;
+    }
+
+    ULONG Crc(const std::string& Text)
+    {
+        return BthPS3_Crc32Update(
+            0,
+            reinterpret_cast<const UCHAR*>(Text.data()),
+            static_cast<ULONG>(Text.size())
+        );
+    }
+
+    //
+    // Bluetooth output report 0x11 including the HIDP DATA header
+    // 
+    std::vector<UCHAR> OutputReport()
+    {
+        std::vector<UCHAR> report(79);
+
+        report[0] = 0xA2;
+        report[1] = 0x11;
+        report[2] = 0xC0;
+        report[4] = 0x07;
+
+        for (size_t index = 7; index < report.size() - BTHPS3_CRC32_SIZE; index++)
+        {
+            report[index] = static_cast<UCHAR>(index * 13);
+        }
+
+        return report;
+    }
+
+    class Crc32Test : public ::testing::Test
+    {
+    protected:
+        static void SetUpTestSuite()
+        {
+            BthPS3_Crc32Init();
+        }
+    };
+}
+
+TEST_F(Crc32Test, KnownAnswers)
+{
+    EXPECT_EQ(0x00000000u, Crc(""));
+    EXPECT_EQ(0xE8B7BE43u, Crc("a"));
+    EXPECT_EQ(0x352441C2u, Crc("abc"));
+    EXPECT_EQ(0xCBF43926u, Crc("123456789"));
+    EXPECT_EQ(0x414FA339u, Crc("The quick brown fox jumps over the lazy dog"));
+}
+
+TEST_F(Crc32Test, MatchesBitwiseAtEveryWidthAndAlignment)
+{
+    std::vector<UCHAR> data(300);
+
+    for (size_t index = 0; index < data.size(); index++)
+    {
+        data[index] = static_cast<UCHAR>(index * 31 + 7);
+    }
+
+    for (size_t offset = 0; offset < 8; offset++)
+    {
+        for (size_t length = 0; length + offset <= 264; length++)
+        {
+            ASSERT_EQ(
+                Reference(&data[offset], length),
+                BthPS3_Crc32Update(0, &data[offset], static_cast<ULONG>(length))
+            ) << "offset " << offset << ", length " << length;
+        }
+    }
+}
+
+TEST_F(Crc32Test, ContinuesAcrossChunks)
+{
+    const std::string text = "The quick brown fox jumps over the lazy dog";
+    const auto* data = reinterpret_cast<const UCHAR*>(text.data());
+
+    for (ULONG split = 0; split <= text.size(); split++)
+    {
+        const ULONG first = BthPS3_Crc32Update(0, data, split);
+
+        EXPECT_EQ(
+            0x414FA339u,
+            BthPS3_Crc32Update(first, data + split, static_cast<ULONG>(text.size()) - split)
+        ) << "split at " << split;
+    }
+}
+
+TEST_F(Crc32Test, SealStoresLittleEndianTrailer)
+{
+    auto report = OutputReport();
+    const ULONG expected = Reference(report.data(), report.size() - BTHPS3_CRC32_SIZE);
+
+    BthPS3_Crc32Seal(report.data(), static_cast<ULONG>(report.size()));
+
+    ULONG stored = 0;
+
+    std::memcpy(&stored, &report[report.size() - BTHPS3_CRC32_SIZE], sizeof(stored));
+
+    EXPECT_EQ(expected, stored);
+}
+
+TEST_F(Crc32Test, SealedReportVerifies)
+{
+    auto report = OutputReport();
+
+    EXPECT_FALSE(BthPS3_Crc32Verify(report.data(), static_cast<ULONG>(report.size())));
+
+    BthPS3_Crc32Seal(report.data(), static_cast<ULONG>(report.size()));
+
+    EXPECT_TRUE(BthPS3_Crc32Verify(report.data(), static_cast<ULONG>(report.size())));
+}
+
+TEST_F(Crc32Test, VerifyCatchesEveryFlippedBit)
+{
+    auto report = OutputReport();
+
+    BthPS3_Crc32Seal(report.data(), static_cast<ULONG>(report.size()));
+
+    for (size_t index = 0; index < report.size(); index++)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            report[index] ^= static_cast<UCHAR>(1 << bit);
+
+            EXPECT_FALSE(BthPS3_Crc32Verify(report.data(), static_cast<ULONG>(report.size())))
+                << "byte " << index << ", bit " << bit;
+
+            report[index] ^= static_cast<UCHAR>(1 << bit);
+        }
+    }
+}
+
+TEST_F(Crc32Test, ResealingFixesStaleTrailer)
+{
+    auto report = OutputReport();
+
+    BthPS3_Crc32Seal(report.data(), static_cast<ULONG>(report.size()));
+
+    //
+    // Consumer changed the rumble after sealing it itself
+    // 
+    report[7]++;
+
+    ASSERT_FALSE(BthPS3_Crc32Verify(report.data(), static_cast<ULONG>(report.size())));
+
+    BthPS3_Crc32Seal(report.data(), static_cast<ULONG>(report.size()));
+
+    EXPECT_TRUE(BthPS3_Crc32Verify(report.data(), static_cast<ULONG>(report.size())));
+}
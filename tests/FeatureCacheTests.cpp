@@ -0,0 +1,380 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/FeatureCache.h>
+}
+
+namespace
+{
+    constexpr BTH_ADDR Sixaxis = 0x0019C1A2B3C4ULL;
+    constexpr BTH_ADDR Navigation = 0x0019C1D5E6F7ULL;
+
+    //
+    // Feature report including the HIDP DATA header, Fill repeated as payload
+    // 
+    std::vector<UCHAR> FeatureReport(UCHAR ReportId, size_t Length, UCHAR Fill)
+    {
+        std::vector<UCHAR> report(Length, Fill);
+
+        report[0] = BTHPS3_FEATURE_CACHE_DATA_HEADER;
+        report[1] = ReportId;
+
+        return report;
+    }
+
+    class FeatureCacheTests : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            BthPS3_FeatureCacheInit(&Cache);
+            BthPS3_FeatureCacheAllow(&Cache, 0x01);
+            BthPS3_FeatureCacheAllow(&Cache, 0xF2);
+        }
+
+        BOOLEAN Store(BTH_ADDR Address, const std::vector<UCHAR>& Report, BOOLEAN IsDirty = TRUE)
+        {
+            return BthPS3_FeatureCacheStore(
+                &Cache,
+                Address,
+                Report.data(),
+                static_cast<ULONG>(Report.size()),
+                IsDirty
+            );
+        }
+
+        bool Lookup(BTH_ADDR Address, UCHAR ReportId, std::vector<UCHAR>& Report, ULONG BufferLength = 0x100)
+        {
+            ULONG length = 0;
+
+            Report.assign(BufferLength, 0);
+
+            const BOOLEAN found = BthPS3_FeatureCacheLookup(
+                &Cache,
+                Address,
+                ReportId,
+                Report.data(),
+                BufferLength,
+                &length
+            );
+
+            Report.resize(length);
+
+            return found != FALSE;
+        }
+
+        BTHPS3_FEATURE_CACHE Cache{};
+    };
+}
+
+TEST(FeatureCacheRequestTests, ParsesFeatureGetReport)
+{
+    const UCHAR request[] = { 0x43, 0xF2 };
+    UCHAR reportId = 0;
+
+    EXPECT_TRUE(BthPS3_FeatureCacheParseRequest(request, sizeof(request), &reportId));
+    EXPECT_EQ(reportId, 0xF2);
+}
+
+TEST(FeatureCacheRequestTests, ParsesFeatureGetReportWithBufferSize)
+{
+    const UCHAR request[] = { 0x4B, 0x01, 0x40, 0x00 };
+    UCHAR reportId = 0;
+
+    EXPECT_TRUE(BthPS3_FeatureCacheParseRequest(request, sizeof(request), &reportId));
+    EXPECT_EQ(reportId, 0x01);
+}
+
+TEST(FeatureCacheRequestTests, RejectsOtherRequests)
+{
+    UCHAR reportId = 0;
+
+    const UCHAR input[] = { 0x41, 0x01 };
+    const UCHAR output[] = { 0x42, 0x01 };
+    const UCHAR setReport[] = { 0x53, 0xF4, 0x42, 0x03 };
+    const UCHAR truncated[] = { 0x43 };
+
+    EXPECT_FALSE(BthPS3_FeatureCacheParseRequest(input, sizeof(input), &reportId));
+    EXPECT_FALSE(BthPS3_FeatureCacheParseRequest(output, sizeof(output), &reportId));
+    EXPECT_FALSE(BthPS3_FeatureCacheParseRequest(setReport, sizeof(setReport), &reportId));
+    EXPECT_FALSE(BthPS3_FeatureCacheParseRequest(truncated, sizeof(truncated), &reportId));
+}
+
+TEST_F(FeatureCacheTests, AllowListCoversOnlyAddedIds)
+{
+    for (int reportId = 0; reportId < 0x100; reportId++)
+    {
+        const bool expected = reportId == 0x01 || reportId == 0xF2;
+
+        EXPECT_EQ(BthPS3_FeatureCacheIsAllowed(&Cache, static_cast<UCHAR>(reportId)) != FALSE, expected)
+            << "report ID " << reportId;
+    }
+}
+
+TEST_F(FeatureCacheTests, InitClearsAllowList)
+{
+    BthPS3_FeatureCacheInit(&Cache);
+
+    EXPECT_FALSE(BthPS3_FeatureCacheIsAllowed(&Cache, 0x01));
+    EXPECT_FALSE(BthPS3_FeatureCacheIsAllowed(&Cache, 0xF2));
+}
+
+TEST_F(FeatureCacheTests, EmptyCacheMisses)
+{
+    std::vector<UCHAR> report;
+
+    EXPECT_FALSE(Lookup(Sixaxis, 0xF2, report));
+    EXPECT_TRUE(report.empty());
+    EXPECT_EQ(Cache.Misses, 1u);
+    EXPECT_EQ(Cache.Hits, 0u);
+}
+
+TEST_F(FeatureCacheTests, StoredReportIsReturned)
+{
+    const auto stored = FeatureReport(0xF2, 0x13, 0x5A);
+    std::vector<UCHAR> report;
+
+    ASSERT_TRUE(Store(Sixaxis, stored));
+    ASSERT_TRUE(Lookup(Sixaxis, 0xF2, report));
+
+    EXPECT_EQ(report, stored);
+    EXPECT_EQ(Cache.Hits, 1u);
+}
+
+TEST_F(FeatureCacheTests, KeyedByAddressAndReportId)
+{
+    const auto sixaxisInfo = FeatureReport(0xF2, 0x13, 0x11);
+    const auto sixaxisCalibration = FeatureReport(0x01, 0x31, 0x22);
+    const auto navigationInfo = FeatureReport(0xF2, 0x13, 0x33);
+    std::vector<UCHAR> report;
+
+    ASSERT_TRUE(Store(Sixaxis, sixaxisInfo));
+    ASSERT_TRUE(Store(Sixaxis, sixaxisCalibration));
+    ASSERT_TRUE(Store(Navigation, navigationInfo));
+
+    ASSERT_TRUE(Lookup(Sixaxis, 0xF2, report));
+    EXPECT_EQ(report, sixaxisInfo);
+    ASSERT_TRUE(Lookup(Sixaxis, 0x01, report));
+    EXPECT_EQ(report, sixaxisCalibration);
+    ASSERT_TRUE(Lookup(Navigation, 0xF2, report));
+    EXPECT_EQ(report, navigationInfo);
+
+    EXPECT_FALSE(Lookup(Navigation, 0x01, report));
+}
+
+TEST_F(FeatureCacheTests, IgnoresReportsNotOnAllowList)
+{
+    std::vector<UCHAR> report;
+
+    EXPECT_FALSE(Store(Sixaxis, FeatureReport(0xF5, 0x10, 0x00)));
+    EXPECT_FALSE(Lookup(Sixaxis, 0xF5, report));
+}
+
+TEST_F(FeatureCacheTests, IgnoresMalformedReports)
+{
+    auto input = FeatureReport(0xF2, 0x13, 0x00);
+    input[0] = 0xA1;
+
+    EXPECT_FALSE(Store(Sixaxis, input));
+    EXPECT_FALSE(Store(Sixaxis, std::vector<UCHAR>{ BTHPS3_FEATURE_CACHE_DATA_HEADER }));
+    EXPECT_FALSE(Store(Sixaxis, FeatureReport(0xF2, BTHPS3_FEATURE_CACHE_MAX_REPORT_SIZE + 1, 0x00)));
+    EXPECT_TRUE(Store(Sixaxis, FeatureReport(0xF2, BTHPS3_FEATURE_CACHE_MAX_REPORT_SIZE, 0x00)));
+}
+
+TEST_F(FeatureCacheTests, LookupMissesIfBufferTooSmall)
+{
+    std::vector<UCHAR> report;
+
+    ASSERT_TRUE(Store(Sixaxis, FeatureReport(0xF2, 0x13, 0x00)));
+
+    EXPECT_FALSE(Lookup(Sixaxis, 0xF2, report, 0x12));
+    EXPECT_TRUE(report.empty());
+    EXPECT_TRUE(Lookup(Sixaxis, 0xF2, report, 0x13));
+}
+
+TEST_F(FeatureCacheTests, NewerContentReplacesEntry)
+{
+    const auto updated = FeatureReport(0x01, 0x20, 0x77);
+    std::vector<UCHAR> report;
+
+    ASSERT_TRUE(Store(Sixaxis, FeatureReport(0x01, 0x31, 0x66)));
+    ASSERT_TRUE(Store(Sixaxis, updated));
+    ASSERT_TRUE(Lookup(Sixaxis, 0x01, report));
+
+    EXPECT_EQ(report, updated);
+
+    size_t used = 0;
+
+    for (const auto& entry : Cache.Entries)
+    {
+        used += entry.Length != 0;
+    }
+
+    EXPECT_EQ(used, 1u);
+}
+
+TEST_F(FeatureCacheTests, TakeDirtyReturnsEachDirtyEntryOnce)
+{
+    ASSERT_TRUE(Store(Sixaxis, FeatureReport(0xF2, 0x13, 0x11)));
+    ASSERT_TRUE(Store(Sixaxis, FeatureReport(0x01, 0x31, 0x22)));
+    ASSERT_TRUE(Store(Navigation, FeatureReport(0xF2, 0x13, 0x33)));
+
+    ULONG cursor = 0;
+    BTHPS3_FEATURE_CACHE_ENTRY entry;
+    std::vector<UCHAR> taken;
+
+    while (BthPS3_FeatureCacheTakeDirty(&Cache, Sixaxis, &cursor, &entry))
+    {
+        EXPECT_EQ(entry.RemoteAddress, Sixaxis);
+        EXPECT_FALSE(entry.IsDirty);
+        taken.push_back(entry.ReportId);
+    }
+
+    EXPECT_EQ(taken.size(), 2u);
+
+    cursor = 0;
+    EXPECT_FALSE(BthPS3_FeatureCacheTakeDirty(&Cache, Sixaxis, &cursor, &entry));
+
+    cursor = 0;
+    ASSERT_TRUE(BthPS3_FeatureCacheTakeDirty(&Cache, Navigation, &cursor, &entry));
+    EXPECT_EQ(entry.ReportId, 0xF2);
+}
+
+TEST_F(FeatureCacheTests, RestoredReportsAreNotDirty)
+{
+    ASSERT_TRUE(Store(Sixaxis, FeatureReport(0xF2, 0x13, 0x11), FALSE));
+
+    ULONG cursor = 0;
+    BTHPS3_FEATURE_CACHE_ENTRY entry;
+
+    EXPECT_FALSE(BthPS3_FeatureCacheTakeDirty(&Cache, Sixaxis, &cursor, &entry));
+}
+
+TEST_F(FeatureCacheTests, UnchangedContentStaysClean)
+{
+    const auto stored = FeatureReport(0xF2, 0x13, 0x11);
+
+    ASSERT_TRUE(Store(Sixaxis, stored));
+
+    ULONG cursor = 0;
+    BTHPS3_FEATURE_CACHE_ENTRY entry;
+
+    ASSERT_TRUE(BthPS3_FeatureCacheTakeDirty(&Cache, Sixaxis, &cursor, &entry));
+
+    //
+    // Same answer after reconnect, nothing to persist again
+    // 
+    ASSERT_TRUE(Store(Sixaxis, stored));
+
+    cursor = 0;
+    EXPECT_FALSE(BthPS3_FeatureCacheTakeDirty(&Cache, Sixaxis, &cursor, &entry));
+
+    ASSERT_TRUE(Store(Sixaxis, FeatureReport(0xF2, 0x13, 0x12)));
+
+    cursor = 0;
+    EXPECT_TRUE(BthPS3_FeatureCacheTakeDirty(&Cache, Sixaxis, &cursor, &entry));
+}
+
+TEST_F(FeatureCacheTests, EvictsLeastRecentlyUsedOnceFull)
+{
+    std::vector<UCHAR> report;
+
+    for (ULONG index = 0; index < BTHPS3_FEATURE_CACHE_MAX_ENTRIES; index++)
+    {
+        ASSERT_TRUE(Store(Sixaxis + index, FeatureReport(0xF2, 0x13, static_cast<UCHAR>(index))));
+    }
+
+    //
+    // Touch the oldest so the second oldest gets replaced
+    // 
+    ASSERT_TRUE(Lookup(Sixaxis, 0xF2, report));
+
+    ASSERT_TRUE(Store(Navigation, FeatureReport(0xF2, 0x13, 0xEE)));
+
+    EXPECT_TRUE(Lookup(Sixaxis, 0xF2, report));
+    EXPECT_FALSE(Lookup(Sixaxis + 1, 0xF2, report));
+    EXPECT_TRUE(Lookup(Navigation, 0xF2, report));
+
+    for (ULONG index = 2; index < BTHPS3_FEATURE_CACHE_MAX_ENTRIES; index++)
+    {
+        EXPECT_TRUE(Lookup(Sixaxis + index, 0xF2, report)) << "entry " << index;
+    }
+}
+
+TEST_F(FeatureCacheTests, ReconnectSkipsRoundTrips)
+{
+    const UCHAR requests[][2] = { { 0x43, 0xF2 }, { 0x43, 0x01 }, { 0x43, 0xF5 } };
+    ULONG roundTrips = 0;
+
+    //
+    // Several connects of the same device, each reading the same reports
+    // 
+    for (int connect = 0; connect < 4; connect++)
+    {
+        for (const auto& request : requests)
+        {
+            UCHAR reportId = 0;
+            std::vector<UCHAR> report;
+
+            ASSERT_TRUE(BthPS3_FeatureCacheParseRequest(request, sizeof(request), &reportId));
+
+            if (Lookup(Sixaxis, reportId, report))
+            {
+                continue;
+            }
+
+            roundTrips++;
+            Store(Sixaxis, FeatureReport(reportId, 0x20, reportId));
+        }
+    }
+
+    //
+    // The allow-listed reports once, the other one on every connect
+    // 
+    EXPECT_EQ(roundTrips, 2u + 4u);
+    EXPECT_EQ(Cache.Hits, 6u);
+
+    RecordProperty("round_trips", static_cast<int>(roundTrips));
+    RecordProperty("cache_hits", static_cast<int>(Cache.Hits));
+}
@@ -0,0 +1,251 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/FlightRecorderRing.h>
+}
+
+namespace
+{
+    constexpr ULONG RingEvents = BTHPS3_FLIGHT_RECORDER_RING_EVENTS;
+
+    //
+    // Derives every field from the sequence number so torn events stand out
+    // 
+    void WriteSequence(PBTHPS3_FLIGHT_RECORDER_RING Ring, ULONG64 Sequence)
+    {
+        BthPS3_FlightRecorderRingWrite(
+            Ring,
+            Sequence,
+            static_cast<ULONG>(Sequence * 7),
+            BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE,
+            static_cast<UCHAR>(Sequence & 3),
+            static_cast<USHORT>(Sequence),
+            Sequence * 3
+        );
+    }
+
+    bool IsIntact(const BTHPS3_FLIGHT_RECORDER_EVENT& Event)
+    {
+        const ULONG64 sequence = Event.Timestamp;
+
+        return Event.Argument == sequence * 3
+            && Event.Processor == static_cast<ULONG>(sequence * 7)
+            && Event.Slot == static_cast<USHORT>(sequence)
+            && Event.Detail == static_cast<UCHAR>(sequence & 3)
+            && Event.Type == BTHPS3_FLIGHT_RECORDER_TRANSFER_COMPLETE;
+    }
+
+    class FlightRecorderRingTest : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            Ring = std::make_unique<BTHPS3_FLIGHT_RECORDER_RING>();
+            std::memset(Ring.get(), 0, sizeof(BTHPS3_FLIGHT_RECORDER_RING));
+        }
+
+        std::vector<BTHPS3_FLIGHT_RECORDER_EVENT> Snapshot(ULONG MaxEvents, ULONG64& LostCount)
+        {
+            std::vector<BTHPS3_FLIGHT_RECORDER_EVENT> events(MaxEvents);
+
+            events.resize(BthPS3_FlightRecorderRingSnapshot(Ring.get(), events.data(), MaxEvents, &LostCount));
+
+            return events;
+        }
+
+        std::unique_ptr<BTHPS3_FLIGHT_RECORDER_RING> Ring;
+    };
+}
+
+TEST(FlightRecorderLayoutTests, EventFitsCompactRecord)
+{
+    EXPECT_LT(sizeof(BTHPS3_FLIGHT_RECORDER_EVENT), 32u);
+    EXPECT_EQ(0u, RingEvents & (RingEvents - 1));
+    EXPECT_EQ(0u, alignof(BTHPS3_FLIGHT_RECORDER_RING) % 64);
+}
+
+TEST_F(FlightRecorderRingTest, EmptyRingSnapshotsNothing)
+{
+    ULONG64 lost = 0;
+
+    EXPECT_TRUE(Snapshot(RingEvents, lost).empty());
+    EXPECT_EQ(0u, lost);
+}
+
+TEST_F(FlightRecorderRingTest, EventIsStoredAsWritten)
+{
+    ULONG64 lost = 0;
+
+    BthPS3_FlightRecorderRingWrite(
+        Ring.get(),
+        0x1122334455ULL,
+        3,
+        BTHPS3_FLIGHT_RECORDER_CONNECT_STAGE,
+        BTHPS3_FLIGHT_RECORDER_CONNECT_PDO_CREATED,
+        5,
+        0x00AABBCCDDEEFFULL
+    );
+
+    const auto events = Snapshot(RingEvents, lost);
+
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(0x1122334455ULL, events[0].Timestamp);
+    EXPECT_EQ(3u, events[0].Processor);
+    EXPECT_EQ(BTHPS3_FLIGHT_RECORDER_CONNECT_STAGE, events[0].Type);
+    EXPECT_EQ(BTHPS3_FLIGHT_RECORDER_CONNECT_PDO_CREATED, events[0].Detail);
+    EXPECT_EQ(5u, events[0].Slot);
+    EXPECT_EQ(0x00AABBCCDDEEFFULL, events[0].Argument);
+    EXPECT_EQ(0u, lost);
+}
+
+TEST_F(FlightRecorderRingTest, SnapshotIsOldestFirst)
+{
+    ULONG64 lost = 0;
+
+    for (ULONG64 sequence = 0; sequence < 10; sequence++)
+    {
+        WriteSequence(Ring.get(), sequence);
+    }
+
+    const auto events = Snapshot(RingEvents, lost);
+
+    ASSERT_EQ(10u, events.size());
+
+    for (ULONG64 index = 0; index < events.size(); index++)
+    {
+        EXPECT_EQ(index, events[index].Timestamp);
+        EXPECT_TRUE(IsIntact(events[index]));
+    }
+}
+
+TEST_F(FlightRecorderRingTest, SmallBufferGetsNewestEvents)
+{
+    ULONG64 lost = 0;
+
+    for (ULONG64 sequence = 0; sequence < 10; sequence++)
+    {
+        WriteSequence(Ring.get(), sequence);
+    }
+
+    const auto events = Snapshot(4, lost);
+
+    ASSERT_EQ(4u, events.size());
+    EXPECT_EQ(6u, events.front().Timestamp);
+    EXPECT_EQ(9u, events.back().Timestamp);
+
+    //
+    // Events left out for lack of room aren't overwritten ones
+    // 
+    EXPECT_EQ(0u, lost);
+}
+
+TEST_F(FlightRecorderRingTest, WrapCountsOverwrittenEvents)
+{
+    ULONG64 lost = 5;
+    const ULONG64 written = RingEvents * 3 + 17;
+
+    for (ULONG64 sequence = 0; sequence < written; sequence++)
+    {
+        WriteSequence(Ring.get(), sequence);
+    }
+
+    const auto events = Snapshot(RingEvents, lost);
+
+    //
+    // The slot the owner writes next counts as overwritten
+    // 
+    ASSERT_EQ(RingEvents - 1, events.size());
+    EXPECT_EQ(written - RingEvents + 1, events.front().Timestamp);
+    EXPECT_EQ(written - 1, events.back().Timestamp);
+    EXPECT_EQ(5 + written - RingEvents + 1, lost);
+}
+
+TEST_F(FlightRecorderRingTest, SnapshotWhileRecordingNeverReturnsTornEvents)
+{
+    std::atomic<bool> stop{ false };
+
+    std::thread owner([&]
+    {
+        for (ULONG64 sequence = 0; !stop.load(std::memory_order_relaxed); sequence++)
+        {
+            WriteSequence(Ring.get(), sequence);
+        }
+    });
+
+    //
+    // Let the owner lap the ring a few times before reading along
+    // 
+    while (ReadAcquire64(&Ring->Head) < static_cast<LONG64>(RingEvents) * 4)
+    {
+        std::this_thread::yield();
+    }
+
+    std::vector<BTHPS3_FLIGHT_RECORDER_EVENT> events(RingEvents);
+
+    for (int round = 0; round < 2000; round++)
+    {
+        ULONG64 lost = 0;
+        const ULONG count = BthPS3_FlightRecorderRingSnapshot(Ring.get(), events.data(), RingEvents, &lost);
+
+        ASSERT_LE(count, RingEvents);
+
+        for (ULONG index = 0; index < count; index++)
+        {
+            ASSERT_TRUE(IsIntact(events[index])) << "round " << round << " event " << index;
+
+            if (index > 0)
+            {
+                ASSERT_EQ(events[index - 1].Timestamp + 1, events[index].Timestamp);
+            }
+        }
+    }
+
+    stop = true;
+    owner.join();
+}
@@ -0,0 +1,308 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/HciTracker.h>
+}
+
+namespace
+{
+    using Bytes = std::vector<UCHAR>;
+
+    constexpr ULONGLONG Ds3Address = 0x0019C1A2B3C4ULL;
+    constexpr ULONGLONG Ds4Address = 0x001FE2D3C4B5ULL;
+
+    Bytes ConnectionComplete(USHORT Handle, ULONGLONG Address, UCHAR Status = 0x00, UCHAR LinkType = HCI_LINK_TYPE_ACL)
+    {
+        Bytes event = {HCI_EVENT_CONNECTION_COMPLETE, 11, Status, static_cast<UCHAR>(Handle), static_cast<UCHAR>(Handle >> 8)};
+
+        for (int i = 0; i < 6; i++)
+        {
+            event.push_back(static_cast<UCHAR>(Address >> (8 * i)));
+        }
+
+        event.push_back(LinkType);
+        event.push_back(0x00);
+
+        return event;
+    }
+
+    Bytes DisconnectionComplete(USHORT Handle, UCHAR Status = 0x00)
+    {
+        return {HCI_EVENT_DISCONNECTION_COMPLETE, 4, Status, static_cast<UCHAR>(Handle), static_cast<UCHAR>(Handle >> 8), 0x13};
+    }
+
+    Bytes Concat(std::initializer_list<Bytes> Events)
+    {
+        Bytes stream;
+
+        for (const auto& event : Events)
+        {
+            stream.insert(stream.end(), event.begin(), event.end());
+        }
+
+        return stream;
+    }
+
+    //
+    // Event pipe traffic while a DS3 pairs up and drops off again, as the
+    // radio reports it: connection request, command status, connection
+    // complete, link key and number of completed packets noise, disconnect
+    // 
+    Bytes RecordedDs3Session(USHORT Handle)
+    {
+        return Concat({
+            {0x04, 0x0A, 0xC4, 0xB3, 0xA2, 0xC1, 0x19, 0x00, 0x08, 0x05, 0x00, 0x01},
+            {0x0F, 0x04, 0x00, 0x01, 0x09, 0x04},
+            ConnectionComplete(Handle, Ds3Address),
+            {0x1B, 0x03, static_cast<UCHAR>(Handle), static_cast<UCHAR>(Handle >> 8), 0x05},
+            {0x13, 0x05, 0x01, static_cast<UCHAR>(Handle), static_cast<UCHAR>(Handle >> 8), 0x01, 0x00},
+        });
+    }
+
+    bool Lookup(const BTHPS3PSM_HCI_TRACKER& Tracker, USHORT Handle, ULONGLONG* Address)
+    {
+        return BthPS3PSM_HciTrackerGetAddress(&Tracker, Handle, Address) != FALSE;
+    }
+
+    class HciTrackerTest : public ::testing::Test
+    {
+    protected:
+        BTHPS3PSM_HCI_TRACKER Tracker;
+
+        void SetUp() override
+        {
+            BthPS3PSM_HciTrackerInit(&Tracker);
+        }
+
+        void Feed(const Bytes& Transfer)
+        {
+            BthPS3PSM_HciTrackerFeed(&Tracker, Transfer.data(), static_cast<ULONG>(Transfer.size()));
+        }
+    };
+}
+
+TEST_F(HciTrackerTest, MapsHandleToAddressOnConnectionComplete)
+{
+    ULONGLONG address = 0;
+
+    Feed(RecordedDs3Session(0x0040));
+
+    ASSERT_TRUE(Lookup(Tracker, 0x0040, &address));
+    EXPECT_EQ(address, Ds3Address);
+    EXPECT_FALSE(Lookup(Tracker, 0x0041, &address));
+}
+
+TEST_F(HciTrackerTest, IgnoresFailedAndNonAclConnections)
+{
+    ULONGLONG address = 0;
+
+    Feed(ConnectionComplete(0x0040, Ds3Address, 0x04));
+    Feed(ConnectionComplete(0x0041, Ds4Address, 0x00, 0x00));
+
+    EXPECT_FALSE(Lookup(Tracker, 0x0040, &address));
+    EXPECT_FALSE(Lookup(Tracker, 0x0041, &address));
+}
+
+TEST_F(HciTrackerTest, ForgetsHandleOnDisconnectionComplete)
+{
+    ULONGLONG address = 0;
+
+    Feed(Concat({RecordedDs3Session(0x0040), ConnectionComplete(0x0041, Ds4Address)}));
+
+    //
+    // A failed disconnect leaves the link up
+    // 
+    Feed(DisconnectionComplete(0x0040, 0x0C));
+    EXPECT_TRUE(Lookup(Tracker, 0x0040, &address));
+
+    Feed(DisconnectionComplete(0x0040));
+
+    EXPECT_FALSE(Lookup(Tracker, 0x0040, &address));
+    ASSERT_TRUE(Lookup(Tracker, 0x0041, &address));
+    EXPECT_EQ(address, Ds4Address);
+}
+
+TEST_F(HciTrackerTest, ReassemblesEventsSplitAtAnyByte)
+{
+    const Bytes stream = Concat({
+        RecordedDs3Session(0x0040),
+        ConnectionComplete(0x0041, Ds4Address),
+        DisconnectionComplete(0x0040),
+    });
+
+    for (size_t split = 0; split <= stream.size(); split++)
+    {
+        BthPS3PSM_HciTrackerInit(&Tracker);
+
+        Feed(Bytes(stream.begin(), stream.begin() + split));
+        Feed(Bytes(stream.begin() + split, stream.end()));
+
+        ULONGLONG address = 0;
+
+        EXPECT_FALSE(Lookup(Tracker, 0x0040, &address)) << "split at " << split;
+        ASSERT_TRUE(Lookup(Tracker, 0x0041, &address)) << "split at " << split;
+        EXPECT_EQ(address, Ds4Address) << "split at " << split;
+        EXPECT_EQ(Tracker.EventLength, 0u) << "split at " << split;
+    }
+}
+
+TEST_F(HciTrackerTest, ReassemblesByteByByte)
+{
+    const Bytes stream = RecordedDs3Session(0x0042);
+
+    for (const UCHAR byte : stream)
+    {
+        Feed({byte});
+    }
+
+    ULONGLONG address = 0;
+
+    ASSERT_TRUE(Lookup(Tracker, 0x0042, &address));
+    EXPECT_EQ(address, Ds3Address);
+}
+
+TEST_F(HciTrackerTest, ReusedHandleTakesTheNewAddress)
+{
+    ULONGLONG address = 0;
+
+    //
+    // Disconnect got lost, the controller hands out the handle again
+    // 
+    Feed(ConnectionComplete(0x0040, Ds3Address));
+    Feed(ConnectionComplete(0x0040, Ds4Address));
+
+    ASSERT_TRUE(Lookup(Tracker, 0x0040, &address));
+    EXPECT_EQ(address, Ds4Address);
+
+    Feed(DisconnectionComplete(0x0040));
+
+    EXPECT_FALSE(Lookup(Tracker, 0x0040, &address));
+}
+
+TEST_F(HciTrackerTest, FullTableDropsNewLinksUntilOneCloses)
+{
+    ULONGLONG address = 0;
+
+    for (USHORT i = 0; i < BTHPS3PSM_HCI_MAX_CONNECTIONS; i++)
+    {
+        Feed(ConnectionComplete(0x0040 + i, Ds3Address + i));
+    }
+
+    const USHORT overflow = 0x0040 + BTHPS3PSM_HCI_MAX_CONNECTIONS;
+
+    Feed(ConnectionComplete(overflow, Ds4Address));
+    EXPECT_FALSE(Lookup(Tracker, overflow, &address));
+
+    Feed(DisconnectionComplete(0x0045));
+    Feed(ConnectionComplete(overflow, Ds4Address));
+
+    ASSERT_TRUE(Lookup(Tracker, overflow, &address));
+    EXPECT_EQ(address, Ds4Address);
+
+    for (USHORT i = 0; i < BTHPS3PSM_HCI_MAX_CONNECTIONS; i++)
+    {
+        if (0x0040 + i == 0x0045)
+        {
+            continue;
+        }
+
+        ASSERT_TRUE(Lookup(Tracker, 0x0040 + i, &address));
+        EXPECT_EQ(address, Ds3Address + i);
+    }
+}
+
+TEST_F(HciTrackerTest, ResyncDropsPartialEvent)
+{
+    const Bytes event = ConnectionComplete(0x0040, Ds3Address);
+    ULONGLONG address = 0;
+
+    //
+    // Transfer failed half-way through an event
+    // 
+    Feed(Bytes(event.begin(), event.begin() + 6));
+    BthPS3PSM_HciTrackerResync(&Tracker);
+
+    Feed(ConnectionComplete(0x0041, Ds4Address));
+
+    EXPECT_FALSE(Lookup(Tracker, 0x0040, &address));
+    ASSERT_TRUE(Lookup(Tracker, 0x0041, &address));
+    EXPECT_EQ(address, Ds4Address);
+}
+
+TEST_F(HciTrackerTest, SkipsLongestPossibleForeignEvent)
+{
+    Bytes commandComplete = {0x0E, 0xFF};
+
+    //
+    // Parameter bytes that would look like a connection complete if the
+    // tracker lost track of event boundaries
+    // 
+    for (int i = 0; i < 0xFF; i++)
+    {
+        commandComplete.push_back(HCI_EVENT_CONNECTION_COMPLETE);
+    }
+
+    Feed(Concat({commandComplete, ConnectionComplete(0x0040, Ds3Address)}));
+
+    ULONGLONG address = 0;
+
+    ASSERT_TRUE(Lookup(Tracker, 0x0040, &address));
+    EXPECT_EQ(address, Ds3Address);
+    EXPECT_FALSE(Lookup(Tracker, 0x0303, &address));
+}
+
+TEST_F(HciTrackerTest, MasksFlagBitsOfTheHandle)
+{
+    ULONGLONG address = 0;
+
+    Feed(ConnectionComplete(0x2040, Ds3Address));
+
+    ASSERT_TRUE(Lookup(Tracker, 0x0040, &address));
+    EXPECT_EQ(address, Ds3Address);
+
+    const UCHAR aclHeader[] = {0x40, 0x20};
+
+    EXPECT_EQ(HCI_GET_ACL_HANDLE(aclHeader), 0x0040);
+}
@@ -0,0 +1,305 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/IdlePolicy.h>
+}
+
+namespace
+{
+    //
+    // ChildIdleTimeout, ChildIdleTimeoutMin and ChildIdleTimeoutMax of BthPS3.inf
+    // 
+    constexpr ULONG DefaultTimeout = 10000;
+    constexpr ULONG MinimumTimeout = 5000;
+    constexpr ULONG MaximumTimeout = 60000;
+
+    //
+    // Time a powered down controller needs until its next report gets through
+    // 
+    constexpr ULONG64 WakeLatencyMs = 300;
+
+    struct Result
+    {
+        ULONG Wakes = 0;
+        ULONG64 LatencyPenaltyMs = 0;
+        ULONG64 PoweredIdleMs = 0;
+    };
+
+    //
+    // Replays the pauses between bursts of activity of a single PDO. A pause
+    // longer than the timeout in effect powers the controller down, costing
+    // a wake on the next burst, otherwise it stays in D0 all along.
+    // 
+    Result Simulate(const std::vector<ULONG64>& Gaps, ULONG Minimum, ULONG Maximum)
+    {
+        BTHPS3_IDLE_POLICY policy;
+        Result result;
+
+        BthPS3_IdlePolicyInit(&policy, DefaultTimeout, Minimum, Maximum);
+
+        for (const ULONG64 gap : Gaps)
+        {
+            if (gap > policy.Timeout)
+            {
+                result.Wakes++;
+                result.LatencyPenaltyMs += WakeLatencyMs;
+                result.PoweredIdleMs += policy.Timeout;
+            }
+            else
+            {
+                result.PoweredIdleMs += gap;
+            }
+
+            (void)BthPS3_IdlePolicyAddGap(&policy, gap);
+
+            EXPECT_GE(policy.Timeout, Minimum);
+            EXPECT_LE(policy.Timeout, Maximum);
+        }
+
+        return result;
+    }
+
+    Result SimulateFixed(const std::vector<ULONG64>& Gaps)
+    {
+        return Simulate(Gaps, DefaultTimeout, DefaultTimeout);
+    }
+
+    Result SimulateAdaptive(const std::vector<ULONG64>& Gaps)
+    {
+        return Simulate(Gaps, MinimumTimeout, MaximumTimeout);
+    }
+
+    std::vector<ULONG64> UniformGaps(ULONG Count, ULONG64 Low, ULONG64 High, ULONG Seed)
+    {
+        std::mt19937 random(Seed);
+        std::uniform_int_distribution<ULONG64> gap(Low, High);
+        std::vector<ULONG64> gaps;
+
+        for (ULONG index = 0; index < Count; index++)
+        {
+            gaps.push_back(gap(random));
+        }
+
+        return gaps;
+    }
+
+    //
+    // Play session: mostly short pauses in menus and cut-scenes that run
+    // somewhat longer than the default timeout, now and then a break
+    // 
+    std::vector<ULONG64> PlaySessionGaps(ULONG Seed)
+    {
+        std::mt19937 random(Seed);
+        std::lognormal_distribution<double> pause(9.3, 0.5);
+        std::bernoulli_distribution isBreak(0.05);
+        std::uniform_int_distribution<ULONG64> breakLength(5 * 60 * 1000, 20 * 60 * 1000);
+        std::vector<ULONG64> gaps;
+
+        for (int index = 0; index < 400; index++)
+        {
+            gaps.push_back(isBreak(random) ? breakLength(random) : static_cast<ULONG64>(pause(random)));
+        }
+
+        return gaps;
+    }
+}
+
+TEST(IdlePolicyTests, InitClampsInitialTimeout)
+{
+    BTHPS3_IDLE_POLICY policy;
+
+    BthPS3_IdlePolicyInit(&policy, 1000, MinimumTimeout, MaximumTimeout);
+    EXPECT_EQ(MinimumTimeout, policy.Timeout);
+
+    BthPS3_IdlePolicyInit(&policy, 120000, MinimumTimeout, MaximumTimeout);
+    EXPECT_EQ(MaximumTimeout, policy.Timeout);
+
+    //
+    // Swapped bounds collapse onto the maximum passed in
+    // 
+    BthPS3_IdlePolicyInit(&policy, DefaultTimeout, MaximumTimeout, MinimumTimeout);
+    EXPECT_EQ(MinimumTimeout, policy.MinimumTimeout);
+    EXPECT_EQ(MinimumTimeout, policy.Timeout);
+}
+
+TEST(IdlePolicyTests, EqualBoundsNeverAdapt)
+{
+    BTHPS3_IDLE_POLICY policy;
+
+    BthPS3_IdlePolicyInit(&policy, DefaultTimeout, DefaultTimeout, DefaultTimeout);
+
+    for (int index = 0; index < 100; index++)
+    {
+        EXPECT_FALSE(BthPS3_IdlePolicyAddGap(&policy, 15000));
+    }
+
+    EXPECT_EQ(DefaultTimeout, policy.Timeout);
+}
+
+TEST(IdlePolicyTests, IgnoresGapsWithinBurst)
+{
+    BTHPS3_IDLE_POLICY policy;
+
+    BthPS3_IdlePolicyInit(&policy, DefaultTimeout, MinimumTimeout, MaximumTimeout);
+
+    for (int index = 0; index < 100; index++)
+    {
+        EXPECT_FALSE(BthPS3_IdlePolicyAddGap(&policy, BTHPS3_IDLE_POLICY_MIN_GAP_MS - 1));
+    }
+
+    EXPECT_EQ(0u, policy.SamplesSinceDecay);
+    EXPECT_EQ(DefaultTimeout, policy.Timeout);
+}
+
+TEST(IdlePolicyTests, WaitsForMinimumSamples)
+{
+    BTHPS3_IDLE_POLICY policy;
+
+    BthPS3_IdlePolicyInit(&policy, DefaultTimeout, MinimumTimeout, MaximumTimeout);
+
+    for (int index = 0; index < BTHPS3_IDLE_POLICY_MIN_SAMPLES - 1; index++)
+    {
+        EXPECT_FALSE(BthPS3_IdlePolicyAddGap(&policy, 20000));
+    }
+
+    EXPECT_TRUE(BthPS3_IdlePolicyAddGap(&policy, 20000));
+
+    //
+    // Upper edge of the [16384, 32768) bucket
+    // 
+    EXPECT_EQ(32768u, policy.Timeout);
+}
+
+TEST(IdlePolicyTests, LongPausesDropToMinimum)
+{
+    BTHPS3_IDLE_POLICY policy;
+
+    BthPS3_IdlePolicyInit(&policy, DefaultTimeout, MinimumTimeout, MaximumTimeout);
+
+    for (int index = 0; index < BTHPS3_IDLE_POLICY_MIN_SAMPLES; index++)
+    {
+        (void)BthPS3_IdlePolicyAddGap(&policy, 10 * 60 * 1000);
+    }
+
+    EXPECT_EQ(MinimumTimeout, policy.Timeout);
+}
+
+TEST(IdlePolicyTests, DecayFollowsChangedBehaviour)
+{
+    BTHPS3_IDLE_POLICY policy;
+
+    BthPS3_IdlePolicyInit(&policy, DefaultTimeout, MinimumTimeout, MaximumTimeout);
+
+    for (int index = 0; index < 64; index++)
+    {
+        (void)BthPS3_IdlePolicyAddGap(&policy, 20000);
+    }
+
+    ASSERT_EQ(32768u, policy.Timeout);
+
+    for (int index = 0; index < 128; index++)
+    {
+        (void)BthPS3_IdlePolicyAddGap(&policy, 3000);
+    }
+
+    EXPECT_EQ(MinimumTimeout, policy.Timeout);
+
+    for (ULONG index = 0; index < BTHPS3_IDLE_POLICY_BUCKETS; index++)
+    {
+        EXPECT_LE(policy.Histogram[index], 2u * BTHPS3_IDLE_POLICY_DECAY_INTERVAL);
+    }
+}
+
+//
+// Simulations against activity traces, the adaptive policy is compared to
+// the fixed ChildIdleTimeout by wake count, latency penalty and time spent
+// powered while idle
+// 
+
+TEST(IdlePolicySimulationTests, PlaySessionWakesLess)
+{
+    const auto gaps = PlaySessionGaps(0x1D1E);
+    const Result fixed = SimulateFixed(gaps);
+    const Result adaptive = SimulateAdaptive(gaps);
+
+    RecordProperty("FixedWakes", static_cast<int>(fixed.Wakes));
+    RecordProperty("AdaptiveWakes", static_cast<int>(adaptive.Wakes));
+    RecordProperty("FixedPenaltyMs", static_cast<int>(fixed.LatencyPenaltyMs));
+    RecordProperty("AdaptivePenaltyMs", static_cast<int>(adaptive.LatencyPenaltyMs));
+
+    EXPECT_LT(adaptive.Wakes * 3, fixed.Wakes);
+    EXPECT_LT(adaptive.LatencyPenaltyMs, fixed.LatencyPenaltyMs);
+}
+
+TEST(IdlePolicySimulationTests, IdleControllerPowersDownSooner)
+{
+    //
+    // Picked up every few minutes for a moment, every pause wakes either way
+    // 
+    const auto gaps = UniformGaps(200, 2 * 60 * 1000, 10 * 60 * 1000, 0x1D1F);
+    const Result fixed = SimulateFixed(gaps);
+    const Result adaptive = SimulateAdaptive(gaps);
+
+    RecordProperty("FixedPoweredIdleMs", static_cast<int>(fixed.PoweredIdleMs));
+    RecordProperty("AdaptivePoweredIdleMs", static_cast<int>(adaptive.PoweredIdleMs));
+
+    EXPECT_EQ(fixed.Wakes, adaptive.Wakes);
+    EXPECT_LT(adaptive.PoweredIdleMs, fixed.PoweredIdleMs);
+}
+
+TEST(IdlePolicySimulationTests, ShortPausesMatchFixedTimeout)
+{
+    //
+    // Pauses the default already bridges must not start costing wakes
+    // 
+    const auto gaps = UniformGaps(300, 500, 4000, 0x1D20);
+    const Result fixed = SimulateFixed(gaps);
+    const Result adaptive = SimulateAdaptive(gaps);
+
+    EXPECT_EQ(0u, fixed.Wakes);
+    EXPECT_EQ(0u, adaptive.Wakes);
+    EXPECT_EQ(fixed.PoweredIdleMs, adaptive.PoweredIdleMs);
+}
@@ -0,0 +1,143 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/L2CAP.h>
+#include <BthPS3PSM/HciTracker.h>
+}
+
+namespace
+{
+    //
+    // ACL packet as it arrives on the bulk IN pipe: HCI ACL header, L2CAP
+    // basic header on the signalling channel and the command
+    // 
+    std::vector<UCHAR> SignallingPacket(UCHAR Code, USHORT Handle, USHORT Psm)
+    {
+        std::vector<UCHAR> packet = {
+            static_cast<UCHAR>(Handle & 0xFF), static_cast<UCHAR>(0x20 | ((Handle >> 8) & 0x0F)),
+            0x0C, 0x00,
+            0x08, 0x00,
+            0x01, 0x00,
+            Code, 0x01, 0x04, 0x00,
+            static_cast<UCHAR>(Psm & 0xFF), static_cast<UCHAR>(Psm >> 8),
+            0x40, 0x00
+        };
+
+        return packet;
+    }
+}
+
+TEST(L2capSignalling, StructuresMatchTheWireLayout)
+{
+    EXPECT_EQ(8u, sizeof(L2CAP_SIGNALLING_CONNECTION_REQUEST));
+    EXPECT_EQ(4u, offsetof(L2CAP_SIGNALLING_CONNECTION_REQUEST, PSM));
+    EXPECT_EQ(6u, offsetof(L2CAP_SIGNALLING_CONNECTION_REQUEST, SCID));
+    EXPECT_EQ(12u, sizeof(L2CAP_SIGNALLING_CONNECTION_RESPONSE));
+    EXPECT_EQ(8u, offsetof(L2CAP_SIGNALLING_CONNECTION_RESPONSE, Result));
+}
+
+TEST(L2capSignalling, AcceptsConnectionRequest)
+{
+    auto packet = SignallingPacket(L2CAP_Connection_Request, 0x002A, 0x0011);
+
+    ASSERT_TRUE(L2CAP_IS_SIGNALLING_PACKET(packet.data(), static_cast<ULONG>(packet.size())));
+    EXPECT_EQ(L2CAP_Connection_Request, L2CAP_GET_SIGNALLING_COMMAND_CODE(packet.data()));
+    EXPECT_EQ(0x002A, HCI_GET_ACL_HANDLE(packet.data()));
+
+    const auto request = reinterpret_cast<PL2CAP_SIGNALLING_CONNECTION_REQUEST>(&packet[8]);
+
+    EXPECT_EQ(0x0011, request->PSM);
+    EXPECT_EQ(0x40, request->SCID.Lsb);
+}
+
+TEST(L2capSignalling, AcceptsEveryDefinedCommandCode)
+{
+    for (UCHAR code = L2CAP_Command_Reject; code <= L2CAP_Information_Response; code++)
+    {
+        auto packet = SignallingPacket(code, 0x0001, 0x0011);
+
+        EXPECT_TRUE(L2CAP_IS_SIGNALLING_PACKET(packet.data(), static_cast<ULONG>(packet.size()))) << int(code);
+    }
+}
+
+TEST(L2capSignalling, RejectsUndefinedCommandCodes)
+{
+    for (const UCHAR code : { 0x00, 0x0C, 0x12, 0xFF })
+    {
+        auto packet = SignallingPacket(code, 0x0001, 0x0011);
+
+        EXPECT_FALSE(L2CAP_IS_SIGNALLING_PACKET(packet.data(), static_cast<ULONG>(packet.size()))) << int(code);
+    }
+}
+
+TEST(L2capSignalling, RejectsOtherChannels)
+{
+    auto packet = SignallingPacket(L2CAP_Connection_Request, 0x0001, 0x0011);
+
+    packet[6] = 0x40;
+    EXPECT_FALSE(L2CAP_IS_SIGNALLING_PACKET(packet.data(), static_cast<ULONG>(packet.size())));
+
+    packet[6] = 0x01;
+    packet[7] = 0x01;
+    EXPECT_FALSE(L2CAP_IS_SIGNALLING_PACKET(packet.data(), static_cast<ULONG>(packet.size())));
+}
+
+TEST(L2capSignalling, RejectsShortOrMissingBuffers)
+{
+    auto packet = SignallingPacket(L2CAP_Connection_Request, 0x0001, 0x0011);
+
+    EXPECT_FALSE(L2CAP_IS_SIGNALLING_PACKET(packet.data(), L2CAP_MIN_BUFFER_LEN - 1));
+    EXPECT_TRUE(L2CAP_IS_SIGNALLING_PACKET(packet.data(), L2CAP_MIN_BUFFER_LEN));
+    EXPECT_FALSE(L2CAP_IS_SIGNALLING_PACKET(nullptr, L2CAP_MIN_BUFFER_LEN));
+}
+
+TEST(L2capSignalling, IdentifiesHidInputReports)
+{
+    std::vector<UCHAR> packet = { 0x2A, 0x20, 0x34, 0x00, 0x30, 0x00, 0x41, 0x00, 0xA1, 0x01, 0x00, 0x00 };
+
+    EXPECT_TRUE(L2CAP_IS_HID_INPUT_REPORT(packet.data()));
+    EXPECT_FALSE(L2CAP_IS_CONTROL_CHANNEL(packet.data()));
+
+    packet[9] = 0x11;
+    EXPECT_FALSE(L2CAP_IS_HID_INPUT_REPORT(packet.data()));
+}
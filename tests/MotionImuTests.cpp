@@ -0,0 +1,284 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/MotionImu.h>
+}
+
+namespace
+{
+    //
+    // Layout of a Motion Controller input report with the HIDP DATA header,
+    // sensor values picked to cover bias and sign handling
+    // 
+    const std::array<UCHAR, 50> RecordedReport =
+    {
+        0xA1, 0x01, 0x00, 0x00, 0x00, 0x37, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+        // Accelerometer, older then newer sample
+        0x00, 0x80, 0x00, 0x81, 0x00, 0x40,
+        0x01, 0x80, 0xFF, 0x80, 0x10, 0x40,
+        // Gyroscope, older then newer sample
+        0xFF, 0xFF, 0x00, 0x00, 0x34, 0x92,
+        0xFE, 0xFF, 0x01, 0x00, 0xCC, 0x6D,
+        // Temperature, magnetometer, timestamps and the rest aren't decoded
+        0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A,
+        0x5A, 0x5A
+    };
+
+    std::array<UCHAR, 50> WithSequence(UCHAR Sequence)
+    {
+        auto report = RecordedReport;
+
+        report[5] = static_cast<UCHAR>((report[5] & 0xF0) | (Sequence & 0x0F));
+
+        return report;
+    }
+
+    class MotionImuTest : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            BthPS3_MotionImuInit(&Clock);
+        }
+
+        BOOLEAN Unpack(UCHAR Sequence, ULONG64 ArrivalTime)
+        {
+            const auto report = WithSequence(Sequence);
+
+            return BthPS3_MotionImuUnpack(
+                &Clock,
+                report.data(),
+                static_cast<ULONG>(report.size()),
+                ArrivalTime,
+                Samples
+            );
+        }
+
+        //
+        // Steady stream of reports two samples apart, starting after Start
+        // 
+        ULONG64 Stream(ULONG Count, ULONG64 Start, ULONG64 SampleInterval, UCHAR* Sequence)
+        {
+            ULONG64 arrival = Start;
+
+            for (ULONG index = 0; index < Count; index++)
+            {
+                arrival += 2 * SampleInterval;
+                EXPECT_TRUE(Unpack((*Sequence)++, arrival));
+            }
+
+            return arrival;
+        }
+
+        BTHPS3_MOTION_IMU_CLOCK Clock;
+        BTHPS3_MOTION_IMU_SAMPLE Samples[2];
+    };
+}
+
+TEST_F(MotionImuTest, RejectsShortReport)
+{
+    EXPECT_FALSE(BthPS3_MotionImuUnpack(
+        &Clock,
+        RecordedReport.data(),
+        BTHPS3_MOTION_IMU_MIN_REPORT_SIZE - 1,
+        1000000,
+        Samples
+    ));
+
+    //
+    // Rejected reports don't feed the clock
+    // 
+    EXPECT_EQ(0u, Clock.LastArrival);
+}
+
+TEST_F(MotionImuTest, RejectsOtherReportIds)
+{
+    auto report = RecordedReport;
+
+    report[1] = 0x02;
+
+    EXPECT_FALSE(BthPS3_MotionImuUnpack(
+        &Clock,
+        report.data(),
+        static_cast<ULONG>(report.size()),
+        1000000,
+        Samples
+    ));
+}
+
+TEST_F(MotionImuTest, AcceptsReportWithoutTrailer)
+{
+    EXPECT_TRUE(BthPS3_MotionImuUnpack(
+        &Clock,
+        RecordedReport.data(),
+        BTHPS3_MOTION_IMU_MIN_REPORT_SIZE,
+        1000000,
+        Samples
+    ));
+}
+
+TEST_F(MotionImuTest, DecodesRecordedReport)
+{
+    ASSERT_TRUE(Unpack(7, 1000000));
+
+    EXPECT_EQ(0, Samples[0].Accelerometer[0]);
+    EXPECT_EQ(256, Samples[0].Accelerometer[1]);
+    EXPECT_EQ(-16384, Samples[0].Accelerometer[2]);
+    EXPECT_EQ(32767, Samples[0].Gyroscope[0]);
+    EXPECT_EQ(-32768, Samples[0].Gyroscope[1]);
+    EXPECT_EQ(4660, Samples[0].Gyroscope[2]);
+
+    EXPECT_EQ(1, Samples[1].Accelerometer[0]);
+    EXPECT_EQ(255, Samples[1].Accelerometer[1]);
+    EXPECT_EQ(-16368, Samples[1].Accelerometer[2]);
+    EXPECT_EQ(32766, Samples[1].Gyroscope[0]);
+    EXPECT_EQ(-32767, Samples[1].Gyroscope[1]);
+    EXPECT_EQ(-4660, Samples[1].Gyroscope[2]);
+
+    for (ULONG frame = 0; frame < 2; frame++)
+    {
+        EXPECT_EQ(7, Samples[frame].Sequence);
+        EXPECT_EQ(frame, Samples[frame].Frame);
+        EXPECT_EQ(0, Samples[frame].Reserved);
+    }
+}
+
+TEST_F(MotionImuTest, FirstReportUsesNominalInterval)
+{
+    ASSERT_TRUE(Unpack(0, 1000000));
+
+    EXPECT_EQ(1000000u, Samples[1].Timestamp);
+    EXPECT_EQ(1000000u - BTHPS3_MOTION_IMU_NOMINAL_INTERVAL, Samples[0].Timestamp);
+}
+
+TEST_F(MotionImuTest, LearnsSampleInterval)
+{
+    UCHAR sequence = 0;
+
+    (void)Stream(200, 1000000, 50000, &sequence);
+
+    EXPECT_NEAR(50000.0, static_cast<double>(Clock.SampleInterval), 50.0);
+    EXPECT_EQ(Samples[1].Timestamp - Clock.SampleInterval, Samples[0].Timestamp);
+}
+
+TEST_F(MotionImuTest, LostReportsDontSkewInterval)
+{
+    UCHAR sequence = 0;
+    ULONG64 arrival = Stream(200, 1000000, 50000, &sequence);
+    const ULONG64 learned = Clock.SampleInterval;
+
+    //
+    // Two reports never made it, the counter tells
+    // 
+    sequence += 2;
+    arrival += 3 * 2 * 50000;
+
+    ASSERT_TRUE(Unpack(sequence, arrival));
+    EXPECT_NEAR(static_cast<double>(learned), static_cast<double>(Clock.SampleInterval), 8.0);
+}
+
+TEST_F(MotionImuTest, SequenceWrapsAround)
+{
+    UCHAR sequence = 0;
+
+    (void)Stream(200, 1000000, 50000, &sequence);
+
+    //
+    // 16 per counter cycle, wrapped many times by now
+    // 
+    EXPECT_GT(sequence, 16);
+    EXPECT_NEAR(50000.0, static_cast<double>(Clock.SampleInterval), 50.0);
+}
+
+TEST_F(MotionImuTest, PauseKeepsInterval)
+{
+    UCHAR sequence = 0;
+    ULONG64 arrival = Stream(200, 1000000, 50000, &sequence);
+    const ULONG64 learned = Clock.SampleInterval;
+
+    //
+    // Controller went quiet for a second, way off the nominal spacing
+    // 
+    arrival += 10000000;
+
+    ASSERT_TRUE(Unpack(sequence++, arrival));
+    EXPECT_EQ(learned, Clock.SampleInterval);
+    EXPECT_EQ(arrival - learned, Samples[0].Timestamp);
+}
+
+TEST_F(MotionImuTest, RepeatedSequenceKeepsInterval)
+{
+    ASSERT_TRUE(Unpack(3, 1000000));
+    ASSERT_TRUE(Unpack(3, 1100000));
+
+    EXPECT_EQ(static_cast<ULONG64>(BTHPS3_MOTION_IMU_NOMINAL_INTERVAL), Clock.SampleInterval);
+}
+
+TEST_F(MotionImuTest, ClockGoingBackwardsKeepsInterval)
+{
+    ASSERT_TRUE(Unpack(0, 1000000));
+    ASSERT_TRUE(Unpack(1, 900000));
+
+    EXPECT_EQ(static_cast<ULONG64>(BTHPS3_MOTION_IMU_NOMINAL_INTERVAL), Clock.SampleInterval);
+    EXPECT_EQ(900000u, Clock.LastArrival);
+}
+
+TEST_F(MotionImuTest, TimestampsIncreaseAcrossReports)
+{
+    UCHAR sequence = 0;
+    ULONG64 arrival = Stream(200, 1000000, 50000, &sequence);
+    ULONG64 previous = Samples[1].Timestamp;
+
+    for (ULONG index = 0; index < 100; index++)
+    {
+        arrival += 2 * 50000;
+
+        ASSERT_TRUE(Unpack(sequence++, arrival));
+        EXPECT_GT(Samples[0].Timestamp, previous);
+        EXPECT_GT(Samples[1].Timestamp, Samples[0].Timestamp);
+
+        previous = Samples[1].Timestamp;
+    }
+}
@@ -0,0 +1,96 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/NameMatch.h>
+}
+
+namespace
+{
+    BOOLEAN IsEqual(const std::string& Name, const std::wstring& Other)
+    {
+        return BthPS3_NameMatchIsEqual(Name.c_str(), Other.data(), static_cast<ULONG>(Other.size()));
+    }
+}
+
+TEST(NameMatch, MatchesSupportedNames)
+{
+    EXPECT_TRUE(IsEqual("PLAYSTATION(R)3 Controller", L"PLAYSTATION(R)3 Controller"));
+    EXPECT_TRUE(IsEqual("Navigation Controller", L"Navigation Controller"));
+    EXPECT_TRUE(IsEqual("Motion Controller", L"Motion Controller"));
+    EXPECT_TRUE(IsEqual("Wireless Controller", L"Wireless Controller"));
+}
+
+TEST(NameMatch, IgnoresCase)
+{
+    EXPECT_TRUE(IsEqual("playstation(r)3 controller", L"PLAYSTATION(R)3 Controller"));
+    EXPECT_TRUE(IsEqual("WIRELESS CONTROLLER", L"wireless controller"));
+}
+
+TEST(NameMatch, FoldsLatin1Letters)
+{
+    EXPECT_TRUE(IsEqual("\xE9t\xE9", L"\u00C9T\u00C9"));
+    EXPECT_TRUE(IsEqual("\xFF", L"\u0178"));
+    EXPECT_FALSE(IsEqual("\xF7", L"\u00D7"));
+}
+
+TEST(NameMatch, RejectsPrefixesAndExtensions)
+{
+    EXPECT_FALSE(IsEqual("Motion", L"Motion Controller"));
+    EXPECT_FALSE(IsEqual("Motion Controller 2", L"Motion Controller"));
+    EXPECT_FALSE(IsEqual("Motion Controllex", L"Motion Controller"));
+}
+
+TEST(NameMatch, EmptyNames)
+{
+    EXPECT_TRUE(IsEqual("", L""));
+    EXPECT_FALSE(IsEqual("", L"Motion Controller"));
+    EXPECT_FALSE(IsEqual("Motion Controller", L""));
+}
+
+TEST(NameMatch, TruncatesOverlongNames)
+{
+    const std::string name(BTHPS3_NAME_MATCH_MAX_CHARS + 10, 'a');
+
+    EXPECT_TRUE(IsEqual(name, std::wstring(BTHPS3_NAME_MATCH_MAX_CHARS, L'A')));
+    EXPECT_FALSE(IsEqual(name, std::wstring(BTHPS3_NAME_MATCH_MAX_CHARS + 10, L'A')));
+}
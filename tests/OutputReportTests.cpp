@@ -0,0 +1,342 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/OutputReport.h>
+}
+
+namespace
+{
+    BTHPS3_SET_FEEDBACK Feedback(UCHAR SmallMotor, UCHAR LargeMotor, UCHAR Duration, UCHAR LedMask, UCHAR Flags = 0)
+    {
+        BTHPS3_SET_FEEDBACK feedback = {};
+
+        feedback.SmallMotor = SmallMotor;
+        feedback.LargeMotor = LargeMotor;
+        feedback.Duration = Duration;
+        feedback.LedMask = LedMask;
+        feedback.Flags = Flags;
+
+        return feedback;
+    }
+
+    std::vector<UCHAR> Bytes(const BTHPS3_OUTPUT_REPORT& OutputReport)
+    {
+        return std::vector<UCHAR>(OutputReport.Report, OutputReport.Report + OutputReport.Length);
+    }
+
+    //
+    // Offsets where two reports differ
+    // 
+    std::vector<ULONG> Changed(const std::vector<UCHAR>& Before, const std::vector<UCHAR>& After)
+    {
+        std::vector<ULONG> offsets;
+
+        for (ULONG index = 0; index < Before.size() && index < After.size(); index++)
+        {
+            if (Before[index] != After[index])
+            {
+                offsets.push_back(index);
+            }
+        }
+
+        return offsets;
+    }
+
+    class OutputReportTest : public ::testing::TestWithParam<DS_DEVICE_TYPE>
+    {
+    protected:
+        void SetUp() override
+        {
+            ASSERT_TRUE(BthPS3_OutputReportInit(&OutputReport, GetParam()));
+        }
+
+        BTHPS3_OUTPUT_REPORT OutputReport;
+    };
+}
+
+TEST(OutputReportInitTests, SixaxisTemplate)
+{
+    BTHPS3_OUTPUT_REPORT report;
+
+    ASSERT_TRUE(BthPS3_OutputReportInit(&report, DS_DEVICE_TYPE_SIXAXIS));
+
+    EXPECT_EQ(static_cast<ULONG>(BTHPS3_SIXAXIS_HID_OUTPUT_REPORT_SIZE), report.Length);
+    EXPECT_TRUE(report.IsControlChannel);
+    EXPECT_FALSE(report.IsSent);
+
+    //
+    // HIDP SET_REPORT (Output), report ID 1
+    // 
+    EXPECT_EQ(0x52, report.Report[0]);
+    EXPECT_EQ(0x01, report.Report[1]);
+}
+
+TEST(OutputReportInitTests, NavigationSharesSixaxisLayout)
+{
+    BTHPS3_OUTPUT_REPORT sixaxis;
+    BTHPS3_OUTPUT_REPORT navigation;
+
+    ASSERT_TRUE(BthPS3_OutputReportInit(&sixaxis, DS_DEVICE_TYPE_SIXAXIS));
+    ASSERT_TRUE(BthPS3_OutputReportInit(&navigation, DS_DEVICE_TYPE_NAVIGATION));
+
+    EXPECT_EQ(Bytes(sixaxis), Bytes(navigation));
+    EXPECT_TRUE(navigation.IsControlChannel);
+}
+
+TEST(OutputReportInitTests, MotionTemplate)
+{
+    BTHPS3_OUTPUT_REPORT report;
+
+    ASSERT_TRUE(BthPS3_OutputReportInit(&report, DS_DEVICE_TYPE_MOTION));
+
+    EXPECT_EQ(0x32u, report.Length);
+    EXPECT_FALSE(report.IsControlChannel);
+
+    //
+    // HIDP DATA (Output), report ID 2, everything else off
+    // 
+    EXPECT_EQ(0xA2, report.Report[0]);
+    EXPECT_EQ(0x02, report.Report[1]);
+
+    for (ULONG index = 2; index < report.Length; index++)
+    {
+        EXPECT_EQ(0x00, report.Report[index]) << "offset " << index;
+    }
+}
+
+TEST(OutputReportInitTests, UnsupportedTypes)
+{
+    BTHPS3_OUTPUT_REPORT report;
+
+    EXPECT_FALSE(BthPS3_OutputReportInit(&report, DS_DEVICE_TYPE_WIRELESS));
+    EXPECT_FALSE(BthPS3_OutputReportInit(&report, DS_DEVICE_TYPE_UNKNOWN));
+
+    //
+    // Nothing to apply to either
+    // 
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(1, 0xFF, 0xFF, 0x0F, BTHPS3_SET_FEEDBACK_FLAG_FORCE);
+
+    EXPECT_FALSE(BthPS3_OutputReportApply(&report, &feedback));
+}
+
+TEST(OutputReportApplyTests, SixaxisPatchesOwnedBytes)
+{
+    BTHPS3_OUTPUT_REPORT report;
+
+    ASSERT_TRUE(BthPS3_OutputReportInit(&report, DS_DEVICE_TYPE_SIXAXIS));
+
+    const auto before = Bytes(report);
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(1, 0x80, 0x40, 0x05);
+
+    ASSERT_TRUE(BthPS3_OutputReportApply(&report, &feedback));
+
+    EXPECT_EQ(0x40, report.Report[3]);
+    EXPECT_EQ(0x01, report.Report[4]);
+    EXPECT_EQ(0x40, report.Report[5]);
+    EXPECT_EQ(0x80, report.Report[6]);
+
+    //
+    // LED 1 and 3, shifted by one on the wire
+    // 
+    EXPECT_EQ(0x0A, report.Report[11]);
+
+    EXPECT_EQ((std::vector<ULONG>{ 3, 4, 5, 6, 11 }), Changed(before, Bytes(report)));
+}
+
+TEST(OutputReportApplyTests, SixaxisSmallMotorIsOnOff)
+{
+    BTHPS3_OUTPUT_REPORT report;
+
+    ASSERT_TRUE(BthPS3_OutputReportInit(&report, DS_DEVICE_TYPE_SIXAXIS));
+
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(0x7F, 0, 0xFF, 0);
+
+    ASSERT_TRUE(BthPS3_OutputReportApply(&report, &feedback));
+    EXPECT_EQ(0x01, report.Report[4]);
+}
+
+TEST(OutputReportApplyTests, SixaxisIgnoresUpperLedBits)
+{
+    BTHPS3_OUTPUT_REPORT report;
+
+    ASSERT_TRUE(BthPS3_OutputReportInit(&report, DS_DEVICE_TYPE_SIXAXIS));
+
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(0, 0, 0xFF, 0xF1);
+
+    ASSERT_TRUE(BthPS3_OutputReportApply(&report, &feedback));
+    EXPECT_EQ(0x02, report.Report[11]);
+}
+
+TEST(OutputReportApplyTests, MotionPatchesSphereAndRumble)
+{
+    BTHPS3_OUTPUT_REPORT report;
+
+    ASSERT_TRUE(BthPS3_OutputReportInit(&report, DS_DEVICE_TYPE_MOTION));
+
+    const auto before = Bytes(report);
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(0x30, 0x90, 0xFF, 0x05);
+
+    ASSERT_TRUE(BthPS3_OutputReportApply(&report, &feedback));
+
+    EXPECT_EQ(0xFF, report.Report[3]);
+    EXPECT_EQ(0x00, report.Report[4]);
+    EXPECT_EQ(0xFF, report.Report[5]);
+
+    //
+    // Stronger of both motors
+    // 
+    EXPECT_EQ(0x90, report.Report[7]);
+
+    EXPECT_EQ((std::vector<ULONG>{ 3, 5, 7 }), Changed(before, Bytes(report)));
+}
+
+TEST(OutputReportApplyTests, MotionRumbleTakesSmallMotorIfStronger)
+{
+    BTHPS3_OUTPUT_REPORT report;
+
+    ASSERT_TRUE(BthPS3_OutputReportInit(&report, DS_DEVICE_TYPE_MOTION));
+
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(0xC0, 0x10, 0xFF, 0);
+
+    ASSERT_TRUE(BthPS3_OutputReportApply(&report, &feedback));
+    EXPECT_EQ(0xC0, report.Report[7]);
+}
+
+//
+// Diffing behaves the same for every synthesized device type
+// 
+
+TEST_P(OutputReportTest, FirstApplyAlwaysSends)
+{
+    //
+    // Even if the command leaves the template as is
+    // 
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(0, 0, 0, 0);
+
+    EXPECT_TRUE(BthPS3_OutputReportApply(&OutputReport, &feedback));
+    EXPECT_TRUE(OutputReport.IsSent);
+}
+
+TEST_P(OutputReportTest, RepeatedCommandIsSuppressed)
+{
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(1, 0x80, 0xFF, 0x03);
+
+    ASSERT_TRUE(BthPS3_OutputReportApply(&OutputReport, &feedback));
+
+    const auto sent = Bytes(OutputReport);
+
+    EXPECT_FALSE(BthPS3_OutputReportApply(&OutputReport, &feedback));
+    EXPECT_EQ(sent, Bytes(OutputReport));
+}
+
+TEST_P(OutputReportTest, ChangedCommandSends)
+{
+    const BTHPS3_SET_FEEDBACK first = Feedback(0, 0x80, 0xFF, 0x01);
+    const BTHPS3_SET_FEEDBACK second = Feedback(0, 0x80, 0xFF, 0x02);
+
+    ASSERT_TRUE(BthPS3_OutputReportApply(&OutputReport, &first));
+    EXPECT_TRUE(BthPS3_OutputReportApply(&OutputReport, &second));
+    EXPECT_FALSE(BthPS3_OutputReportApply(&OutputReport, &second));
+}
+
+TEST_P(OutputReportTest, ForceFlagResends)
+{
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(0, 0x40, 0xFF, 0x01);
+    const BTHPS3_SET_FEEDBACK forced = Feedback(0, 0x40, 0xFF, 0x01, BTHPS3_SET_FEEDBACK_FLAG_FORCE);
+
+    ASSERT_TRUE(BthPS3_OutputReportApply(&OutputReport, &feedback));
+    EXPECT_TRUE(BthPS3_OutputReportApply(&OutputReport, &forced));
+}
+
+TEST_P(OutputReportTest, FailedTransferResends)
+{
+    const BTHPS3_SET_FEEDBACK feedback = Feedback(0, 0x40, 0xFF, 0x01);
+
+    ASSERT_TRUE(BthPS3_OutputReportApply(&OutputReport, &feedback));
+
+    //
+    // What the driver does once the transfer failed
+    // 
+    OutputReport.IsSent = FALSE;
+
+    EXPECT_TRUE(BthPS3_OutputReportApply(&OutputReport, &feedback));
+}
+
+TEST_P(OutputReportTest, HeaderAndLengthNeverChange)
+{
+    const auto before = Bytes(OutputReport);
+
+    for (int value = 0; value < 0x100; value += 0x11)
+    {
+        const BTHPS3_SET_FEEDBACK feedback = Feedback(
+            static_cast<UCHAR>(value),
+            static_cast<UCHAR>(0xFF - value),
+            static_cast<UCHAR>(value),
+            static_cast<UCHAR>(value)
+        );
+
+        (void)BthPS3_OutputReportApply(&OutputReport, &feedback);
+
+        ASSERT_EQ(before.size(), OutputReport.Length);
+        EXPECT_EQ(before[0], OutputReport.Report[0]);
+        EXPECT_EQ(before[1], OutputReport.Report[1]);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    DeviceTypes,
+    OutputReportTest,
+    ::testing::Values(DS_DEVICE_TYPE_SIXAXIS, DS_DEVICE_TYPE_NAVIGATION, DS_DEVICE_TYPE_MOTION),
+    [](const ::testing::TestParamInfo<DS_DEVICE_TYPE>& Info)
+    {
+        switch (Info.param)
+        {
+        case DS_DEVICE_TYPE_SIXAXIS:
+            return "Sixaxis";
+        case DS_DEVICE_TYPE_NAVIGATION:
+            return "Navigation";
+        default:
+            return "Motion";
+        }
+    }
+);
@@ -0,0 +1,354 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/PatchPolicy.h>
+}
+
+namespace
+{
+    //
+    // PSM_HID_CONTROL and PSM_HID_INTERRUPT of bthdef.h
+    // 
+    constexpr USHORT HidControlPsm = 0x0011;
+    constexpr USHORT HidInterruptPsm = 0x0013;
+
+    constexpr USHORT HandleA = 0x0040;
+    constexpr USHORT HandleB = 0x0041;
+    constexpr ULONGLONG AddressA = 0x00112233445566ULL;
+    constexpr ULONGLONG AddressB = 0x00AABBCCDDEEFFULL;
+
+    std::vector<UCHAR> ConnectionComplete(USHORT Handle, ULONGLONG Address)
+    {
+        std::vector<UCHAR> event = {
+            HCI_EVENT_CONNECTION_COMPLETE, 0x0B, 0x00,
+            static_cast<UCHAR>(Handle & 0xFF), static_cast<UCHAR>(Handle >> 8)
+        };
+
+        for (int index = 0; index < 6; index++)
+        {
+            event.push_back(static_cast<UCHAR>(Address >> (8 * index)));
+        }
+
+        event.push_back(HCI_LINK_TYPE_ACL);
+        event.push_back(0x00);
+
+        return event;
+    }
+
+    std::vector<UCHAR> DisconnectionComplete(USHORT Handle)
+    {
+        return {
+            HCI_EVENT_DISCONNECTION_COMPLETE, 0x04, 0x00,
+            static_cast<UCHAR>(Handle & 0xFF), static_cast<UCHAR>(Handle >> 8),
+            0x13
+        };
+    }
+
+    std::vector<UCHAR> SignallingPacket(UCHAR Code, USHORT Handle, USHORT Psm)
+    {
+        return {
+            static_cast<UCHAR>(Handle & 0xFF), static_cast<UCHAR>(0x20 | ((Handle >> 8) & 0x0F)),
+            0x0C, 0x00,
+            0x08, 0x00,
+            0x01, 0x00,
+            Code, 0x01, 0x04, 0x00,
+            static_cast<UCHAR>(Psm & 0xFF), static_cast<UCHAR>(Psm >> 8),
+            0x40, 0x00
+        };
+    }
+
+    USHORT PacketPsm(const std::vector<UCHAR>& Packet)
+    {
+        return static_cast<USHORT>(Packet[12] | (Packet[13] << 8));
+    }
+
+    class PatchPolicyTest : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            const BTHPS3PSM_PSM_REMAP_RULE rules[] = {
+                { HidControlPsm, PSM_DS3_HID_CONTROL },
+                { HidInterruptPsm, PSM_DS3_HID_INTERRUPT }
+            };
+
+            ASSERT_EQ(STATUS_SUCCESS, BthPS3PSM_PsmRemapCompile(rules, ARRAYSIZE(rules), &Table));
+
+            BthPS3PSM_PatchPolicyInit(&Policy);
+            Feed(ConnectionComplete(HandleA, AddressA));
+            Feed(ConnectionComplete(HandleB, AddressB));
+        }
+
+        void Feed(const std::vector<UCHAR>& Event)
+        {
+            BthPS3PSM_PatchPolicyProcessEvents(&Policy, Event.data(), static_cast<ULONG>(Event.size()));
+        }
+
+        BTHPS3PSM_PATCH_RESULT Process(std::vector<UCHAR>& Packet, BOOLEAN IsPatchingEnabled)
+        {
+            BTHPS3PSM_PATCH_RESULT result;
+
+            BthPS3PSM_PatchPolicyProcessAcl(
+                &Policy,
+                &Table,
+                IsPatchingEnabled,
+                Packet.data(),
+                static_cast<ULONG>(Packet.size()),
+                &result
+            );
+
+            return result;
+        }
+
+        BTHPS3PSM_PSM_REMAP_TABLE Table;
+        BTHPS3PSM_PATCH_POLICY Policy;
+    };
+}
+
+TEST_F(PatchPolicyTest, NonSignallingPacketIsNone)
+{
+    std::vector<UCHAR> packet = SignallingPacket(L2CAP_Connection_Request, HandleA, HidControlPsm);
+    packet[6] = 0x41;
+
+    const BTHPS3PSM_PATCH_RESULT result = Process(packet, TRUE);
+
+    EXPECT_EQ(PatchVerdictNone, result.Verdict);
+    EXPECT_EQ(L2CAP_Reserved, result.Code);
+    EXPECT_EQ(HidControlPsm, PacketPsm(packet));
+}
+
+TEST_F(PatchPolicyTest, PatchesRemappedPsmWhenEnabled)
+{
+    std::vector<UCHAR> packet = SignallingPacket(L2CAP_Connection_Request, HandleA, HidInterruptPsm);
+
+    const BTHPS3PSM_PATCH_RESULT result = Process(packet, TRUE);
+
+    EXPECT_EQ(PatchVerdictPatched, result.Verdict);
+    EXPECT_EQ(L2CAP_Connection_Request, result.Code);
+    EXPECT_EQ(HidInterruptPsm, result.OriginalPsm);
+    EXPECT_EQ(PSM_DS3_HID_INTERRUPT, result.PatchedPsm);
+    EXPECT_EQ(PSM_DS3_HID_INTERRUPT, PacketPsm(packet));
+}
+
+TEST_F(PatchPolicyTest, LeavesRemappedPsmWhenDisabled)
+{
+    std::vector<UCHAR> packet = SignallingPacket(L2CAP_Connection_Request, HandleA, HidControlPsm);
+
+    const BTHPS3PSM_PATCH_RESULT result = Process(packet, FALSE);
+
+    EXPECT_EQ(PatchVerdictNotPatched, result.Verdict);
+    EXPECT_EQ(HidControlPsm, result.PatchedPsm);
+    EXPECT_EQ(HidControlPsm, PacketPsm(packet));
+}
+
+TEST_F(PatchPolicyTest, IgnoresPsmWithoutRule)
+{
+    std::vector<UCHAR> packet = SignallingPacket(L2CAP_Connection_Request, HandleA, 0x0001);
+
+    const BTHPS3PSM_PATCH_RESULT result = Process(packet, TRUE);
+
+    EXPECT_EQ(PatchVerdictSignalling, result.Verdict);
+    EXPECT_EQ(0x0001, PacketPsm(packet));
+}
+
+TEST_F(PatchPolicyTest, AllowListPatchesWhileDisabled)
+{
+    BthPS3PSM_PatchPolicySetAddresses(&Policy, &AddressB, 1);
+
+    std::vector<UCHAR> fromA = SignallingPacket(L2CAP_Connection_Request, HandleA, HidControlPsm);
+    std::vector<UCHAR> fromB = SignallingPacket(L2CAP_Connection_Request, HandleB, HidControlPsm);
+
+    EXPECT_EQ(PatchVerdictNotPatched, Process(fromA, FALSE).Verdict);
+    EXPECT_EQ(PatchVerdictPatched, Process(fromB, FALSE).Verdict);
+    EXPECT_EQ(PSM_DS3_HID_CONTROL, PacketPsm(fromB));
+}
+
+TEST_F(PatchPolicyTest, AllowListIgnoresUnknownHandle)
+{
+    BthPS3PSM_PatchPolicySetAddresses(&Policy, &AddressA, 1);
+    Feed(DisconnectionComplete(HandleA));
+
+    std::vector<UCHAR> packet = SignallingPacket(L2CAP_Connection_Request, HandleA, HidControlPsm);
+
+    EXPECT_EQ(PatchVerdictNotPatched, Process(packet, FALSE).Verdict);
+}
+
+TEST_F(PatchPolicyTest, SuspendedRemoteRearmsOnConfiguration)
+{
+    BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressA);
+
+    std::vector<UCHAR> connect = SignallingPacket(L2CAP_Connection_Request, HandleA, HidControlPsm);
+    EXPECT_EQ(PatchVerdictNotPatched, Process(connect, TRUE).Verdict);
+    EXPECT_EQ(RearmStateAttemptInProgress, Policy.Suspensions[0].RearmState);
+
+    //
+    // Configuration on another link doesn't count
+    // 
+    std::vector<UCHAR> otherConfig = SignallingPacket(L2CAP_Configuration_Request, HandleB, 0x0040);
+    EXPECT_EQ(PatchVerdictSignalling, Process(otherConfig, FALSE).Verdict);
+
+    std::vector<UCHAR> config = SignallingPacket(L2CAP_Configuration_Request, HandleA, 0x0040);
+    const BTHPS3PSM_PATCH_RESULT result = Process(config, FALSE);
+
+    EXPECT_EQ(PatchVerdictRearm, result.Verdict);
+    EXPECT_EQ(L2CAP_Configuration_Request, result.Code);
+    EXPECT_EQ(RearmStateIdle, Policy.Suspensions[0].RearmState);
+
+    //
+    // The link the remote opened unpatched stays excluded, other remotes get patched again
+    // 
+    std::vector<UCHAR> again = SignallingPacket(L2CAP_Connection_Request, HandleA, HidInterruptPsm);
+    EXPECT_EQ(PatchVerdictNotPatched, Process(again, TRUE).Verdict);
+
+    std::vector<UCHAR> fromB = SignallingPacket(L2CAP_Connection_Request, HandleB, HidInterruptPsm);
+    EXPECT_EQ(PatchVerdictPatched, Process(fromB, TRUE).Verdict);
+}
+
+TEST_F(PatchPolicyTest, SuspendedRemoteIsExcludedFromAllowList)
+{
+    BthPS3PSM_PatchPolicySetAddresses(&Policy, &AddressA, 1);
+    BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressA);
+
+    std::vector<UCHAR> packet = SignallingPacket(L2CAP_Connection_Request, HandleA, HidControlPsm);
+
+    EXPECT_EQ(PatchVerdictNotPatched, Process(packet, FALSE).Verdict);
+}
+
+TEST_F(PatchPolicyTest, LinkLossDuringAttemptRearms)
+{
+    BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressA);
+
+    std::vector<UCHAR> connect = SignallingPacket(L2CAP_Connection_Request, HandleA, HidControlPsm);
+    EXPECT_EQ(PatchVerdictNotPatched, Process(connect, FALSE).Verdict);
+
+    EXPECT_FALSE(BthPS3PSM_PatchPolicyOnLinkLoss(&Policy));
+
+    Feed(DisconnectionComplete(HandleA));
+
+    EXPECT_TRUE(BthPS3PSM_PatchPolicyOnLinkLoss(&Policy));
+    EXPECT_EQ(RearmStateIdle, Policy.Suspensions[0].RearmState);
+    EXPECT_EQ(0u, Policy.Suspensions[0].Address);
+}
+
+TEST_F(PatchPolicyTest, SecondSuspensionKeepsFirstExempt)
+{
+    EXPECT_TRUE(BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressA));
+    EXPECT_TRUE(BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressB));
+
+    std::vector<UCHAR> fromA = SignallingPacket(L2CAP_Connection_Request, HandleA, HidControlPsm);
+    std::vector<UCHAR> fromB = SignallingPacket(L2CAP_Connection_Request, HandleB, HidControlPsm);
+
+    //
+    // B getting accepted re-arms the radio, A still retries unpatched
+    // 
+    EXPECT_EQ(PatchVerdictNotPatched, Process(fromB, FALSE).Verdict);
+
+    std::vector<UCHAR> configB = SignallingPacket(L2CAP_Configuration_Request, HandleB, 0x0040);
+    EXPECT_EQ(PatchVerdictRearm, Process(configB, FALSE).Verdict);
+
+    EXPECT_EQ(PatchVerdictNotPatched, Process(fromA, TRUE).Verdict);
+    EXPECT_EQ(HidControlPsm, PacketPsm(fromA));
+
+    std::vector<UCHAR> configA = SignallingPacket(L2CAP_Configuration_Request, HandleA, 0x0040);
+    EXPECT_EQ(PatchVerdictRearm, Process(configA, TRUE).Verdict);
+}
+
+TEST_F(PatchPolicyTest, SuspendingAgainReusesEntry)
+{
+    for (int attempt = 0; attempt < BTHPS3PSM_PATCH_POLICY_MAX_SUSPENSIONS + 1; attempt++)
+    {
+        EXPECT_TRUE(BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressA));
+    }
+
+    EXPECT_TRUE(BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressB));
+}
+
+TEST_F(PatchPolicyTest, RefusesSuspensionOnceAllEntriesAreWatched)
+{
+    for (ULONGLONG index = 0; index < BTHPS3PSM_PATCH_POLICY_MAX_SUSPENSIONS; index++)
+    {
+        EXPECT_TRUE(BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressB + index));
+    }
+
+    EXPECT_FALSE(BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressA));
+
+    //
+    // The remotes suspended first keep their exemption
+    // 
+    std::vector<UCHAR> fromB = SignallingPacket(L2CAP_Connection_Request, HandleB, HidControlPsm);
+    EXPECT_EQ(PatchVerdictNotPatched, Process(fromB, TRUE).Verdict);
+}
+
+TEST_F(PatchPolicyTest, EntryFreesUpOnceExcludedLinkIsGone)
+{
+    for (ULONGLONG index = 0; index < BTHPS3PSM_PATCH_POLICY_MAX_SUSPENSIONS; index++)
+    {
+        EXPECT_TRUE(BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressB + index));
+    }
+
+    //
+    // AddressB gets accepted unpatched, then drops its link
+    // 
+    std::vector<UCHAR> fromB = SignallingPacket(L2CAP_Connection_Request, HandleB, HidControlPsm);
+    EXPECT_EQ(PatchVerdictNotPatched, Process(fromB, FALSE).Verdict);
+
+    std::vector<UCHAR> configB = SignallingPacket(L2CAP_Configuration_Request, HandleB, 0x0040);
+    EXPECT_EQ(PatchVerdictRearm, Process(configB, FALSE).Verdict);
+
+    EXPECT_FALSE(BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressA));
+
+    Feed(DisconnectionComplete(HandleB));
+
+    EXPECT_FALSE(BthPS3PSM_PatchPolicyOnLinkLoss(&Policy));
+    EXPECT_TRUE(BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressA));
+}
+
+TEST_F(PatchPolicyTest, ResumeClearsSuspension)
+{
+    BthPS3PSM_PatchPolicySuspendFor(&Policy, AddressA);
+    BthPS3PSM_PatchPolicyResume(&Policy);
+
+    std::vector<UCHAR> packet = SignallingPacket(L2CAP_Connection_Request, HandleA, HidControlPsm);
+
+    EXPECT_EQ(PatchVerdictPatched, Process(packet, TRUE).Verdict);
+}
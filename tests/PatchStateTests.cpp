@@ -0,0 +1,291 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/PatchState.h>
+}
+
+namespace
+{
+    //
+    // Sideband control device in miniature: patch state per filter device,
+    // the last change and the manual queue of parked wait requests. Every
+    // operation runs under what is FilterDeviceCollectionLock in the driver.
+    // 
+    class PatchStateModel
+    {
+    public:
+        explicit PatchStateModel(size_t DeviceCount)
+            : Devices(DeviceCount, TRUE)
+        {
+        }
+
+        //
+        // IOCTL_BTHPS3PSM_ENABLE/DISABLE/SUSPEND_PSM_PATCHING and the re-arm work item
+        // 
+        bool Set(ULONG DeviceIndex, bool IsEnabled)
+        {
+            if (!BthPS3PSM_PatchStateSet(&Devices[DeviceIndex], IsEnabled ? TRUE : FALSE))
+            {
+                return false;
+            }
+
+            BthPS3PSM_PatchStateRecordChange(&LastChange, DeviceIndex, IsEnabled ? TRUE : FALSE);
+
+            for (auto& waiter : Parked)
+            {
+                Completed.push_back({waiter, LastChange});
+            }
+
+            Parked.clear();
+
+            return true;
+        }
+
+        //
+        // IOCTL_BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE, returns the change if it
+        // completed right away
+        // 
+        std::optional<BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE> Wait(ULONG Client, ULONG64 Sequence)
+        {
+            if (BthPS3PSM_PatchStateWaitIsStale(&LastChange, Sequence))
+            {
+                return LastChange;
+            }
+
+            Parked.push_back(Client);
+
+            return std::nullopt;
+        }
+
+        std::vector<ULONG> Devices;
+        BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE LastChange = {};
+        std::vector<ULONG> Parked;
+        std::vector<std::pair<ULONG, BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE>> Completed;
+    };
+}
+
+TEST(PatchStateTests, OnlyActualFlipsCountAsChange)
+{
+    ULONG state = FALSE;
+
+    EXPECT_FALSE(BthPS3PSM_PatchStateSet(&state, FALSE));
+    EXPECT_TRUE(BthPS3PSM_PatchStateSet(&state, TRUE));
+    EXPECT_EQ(state, static_cast<ULONG>(TRUE));
+    EXPECT_FALSE(BthPS3PSM_PatchStateSet(&state, TRUE));
+    EXPECT_TRUE(BthPS3PSM_PatchStateSet(&state, FALSE));
+    EXPECT_EQ(state, static_cast<ULONG>(FALSE));
+}
+
+TEST(PatchStateTests, AnyNonZeroRegistryValueCountsAsEnabled)
+{
+    ULONG state = 2;
+
+    EXPECT_FALSE(BthPS3PSM_PatchStateSet(&state, TRUE));
+    EXPECT_EQ(state, static_cast<ULONG>(TRUE));
+
+    state = 2;
+
+    EXPECT_TRUE(BthPS3PSM_PatchStateSet(&state, FALSE));
+}
+
+TEST(PatchStateTests, RecordedChangesGetIncreasingSequences)
+{
+    BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE last = {};
+
+    BthPS3PSM_PatchStateRecordChange(&last, 3, FALSE);
+
+    EXPECT_EQ(last.Sequence, 1u);
+    EXPECT_EQ(last.DeviceIndex, 3u);
+    EXPECT_EQ(last.IsEnabled, static_cast<ULONG>(FALSE));
+
+    BthPS3PSM_PatchStateRecordChange(&last, 1, TRUE);
+
+    EXPECT_EQ(last.Sequence, 2u);
+    EXPECT_EQ(last.DeviceIndex, 1u);
+    EXPECT_EQ(last.IsEnabled, static_cast<ULONG>(TRUE));
+}
+
+TEST(PatchStateTests, FirstWaitParksUntilFirstChange)
+{
+    PatchStateModel model(2);
+
+    EXPECT_FALSE(model.Wait(0, 0).has_value());
+    EXPECT_TRUE(model.Completed.empty());
+
+    //
+    // Enabling an enabled device isn't a change
+    // 
+    EXPECT_FALSE(model.Set(1, true));
+    EXPECT_TRUE(model.Completed.empty());
+
+    EXPECT_TRUE(model.Set(1, false));
+
+    ASSERT_EQ(model.Completed.size(), 1u);
+    EXPECT_EQ(model.Completed[0].second.Sequence, 1u);
+    EXPECT_EQ(model.Completed[0].second.DeviceIndex, 1u);
+    EXPECT_EQ(model.Completed[0].second.IsEnabled, static_cast<ULONG>(FALSE));
+}
+
+TEST(PatchStateTests, ChangeWakesAllParkedWaiters)
+{
+    PatchStateModel model(1);
+
+    for (ULONG client = 0; client < 4; client++)
+    {
+        EXPECT_FALSE(model.Wait(client, 0).has_value());
+    }
+
+    model.Set(0, false);
+
+    EXPECT_EQ(model.Completed.size(), 4u);
+    EXPECT_TRUE(model.Parked.empty());
+}
+
+TEST(PatchStateTests, MissedChangesCompleteRightAwayWithTheLatest)
+{
+    PatchStateModel model(2);
+
+    model.Set(0, false);
+
+    const auto seen = model.LastChange.Sequence;
+
+    model.Set(1, false);
+    model.Set(0, true);
+
+    const auto change = model.Wait(0, seen);
+
+    ASSERT_TRUE(change.has_value());
+    EXPECT_EQ(change->Sequence, 3u);
+    EXPECT_EQ(change->DeviceIndex, 0u);
+    EXPECT_EQ(change->IsEnabled, static_cast<ULONG>(TRUE));
+
+    //
+    // Up to date now, so the next wait parks
+    // 
+    EXPECT_FALSE(model.Wait(0, change->Sequence).has_value());
+}
+
+TEST(PatchStateTests, ClientsThatRewaitNeverMissTheFinalState)
+{
+    constexpr ULONG deviceCount = 4;
+    constexpr ULONG clientCount = 3;
+
+    std::mt19937 random(0xB7B5);
+    PatchStateModel model(deviceCount);
+
+    //
+    // Per client: last sequence seen, whether a wait is outstanding and
+    // the patch state it believes each device is in
+    // 
+    std::vector<ULONG64> seen(clientCount, 0);
+    std::vector<bool> pending(clientCount, false);
+    std::vector<std::vector<ULONG>> view(clientCount, std::vector<ULONG>(deviceCount, TRUE));
+    ULONG64 flips = 0;
+
+    auto deliver = [&](ULONG Client, const BTHPS3PSM_WAIT_PSM_PATCHING_CHANGE& Change)
+    {
+        ASSERT_GT(Change.Sequence, seen[Client]);
+
+        seen[Client] = Change.Sequence;
+        view[Client][Change.DeviceIndex] = Change.IsEnabled;
+        pending[Client] = false;
+    };
+
+    for (ULONG step = 0; step < 20000; step++)
+    {
+        const ULONG client = random() % clientCount;
+
+        //
+        // Clients re-submit at random points, state changes come in between
+        // 
+        if (random() % 2 == 0 && !pending[client])
+        {
+            if (const auto change = model.Wait(client, seen[client]))
+            {
+                deliver(client, *change);
+            }
+            else
+            {
+                pending[client] = true;
+            }
+        }
+        else if (model.Set(random() % deviceCount, random() % 2 == 0))
+        {
+            flips++;
+
+            for (const auto& [waiter, change] : model.Completed)
+            {
+                deliver(waiter, change);
+            }
+
+            model.Completed.clear();
+        }
+    }
+
+    EXPECT_EQ(model.LastChange.Sequence, flips);
+
+    //
+    // Catch up, every client ends on the latest change. One still parked
+    // must have seen it already or the change would have completed it.
+    // 
+    for (ULONG client = 0; client < clientCount; client++)
+    {
+        if (!pending[client])
+        {
+            if (const auto change = model.Wait(client, seen[client]))
+            {
+                deliver(client, *change);
+            }
+        }
+
+        EXPECT_EQ(seen[client], model.LastChange.Sequence);
+        EXPECT_EQ(
+            view[client][model.LastChange.DeviceIndex],
+            model.Devices[model.LastChange.DeviceIndex]
+        );
+    }
+}
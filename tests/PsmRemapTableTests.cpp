@@ -0,0 +1,232 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/PsmRemapTable.h>
+}
+
+namespace
+{
+    //
+    // Random valid PSMs, odd with the lowest bit of the upper octet cleared
+    // 
+    std::vector<BTHPS3PSM_PSM_REMAP_RULE> RandomRules(std::mt19937& Random, size_t Count)
+    {
+        std::map<USHORT, USHORT> unique;
+
+        while (unique.size() < Count)
+        {
+            const auto original = static_cast<USHORT>((Random() & 0xFEFE) | 0x0001);
+            const auto patched = static_cast<USHORT>((Random() & 0xFEFE) | 0x0001);
+
+            unique.emplace(original, patched);
+        }
+
+        std::vector<BTHPS3PSM_PSM_REMAP_RULE> rules;
+
+        for (const auto& [original, patched] : unique)
+        {
+            rules.push_back({original, patched});
+        }
+
+        std::shuffle(rules.begin(), rules.end(), Random);
+
+        return rules;
+    }
+
+    //
+    // Every one of the 64k possible PSMs has to resolve exactly like the rule set says
+    // 
+    void ExpectLookupMatchesRules(
+        const BTHPS3PSM_PSM_REMAP_TABLE& Table,
+        const std::vector<BTHPS3PSM_PSM_REMAP_RULE>& Rules
+    )
+    {
+        std::map<USHORT, USHORT> expected;
+
+        for (const auto& rule : Rules)
+        {
+            expected[rule.OriginalPsm] = rule.PatchedPsm;
+        }
+
+        for (ULONG psm = 0; psm <= 0xFFFF; psm++)
+        {
+            USHORT patched = 0;
+            const auto it = expected.find(static_cast<USHORT>(psm));
+            const bool isHit = BthPS3PSM_PsmRemapLookup(&Table, static_cast<USHORT>(psm), &patched);
+
+            ASSERT_EQ(isHit, it != expected.end()) << "PSM " << psm;
+
+            if (isHit)
+            {
+                ASSERT_EQ(patched, it->second) << "PSM " << psm;
+            }
+        }
+    }
+}
+
+TEST(PsmRemapTableTests, EmptyTableMatchesNothing)
+{
+    BTHPS3PSM_PSM_REMAP_TABLE table;
+
+    ASSERT_EQ(BthPS3PSM_PsmRemapCompile(nullptr, 0, &table), STATUS_SUCCESS);
+
+    EXPECT_EQ(table.RuleCount, 0u);
+    ExpectLookupMatchesRules(table, {});
+}
+
+TEST(PsmRemapTableTests, DefaultDs3RulesResolve)
+{
+    const std::vector<BTHPS3PSM_PSM_REMAP_RULE> rules = {
+        {0x0011, 0x5053},
+        {0x0013, 0x5055},
+    };
+    BTHPS3PSM_PSM_REMAP_TABLE table;
+
+    ASSERT_EQ(BthPS3PSM_PsmRemapCompile(rules.data(), static_cast<ULONG>(rules.size()), &table), STATUS_SUCCESS);
+
+    EXPECT_EQ(table.RuleCount, 2u);
+    ExpectLookupMatchesRules(table, rules);
+}
+
+TEST(PsmRemapTableTests, RejectsInvalidPsms)
+{
+    BTHPS3PSM_PSM_REMAP_TABLE table;
+
+    const BTHPS3PSM_PSM_REMAP_RULE even[] = {{0x0010, 0x5053}};
+    const BTHPS3PSM_PSM_REMAP_RULE upperOctetOdd[] = {{0x0011, 0x5153}};
+    const BTHPS3PSM_PSM_REMAP_RULE zero[] = {{0x0000, 0x5053}};
+
+    EXPECT_EQ(BthPS3PSM_PsmRemapCompile(even, 1, &table), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(BthPS3PSM_PsmRemapCompile(upperOctetOdd, 1, &table), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(BthPS3PSM_PsmRemapCompile(zero, 1, &table), STATUS_INVALID_PARAMETER);
+
+    //
+    // A failed compile leaves a table that matches nothing
+    // 
+    ExpectLookupMatchesRules(table, {});
+}
+
+TEST(PsmRemapTableTests, RejectsDuplicateOriginalPsm)
+{
+    const BTHPS3PSM_PSM_REMAP_RULE rules[] = {
+        {0x0011, 0x5053},
+        {0x0013, 0x5055},
+        {0x0011, 0x5055},
+    };
+    BTHPS3PSM_PSM_REMAP_TABLE table;
+
+    EXPECT_EQ(BthPS3PSM_PsmRemapCompile(rules, ARRAYSIZE(rules), &table), STATUS_DUPLICATE_NAME);
+}
+
+TEST(PsmRemapTableTests, RejectsTooManyRules)
+{
+    std::mt19937 random(1);
+    const auto rules = RandomRules(random, BTHPS3PSM_PSM_REMAP_MAX_RULES + 1);
+    BTHPS3PSM_PSM_REMAP_TABLE table;
+
+    EXPECT_EQ(
+        BthPS3PSM_PsmRemapCompile(rules.data(), static_cast<ULONG>(rules.size()), &table),
+        STATUS_INVALID_PARAMETER
+    );
+}
+
+TEST(PsmRemapTableTests, RandomRuleSetsCompileCollisionFree)
+{
+    std::mt19937 random(0x5053);
+
+    for (ULONG round = 0; round < 64; round++)
+    {
+        const size_t count = 1 + random() % BTHPS3PSM_PSM_REMAP_MAX_RULES;
+        const auto rules = RandomRules(random, count);
+        BTHPS3PSM_PSM_REMAP_TABLE table;
+
+        ASSERT_EQ(BthPS3PSM_PsmRemapCompile(rules.data(), static_cast<ULONG>(count), &table), STATUS_SUCCESS);
+
+        const ULONG slots = 1UL << (32 - table.Shift);
+
+        EXPECT_EQ(table.RuleCount, count);
+        EXPECT_GE(slots, count);
+        EXPECT_LE(slots, static_cast<ULONG>(BTHPS3PSM_PSM_REMAP_MAX_SLOTS));
+        EXPECT_EQ(table.Multiplier & 1, 1u);
+
+        ExpectLookupMatchesRules(table, rules);
+    }
+}
+
+TEST(PsmRemapTableTests, DecompileReturnsTheCompiledRules)
+{
+    std::mt19937 random(0x5055);
+    const auto rules = RandomRules(random, BTHPS3PSM_PSM_REMAP_MAX_RULES);
+    BTHPS3PSM_PSM_REMAP_TABLE table;
+    BTHPS3PSM_PSM_REMAP_RULE decompiled[BTHPS3PSM_PSM_REMAP_MAX_RULES];
+    ULONG count = 0;
+
+    ASSERT_EQ(BthPS3PSM_PsmRemapCompile(rules.data(), static_cast<ULONG>(rules.size()), &table), STATUS_SUCCESS);
+
+    BthPS3PSM_PsmRemapDecompile(&table, decompiled, &count);
+
+    ASSERT_EQ(count, rules.size());
+
+    std::map<USHORT, USHORT> expected, actual;
+
+    for (ULONG i = 0; i < count; i++)
+    {
+        expected[rules[i].OriginalPsm] = rules[i].PatchedPsm;
+        actual[decompiled[i].OriginalPsm] = decompiled[i].PatchedPsm;
+    }
+
+    EXPECT_EQ(actual, expected);
+
+    //
+    // Feeding the rules back in yields the same lookups
+    // 
+    BTHPS3PSM_PSM_REMAP_TABLE recompiled;
+
+    ASSERT_EQ(BthPS3PSM_PsmRemapCompile(decompiled, count, &recompiled), STATUS_SUCCESS);
+    ExpectLookupMatchesRules(recompiled, rules);
+}
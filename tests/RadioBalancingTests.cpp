@@ -0,0 +1,279 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+}
+
+#include <BthPS3Client.hpp>
+
+namespace
+{
+    using namespace bthps3;
+
+    BTHPS3_GET_RADIO_LOAD MakeLoad(const std::vector<BTHPS3_RADIO_LOAD>& Radios)
+    {
+        BTHPS3_GET_RADIO_LOAD load = {};
+
+        load.RadioCount = static_cast<ULONG>(Radios.size());
+
+        for (size_t index = 0; index < Radios.size(); index++)
+        {
+            load.Radios[index] = Radios[index];
+            load.Radios[index].RadioAddress = 0x001A7D000000ULL + index;
+        }
+
+        return load;
+    }
+
+    BTHPS3_RADIO_LOAD Radio(ULONG ActiveLinks, ULONG MaxLinks, ULONG64 BytesTransferred = 0)
+    {
+        BTHPS3_RADIO_LOAD radio = {};
+
+        radio.ActiveLinks = ActiveLinks;
+        radio.MaxLinks = MaxLinks;
+        radio.BytesTransferred = BytesTransferred;
+
+        return radio;
+    }
+}
+
+TEST(RadioLoadTests, CapOfZeroIsUnlimited)
+{
+    EXPECT_FALSE(BTHPS3_RADIO_IS_FULL(0u, 0u));
+    EXPECT_FALSE(BTHPS3_RADIO_IS_FULL(1000u, 0u));
+    EXPECT_FALSE(BTHPS3_RADIO_IS_FULL(6u, 7u));
+    EXPECT_TRUE(BTHPS3_RADIO_IS_FULL(7u, 7u));
+    EXPECT_TRUE(BTHPS3_RADIO_IS_FULL(8u, 7u));
+}
+
+TEST(RadioLoadTests, NoRadios)
+{
+    EXPECT_EQ(0u, LeastLoadedRadio(MakeLoad({})));
+}
+
+TEST(RadioLoadTests, PicksFewestLinks)
+{
+    EXPECT_EQ(1u, LeastLoadedRadio(MakeLoad({ Radio(3, 0), Radio(1, 0), Radio(2, 0) })));
+}
+
+TEST(RadioLoadTests, SkipsFullRadios)
+{
+    EXPECT_EQ(2u, LeastLoadedRadio(MakeLoad({ Radio(2, 2), Radio(1, 1), Radio(5, 7) })));
+}
+
+TEST(RadioLoadTests, TieGoesToLessTraffic)
+{
+    EXPECT_EQ(1u, LeastLoadedRadio(MakeLoad({ Radio(2, 7, 5000), Radio(2, 7, 100), Radio(2, 7, 900) })));
+}
+
+TEST(RadioLoadTests, AllFull)
+{
+    EXPECT_EQ(2u, LeastLoadedRadio(MakeLoad({ Radio(7, 7), Radio(3, 3) })));
+}
+
+namespace
+{
+    //
+    // A host with several dongles, controllers getting paired one after
+    // another and afterwards coming and going. A controller only ever pages
+    // the radio it got paired to, so the pairing decides the spread and the
+    // per-radio cap decides who gets denied.
+    // 
+    constexpr ULONG RadioCount = 4;
+    constexpr ULONG RadioCap = 7;
+    constexpr ULONG ControllerCount = 26;
+    constexpr ULONG Minutes = 2000;
+
+    //
+    // Input report bytes a connected controller moves per minute
+    // 
+    constexpr ULONG64 BytesPerMinute = 49ULL * 250 * 60;
+
+    enum class Pairing
+    {
+        FirstRadio,
+        Random,
+        LeastLoaded
+    };
+
+    struct LabResult
+    {
+        ULONG64 Connects = 0;
+        ULONG64 Denied = 0;
+        ULONG PeakLinks = 0;
+    };
+
+    LabResult RunLab(Pairing Strategy, ULONG Seed)
+    {
+        std::mt19937 random(Seed);
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        std::uniform_int_distribution<ULONG> anyRadio(0, RadioCount - 1);
+        std::vector<BTHPS3_RADIO_LOAD> radios(RadioCount, Radio(0, RadioCap));
+        std::vector<ULONG> pairedTo;
+        std::vector<double> usage;
+        std::vector<bool> connected;
+        LabResult result;
+
+        for (ULONG minute = 0; minute < Minutes; minute++)
+        {
+            //
+            // A new controller every few minutes at first, heavy and light users mixed
+            // 
+            if (pairedTo.size() < ControllerCount && minute % 5 == 0)
+            {
+                ULONG radio = 0;
+
+                switch (Strategy)
+                {
+                case Pairing::FirstRadio:
+                    radio = 0;
+                    break;
+                case Pairing::Random:
+                    radio = anyRadio(random);
+                    break;
+                case Pairing::LeastLoaded:
+                    radio = LeastLoadedRadio(MakeLoad(radios));
+
+                    //
+                    // Everything full right now, fall back to the quietest
+                    // 
+                    if (radio >= RadioCount)
+                    {
+                        radio = 0;
+
+                        for (ULONG index = 1; index < RadioCount; index++)
+                        {
+                            if (radios[index].BytesTransferred < radios[radio].BytesTransferred)
+                            {
+                                radio = index;
+                            }
+                        }
+                    }
+                    break;
+                }
+
+                pairedTo.push_back(radio);
+                usage.push_back((pairedTo.size() % 3 == 0) ? 0.9 : 0.4);
+                connected.push_back(false);
+            }
+
+            for (size_t index = 0; index < pairedTo.size(); index++)
+            {
+                BTHPS3_RADIO_LOAD& radio = radios[pairedTo[index]];
+                const bool wantsOn = chance(random) < usage[index];
+
+                if (connected[index] && !wantsOn)
+                {
+                    connected[index] = false;
+                    radio.ActiveLinks--;
+                }
+                else if (!connected[index] && wantsOn)
+                {
+                    result.Connects++;
+
+                    if (BTHPS3_RADIO_IS_FULL(radio.ActiveLinks, radio.MaxLinks))
+                    {
+                        radio.DeniedConnections++;
+                        result.Denied++;
+                        continue;
+                    }
+
+                    connected[index] = true;
+                    radio.ActiveLinks++;
+                }
+
+                if (connected[index])
+                {
+                    radio.BytesTransferred += BytesPerMinute;
+                }
+            }
+
+            for (const auto& radio : radios)
+            {
+                result.PeakLinks = std::max<ULONG>(result.PeakLinks, radio.ActiveLinks);
+            }
+        }
+
+        return result;
+    }
+}
+
+TEST(RadioBalancingSimulationTests, LeastLoadedPairingAvoidsDenials)
+{
+    LabResult first;
+    LabResult randomly;
+    LabResult balanced;
+
+    for (ULONG seed = 1; seed <= 20; seed++)
+    {
+        for (auto [strategy, total] : {
+            std::make_pair(Pairing::FirstRadio, &first),
+            std::make_pair(Pairing::Random, &randomly),
+            std::make_pair(Pairing::LeastLoaded, &balanced) })
+        {
+            const LabResult result = RunLab(strategy, seed);
+
+            //
+            // The cap holds no matter how controllers got spread
+            // 
+            ASSERT_LE(result.PeakLinks, RadioCap);
+
+            total->Connects += result.Connects;
+            total->Denied += result.Denied;
+        }
+    }
+
+    RecordProperty("FirstRadioDenied", static_cast<int>(first.Denied));
+    RecordProperty("RandomDenied", static_cast<int>(randomly.Denied));
+    RecordProperty("LeastLoadedDenied", static_cast<int>(balanced.Denied));
+
+    EXPECT_GT(first.Denied, randomly.Denied);
+    EXPECT_LT(balanced.Denied, randomly.Denied);
+    EXPECT_LT(balanced.Denied * 10, first.Denied);
+}
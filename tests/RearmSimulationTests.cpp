@@ -0,0 +1,389 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/PatchPolicy.h>
+}
+
+//
+// Replays interleavings of a rejected foreign remote retrying its
+// connection against DS3s connecting at the same time, once with the
+// fixed AutoEnableFilterDelay timer as the only way back and once with
+// the event-driven re-arm of the patch policy. The failed-DS3 window is
+// the time radio-wide patching stays off after the rejection.
+// 
+
+namespace
+{
+    constexpr USHORT HidControlPsm = 0x0011;
+
+    //
+    // Default of AutoEnableFilterDelay, in milliseconds
+    // 
+    constexpr ULONG AutoEnableFilterDelay = 10 * 1000;
+
+    constexpr USHORT ForeignHandle = 0x0040;
+    constexpr ULONGLONG ForeignAddress = 0x00112233445566ULL;
+
+    constexpr int TrialCount = 500;
+    constexpr int Ds3AttemptsPerTrial = 20;
+
+    enum class Action
+    {
+        LinkUp,
+        LinkDown,
+        ConnectionRequest,
+        ConfigurationRequest,
+        Timer
+    };
+
+    struct Step
+    {
+        ULONG Time;
+        Action What;
+        USHORT Handle;
+        ULONGLONG Address;
+    };
+
+    struct Outcome
+    {
+        ULONG Window = 0;
+        int FailedDs3 = 0;
+        int PatchedForeign = 0;
+    };
+
+    std::vector<UCHAR> ConnectionComplete(USHORT Handle, ULONGLONG Address)
+    {
+        std::vector<UCHAR> event = {
+            HCI_EVENT_CONNECTION_COMPLETE, 0x0B, 0x00,
+            static_cast<UCHAR>(Handle & 0xFF), static_cast<UCHAR>(Handle >> 8)
+        };
+
+        for (int index = 0; index < 6; index++)
+        {
+            event.push_back(static_cast<UCHAR>(Address >> (8 * index)));
+        }
+
+        event.push_back(HCI_LINK_TYPE_ACL);
+        event.push_back(0x00);
+
+        return event;
+    }
+
+    std::vector<UCHAR> DisconnectionComplete(USHORT Handle)
+    {
+        return {
+            HCI_EVENT_DISCONNECTION_COMPLETE, 0x04, 0x00,
+            static_cast<UCHAR>(Handle & 0xFF), static_cast<UCHAR>(Handle >> 8),
+            0x13
+        };
+    }
+
+    std::vector<UCHAR> SignallingPacket(UCHAR Code, USHORT Handle, USHORT Psm)
+    {
+        return {
+            static_cast<UCHAR>(Handle & 0xFF), static_cast<UCHAR>(0x20 | ((Handle >> 8) & 0x0F)),
+            0x0C, 0x00,
+            0x08, 0x00,
+            0x01, 0x00,
+            Code, 0x01, 0x04, 0x00,
+            static_cast<UCHAR>(Psm & 0xFF), static_cast<UCHAR>(Psm >> 8),
+            0x40, 0x00
+        };
+    }
+
+    //
+    // One rejection of the foreign remote and the traffic following it
+    // 
+    std::vector<Step> MakeTrial(std::mt19937& Random)
+    {
+        std::vector<Step> steps;
+        std::uniform_int_distribution<ULONG> retryDelay(20, 2000);
+        std::uniform_int_distribution<ULONG> setupLatency(5, 300);
+        std::uniform_int_distribution<ULONG> ds3Time(0, AutoEnableFilterDelay + 2000);
+        std::bernoulli_distribution retries(0.9);
+        std::bernoulli_distribution accepted(0.6);
+
+        steps.push_back({ 0, Action::LinkUp, ForeignHandle, ForeignAddress });
+        steps.push_back({ AutoEnableFilterDelay, Action::Timer, 0, 0 });
+
+        //
+        // Some remotes give up right away and only the timer brings patching back
+        // 
+        if (retries(Random))
+        {
+            const ULONG attempt = retryDelay(Random);
+            const ULONG settled = attempt + setupLatency(Random);
+
+            steps.push_back({ attempt, Action::ConnectionRequest, ForeignHandle, ForeignAddress });
+            steps.push_back({
+                settled,
+                accepted(Random) ? Action::ConfigurationRequest : Action::LinkDown,
+                ForeignHandle,
+                ForeignAddress
+            });
+        }
+
+        for (int index = 0; index < Ds3AttemptsPerTrial; index++)
+        {
+            const ULONG time = ds3Time(Random);
+            const USHORT handle = static_cast<USHORT>(0x0100 + index);
+            const ULONGLONG address = 0x00AABBCC000000ULL + index;
+
+            steps.push_back({ time, Action::LinkUp, handle, address });
+            steps.push_back({ time + 1, Action::ConnectionRequest, handle, address });
+            steps.push_back({ time + 2, Action::LinkDown, handle, address });
+        }
+
+        std::stable_sort(steps.begin(), steps.end(), [](const Step& Left, const Step& Right)
+        {
+            return Left.Time < Right.Time;
+        });
+
+        return steps;
+    }
+
+    Outcome Replay(const std::vector<Step>& Steps, const BTHPS3PSM_PSM_REMAP_TABLE& Table, bool IsEventDriven)
+    {
+        BTHPS3PSM_PATCH_POLICY policy;
+        BOOLEAN isPatchingEnabled = FALSE;
+        Outcome outcome;
+
+        BthPS3PSM_PatchPolicyInit(&policy);
+
+        //
+        // Without event-driven re-arm the profile driver merely disabled patching
+        // 
+        if (IsEventDriven)
+        {
+            BthPS3PSM_PatchPolicySuspendFor(&policy, ForeignAddress);
+        }
+
+        const auto rearm = [&](ULONG Time)
+        {
+            if (!isPatchingEnabled)
+            {
+                isPatchingEnabled = TRUE;
+                outcome.Window = Time;
+            }
+        };
+
+        for (const Step& step : Steps)
+        {
+            switch (step.What)
+            {
+            case Action::LinkUp:
+            {
+                const std::vector<UCHAR> event = ConnectionComplete(step.Handle, step.Address);
+                BthPS3PSM_PatchPolicyProcessEvents(&policy, event.data(), static_cast<ULONG>(event.size()));
+                break;
+            }
+            case Action::LinkDown:
+            {
+                const std::vector<UCHAR> event = DisconnectionComplete(step.Handle);
+                BthPS3PSM_PatchPolicyProcessEvents(&policy, event.data(), static_cast<ULONG>(event.size()));
+
+                if (IsEventDriven && BthPS3PSM_PatchPolicyOnLinkLoss(&policy))
+                {
+                    rearm(step.Time);
+                }
+                break;
+            }
+            case Action::ConnectionRequest:
+            case Action::ConfigurationRequest:
+            {
+                const bool isConnect = (step.What == Action::ConnectionRequest);
+                std::vector<UCHAR> packet = SignallingPacket(
+                    isConnect ? L2CAP_Connection_Request : L2CAP_Configuration_Request,
+                    step.Handle,
+                    HidControlPsm
+                );
+                BTHPS3PSM_PATCH_RESULT result;
+
+                BthPS3PSM_PatchPolicyProcessAcl(
+                    &policy,
+                    &Table,
+                    isPatchingEnabled,
+                    packet.data(),
+                    static_cast<ULONG>(packet.size()),
+                    &result
+                );
+
+                if (isConnect && step.Address == ForeignAddress && result.Verdict == PatchVerdictPatched)
+                {
+                    outcome.PatchedForeign++;
+                }
+                else if (isConnect && step.Address != ForeignAddress && result.Verdict != PatchVerdictPatched)
+                {
+                    outcome.FailedDs3++;
+                }
+
+                if (IsEventDriven && result.Verdict == PatchVerdictRearm)
+                {
+                    rearm(step.Time);
+                }
+                break;
+            }
+            case Action::Timer:
+                //
+                // Enabling patching explicitly also ends any suspension
+                // 
+                BthPS3PSM_PatchPolicyResume(&policy);
+                rearm(step.Time);
+                break;
+            }
+        }
+
+        return outcome;
+    }
+
+    class RearmSimulationTest : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            const BTHPS3PSM_PSM_REMAP_RULE rules[] = {
+                { HidControlPsm, PSM_DS3_HID_CONTROL }
+            };
+
+            ASSERT_EQ(STATUS_SUCCESS, BthPS3PSM_PsmRemapCompile(rules, ARRAYSIZE(rules), &Table));
+        }
+
+        BTHPS3PSM_PSM_REMAP_TABLE Table;
+    };
+}
+
+TEST_F(RearmSimulationTest, EventDrivenRearmShrinksFailedDs3Window)
+{
+    std::mt19937 random(0x42535033);
+    ULONGLONG timerWindow = 0;
+    ULONGLONG eventWindow = 0;
+    int timerFailures = 0;
+    int eventFailures = 0;
+
+    for (int trial = 0; trial < TrialCount; trial++)
+    {
+        const std::vector<Step> steps = MakeTrial(random);
+        const Outcome timer = Replay(steps, Table, false);
+        const Outcome event = Replay(steps, Table, true);
+
+        //
+        // The foreign remote must get through unpatched either way
+        // 
+        ASSERT_EQ(0, timer.PatchedForeign) << "trial " << trial;
+        ASSERT_EQ(0, event.PatchedForeign) << "trial " << trial;
+
+        //
+        // The timer stays the upper bound of the event-driven window
+        // 
+        ASSERT_EQ(AutoEnableFilterDelay, timer.Window) << "trial " << trial;
+        ASSERT_LE(event.Window, timer.Window) << "trial " << trial;
+        ASSERT_LE(event.FailedDs3, timer.FailedDs3) << "trial " << trial;
+
+        timerWindow += timer.Window;
+        eventWindow += event.Window;
+        timerFailures += timer.FailedDs3;
+        eventFailures += event.FailedDs3;
+    }
+
+    RecordProperty("TimerMeanWindowMs", static_cast<int>(timerWindow / TrialCount));
+    RecordProperty("EventMeanWindowMs", static_cast<int>(eventWindow / TrialCount));
+    RecordProperty("TimerFailedDs3", timerFailures);
+    RecordProperty("EventFailedDs3", eventFailures);
+
+    //
+    // One in ten remotes never retries and waits for the timer, the rest
+    // settle within roughly a second
+    // 
+    EXPECT_LT(eventWindow * 4, timerWindow);
+    EXPECT_LT(eventFailures * 4, timerFailures);
+}
+
+TEST_F(RearmSimulationTest, SilentRemoteFallsBackToTimer)
+{
+    const std::vector<Step> steps = {
+        { 0, Action::LinkUp, ForeignHandle, ForeignAddress },
+        { 500, Action::LinkUp, 0x0100, 0x00AABBCC000000ULL },
+        { 501, Action::ConnectionRequest, 0x0100, 0x00AABBCC000000ULL },
+        { AutoEnableFilterDelay, Action::Timer, 0, 0 },
+        { AutoEnableFilterDelay + 1, Action::ConnectionRequest, 0x0100, 0x00AABBCC000000ULL }
+    };
+
+    const Outcome timer = Replay(steps, Table, false);
+    const Outcome event = Replay(steps, Table, true);
+
+    EXPECT_EQ(AutoEnableFilterDelay, timer.Window);
+    EXPECT_EQ(AutoEnableFilterDelay, event.Window);
+    EXPECT_EQ(1, timer.FailedDs3);
+    EXPECT_EQ(1, event.FailedDs3);
+}
+
+TEST_F(RearmSimulationTest, Ds3DuringForeignAttemptStillFails)
+{
+    //
+    // Patching is off until the foreign remote configures its channel,
+    // a DS3 squeezed in between still gets rejected
+    // 
+    const std::vector<Step> steps = {
+        { 0, Action::LinkUp, ForeignHandle, ForeignAddress },
+        { 100, Action::ConnectionRequest, ForeignHandle, ForeignAddress },
+        { 120, Action::LinkUp, 0x0100, 0x00AABBCC000000ULL },
+        { 121, Action::ConnectionRequest, 0x0100, 0x00AABBCC000000ULL },
+        { 150, Action::ConfigurationRequest, ForeignHandle, ForeignAddress },
+        { 160, Action::LinkUp, 0x0101, 0x00AABBCC000001ULL },
+        { 161, Action::ConnectionRequest, 0x0101, 0x00AABBCC000001ULL },
+        { 170, Action::ConnectionRequest, ForeignHandle, ForeignAddress },
+        { AutoEnableFilterDelay, Action::Timer, 0, 0 }
+    };
+
+    const Outcome timer = Replay(steps, Table, false);
+    const Outcome event = Replay(steps, Table, true);
+
+    EXPECT_EQ(150u, event.Window);
+    EXPECT_EQ(1, event.FailedDs3);
+    EXPECT_EQ(0, event.PatchedForeign);
+    EXPECT_EQ(2, timer.FailedDs3);
+}
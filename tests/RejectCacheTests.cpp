@@ -0,0 +1,293 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/RejectCache.h>
+}
+
+namespace
+{
+    constexpr BTH_ADDR Headset = 0x001A7DDA7113ULL;
+    constexpr BTH_ADDR Keyboard = 0x0025DB0C1A2BULL;
+
+    //
+    // One minute in interrupt time units
+    // 
+    constexpr ULONG64 Timeout = 60ULL * 10000000ULL;
+
+    class RejectCacheTests : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            BthPS3_RejectCacheInit(&Cache);
+        }
+
+        bool Contains(BTH_ADDR Address, ULONG64 Now)
+        {
+            return BthPS3_RejectCacheContains(&Cache, Address, Now) != FALSE;
+        }
+
+        size_t UsedEntries() const
+        {
+            size_t used = 0;
+
+            for (const auto& entry : Cache.Entries)
+            {
+                used += entry.RemoteAddress != 0;
+            }
+
+            return used;
+        }
+
+        BTHPS3_REJECT_CACHE Cache{};
+    };
+}
+
+TEST_F(RejectCacheTests, EmptyCacheContainsNothing)
+{
+    EXPECT_FALSE(Contains(Headset, 0));
+    EXPECT_FALSE(Contains(Keyboard, Timeout));
+    EXPECT_EQ(Cache.Hits, 0);
+    EXPECT_EQ(UsedEntries(), 0u);
+}
+
+TEST_F(RejectCacheTests, DeniedDeviceIsFoundUntilExpiry)
+{
+    BthPS3_RejectCacheInsert(&Cache, Headset, 1000 + Timeout);
+
+    EXPECT_TRUE(Contains(Headset, 1000));
+    EXPECT_TRUE(Contains(Headset, 1000 + Timeout - 1));
+    EXPECT_FALSE(Contains(Headset, 1000 + Timeout));
+    EXPECT_FALSE(Contains(Keyboard, 1000));
+
+    EXPECT_EQ(Cache.Hits, 2);
+    EXPECT_EQ(Cache.Inserts, 1);
+}
+
+TEST_F(RejectCacheTests, RefreshExtendsExpiryInPlace)
+{
+    BthPS3_RejectCacheInsert(&Cache, Headset, Timeout);
+    BthPS3_RejectCacheInsert(&Cache, Headset, 2 * Timeout);
+
+    EXPECT_TRUE(Contains(Headset, Timeout));
+    EXPECT_EQ(UsedEntries(), 1u);
+    EXPECT_EQ(Cache.Inserts, 2);
+}
+
+TEST_F(RejectCacheTests, ExpiredDeviceCanBeDeniedAgain)
+{
+    BthPS3_RejectCacheInsert(&Cache, Headset, Timeout);
+
+    ASSERT_FALSE(Contains(Headset, Timeout));
+
+    BthPS3_RejectCacheInsert(&Cache, Headset, 2 * Timeout);
+
+    EXPECT_TRUE(Contains(Headset, Timeout));
+    EXPECT_EQ(UsedEntries(), 1u);
+}
+
+TEST_F(RejectCacheTests, FillsFreeEntriesFirst)
+{
+    for (ULONG index = 0; index < BTHPS3_REJECT_CACHE_ENTRIES; index++)
+    {
+        BthPS3_RejectCacheInsert(&Cache, Headset + index, Timeout + index);
+    }
+
+    EXPECT_EQ(UsedEntries(), static_cast<size_t>(BTHPS3_REJECT_CACHE_ENTRIES));
+
+    for (ULONG index = 0; index < BTHPS3_REJECT_CACHE_ENTRIES; index++)
+    {
+        EXPECT_TRUE(Contains(Headset + index, 0)) << "entry " << index;
+    }
+}
+
+TEST_F(RejectCacheTests, ReplacesEntryClosestToExpiryOnceFull)
+{
+    for (ULONG index = 0; index < BTHPS3_REJECT_CACHE_ENTRIES; index++)
+    {
+        BthPS3_RejectCacheInsert(&Cache, Headset + index, Timeout + index);
+    }
+
+    //
+    // Retrying pushes the first one out, the second is next in line
+    // 
+    BthPS3_RejectCacheInsert(&Cache, Headset, 2 * Timeout);
+    BthPS3_RejectCacheInsert(&Cache, Keyboard, 2 * Timeout);
+
+    EXPECT_TRUE(Contains(Headset, 0));
+    EXPECT_FALSE(Contains(Headset + 1, 0));
+    EXPECT_TRUE(Contains(Keyboard, 0));
+    EXPECT_EQ(UsedEntries(), static_cast<size_t>(BTHPS3_REJECT_CACHE_ENTRIES));
+
+    for (ULONG index = 2; index < BTHPS3_REJECT_CACHE_ENTRIES; index++)
+    {
+        EXPECT_TRUE(Contains(Headset + index, 0)) << "entry " << index;
+    }
+}
+
+TEST_F(RejectCacheTests, RetryStormIsAnsweredFromCache)
+{
+    ULONG64 now = 0;
+    ULONG nameQueries = 0;
+
+    //
+    // A device retrying every 500ms for five minutes, denied again only
+    // after each timeout
+    // 
+    for (int attempt = 0; attempt < 600; attempt++, now += 5000000ULL)
+    {
+        if (Contains(Headset, now))
+        {
+            continue;
+        }
+
+        nameQueries++;
+        BthPS3_RejectCacheInsert(&Cache, Headset, now + Timeout);
+    }
+
+    EXPECT_EQ(nameQueries, 5u);
+    EXPECT_EQ(Cache.Hits, 595);
+
+    RecordProperty("name_queries", std::to_string(nameQueries));
+    RecordProperty("cached_denials", std::to_string(Cache.Hits));
+}
+
+TEST(RejectCacheConcurrencyTests, ReadersNeverMatchExpiredEntries)
+{
+    constexpr ULONG Inserts = 200000;
+    constexpr unsigned Readers = 3;
+    constexpr ULONG64 Now = 100;
+
+    //
+    // Twice as many live devices as entries so they keep replacing each
+    // other, the expired ones keep getting refreshed with a past expiry
+    // 
+    constexpr ULONG LiveDevices = 2 * BTHPS3_REJECT_CACHE_ENTRIES;
+    constexpr ULONG ExpiredDevices = 8;
+    constexpr BTH_ADDR LiveBase = 0x001A7D000000ULL;
+    constexpr BTH_ADDR ExpiredBase = 0x0025DB000000ULL;
+
+    BTHPS3_REJECT_CACHE cache;
+    std::atomic<bool> isDone{ false };
+    std::atomic<ULONG64> lookups{ 0 };
+    std::atomic<ULONG64> liveHits{ 0 };
+    std::vector<std::string> failures(Readers);
+    std::vector<std::thread> readers;
+
+    BthPS3_RejectCacheInit(&cache);
+
+    for (unsigned reader = 0; reader < Readers; reader++)
+    {
+        readers.emplace_back([&, reader]
+        {
+            ULONG index = reader;
+
+            while (!isDone.load(std::memory_order_relaxed) && failures[reader].empty())
+            {
+                const BTH_ADDR expired = ExpiredBase + index % ExpiredDevices;
+
+                //
+                // A torn read would pair this address with a live expiry
+                // 
+                if (BthPS3_RejectCacheContains(&cache, expired, Now))
+                {
+                    failures[reader] = "expired device " + std::to_string(expired) + " matched";
+                }
+
+                if (BthPS3_RejectCacheContains(&cache, LiveBase + index % LiveDevices, Now))
+                {
+                    liveHits++;
+                }
+
+                lookups += 2;
+                index++;
+
+                if (index % 16 == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (ULONG index = 0; index < Inserts; index++)
+    {
+        if (index % 2 == 0)
+        {
+            BthPS3_RejectCacheInsert(&cache, LiveBase + index / 2 % LiveDevices, Now + 1 + index);
+        }
+        else
+        {
+            BthPS3_RejectCacheInsert(&cache, ExpiredBase + index / 2 % ExpiredDevices, 1);
+        }
+
+        //
+        // Lets the readers run between inserts on a single processor
+        // 
+        if (index % 4 == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    isDone = true;
+
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    for (unsigned reader = 0; reader < Readers; reader++)
+    {
+        EXPECT_EQ("", failures[reader]) << "reader " << reader;
+    }
+
+    EXPECT_EQ(cache.Inserts, static_cast<LONG64>(Inserts));
+    EXPECT_GT(lookups.load(), 0u);
+
+    RecordProperty("lookups", std::to_string(lookups.load()));
+    RecordProperty("live_hits", std::to_string(liveHits.load()));
+}
@@ -0,0 +1,382 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/SlotBitmap.h>
+}
+
+namespace
+{
+    struct SlotMap
+    {
+        explicit SlotMap(ULONG Capacity)
+            : Words(Capacity / BTHPS3_SLOT_BITMAP_BITS_PER_WORD)
+        {
+            Map.Words = Words.data();
+            Map.Capacity = Capacity;
+            BthPS3_SlotMapRebuildSummary(&Map);
+        }
+
+        std::vector<UINT32> Words;
+        BTHPS3_SLOT_MAP Map{};
+    };
+}
+
+TEST(SlotBitmap, SetClearTestSingleBits)
+{
+    UINT32 bitmap[2] = {};
+
+    BthPS3_SlotBitmapSet(bitmap, 0);
+    BthPS3_SlotBitmapSet(bitmap, 31);
+    BthPS3_SlotBitmapSet(bitmap, 32);
+
+    EXPECT_EQ(0x80000001u, bitmap[0]);
+    EXPECT_EQ(0x00000001u, bitmap[1]);
+    EXPECT_TRUE(BthPS3_SlotBitmapTest(bitmap, 31));
+    EXPECT_FALSE(BthPS3_SlotBitmapTest(bitmap, 30));
+
+    BthPS3_SlotBitmapClear(bitmap, 31);
+
+    EXPECT_FALSE(BthPS3_SlotBitmapTest(bitmap, 31));
+    EXPECT_EQ(0x00000001u, bitmap[0]);
+}
+
+TEST(SlotBitmap, LowestClearMatchesLinearScan)
+{
+    for (ULONG bit = 0; bit < 32; bit++)
+    {
+        //
+        // Everything below the bit occupied, random garbage above it
+        // 
+        const UINT32 below = bit == 0 ? 0 : (0xFFFFFFFFu >> (32 - bit));
+        const UINT32 word = below | (0xA5A5A5A5u << bit << 1);
+
+        EXPECT_EQ(bit, BthPS3_SlotBitmapLowestClear(word)) << bit;
+    }
+}
+
+TEST(SlotMap, HandsOutSlotsInAscendingOrder)
+{
+    SlotMap slots(256);
+
+    for (ULONG slot = 0; slot < 256; slot++)
+    {
+        ASSERT_EQ(slot, BthPS3_SlotMapFindClear(&slots.Map));
+        BthPS3_SlotMapSet(&slots.Map, slot);
+    }
+
+    EXPECT_EQ(256u, BthPS3_SlotMapFindClear(&slots.Map));
+}
+
+TEST(SlotMap, ReusesLowestReleasedSlot)
+{
+    SlotMap slots(128);
+
+    for (ULONG slot = 0; slot < 128; slot++)
+    {
+        BthPS3_SlotMapSet(&slots.Map, slot);
+    }
+
+    BthPS3_SlotMapClear(&slots.Map, 97);
+    BthPS3_SlotMapClear(&slots.Map, 40);
+
+    EXPECT_FALSE(BthPS3_SlotMapTest(&slots.Map, 40));
+    EXPECT_EQ(40u, BthPS3_SlotMapFindClear(&slots.Map));
+
+    BthPS3_SlotMapSet(&slots.Map, 40);
+
+    EXPECT_EQ(97u, BthPS3_SlotMapFindClear(&slots.Map));
+}
+
+TEST(SlotMap, TestIsFalseBeyondCapacity)
+{
+    SlotMap slots(64);
+
+    //
+    // Leaf words past a shrunk capacity may still hold stale bits
+    // 
+    slots.Words[1] = 0xFFFFFFFF;
+    slots.Map.Capacity = 32;
+
+    EXPECT_FALSE(BthPS3_SlotMapTest(&slots.Map, 32));
+    EXPECT_FALSE(BthPS3_SlotMapTest(&slots.Map, 63));
+}
+
+TEST(SlotMap, RebuildSummaryAfterReplacingWords)
+{
+    SlotMap slots(96);
+
+    slots.Words[0] = 0xFFFFFFFF;
+    slots.Words[1] = 0xFFFFFFFF;
+    slots.Words[2] = 0xFFFFFFF7;
+    BthPS3_SlotMapRebuildSummary(&slots.Map);
+
+    EXPECT_EQ(67u, BthPS3_SlotMapFindClear(&slots.Map));
+
+    slots.Words[2] = 0xFFFFFFFF;
+    BthPS3_SlotMapRebuildSummary(&slots.Map);
+
+    EXPECT_EQ(96u, BthPS3_SlotMapFindClear(&slots.Map));
+}
+
+TEST(SlotMap, LargestMapFillsCompletely)
+{
+    SlotMap slots(BTHPS3_SLOT_MAP_MAX_SLOTS);
+
+    for (ULONG slot = 0; slot < BTHPS3_SLOT_MAP_MAX_SLOTS; slot++)
+    {
+        BthPS3_SlotMapSet(&slots.Map, slot);
+    }
+
+    EXPECT_EQ(static_cast<ULONG>(BTHPS3_SLOT_MAP_MAX_SLOTS), BthPS3_SlotMapFindClear(&slots.Map));
+
+    BthPS3_SlotMapClear(&slots.Map, BTHPS3_SLOT_MAP_MAX_SLOTS - 1);
+
+    EXPECT_EQ(static_cast<ULONG>(BTHPS3_SLOT_MAP_MAX_SLOTS - 1), BthPS3_SlotMapFindClear(&slots.Map));
+}
+
+namespace
+{
+    //
+    // Stand-in for a Devices\%012llX key of the parameters key
+    // 
+    struct CachedDevice
+    {
+        ULONGLONG Address;
+        ULONG Slot;
+        ULONG64 LastConnectedTime;
+    };
+
+    //
+    // Same walk BthPS3_PDO_ReclaimSlot does over the registry
+    // 
+    ULONG Reclaim(const std::vector<CachedDevice>& Cache, ULONG Capacity, const std::set<ULONG>& Present)
+    {
+        BTHPS3_SLOT_RECLAIM reclaim;
+
+        BthPS3_SlotReclaimInit(&reclaim, Capacity);
+
+        for (const auto& device : Cache)
+        {
+            if (BthPS3_SlotReclaimIsOlder(&reclaim, device.Slot, device.LastConnectedTime)
+                && Present.count(device.Slot) == 0)
+            {
+                BthPS3_SlotReclaimTake(&reclaim, device.Slot, device.LastConnectedTime);
+            }
+        }
+
+        return reclaim.OldestSlot;
+    }
+}
+
+TEST(SlotReclaim, NoCandidateKeepsSlotZero)
+{
+    EXPECT_EQ(0u, Reclaim({}, 256, {}));
+}
+
+TEST(SlotReclaim, PicksLeastRecentlyConnected)
+{
+    const std::vector<CachedDevice> cache = {
+        { 0x01, 1, 300 },
+        { 0x02, 2, 100 },
+        { 0x03, 3, 200 }
+    };
+
+    EXPECT_EQ(2u, Reclaim(cache, 256, {}));
+}
+
+TEST(SlotReclaim, SkipsPresentDevices)
+{
+    const std::vector<CachedDevice> cache = {
+        { 0x01, 1, 300 },
+        { 0x02, 2, 100 },
+        { 0x03, 3, 200 }
+    };
+
+    EXPECT_EQ(3u, Reclaim(cache, 256, { 2 }));
+    EXPECT_EQ(0u, Reclaim(cache, 256, { 1, 2, 3 }));
+}
+
+TEST(SlotReclaim, UntimedEntriesCountAsOldest)
+{
+    const std::vector<CachedDevice> cache = {
+        { 0x01, 1, 100 },
+        { 0x02, 2, 0 }
+    };
+
+    EXPECT_EQ(2u, Reclaim(cache, 256, {}));
+}
+
+TEST(SlotReclaim, IgnoresInvalidSlots)
+{
+    const std::vector<CachedDevice> cache = {
+        { 0x01, 0, 1 },
+        { 0x02, 256, 2 },
+        { 0x03, 7, 3 }
+    };
+
+    EXPECT_EQ(7u, Reclaim(cache, 256, {}));
+}
+
+TEST(SlotReclaim, TieKeepsFirstEnumerated)
+{
+    const std::vector<CachedDevice> cache = {
+        { 0x01, 4, 100 },
+        { 0x02, 5, 100 }
+    };
+
+    EXPECT_EQ(4u, Reclaim(cache, 256, {}));
+}
+
+//
+// A test lab pairing 10k controllers over time, a few of them connected at
+// any time and some coming back later. Slots are handed out from the map
+// until it's exhausted, then taken over from the least recently seen device.
+// 
+TEST(SlotReclaim, LabWithTenThousandDevicesNeverRunsOut)
+{
+    constexpr ULONG deviceCount = 10000;
+    constexpr ULONG presentCount = 8;
+    SlotMap slots(BTHPS3_SLOT_MAP_MAX_SLOTS);
+    std::vector<CachedDevice> cache;
+    std::map<ULONGLONG, size_t> byAddress;
+    std::deque<ULONG> connected;
+    std::mt19937 random(0x5107);
+    std::bernoulli_distribution isReturning(0.2);
+    ULONG reclaimed = 0;
+
+    //
+    // Slot 0 is never handed out
+    // 
+    BthPS3_SlotMapSet(&slots.Map, 0);
+
+    for (ULONG64 time = 1; time <= deviceCount; time++)
+    {
+        ULONGLONG address = 0x001A2B000000ULL + time;
+        ULONG slot;
+
+        if (!cache.empty() && isReturning(random))
+        {
+            address = cache[std::uniform_int_distribution<size_t>(0, cache.size() - 1)(random)].Address;
+        }
+
+        const std::set<ULONG> present(connected.begin(), connected.end());
+        const auto known = byAddress.find(address);
+
+        if (known != byAddress.end())
+        {
+            slot = cache[known->second].Slot;
+
+            if (present.count(slot) != 0)
+            {
+                continue;
+            }
+
+            cache[known->second].LastConnectedTime = time;
+        }
+        else
+        {
+            slot = BthPS3_SlotMapFindClear(&slots.Map);
+
+            if (slot == slots.Map.Capacity)
+            {
+                slot = Reclaim(cache, slots.Map.Capacity, present);
+                ASSERT_NE(0u, slot) << "at device " << time;
+
+                //
+                // Must be the least recently connected absent device
+                // 
+                const auto victim = std::find_if(cache.begin(), cache.end(), [slot](const CachedDevice& Device)
+                {
+                    return Device.Slot == slot;
+                });
+
+                ASSERT_NE(cache.end(), victim);
+
+                for (const auto& device : cache)
+                {
+                    if (present.count(device.Slot) == 0)
+                    {
+                        ASSERT_LE(victim->LastConnectedTime, device.LastConnectedTime);
+                    }
+                }
+
+                //
+                // The new device takes over the forgotten device's entry
+                // 
+                byAddress.erase(victim->Address);
+                byAddress[address] = static_cast<size_t>(victim - cache.begin());
+                *victim = { address, slot, time };
+
+                reclaimed++;
+            }
+            else
+            {
+                BthPS3_SlotMapSet(&slots.Map, slot);
+                byAddress[address] = cache.size();
+                cache.push_back({ address, slot, time });
+            }
+        }
+
+        connected.push_back(slot);
+
+        if (connected.size() > presentCount)
+        {
+            connected.pop_front();
+        }
+    }
+
+    EXPECT_EQ(static_cast<size_t>(BTHPS3_SLOT_MAP_MAX_SLOTS - 1), cache.size());
+    EXPECT_GT(reclaimed, 0u);
+
+    std::set<ULONG> unique;
+
+    for (const auto& device : cache)
+    {
+        EXPECT_TRUE(unique.insert(device.Slot).second) << "slot " << device.Slot << " handed out twice";
+    }
+}
@@ -0,0 +1,294 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3/StatePage.h>
+}
+
+#include <BthPS3Client.hpp>
+
+namespace
+{
+    using bthps3::PdoClient;
+
+    //
+    // Report n is n % 0x60 + 0x20 bytes long and filled with n, so a torn
+    // copy shows as mismatching length, bytes or timestamp
+    // 
+    ULONG ReportLength(ULONG64 Index)
+    {
+        return static_cast<ULONG>(Index % 0x60) + 0x20;
+    }
+
+    void Publish(PBTHPS3_STATE_PAGE Page, ULONG64 Index)
+    {
+        UCHAR report[BTHPS3_STATE_PAGE_REPORT_SIZE];
+
+        std::memset(report, static_cast<UCHAR>(Index), sizeof(report));
+
+        BthPS3_StatePagePublish(Page, report, ReportLength(Index), Index);
+    }
+
+    //
+    // Returns an empty string if Snapshot is a consistent copy
+    // 
+    std::string Inconsistency(const BTHPS3_STATE_PAGE& Snapshot)
+    {
+        const ULONG64 index = Snapshot.Timestamp;
+
+        if (Snapshot.Sequence & 1)
+        {
+            return "odd sequence";
+        }
+
+        if (Snapshot.ReportCount != index)
+        {
+            return "report count " + std::to_string(Snapshot.ReportCount) + " for report " + std::to_string(index);
+        }
+
+        if (index != 0 && Snapshot.ReportLength != ReportLength(index))
+        {
+            return "length " + std::to_string(Snapshot.ReportLength) + " for report " + std::to_string(index);
+        }
+
+        for (ULONG offset = 0; offset < Snapshot.ReportLength; offset++)
+        {
+            if (Snapshot.Report[offset] != static_cast<UCHAR>(index))
+            {
+                return "byte " + std::to_string(offset) + " torn in report " + std::to_string(index);
+            }
+        }
+
+        return std::string();
+    }
+
+    std::unique_ptr<BTHPS3_STATE_PAGE> MakePage()
+    {
+        auto page = std::make_unique<BTHPS3_STATE_PAGE>();
+
+        BthPS3_StatePageInit(page.get());
+
+        return page;
+    }
+}
+
+TEST(StatePageTests, InitClearsPage)
+{
+    BTHPS3_STATE_PAGE page;
+
+    std::memset(&page, 0xCC, sizeof(page));
+
+    BthPS3_StatePageInit(&page);
+
+    EXPECT_EQ(0, page.Sequence);
+    EXPECT_EQ(0u, page.ReportLength);
+    EXPECT_EQ(0u, page.Timestamp);
+    EXPECT_EQ(0u, page.ReportCount);
+}
+
+TEST(StatePageTests, PublishStoresReport)
+{
+    const auto page = MakePage();
+    const UCHAR report[] = { 0xA1, 0x01, 0x00, 0x7F };
+
+    BthPS3_StatePagePublish(page.get(), report, sizeof(report), 123456);
+
+    EXPECT_EQ(2, page->Sequence);
+    EXPECT_EQ(sizeof(report), page->ReportLength);
+    EXPECT_EQ(123456u, page->Timestamp);
+    EXPECT_EQ(1u, page->ReportCount);
+    EXPECT_EQ(0, std::memcmp(report, page->Report, sizeof(report)));
+}
+
+TEST(StatePageTests, PublishTruncatesLongReports)
+{
+    const auto page = MakePage();
+    std::vector<UCHAR> report(BTHPS3_STATE_PAGE_REPORT_SIZE + 16, 0x5A);
+
+    BthPS3_StatePagePublish(page.get(), report.data(), static_cast<ULONG>(report.size()), 1);
+
+    EXPECT_EQ(static_cast<ULONG>(BTHPS3_STATE_PAGE_REPORT_SIZE), page->ReportLength);
+}
+
+TEST(StatePageTests, SequenceStaysEvenBetweenUpdates)
+{
+    const auto page = MakePage();
+
+    for (ULONG64 index = 1; index <= 100; index++)
+    {
+        Publish(page.get(), index);
+
+        ASSERT_EQ(0, page->Sequence & 1);
+        ASSERT_EQ(static_cast<LONG>(2 * index), page->Sequence);
+    }
+}
+
+TEST(StatePageTests, ReaderCopiesIdlePage)
+{
+    const auto page = MakePage();
+    BTHPS3_STATE_PAGE snapshot;
+
+    for (ULONG64 index = 1; index <= 7; index++)
+    {
+        Publish(page.get(), index);
+    }
+
+    ASSERT_TRUE(PdoClient::ReadStatePage(*page, snapshot));
+    EXPECT_EQ("", Inconsistency(snapshot));
+    EXPECT_EQ(7u, snapshot.Timestamp);
+}
+
+TEST(StatePageTests, ReaderGivesUpWhileUpdateInProgress)
+{
+    const auto page = MakePage();
+    BTHPS3_STATE_PAGE snapshot;
+
+    Publish(page.get(), 1);
+
+    //
+    // Publisher stopped between its two increments
+    // 
+    page->Sequence++;
+
+    EXPECT_FALSE(PdoClient::ReadStatePage(*page, snapshot, 16));
+
+    page->Sequence++;
+
+    EXPECT_TRUE(PdoClient::ReadStatePage(*page, snapshot, 16));
+}
+
+//
+// One publisher at full speed against several polling readers, every copy
+// a reader accepts must be one the publisher wrote as a whole
+// 
+TEST(StatePageTests, ConcurrentReadersNeverSeeTornReports)
+{
+    constexpr ULONG64 Reports = 500000;
+    constexpr unsigned Readers = 3;
+
+    const auto page = MakePage();
+    std::atomic<bool> isDone{ false };
+    std::atomic<ULONG64> accepted{ 0 };
+    std::atomic<ULONG64> newer{ 0 };
+    std::atomic<ULONG64> gaveUp{ 0 };
+    std::vector<std::string> failures(Readers);
+    std::vector<std::thread> readers;
+
+    for (unsigned reader = 0; reader < Readers; reader++)
+    {
+        readers.emplace_back([&, reader]
+        {
+            BTHPS3_STATE_PAGE snapshot;
+            ULONG64 last = 0;
+
+            while (!isDone.load(std::memory_order_relaxed) && failures[reader].empty())
+            {
+                if (!PdoClient::ReadStatePage(*page, snapshot))
+                {
+                    gaveUp++;
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                accepted++;
+                failures[reader] = Inconsistency(snapshot);
+
+                //
+                // Never goes back to an older report
+                // 
+                if (snapshot.Timestamp < last)
+                {
+                    failures[reader] = "report " + std::to_string(snapshot.Timestamp) + " after " + std::to_string(last);
+                }
+
+                if (snapshot.Timestamp > last)
+                {
+                    newer++;
+                }
+
+                last = snapshot.Timestamp;
+
+                //
+                // Polls rather than spins, like once per frame
+                // 
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    for (ULONG64 index = 1; index <= Reports; index++)
+    {
+        Publish(page.get(), index);
+
+        //
+        // Every so often leave the readers a gap like the time between two
+        // reports does, back to back otherwise. Also gets them scheduled at
+        // all on a single processor.
+        // 
+        if (index % 4 == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    isDone = true;
+
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    for (unsigned reader = 0; reader < Readers; reader++)
+    {
+        EXPECT_EQ("", failures[reader]) << "reader " << reader;
+    }
+
+    EXPECT_EQ(static_cast<LONG>(2 * Reports), page->Sequence);
+    EXPECT_GT(accepted.load(), 0u);
+
+    RecordProperty("accepted_copies", std::to_string(accepted.load()));
+    RecordProperty("newer_reports_seen", std::to_string(newer.load()));
+    RecordProperty("reads_given_up", std::to_string(gaveUp.load()));
+}
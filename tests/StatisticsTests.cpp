@@ -0,0 +1,173 @@
+/**********************************************************************************
+ *                                                                                *
+ * BthPS3 - Windows kernel-mode Bluetooth profile and bus driver                  *
+ *                                                                                *
+ * BSD 3-Clause License                                                           *
+ *                                                                                *
+ * Copyright (c) 2018-2025, Nefarius Software Solutions e.U.                      *
+ * All rights reserved.                                                           *
+ *                                                                                *
+ * Redistribution and use in source and binary forms, with or without             *
+ * modification, are permitted provided that the following conditions are met:    *
+ *                                                                                *
+ * 1. Redistributions of source code must retain the above copyright notice, this *
+ *    list of conditions and the following disclaimer.                            *
+ *                                                                                *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,   *
+ *    this list of conditions and the following disclaimer in the documentation   *
+ *    and/or other materials provided with the distribution.                      *
+ *                                                                                *
+ * 3. Neither the name of the copyright holder nor the names of its               *
+ *    contributors may be used to endorse or promote products derived from        *
+ *    this software without specific prior written permission.                    *
+ *                                                                                *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"    *
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE      *
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE *
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE   *
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL     *
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR     *
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER     *
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,  *
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE  *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.           *
+ *                                                                                *
+ **********************************************************************************/
+
+
+
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <vector>
+
+extern "C" {
+#include <BthPS3Portable.h>
+#include <BthPS3PSM/StatisticsSlots.h>
+}
+
+namespace
+{
+    //
+    // Fills every counter of a block with a value derived from the slot index
+    // 
+    void FillSlot(BTHPS3PSM_STATISTICS& Counters, ULONG64 Base)
+    {
+        for (ULONG i = 0; i < BTHPS3PSM_STATS_URB_FUNCTION_COUNT; i++)
+        {
+            Counters.UrbsByFunction[i] = Base + i;
+        }
+
+        Counters.UrbsOtherFunction = Base * 2;
+        Counters.BulkInTransfers = Base * 3;
+        Counters.BulkInBytes = Base * 4;
+
+        for (ULONG i = 0; i < BTHPS3PSM_STATS_SIGNALLING_CODE_COUNT; i++)
+        {
+            Counters.SignallingCommands[i] = Base * 5 + i;
+        }
+
+        Counters.PsmsPatched = Base * 6;
+        Counters.PsmsNotPatched = Base * 7;
+        Counters.CompletionRoutineTicks = Base * 8;
+        Counters.CompletionRoutineTicksMax = Base * 9;
+    }
+}
+
+TEST(StatisticsTests, SlotsOccupyWholeCacheLines)
+{
+    EXPECT_EQ(alignof(BTHPS3PSM_STATISTICS_SLOT), 64u);
+    EXPECT_EQ(sizeof(BTHPS3PSM_STATISTICS_SLOT) % 64, 0u);
+    EXPECT_GE(sizeof(BTHPS3PSM_STATISTICS_SLOT), sizeof(BTHPS3PSM_STATISTICS));
+
+    BTHPS3PSM_STATISTICS_SLOT slots[2];
+
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(&slots[0]) % 64, 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(&slots[1]) % 64, 0u);
+}
+
+TEST(StatisticsTests, CounterBlockIsPackedUnsigned64BitCounters)
+{
+    //
+    // The block is copied to user mode as-is, so it must be free of padding
+    // 
+    constexpr size_t counters = BTHPS3PSM_STATS_URB_FUNCTION_COUNT + BTHPS3PSM_STATS_SIGNALLING_CODE_COUNT + 7;
+
+    EXPECT_EQ(sizeof(BTHPS3PSM_STATISTICS), counters * sizeof(ULONG64));
+    EXPECT_EQ(offsetof(BTHPS3PSM_STATISTICS, UrbsOtherFunction), BTHPS3PSM_STATS_URB_FUNCTION_COUNT * sizeof(ULONG64));
+    EXPECT_EQ(
+        offsetof(BTHPS3PSM_STATISTICS, CompletionRoutineTicksMax),
+        sizeof(BTHPS3PSM_STATISTICS) - sizeof(ULONG64)
+    );
+}
+
+TEST(StatisticsTests, UrbCounterUsesOverflowBucketBeyondTable)
+{
+    BTHPS3PSM_STATISTICS counters = {};
+
+    EXPECT_EQ(BthPS3PSM_StatisticsUrbCounter(&counters, 0), &counters.UrbsByFunction[0]);
+    EXPECT_EQ(
+        BthPS3PSM_StatisticsUrbCounter(&counters, BTHPS3PSM_STATS_URB_FUNCTION_COUNT - 1),
+        &counters.UrbsByFunction[BTHPS3PSM_STATS_URB_FUNCTION_COUNT - 1]
+    );
+    EXPECT_EQ(BthPS3PSM_StatisticsUrbCounter(&counters, BTHPS3PSM_STATS_URB_FUNCTION_COUNT), &counters.UrbsOtherFunction);
+    EXPECT_EQ(BthPS3PSM_StatisticsUrbCounter(&counters, 0xFFFF), &counters.UrbsOtherFunction);
+}
+
+TEST(StatisticsTests, SumAddsCountersAndKeepsLongestCompletion)
+{
+    constexpr ULONG slotCount = 5;
+    std::vector<BTHPS3PSM_STATISTICS_SLOT> slots(slotCount);
+    BTHPS3PSM_STATISTICS result;
+
+    for (ULONG i = 0; i < slotCount; i++)
+    {
+        FillSlot(slots[i].Counters, i + 1);
+    }
+
+    //
+    // Not the last slot, so the maximum isn't simply the last value seen
+    // 
+    slots[2].Counters.CompletionRoutineTicksMax = 1000;
+
+    memset(&result, 0xCC, sizeof(result));
+
+    BthPS3PSM_StatisticsSumSlots(slots.data(), slotCount, &result);
+
+    //
+    // Sum of bases 1..5
+    // 
+    constexpr ULONG64 sum = 15;
+
+    for (ULONG i = 0; i < BTHPS3PSM_STATS_URB_FUNCTION_COUNT; i++)
+    {
+        EXPECT_EQ(result.UrbsByFunction[i], sum + slotCount * i);
+    }
+
+    EXPECT_EQ(result.UrbsOtherFunction, sum * 2);
+    EXPECT_EQ(result.BulkInTransfers, sum * 3);
+    EXPECT_EQ(result.BulkInBytes, sum * 4);
+
+    for (ULONG i = 0; i < BTHPS3PSM_STATS_SIGNALLING_CODE_COUNT; i++)
+    {
+        EXPECT_EQ(result.SignallingCommands[i], sum * 5 + slotCount * i);
+    }
+
+    EXPECT_EQ(result.PsmsPatched, sum * 6);
+    EXPECT_EQ(result.PsmsNotPatched, sum * 7);
+    EXPECT_EQ(result.CompletionRoutineTicks, sum * 8);
+    EXPECT_EQ(result.CompletionRoutineTicksMax, 1000u);
+}
+
+TEST(StatisticsTests, SumOfNoSlotsIsZero)
+{
+    BTHPS3PSM_STATISTICS result;
+    const BTHPS3PSM_STATISTICS zero = {};
+
+    memset(&result, 0xCC, sizeof(result));
+
+    BthPS3PSM_StatisticsSumSlots(nullptr, 0, &result);
+
+    EXPECT_EQ(memcmp(&result, &zero, sizeof(result)), 0);
+}